@@ -32,6 +32,7 @@
 #include <BBSKernel/CorrelationMask.h>
 #include <BBSKernel/MeasurementExpr.h>
 #include <BBSKernel/VisBuffer.h>
+#include <BBSKernel/Expr/ExprProgram.h>
 
 #include <Common/lofar_iostream.h>
 #include <Common/Timer.h>
@@ -41,6 +42,8 @@ namespace LOFAR
 namespace BBS
 {
 
+class MeasurementExprLOFAR;
+
 // \addtogroup BBSKernel
 // @{
 
@@ -71,6 +74,11 @@ public:
     // Set operation to perform on the data (equate, subtract, or add).
     void setMode(Mode mode);
 
+    // Evaluate the model using its compiled form (see ExprProgram) when
+    // possible, i.e. when the model is a MeasurementExprLOFAR instance and no
+    // partial derivatives are required (default: true).
+    void setUseProgram(bool use);
+
     // Evaluate the expressions in the set and process the visibilities
     // according to the current processing mode.
     void process();
@@ -107,6 +115,18 @@ private:
     template <typename T_OPERATOR>
     void procExpr(size_t &bl, const JonesMatrix &rhs);
 
+    // Signature of sample processor function for compiled expressions.
+    typedef void (Evaluator::*ProgramProcessor)(size_t &bl,
+        const ExprProgram::Result &rhs);
+
+    template <typename T_OPERATOR>
+    void procProgramWithFlags(size_t &bl, const ExprProgram::Result &rhs);
+
+    template <typename T_OPERATOR>
+    void procProgram(size_t &bl, const ExprProgram::Result &rhs);
+
+    void processProgram();
+
     // Visibility data buffer.
     VisBuffer::Ptr                  itsLHS;
     // Measurement equation.
@@ -117,6 +137,10 @@ private:
     vector<pair<size_t, size_t> >   itsBlMap, itsCrMap;
 
     ExprProcessor                   itsExprProcessor[2];
+    ProgramProcessor                itsProgramProcessor[2];
+
+    // Measurement equation, if it can be evaluated using its compiled form.
+    shared_ptr<MeasurementExprLOFAR>    itsProgramRHS;
 
     // Timers.
     enum ProcTimer
@@ -250,6 +274,86 @@ void Evaluator::procExpr(size_t &bl, const JonesMatrix &rhs)
     }
 }
 
+template <typename T_OPERATOR>
+void Evaluator::procProgramWithFlags(size_t &bl, const ExprProgram::Result &rhs)
+{
+    // Determine no. of samples along frequency and time axis.
+    const size_t nFreq = itsLHS->grid()[FREQ]->size();
+    const size_t nTime = itsLHS->grid()[TIME]->size();
+
+    // Determine flag iterator increments (0 for scalar flags).
+    const size_t flagStep = rhs.flags.rank() == 0 ? 0 : 1;
+    DBGASSERT(rhs.flags.rank() == 0 || rhs.flags.size() == nFreq * nTime);
+
+    for(size_t cr = 0; cr < itsCrMap.size(); ++cr)
+    {
+        const size_t crLHS = itsCrMap[cr].first;
+        const size_t crRHS = itsCrMap[cr].second;
+
+        // Get random access iterator for the flags.
+        FlagArray::const_iterator flagIt = rhs.flags.begin();
+
+        // Get pointers to the computed visibilities (always an array).
+        const double *reIt = rhs.re[crRHS], *imIt = rhs.im[crRHS];
+
+        // Get a view on the relevant slice of the data buffer.
+        typedef boost::multi_array<flag_t, 4>::index_range FRange;
+        typedef boost::multi_array<flag_t, 4>::array_view<2>::type FSlice;
+        FSlice flagsLHS(itsLHS->flags[boost::indices[bl][FRange()][FRange()]
+            [crLHS]]);
+
+        typedef boost::multi_array<dcomplex, 4>::index_range SRange;
+        typedef boost::multi_array<dcomplex, 4>::array_view<2>::type SSlice;
+        SSlice samplesLHS(itsLHS->samples[boost::indices[bl][SRange()]
+            [SRange()][crLHS]]);
+
+        // Process visibilities and flags.
+        for(size_t t = 0; t < nTime; ++t)
+        {
+            for(size_t f = 0; f < nFreq; ++f)
+            {
+                flagsLHS[t][f] |= *flagIt;
+                T_OPERATOR::apply(samplesLHS[t][f], makedcomplex(*reIt++,
+                    *imIt++));
+                flagIt += flagStep;
+            }
+        }
+    }
+}
+
+template <typename T_OPERATOR>
+void Evaluator::procProgram(size_t &bl, const ExprProgram::Result &rhs)
+{
+    // Determine no. of samples along frequency and time axis.
+    const size_t nFreq = itsLHS->grid()[FREQ]->size();
+    const size_t nTime = itsLHS->grid()[TIME]->size();
+
+    for(size_t cr = 0; cr < itsCrMap.size(); ++cr)
+    {
+        const size_t crLHS = itsCrMap[cr].first;
+        const size_t crRHS = itsCrMap[cr].second;
+
+        // Get pointers to the computed visibilities (always an array).
+        const double *reIt = rhs.re[crRHS], *imIt = rhs.im[crRHS];
+
+        // Get a view on the relevant slice of the data buffer.
+        typedef boost::multi_array<dcomplex, 4>::index_range SRange;
+        typedef boost::multi_array<dcomplex, 4>::array_view<2>::type SSlice;
+        SSlice samplesLHS(itsLHS->samples[boost::indices[bl][SRange()]
+            [SRange()][crLHS]]);
+
+        // Process visibilities.
+        for(size_t t = 0; t < nTime; ++t)
+        {
+            for(size_t f = 0; f < nFreq; ++f)
+            {
+                T_OPERATOR::apply(samplesLHS[t][f], makedcomplex(*reIt++,
+                    *imIt++));
+            }
+        }
+    }
+}
+
 } //# namespace BBS
 } //# namespace LOFAR
 
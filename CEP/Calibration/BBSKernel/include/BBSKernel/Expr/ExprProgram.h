@@ -0,0 +1,274 @@
+//# ExprProgram.h: Flat, allocation free evaluation of the arithmetic part of a
+//# set of Jones matrix expressions.
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_BBSKERNEL_EXPR_EXPRPROGRAM_H
+#define LOFAR_BBSKERNEL_EXPR_EXPRPROGRAM_H
+
+// \file
+// Flat, allocation free evaluation of the arithmetic part of a set of Jones
+// matrix expressions.
+
+#include <BBSKernel/Expr/Expr.h>
+#include <Common/lofar_smartptr.h>
+#include <Common/lofar_map.h>
+#include <Common/lofar_vector.h>
+
+namespace LOFAR
+{
+namespace BBS
+{
+
+// \addtogroup Expr
+// @{
+
+// An ExprProgram is a set of Jones matrix expressions (e.g. one per baseline)
+// compiled into a flat list of typed instructions. The nodes that only combine
+// Jones matrices (MatrixMul2, MatrixMul3, and MatrixSum) are compiled. All
+// other nodes are leaves of the program; they are evaluated through
+// Expr::evaluate() and can therefore still be cached as usual.
+//
+// The instructions are executed per chunk of cells on split complex buffers
+// that are allocated once, so no temporary Matrix instances are created and no
+// virtual calls are made on the hot path. A MatrixMul3 that is a term of a
+// MatrixSum is fused into a single multiply-accumulate instruction.
+//
+// Nodes that are used by more than one expression (e.g. the product of the
+// direction dependent effects of a station) are computed once per request into
+// a buffer that covers the whole grid.
+//
+// Only the main value is computed; perturbed values are ignored. Therefore, a
+// program should not be used to evaluate expressions that depend on
+// solvables.
+class ExprProgram
+{
+public:
+    typedef shared_ptr<ExprProgram>         Ptr;
+    typedef shared_ptr<const ExprProgram>   ConstPtr;
+
+    // The value of a Jones matrix expression. The elements (in row major
+    // order) are stored as separate real and imaginary arrays of nFreq x nTime
+    // cells, with frequency varying fastest.
+    struct Result
+    {
+        const double    *re[4];
+        const double    *im[4];
+        bool            hasFlags;
+        FlagArray       flags;
+    };
+
+    // Compile the expressions in the range [first, last).
+    template <typename T_ITER>
+    ExprProgram(T_ITER first, T_ITER last, unsigned int chunkSize = 128);
+
+    // Number of compiled expressions.
+    unsigned int size() const;
+
+    // \name Program statistics
+    // @{
+    unsigned int nInstructions() const;
+    unsigned int nLeaves() const;
+    unsigned int nShared() const;
+    // @}
+
+    // Set the request for which the expressions are evaluated. The leaves are
+    // evaluated using the given cache. This invalidates the results of shared
+    // nodes, so it should also be called if the values of the leaves may have
+    // changed.
+    void setRequest(const Request &request, Cache &cache,
+        unsigned int grid = 0);
+
+    // Evaluate expression i. The result remains valid until the next call.
+    const Result &evaluate(unsigned int i);
+
+private:
+    enum Opcode
+    {
+        ZERO,
+        ASSIGN,
+        ADD,
+        MUL2,
+        MUL3,
+        MUL3_ADD,
+        N_Opcode
+    };
+
+    enum Location
+    {
+        LEAF,
+        SHARED,
+        TEMP,
+        OUTPUT,
+        N_Location
+    };
+
+    struct Operand
+    {
+        Operand(Location location = TEMP, unsigned int index = 0);
+
+        Location        location;
+        unsigned int    index;
+    };
+
+    struct Instruction
+    {
+        Opcode          opcode;
+        Operand         dst;
+        Operand         arg[3];
+    };
+
+    // The code to compute a single expression or shared node.
+    struct Segment
+    {
+        Segment();
+
+        vector<Instruction>     code;
+        vector<unsigned int>    leaves;
+        vector<unsigned int>    shared;
+        unsigned int            nTemps;
+    };
+
+    // A Jones matrix of split complex buffers for a chunk of cells.
+    struct Registers
+    {
+        double  *re[4];
+        double  *im[4];
+    };
+
+    // The value of a leaf, bound to the current request.
+    struct Binding
+    {
+        JonesMatrix     value;
+        const double    *re[4];
+        const double    *im[4];
+        bool            reIsArray[4];
+        bool            imIsArray[4];
+    };
+
+    // The value of a shared node for the current request.
+    struct SharedValue
+    {
+        bool            valid;
+        bool            hasFlags;
+        FlagArray       flags;
+        vector<double>  data;
+    };
+
+    // Forbid copy and assignment.
+    ExprProgram(const ExprProgram &);
+    ExprProgram &operator=(const ExprProgram &);
+
+    void compile(const Expr<JonesMatrix>::ConstPtr &expr);
+    void compileNode(const Expr<JonesMatrix>::ConstPtr &expr, Segment &segment,
+        const Operand &dst, vector<unsigned int> &free);
+    Operand compileArgument(const Expr<JonesMatrix>::ConstPtr &expr,
+        Segment &segment, vector<unsigned int> &free);
+    Operand allocateTemp(Segment &segment, vector<unsigned int> &free) const;
+    void releaseTemp(const Operand &operand, vector<unsigned int> &free) const;
+    void emit(Segment &segment, Opcode opcode, const Operand &dst,
+        const Operand &arg0 = Operand(), const Operand &arg1 = Operand(),
+        const Operand &arg2 = Operand()) const;
+    static bool isCompilable(const Expr<JonesMatrix>::ConstPtr &expr);
+
+    void evaluateShared(unsigned int i);
+    void run(const Segment &segment, double *dst, bool &hasFlags,
+        FlagArray &flags);
+    void bind(const Segment &segment, bool &hasFlags, FlagArray &flags);
+    void resolve(const Operand &operand, size_t start, double *dst,
+        Registers &registers);
+
+    unsigned int                    itsChunkSize;
+
+    // Compiled program.
+    vector<Expr<JonesMatrix>::ConstPtr> itsLeaves;
+    map<ExprId, unsigned int>           itsLeafIndex;
+    vector<Segment>                     itsSharedCode;
+    map<ExprId, unsigned int>           itsSharedIndex;
+    vector<Segment>                     itsCode;
+
+    // State for the current request.
+    const Request                   *itsRequest;
+    Cache                           *itsCache;
+    unsigned int                    itsGrid;
+    size_t                          itsCellCount;
+    vector<Binding>                 itsBindings;
+    vector<SharedValue>             itsSharedValues;
+    vector<double>                  itsTemps;
+    vector<double>                  itsConstants;
+    vector<double>                  itsZeros;
+    vector<double>                  itsOutput;
+    Result                          itsResult;
+};
+
+// @}
+
+// -------------------------------------------------------------------------- //
+// - Implementation: ExprProgram                                            - //
+// -------------------------------------------------------------------------- //
+
+template <typename T_ITER>
+ExprProgram::ExprProgram(T_ITER first, T_ITER last, unsigned int chunkSize)
+    :   itsChunkSize(chunkSize),
+        itsRequest(0),
+        itsCache(0),
+        itsGrid(0),
+        itsCellCount(0)
+{
+    ASSERT(itsChunkSize > 0);
+    for(; first != last; ++first)
+    {
+        compile(*first);
+    }
+    itsBindings.resize(itsLeaves.size());
+    itsSharedValues.resize(itsSharedCode.size());
+}
+
+inline ExprProgram::Operand::Operand(Location location, unsigned int index)
+    :   location(location),
+        index(index)
+{
+}
+
+inline ExprProgram::Segment::Segment()
+    :   nTemps(0)
+{
+}
+
+inline unsigned int ExprProgram::size() const
+{
+    return itsCode.size();
+}
+
+inline unsigned int ExprProgram::nLeaves() const
+{
+    return itsLeaves.size();
+}
+
+inline unsigned int ExprProgram::nShared() const
+{
+    return itsSharedCode.size();
+}
+
+} // namespace BBS
+} // namespace LOFAR
+
+#endif
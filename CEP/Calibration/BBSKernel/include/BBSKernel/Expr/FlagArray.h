@@ -473,22 +473,50 @@ inline FlagArray::iterator FlagArray::end()
 
 inline void FlagArray::operator|=(const FlagArray &rhs)
 {
-    instance().opBitWiseOr(rhs.instance(), true, false);
+    FlagArrayImpl *result = instance().opBitWiseOr(rhs.instance(), true, false);
+
+    // The operation can only be performed in place if the shape of the result
+    // equals the shape of this FlagArray.
+    if(result != &instance())
+    {
+        *this = FlagArray(result);
+    }
 }
 
 inline void FlagArray::operator|=(const FlagArrayTemporary &rhs)
 {
-    instance().opBitWiseOr(rhs.instance(), true, true);
+    FlagArrayImpl *result = instance().opBitWiseOr(rhs.instance(), true, true);
+
+    // The operation can only be performed in place if the shape of the result
+    // equals the shape of this FlagArray.
+    if(result != &instance())
+    {
+        *this = FlagArray(result);
+    }
 }
 
 inline void FlagArray::operator&=(const FlagArray &rhs)
 {
-    instance().opBitWiseAnd(rhs.instance(), true, false);
+    FlagArrayImpl *result = instance().opBitWiseAnd(rhs.instance(), true, false);
+
+    // The operation can only be performed in place if the shape of the result
+    // equals the shape of this FlagArray.
+    if(result != &instance())
+    {
+        *this = FlagArray(result);
+    }
 }
 
 inline void FlagArray::operator&=(const FlagArrayTemporary &rhs)
 {
-    instance().opBitWiseAnd(rhs.instance(), true, true);
+    FlagArrayImpl *result = instance().opBitWiseAnd(rhs.instance(), true, true);
+
+    // The operation can only be performed in place if the shape of the result
+    // equals the shape of this FlagArray.
+    if(result != &instance())
+    {
+        *this = FlagArray(result);
+    }
 }
 
 // -------------------------------------------------------------------------- //
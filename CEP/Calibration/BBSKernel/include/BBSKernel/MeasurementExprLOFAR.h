@@ -38,6 +38,7 @@
 #include <BBSKernel/VisBuffer.h>
 #include <BBSKernel/Expr/CachePolicy.h>
 #include <BBSKernel/Expr/Expr.h>
+#include <BBSKernel/Expr/ExprProgram.h>
 #include <BBSKernel/Expr/Scope.h>
 #include <BBSKernel/Expr/Source.h>
 #include <ParmDB/ParmDB.h>
@@ -102,6 +103,13 @@ public:
     virtual const JonesMatrix evaluate(unsigned int i);
     // @}
 
+    // Evaluate the expression with index i on the evaluation grid using the
+    // compiled form of the expressions in the set (see ExprProgram). The
+    // expressions are compiled on first use. Partial derivatives are not
+    // computed, so this should only be used if the set of solvables is empty.
+    // The result remains valid until the next call.
+    const ExprProgram::Result &evaluateProgram(unsigned int i);
+
 private:
     void makeForwardExpr(SourceDB &sourceDB,
         const BufferMap &buffers,
@@ -138,6 +146,7 @@ private:
     vector<Expr<JonesMatrix>::Ptr>  itsExpr;
     Scope                           itsScope;
     CachePolicy::Ptr                itsCachePolicy;
+    ExprProgram::Ptr                itsProgram;
 };
 
 // @}
@@ -25,6 +25,7 @@
 
 #include <BBSKernel/Evaluator.h>
 #include <BBSKernel/Exceptions.h>
+#include <BBSKernel/MeasurementExprLOFAR.h>
 #include <BBSKernel/Expr/Timer.h>
 
 namespace LOFAR
@@ -53,6 +54,7 @@ Evaluator::Evaluator(const VisBuffer::Ptr &lhs, const MeasurementExpr::Ptr &rhs)
 
     // Set default processing mode.
     setMode(EQUATE);
+    setUseProgram(true);
 
     // Set request grid.
     // TODO: More robust checks on expression domain.
@@ -90,20 +92,35 @@ void Evaluator::setMode(Mode mode)
     case EQUATE:
         itsExprProcessor[0] = &Evaluator::procExprWithFlags<OpEq>;
         itsExprProcessor[1] = &Evaluator::procExpr<OpEq>;
+        itsProgramProcessor[0] = &Evaluator::procProgramWithFlags<OpEq>;
+        itsProgramProcessor[1] = &Evaluator::procProgram<OpEq>;
         break;
     case SUBTRACT:
         itsExprProcessor[0] = &Evaluator::procExprWithFlags<OpSub>;
         itsExprProcessor[1] = &Evaluator::procExpr<OpSub>;
+        itsProgramProcessor[0] = &Evaluator::procProgramWithFlags<OpSub>;
+        itsProgramProcessor[1] = &Evaluator::procProgram<OpSub>;
         break;
     case ADD:
         itsExprProcessor[0] = &Evaluator::procExprWithFlags<OpAdd>;
         itsExprProcessor[1] = &Evaluator::procExpr<OpAdd>;
+        itsProgramProcessor[0] = &Evaluator::procProgramWithFlags<OpAdd>;
+        itsProgramProcessor[1] = &Evaluator::procProgram<OpAdd>;
         break;
     default:
         THROW(BBSKernelException, "Invalid processing mode specified.");
     }
 }
 
+void Evaluator::setUseProgram(bool use)
+{
+    itsProgramRHS.reset();
+    if(use)
+    {
+        itsProgramRHS = dynamic_pointer_cast<MeasurementExprLOFAR>(itsRHS);
+    }
+}
+
 void Evaluator::process()
 {
     itsProcTimers[ALL].start();
@@ -114,6 +131,14 @@ void Evaluator::process()
         return;
     }
 
+    // The compiled form of the model does not compute partial derivatives.
+    if(itsProgramRHS && itsProgramRHS->solvables().empty())
+    {
+        processProgram();
+        itsProcTimers[ALL].stop();
+        return;
+    }
+
     for(size_t i = 0; i < itsBlMap.size(); ++i)
     {
         // Evaluate the expression for this baseline.
@@ -146,6 +171,31 @@ void Evaluator::process()
     itsProcTimers[ALL].stop();
 }
 
+void Evaluator::processProgram()
+{
+    for(size_t i = 0; i < itsBlMap.size(); ++i)
+    {
+        // Evaluate the expression for this baseline.
+        itsProcTimers[EVAL_RHS].start();
+        const ExprProgram::Result &rhs =
+            itsProgramRHS->evaluateProgram(itsBlMap[i].second);
+        itsProcTimers[EVAL_RHS].stop();
+
+        itsProcTimers[APPLY].start();
+        // Process the visibilities according to the current processing mode.
+        if(itsLHS->hasFlags() && rhs.hasFlags
+            && (rhs.flags.rank() > 0 || rhs.flags(0, 0) != 0))
+        {
+            (this->*itsProgramProcessor[0])(itsBlMap[i].first, rhs);
+        }
+        else
+        {
+            (this->*itsProgramProcessor[1])(itsBlMap[i].first, rhs);
+        }
+        itsProcTimers[APPLY].stop();
+    }
+}
+
 void Evaluator::clearStats()
 {
     for(size_t i = 0; i < Evaluator::N_ProcTimer; ++i)
@@ -0,0 +1,746 @@
+//# ExprProgram.cc: Flat, allocation free evaluation of the arithmetic part of
+//# a set of Jones matrix expressions.
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <BBSKernel/Expr/ExprProgram.h>
+#include <BBSKernel/Expr/MatrixMul2.h>
+#include <BBSKernel/Expr/MatrixMul3.h>
+#include <BBSKernel/Expr/MatrixSum.h>
+#include <BBSKernel/Exceptions.h>
+#include <Common/lofar_algorithm.h>
+
+namespace LOFAR
+{
+namespace BBS
+{
+
+namespace
+{
+    // Return argument i of a Jones matrix expression.
+    Expr<JonesMatrix>::ConstPtr argument(const Expr<JonesMatrix>::ConstPtr &expr,
+        unsigned int i)
+    {
+        // ExprBase::argument() is public, but it is protected in most of the
+        // derived classes.
+        const ExprBase &base = *expr;
+        Expr<JonesMatrix>::ConstPtr arg =
+            dynamic_pointer_cast<const Expr<JonesMatrix> >(base.argument(i));
+        ASSERT(arg);
+        return arg;
+    }
+
+    // Kernels. All arguments are 2x2 complex matrices stored as separate
+    // arrays per element, in row major order: re[0] = Re(A00), re[1] =
+    // Re(A01), re[2] = Re(A10), re[3] = Re(A11). The arithmetic is done in the
+    // same order as in MatrixMul2, MatrixMul3, and MatrixSum.
+
+    inline void mul(double &outRe, double &outIm, double lRe, double lIm,
+        double rRe, double rIm)
+    {
+        outRe = lRe * rRe - lIm * rIm;
+        outIm = lRe * rIm + lIm * rRe;
+    }
+
+    // out = l * conj(r)
+    inline void mulConj(double &outRe, double &outIm, double lRe, double lIm,
+        double rRe, double rIm)
+    {
+        outRe = lRe * rRe + lIm * rIm;
+        outIm = lIm * rRe - lRe * rIm;
+    }
+
+    void kernelZero(size_t n, double *const *dstRe, double *const *dstIm)
+    {
+        for(unsigned int k = 0; k < 4; ++k)
+        {
+            fill(dstRe[k], dstRe[k] + n, 0.0);
+            fill(dstIm[k], dstIm[k] + n, 0.0);
+        }
+    }
+
+    void kernelAssign(size_t n, double *const *dstRe, double *const *dstIm,
+        double *const *aRe, double *const *aIm)
+    {
+        for(unsigned int k = 0; k < 4; ++k)
+        {
+            copy(aRe[k], aRe[k] + n, dstRe[k]);
+            copy(aIm[k], aIm[k] + n, dstIm[k]);
+        }
+    }
+
+    void kernelAdd(size_t n, double *const *dstRe, double *const *dstIm,
+        double *const *aRe, double *const *aIm)
+    {
+        for(unsigned int k = 0; k < 4; ++k)
+        {
+            double *outRe = dstRe[k];
+            double *outIm = dstIm[k];
+            const double *inRe = aRe[k];
+            const double *inIm = aIm[k];
+            for(size_t i = 0; i < n; ++i)
+            {
+                outRe[i] += inRe[i];
+                outIm[i] += inIm[i];
+            }
+        }
+    }
+
+    // dst = a * b
+    void kernelMul2(size_t n, double *const *dstRe, double *const *dstIm,
+        double *const *aRe, double *const *aIm, double *const *bRe,
+        double *const *bIm)
+    {
+        const double *a00r = aRe[0], *a01r = aRe[1], *a10r = aRe[2],
+            *a11r = aRe[3];
+        const double *a00i = aIm[0], *a01i = aIm[1], *a10i = aIm[2],
+            *a11i = aIm[3];
+        const double *b00r = bRe[0], *b01r = bRe[1], *b10r = bRe[2],
+            *b11r = bRe[3];
+        const double *b00i = bIm[0], *b01i = bIm[1], *b10i = bIm[2],
+            *b11i = bIm[3];
+        double *d00r = dstRe[0], *d01r = dstRe[1], *d10r = dstRe[2],
+            *d11r = dstRe[3];
+        double *d00i = dstIm[0], *d01i = dstIm[1], *d10i = dstIm[2],
+            *d11i = dstIm[3];
+
+        for(size_t i = 0; i < n; ++i)
+        {
+            const double ar[4] = {a00r[i], a01r[i], a10r[i], a11r[i]};
+            const double ai[4] = {a00i[i], a01i[i], a10i[i], a11i[i]};
+            const double br[4] = {b00r[i], b01r[i], b10r[i], b11r[i]};
+            const double bi[4] = {b00i[i], b01i[i], b10i[i], b11i[i]};
+
+            double re0, im0, re1, im1;
+            mul(re0, im0, ar[0], ai[0], br[0], bi[0]);
+            mul(re1, im1, ar[1], ai[1], br[2], bi[2]);
+            d00r[i] = re0 + re1;
+            d00i[i] = im0 + im1;
+
+            mul(re0, im0, ar[0], ai[0], br[1], bi[1]);
+            mul(re1, im1, ar[1], ai[1], br[3], bi[3]);
+            d01r[i] = re0 + re1;
+            d01i[i] = im0 + im1;
+
+            mul(re0, im0, ar[2], ai[2], br[0], bi[0]);
+            mul(re1, im1, ar[3], ai[3], br[2], bi[2]);
+            d10r[i] = re0 + re1;
+            d10i[i] = im0 + im1;
+
+            mul(re0, im0, ar[2], ai[2], br[1], bi[1]);
+            mul(re1, im1, ar[3], ai[3], br[3], bi[3]);
+            d11r[i] = re0 + re1;
+            d11i[i] = im0 + im1;
+        }
+    }
+
+    // dst = a * b * c^H (or dst += a * b * c^H if T_ACCUMULATE is true).
+    template <bool T_ACCUMULATE>
+    void kernelMul3(size_t n, double *const *dstRe, double *const *dstIm,
+        double *const *aRe, double *const *aIm, double *const *bRe,
+        double *const *bIm, double *const *cRe, double *const *cIm)
+    {
+        const double *a00r = aRe[0], *a01r = aRe[1], *a10r = aRe[2],
+            *a11r = aRe[3];
+        const double *a00i = aIm[0], *a01i = aIm[1], *a10i = aIm[2],
+            *a11i = aIm[3];
+        const double *b00r = bRe[0], *b01r = bRe[1], *b10r = bRe[2],
+            *b11r = bRe[3];
+        const double *b00i = bIm[0], *b01i = bIm[1], *b10i = bIm[2],
+            *b11i = bIm[3];
+        const double *c00r = cRe[0], *c01r = cRe[1], *c10r = cRe[2],
+            *c11r = cRe[3];
+        const double *c00i = cIm[0], *c01i = cIm[1], *c10i = cIm[2],
+            *c11i = cIm[3];
+        double *d00r = dstRe[0], *d01r = dstRe[1], *d10r = dstRe[2],
+            *d11r = dstRe[3];
+        double *d00i = dstIm[0], *d01i = dstIm[1], *d10i = dstIm[2],
+            *d11i = dstIm[3];
+
+        for(size_t i = 0; i < n; ++i)
+        {
+            const double ar[4] = {a00r[i], a01r[i], a10r[i], a11r[i]};
+            const double ai[4] = {a00i[i], a01i[i], a10i[i], a11i[i]};
+            const double br[4] = {b00r[i], b01r[i], b10r[i], b11r[i]};
+            const double bi[4] = {b00i[i], b01i[i], b10i[i], b11i[i]};
+            const double cr[4] = {c00r[i], c01r[i], c10r[i], c11r[i]};
+            const double ci[4] = {c00i[i], c01i[i], c10i[i], c11i[i]};
+
+            // tmp = a * b
+            double tr[4], ti[4];
+            double re0, im0, re1, im1;
+            mul(re0, im0, ar[0], ai[0], br[0], bi[0]);
+            mul(re1, im1, ar[1], ai[1], br[2], bi[2]);
+            tr[0] = re0 + re1;
+            ti[0] = im0 + im1;
+
+            mul(re0, im0, ar[0], ai[0], br[1], bi[1]);
+            mul(re1, im1, ar[1], ai[1], br[3], bi[3]);
+            tr[1] = re0 + re1;
+            ti[1] = im0 + im1;
+
+            mul(re0, im0, ar[2], ai[2], br[0], bi[0]);
+            mul(re1, im1, ar[3], ai[3], br[2], bi[2]);
+            tr[2] = re0 + re1;
+            ti[2] = im0 + im1;
+
+            mul(re0, im0, ar[2], ai[2], br[1], bi[1]);
+            mul(re1, im1, ar[3], ai[3], br[3], bi[3]);
+            tr[3] = re0 + re1;
+            ti[3] = im0 + im1;
+
+            // result = tmp * c^H
+            double rr[4], ri[4];
+            mulConj(re0, im0, tr[0], ti[0], cr[0], ci[0]);
+            mulConj(re1, im1, tr[1], ti[1], cr[1], ci[1]);
+            rr[0] = re0 + re1;
+            ri[0] = im0 + im1;
+
+            mulConj(re0, im0, tr[0], ti[0], cr[2], ci[2]);
+            mulConj(re1, im1, tr[1], ti[1], cr[3], ci[3]);
+            rr[1] = re0 + re1;
+            ri[1] = im0 + im1;
+
+            mulConj(re0, im0, tr[2], ti[2], cr[0], ci[0]);
+            mulConj(re1, im1, tr[3], ti[3], cr[1], ci[1]);
+            rr[2] = re0 + re1;
+            ri[2] = im0 + im1;
+
+            mulConj(re0, im0, tr[2], ti[2], cr[2], ci[2]);
+            mulConj(re1, im1, tr[3], ti[3], cr[3], ci[3]);
+            rr[3] = re0 + re1;
+            ri[3] = im0 + im1;
+
+            if(T_ACCUMULATE)
+            {
+                d00r[i] += rr[0];
+                d00i[i] += ri[0];
+                d01r[i] += rr[1];
+                d01i[i] += ri[1];
+                d10r[i] += rr[2];
+                d10i[i] += ri[2];
+                d11r[i] += rr[3];
+                d11i[i] += ri[3];
+            }
+            else
+            {
+                d00r[i] = rr[0];
+                d00i[i] = ri[0];
+                d01r[i] = rr[1];
+                d01i[i] = ri[1];
+                d10r[i] = rr[2];
+                d10i[i] = ri[2];
+                d11r[i] = rr[3];
+                d11i[i] = ri[3];
+            }
+        }
+    }
+} // unnamed namespace
+
+unsigned int ExprProgram::nInstructions() const
+{
+    unsigned int count = 0;
+    for(size_t i = 0; i < itsCode.size(); ++i)
+    {
+        count += itsCode[i].code.size();
+    }
+
+    for(size_t i = 0; i < itsSharedCode.size(); ++i)
+    {
+        count += itsSharedCode[i].code.size();
+    }
+
+    return count;
+}
+
+void ExprProgram::setRequest(const Request &request, Cache &cache,
+    unsigned int grid)
+{
+    itsRequest = &request;
+    itsCache = &cache;
+    itsGrid = grid;
+    itsCellCount = request[grid][FREQ]->size() * request[grid][TIME]->size();
+
+    for(size_t i = 0; i < itsSharedValues.size(); ++i)
+    {
+        itsSharedValues[i].valid = false;
+    }
+
+    itsZeros.assign(itsChunkSize, 0.0);
+    itsOutput.resize(8 * itsCellCount);
+}
+
+const ExprProgram::Result &ExprProgram::evaluate(unsigned int i)
+{
+    ASSERT(itsRequest && i < itsCode.size());
+
+    run(itsCode[i], &(itsOutput[0]), itsResult.hasFlags, itsResult.flags);
+    for(unsigned int k = 0; k < 4; ++k)
+    {
+        itsResult.re[k] = &(itsOutput[k * itsCellCount]);
+        itsResult.im[k] = &(itsOutput[(4 + k) * itsCellCount]);
+    }
+
+    return itsResult;
+}
+
+bool ExprProgram::isCompilable(const Expr<JonesMatrix>::ConstPtr &expr)
+{
+    return dynamic_cast<const MatrixMul2*>(expr.get())
+        || dynamic_cast<const MatrixMul3*>(expr.get())
+        || dynamic_cast<const MatrixSum*>(expr.get());
+}
+
+void ExprProgram::compile(const Expr<JonesMatrix>::ConstPtr &expr)
+{
+    Segment segment;
+    vector<unsigned int> free;
+
+    if(isCompilable(expr) && expr->nConsumers() <= 1)
+    {
+        compileNode(expr, segment, Operand(OUTPUT), free);
+    }
+    else
+    {
+        emit(segment, ASSIGN, Operand(OUTPUT), compileArgument(expr, segment,
+            free));
+    }
+
+    itsCode.push_back(segment);
+}
+
+void ExprProgram::compileNode(const Expr<JonesMatrix>::ConstPtr &expr,
+    Segment &segment, const Operand &dst, vector<unsigned int> &free)
+{
+    if(dynamic_cast<const MatrixMul2*>(expr.get()))
+    {
+        Operand lhs = compileArgument(argument(expr, 0), segment, free);
+        Operand rhs = compileArgument(argument(expr, 1), segment, free);
+        emit(segment, MUL2, dst, lhs, rhs);
+        releaseTemp(lhs, free);
+        releaseTemp(rhs, free);
+    }
+    else if(dynamic_cast<const MatrixMul3*>(expr.get()))
+    {
+        Operand left = compileArgument(argument(expr, 0), segment, free);
+        Operand mid = compileArgument(argument(expr, 1), segment, free);
+        Operand right = compileArgument(argument(expr, 2), segment, free);
+        emit(segment, MUL3, dst, left, mid, right);
+        releaseTemp(left, free);
+        releaseTemp(mid, free);
+        releaseTemp(right, free);
+    }
+    else
+    {
+        const ExprBase &base = *expr;
+        const unsigned int nTerms = base.nArguments();
+
+        if(nTerms == 0)
+        {
+            emit(segment, ZERO, dst);
+            return;
+        }
+
+        for(unsigned int i = 0; i < nTerms; ++i)
+        {
+            Expr<JonesMatrix>::ConstPtr term = argument(expr, i);
+
+            // Fuse the product and the accumulation of a term that is not
+            // shared with other expressions.
+            if(dynamic_cast<const MatrixMul3*>(term.get())
+                && term->nConsumers() <= 1)
+            {
+                Operand left = compileArgument(argument(term, 0), segment,
+                    free);
+                Operand mid = compileArgument(argument(term, 1), segment,
+                    free);
+                Operand right = compileArgument(argument(term, 2), segment,
+                    free);
+                emit(segment, i == 0 ? MUL3 : MUL3_ADD, dst, left, mid, right);
+                releaseTemp(left, free);
+                releaseTemp(mid, free);
+                releaseTemp(right, free);
+            }
+            else
+            {
+                Operand arg = compileArgument(term, segment, free);
+                emit(segment, i == 0 ? ASSIGN : ADD, dst, arg);
+                releaseTemp(arg, free);
+            }
+        }
+    }
+}
+
+ExprProgram::Operand ExprProgram::compileArgument
+    (const Expr<JonesMatrix>::ConstPtr &expr, Segment &segment,
+    vector<unsigned int> &free)
+{
+    if(!isCompilable(expr))
+    {
+        map<ExprId, unsigned int>::const_iterator it =
+            itsLeafIndex.find(expr->id());
+
+        unsigned int index = 0;
+        if(it == itsLeafIndex.end())
+        {
+            index = itsLeaves.size();
+            itsLeaves.push_back(expr);
+            itsLeafIndex[expr->id()] = index;
+        }
+        else
+        {
+            index = it->second;
+        }
+
+        if(find(segment.leaves.begin(), segment.leaves.end(), index)
+            == segment.leaves.end())
+        {
+            segment.leaves.push_back(index);
+        }
+
+        return Operand(LEAF, index);
+    }
+
+    if(expr->nConsumers() > 1)
+    {
+        map<ExprId, unsigned int>::const_iterator it =
+            itsSharedIndex.find(expr->id());
+
+        unsigned int index = 0;
+        if(it == itsSharedIndex.end())
+        {
+            // Compiling the shared node may add other shared nodes, so the
+            // index can only be determined afterwards.
+            Segment shared;
+            vector<unsigned int> sharedFree;
+            compileNode(expr, shared, Operand(OUTPUT), sharedFree);
+
+            index = itsSharedCode.size();
+            itsSharedCode.push_back(shared);
+            itsSharedIndex[expr->id()] = index;
+        }
+        else
+        {
+            index = it->second;
+        }
+
+        if(find(segment.shared.begin(), segment.shared.end(), index)
+            == segment.shared.end())
+        {
+            segment.shared.push_back(index);
+        }
+
+        return Operand(SHARED, index);
+    }
+
+    Operand tmp = allocateTemp(segment, free);
+    compileNode(expr, segment, tmp, free);
+    return tmp;
+}
+
+ExprProgram::Operand ExprProgram::allocateTemp(Segment &segment,
+    vector<unsigned int> &free) const
+{
+    if(free.empty())
+    {
+        return Operand(TEMP, segment.nTemps++);
+    }
+
+    Operand tmp(TEMP, free.back());
+    free.pop_back();
+    return tmp;
+}
+
+void ExprProgram::releaseTemp(const Operand &operand,
+    vector<unsigned int> &free) const
+{
+    if(operand.location == TEMP)
+    {
+        free.push_back(operand.index);
+    }
+}
+
+void ExprProgram::emit(Segment &segment, Opcode opcode, const Operand &dst,
+    const Operand &arg0, const Operand &arg1, const Operand &arg2) const
+{
+    Instruction instr;
+    instr.opcode = opcode;
+    instr.dst = dst;
+    instr.arg[0] = arg0;
+    instr.arg[1] = arg1;
+    instr.arg[2] = arg2;
+    segment.code.push_back(instr);
+}
+
+void ExprProgram::evaluateShared(unsigned int i)
+{
+    SharedValue &shared = itsSharedValues[i];
+    if(!shared.valid)
+    {
+        shared.data.resize(8 * itsCellCount);
+        run(itsSharedCode[i], &(shared.data[0]), shared.hasFlags,
+            shared.flags);
+        shared.valid = true;
+    }
+}
+
+void ExprProgram::run(const Segment &segment, double *dst, bool &hasFlags,
+    FlagArray &flags)
+{
+    // Shared nodes use the temporary buffers as well, so they have to be
+    // computed before anything else.
+    for(size_t i = 0; i < segment.shared.size(); ++i)
+    {
+        evaluateShared(segment.shared[i]);
+    }
+
+    bind(segment, hasFlags, flags);
+
+    const size_t nTempValues = segment.nTemps * 8 * itsChunkSize;
+    if(itsTemps.size() < nTempValues)
+    {
+        itsTemps.resize(nTempValues);
+    }
+
+    Registers out, arg[3];
+    for(size_t start = 0; start < itsCellCount; start += itsChunkSize)
+    {
+        const size_t n = std::min<size_t>(itsChunkSize, itsCellCount - start);
+
+        for(size_t i = 0; i < segment.code.size(); ++i)
+        {
+            const Instruction &instr = segment.code[i];
+            resolve(instr.dst, start, dst, out);
+
+            switch(instr.opcode)
+            {
+            case ZERO:
+                kernelZero(n, out.re, out.im);
+                break;
+
+            case ASSIGN:
+                resolve(instr.arg[0], start, dst, arg[0]);
+                kernelAssign(n, out.re, out.im, arg[0].re, arg[0].im);
+                break;
+
+            case ADD:
+                resolve(instr.arg[0], start, dst, arg[0]);
+                kernelAdd(n, out.re, out.im, arg[0].re, arg[0].im);
+                break;
+
+            case MUL2:
+                resolve(instr.arg[0], start, dst, arg[0]);
+                resolve(instr.arg[1], start, dst, arg[1]);
+                kernelMul2(n, out.re, out.im, arg[0].re, arg[0].im,
+                    arg[1].re, arg[1].im);
+                break;
+
+            case MUL3:
+            case MUL3_ADD:
+                resolve(instr.arg[0], start, dst, arg[0]);
+                resolve(instr.arg[1], start, dst, arg[1]);
+                resolve(instr.arg[2], start, dst, arg[2]);
+                if(instr.opcode == MUL3)
+                {
+                    kernelMul3<false>(n, out.re, out.im, arg[0].re, arg[0].im,
+                        arg[1].re, arg[1].im, arg[2].re, arg[2].im);
+                }
+                else
+                {
+                    kernelMul3<true>(n, out.re, out.im, arg[0].re, arg[0].im,
+                        arg[1].re, arg[1].im, arg[2].re, arg[2].im);
+                }
+                break;
+
+            default:
+                THROW(BBSKernelException, "Invalid opcode encountered: "
+                    << instr.opcode);
+            }
+        }
+    }
+
+    // Release the leaf values that are no longer needed (values that are
+    // needed again are kept alive by the cache).
+    for(size_t i = 0; i < segment.leaves.size(); ++i)
+    {
+        itsBindings[segment.leaves[i]].value = JonesMatrix();
+    }
+}
+
+void ExprProgram::bind(const Segment &segment, bool &hasFlags,
+    FlagArray &flags)
+{
+    hasFlags = false;
+    flags = FlagArray(flag_t(0));
+
+    // Merge the flags of the shared nodes this segment depends on.
+    for(size_t i = 0; i < segment.shared.size(); ++i)
+    {
+        const SharedValue &shared = itsSharedValues[segment.shared[i]];
+        if(shared.hasFlags)
+        {
+            flags |= shared.flags;
+            hasFlags = true;
+        }
+    }
+
+    // Evaluate the leaves and count the number of buffers required to expand
+    // scalar (real and imaginary) values.
+    size_t nConstants = 0;
+    for(size_t i = 0; i < segment.leaves.size(); ++i)
+    {
+        const unsigned int index = segment.leaves[i];
+        Binding &binding = itsBindings[index];
+        binding.value = itsLeaves[index]->evaluate(*itsRequest, *itsCache,
+            itsGrid);
+
+        if(binding.value.hasFlags())
+        {
+            flags |= binding.value.flags();
+            hasFlags = true;
+        }
+
+        for(unsigned int k = 0; k < 4; ++k)
+        {
+            const Matrix value = binding.value.element(k).value();
+            if(!value.isNull())
+            {
+                if(!value.isArray())
+                {
+                    nConstants += value.isComplex() ? 2 : 1;
+                }
+            }
+        }
+    }
+
+    if(itsConstants.size() < nConstants * itsChunkSize)
+    {
+        itsConstants.resize(nConstants * itsChunkSize);
+    }
+
+    // Bind the leaves.
+    double *constant = nConstants > 0 ? &(itsConstants[0]) : 0;
+    for(size_t i = 0; i < segment.leaves.size(); ++i)
+    {
+        Binding &binding = itsBindings[segment.leaves[i]];
+
+        for(unsigned int k = 0; k < 4; ++k)
+        {
+            const Matrix value = binding.value.element(k).value();
+
+            binding.re[k] = binding.im[k] = &(itsZeros[0]);
+            binding.reIsArray[k] = binding.imIsArray[k] = false;
+
+            if(value.isNull())
+            {
+                continue;
+            }
+
+            if(value.isArray())
+            {
+                ASSERT(static_cast<size_t>(value.nelements()) == itsCellCount);
+                if(value.isComplex())
+                {
+                    value.dcomplexStorage(binding.re[k], binding.im[k]);
+                    binding.imIsArray[k] = true;
+                }
+                else
+                {
+                    binding.re[k] = value.doubleStorage();
+                }
+                binding.reIsArray[k] = true;
+            }
+            else
+            {
+                const dcomplex z = value.getDComplex();
+                fill(constant, constant + itsChunkSize, real(z));
+                binding.re[k] = constant;
+                constant += itsChunkSize;
+
+                if(value.isComplex())
+                {
+                    fill(constant, constant + itsChunkSize, imag(z));
+                    binding.im[k] = constant;
+                    constant += itsChunkSize;
+                }
+            }
+        }
+    }
+}
+
+void ExprProgram::resolve(const Operand &operand, size_t start, double *dst,
+    Registers &registers)
+{
+    switch(operand.location)
+    {
+    case LEAF:
+        {
+            const Binding &binding = itsBindings[operand.index];
+            for(unsigned int k = 0; k < 4; ++k)
+            {
+                registers.re[k] = const_cast<double*>(binding.re[k])
+                    + (binding.reIsArray[k] ? start : 0);
+                registers.im[k] = const_cast<double*>(binding.im[k])
+                    + (binding.imIsArray[k] ? start : 0);
+            }
+        }
+        break;
+
+    case SHARED:
+        {
+            double *data = &(itsSharedValues[operand.index].data[0]);
+            for(unsigned int k = 0; k < 4; ++k)
+            {
+                registers.re[k] = data + k * itsCellCount + start;
+                registers.im[k] = data + (4 + k) * itsCellCount + start;
+            }
+        }
+        break;
+
+    case TEMP:
+        {
+            double *data = &(itsTemps[operand.index * 8 * itsChunkSize]);
+            for(unsigned int k = 0; k < 4; ++k)
+            {
+                registers.re[k] = data + k * itsChunkSize;
+                registers.im[k] = data + (4 + k) * itsChunkSize;
+            }
+        }
+        break;
+
+    case OUTPUT:
+        for(unsigned int k = 0; k < 4; ++k)
+        {
+            registers.re[k] = dst + k * itsCellCount + start;
+            registers.im[k] = dst + (4 + k) * itsCellCount + start;
+        }
+        break;
+
+    default:
+        THROW(BBSKernelException, "Invalid operand location encountered: "
+            << operand.location);
+    }
+}
+
+} // namespace BBS
+} // namespace LOFAR
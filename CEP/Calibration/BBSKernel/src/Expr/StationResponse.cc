@@ -148,7 +148,22 @@ const JonesMatrix::View StationResponse::evaluateImplResponse(const Grid &grid,
     E11.setDCMat(nFreq, nTime);
     E11.dcomplexStorage(E11_re, E11_im);
 
-    // Evaluate station response.
+    // Frequencies and reference frequencies for which to evaluate the station
+    // response.
+    vector<double> freq(nFreq), referenceFreq(nFreq, itsReferenceFreq);
+    for(size_t j = 0; j < nFreq; ++j)
+    {
+        freq[j] = grid[FREQ]->center(j);
+    }
+
+    if(itsUseChannelFreq)
+    {
+        referenceFreq = freq;
+    }
+
+    // Evaluate station response. The response for all frequencies of a
+    // timeslot is computed in a single batch.
+    vector<LOFAR::StationResponse::matrix22c_t> buffer(nFreq);
     for(size_t i = 0; i < nTime; ++i)
     {
         double time = grid[TIME]->center(i);
@@ -160,14 +175,14 @@ const JonesMatrix::View StationResponse::evaluateImplResponse(const Grid &grid,
         LOFAR::StationResponse::vector3r_t v_tile0 = {{*p_tile0[0]++,
             *p_tile0[1]++, *p_tile0[2]++}};
 
+        LOFAR::StationResponse::BeamBatch batch(time, nFreq, &(freq[0]),
+            &(referenceFreq[0]), v_station0, v_tile0);
+        batch.setDirections(1, &v_direction);
+        itsStation->response(batch, &(buffer[0]));
+
         for(size_t j = 0; j < nFreq; ++j)
         {
-            double freq = grid[FREQ]->center(j);
-            double referenceFreq = itsUseChannelFreq ? freq : itsReferenceFreq;
-
-            LOFAR::StationResponse::matrix22c_t response =
-                itsStation->response(time, freq, v_direction, referenceFreq,
-                v_station0, v_tile0);
+            const LOFAR::StationResponse::matrix22c_t &response = buffer[j];
 
             *E00_re++ = real(response[0][0]);
             *E00_im++ = imag(response[0][0]);
@@ -102,6 +102,11 @@ void MeasurementExprLOFAR::solvablesChanged()
 //    LOG_DEBUG_STR("" << itsCache);
     itsCache.clear(Cache::VOLATILE);
     itsCache.clearStats();
+
+    if(itsProgram)
+    {
+        itsProgram->setRequest(itsRequest, itsCache);
+    }
 }
 
 void MeasurementExprLOFAR::makeForwardExpr(SourceDB &sourceDB,
@@ -778,6 +783,11 @@ void MeasurementExprLOFAR::setSolvables(const ParmGroup &solvables)
     itsCache.clear();
     itsCache.clearStats();
     itsCachePolicy->apply(itsExpr.begin(), itsExpr.end());
+
+    if(itsProgram)
+    {
+        itsProgram->setRequest(itsRequest, itsCache);
+    }
 }
 
 void MeasurementExprLOFAR::clearSolvables()
@@ -794,6 +804,11 @@ void MeasurementExprLOFAR::clearSolvables()
     itsCache.clear();
     itsCache.clearStats();
     itsCachePolicy->apply(itsExpr.begin(), itsExpr.end());
+
+    if(itsProgram)
+    {
+        itsProgram->setRequest(itsRequest, itsCache);
+    }
 }
 
 void MeasurementExprLOFAR::setEvalGrid(const Grid &grid)
@@ -803,6 +818,11 @@ void MeasurementExprLOFAR::setEvalGrid(const Grid &grid)
     itsCache.clear();
     itsCache.clearStats();
 
+    if(itsProgram)
+    {
+        itsProgram->setRequest(itsRequest, itsCache);
+    }
+
     // TODO: Set cache size in number of Matrix instances... ?
 }
 
@@ -855,6 +875,31 @@ const JonesMatrix MeasurementExprLOFAR::evaluate(unsigned int i)
     return result;
 }
 
+const ExprProgram::Result &MeasurementExprLOFAR::evaluateProgram
+    (unsigned int i)
+{
+    ASSERT(i < itsExpr.size());
+
+    if(!itsProgram)
+    {
+        NSTimer timer;
+        timer.start();
+
+        LOG_DEBUG_STR("Compiling expression tree...");
+        itsProgram.reset(new ExprProgram(itsExpr.begin(), itsExpr.end()));
+        itsProgram->setRequest(itsRequest, itsCache);
+
+        timer.stop();
+        LOG_DEBUG_STR("Compiling expression tree... done (instructions: "
+            << itsProgram->nInstructions() << ", leaves: "
+            << itsProgram->nLeaves() << ", shared: " << itsProgram->nShared()
+            << ").");
+        LOG_DEBUG_STR("" << timer);
+    }
+
+    return itsProgram->evaluate(i);
+}
+
 void MeasurementExprLOFAR::setCorrelations(bool circular)
 {
     itsCorrelations.clear();
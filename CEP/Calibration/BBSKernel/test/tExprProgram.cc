@@ -0,0 +1,331 @@
+//# tExprProgram.cc: Compare the evaluation of a compiled expression program to
+//# the evaluation of the expression tree it was compiled from.
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <BBSKernel/Expr/CachePolicy.h>
+#include <BBSKernel/Expr/ExprProgram.h>
+#include <BBSKernel/Expr/MatrixMul2.h>
+#include <BBSKernel/Expr/MatrixMul3.h>
+#include <BBSKernel/Expr/MatrixSum.h>
+#include <ParmDB/Axis.h>
+#include <ParmDB/Grid.h>
+#include <Common/LofarLogger.h>
+#include <Common/Timer.h>
+#include <Common/lofar_complex.h>
+#include <Common/lofar_iostream.h>
+#include <Common/lofar_vector.h>
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace LOFAR;
+using namespace LOFAR::BBS;
+
+// Leaf node that returns a fixed value.
+class Constant: public NullaryExpr<JonesMatrix>
+{
+public:
+    typedef shared_ptr<Constant>        Ptr;
+    typedef shared_ptr<const Constant>  ConstPtr;
+
+    Constant(const JonesMatrix &value)
+        :   itsValue(value)
+    {
+    }
+
+protected:
+    virtual const JonesMatrix evaluateExpr(const Request&, Cache&,
+        unsigned int) const
+    {
+        return itsValue;
+    }
+
+private:
+    JonesMatrix itsValue;
+};
+
+Matrix makeArray(size_t nFreq, size_t nTime, bool isComplex)
+{
+    if(isComplex)
+    {
+        Matrix value(makedcomplex(0.0, 0.0), nFreq, nTime, false);
+        double *re = 0, *im = 0;
+        value.dcomplexStorage(re, im);
+        for(size_t i = 0; i < nFreq * nTime; ++i)
+        {
+            re[i] = drand48() - 0.5;
+            im[i] = drand48() - 0.5;
+        }
+        return value;
+    }
+
+    Matrix value(0.0, nFreq, nTime, false);
+    double *re = value.doubleStorage();
+    for(size_t i = 0; i < nFreq * nTime; ++i)
+    {
+        re[i] = drand48() - 0.5;
+    }
+    return value;
+}
+
+// Create a pool of Jones matrices that covers the different kinds of Matrix
+// instances a leaf node can return: complex arrays, real arrays, scalars, and
+// arrays with flags.
+vector<JonesMatrix> makePool(size_t nFreq, size_t nTime)
+{
+    vector<JonesMatrix> pool;
+    for(size_t i = 0; i < 8; ++i)
+    {
+        pool.push_back(JonesMatrix(makeArray(nFreq, nTime, true),
+            makeArray(nFreq, nTime, true), makeArray(nFreq, nTime, true),
+            makeArray(nFreq, nTime, true)));
+    }
+
+    pool.push_back(JonesMatrix(makeArray(nFreq, nTime, false),
+        Matrix(makedcomplex(0.0, 0.0)), Matrix(makedcomplex(0.0, 0.0)),
+        makeArray(nFreq, nTime, false)));
+
+    pool.push_back(JonesMatrix(Matrix(makedcomplex(0.5, -0.25)),
+        Matrix(0.125), Matrix(makedcomplex(-0.75, 0.5)), Matrix(1.0)));
+
+    JonesMatrix flagged(makeArray(nFreq, nTime, true),
+        makeArray(nFreq, nTime, true), makeArray(nFreq, nTime, true),
+        makeArray(nFreq, nTime, true));
+    FlagArray flags(nFreq, nTime, flag_t(0));
+    for(FlagArray::iterator it = flags.begin(), end = flags.end(); it != end;
+        ++it)
+    {
+        *it = (drand48() < 0.1 ? 1 : 0);
+    }
+    flagged.setFlags(flags);
+    pool.push_back(flagged);
+
+    return pool;
+}
+
+Expr<JonesMatrix>::Ptr makeLeaf(const vector<JonesMatrix> &pool)
+{
+    return Expr<JonesMatrix>::Ptr(new Constant(pool[lrand48() % pool.size()]));
+}
+
+// Create a model with the same structure as the forward model constructed by
+// MeasurementExprLOFAR: for baseline (p, q) the model is defined as DIE(p)
+// * sum_k(DDE(p, k) * coherence(p, q, k) * DDE(q, k)^H) * DIE(q)^H, where the
+// direction dependent effects are the product of two Jones matrices.
+vector<Expr<JonesMatrix>::Ptr> makeModel(size_t nStations, size_t nPatches,
+    const vector<JonesMatrix> &pool)
+{
+    vector<Expr<JonesMatrix>::Ptr> die(nStations);
+    for(size_t i = 0; i < nStations; ++i)
+    {
+        die[i] = makeLeaf(pool);
+    }
+
+    vector<vector<Expr<JonesMatrix>::Ptr> > dde(nPatches,
+        vector<Expr<JonesMatrix>::Ptr>(nStations));
+    for(size_t k = 0; k < nPatches; ++k)
+    {
+        for(size_t i = 0; i < nStations; ++i)
+        {
+            dde[k][i].reset(new MatrixMul2(makeLeaf(pool), makeLeaf(pool)));
+        }
+    }
+
+    vector<Expr<JonesMatrix>::Ptr> model;
+    for(size_t p = 0; p < nStations; ++p)
+    {
+        for(size_t q = p + 1; q < nStations; ++q)
+        {
+            MatrixSum::Ptr sum(new MatrixSum());
+            for(size_t k = 0; k < nPatches; ++k)
+            {
+                sum->connect(Expr<JonesMatrix>::Ptr(new MatrixMul3(dde[k][p],
+                    makeLeaf(pool), dde[k][q])));
+            }
+
+            model.push_back(Expr<JonesMatrix>::Ptr(new MatrixMul3(die[p], sum,
+                die[q])));
+        }
+    }
+
+    return model;
+}
+
+bool compare(const JonesMatrix &expected, const ExprProgram::Result &result,
+    size_t nCells)
+{
+    for(unsigned int k = 0; k < 4; ++k)
+    {
+        const Matrix value = expected.element(k).value();
+        ASSERT(value.isArray() && value.isComplex());
+
+        const double *re = 0, *im = 0;
+        value.dcomplexStorage(re, im);
+        for(size_t i = 0; i < nCells; ++i)
+        {
+            const double norm = std::max(1.0, abs(makedcomplex(re[i], im[i])));
+            if(std::abs(re[i] - result.re[k][i]) > 1e-12 * norm
+                || std::abs(im[i] - result.im[k][i]) > 1e-12 * norm)
+            {
+                cerr << "Value mismatch: element: " << k << " cell: " << i
+                    << " expected: " << makedcomplex(re[i], im[i]) << " got: "
+                    << makedcomplex(result.re[k][i], result.im[k][i]) << endl;
+                return false;
+            }
+        }
+    }
+
+    if(expected.hasFlags() != result.hasFlags)
+    {
+        cerr << "Flag mismatch." << endl;
+        return false;
+    }
+
+    if(expected.hasFlags())
+    {
+        const FlagArray flags = expected.flags();
+        FlagArray::const_iterator it = flags.begin();
+        FlagArray::const_iterator itResult = result.flags.begin();
+        const size_t n = flags.rank() == 0 ? 1 : nCells;
+        for(size_t i = 0; i < n; ++i, ++it, ++itResult)
+        {
+            if(*it != *itResult)
+            {
+                cerr << "Flag mismatch: cell: " << i << endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool doTest(size_t nStations, size_t nPatches, size_t nFreq, size_t nTime,
+    size_t nIter)
+{
+    cout << "stations: " << nStations << " patches: " << nPatches
+        << " channels: " << nFreq << " timeslots: " << nTime << endl;
+
+    srand48(42);
+    vector<JonesMatrix> pool = makePool(nFreq, nTime);
+    vector<Expr<JonesMatrix>::Ptr> model = makeModel(nStations, nPatches,
+        pool);
+
+    DefaultCachePolicy policy;
+    policy.apply(model.begin(), model.end());
+
+    NSTimer compileTimer;
+    compileTimer.start();
+    ExprProgram program(model.begin(), model.end());
+    compileTimer.stop();
+
+    cout << "instructions: " << program.nInstructions() << " leaves: "
+        << program.nLeaves() << " shared: " << program.nShared()
+        << " compile time: " << compileTimer.getElapsed() << " s" << endl;
+
+    Axis::ShPtr freqAxis(new RegularAxis(1.0e8, 1.0e5, nFreq));
+    Axis::ShPtr timeAxis(new RegularAxis(0.0, 1.0, nTime));
+    Grid grid(freqAxis, timeAxis);
+
+    // Compare the results.
+    {
+        Request request(grid);
+        Cache cache;
+        Cache programCache;
+        program.setRequest(request, programCache);
+
+        for(size_t i = 0; i < model.size(); ++i)
+        {
+            const JonesMatrix expected = model[i]->evaluate(request, cache, 0);
+            if(!compare(expected, program.evaluate(i), nFreq * nTime))
+            {
+                cerr << "Result mismatch for expression: " << i << endl;
+                return false;
+            }
+        }
+    }
+
+    // Compare the run time.
+    NSTimer treeTimer, programTimer;
+    double checksum[2] = {0.0, 0.0};
+    for(size_t iter = 0; iter < nIter; ++iter)
+    {
+        Request request(grid);
+        Cache cache;
+
+        treeTimer.start();
+        for(size_t i = 0; i < model.size(); ++i)
+        {
+            const JonesMatrix result = model[i]->evaluate(request, cache, 0);
+            checksum[0] += result.element(0).value().getDComplex(0, 0).real();
+        }
+        treeTimer.stop();
+
+        cache.clear();
+
+        programTimer.start();
+        program.setRequest(request, cache);
+        for(size_t i = 0; i < model.size(); ++i)
+        {
+            const ExprProgram::Result &result = program.evaluate(i);
+            checksum[1] += result.re[0][0];
+        }
+        programTimer.stop();
+    }
+
+    cout << "tree: " << treeTimer.getElapsed() << " s program: "
+        << programTimer.getElapsed() << " s speed-up: "
+        << treeTimer.getElapsed() / programTimer.getElapsed() << endl;
+
+    return std::abs(checksum[0] - checksum[1])
+        <= 1e-9 * std::max(1.0, std::abs(checksum[0]));
+}
+
+int main(int argc, char *argv[])
+{
+    INIT_LOGGER("tExprProgram");
+
+    try
+    {
+        // Usage: tExprProgram [nStations nPatches nFreq nTime nIter]
+        if(argc == 6)
+        {
+            return doTest(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]),
+                atoi(argv[4]), atoi(argv[5])) ? 0 : 1;
+        }
+
+        // Empty patch list, single cell, and a chunk boundary.
+        if(!doTest(4, 0, 1, 1, 1) || !doTest(6, 1, 1, 1, 1)
+            || !doTest(8, 3, 15, 20, 2) || !doTest(20, 4, 64, 10, 2))
+        {
+            return 1;
+        }
+    }
+    catch(std::exception &ex)
+    {
+        cerr << "Unexpected exception: " << ex.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -94,6 +94,55 @@ void element_response(double freq, double theta, double phi,
     double freq_range, const unsigned int (&coeff_shape)[3],
     const std::complex<double> coeff[]);
 
+// Batched evaluation
+// ------------------
+// The model is a polynomial in frequency and theta. For a fixed frequency, it
+// can be reduced to a polynomial in theta only, which is much cheaper to
+// evaluate for many directions. The functions below compute such a reduced set
+// of coefficients (once per frequency), and evaluate the response for a single
+// direction and any number of frequencies from the reduced coefficients. The
+// azimuthal harmonics then only have to be computed once per direction.
+//
+// The results are identical to those of the functions above.
+
+// Return the number of reduced coefficients for a single frequency, for the
+// default LBA and HBA models, respectively.
+unsigned int element_response_lba_reduced_size();
+unsigned int element_response_hba_reduced_size();
+
+// Reduce the default LBA or HBA model to a polynomial in theta at frequency
+// freq (Hz). The reduced parameter should point to an array of
+// element_response_[lh]ba_reduced_size() coefficients.
+void element_response_lba_reduce(double freq, std::complex<double> reduced[]);
+void element_response_hba_reduce(double freq, std::complex<double> reduced[]);
+
+// Compute the response of the default LBA or HBA model for count frequencies
+// for the direction given by theta, phi (rad). The reduced coefficients for
+// frequency i (see element_response_[lh]ba_reduce()) are read from
+// reduced + i * element_response_[lh]ba_reduced_size(), and the response for
+// frequency i is stored in response[i].
+void element_response_lba(double theta, double phi, unsigned int count,
+    const std::complex<double> reduced[],
+    std::complex<double> (*response)[2][2]);
+void element_response_hba(double theta, double phi, unsigned int count,
+    const std::complex<double> reduced[],
+    std::complex<double> (*response)[2][2]);
+
+// Reduce a set of user defined coefficients (see element_response()) to a
+// polynomial in theta at frequency freq (Hz). The reduced parameter should
+// point to an array of coeff_shape[0] x coeff_shape[1] x 2 coefficients.
+void element_response_reduce(double freq, double freq_center,
+    double freq_range, const unsigned int (&coeff_shape)[3],
+    const std::complex<double> coeff[], std::complex<double> reduced[]);
+
+// Compute the response for count frequencies from a set of reduced
+// coefficients. The coeff_shape parameter is the shape of the coefficient
+// array the reduced coefficients were computed from.
+void element_response(double theta, double phi, unsigned int count,
+    std::complex<double> (*response)[2][2],
+    const unsigned int (&coeff_shape)[3],
+    const std::complex<double> reduced[]);
+
 // @}
 
 } //# namespace LOFAR
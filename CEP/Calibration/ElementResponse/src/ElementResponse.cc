@@ -53,6 +53,46 @@ void element_response_hba(double freq, double theta, double phi,
         default_hba_freq_range, default_hba_coeff_shape, default_hba_coeff);
 }
 
+unsigned int element_response_lba_reduced_size()
+{
+    return default_lba_coeff_shape[0] * default_lba_coeff_shape[1] * 2;
+}
+
+unsigned int element_response_hba_reduced_size()
+{
+    return default_hba_coeff_shape[0] * default_hba_coeff_shape[1] * 2;
+}
+
+void element_response_lba_reduce(double freq, std::complex<double> reduced[])
+{
+    element_response_reduce(freq, default_lba_freq_center,
+        default_lba_freq_range, default_lba_coeff_shape, default_lba_coeff,
+        reduced);
+}
+
+void element_response_hba_reduce(double freq, std::complex<double> reduced[])
+{
+    element_response_reduce(freq, default_hba_freq_center,
+        default_hba_freq_range, default_hba_coeff_shape, default_hba_coeff,
+        reduced);
+}
+
+void element_response_lba(double theta, double phi, unsigned int count,
+    const std::complex<double> reduced[],
+    std::complex<double> (*response)[2][2])
+{
+    element_response(theta, phi, count, response, default_lba_coeff_shape,
+        reduced);
+}
+
+void element_response_hba(double theta, double phi, unsigned int count,
+    const std::complex<double> reduced[],
+    std::complex<double> (*response)[2][2])
+{
+    element_response(theta, phi, count, response, default_hba_coeff_shape,
+        reduced);
+}
+
 void element_response(double freq, double theta, double phi,
     std::complex<double> (&response)[2][2], double freq_center,
     double freq_range, const unsigned int (&coeff_shape)[3],
@@ -154,4 +194,95 @@ void element_response(double freq, double theta, double phi,
     }
 }
 
+void element_response_reduce(double freq, double freq_center,
+    double freq_range, const unsigned int (&coeff_shape)[3],
+    const std::complex<double> coeff[], std::complex<double> reduced[])
+{
+    const unsigned int nPowerFreq = coeff_shape[2];
+    const unsigned int nPolynomials = coeff_shape[0] * coeff_shape[1] * 2;
+
+    freq = (freq - freq_center) / freq_range;
+
+    // The coefficients of the polynomial in freq for each harmonic, power of
+    // theta, and element of P are interleaved (the element of P varies
+    // fastest). The polynomials are evaluated using Horner's rule, in exactly
+    // the same way as in element_response() above.
+    for(unsigned int i = 0; i < nPolynomials; i += 2)
+    {
+        const std::complex<double> *it = coeff + (i + 2) * nPowerFreq;
+
+        std::complex<double> P[2];
+        P[1] = *--it;
+        P[0] = *--it;
+
+        for(unsigned int j = 0; j < nPowerFreq - 1; ++j)
+        {
+            P[1] = P[1] * freq + *--it;
+            P[0] = P[0] * freq + *--it;
+        }
+
+        reduced[i] = P[0];
+        reduced[i + 1] = P[1];
+    }
+}
+
+void element_response(double theta, double phi, unsigned int count,
+    std::complex<double> (*response)[2][2],
+    const unsigned int (&coeff_shape)[3],
+    const std::complex<double> reduced[])
+{
+    // Initialize the response to zero.
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        response[i][0][0] = 0.0;
+        response[i][0][1] = 0.0;
+        response[i][1][0] = 0.0;
+        response[i][1][1] = 0.0;
+    }
+
+    // Clip directions below the horizon.
+    if(theta >= pi_2)
+    {
+        return;
+    }
+
+    const unsigned int nHarmonics  = coeff_shape[0];
+    const unsigned int nPowerTheta = coeff_shape[1];
+    const unsigned int stride = nHarmonics * nPowerTheta * 2;
+
+    int sign = 1, kappa = 1;
+
+    std::complex<double> P[2];
+    for(unsigned int k = 0; k < nHarmonics; ++k)
+    {
+        // The rotation over kappa * az does not depend on frequency.
+        const double angle = sign * kappa * phi;
+        const double caz = std::cos(angle);
+        const double saz = std::sin(angle);
+
+        const std::complex<double> *block = reduced + (k + 1) * nPowerTheta * 2;
+        for(unsigned int i = 0; i < count; ++i, block += stride)
+        {
+            // Evaluate the polynomial in theta using Horner's rule.
+            const std::complex<double> *it = block;
+            P[1] = *--it;
+            P[0] = *--it;
+
+            for(unsigned int j = 0; j < nPowerTheta - 1; ++j)
+            {
+                P[1] = P[1] * theta + *--it;
+                P[0] = P[0] * theta + *--it;
+            }
+
+            response[i][0][0] += caz * P[0];
+            response[i][0][1] += -saz * P[1];
+            response[i][1][0] += saz * P[0];
+            response[i][1][1] += caz * P[1];
+        }
+
+        sign = -sign;
+        kappa += 2;
+    }
+}
+
 } //# namespace LOFAR
@@ -31,6 +31,7 @@
 #include <Common/lofar_smartptr.h>
 #include <Common/lofar_string.h>
 #include <Common/lofar_vector.h>
+#include <StationResponse/BeamBatch.h>
 #include <StationResponse/Constants.h>
 #include <StationResponse/Types.h>
 #include <StationResponse/ITRFDirection.h>
@@ -235,6 +236,32 @@ public:
     virtual matrix22c_t elementResponse(real_t time, real_t freq,
         const vector3r_t &direction) const = 0;
 
+    /*!
+     *  \name Batched member functions
+     *  These member functions perform the same function as the corresponding
+     *  member functions above, for all frequencies in \p batch. The analog
+     *  %tile beam former is steered towards batch.tile0(). The default
+     *  implementations call the non-batched member functions once per
+     *  frequency. Derived classes override them to compute everything that
+     *  does not depend on frequency only once.
+     *
+     *  \param batch Time, frequencies, and reference directions.
+     *  \param direction Direction of arrival (ITRF, m).
+     *  \param buffer Output buffer with room for batch.nFreq() instances.
+     */
+    // @{
+
+    virtual void rawResponse(const BeamBatch &batch,
+        const vector3r_t &direction, raw_response_t *buffer) const;
+
+    virtual void rawArrayFactor(const BeamBatch &batch,
+        const vector3r_t &direction, raw_array_factor_t *buffer) const;
+
+    virtual void elementResponse(const BeamBatch &batch,
+        const vector3r_t &direction, matrix22c_t *buffer) const;
+
+    // @}
+
 protected:
     /** Compute the parallactic rotation. */
     matrix22r_t rotation(real_t time, const vector3r_t &direction) const;
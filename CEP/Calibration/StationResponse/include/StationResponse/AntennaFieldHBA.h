@@ -61,6 +61,14 @@ public:
     virtual matrix22c_t elementResponse(real_t time, real_t freq,
         const vector3r_t &direction) const;
 
+    using AntennaField::rawResponse;
+
+    virtual void rawArrayFactor(const BeamBatch &batch,
+        const vector3r_t &direction, raw_array_factor_t *buffer) const;
+
+    virtual void elementResponse(const BeamBatch &batch,
+        const vector3r_t &direction, matrix22c_t *buffer) const;
+
 private:
     AntennaModelHBA::ConstPtr   itsAntennaModel;
 };
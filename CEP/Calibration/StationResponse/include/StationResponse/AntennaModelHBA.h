@@ -26,6 +26,7 @@
 // \file
 // HBA antenna model interface definitions.
 
+#include <StationResponse/BeamBatch.h>
 #include <StationResponse/Types.h>
 #include <Common/lofar_smartptr.h>
 
@@ -59,6 +60,16 @@ public:
 
     virtual matrix22c_t elementResponse(real_t freq,
         const vector3r_t &direction) const = 0;
+
+    // Batched versions of rawArrayFactor() and elementResponse(), for all
+    // frequencies in batch. The default implementations call the non-batched
+    // member functions once per frequency.
+    virtual void rawArrayFactor(const BeamBatch &batch,
+        const vector3r_t &direction, const vector3r_t &direction0,
+        raw_array_factor_t *buffer) const;
+
+    virtual void elementResponse(const BeamBatch &batch,
+        const vector3r_t &direction, matrix22c_t *buffer) const;
 };
 
 // @}
@@ -26,6 +26,7 @@
 // \file
 // LBA antenna model interface definitions.
 
+#include <StationResponse/BeamBatch.h>
 #include <StationResponse/Types.h>
 #include <Common/lofar_smartptr.h>
 
@@ -47,6 +48,11 @@ public:
 
     virtual matrix22c_t response(real_t freq, const vector3r_t &direction)
         const = 0;
+
+    // Batched version of response(), for all frequencies in batch. The
+    // default implementation calls response() once per frequency.
+    virtual void response(const BeamBatch &batch, const vector3r_t &direction,
+        matrix22c_t *buffer) const;
 };
 
 // @}
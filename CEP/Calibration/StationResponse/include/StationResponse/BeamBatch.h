@@ -0,0 +1,185 @@
+//# BeamBatch.h: Description of a batch of station response evaluations for a
+//# single time.
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_STATIONRESPONSE_BEAMBATCH_H
+#define LOFAR_STATIONRESPONSE_BEAMBATCH_H
+
+// \file
+// Description of a batch of station response evaluations for a single time.
+
+#include <Common/lofar_smartptr.h>
+#include <Common/lofar_vector.h>
+#include <StationResponse/Types.h>
+
+namespace LOFAR
+{
+namespace StationResponse
+{
+
+// \addtogroup StationResponse
+// @{
+
+/*!
+ *  \brief Description of a batch of station response evaluations: a single
+ *  time, a list of frequencies, and a list of directions of arrival, with
+ *  fixed station and tile beam former reference directions.
+ *
+ *  A BeamBatch holds everything that does not depend on the station, such
+ *  as the angular wave numbers and the element beam model coefficients
+ *  reduced to a polynomial in theta for each frequency. It should be
+ *  constructed once per time and passed to Station::response() or
+ *  Station::arrayFactor() for all stations.
+ *
+ *  If the frequencies (and reference frequencies) are regularly spaced, the
+ *  phase shifts required to compute the array factor are updated
+ *  incrementally from one frequency to the next by complex multiplication,
+ *  instead of calling cos() and sin() for each frequency.
+ */
+class BeamBatch
+{
+public:
+    typedef shared_ptr<BeamBatch>       Ptr;
+    typedef shared_ptr<const BeamBatch> ConstPtr;
+
+    /*!
+     *  \brief Construct a batch for a list of frequencies and a fixed
+     *  reference frequency.
+     *
+     *  \param time Time, modified Julian date, UTC, in seconds (MJD(UTC), s).
+     *  \param count Number of frequencies.
+     *  \param freq List of frequencies (Hz) of length \p count.
+     *  \param freq0 %Station beam former reference frequency (Hz).
+     *  \param station0 %Station beam former reference direction (ITRF, m).
+     *  \param tile0 Tile beam former reference direction (ITRF, m).
+     */
+    BeamBatch(real_t time, unsigned int count, const real_t *freq,
+        real_t freq0, const vector3r_t &station0, const vector3r_t &tile0);
+
+    /*!
+     *  \brief Construct a batch for a list of (frequency, reference
+     *  frequency) pairs.
+     *
+     *  \param time Time, modified Julian date, UTC, in seconds (MJD(UTC), s).
+     *  \param count Number of frequencies.
+     *  \param freq List of frequencies (Hz) of length \p count.
+     *  \param freq0 List of %station beam former reference frequencies (Hz) of
+     *  length \p count.
+     *  \param station0 %Station beam former reference direction (ITRF, m).
+     *  \param tile0 Tile beam former reference direction (ITRF, m).
+     */
+    BeamBatch(real_t time, unsigned int count, const real_t *freq,
+        const real_t *freq0, const vector3r_t &station0,
+        const vector3r_t &tile0);
+
+    /*!
+     *  \brief Set the list of directions of arrival (ITRF, m) to evaluate the
+     *  response for.
+     */
+    void setDirections(unsigned int count, const vector3r_t *direction);
+
+    /** Return the time (MJD(UTC), s). */
+    real_t time() const;
+
+    /** Return the number of frequencies. */
+    unsigned int nFreq() const;
+
+    /** Return frequency \p i (Hz). */
+    real_t freq(unsigned int i) const;
+
+    /** Return reference frequency \p i (Hz). */
+    real_t freq0(unsigned int i) const;
+
+    /** Return the number of directions. */
+    unsigned int nDirections() const;
+
+    /** Return direction \p i (ITRF, m). */
+    const vector3r_t &direction(unsigned int i) const;
+
+    /** Return the %station beam former reference direction (ITRF, m). */
+    const vector3r_t &station0() const;
+
+    /** Return the tile beam former reference direction (ITRF, m). */
+    const vector3r_t &tile0() const;
+
+    /*!
+     *  \brief Return the LBA element beam model coefficients reduced to a
+     *  polynomial in theta for each frequency, in the layout expected by
+     *  element_response_lba().
+     */
+    const complex_t *lbaCoeff() const;
+
+    /*!
+     *  \brief Return the HBA element beam model coefficients reduced to a
+     *  polynomial in theta for each frequency, in the layout expected by
+     *  element_response_hba().
+     */
+    const complex_t *hbaCoeff() const;
+
+    /*!
+     *  \brief Compute the (weighted) sum of the phase shifts of a set of
+     *  antennae for all frequencies.
+     *
+     *  \param count Number of antennae.
+     *  \param delay Projection of the position of each antenna on the
+     *  direction of arrival (m).
+     *  \param delay0 Projection of the position of each antenna on the
+     *  reference direction (m), or 0 if the reference direction should be
+     *  ignored.
+     *  \param weight0 Weight of each antenna for the \p X signal path.
+     *  \param weight1 Weight of each antenna for the \p Y signal path.
+     *  \param buffer Output buffer with room for nFreq() instances of type
+     *  ::raw_array_factor_t. Only the factor field is written.
+     *
+     *  The phase shift of antenna \p a at frequency \p i is given by
+     *  <tt>k(i) * delay[a] - k0(i) * delay0[a]</tt>, where \p k and \p k0 are
+     *  the angular wave numbers that correspond to freq(i) and freq0(i).
+     */
+    void sumPhaseShifts(unsigned int count, const real_t *delay,
+        const real_t *delay0, const real_t *weight0, const real_t *weight1,
+        raw_array_factor_t *buffer) const;
+
+private:
+    void init(unsigned int count, const real_t *freq, const real_t *freq0);
+
+    real_t              itsTime;
+    vector<real_t>      itsFreq;
+    vector<real_t>      itsFreq0;
+    vector<real_t>      itsK;
+    vector<real_t>      itsK0;
+    bool                itsRegular;
+    bool                itsRegular0;
+    real_t              itsDeltaK;
+    real_t              itsDeltaK0;
+    vector<vector3r_t>  itsDirections;
+    vector3r_t          itsStation0;
+    vector3r_t          itsTile0;
+    vector<complex_t>   itsLBACoeff;
+    vector<complex_t>   itsHBACoeff;
+};
+
+// @}
+
+} //# namespace StationResponse
+} //# namespace LOFAR
+
+#endif
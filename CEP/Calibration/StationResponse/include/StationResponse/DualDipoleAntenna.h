@@ -45,6 +45,9 @@ public:
 
     virtual matrix22c_t response(real_t freq, const vector3r_t &direction)
         const;
+
+    virtual void response(const BeamBatch &batch, const vector3r_t &direction,
+        matrix22c_t *buffer) const;
 };
 
 // @}
@@ -30,6 +30,7 @@
 #include <Common/lofar_string.h>
 #include <Common/lofar_vector.h>
 #include <StationResponse/AntennaField.h>
+#include <StationResponse/BeamBatch.h>
 #include <StationResponse/Types.h>
 
 namespace LOFAR
@@ -290,11 +291,67 @@ public:
 
     // @}
 
+    /*!
+     *  \name Batched member functions
+     *  These member functions perform the same function as the corresponding
+     *  non-template member functions, for all frequencies and directions in a
+     *  BeamBatch. Everything that does not depend on frequency (e.g. the
+     *  projection of the antenna positions on the direction of arrival, and
+     *  the parallactic rotation) is computed once per direction, and the
+     *  frequency dependent part of the element beam model is shared by all
+     *  stations through the BeamBatch.
+     */
+    // @{
+
+    /*!
+     *  \brief Compute the response of the station for all frequencies and
+     *  directions in \p batch.
+     *
+     *  \param batch Time, frequencies, directions, and reference directions.
+     *  \param buffer Output buffer with room for batch.nDirections() x
+     *  batch.nFreq() instances of type ::matrix22c_t. The response for
+     *  direction \p i and frequency \p j is stored at index
+     *  <tt>i * batch.nFreq() + j</tt>.
+     */
+    void response(const BeamBatch &batch, matrix22c_t *buffer) const;
+
+    /*!
+     *  \brief Compute the array factor of the station for all frequencies and
+     *  directions in \p batch.
+     *
+     *  \param batch Time, frequencies, directions, and reference directions.
+     *  \param buffer Output buffer with room for batch.nDirections() x
+     *  batch.nFreq() instances of type ::diag22c_t, in the same layout as
+     *  used by response(const BeamBatch&, matrix22c_t*) const.
+     */
+    void arrayFactor(const BeamBatch &batch, diag22c_t *buffer) const;
+
+    // @}
+
 private:
+    // Positions of the enabled antennae of an antenna field relative to the
+    // phase reference position, stored as a separate array per coordinate.
+    struct FieldGeometry
+    {
+        vector<real_t>  x;
+        vector<real_t>  y;
+        vector<real_t>  z;
+        vector<real_t>  delay0;
+        vector<real_t>  weight[2];
+        diag22r_t       nEnabled;
+    };
+
     raw_array_factor_t fieldArrayFactor(const AntennaField::ConstPtr &field,
         real_t time, real_t freq, const vector3r_t &direction, real_t freq0,
         const vector3r_t &position0, const vector3r_t &direction0) const;
 
+    void fieldGeometry(const AntennaField::ConstPtr &field,
+        const vector3r_t &direction0, FieldGeometry &geometry) const;
+
+    void fieldArrayFactor(const FieldGeometry &geometry,
+        const BeamBatch &batch, const vector3r_t &direction,
+        vector<real_t> &delay, raw_array_factor_t *buffer) const;
+
 private:
     string      itsName;
     vector3r_t  itsPosition;
@@ -302,6 +359,30 @@ private:
     FieldList   itsFields;
 };
 
+/*!
+ *  \brief Compute the response of a list of stations for all frequencies
+ *  and directions in \p batch.
+ *
+ *  \param first Input iterator to the first station (Station::ConstPtr).
+ *  \param last Input iterator one position past the last station.
+ *  \param batch Time, frequencies, directions, and reference directions.
+ *  \param buffer Output buffer with room for (number of stations) x
+ *  batch.nDirections() x batch.nFreq() instances of type ::matrix22c_t, with
+ *  frequency varying fastest and station varying slowest.
+ */
+template <typename T>
+void response(T first, T last, const BeamBatch &batch, matrix22c_t *buffer);
+
+/*!
+ *  \brief Compute the array factor of a list of stations for all frequencies
+ *  and directions in \p batch.
+ *
+ *  \see response(T first, T last, const BeamBatch &batch,
+ *  matrix22c_t *buffer)
+ */
+template <typename T>
+void arrayFactor(T first, T last, const BeamBatch &batch, diag22c_t *buffer);
+
 // @}
 
 //# ------------------------------------------------------------------------- //
@@ -355,6 +436,26 @@ void Station::arrayFactor(unsigned int count, real_t time, T freq,
     }
 }
 
+template <typename T>
+void response(T first, T last, const BeamBatch &batch, matrix22c_t *buffer)
+{
+    const size_t size = batch.nDirections() * batch.nFreq();
+    for(; first != last; ++first, buffer += size)
+    {
+        (*first)->response(batch, buffer);
+    }
+}
+
+template <typename T>
+void arrayFactor(T first, T last, const BeamBatch &batch, diag22c_t *buffer)
+{
+    const size_t size = batch.nDirections() * batch.nFreq();
+    for(; first != last; ++first, buffer += size)
+    {
+        (*first)->arrayFactor(batch, buffer);
+    }
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
 
@@ -229,5 +229,50 @@ raw_response_t AntennaField::rawResponse(real_t time, real_t freq,
     return result;
 }
 
+void AntennaField::rawResponse(const BeamBatch &batch,
+    const vector3r_t &direction, raw_response_t *buffer) const
+{
+    const unsigned int nFreq = batch.nFreq();
+    if(nFreq == 0)
+    {
+        return;
+    }
+
+    vector<raw_array_factor_t> af(nFreq);
+    rawArrayFactor(batch, direction, &(af[0]));
+
+    vector<matrix22c_t> element(nFreq);
+    elementResponse(batch, direction, &(element[0]));
+
+    for(unsigned int i = 0; i < nFreq; ++i)
+    {
+        buffer[i].response = element[i];
+        buffer[i].response[0][0] *= af[i].factor[0];
+        buffer[i].response[0][1] *= af[i].factor[0];
+        buffer[i].response[1][0] *= af[i].factor[1];
+        buffer[i].response[1][1] *= af[i].factor[1];
+        buffer[i].weight = af[i].weight;
+    }
+}
+
+void AntennaField::rawArrayFactor(const BeamBatch &batch,
+    const vector3r_t &direction, raw_array_factor_t *buffer) const
+{
+    for(unsigned int i = 0; i < batch.nFreq(); ++i)
+    {
+        buffer[i] = rawArrayFactor(batch.time(), batch.freq(i), direction,
+            batch.tile0());
+    }
+}
+
+void AntennaField::elementResponse(const BeamBatch &batch,
+    const vector3r_t &direction, matrix22c_t *buffer) const
+{
+    for(unsigned int i = 0; i < batch.nFreq(); ++i)
+    {
+        buffer[i] = elementResponse(batch.time(), batch.freq(i), direction);
+    }
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
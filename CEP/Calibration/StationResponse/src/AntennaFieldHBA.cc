@@ -73,5 +73,24 @@ matrix22c_t AntennaFieldHBA::elementResponse(real_t time, real_t freq,
         * rotation(time, direction);
 }
 
+void AntennaFieldHBA::rawArrayFactor(const BeamBatch &batch,
+    const vector3r_t &direction, raw_array_factor_t *buffer) const
+{
+    itsAntennaModel->rawArrayFactor(batch, itrf2field(direction),
+        itrf2field(batch.tile0()), buffer);
+}
+
+void AntennaFieldHBA::elementResponse(const BeamBatch &batch,
+    const vector3r_t &direction, matrix22c_t *buffer) const
+{
+    itsAntennaModel->elementResponse(batch, itrf2field(direction), buffer);
+
+    const matrix22r_t parallactic = rotation(batch.time(), direction);
+    for(unsigned int i = 0; i < batch.nFreq(); ++i)
+    {
+        buffer[i] = buffer[i] * parallactic;
+    }
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
@@ -23,6 +23,7 @@
 #include <lofar_config.h>
 #include <StationResponse/AntennaFieldLBA.h>
 #include <StationResponse/MathUtil.h>
+#include <algorithm>
 
 namespace LOFAR
 {
@@ -50,5 +51,24 @@ matrix22c_t AntennaFieldLBA::elementResponse(real_t time, real_t freq,
         * rotation(time, direction);
 }
 
+void AntennaFieldLBA::rawArrayFactor(const BeamBatch &batch,
+    const vector3r_t&, raw_array_factor_t *buffer) const
+{
+    raw_array_factor_t af = {{{1.0, 1.0}}, {{1.0, 1.0}}};
+    std::fill(buffer, buffer + batch.nFreq(), af);
+}
+
+void AntennaFieldLBA::elementResponse(const BeamBatch &batch,
+    const vector3r_t &direction, matrix22c_t *buffer) const
+{
+    itsAntennaModel->response(batch, itrf2field(direction), buffer);
+
+    const matrix22r_t parallactic = rotation(batch.time(), direction);
+    for(unsigned int i = 0; i < batch.nFreq(); ++i)
+    {
+        buffer[i] = buffer[i] * parallactic;
+    }
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
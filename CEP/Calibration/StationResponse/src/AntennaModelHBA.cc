@@ -60,5 +60,24 @@ raw_response_t AntennaModelHBA::rawResponse(real_t freq,
     return result;
 }
 
+void AntennaModelHBA::rawArrayFactor(const BeamBatch &batch,
+    const vector3r_t &direction, const vector3r_t &direction0,
+    raw_array_factor_t *buffer) const
+{
+    for(unsigned int i = 0; i < batch.nFreq(); ++i)
+    {
+        buffer[i] = rawArrayFactor(batch.freq(i), direction, direction0);
+    }
+}
+
+void AntennaModelHBA::elementResponse(const BeamBatch &batch,
+    const vector3r_t &direction, matrix22c_t *buffer) const
+{
+    for(unsigned int i = 0; i < batch.nFreq(); ++i)
+    {
+        buffer[i] = elementResponse(batch.freq(i), direction);
+    }
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
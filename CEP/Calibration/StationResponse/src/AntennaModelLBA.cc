@@ -32,5 +32,14 @@ AntennaModelLBA::~AntennaModelLBA()
 {
 }
 
+void AntennaModelLBA::response(const BeamBatch &batch,
+    const vector3r_t &direction, matrix22c_t *buffer) const
+{
+    for(unsigned int i = 0; i < batch.nFreq(); ++i)
+    {
+        buffer[i] = response(batch.freq(i), direction);
+    }
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
@@ -0,0 +1,250 @@
+//# BeamBatch.cc: Description of a batch of station response evaluations for a
+//# single time.
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <StationResponse/BeamBatch.h>
+#include <StationResponse/Constants.h>
+#include <ElementResponse/ElementResponse.h>
+#include <algorithm>
+#include <cmath>
+
+namespace LOFAR
+{
+namespace StationResponse
+{
+
+namespace
+{
+// Number of antennae that are processed together in
+// BeamBatch::sumPhaseShifts(). The state for each antenna is kept in arrays of
+// this size on the stack.
+const unsigned int antennaBlockSize = 128;
+
+// Maximum number of frequencies for which the phase shifts are updated
+// incrementally before they are recomputed from scratch. This bounds the
+// accumulation of round-off errors.
+const unsigned int resyncInterval = 16;
+
+// Check if the values in the range [first, first + count) are regularly
+// spaced. If so, set delta to the spacing.
+bool isRegular(const real_t *first, unsigned int count, real_t &delta)
+{
+    delta = (count > 1 ? (first[count - 1] - first[0]) / (count - 1) : 0.0);
+    for(unsigned int i = 1; i + 1 < count; ++i)
+    {
+        const real_t expected = first[0] + i * delta;
+        if(std::abs(first[i] - expected) > 1e-12 * std::abs(expected))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+} //# unnamed namespace
+
+BeamBatch::BeamBatch(real_t time, unsigned int count, const real_t *freq,
+    real_t freq0, const vector3r_t &station0, const vector3r_t &tile0)
+    :   itsTime(time),
+        itsStation0(station0),
+        itsTile0(tile0)
+{
+    vector<real_t> freq0List(count, freq0);
+    init(count, freq, count > 0 ? &(freq0List[0]) : 0);
+}
+
+BeamBatch::BeamBatch(real_t time, unsigned int count, const real_t *freq,
+    const real_t *freq0, const vector3r_t &station0, const vector3r_t &tile0)
+    :   itsTime(time),
+        itsStation0(station0),
+        itsTile0(tile0)
+{
+    init(count, freq, freq0);
+}
+
+void BeamBatch::init(unsigned int count, const real_t *freq,
+    const real_t *freq0)
+{
+    itsFreq.assign(freq, freq + count);
+    itsFreq0.assign(freq0, freq0 + count);
+
+    itsK.resize(count);
+    itsK0.resize(count);
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        itsK[i] = Constants::_2pi * itsFreq[i] / Constants::c;
+        itsK0[i] = Constants::_2pi * itsFreq0[i] / Constants::c;
+    }
+
+    itsRegular = count > 0 && isRegular(&(itsK[0]), count, itsDeltaK);
+    itsRegular0 = count > 0 && isRegular(&(itsK0[0]), count, itsDeltaK0);
+
+    // Reduce the element beam models to a polynomial in theta for each
+    // frequency. This only depends on frequency, and is shared by all
+    // stations and directions.
+    const unsigned int nLBACoeff = element_response_lba_reduced_size();
+    const unsigned int nHBACoeff = element_response_hba_reduced_size();
+    itsLBACoeff.resize(count * nLBACoeff);
+    itsHBACoeff.resize(count * nHBACoeff);
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        element_response_lba_reduce(itsFreq[i], &(itsLBACoeff[i * nLBACoeff]));
+        element_response_hba_reduce(itsFreq[i], &(itsHBACoeff[i * nHBACoeff]));
+    }
+}
+
+void BeamBatch::setDirections(unsigned int count, const vector3r_t *direction)
+{
+    itsDirections.assign(direction, direction + count);
+}
+
+real_t BeamBatch::time() const
+{
+    return itsTime;
+}
+
+unsigned int BeamBatch::nFreq() const
+{
+    return itsFreq.size();
+}
+
+real_t BeamBatch::freq(unsigned int i) const
+{
+    return itsFreq[i];
+}
+
+real_t BeamBatch::freq0(unsigned int i) const
+{
+    return itsFreq0[i];
+}
+
+unsigned int BeamBatch::nDirections() const
+{
+    return itsDirections.size();
+}
+
+const vector3r_t &BeamBatch::direction(unsigned int i) const
+{
+    return itsDirections[i];
+}
+
+const vector3r_t &BeamBatch::station0() const
+{
+    return itsStation0;
+}
+
+const vector3r_t &BeamBatch::tile0() const
+{
+    return itsTile0;
+}
+
+const complex_t *BeamBatch::lbaCoeff() const
+{
+    return itsLBACoeff.empty() ? 0 : &(itsLBACoeff[0]);
+}
+
+const complex_t *BeamBatch::hbaCoeff() const
+{
+    return itsHBACoeff.empty() ? 0 : &(itsHBACoeff[0]);
+}
+
+void BeamBatch::sumPhaseShifts(unsigned int count, const real_t *delay,
+    const real_t *delay0, const real_t *weight0, const real_t *weight1,
+    raw_array_factor_t *buffer) const
+{
+    const unsigned int nFreq = itsK.size();
+    for(unsigned int i = 0; i < nFreq; ++i)
+    {
+        buffer[i].factor[0] = 0.0;
+        buffer[i].factor[1] = 0.0;
+    }
+
+    // If the wave numbers are regularly spaced, the phase shift of each
+    // antenna increases by a fixed amount from one frequency to the next.
+    const bool regular = itsRegular && (delay0 == 0 || itsRegular0);
+
+    // The phase shift of each antenna is kept as a (cos, sin) pair in separate
+    // arrays, such that the loops over the antennae below can be vectorized.
+    real_t re[antennaBlockSize], im[antennaBlockSize];
+    real_t stepRe[antennaBlockSize], stepIm[antennaBlockSize];
+
+    for(unsigned int first = 0; first < count; first += antennaBlockSize)
+    {
+        const unsigned int n = std::min(antennaBlockSize, count - first);
+        const real_t *d = delay + first;
+        const real_t *d0 = (delay0 == 0 ? 0 : delay0 + first);
+        const real_t *w0 = weight0 + first;
+        const real_t *w1 = weight1 + first;
+
+        if(regular)
+        {
+            for(unsigned int a = 0; a < n; ++a)
+            {
+                const real_t step = itsDeltaK * d[a]
+                    - (d0 == 0 ? 0.0 : itsDeltaK0 * d0[a]);
+                stepRe[a] = std::cos(step);
+                stepIm[a] = std::sin(step);
+            }
+        }
+
+        for(unsigned int i = 0; i < nFreq; ++i)
+        {
+            if(!regular || i % resyncInterval == 0)
+            {
+                const real_t k = itsK[i];
+                const real_t k0 = itsK0[i];
+                for(unsigned int a = 0; a < n; ++a)
+                {
+                    const real_t phase = k * d[a]
+                        - (d0 == 0 ? 0.0 : k0 * d0[a]);
+                    re[a] = std::cos(phase);
+                    im[a] = std::sin(phase);
+                }
+            }
+            else
+            {
+                for(unsigned int a = 0; a < n; ++a)
+                {
+                    const real_t tmp = re[a] * stepRe[a] - im[a] * stepIm[a];
+                    im[a] = re[a] * stepIm[a] + im[a] * stepRe[a];
+                    re[a] = tmp;
+                }
+            }
+
+            real_t re0 = 0.0, im0 = 0.0, re1 = 0.0, im1 = 0.0;
+            for(unsigned int a = 0; a < n; ++a)
+            {
+                re0 += w0[a] * re[a];
+                im0 += w0[a] * im[a];
+                re1 += w1[a] * re[a];
+                im1 += w1[a] * im[a];
+            }
+
+            buffer[i].factor[0] += complex_t(re0, im0);
+            buffer[i].factor[1] += complex_t(re1, im1);
+        }
+    }
+}
+
+} //# namespace StationResponse
+} //# namespace LOFAR
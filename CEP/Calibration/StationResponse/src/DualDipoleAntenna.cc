@@ -47,5 +47,18 @@ matrix22c_t DualDipoleAntenna::response(real_t freq,
     return response;
 }
 
+void DualDipoleAntenna::response(const BeamBatch &batch,
+    const vector3r_t &direction, matrix22c_t *buffer) const
+{
+    // The direction dependent part of the model is evaluated once for all
+    // frequencies, using the coefficients reduced to a polynomial in theta
+    // that are cached in the batch.
+    vector2r_t thetaphi = cart2thetaphi(direction);
+    thetaphi[1] -= 5.0 * Constants::pi_4;
+    element_response_lba(thetaphi[0], thetaphi[1], batch.nFreq(),
+        batch.lbaCoeff(),
+        reinterpret_cast<std::complex<double> (*)[2][2]>(buffer));
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
@@ -23,6 +23,7 @@
 #include <lofar_config.h>
 #include <StationResponse/Station.h>
 #include <StationResponse/MathUtil.h>
+#include <algorithm>
 
 namespace LOFAR
 {
@@ -172,5 +173,168 @@ Station::fieldArrayFactor(const AntennaField::ConstPtr &field,
     return af;
 }
 
+void Station::response(const BeamBatch &batch, matrix22c_t *buffer) const
+{
+    const unsigned int nFreq = batch.nFreq();
+    if(nFreq == 0)
+    {
+        return;
+    }
+
+    vector<FieldGeometry> geometry(itsFields.size());
+    for(size_t i = 0; i < itsFields.size(); ++i)
+    {
+        fieldGeometry(itsFields[i], batch.station0(), geometry[i]);
+    }
+
+    const raw_response_t zero = {{{{{}}, {{}}}}, {{}}};
+    vector<raw_response_t> result(nFreq);
+    vector<raw_response_t> antenna(nFreq);
+    vector<raw_array_factor_t> field(nFreq);
+    vector<real_t> delay;
+    for(unsigned int i = 0; i < batch.nDirections(); ++i)
+    {
+        const vector3r_t &direction = batch.direction(i);
+
+        std::fill(result.begin(), result.end(), zero);
+        for(size_t j = 0; j < itsFields.size(); ++j)
+        {
+            fieldArrayFactor(geometry[j], batch, direction, delay,
+                &(field[0]));
+            itsFields[j]->rawResponse(batch, direction, &(antenna[0]));
+
+            for(unsigned int k = 0; k < nFreq; ++k)
+            {
+                raw_response_t &sum = result[k];
+                sum.response[0][0] += field[k].factor[0]
+                    * antenna[k].response[0][0];
+                sum.response[0][1] += field[k].factor[0]
+                    * antenna[k].response[0][1];
+                sum.response[1][0] += field[k].factor[1]
+                    * antenna[k].response[1][0];
+                sum.response[1][1] += field[k].factor[1]
+                    * antenna[k].response[1][1];
+
+                sum.weight[0] += field[k].weight[0] * antenna[k].weight[0];
+                sum.weight[1] += field[k].weight[1] * antenna[k].weight[1];
+            }
+        }
+
+        for(unsigned int k = 0; k < nFreq; ++k)
+        {
+            *buffer++ = normalize(result[k]);
+        }
+    }
+}
+
+void Station::arrayFactor(const BeamBatch &batch, diag22c_t *buffer) const
+{
+    const unsigned int nFreq = batch.nFreq();
+    if(nFreq == 0)
+    {
+        return;
+    }
+
+    vector<FieldGeometry> geometry(itsFields.size());
+    for(size_t i = 0; i < itsFields.size(); ++i)
+    {
+        fieldGeometry(itsFields[i], batch.station0(), geometry[i]);
+    }
+
+    const raw_array_factor_t zero = {{{}}, {{}}};
+    vector<raw_array_factor_t> result(nFreq);
+    vector<raw_array_factor_t> antenna(nFreq);
+    vector<raw_array_factor_t> field(nFreq);
+    vector<real_t> delay;
+    for(unsigned int i = 0; i < batch.nDirections(); ++i)
+    {
+        const vector3r_t &direction = batch.direction(i);
+
+        std::fill(result.begin(), result.end(), zero);
+        for(size_t j = 0; j < itsFields.size(); ++j)
+        {
+            fieldArrayFactor(geometry[j], batch, direction, delay,
+                &(field[0]));
+            itsFields[j]->rawArrayFactor(batch, direction, &(antenna[0]));
+
+            for(unsigned int k = 0; k < nFreq; ++k)
+            {
+                raw_array_factor_t &sum = result[k];
+                sum.factor[0] += field[k].factor[0] * antenna[k].factor[0];
+                sum.factor[1] += field[k].factor[1] * antenna[k].factor[1];
+                sum.weight[0] += field[k].weight[0] * antenna[k].weight[0];
+                sum.weight[1] += field[k].weight[1] * antenna[k].weight[1];
+            }
+        }
+
+        for(unsigned int k = 0; k < nFreq; ++k)
+        {
+            *buffer++ = normalize(result[k]);
+        }
+    }
+}
+
+void Station::fieldGeometry(const AntennaField::ConstPtr &field,
+    const vector3r_t &direction0, FieldGeometry &geometry) const
+{
+    vector3r_t offset = field->position() - phaseReference();
+    geometry.nEnabled[0] = 0.0;
+    geometry.nEnabled[1] = 0.0;
+
+    typedef AntennaField::AntennaList AntennaList;
+    for(AntennaList::const_iterator antenna_it = field->beginAntennae(),
+        antenna_end = field->endAntennae(); antenna_it != antenna_end;
+        ++antenna_it)
+    {
+        if(!antenna_it->enabled[0] && !antenna_it->enabled[1])
+        {
+            continue;
+        }
+
+        vector3r_t position = offset + antenna_it->position;
+        geometry.x.push_back(position[0]);
+        geometry.y.push_back(position[1]);
+        geometry.z.push_back(position[2]);
+        geometry.delay0.push_back(dot(position, direction0));
+        geometry.weight[0].push_back(antenna_it->enabled[0] ? 1.0 : 0.0);
+        geometry.weight[1].push_back(antenna_it->enabled[1] ? 1.0 : 0.0);
+        geometry.nEnabled[0] += geometry.weight[0].back();
+        geometry.nEnabled[1] += geometry.weight[1].back();
+    }
+}
+
+void Station::fieldArrayFactor(const FieldGeometry &geometry,
+    const BeamBatch &batch, const vector3r_t &direction,
+    vector<real_t> &delay, raw_array_factor_t *buffer) const
+{
+    const unsigned int nFreq = batch.nFreq();
+    const unsigned int nAntennae = geometry.x.size();
+
+    if(nAntennae == 0)
+    {
+        raw_array_factor_t af = {{{}}, {{}}};
+        std::fill(buffer, buffer + nFreq, af);
+        return;
+    }
+
+    delay.resize(nAntennae);
+    const real_t *x = &(geometry.x[0]);
+    const real_t *y = &(geometry.y[0]);
+    const real_t *z = &(geometry.z[0]);
+    for(unsigned int i = 0; i < nAntennae; ++i)
+    {
+        delay[i] = x[i] * direction[0] + y[i] * direction[1]
+            + z[i] * direction[2];
+    }
+
+    batch.sumPhaseShifts(nAntennae, &(delay[0]), &(geometry.delay0[0]),
+        &(geometry.weight[0][0]), &(geometry.weight[1][0]), buffer);
+
+    for(unsigned int i = 0; i < nFreq; ++i)
+    {
+        buffer[i].weight = geometry.nEnabled;
+    }
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
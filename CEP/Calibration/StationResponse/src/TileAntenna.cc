@@ -25,6 +25,7 @@
 #include <StationResponse/Constants.h>
 #include <StationResponse/MathUtil.h>
 #include <ElementResponse/ElementResponse.h>
+#include <Common/lofar_vector.h>
 
 namespace LOFAR
 {
@@ -96,5 +97,43 @@ matrix22c_t TileAntenna::elementResponse(real_t freq,
     return response;
 }
 
+void TileAntenna::rawArrayFactor(const BeamBatch &batch,
+    const vector3r_t &direction, const vector3r_t &direction0,
+    raw_array_factor_t *buffer) const
+{
+    // The projection of the position of each dipole element on the difference
+    // between the target and reference direction does not depend on
+    // frequency (see above).
+    vector3r_t difference = direction - direction0;
+
+    const unsigned int nElements = itsConfig.size();
+    vector<real_t> delay(nElements);
+    vector<real_t> weight(nElements, 1.0);
+    for(unsigned int i = 0; i < nElements; ++i)
+    {
+        delay[i] = dot(difference, itsConfig[i]);
+    }
+
+    batch.sumPhaseShifts(nElements, &(delay[0]), 0, &(weight[0]),
+        &(weight[0]), buffer);
+
+    real_t size = nElements;
+    for(unsigned int i = 0; i < batch.nFreq(); ++i)
+    {
+        buffer[i].weight[0] = size;
+        buffer[i].weight[1] = size;
+    }
+}
+
+void TileAntenna::elementResponse(const BeamBatch &batch,
+    const vector3r_t &direction, matrix22c_t *buffer) const
+{
+    vector2r_t thetaphi = cart2thetaphi(direction);
+    thetaphi[1] -= 5.0 * Constants::pi_4;
+    element_response_hba(thetaphi[0], thetaphi[1], batch.nFreq(),
+        batch.hbaCoeff(),
+        reinterpret_cast<std::complex<double> (*)[2][2]>(buffer));
+}
+
 } //# namespace StationResponse
 } //# namespace LOFAR
@@ -0,0 +1,256 @@
+//# tBeamBatch.cc: Compare the batched evaluation of the station response to
+//# the evaluation per frequency and direction, and report the run time of both.
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <StationResponse/AntennaFieldHBA.h>
+#include <StationResponse/AntennaFieldLBA.h>
+#include <StationResponse/BeamBatch.h>
+#include <StationResponse/DualDipoleAntenna.h>
+#include <StationResponse/MathUtil.h>
+#include <StationResponse/Station.h>
+#include <StationResponse/TileAntenna.h>
+#include <Common/Timer.h>
+#include <Common/lofar_iostream.h>
+#include <Common/lofar_sstream.h>
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace LOFAR;
+using namespace LOFAR::StationResponse;
+
+// Coordinate system of an antenna field at the given geodetic longitude and
+// latitude (rad), with axes pointing towards the East, North, and zenith.
+AntennaField::CoordinateSystem makeCoordinates(real_t lon, real_t lat)
+{
+    const real_t radius = 6371.0e3;
+    AntennaField::CoordinateSystem coordinates =
+        {{{radius * cos(lat) * cos(lon), radius * cos(lat) * sin(lon),
+            radius * sin(lat)}},
+         {{{-sin(lon), cos(lon), 0.0}},
+          {{-sin(lat) * cos(lon), -sin(lat) * sin(lon), cos(lat)}},
+          {{cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat)}}}};
+    return coordinates;
+}
+
+vector3r_t field2itrf(const AntennaField::CoordinateSystem &coordinates,
+    real_t p, real_t q, real_t r)
+{
+    const AntennaField::CoordinateSystem::Axes &axes = coordinates.axes;
+    vector3r_t itrf = {{p * axes.p[0] + q * axes.q[0] + r * axes.r[0],
+        p * axes.p[1] + q * axes.q[1] + r * axes.r[1],
+        p * axes.p[2] + q * axes.q[2] + r * axes.r[2]}};
+    return itrf;
+}
+
+void addAntennae(AntennaField &field, unsigned int count, real_t size)
+{
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        AntennaField::Antenna antenna;
+        antenna.position = field2itrf(field.coordinates(),
+            (drand48() - 0.5) * size, (drand48() - 0.5) * size, 0.0);
+        antenna.enabled[0] = drand48() > 0.05;
+        antenna.enabled[1] = drand48() > 0.05;
+        field.addAntenna(antenna);
+    }
+}
+
+// Create a station with an LBA field of 96 antennae and an HBA field of 48
+// tiles, similar to a LOFAR core station.
+Station::Ptr makeStation(unsigned int id)
+{
+    const real_t lon = 0.1199 + 1e-4 * id;
+    const real_t lat = 0.9230 + 1e-4 * id;
+    AntennaField::CoordinateSystem coordinates = makeCoordinates(lon, lat);
+
+    ostringstream name;
+    name << "CS" << id;
+    Station::Ptr station(new Station(name.str(), coordinates.origin));
+
+    AntennaFieldLBA::Ptr lba(new AntennaFieldLBA(name.str() + "LBA",
+        coordinates, AntennaModelLBA::Ptr(new DualDipoleAntenna())));
+    addAntennae(*lba, 96, 80.0);
+    station->addField(lba);
+
+    TileAntenna::TileConfig config;
+    for(unsigned int i = 0; i < config.size(); ++i)
+    {
+        config[i] = field2itrf(coordinates, 1.25 * (i % 4) - 1.875,
+            1.25 * (i / 4) - 1.875, 0.0);
+    }
+
+    AntennaFieldHBA::Ptr hba(new AntennaFieldHBA(name.str() + "HBA",
+        coordinates, AntennaModelHBA::Ptr(new TileAntenna(config))));
+    addAntennae(*hba, 48, 40.0);
+    station->addField(hba);
+
+    return station;
+}
+
+// Random directions within 30 degrees of the zenith of the given station.
+vector<vector3r_t> makeDirections(const Station &station, unsigned int count)
+{
+    const AntennaField::CoordinateSystem &coordinates =
+        station.field(0)->coordinates();
+
+    vector<vector3r_t> directions;
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        const real_t theta = drand48() * 0.5;
+        const real_t phi = drand48() * Constants::_2pi;
+        directions.push_back(field2itrf(coordinates, sin(theta) * cos(phi),
+            sin(theta) * sin(phi), cos(theta)));
+    }
+    return directions;
+}
+
+template <typename T>
+bool compare(const T &expected, const T &value)
+{
+    const complex_t *x = reinterpret_cast<const complex_t*>(&expected);
+    const complex_t *y = reinterpret_cast<const complex_t*>(&value);
+    for(size_t i = 0; i < sizeof(T) / sizeof(complex_t); ++i)
+    {
+        if(abs(x[i] - y[i]) > 1e-9 * std::max(1.0, abs(x[i])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool doTest(unsigned int nStations, unsigned int nFreq, unsigned int nDir,
+    bool regular, bool useChannelFreq, unsigned int nIter)
+{
+    cout << "stations: " << nStations << " channels: " << nFreq
+        << " directions: " << nDir << " regular: " << regular
+        << " channel frequency: " << useChannelFreq << endl;
+
+    srand48(42);
+    vector<Station::ConstPtr> stations;
+    for(unsigned int i = 0; i < nStations; ++i)
+    {
+        stations.push_back(makeStation(i));
+    }
+
+    vector<real_t> freq(nFreq);
+    for(unsigned int i = 0; i < nFreq; ++i)
+    {
+        freq[i] = 150.0e6 + i * 195312.5 / 64.0
+            + (regular ? 0.0 : 100.0 * drand48());
+    }
+    vector<real_t> freq0(useChannelFreq ? freq : vector<real_t>(nFreq,
+        150.0e6));
+
+    vector<vector3r_t> directions = makeDirections(*stations[0], nDir);
+    const vector3r_t station0 = directions[0];
+    const vector3r_t tile0 = directions[nDir / 2];
+    const real_t time = 4.8e9;
+
+    BeamBatch batch(time, nFreq, &(freq[0]), &(freq0[0]), station0, tile0);
+    batch.setDirections(nDir, &(directions[0]));
+
+    const size_t size = nStations * nDir * nFreq;
+    vector<matrix22c_t> response(size), expected(size);
+    vector<diag22c_t> af(size), expectedAF(size);
+
+    NSTimer scalarTimer, batchTimer;
+    for(unsigned int iter = 0; iter < nIter; ++iter)
+    {
+        scalarTimer.start();
+        for(unsigned int i = 0; i < nStations; ++i)
+        {
+            for(unsigned int j = 0; j < nDir; ++j)
+            {
+                const size_t offset = (i * nDir + j) * nFreq;
+                stations[i]->response(nFreq, time, freq.begin(), directions[j],
+                    freq0.begin(), station0, tile0, &(expected[offset]));
+                stations[i]->arrayFactor(nFreq, time, freq.begin(),
+                    directions[j], freq0.begin(), station0, tile0,
+                    &(expectedAF[offset]));
+            }
+        }
+        scalarTimer.stop();
+
+        batchTimer.start();
+        StationResponse::response(stations.begin(), stations.end(), batch,
+            &(response[0]));
+        StationResponse::arrayFactor(stations.begin(), stations.end(), batch,
+            &(af[0]));
+        batchTimer.stop();
+    }
+
+    cout << "scalar: " << scalarTimer.getElapsed() << " s batch: "
+        << batchTimer.getElapsed() << " s speed-up: "
+        << scalarTimer.getElapsed() / batchTimer.getElapsed() << endl;
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        if(!compare(expected[i], response[i]))
+        {
+            cerr << "Response mismatch at index: " << i << " expected: "
+                << expected[i] << " got: " << response[i] << endl;
+            return false;
+        }
+
+        if(!compare(expectedAF[i], af[i]))
+        {
+            cerr << "Array factor mismatch at index: " << i << " expected: "
+                << expectedAF[i] << " got: " << af[i] << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        // Usage: tBeamBatch [nStations nFreq nDirections nIter]
+        if(argc == 5)
+        {
+            return doTest(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]), true,
+                false, atoi(argv[4])) ? 0 : 1;
+        }
+
+        if(!doTest(1, 1, 1, true, false, 1)
+            || !doTest(3, 64, 5, true, false, 1)
+            || !doTest(3, 64, 5, true, true, 1)
+            || !doTest(3, 37, 5, false, false, 1)
+            || !doTest(3, 37, 5, false, true, 1)
+            || !doTest(8, 256, 4, true, false, 2))
+        {
+            return 1;
+        }
+    }
+    catch(std::exception &ex)
+    {
+        cerr << "Unexpected exception: " << ex.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
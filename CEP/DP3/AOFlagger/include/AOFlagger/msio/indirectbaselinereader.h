@@ -21,6 +21,7 @@
 #define INDIRECTBASELINEREADER_H
 
 #include <map>
+#include <sstream>
 #include <vector>
 #include <stdexcept>
 
@@ -28,6 +29,17 @@
 #include <AOFlagger/msio/directbaselinereader.h>
 
 /**
+ * Baseline reader that reorders the measurement set once into a baseline-major scratch
+ * file, after which baselines can be read and written with sequential access.
+ * 
+ * The scratch file ("ms-reordered.tmp") holds, for each baseline, all its time steps
+ * consecutively: first the data of all baselines, then the flags. Because every
+ * baseline has the same size, the offset index is just the baseline number
+ * times that size. The file is written with large sequential writes while reordering,
+ * and is memory mapped afterwards to serve the read and write requests. When the
+ * reader is destroyed, only the baselines of which the flags (or data) were changed are
+ * written back to the measurement set.
+ * 
 	@author A.R. Offringa <offringa@astro.rug.nl>
 */
 class IndirectBaselineReader : public BaselineReader {
@@ -44,8 +56,13 @@ class IndirectBaselineReader : public BaselineReader {
 		virtual size_t GetMaxRecommendedBufferSize(size_t /*threadCount*/) { return 2; }
 		void SetReadUVW(bool readUVW) { _readUVW = readUVW; }
 	private:
+		struct ReorderBlock;
+		class ReorderWorker;
+		
 		void initializeReorderedMS();
+		void initializeLayout();
 		void reorderMS();
+		void reorderBlock(const ReorderBlock &block);
 		void updateOriginalMSData();
 		void updateOriginalMSFlags();
 		void performFlagWriteTask(std::vector<Mask2DCPtr> flags, int antenna1, int antenna2);
@@ -53,19 +70,31 @@ class IndirectBaselineReader : public BaselineReader {
 		template<bool UpdateData, bool UpdateFlags>
 		void updateOriginalMS();
 		
+		void openScratchFile(bool create);
+		void closeScratchFile();
 		void removeTemporaryFiles();
-		std::string DataFilename(int antenna1, int antenna2) const
-		{
-			std::stringstream dataFilename;
-			dataFilename << "data-" << antenna1 << "x" << antenna2 << ".tmp";
-			return dataFilename.str();
-		}
-		std::string FlagFilename(int antenna1, int antenna2) const
+		
+		size_t baselineIndex(size_t antenna1, size_t antenna2) const
 		{
-			std::stringstream flagFilename;
-			flagFilename << "flag-" << antenna1 << "x" << antenna2 << ".tmp";
-			return flagFilename.str();
+			if(antenna1 >= _baselineIndices.size() || antenna2 >= _baselineIndices[antenna1].size() || _baselineIndices[antenna1][antenna2] == (size_t) -1)
+			{
+				std::stringstream s;
+				s << "Baseline " << antenna1 << " x " << antenna2 << " is not in the reordered measurement set";
+				throw std::runtime_error(s.str());
+			}
+			return _baselineIndices[antenna1][antenna2];
 		}
+		/** Number of values (frequencies x polarizations) in one time step of a baseline. */
+		size_t samplesPerTimestep() const { return _frequencyCount * _polarizationCount; }
+		size_t dataBytesPerBaseline() const { return _timestepCount * samplesPerTimestep() * 2 * sizeof(float); }
+		size_t flagBytesPerBaseline() const { return _timestepCount * samplesPerTimestep() * sizeof(bool); }
+		size_t dataOffset(size_t baseline) const { return baseline * dataBytesPerBaseline(); }
+		size_t flagOffset(size_t baseline) const { return _baselineCount * dataBytesPerBaseline() + baseline * flagBytesPerBaseline(); }
+		float *dataPtr(size_t baseline) const { return reinterpret_cast<float*>(_scratchMap + dataOffset(baseline)); }
+		bool *flagPtr(size_t baseline) const { return reinterpret_cast<bool*>(_scratchMap + flagOffset(baseline)); }
+		
+		static const char *scratchFilename() { return "ms-reordered.tmp"; }
+		static const char *infoFilename() { return "ms-aoinfo.txt"; }
 
 		DirectBaselineReader _directReader;
 		bool _msIsReordered;
@@ -74,6 +103,14 @@ class IndirectBaselineReader : public BaselineReader {
 		bool _reorderedFlagFilesHaveChanged;
 		size_t _maxMemoryUse;
 		bool _readUVW;
+		
+		std::vector<std::vector<size_t> > _baselineIndices;
+		std::vector<std::pair<size_t,size_t> > _baselines;
+		size_t _baselineCount, _timestepCount, _frequencyCount, _polarizationCount;
+		std::vector<bool> _dataChanged, _flagsChanged;
+		int _scratchFd;
+		char *_scratchMap;
+		size_t _scratchSize;
 };
 
 #endif // INDIRECTBASELINEREADER_H
@@ -24,6 +24,8 @@
 
 #include <AOFlagger/msio/mask2d.h>
 
+#include <AOFlagger/util/cpufeatures.h>
+
 /**
 	@author A.R. Offringa <offringa@astro.rug.nl>
 */
@@ -42,8 +44,57 @@ class StatisticalFlagger{
 			DilateFlagsHorizontally(mask, timeSize);
 			DilateFlagsVertically(mask, frequencySize);
 		}
-		static void DilateFlagsHorizontally(Mask2DPtr mask, size_t timeSize);
-		static void DilateFlagsVertically(Mask2DPtr mask, size_t frequencySize);
+		/**
+		 * Flags every sample that is within timeSize samples of a flagged sample
+		 * in the same row. Runs the fastest implementation that the machine supports.
+		 */
+		static void DilateFlagsHorizontally(Mask2DPtr mask, size_t timeSize)
+		{
+			if(CPUFeatures::HasAVX512F())
+				DilateFlagsHorizontallyAVX512(mask, timeSize);
+			else if(CPUFeatures::HasAVX2())
+				DilateFlagsHorizontallyAVX2(mask, timeSize);
+			else
+				DilateFlagsHorizontallyReference(mask, timeSize);
+		}
+		/**
+		 * Flags every sample that is within frequencySize samples of a flagged sample
+		 * in the same column. Runs the fastest implementation that the machine supports.
+		 */
+		static void DilateFlagsVertically(Mask2DPtr mask, size_t frequencySize)
+		{
+			if(CPUFeatures::HasAVX512F())
+				DilateFlagsVerticallyAVX512(mask, frequencySize);
+			else if(CPUFeatures::HasAVX2())
+				DilateFlagsVerticallyAVX2(mask, frequencySize);
+			else
+				DilateFlagsVerticallyReference(mask, frequencySize);
+		}
+		static void DilateFlagsHorizontallyReference(Mask2DPtr mask, size_t timeSize);
+		static void DilateFlagsVerticallyReference(Mask2DPtr mask, size_t frequencySize);
+		/**
+		 * Vectorized dilation, which gives the same result as the reference version. Each row
+		 * is dilated with a logarithmic number of shifted ORs over 32 flags at a time.
+		 * Should only be called when CPUFeatures::HasAVX2() returns true; when the AVX2 kernels
+		 * were not compiled in, it falls back to the reference version.
+		 */
+		static void DilateFlagsHorizontallyAVX2(Mask2DPtr mask, size_t timeSize);
+		/**
+		 * Vectorized dilation, which gives the same result as the reference version. It keeps
+		 * a running count of the flags in the window for each column, and processes whole rows
+		 * at a time. Should only be called when CPUFeatures::HasAVX2() returns true.
+		 */
+		static void DilateFlagsVerticallyAVX2(Mask2DPtr mask, size_t frequencySize);
+		/**
+		 * AVX-512 version of DilateFlagsHorizontallyAVX2(), processing 64 flags at a time.
+		 * Should only be called when CPUFeatures::HasAVX512F() returns true.
+		 */
+		static void DilateFlagsHorizontallyAVX512(Mask2DPtr mask, size_t timeSize);
+		/**
+		 * AVX-512 version of DilateFlagsVerticallyAVX2(), processing sixteen columns at a time.
+		 * Should only be called when CPUFeatures::HasAVX512F() returns true.
+		 */
+		static void DilateFlagsVerticallyAVX512(Mask2DPtr mask, size_t frequencySize);
 		static void LineRemover(Mask2DPtr mask, size_t maxTimeContamination, size_t maxFreqContamination);
 		static void DensityTimeFlagger(Mask2DPtr mask, num_t minimumGoodDataRatio);
 		static void DensityFrequencyFlagger(Mask2DPtr mask, num_t minimumGoodDataRatio);
@@ -64,6 +115,21 @@ class StatisticalFlagger{
 		 */
 		static void ScaleInvDilationQuick(bool *flags, const unsigned n, num_t minimumGoodDataRatio);
 	private:
+		/**
+		 * The AVX kernels are compiled in separate translation units with -mavx2 or
+		 * -mavx512f, and therefore work on plain pointers (see ThresholdMitigater::KernelData).
+		 * The horizontal kernels work in place; the vertical kernels write into a mask with
+		 * the same dimensions.
+		 */
+		typedef void (*HorizontalDilationKernel)(bool *values, size_t stride, size_t width, size_t height, size_t size);
+		typedef void (*VerticalDilationKernel)(const bool *input, bool *output, size_t stride, size_t width, size_t height, size_t size);
+		static void dilateHorizontallyWithKernel(HorizontalDilationKernel kernel, Mask2DPtr mask, size_t timeSize);
+		static void dilateVerticallyWithKernel(VerticalDilationKernel kernel, Mask2DPtr mask, size_t frequencySize);
+		static void dilateFlagsHorizontallyAVX2(bool *values, size_t stride, size_t width, size_t height, size_t size);
+		static void dilateFlagsVerticallyAVX2(const bool *input, bool *output, size_t stride, size_t width, size_t height, size_t size);
+		static void dilateFlagsHorizontallyAVX512(bool *values, size_t stride, size_t width, size_t height, size_t size);
+		static void dilateFlagsVerticallyAVX512(const bool *input, bool *output, size_t stride, size_t width, size_t height, size_t size);
+		
 		static void FlagTime(Mask2DPtr mask, size_t x);
 		static void FlagFrequency(Mask2DPtr mask, size_t y);
 		static void MaskToInts(Mask2DCPtr mask, int **maskAsInt);
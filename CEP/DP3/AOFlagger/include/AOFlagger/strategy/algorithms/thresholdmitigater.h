@@ -26,6 +26,8 @@
 #include <AOFlagger/msio/image2d.h>
 #include <AOFlagger/msio/mask2d.h>
 
+#include <AOFlagger/util/cpufeatures.h>
+
 /**
 	@author A.R. Offringa <offringa@astro.rug.nl>
 */
@@ -52,6 +54,33 @@ class ThresholdMitigater{
 		
 		static void HorizontalSumThresholdLargeSSE(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
 
+		/**
+		 * AVX2 version of the vertical SumThreshold. It processes whole rows at a time, eight
+		 * columns per instruction, and produces the same flags as the SSE version.
+		 * Should only be called when CPUFeatures::HasAVX2() returns true; when the AVX2 kernels
+		 * were not compiled in, it falls back to the SSE version.
+		 */
+		static void VerticalSumThresholdLargeAVX2(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
+		
+		/**
+		 * AVX2 version of the horizontal SumThreshold. Blocks of eight rows are transposed in
+		 * 8x8 tiles, such that the sliding window runs over eight rows per instruction.
+		 * @see VerticalSumThresholdLargeAVX2()
+		 */
+		static void HorizontalSumThresholdLargeAVX2(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
+		
+		/**
+		 * AVX-512 version of the vertical SumThreshold, processing sixteen columns per instruction.
+		 * Should only be called when CPUFeatures::HasAVX512F() returns true.
+		 */
+		static void VerticalSumThresholdLargeAVX512(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
+		
+		/**
+		 * AVX-512 version of the horizontal SumThreshold, processing blocks of sixteen rows.
+		 * Should only be called when CPUFeatures::HasAVX512F() returns true.
+		 */
+		static void HorizontalSumThresholdLargeAVX512(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
+
 		template<size_t Length>
 		static void VerticalSumThresholdLargeCompare(Image2DCPtr input, Mask2DPtr mask, num_t threshold);
 
@@ -65,23 +94,34 @@ class ThresholdMitigater{
 			VerticalSumThresholdLarge<Length>(input, mask, vThreshold);
 		}
 		
+		/**
+		 * Runs the fastest vertical SumThreshold implementation that the machine supports.
+		 */
 		static void VerticalSumThresholdLarge(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold)
 		{
-			VerticalSumThresholdLargeSSE(input, mask, length, threshold);
-			
-			// We could/should check maybe availability of SSE here. If no SSE is
-			// available, we should call:
-			
-			// VerticalSumThresholdLargeReference(input, mask, length, threshold);
+			if(CPUFeatures::HasAVX512F())
+				VerticalSumThresholdLargeAVX512(input, mask, length, threshold);
+			else if(CPUFeatures::HasAVX2())
+				VerticalSumThresholdLargeAVX2(input, mask, length, threshold);
+			else
+				VerticalSumThresholdLargeSSE(input, mask, length, threshold);
 		}
 		
 		static void VerticalSumThresholdLargeReference(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
 		
 		static void HorizontalSumThresholdLargeReference(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
 		
+		/**
+		 * Runs the fastest horizontal SumThreshold implementation that the machine supports.
+		 */
 		static void HorizontalSumThresholdLarge(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold)
 		{
-			HorizontalSumThresholdLargeSSE(input, mask, length, threshold);
+			if(CPUFeatures::HasAVX512F())
+				HorizontalSumThresholdLargeAVX512(input, mask, length, threshold);
+			else if(CPUFeatures::HasAVX2())
+				HorizontalSumThresholdLargeAVX2(input, mask, length, threshold);
+			else
+				HorizontalSumThresholdLargeSSE(input, mask, length, threshold);
 		}
 
 		static void VarThreshold(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
@@ -91,6 +131,39 @@ class ThresholdMitigater{
 		static void VerticalVarThreshold(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
 	private:
 		ThresholdMitigater() { }
+		
+		/**
+		 * Raw view on the data that the AVX kernels work on. The kernels are compiled with
+		 * -mavx2 or -mavx512f in their own translation units. Because the linker may pick any
+		 * copy of an inline function or template instantiation, those units should not use
+		 * code that is shared with the rest of the flagger (like the Image2D accessors), hence
+		 * the kernels get plain pointers. The output mask is a copy of the input mask, and
+		 * has the same stride.
+		 */
+		struct KernelData
+		{
+			const num_t *values;
+			size_t valueStride;
+			const bool *flags;
+			bool *output;
+			size_t flagStride;
+			size_t width, height;
+		};
+		typedef void (*SumThresholdKernel)(const KernelData &data, size_t length, num_t threshold);
+		
+		static void sumThresholdWithKernel(SumThresholdKernel kernel, bool vertical, Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
+		
+		/**
+		 * Scalar SumThreshold over a single row or column, performing exactly the same
+		 * floating point operations as one lane of the vectorized versions. Used by the AVX
+		 * kernels for the columns or rows that do not fill a whole vector.
+		 */
+		static void sumThresholdLine(const num_t *values, size_t valueStep, const bool *flags, bool *output, size_t flagStep, size_t n, size_t length, num_t threshold);
+		
+		static void verticalSumThresholdAVX2(const KernelData &data, size_t length, num_t threshold);
+		static void horizontalSumThresholdAVX2(const KernelData &data, size_t length, num_t threshold);
+		static void verticalSumThresholdAVX512(const KernelData &data, size_t length, num_t threshold);
+		static void horizontalSumThresholdAVX512(const KernelData &data, size_t length, num_t threshold);
 };
 
 #endif
@@ -24,6 +24,7 @@
 
 #include <AOFlagger/test/experiments/defaultstrategyspeedtest.h>
 //#include <AOFlagger/test/experiments/filterresultstest.h>
+#include <AOFlagger/test/experiments/flaggingkernelsspeedtest.h>
 #include <AOFlagger/test/experiments/highpassfilterexperiment.h>
 //#include <AOFlagger/test/experiments/scaleinvariantdilationexperiment.h>
 //#include <AOFlagger/test/experiments/rankoperatorrocexperiment.h>
@@ -37,6 +38,7 @@ class ExperimentsTestGroup : public TestGroup {
 			Add(new HighPassFilterExperiment());
 			//Add(new RankOperatorROCExperiment());
 			Add(new DefaultStrategySpeedTest());
+			Add(new FlaggingKernelsSpeedTest());
 			//Add(new FilterResultsTest());
 			//Add(new ScaleInvariantDilationExperiment());
 		}
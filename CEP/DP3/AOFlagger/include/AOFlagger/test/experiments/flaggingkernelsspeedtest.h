@@ -0,0 +1,158 @@
+/***************************************************************************
+ *   Copyright (C) 2012 by A.R. Offringa                                   *
+ *   offringa@astro.rug.nl                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef AOFLAGGER_FLAGGINGKERNELSSPEEDTEST_H
+#define AOFLAGGER_FLAGGINGKERNELSSPEEDTEST_H
+
+#include <AOFlagger/test/testingtools/asserter.h>
+#include <AOFlagger/test/testingtools/unittest.h>
+
+#include <AOFlagger/msio/image2d.h>
+#include <AOFlagger/msio/mask2d.h>
+
+#include <AOFlagger/strategy/algorithms/mitigationtester.h>
+#include <AOFlagger/strategy/algorithms/statisticalflagger.h>
+#include <AOFlagger/strategy/algorithms/thresholdconfig.h>
+#include <AOFlagger/strategy/algorithms/thresholdmitigater.h>
+
+#include <AOFlagger/util/aologger.h>
+#include <AOFlagger/util/cpufeatures.h>
+#include <AOFlagger/util/stopwatch.h>
+
+/**
+ * Times the reference, SSE, AVX2 and AVX-512 versions of the SumThreshold and dilation
+ * kernels on images of the size of a typical LOFAR baseline. Variants that the machine
+ * does not support are skipped. Run with "aotest time".
+ */
+class FlaggingKernelsSpeedTest : public UnitTest {
+	public:
+		FlaggingKernelsSpeedTest() : UnitTest("Flagging kernels speed test")
+		{
+			AddTest(TimeSumThreshold(), "Timing SumThreshold variants");
+			AddTest(TimeDilation(), "Timing dilation variants");
+		}
+		
+	private:
+		struct TimeSumThreshold : public Asserter
+		{
+			void operator()();
+		};
+		struct TimeDilation : public Asserter
+		{
+			void operator()();
+		};
+		
+		typedef void (*SumThresholdFunction)(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold);
+		typedef void (*DilationFunction)(Mask2DPtr mask, size_t size);
+		
+		/**
+		 * Runs all lengths of the default SumThreshold configuration over the image, like the
+		 * default strategy does, and returns the time it took in seconds.
+		 */
+		static double timeSumThreshold(SumThresholdFunction function, Image2DCPtr input, Mask2DCPtr mask, const ThresholdConfig &config, unsigned repeats)
+		{
+			Stopwatch watch(true);
+			for(unsigned r=0;r<repeats;++r)
+			{
+				Mask2DPtr maskCopy = Mask2D::CreateCopy(mask);
+				for(unsigned i=0;i<config.GetHorizontalOperations();++i)
+					function(input, maskCopy, config.GetHorizontalLength(i), config.GetHorizontalThreshold(i));
+			}
+			return watch.Seconds();
+		}
+		
+		static double timeDilation(DilationFunction function, Mask2DCPtr mask, size_t size, unsigned repeats)
+		{
+			Stopwatch watch(true);
+			for(unsigned r=0;r<repeats;++r)
+			{
+				Mask2DPtr maskCopy = Mask2D::CreateCopy(mask);
+				function(maskCopy, size);
+			}
+			return watch.Seconds();
+		}
+		
+		static void report(const std::string &name, double seconds, double referenceSeconds)
+		{
+			AOLogger::Info << "  " << name << ": " << seconds << " s (x" << (referenceSeconds / seconds) << ")\n";
+		}
+};
+
+inline void FlaggingKernelsSpeedTest::TimeSumThreshold::operator()()
+{
+	const size_t sizes[][2] = { { 3000, 256 }, { 10000, 256 }, { 10000, 16 }, { 1000, 2048 } };
+	const unsigned repeats = 5;
+	for(size_t s=0;s!=sizeof(sizes)/sizeof(sizes[0]);++s)
+	{
+		const size_t width = sizes[s][0], height = sizes[s][1];
+		Mask2DPtr rfi = Mask2D::CreateUnsetMaskPtr(width, height);
+		Image2DPtr input = MitigationTester::CreateTestSet(26, rfi, width, height);
+		Mask2DPtr mask = Mask2D::CreateSetMaskPtr<false>(width, height);
+		
+		ThresholdConfig config;
+		config.InitializeLengthsDefault();
+		config.InitializeThresholdsFromFirstThreshold(6.0 * input->GetMode(), ThresholdConfig::Rayleigh);
+		
+		AOLogger::Info << "SumThreshold on " << width << " x " << height << ", " << repeats << " times:\n";
+		const double
+			vReference = timeSumThreshold(&ThresholdMitigater::VerticalSumThresholdLargeReference, input, mask, config, repeats),
+			hReference = timeSumThreshold(&ThresholdMitigater::HorizontalSumThresholdLargeReference, input, mask, config, repeats);
+		report("Vertical reference", vReference, vReference);
+		report("Vertical SSE", timeSumThreshold(&ThresholdMitigater::VerticalSumThresholdLargeSSE, input, mask, config, repeats), vReference);
+		if(CPUFeatures::HasAVX2())
+			report("Vertical AVX2", timeSumThreshold(&ThresholdMitigater::VerticalSumThresholdLargeAVX2, input, mask, config, repeats), vReference);
+		if(CPUFeatures::HasAVX512F())
+			report("Vertical AVX-512", timeSumThreshold(&ThresholdMitigater::VerticalSumThresholdLargeAVX512, input, mask, config, repeats), vReference);
+		report("Horizontal reference", hReference, hReference);
+		report("Horizontal SSE", timeSumThreshold(&ThresholdMitigater::HorizontalSumThresholdLargeSSE, input, mask, config, repeats), hReference);
+		if(CPUFeatures::HasAVX2())
+			report("Horizontal AVX2", timeSumThreshold(&ThresholdMitigater::HorizontalSumThresholdLargeAVX2, input, mask, config, repeats), hReference);
+		if(CPUFeatures::HasAVX512F())
+			report("Horizontal AVX-512", timeSumThreshold(&ThresholdMitigater::HorizontalSumThresholdLargeAVX512, input, mask, config, repeats), hReference);
+	}
+}
+
+inline void FlaggingKernelsSpeedTest::TimeDilation::operator()()
+{
+	const size_t width = 10000, height = 256;
+	const size_t dilationSizes[] = { 1, 4, 32 };
+	const unsigned repeats = 10;
+	Mask2DPtr rfi = Mask2D::CreateUnsetMaskPtr(width, height);
+	MitigationTester::CreateTestSet(26, rfi, width, height);
+	for(size_t s=0;s!=sizeof(dilationSizes)/sizeof(dilationSizes[0]);++s)
+	{
+		const size_t size = dilationSizes[s];
+		AOLogger::Info << "Dilation with size " << size << " on " << width << " x " << height << ", " << repeats << " times:\n";
+		const double
+			vReference = timeDilation(&StatisticalFlagger::DilateFlagsVerticallyReference, rfi, size, repeats),
+			hReference = timeDilation(&StatisticalFlagger::DilateFlagsHorizontallyReference, rfi, size, repeats);
+		report("Vertical reference", vReference, vReference);
+		if(CPUFeatures::HasAVX2())
+			report("Vertical AVX2", timeDilation(&StatisticalFlagger::DilateFlagsVerticallyAVX2, rfi, size, repeats), vReference);
+		if(CPUFeatures::HasAVX512F())
+			report("Vertical AVX-512", timeDilation(&StatisticalFlagger::DilateFlagsVerticallyAVX512, rfi, size, repeats), vReference);
+		report("Horizontal reference", hReference, hReference);
+		if(CPUFeatures::HasAVX2())
+			report("Horizontal AVX2", timeDilation(&StatisticalFlagger::DilateFlagsHorizontallyAVX2, rfi, size, repeats), hReference);
+		if(CPUFeatures::HasAVX512F())
+			report("Horizontal AVX-512", timeDilation(&StatisticalFlagger::DilateFlagsHorizontallyAVX512, rfi, size, repeats), hReference);
+	}
+}
+
+#endif
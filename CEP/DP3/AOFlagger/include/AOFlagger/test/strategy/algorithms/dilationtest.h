@@ -27,12 +27,16 @@
 
 #include <AOFlagger/strategy/algorithms/statisticalflagger.h>
 
+#include <AOFlagger/util/cpufeatures.h>
+
 class DilationTest : public UnitTest {
 	public:
 		DilationTest() : UnitTest("Dilation algorithm")
 		{
 			AddTest(TestHorizontalDilation(), "Horizontal dilation");
 			AddTest(TestVerticalDilation(), "Vertical dilation");
+			AddTest(TestHorizontalDilationAVX(), "Horizontal dilation with AVX2 and AVX-512");
+			AddTest(TestVerticalDilationAVX(), "Vertical dilation with AVX2 and AVX-512");
 		}
 		
 	private:
@@ -49,6 +53,19 @@ class DilationTest : public UnitTest {
 		{
 			void operator()();
 		};
+		struct TestHorizontalDilationAVX : public DilationTest::TestSingleDilation
+		{
+			void operator()();
+		};
+		struct TestVerticalDilationAVX : public DilationTest::TestSingleDilation
+		{
+			void operator()();
+		};
+		struct TestLargeDilation : public Asserter
+		{
+			template<typename DilateFunction>
+			void testEqualToReference(DilateFunction dilate, DilateFunction reference, const std::string &name);
+		};
 		
 		static std::string maskToString(Mask2DCPtr mask, bool flip)
 		{
@@ -112,6 +129,64 @@ inline void DilationTest::TestVerticalDilation::operator()()
 	TestSingleDilation::testDilation<true>(StatisticalFlagger::DilateFlagsVertically);
 }
 
+inline void DilationTest::TestHorizontalDilationAVX::operator()()
+{
+	TestLargeDilation large;
+	if(CPUFeatures::HasAVX2())
+	{
+		TestSingleDilation::testDilation<false>(StatisticalFlagger::DilateFlagsHorizontallyAVX2);
+		large.testEqualToReference(StatisticalFlagger::DilateFlagsHorizontallyAVX2, StatisticalFlagger::DilateFlagsHorizontallyReference, "AVX2");
+	}
+	if(CPUFeatures::HasAVX512F())
+	{
+		TestSingleDilation::testDilation<false>(StatisticalFlagger::DilateFlagsHorizontallyAVX512);
+		large.testEqualToReference(StatisticalFlagger::DilateFlagsHorizontallyAVX512, StatisticalFlagger::DilateFlagsHorizontallyReference, "AVX-512");
+	}
+}
+
+inline void DilationTest::TestVerticalDilationAVX::operator()()
+{
+	TestLargeDilation large;
+	if(CPUFeatures::HasAVX2())
+	{
+		TestSingleDilation::testDilation<true>(StatisticalFlagger::DilateFlagsVerticallyAVX2);
+		large.testEqualToReference(StatisticalFlagger::DilateFlagsVerticallyAVX2, StatisticalFlagger::DilateFlagsVerticallyReference, "AVX2");
+	}
+	if(CPUFeatures::HasAVX512F())
+	{
+		TestSingleDilation::testDilation<true>(StatisticalFlagger::DilateFlagsVerticallyAVX512);
+		large.testEqualToReference(StatisticalFlagger::DilateFlagsVerticallyAVX512, StatisticalFlagger::DilateFlagsVerticallyReference, "AVX-512");
+	}
+}
+
+/**
+ * Compares a vectorized dilation with the reference on a mask that is larger than the
+ * vector width and not a multiple of it.
+ */
+template<typename DilateFunction>
+inline void DilationTest::TestLargeDilation::testEqualToReference(DilateFunction dilate, DilateFunction reference, const std::string &name)
+{
+	const size_t width = 301, height = 133;
+	Mask2DPtr input = Mask2D::CreateSetMaskPtr<false>(width, height);
+	for(size_t y=0;y<height;++y)
+	{
+		for(size_t x=0;x<width;++x)
+			input->SetValue(x, y, (x * 7 + y * 13) % 97 == 0);
+	}
+	const size_t sizes[] = { 1, 2, 3, 5, 16, 31, 64, 100, 200, 400 };
+	for(size_t i=0;i!=sizeof(sizes)/sizeof(sizes[0]);++i)
+	{
+		Mask2DPtr
+			expected = Mask2D::CreateCopy(input),
+			result = Mask2D::CreateCopy(input);
+		reference(expected, sizes[i]);
+		dilate(result, sizes[i]);
+		std::stringstream s;
+		s << name << " dilation equals reference with size=" << sizes[i];
+		AssertTrue(result->Equals(expected), s.str());
+	}
+}
+
 template<bool Flip, typename DilateFunction>
 inline void DilationTest::TestSingleDilation::testDilation(DilateFunction dilate)
 {
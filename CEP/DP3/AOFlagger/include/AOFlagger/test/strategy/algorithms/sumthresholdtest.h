@@ -32,12 +32,16 @@
 #include <AOFlagger/test/testingtools/maskasserter.h>
 #include <AOFlagger/test/testingtools/unittest.h>
 
+#include <AOFlagger/util/cpufeatures.h>
+
 class SumThresholdTest : public UnitTest {
 	public:
 		SumThresholdTest() : UnitTest("Sumthreshold")
 		{
 			AddTest(VerticalSumThresholdSSE(), "SumThreshold optimized SSE version (vertical)");
 			AddTest(HorizontalSumThresholdSSE(), "SumThreshold optimized SSE version (horizontal)");
+			AddTest(VerticalSumThresholdAVX(), "SumThreshold AVX2 and AVX-512 versions (vertical)");
+			AddTest(HorizontalSumThresholdAVX(), "SumThreshold AVX2 and AVX-512 versions (horizontal)");
 			AddTest(Stability(), "SumThreshold stability");
 		}
 		
@@ -50,6 +54,14 @@ class SumThresholdTest : public UnitTest {
 		{
 			void operator()();
 		};
+		struct VerticalSumThresholdAVX : public Asserter
+		{
+			void operator()();
+		};
+		struct HorizontalSumThresholdAVX : public Asserter
+		{
+			void operator()();
+		};
 		struct Stability : public Asserter
 		{
 			void operator()();
@@ -132,6 +144,114 @@ void SumThresholdTest::HorizontalSumThresholdSSE::operator()()
 	}
 }
 
+void SumThresholdTest::VerticalSumThresholdAVX::operator()()
+{
+	if(!CPUFeatures::HasAVX2())
+		return;
+	
+	// Use a size that is not a multiple of the vector width, to also test the remainders
+	const unsigned
+		width = 2045,
+		height = 253;
+	Mask2DPtr
+		mask1 = Mask2D::CreateUnsetMaskPtr(width, height),
+		mask2 = Mask2D::CreateUnsetMaskPtr(width, height),
+		mask3;
+	Image2DPtr
+		real = MitigationTester::CreateTestSet(26, mask1, width, height),
+		imag = MitigationTester::CreateTestSet(26, mask2, width, height);
+	TimeFrequencyData data(XXPolarisation, real, imag);
+	Image2DCPtr image = data.GetSingleImage();
+	
+	ThresholdConfig config;
+	config.InitializeLengthsDefault(9);
+	num_t mode = image->GetMode();
+	config.InitializeThresholdsFromFirstThreshold(6.0 * mode, ThresholdConfig::Rayleigh);
+	for(unsigned i=0;i<9;++i)
+	{
+		mask1->SetAll<false>();
+		// Start with some flags, so that flagged samples are skipped in the sums
+		for(unsigned y=0;y<height;y+=7)
+			mask1->SetHorizontalValues(0, y, true, width/3);
+		mask2 = Mask2D::CreateCopy(mask1);
+		mask3 = Mask2D::CreateCopy(mask1);
+		
+		const unsigned length = config.GetHorizontalLength(i);
+		const double threshold = config.GetHorizontalThreshold(i);
+		
+		ThresholdMitigater::VerticalSumThresholdLargeSSE(image, mask1, length, threshold);
+		ThresholdMitigater::VerticalSumThresholdLargeAVX2(image, mask2, length, threshold);
+		
+		std::stringstream s;
+		s << "Equal SSE and AVX2 masks produced by SumThreshold length " << length;
+		MaskAsserter::AssertEqualMasks(mask2, mask1, s.str());
+		
+		if(CPUFeatures::HasAVX512F())
+		{
+			ThresholdMitigater::VerticalSumThresholdLargeAVX512(image, mask3, length, threshold);
+			std::stringstream s512;
+			s512 << "Equal SSE and AVX-512 masks produced by SumThreshold length " << length;
+			MaskAsserter::AssertEqualMasks(mask3, mask1, s512.str());
+		}
+	}
+}
+
+void SumThresholdTest::HorizontalSumThresholdAVX::operator()()
+{
+	if(!CPUFeatures::HasAVX2())
+		return;
+	
+	const unsigned
+		width = 2045,
+		height = 253;
+	Mask2DPtr
+		mask1 = Mask2D::CreateUnsetMaskPtr(width, height),
+		mask2 = Mask2D::CreateUnsetMaskPtr(width, height),
+		mask3;
+	Image2DPtr
+		real = MitigationTester::CreateTestSet(26, mask1, width, height),
+		imag = MitigationTester::CreateTestSet(26, mask2, width, height);
+		
+	mask1->SwapXY();
+	mask2->SwapXY();
+	real->SwapXY();
+	imag->SwapXY();
+		
+	TimeFrequencyData data(XXPolarisation, real, imag);
+	Image2DCPtr image = data.GetSingleImage();
+
+	ThresholdConfig config;
+	config.InitializeLengthsDefault(9);
+	num_t mode = image->GetMode();
+	config.InitializeThresholdsFromFirstThreshold(6.0 * mode, ThresholdConfig::Rayleigh);
+	for(unsigned i=0;i<9;++i)
+	{
+		mask1->SetAll<false>();
+		for(unsigned y=0;y<mask1->Height();y+=7)
+			mask1->SetHorizontalValues(0, y, true, mask1->Width()/3);
+		mask2 = Mask2D::CreateCopy(mask1);
+		mask3 = Mask2D::CreateCopy(mask1);
+		
+		const unsigned length = config.GetHorizontalLength(i);
+		const double threshold = config.GetHorizontalThreshold(i);
+		
+		ThresholdMitigater::HorizontalSumThresholdLargeSSE(image, mask1, length, threshold);
+		ThresholdMitigater::HorizontalSumThresholdLargeAVX2(image, mask2, length, threshold);
+		
+		std::stringstream s;
+		s << "Equal SSE and AVX2 masks produced by SumThreshold length " << length << ", threshold " << threshold;
+		MaskAsserter::AssertEqualMasks(mask2, mask1, s.str());
+		
+		if(CPUFeatures::HasAVX512F())
+		{
+			ThresholdMitigater::HorizontalSumThresholdLargeAVX512(image, mask3, length, threshold);
+			std::stringstream s512;
+			s512 << "Equal SSE and AVX-512 masks produced by SumThreshold length " << length << ", threshold " << threshold;
+			MaskAsserter::AssertEqualMasks(mask3, mask1, s512.str());
+		}
+	}
+}
+
 void SumThresholdTest::Stability::operator()()
 {
 	Mask2DPtr
@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   Copyright (C) 2012 by A.R. Offringa                                   *
+ *   offringa@astro.rug.nl                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+/**
+ * Run-time detection of the instruction set extensions that the optimized
+ * flagging kernels can use. The SSE2 kernels are always available, because the
+ * flagger is compiled with -msse2. The AVX2 and AVX-512 kernels are compiled
+ * into separate translation units (only when the compiler supports them) and
+ * may only be called when these functions return true. Apart from asking the
+ * processor, they therefore also check that the kernels were compiled in
+ * and that the operating system saves the wide registers on a context switch.
+ *
+ * The result is determined once and cached.
+ */
+class CPUFeatures
+{
+	public:
+		/**
+		 * @returns true if the AVX2 kernels are compiled in and can be used on this machine.
+		 */
+		static bool HasAVX2() { return instance()._hasAVX2; }
+		
+		/**
+		 * @returns true if the AVX-512F kernels are compiled in and can be used on this machine.
+		 */
+		static bool HasAVX512F() { return instance()._hasAVX512F; }
+		
+	private:
+		CPUFeatures();
+		
+		static const CPUFeatures &instance()
+		{
+			static const CPUFeatures features;
+			return features;
+		}
+		
+		bool _hasAVX2, _hasAVX512F;
+};
+
+#endif
@@ -19,21 +19,115 @@
  ***************************************************************************/
 #include <AOFlagger/msio/indirectbaselinereader.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <set>
 #include <stdexcept>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <boost/filesystem.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <casa/Arrays/Slicer.h>
 
-#include <AOFlagger/msio/arraycolumniterator.h>
-#include <AOFlagger/msio/scalarcolumniterator.h>
 #include <AOFlagger/msio/timefrequencydata.h>
 #include <AOFlagger/msio/system.h>
 
 #include <AOFlagger/util/aologger.h>
 #include <AOFlagger/util/stopwatch.h>
 
-IndirectBaselineReader::IndirectBaselineReader(const std::string &msFile) : BaselineReader(msFile), _directReader(msFile), _msIsReordered(false), _removeReorderedFiles(false), _reorderedDataFilesHaveChanged(false), _reorderedFlagFilesHaveChanged(false), _maxMemoryUse(1024*1024*1024), _readUVW(false)
+/**
+ * A number of consecutive time steps as read from the measurement set, together with
+ * the staging buffers in which they are transposed to baseline-major order.
+ */
+struct IndirectBaselineReader::ReorderBlock
+{
+	size_t startTimestep, timestepCount;
+	const casa::Complex *rowData;
+	const bool *rowFlags;
+	/** For every row in the block: its baseline index and time step relative to startTimestep */
+	std::vector<size_t> rowBaselines, rowTimesteps;
+	float *dataBuffer;
+	bool *flagBuffer;
+};
+
+/**
+ * Transposes the rows of a block for a range of baselines and writes the resulting
+ * extents to the scratch file. Every worker owns a distinct range of baselines, hence
+ * distinct parts of the staging buffers and the scratch file.
+ */
+class IndirectBaselineReader::ReorderWorker
+{
+	public:
+		ReorderWorker(const IndirectBaselineReader &reader, const ReorderBlock &block, size_t firstBaseline, size_t endBaseline, int *error)
+		: _reader(reader), _block(block), _firstBaseline(firstBaseline), _endBaseline(endBaseline), _error(error)
+		{
+		}
+
+		void operator()()
+		{
+			const size_t
+				samplesPerTimestep = _reader.samplesPerTimestep(),
+				valuesPerBaseline = _block.timestepCount * samplesPerTimestep;
+
+			// Time steps that are missing for a baseline should be flagged
+			std::fill(_block.dataBuffer + _firstBaseline * valuesPerBaseline * 2, _block.dataBuffer + _endBaseline * valuesPerBaseline * 2, 0.0f);
+			std::fill(_block.flagBuffer + _firstBaseline * valuesPerBaseline, _block.flagBuffer + _endBaseline * valuesPerBaseline, true);
+
+			for(size_t row=0;row!=_block.rowBaselines.size();++row)
+			{
+				const size_t baseline = _block.rowBaselines[row];
+				if(baseline >= _firstBaseline && baseline < _endBaseline)
+				{
+					const size_t index = baseline * valuesPerBaseline + _block.rowTimesteps[row] * samplesPerTimestep;
+					memcpy(_block.dataBuffer + index * 2, _block.rowData + row * samplesPerTimestep, samplesPerTimestep * sizeof(casa::Complex));
+					memcpy(_block.flagBuffer + index, _block.rowFlags + row * samplesPerTimestep, samplesPerTimestep * sizeof(bool));
+				}
+			}
+
+			const size_t startValue = _block.startTimestep * samplesPerTimestep;
+			for(size_t baseline=_firstBaseline;baseline!=_endBaseline;++baseline)
+			{
+				if(!writeExtent(_block.dataBuffer + baseline * valuesPerBaseline * 2, valuesPerBaseline * 2 * sizeof(float), _reader.dataOffset(baseline) + startValue * 2 * sizeof(float)) ||
+					!writeExtent(_block.flagBuffer + baseline * valuesPerBaseline, valuesPerBaseline * sizeof(bool), _reader.flagOffset(baseline) + startValue * sizeof(bool)))
+				{
+					*_error = errno;
+					return;
+				}
+			}
+		}
+	private:
+		bool writeExtent(const void *buffer, size_t size, size_t offset)
+		{
+			const char *data = static_cast<const char*>(buffer);
+			while(size > 0)
+			{
+				ssize_t written = pwrite(_reader._scratchFd, data, size, offset);
+				if(written < 0)
+				{
+					if(errno == EINTR) continue;
+					return false;
+				}
+				data += written;
+				offset += written;
+				size -= written;
+			}
+			return true;
+		}
+
+		const IndirectBaselineReader &_reader;
+		const ReorderBlock &_block;
+		size_t _firstBaseline, _endBaseline;
+		int *_error;
+};
+
+IndirectBaselineReader::IndirectBaselineReader(const std::string &msFile) : BaselineReader(msFile), _directReader(msFile), _msIsReordered(false), _removeReorderedFiles(false), _reorderedDataFilesHaveChanged(false), _reorderedFlagFilesHaveChanged(false), _maxMemoryUse(1024*1024*1024), _readUVW(false), _baselineCount(0), _timestepCount(0), _frequencyCount(0), _polarizationCount(0), _scratchFd(-1), _scratchMap(0), _scratchSize(0)
 {
 	AOLogger::Debug << "Total system memory detected: " << System::TotalMemory() << '\n';
 	if(System::TotalMemory() < 3l*1024l*1024l*1024l)
@@ -49,6 +143,7 @@ IndirectBaselineReader::~IndirectBaselineReader()
 		updateOriginalMSData();
 	if(_reorderedFlagFilesHaveChanged)
 		updateOriginalMSFlags();
+	closeScratchFile();
 	removeTemporaryFiles();
 }
 
@@ -63,8 +158,9 @@ void IndirectBaselineReader::PerformReadRequests()
 	for(size_t i=0;i<_readRequests.size();++i)
 	{
 		const ReadRequest request = _readRequests[i];
+		const size_t baseline = baselineIndex(request.antenna1, request.antenna2);
 		_results.push_back(Result());
-		const size_t width = AllObservationTimes().size();
+		const size_t width = _timestepCount;
 		for(size_t p=0;p<PolarizationCount();++p)
 		{
 			if(ReadData()) {
@@ -72,10 +168,8 @@ void IndirectBaselineReader::PerformReadRequests()
 				_results[i]._imaginaryImages.push_back(Image2D::CreateZeroImagePtr(width, FrequencyCount()));
 			}
 			if(ReadFlags()) {
-				// The flags should be initialized to true, as a baseline might
-				// miss some time scans that other baselines do have, and these
-				// should be flagged.
-				_results[i]._flags.push_back(Mask2D::CreateSetMaskPtr<true>(width, FrequencyCount()));
+				// Time scans that this baseline misses were flagged during reordering
+				_results[i]._flags.push_back(Mask2D::CreateUnsetMaskPtr(width, FrequencyCount()));
 			}
 		}
 		if(_readUVW)
@@ -86,30 +180,34 @@ void IndirectBaselineReader::PerformReadRequests()
 			_results[i]._uvw.push_back(UVW(0.0, 0.0, 0.0));
 		}
 
-		const std::string dataFilename = DataFilename(request.antenna1, request.antenna2);
-		std::ifstream dataFile(dataFilename.c_str(), std::ifstream::binary);
-
-		const std::string flagFilename = FlagFilename(request.antenna1, request.antenna2);
-		std::ifstream flagFile(flagFilename.c_str(), std::ifstream::binary);
-
-		const size_t bufferSize = FrequencyCount() * PolarizationCount();
-		for(size_t x=0;x<width;++x)
+		if(ReadData())
 		{
-			float dataBuffer[bufferSize*2];
-			bool flagBuffer[bufferSize];
-			dataFile.read((char *) dataBuffer, bufferSize * sizeof(float) * 2);
-			size_t dataBufferPtr = 0;
-			flagFile.read((char *) flagBuffer, bufferSize * sizeof(bool));
-			size_t flagBufferPtr = 0;
-			for(size_t f=0;f<FrequencyCount();++f) {
-				for(size_t p=0;p<PolarizationCount();++p)
-				{
-					_results[i]._realImages[p]->SetValue(x, f, dataBuffer[dataBufferPtr]);
-					++dataBufferPtr;
-					_results[i]._imaginaryImages[p]->SetValue(x, f, dataBuffer[dataBufferPtr]);
-					++dataBufferPtr;
-					_results[i]._flags[p]->SetValue(x, f, flagBuffer[flagBufferPtr]);
-					++flagBufferPtr;
+			const float *data = dataPtr(baseline);
+			madvise(const_cast<float*>(data), dataBytesPerBaseline(), MADV_WILLNEED);
+			for(size_t x=0;x<width;++x)
+			{
+				for(size_t f=0;f<FrequencyCount();++f) {
+					for(size_t p=0;p<PolarizationCount();++p)
+					{
+						_results[i]._realImages[p]->SetValue(x, f, *data);
+						++data;
+						_results[i]._imaginaryImages[p]->SetValue(x, f, *data);
+						++data;
+					}
+				}
+			}
+		}
+		if(ReadFlags())
+		{
+			const bool *flags = flagPtr(baseline);
+			for(size_t x=0;x<width;++x)
+			{
+				for(size_t f=0;f<FrequencyCount();++f) {
+					for(size_t p=0;p<PolarizationCount();++p)
+					{
+						_results[i]._flags[p]->SetValue(x, f, *flags);
+						++flags;
+					}
 				}
 			}
 		}
@@ -129,19 +227,46 @@ void IndirectBaselineReader::PerformFlagWriteRequests()
 	_writeRequests.clear();
 }
 
+void IndirectBaselineReader::initializeLayout()
+{
+	_baselines.clear();
+	Set().GetBaselines(_baselines);
+	const size_t antennaCount = Set().AntennaCount();
+	_baselineIndices.assign(antennaCount, std::vector<size_t>(antennaCount, (size_t) -1));
+	for(size_t i=0;i!=_baselines.size();++i)
+		_baselineIndices[_baselines[i].first][_baselines[i].second] = i;
+
+	_baselineCount = _baselines.size();
+	_timestepCount = AllObservationTimes().size();
+	_frequencyCount = FrequencyCount();
+	_polarizationCount = PolarizationCount();
+	_scratchSize = _baselineCount * (dataBytesPerBaseline() + flagBytesPerBaseline());
+
+	_dataChanged.assign(_baselineCount, false);
+	_flagsChanged.assign(_baselineCount, false);
+}
+
 void IndirectBaselineReader::initializeReorderedMS()
 {
-	boost::filesystem::path path("ms-aoinfo.txt");
+	initializeLayout();
+
+	boost::filesystem::path path(infoFilename());
 	bool reorderRequired = true;
 	
-	if(boost::filesystem::exists(path))
+	if(boost::filesystem::exists(path) && boost::filesystem::exists(scratchFilename()))
 	{
 		std::ifstream str(path.string().c_str());
 		std::string name;
 		std::getline(str, name);
-		if(boost::filesystem::equivalent(boost::filesystem::path(name), Set().Location()))
+		size_t baselineCount = 0, timestepCount = 0, frequencyCount = 0, polarizationCount = 0;
+		str >> baselineCount >> timestepCount >> frequencyCount >> polarizationCount;
+		if(boost::filesystem::equivalent(boost::filesystem::path(name), Set().Location()) &&
+			baselineCount == _baselineCount && timestepCount == _timestepCount &&
+			frequencyCount == _frequencyCount && polarizationCount == _polarizationCount &&
+			boost::filesystem::file_size(scratchFilename()) == _scratchSize)
 		{
 			AOLogger::Debug << "Measurement set has already been reordered; using old temporary files.\n";
+			openScratchFile(false);
 			reorderRequired = false;
 			_msIsReordered = true;
 			_removeReorderedFiles = false;
@@ -153,190 +278,173 @@ void IndirectBaselineReader::initializeReorderedMS()
 	{
 		reorderMS();
 		std::ofstream str(path.string().c_str());
-		str << Set().Location() << '\n';
+		str << Set().Location() << '\n'
+			<< _baselineCount << ' ' << _timestepCount << ' ' << _frequencyCount << ' ' << _polarizationCount << '\n';
 	}
 }
 
 void IndirectBaselineReader::reorderMS()
 {
+	Stopwatch watch(true);
 	casa::Table &table = *Table();
 
-	casa::ROScalarColumn<double> timeColumn(*Table(), "TIME");
+	casa::ROScalarColumn<double> timeColumn(table, "TIME");
 	casa::ROArrayColumn<bool> flagColumn(table, "FLAG");
 	casa::ROScalarColumn<int> antenna1Column(table, "ANTENNA1"); 
 	casa::ROScalarColumn<int> antenna2Column(table, "ANTENNA2");
+	casa::ROArrayColumn<casa::Complex> dataColumn(table, DataColumnName());
 
-	int rowCount = table.nrow();
+	const size_t rowCount = table.nrow();
 	if(rowCount == 0)
 		throw std::runtime_error("Measurement set is empty (zero rows)");
 
-	casa::ROArrayColumn<casa::Complex> *dataColumn = new casa::ROArrayColumn<casa::Complex>(table, DataColumnName());
+	const casa::Vector<double> times = timeColumn.getColumn();
+	const casa::Vector<int>
+		antenna1s = antenna1Column.getColumn(),
+		antenna2s = antenna2Column.getColumn();
 
-	std::vector<std::pair<size_t,size_t> > baselines;
-	Set().GetBaselines(baselines);
-	size_t
-		antennaCount = Set().AntennaCount(),
-		frequencyCount = FrequencyCount(),
-		polarizationCount = PolarizationCount();
-
-	size_t bufferSize = _maxMemoryUse / (baselines.size() * frequencyCount * polarizationCount * (sizeof(float) * 2 + sizeof(bool)));
-
-	std::vector<std::vector<float *> > dataBuffers;
-	std::vector<std::vector<bool *> > flagBuffers;
-	std::vector<std::vector<std::ofstream *> > dataFiles;
-	std::vector<std::vector<std::ofstream *> > flagFiles;
-	for(size_t i=0;i<antennaCount;++i) {
-		dataBuffers.push_back(std::vector<float *>());
-		dataFiles.push_back(std::vector<std::ofstream *>());
-		flagBuffers.push_back(std::vector<bool *>());
-		flagFiles.push_back(std::vector<std::ofstream *>());
-		for(size_t j=0;j<antennaCount;++j) {
-			dataBuffers[i].push_back(0);
-			dataFiles[i].push_back(0);
-			flagBuffers[i].push_back(0);
-			flagFiles[i].push_back(0);
-		}
-	}
+	openScratchFile(true);
 
-	AOLogger::Debug << "Requesting " << (sizeof(float)*2+sizeof(bool)) << " x " << baselines.size() << " x " << bufferSize << " x " << polarizationCount << " x " << frequencyCount << " bytes of data\n";
-	for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
-	{
-		const std::string dataFilename = DataFilename(i->first, i->second);
-		const std::string flagFilename = FlagFilename(i->first, i->second);
-		dataBuffers[i->first][i->second] = new float[2 * bufferSize * frequencyCount * polarizationCount];
-		dataFiles[i->first][i->second] = new std::ofstream(dataFilename.c_str(), std::ofstream::binary);
-		if(dataFiles[i->first][i->second]->fail())
-			throw std::runtime_error("Error: failed to open temporary data files for writing! Check access rights and free disk space.");
-		flagBuffers[i->first][i->second] = new bool[bufferSize * frequencyCount * polarizationCount];
-		flagFiles[i->first][i->second] = new std::ofstream(flagFilename.c_str(), std::ofstream::binary);
-		if(flagFiles[i->first][i->second]->fail())
-			throw std::runtime_error("Error: failed to open temporary data files for writing! Check access rights and free disk space.");
-	}
+	// Both the rows read from the measurement set and the transposed staging buffers
+	// are kept in memory, hence the factor of two.
+	const size_t bytesPerTimestep = _baselineCount * samplesPerTimestep() * (sizeof(float) * 2 + sizeof(bool));
+	size_t blockTimesteps = _maxMemoryUse / (2 * bytesPerTimestep);
+	if(blockTimesteps == 0)
+		blockTimesteps = 1;
+
+	AOLogger::Debug << "Requesting " << (sizeof(float)*2+sizeof(bool)) << " x " << _baselineCount << " x " << blockTimesteps << " x " << _polarizationCount << " x " << _frequencyCount << " bytes of data\n";
+	boost::scoped_array<float> dataBuffer(new float[blockTimesteps * _baselineCount * samplesPerTimestep() * 2]);
+	boost::scoped_array<bool> flagBuffer(new bool[blockTimesteps * _baselineCount * samplesPerTimestep()]);
 
 	size_t
 		prevTimeIndex = (size_t) (-1),
-		timeIndex = 0,
-		currentBufferBlockPtr = (size_t) (-1);
+		rowIndex = 0;
 	double prevTime = -1.0;
 
-	AOLogger::Debug << 'R';
-	AOLogger::Debug.Flush();
-	for(int rowIndex = 0;rowIndex < rowCount;++rowIndex)
+	while(rowIndex < rowCount)
 	{
-		double time = timeColumn(rowIndex);
-		if(time != prevTime)
+		ReorderBlock block;
+		block.startTimestep = prevTimeIndex + 1;
+		block.dataBuffer = dataBuffer.get();
+		block.flagBuffer = flagBuffer.get();
+
+		// Collect the rows of the next blockTimesteps time steps
+		const size_t startRow = rowIndex;
+		while(rowIndex < rowCount)
 		{
-			timeIndex = AllObservationTimes().find(time)->second;
-			if(timeIndex != prevTimeIndex+1)
-			{
-				std::stringstream s;
-				s << "Error: time step " << prevTimeIndex << " is followed by time step " << timeIndex;
-				throw std::runtime_error(s.str());
-			}
-			prevTime = time;
-			prevTimeIndex = timeIndex;
-			++currentBufferBlockPtr;
-
-			if(currentBufferBlockPtr >= bufferSize)
+			const double time = times[rowIndex];
+			if(time != prevTime)
 			{
-				// buffer is full, flush
-				AOLogger::Debug << 'W';
-				AOLogger::Debug.Flush();
-				for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
+				const size_t timeIndex = AllObservationTimes().find(time)->second;
+				if(timeIndex != prevTimeIndex+1)
 				{
-					const size_t sampleCount = bufferSize * frequencyCount * polarizationCount;
-					float *dataBuffer = dataBuffers[i->first][i->second];
-					bool *flagBuffer = flagBuffers[i->first][i->second];
-					std::ofstream *dataFile = dataFiles[i->first][i->second];
-					std::ofstream *flagFile = flagFiles[i->first][i->second];
-					dataFile->write(reinterpret_cast<char*>(dataBuffer), sampleCount * 2 * sizeof(float));
-					if(dataFile->fail())
-						throw std::runtime_error("Error: failed to write temporary data files! Check access rights and free disk space.");
-					flagFile->write(reinterpret_cast<char*>(flagBuffer), sampleCount * sizeof(bool));
-					if(flagFile->fail())
-						throw std::runtime_error("Error: failed to write temporary flag files! Check access rights and free disk space.");
+					std::stringstream s;
+					s << "Error: time step " << prevTimeIndex << " is followed by time step " << timeIndex;
+					throw std::runtime_error(s.str());
 				}
-
-				AOLogger::Debug << 'R';
-				AOLogger::Debug.Flush();
-				currentBufferBlockPtr = 0;
-			}
-		}
-		
-		casa::Array<casa::Complex> data = (*dataColumn)(rowIndex);
-		casa::Array<casa::Complex>::const_iterator dataI=data.begin();
-		casa::Array<bool> flag = flagColumn(rowIndex);
-		casa::Array<bool>::const_iterator flagI=flag.begin();
-		size_t dataBufferPtr = currentBufferBlockPtr*2*frequencyCount*polarizationCount;
-		float *dataBuffer = dataBuffers[antenna1Column(rowIndex)][antenna2Column(rowIndex)];
-		size_t flagBufferPtr = currentBufferBlockPtr*frequencyCount*polarizationCount;
-		bool *flagBuffer = flagBuffers[antenna1Column(rowIndex)][antenna2Column(rowIndex)];
-		for(size_t f=0;f<frequencyCount;++f) {
-			for(size_t p=0;p<polarizationCount;++p) {
-				dataBuffer[dataBufferPtr] = dataI->real();
-				++dataBufferPtr;
-				dataBuffer[dataBufferPtr] = dataI->imag();
-				++dataI;
-				++dataBufferPtr;
-
-				flagBuffer[flagBufferPtr] = *flagI;
-				++flagBufferPtr;
-				++flagI;
+				if(timeIndex >= block.startTimestep + blockTimesteps)
+					break;
+				prevTime = time;
+				prevTimeIndex = timeIndex;
 			}
+			block.rowBaselines.push_back(baselineIndex(antenna1s[rowIndex], antenna2s[rowIndex]));
+			block.rowTimesteps.push_back(prevTimeIndex - block.startTimestep);
+			++rowIndex;
 		}
+		block.timestepCount = prevTimeIndex + 1 - block.startTimestep;
+
+		AOLogger::Debug << 'R';
+		AOLogger::Debug.Flush();
+		const casa::Slicer rowRange(casa::IPosition(1, startRow), casa::IPosition(1, rowIndex - startRow));
+		const casa::Array<casa::Complex> data = dataColumn.getColumnRange(rowRange);
+		const casa::Array<bool> flags = flagColumn.getColumnRange(rowRange);
+		bool deleteData, deleteFlags;
+		block.rowData = data.getStorage(deleteData);
+		block.rowFlags = flags.getStorage(deleteFlags);
+
+		AOLogger::Debug << 'W';
+		AOLogger::Debug.Flush();
+		reorderBlock(block);
+
+		data.freeStorage(block.rowData, deleteData);
+		flags.freeStorage(block.rowFlags, deleteFlags);
 	}
-	
-	// flush half-full buffer
-	AOLogger::Debug << "W";
-	AOLogger::Debug.Flush();
-	++currentBufferBlockPtr; // Since we have finished reading the last timestep
-	                         // the buffer contains one more
-	for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
-	{
-		const size_t sampleCount = currentBufferBlockPtr * frequencyCount * polarizationCount;
-		float *dataBuffer = dataBuffers[i->first][i->second];
-		bool *flagBuffer = flagBuffers[i->first][i->second];
-		std::ofstream *dataFile = dataFiles[i->first][i->second];
-		std::ofstream *flagFile = flagFiles[i->first][i->second];
-		dataFile->write(reinterpret_cast<char*>(dataBuffer), sampleCount * 2 * sizeof(float));
-		if(dataFile->fail())
-			throw std::runtime_error("Error: failed to write temporary data files! Check access rights and free disk space.");
-		flagFile->write(reinterpret_cast<char*>(flagBuffer), sampleCount * sizeof(bool));
-		if(flagFile->fail())
-			throw std::runtime_error("Error: failed to write temporary flag files! Check access rights and free disk space.");
-	}
-
-	for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
-	{
-		delete[] dataBuffers[i->first][i->second];
-		delete[] flagBuffers[i->first][i->second];
-		delete dataFiles[i->first][i->second];
-		delete flagFiles[i->first][i->second];
-	}
-
-	delete dataColumn;
 
 	clearTableCaches();
 
-	AOLogger::Debug << "Done reordering data set\n";
+	AOLogger::Debug << "\nDone reordering data set in " << watch.ToString() << '\n';
 	_msIsReordered = true;
 	_removeReorderedFiles = true;
 	_reorderedDataFilesHaveChanged = false;
 	_reorderedFlagFilesHaveChanged = false;
 }
 
-void IndirectBaselineReader::removeTemporaryFiles()
+void IndirectBaselineReader::reorderBlock(const ReorderBlock &block)
 {
-	if(_msIsReordered && _removeReorderedFiles)
+	const size_t threadCount = std::min<size_t>(System::ProcessorCount(), _baselineCount);
+	std::vector<int> errors(threadCount, 0);
+	boost::thread_group group;
+	for(size_t t=0;t!=threadCount;++t)
+	{
+		ReorderWorker worker(*this, block, t * _baselineCount / threadCount, (t+1) * _baselineCount / threadCount, &errors[t]);
+		group.create_thread(worker);
+	}
+	group.join_all();
+	for(size_t t=0;t!=threadCount;++t)
+	{
+		if(errors[t] != 0)
+		{
+			std::stringstream s;
+			s << "Error: failed to write temporary data file (" << strerror(errors[t]) << ")! Check access rights and free disk space.";
+			throw std::runtime_error(s.str());
+		}
+	}
+}
+
+void IndirectBaselineReader::openScratchFile(bool create)
+{
+	_scratchFd = open(scratchFilename(), create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0666);
+	if(_scratchFd < 0)
+		throw std::runtime_error("Error: failed to open temporary data file! Check access rights and free disk space.");
+	if(create && ftruncate(_scratchFd, _scratchSize) != 0)
+	{
+		closeScratchFile();
+		throw std::runtime_error("Error: failed to allocate temporary data file! Check access rights and free disk space.");
+	}
+	// The reordering pass writes with pwrite() while the file is already mapped; this
+	// is coherent, as both go through the same page cache.
+	if(_scratchSize != 0)
 	{
-		boost::filesystem::remove("ms-aoinfo.txt");
-		std::vector<std::pair<size_t,size_t> > baselines;
-		Set().GetBaselines(baselines);
-		for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
+		void *map = mmap(0, _scratchSize, PROT_READ | PROT_WRITE, MAP_SHARED, _scratchFd, 0);
+		if(map == MAP_FAILED)
 		{
-			boost::filesystem::remove(DataFilename(i->first, i->second));
-			boost::filesystem::remove(FlagFilename(i->first, i->second));
+			closeScratchFile();
+			throw std::runtime_error("Error: failed to memory map the temporary data file!");
 		}
+		_scratchMap = static_cast<char*>(map);
+	}
+}
+
+void IndirectBaselineReader::closeScratchFile()
+{
+	if(_scratchMap != 0)
+	{
+		munmap(_scratchMap, _scratchSize);
+		_scratchMap = 0;
+	}
+	if(_scratchFd >= 0)
+	{
+		close(_scratchFd);
+		_scratchFd = -1;
+	}
+}
+
+void IndirectBaselineReader::removeTemporaryFiles()
+{
+	if(_msIsReordered && _removeReorderedFiles)
+	{
+		boost::filesystem::remove(infoFilename());
+		boost::filesystem::remove(scratchFilename());
 		AOLogger::Debug << "Temporary files removed.\n";
 	}
 	_msIsReordered = false;
@@ -365,32 +473,36 @@ void IndirectBaselineReader::PerformDataWriteTask(std::vector<Image2DCPtr> _real
 	if(!_msIsReordered) initializeReorderedMS();
 	
 	const size_t width = _realImages[0]->Width();
-	const size_t bufferSize = FrequencyCount() * PolarizationCount();
+	if(width > _timestepCount)
+		throw std::runtime_error("PerformDataWriteTask: input images have more time steps than the measurement set");
 	
-	const std::string dataFilename = DataFilename(antenna1, antenna2);
-	std::ofstream dataFile(dataFilename.c_str(), std::ofstream::binary | std::ofstream::trunc);
-		
+	const size_t baseline = baselineIndex(antenna1, antenna2);
+	float *data = dataPtr(baseline);
+	bool changed = false;
 	for(size_t x=0;x<width;++x)
 	{
-		float dataBuffer[bufferSize*2];
-		
-		size_t dataBufferPtr = 0;
 		for(size_t f=0;f<FrequencyCount();++f) {
 			for(size_t p=0;p<PolarizationCount();++p)
 			{
-				dataBuffer[dataBufferPtr] = _realImages[p]->Value(x, f);
-				++dataBufferPtr;
-				dataBuffer[dataBufferPtr] = _imaginaryImages[p]->Value(x, f);
-				++dataBufferPtr;
+				const float
+					real = _realImages[p]->Value(x, f),
+					imaginary = _imaginaryImages[p]->Value(x, f);
+				if(data[0] != real || data[1] != imaginary)
+				{
+					data[0] = real;
+					data[1] = imaginary;
+					changed = true;
+				}
+				data += 2;
 			}
 		}
-
-		dataFile.write(reinterpret_cast<char*>(dataBuffer), bufferSize * sizeof(float) * 2);
-		if(dataFile.bad())
-			throw std::runtime_error("Error: failed to update temporary data files! Check access rights and free disk space.");
 	}
 	
-	_reorderedDataFilesHaveChanged = true;
+	if(changed)
+	{
+		_dataChanged[baseline] = true;
+		_reorderedDataFilesHaveChanged = true;
+	}
 	
 	AOLogger::Debug << "Done writing.\n";
 }
@@ -413,30 +525,33 @@ void IndirectBaselineReader::performFlagWriteTask(std::vector<Mask2DCPtr> flags,
 	if(!_msIsReordered) initializeReorderedMS();
 	
 	const size_t width = flags[0]->Width();
-	const size_t bufferSize = FrequencyCount() * PolarizationCount();
-	
-	const std::string flagFilename = FlagFilename(antenna1, antenna2);
-	std::ofstream flagFile(flagFilename.c_str(), std::ofstream::binary | std::ofstream::trunc);
+	if(width > _timestepCount)
+		throw std::runtime_error("PerformFlagWriteTask: input masks have more time steps than the measurement set");
 	
+	const size_t baseline = baselineIndex(antenna1, antenna2);
+	bool *flagValues = flagPtr(baseline);
+	bool changed = false;
 	for(size_t x=0;x<width;++x)
 	{
-		bool flagBuffer[bufferSize];
-		
-		size_t flagBufferPtr = 0;
 		for(size_t f=0;f<FrequencyCount();++f) {
 			for(size_t p=0;p<PolarizationCount();++p)
 			{
-				flagBuffer[flagBufferPtr] = flags[p]->Value(x, f);
-				++flagBufferPtr;
+				const bool flag = flags[p]->Value(x, f);
+				if(*flagValues != flag)
+				{
+					*flagValues = flag;
+					changed = true;
+				}
+				++flagValues;
 			}
 		}
-
-		flagFile.write(reinterpret_cast<char*>(flagBuffer), bufferSize * sizeof(bool));
-		if(flagFile.bad())
-			throw std::runtime_error("Error: failed to update temporary flag files! Check access rights and free disk space.");
 	}
 	
-	_reorderedFlagFilesHaveChanged = true;
+	if(changed)
+	{
+		_flagsChanged[baseline] = true;
+		_reorderedFlagFilesHaveChanged = true;
+	}
 }
 
 template<bool UpdateData, bool UpdateFlags>
@@ -444,103 +559,30 @@ void IndirectBaselineReader::updateOriginalMS()
 {
 	casa::Table &table = *Table();
 
-	casa::ROScalarColumn<double> timeColumn(*Table(), "TIME");
+	casa::ROScalarColumn<double> timeColumn(table, "TIME");
 	casa::ROScalarColumn<int> antenna1Column(table, "ANTENNA1"); 
 	casa::ROScalarColumn<int> antenna2Column(table, "ANTENNA2");
 	casa::ArrayColumn<bool> flagColumn(table, "FLAG");
-	casa::ArrayColumn<casa::Complex> *dataColumn = new casa::ArrayColumn<casa::Complex>(table, DataColumnName());
-
-	int rowCount = table.nrow();
+	casa::ArrayColumn<casa::Complex> dataColumn(table, DataColumnName());
 
-	std::vector<std::pair<size_t,size_t> > baselines;
-	Set().GetBaselines(baselines);
-	size_t
-		antennaCount = Set().AntennaCount(),
-		frequencyCount = FrequencyCount(),
-		polarizationCount = PolarizationCount();
-
-	// Initialize data buffer and files for reading
-	size_t bufferSize = _maxMemoryUse / (baselines.size() * frequencyCount * polarizationCount * (sizeof(float) * 2 + sizeof(bool)));
-	std::vector<std::vector<float *> > dataBuffers;
-	std::vector<std::vector<std::ifstream *> > dataFiles;
-	std::vector<std::vector<bool *> > flagBuffers;
-	std::vector<std::vector<std::ifstream *> > flagFiles;
-	for(size_t i=0;i<antennaCount;++i) {
-		if(UpdateData)
-		{
-			dataBuffers.push_back(std::vector<float *>());
-			dataFiles.push_back(std::vector<std::ifstream *>());
-			for(size_t j=0;j<antennaCount;++j) {
-				dataBuffers[i].push_back(0);
-				dataFiles[i].push_back(0);
-			}
-		}
-		if(UpdateFlags)
-		{
-			flagBuffers.push_back(std::vector<bool *>());
-			flagFiles.push_back(std::vector<std::ifstream *>());
-			for(size_t j=0;j<antennaCount;++j) {
-				flagBuffers[i].push_back(0);
-				flagFiles[i].push_back(0);
-			}
-		}
-	}
+	std::vector<bool> &changed = UpdateData ? _dataChanged : _flagsChanged;
+	AOLogger::Debug << "Writing " << std::count(changed.begin(), changed.end(), true) << " of " << _baselineCount << " baselines back to the measurement set\n";
 
-	AOLogger::Debug << "Requesting " << (sizeof(float)*2+sizeof(bool)) << " x " << baselines.size() << " x " << bufferSize << " x " << polarizationCount << " x " << frequencyCount << " bytes of data\n";
-	for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
-	{
-		if(UpdateData)
-		{
-			const std::string dataFilename = DataFilename(i->first, i->second);
-			dataBuffers[i->first][i->second] = new float[2 * bufferSize * frequencyCount * polarizationCount];
-			dataFiles[i->first][i->second] = new std::ifstream(dataFilename.c_str(), std::ifstream::binary);
-		}
-		if(UpdateFlags)
-		{
-			const std::string flagFilename = FlagFilename(i->first, i->second);
-			flagBuffers[i->first][i->second] = new bool[bufferSize * frequencyCount * polarizationCount];
-			flagFiles[i->first][i->second] = new std::ifstream(flagFilename.c_str(), std::ifstream::binary);
-		}
-	}
+	const size_t rowCount = table.nrow();
+	const casa::Vector<double> times = timeColumn.getColumn();
+	const casa::Vector<int>
+		antenna1s = antenna1Column.getColumn(),
+		antenna2s = antenna2Column.getColumn();
+	const casa::IPosition shape(2, _polarizationCount, _frequencyCount);
 
-	// read first chunk
-	AOLogger::Debug << 'R';
-	AOLogger::Debug.Flush();
-	for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
-	{
-		const size_t sampleCount = bufferSize * frequencyCount * polarizationCount;
-		if(UpdateData)
-		{
-			float *dataBuffer = dataBuffers[i->first][i->second];
-			std::ifstream *dataFile = dataFiles[i->first][i->second];
-			if(dataFile->fail())
-				throw std::runtime_error("Error: failed to read temporary data files!");
-			dataFile->read(reinterpret_cast<char*>(dataBuffer), sampleCount * 2 * sizeof(float));
-		}
-		if(UpdateFlags)
-		{
-			bool *flagBuffer = flagBuffers[i->first][i->second];
-			std::ifstream *flagFile = flagFiles[i->first][i->second];
-			if(flagFile->fail())
-				throw std::runtime_error("Error: failed to read temporary data files!");
-			flagFile->read(reinterpret_cast<char*>(flagBuffer), sampleCount * sizeof(bool));
-		}
-	}
-	
-	AOLogger::Debug << 'W';
-	AOLogger::Debug.Flush();
-	
 	size_t
 		prevTimeIndex = (size_t) (-1),
-		timeIndex = 0,
-		currentBufferBlockPtr = (size_t) (-1);
+		timeIndex = 0;
 	double prevTime = -1.0;
 	
-	// This loop writes the chunks back to the MS and then reads the next chunks from the reordered file.
-	for(int rowIndex = 0;rowIndex < rowCount;++rowIndex)
+	for(size_t rowIndex = 0;rowIndex < rowCount;++rowIndex)
 	{
-		// We only read entire time steps at a time, so as long as time does not change, don't check if buffer is empty
-		double time = timeColumn(rowIndex);
+		const double time = times[rowIndex];
 		if(time != prevTime)
 		{
 			// This row has a different time value, so search it up in the index table and do sanity check
@@ -553,89 +595,27 @@ void IndirectBaselineReader::updateOriginalMS()
 			}
 			prevTime = time;
 			prevTimeIndex = timeIndex;
-			++currentBufferBlockPtr;
-
-			if(currentBufferBlockPtr >= bufferSize)
-			{
-				// entire buffer was written to MS, read next chunk from reordered files
-				AOLogger::Debug << 'R';
-				AOLogger::Debug.Flush();
-				for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
-				{
-					const size_t sampleCount = bufferSize * frequencyCount * polarizationCount;
-					if(UpdateData)
-					{
-						float *dataBuffer = dataBuffers[i->first][i->second];
-						std::ifstream *dataFile = dataFiles[i->first][i->second];
-						if(dataFile->fail())
-							throw std::runtime_error("Error: failed to read temporary data files!");
-						dataFile->read(reinterpret_cast<char*>(dataBuffer), sampleCount * 2 * sizeof(float));
-					}
-					if(UpdateFlags)
-					{
-						bool *flagBuffer = flagBuffers[i->first][i->second];
-						std::ifstream *flagFile = flagFiles[i->first][i->second];
-						if(flagFile->fail())
-							throw std::runtime_error("Error: failed to read temporary flag files!");
-						flagFile->read(reinterpret_cast<char*>(flagBuffer), sampleCount * sizeof(bool));
-					}
-				}
-
-				AOLogger::Debug << 'W';
-				AOLogger::Debug.Flush();
-				currentBufferBlockPtr = 0;
-			}
 		}
 		
-		// Write the current row
+		const size_t baseline = baselineIndex(antenna1s[rowIndex], antenna2s[rowIndex]);
+		if(!changed[baseline])
+			continue;
+
+		// The arrays share their storage with the mapped scratch file, so no copy is made
+		const size_t sampleIndex = timeIndex * samplesPerTimestep();
 		if(UpdateData)
 		{
-			casa::Array<casa::Complex> data = (*dataColumn)(rowIndex);
-			casa::Array<casa::Complex>::iterator dataIter=data.begin();
-			size_t dataBufferPtr = currentBufferBlockPtr*2*frequencyCount*polarizationCount;
-			const float *dataBuffer = dataBuffers[antenna1Column(rowIndex)][antenna2Column(rowIndex)];
-			for(size_t f=0;f<frequencyCount;++f) {
-				for(size_t p=0;p<polarizationCount;++p) {
-					(*dataIter) = casa::Complex(dataBuffer[dataBufferPtr], dataBuffer[dataBufferPtr+1]);
-					++dataIter;
-					dataBufferPtr += 2;
-				}
-			}
-			dataColumn->basePut(rowIndex, data);
+			casa::Array<casa::Complex> data(shape, reinterpret_cast<casa::Complex*>(dataPtr(baseline) + sampleIndex * 2), casa::SHARE);
+			dataColumn.put(rowIndex, data);
 		}
 		if(UpdateFlags)
 		{
-			casa::Array<bool> flagArray = flagColumn(rowIndex);
-			casa::Array<bool>::iterator flagIter=flagArray.begin();
-			size_t flagBufferPtr = currentBufferBlockPtr*frequencyCount*polarizationCount;
-			const bool *flagBuffer = flagBuffers[antenna1Column(rowIndex)][antenna2Column(rowIndex)];
-			for(size_t f=0;f<frequencyCount;++f) {
-				for(size_t p=0;p<polarizationCount;++p) {
-					(*flagIter) = flagBuffer[flagBufferPtr];
-					++flagIter;
-					++flagBufferPtr;
-				}
-			}
-			flagColumn.basePut(rowIndex, flagArray);
+			casa::Array<bool> flagArray(shape, flagPtr(baseline) + sampleIndex, casa::SHARE);
+			flagColumn.put(rowIndex, flagArray);
 		}
 	}
 	
-	AOLogger::Debug << "\nFreeing the data\n";
-	for(std::vector<std::pair<size_t,size_t> >::const_iterator i=baselines.begin();i<baselines.end();++i)
-	{
-		if(UpdateData)
-		{
-			delete[] dataBuffers[i->first][i->second];
-			delete dataFiles[i->first][i->second];
-		}
-		if(UpdateFlags)
-		{
-			delete[] flagBuffers[i->first][i->second];
-			delete flagFiles[i->first][i->second];
-		}
-	}
-
-	delete dataColumn;
+	changed.assign(_baselineCount, false);
 
 	clearTableCaches();
 
@@ -0,0 +1,136 @@
+/***************************************************************************
+ *   Copyright (C) 2012 by A.R. Offringa                                   *
+ *   offringa@astro.rug.nl                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdint.h>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include <AOFlagger/strategy/algorithms/statisticalflagger.h>
+
+/**
+ * @file
+ * AVX2 versions of the dilation in StatisticalFlagger. This file is compiled with -mavx2, and
+ * its functions may only be called when CPUFeatures::HasAVX2() returns true. Only plain
+ * pointers are used here, see ThresholdMitigater::KernelData for the reason.
+ */
+
+/**
+ * Dilating with size s sets each flag to the OR of the 2s+1 flags around it. The row is copied
+ * into a zero-padded buffer, in which an OR over windows of 2^k flags is built by repeatedly
+ * OR-ing the buffer with itself shifted by 1, 2, 4, ... positions. The window of 2s+1 flags is
+ * then the OR of two such (overlapping) windows. Each step processes 32 flags at a time.
+ */
+void StatisticalFlagger::dilateFlagsHorizontallyAVX2(bool *values, size_t stride, size_t width, size_t height, size_t size)
+{
+	const size_t windowLength = 2 * size + 1;
+	size_t span = 1;
+	while(span * 2 <= windowLength)
+		span *= 2;
+	const size_t
+		bufferSize = ((width + 3 * size + 96) / 32 + 1) * 32,
+		orRange = width + size;
+	bool *buffer = static_cast<bool*>(_mm_malloc(bufferSize, 32));
+	
+	for(size_t y=0;y<height;++y)
+	{
+		bool *row = values + y * stride;
+		memset(buffer, 0, bufferSize);
+		memcpy(buffer + size, row, width * sizeof(bool));
+		
+		// After the pass with shift p, buffer[i] holds the OR of buffer[i .. i+2p-1]. Every
+		// chunk reads the unmodified values to its right before it is stored.
+		for(size_t shift=1;shift<span;shift*=2)
+		{
+			for(size_t i=0;i<orRange;i+=32)
+			{
+				const __m256i
+					a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i)),
+					b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i + shift));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(buffer + i), _mm256_or_si256(a, b));
+			}
+		}
+		
+		// Flag x is dilated from buffer positions x .. x+windowLength-1
+		const size_t secondOffset = windowLength - span;
+		for(size_t x=0;x<width;x+=32)
+		{
+			const __m256i result = _mm256_or_si256(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + x)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + x + secondOffset)));
+			if(x + 32 <= width)
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x), result);
+			else {
+				bool tail[32];
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(tail), result);
+				memcpy(row + x, tail, (width - x) * sizeof(bool));
+			}
+		}
+	}
+	_mm_free(buffer);
+}
+
+/**
+ * The vertical dilation keeps, for each column, the number of flags within the window around
+ * the current row, and goes through the mask row by row, adding the row that enters and
+ * subtracting the row that leaves the window. Eight columns are processed at a time.
+ */
+void StatisticalFlagger::dilateFlagsVerticallyAVX2(const bool *input, bool *output, size_t stride, size_t width, size_t height, size_t size)
+{
+	const size_t vectorWidth = width - width % 8;
+	int32_t *counts = static_cast<int32_t*>(_mm_malloc((width + 8) * sizeof(int32_t), 32));
+	for(size_t x=0;x<width;++x)
+		counts[x] = 0;
+	
+	for(size_t y=0;y<size;++y)
+	{
+		const bool *row = input + y * stride;
+		for(size_t x=0;x<width;++x)
+			counts[x] += row[x] ? 1 : 0;
+	}
+	
+	const __m256i ones = _mm256_set1_epi32(1);
+	for(size_t y=0;y<height;++y)
+	{
+		const bool
+			*enteringRow = (y + size < height) ? input + (y + size) * stride : 0,
+			*leavingRow = (y > size) ? input + (y - size - 1) * stride : 0;
+		bool *outputRow = output + y * stride;
+		for(size_t x=0;x<vectorWidth;x+=8)
+		{
+			__m256i count = _mm256_load_si256(reinterpret_cast<const __m256i*>(counts + x));
+			if(enteringRow != 0)
+				count = _mm256_add_epi32(count, _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(enteringRow + x))));
+			if(leavingRow != 0)
+				count = _mm256_sub_epi32(count, _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(leavingRow + x))));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(counts + x), count);
+			
+			const __m256i flags = _mm256_min_epi32(count, ones);
+			const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(flags), _mm256_extracti128_si256(flags, 1));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(outputRow + x), _mm_packs_epi16(words, words));
+		}
+		for(size_t x=vectorWidth;x<width;++x)
+		{
+			if(enteringRow != 0 && enteringRow[x]) ++counts[x];
+			if(leavingRow != 0 && leavingRow[x]) --counts[x];
+			outputRow[x] = counts[x] > 0;
+		}
+	}
+	_mm_free(counts);
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   Copyright (C) 2012 by A.R. Offringa                                   *
+ *   offringa@astro.rug.nl                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdint.h>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include <AOFlagger/strategy/algorithms/statisticalflagger.h>
+
+/**
+ * @file
+ * AVX-512 versions of the dilation in StatisticalFlagger. This file is compiled with
+ * -mavx512f, and its functions may only be called when CPUFeatures::HasAVX512F() returns
+ * true. The algorithms are the same as in statisticalflagger-avx2.cpp.
+ */
+
+void StatisticalFlagger::dilateFlagsHorizontallyAVX512(bool *values, size_t stride, size_t width, size_t height, size_t size)
+{
+	const size_t windowLength = 2 * size + 1;
+	size_t span = 1;
+	while(span * 2 <= windowLength)
+		span *= 2;
+	const size_t
+		bufferSize = ((width + 3 * size + 192) / 64 + 1) * 64,
+		orRange = width + size;
+	bool *buffer = static_cast<bool*>(_mm_malloc(bufferSize, 64));
+	
+	for(size_t y=0;y<height;++y)
+	{
+		bool *row = values + y * stride;
+		memset(buffer, 0, bufferSize);
+		memcpy(buffer + size, row, width * sizeof(bool));
+		
+		for(size_t shift=1;shift<span;shift*=2)
+		{
+			for(size_t i=0;i<orRange;i+=64)
+			{
+				const __m512i
+					a = _mm512_loadu_si512(buffer + i),
+					b = _mm512_loadu_si512(buffer + i + shift);
+				_mm512_storeu_si512(buffer + i, _mm512_or_si512(a, b));
+			}
+		}
+		
+		const size_t secondOffset = windowLength - span;
+		for(size_t x=0;x<width;x+=64)
+		{
+			const __m512i result = _mm512_or_si512(
+				_mm512_loadu_si512(buffer + x),
+				_mm512_loadu_si512(buffer + x + secondOffset));
+			if(x + 64 <= width)
+				_mm512_storeu_si512(row + x, result);
+			else {
+				bool tail[64];
+				_mm512_storeu_si512(tail, result);
+				memcpy(row + x, tail, (width - x) * sizeof(bool));
+			}
+		}
+	}
+	_mm_free(buffer);
+}
+
+void StatisticalFlagger::dilateFlagsVerticallyAVX512(const bool *input, bool *output, size_t stride, size_t width, size_t height, size_t size)
+{
+	const size_t vectorWidth = width - width % 16;
+	int32_t *counts = static_cast<int32_t*>(_mm_malloc((width + 16) * sizeof(int32_t), 64));
+	for(size_t x=0;x<width;++x)
+		counts[x] = 0;
+	
+	for(size_t y=0;y<size;++y)
+	{
+		const bool *row = input + y * stride;
+		for(size_t x=0;x<width;++x)
+			counts[x] += row[x] ? 1 : 0;
+	}
+	
+	const __m512i ones = _mm512_set1_epi32(1);
+	for(size_t y=0;y<height;++y)
+	{
+		const bool
+			*enteringRow = (y + size < height) ? input + (y + size) * stride : 0,
+			*leavingRow = (y > size) ? input + (y - size - 1) * stride : 0;
+		bool *outputRow = output + y * stride;
+		for(size_t x=0;x<vectorWidth;x+=16)
+		{
+			__m512i count = _mm512_load_si512(counts + x);
+			if(enteringRow != 0)
+				count = _mm512_add_epi32(count, _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(enteringRow + x))));
+			if(leavingRow != 0)
+				count = _mm512_sub_epi32(count, _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(leavingRow + x))));
+			_mm512_store_si512(counts + x, count);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outputRow + x), _mm512_cvtepi32_epi8(_mm512_min_epi32(count, ones)));
+		}
+		for(size_t x=vectorWidth;x<width;++x)
+		{
+			if(enteringRow != 0 && enteringRow[x]) ++counts[x];
+			if(leavingRow != 0 && leavingRow[x]) --counts[x];
+			outputRow[x] = counts[x] > 0;
+		}
+	}
+	_mm_free(counts);
+}
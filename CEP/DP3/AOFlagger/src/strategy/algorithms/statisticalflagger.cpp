@@ -74,7 +74,7 @@ void StatisticalFlagger::EnlargeFlags(Mask2DPtr mask, size_t timeSize, size_t fr
 	}
 }
 
-void StatisticalFlagger::DilateFlagsHorizontally(Mask2DPtr mask, size_t timeSize)
+void StatisticalFlagger::DilateFlagsHorizontallyReference(Mask2DPtr mask, size_t timeSize)
 {
 	if(timeSize != 0)
 	{
@@ -118,7 +118,7 @@ void StatisticalFlagger::DilateFlagsHorizontally(Mask2DPtr mask, size_t timeSize
 	}
 }
 
-void StatisticalFlagger::DilateFlagsVertically(Mask2DPtr mask, size_t frequencySize)
+void StatisticalFlagger::DilateFlagsVerticallyReference(Mask2DPtr mask, size_t frequencySize)
 {
 	if(frequencySize != 0)
 	{
@@ -162,6 +162,62 @@ void StatisticalFlagger::DilateFlagsVertically(Mask2DPtr mask, size_t frequencyS
 	}
 }
 
+void StatisticalFlagger::dilateHorizontallyWithKernel(HorizontalDilationKernel kernel, Mask2DPtr mask, size_t timeSize)
+{
+	if(timeSize != 0 && mask->Width() != 0 && mask->Height() != 0)
+	{
+		if(timeSize > mask->Width()) timeSize = mask->Width();
+		kernel(mask->ValuePtr(0, 0), mask->Stride(), mask->Width(), mask->Height(), timeSize);
+	}
+}
+
+void StatisticalFlagger::dilateVerticallyWithKernel(VerticalDilationKernel kernel, Mask2DPtr mask, size_t frequencySize)
+{
+	if(frequencySize != 0 && mask->Width() != 0 && mask->Height() != 0)
+	{
+		Mask2DPtr destination = Mask2D::CreateUnsetMaskPtr(mask->Width(), mask->Height());
+		if(frequencySize > mask->Height()) frequencySize = mask->Height();
+		kernel(mask->ValuePtr(0, 0), destination->ValuePtr(0, 0), mask->Stride(), mask->Width(), mask->Height(), frequencySize);
+		mask->Swap(destination);
+	}
+}
+
+void StatisticalFlagger::DilateFlagsHorizontallyAVX2(Mask2DPtr mask, size_t timeSize)
+{
+#ifdef HAVE_AVX2
+	dilateHorizontallyWithKernel(&dilateFlagsHorizontallyAVX2, mask, timeSize);
+#else
+	DilateFlagsHorizontallyReference(mask, timeSize);
+#endif
+}
+
+void StatisticalFlagger::DilateFlagsVerticallyAVX2(Mask2DPtr mask, size_t frequencySize)
+{
+#ifdef HAVE_AVX2
+	dilateVerticallyWithKernel(&dilateFlagsVerticallyAVX2, mask, frequencySize);
+#else
+	DilateFlagsVerticallyReference(mask, frequencySize);
+#endif
+}
+
+void StatisticalFlagger::DilateFlagsHorizontallyAVX512(Mask2DPtr mask, size_t timeSize)
+{
+#ifdef HAVE_AVX512F
+	dilateHorizontallyWithKernel(&dilateFlagsHorizontallyAVX512, mask, timeSize);
+#else
+	DilateFlagsHorizontallyAVX2(mask, timeSize);
+#endif
+}
+
+void StatisticalFlagger::DilateFlagsVerticallyAVX512(Mask2DPtr mask, size_t frequencySize)
+{
+#ifdef HAVE_AVX512F
+	dilateVerticallyWithKernel(&dilateFlagsVerticallyAVX512, mask, frequencySize);
+#else
+	DilateFlagsVerticallyAVX2(mask, frequencySize);
+#endif
+}
+
 void StatisticalFlagger::LineRemover(Mask2DPtr mask, size_t maxTimeContamination, size_t maxFreqContamination)
 {
 	for(size_t x=0;x<mask->Width();++x)
@@ -0,0 +1,274 @@
+/***************************************************************************
+ *   Copyright (C) 2012 by A.R. Offringa                                   *
+ *   offringa@astro.rug.nl                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdint.h>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include <AOFlagger/strategy/algorithms/thresholdmitigater.h>
+
+/**
+ * @file
+ * AVX2 versions of the SumThreshold algorithm. This file is compiled with -mavx2, and its
+ * functions may only be called when CPUFeatures::HasAVX2() returns true. Only plain pointers
+ * are used here (see ThresholdMitigater::KernelData).
+ *
+ * Each lane performs the same single precision operations in the same order as the SSE
+ * version (add the new sample, test, subtract the old sample), so the results are identical.
+ */
+
+namespace {
+
+	/**
+	 * Returns 0xFFFFFFFF for each of the eight bools that is false, 0 otherwise.
+	 */
+	inline __m256i unflaggedCondition(const bool *flags)
+	{
+		return _mm256_cmpeq_epi32(
+			_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(flags))),
+			_mm256_setzero_si256());
+	}
+	
+	/**
+	 * Converts eight 32-bit comparison results into eight bools.
+	 */
+	inline uint64_t conditionToBools(__m256 condition)
+	{
+		const __m256i c = _mm256_castps_si256(condition);
+		const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(c), _mm256_extracti128_si256(c, 1));
+		const __m128i bytes = _mm_and_si128(_mm_packs_epi16(words, words), _mm_set1_epi8(1));
+		return _mm_cvtsi128_si64(bytes);
+	}
+	
+	inline void transpose8x8(__m256 *r)
+	{
+		const __m256
+			t0 = _mm256_unpacklo_ps(r[0], r[1]),
+			t1 = _mm256_unpackhi_ps(r[0], r[1]),
+			t2 = _mm256_unpacklo_ps(r[2], r[3]),
+			t3 = _mm256_unpackhi_ps(r[2], r[3]),
+			t4 = _mm256_unpacklo_ps(r[4], r[5]),
+			t5 = _mm256_unpackhi_ps(r[4], r[5]),
+			t6 = _mm256_unpacklo_ps(r[6], r[7]),
+			t7 = _mm256_unpackhi_ps(r[6], r[7]);
+		const __m256
+			s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+			s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+			s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+			s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+			s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)),
+			s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2)),
+			s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)),
+			s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+		r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+		r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+		r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+		r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+		r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+		r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+		r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+		r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+	}
+}
+
+/**
+ * The vertical version runs over the image row by row and keeps the sums and counts
+ * of all columns in a buffer. Compared to walking down each group of columns, as the
+ * SSE version does, this reads the image in memory order.
+ */
+void ThresholdMitigater::verticalSumThresholdAVX2(const KernelData &data, size_t length, num_t threshold)
+{
+	const size_t vectorWidth = data.width - data.width % 8;
+	num_t *sums = static_cast<num_t*>(_mm_malloc((vectorWidth + 8) * sizeof(num_t), 32));
+	int32_t *counts = static_cast<int32_t*>(_mm_malloc((vectorWidth + 8) * sizeof(int32_t), 32));
+	for(size_t x=0;x<vectorWidth;++x)
+	{
+		sums[x] = 0.0;
+		counts[x] = 0;
+	}
+	const __m256 thresholdPos = _mm256_set1_ps(threshold);
+	const __m256 thresholdNeg = _mm256_set1_ps(-threshold);
+	
+	size_t yBottom;
+	for(yBottom=0;yBottom<length-1;++yBottom)
+	{
+		const num_t *values = data.values + yBottom * data.valueStride;
+		const bool *flags = data.flags + yBottom * data.flagStride;
+		for(size_t x=0;x<vectorWidth;x+=8)
+		{
+			const __m256i condition = unflaggedCondition(flags + x);
+			const __m256 v = _mm256_and_ps(_mm256_loadu_ps(values + x), _mm256_castsi256_ps(condition));
+			_mm256_store_ps(sums + x, _mm256_add_ps(_mm256_load_ps(sums + x), v));
+			// condition is -1 for unflagged samples
+			_mm256_store_si256(reinterpret_cast<__m256i*>(counts + x),
+				_mm256_sub_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(counts + x)), condition));
+		}
+	}
+	
+	size_t yTop = 0;
+	while(yBottom < data.height)
+	{
+		const num_t
+			*bottomValues = data.values + yBottom * data.valueStride,
+			*topValues = data.values + yTop * data.valueStride;
+		const bool
+			*bottomFlags = data.flags + yBottom * data.flagStride,
+			*topFlags = data.flags + yTop * data.flagStride;
+		for(size_t x=0;x<vectorWidth;x+=8)
+		{
+			__m256 sum = _mm256_load_ps(sums + x);
+			__m256i count = _mm256_load_si256(reinterpret_cast<const __m256i*>(counts + x));
+			
+			// ** Add the samples at the bottom **
+			__m256i condition = unflaggedCondition(bottomFlags + x);
+			sum = _mm256_add_ps(sum, _mm256_and_ps(_mm256_loadu_ps(bottomValues + x), _mm256_castsi256_ps(condition)));
+			count = _mm256_sub_epi32(count, condition);
+			
+			// ** Check sum **
+			const __m256 avg = _mm256_div_ps(sum, _mm256_cvtepi32_ps(count));
+			const __m256 flagConditions = _mm256_or_ps(
+				_mm256_cmp_ps(avg, thresholdPos, _CMP_GT_OQ),
+				_mm256_cmp_ps(avg, thresholdNeg, _CMP_LT_OQ));
+			if(_mm256_movemask_ps(flagConditions) != 0)
+			{
+				const uint64_t outputValues = conditionToBools(flagConditions);
+				for(size_t i=0;i<length;++i)
+				{
+					bool *outputPtr = data.output + (yTop + i) * data.flagStride + x;
+					uint64_t current;
+					memcpy(&current, outputPtr, sizeof(current));
+					current |= outputValues;
+					memcpy(outputPtr, &current, sizeof(current));
+				}
+			}
+			
+			// ** Subtract the samples at the top **
+			condition = unflaggedCondition(topFlags + x);
+			sum = _mm256_sub_ps(sum, _mm256_and_ps(_mm256_loadu_ps(topValues + x), _mm256_castsi256_ps(condition)));
+			count = _mm256_add_epi32(count, condition);
+			
+			_mm256_store_ps(sums + x, sum);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(counts + x), count);
+		}
+		++yTop;
+		++yBottom;
+	}
+	_mm_free(sums);
+	_mm_free(counts);
+	
+	for(size_t x=vectorWidth;x<data.width;++x)
+		sumThresholdLine(data.values + x, data.valueStride, data.flags + x, data.output + x, data.flagStride, data.height, length, threshold);
+}
+
+/**
+ * The horizontal version reads blocks of eight rows, and transposes them in tiles of
+ * 8x8 samples into a buffer that holds the eight rows of each column consecutively. The
+ * sliding window then runs over the columns of that buffer, processing eight rows with
+ * each instruction, instead of gathering the samples one by one as the SSE version does.
+ */
+void ThresholdMitigater::horizontalSumThresholdAVX2(const KernelData &data, size_t length, num_t threshold)
+{
+	const size_t width = data.width;
+	num_t *columnValues = static_cast<num_t*>(_mm_malloc(width * 8 * sizeof(num_t), 32));
+	int32_t *columnConditions = static_cast<int32_t*>(_mm_malloc(width * 8 * sizeof(int32_t), 32));
+	const __m256 thresholdPos = _mm256_set1_ps(threshold);
+	const __m256 thresholdNeg = _mm256_set1_ps(-threshold);
+	
+	size_t y;
+	for(y=0;y+8<=data.height;y+=8)
+	{
+		for(size_t x=0;x<width;x+=8)
+		{
+			__m256 values[8], flags[8];
+			for(size_t r=0;r<8;++r)
+			{
+				const num_t *valuePtr = data.values + (y + r) * data.valueStride + x;
+				const bool *flagPtr = data.flags + (y + r) * data.flagStride + x;
+				if(x + 8 <= width)
+				{
+					values[r] = _mm256_loadu_ps(valuePtr);
+					flags[r] = _mm256_castsi256_ps(unflaggedCondition(flagPtr));
+				} else {
+					// Last tile: don't read past the end of the row
+					num_t valueTile[8] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+					bool flagTile[8] = { true, true, true, true, true, true, true, true };
+					memcpy(valueTile, valuePtr, (width - x) * sizeof(num_t));
+					memcpy(flagTile, flagPtr, (width - x) * sizeof(bool));
+					values[r] = _mm256_loadu_ps(valueTile);
+					flags[r] = _mm256_castsi256_ps(unflaggedCondition(flagTile));
+				}
+			}
+			transpose8x8(values);
+			transpose8x8(flags);
+			const size_t tileWidth = (x + 8 <= width) ? 8 : width - x;
+			for(size_t i=0;i<tileWidth;++i)
+			{
+				_mm256_store_ps(columnValues + (x + i) * 8, values[i]);
+				_mm256_store_ps(reinterpret_cast<float*>(columnConditions) + (x + i) * 8, flags[i]);
+			}
+		}
+		
+		__m256 sum = _mm256_setzero_ps();
+		__m256i count = _mm256_setzero_si256();
+		size_t xRight;
+		for(xRight=0;xRight<length-1;++xRight)
+		{
+			const __m256i condition = _mm256_load_si256(reinterpret_cast<const __m256i*>(columnConditions + xRight * 8));
+			sum = _mm256_add_ps(sum, _mm256_and_ps(_mm256_load_ps(columnValues + xRight * 8), _mm256_castsi256_ps(condition)));
+			count = _mm256_sub_epi32(count, condition);
+		}
+		
+		size_t xLeft = 0;
+		while(xRight < width)
+		{
+			// ** Add the samples at the right **
+			__m256i condition = _mm256_load_si256(reinterpret_cast<const __m256i*>(columnConditions + xRight * 8));
+			sum = _mm256_add_ps(sum, _mm256_and_ps(_mm256_load_ps(columnValues + xRight * 8), _mm256_castsi256_ps(condition)));
+			count = _mm256_sub_epi32(count, condition);
+			
+			// ** Check sum **
+			const __m256 avg = _mm256_div_ps(sum, _mm256_cvtepi32_ps(count));
+			const unsigned flagConditions = _mm256_movemask_ps(_mm256_or_ps(
+				_mm256_cmp_ps(avg, thresholdPos, _CMP_GT_OQ),
+				_mm256_cmp_ps(avg, thresholdNeg, _CMP_LT_OQ)));
+			if(flagConditions != 0)
+			{
+				for(size_t r=0;r<8;++r)
+				{
+					if((flagConditions & (1 << r)) != 0)
+						memset(data.output + (y + r) * data.flagStride + xLeft, true, length * sizeof(bool));
+				}
+			}
+			
+			// ** Subtract the samples at the left **
+			condition = _mm256_load_si256(reinterpret_cast<const __m256i*>(columnConditions + xLeft * 8));
+			sum = _mm256_sub_ps(sum, _mm256_and_ps(_mm256_load_ps(columnValues + xLeft * 8), _mm256_castsi256_ps(condition)));
+			count = _mm256_add_epi32(count, condition);
+			
+			++xLeft;
+			++xRight;
+		}
+	}
+	_mm_free(columnValues);
+	_mm_free(columnConditions);
+	
+	for(;y<data.height;++y)
+		sumThresholdLine(data.values + y * data.valueStride, 1, data.flags + y * data.flagStride, data.output + y * data.flagStride, 1, width, length, threshold);
+}
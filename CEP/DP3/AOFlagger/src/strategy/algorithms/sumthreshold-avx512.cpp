@@ -0,0 +1,282 @@
+/***************************************************************************
+ *   Copyright (C) 2012 by A.R. Offringa                                   *
+ *   offringa@astro.rug.nl                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdint.h>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include <AOFlagger/strategy/algorithms/thresholdmitigater.h>
+
+/**
+ * @file
+ * AVX-512 versions of the SumThreshold algorithm. This file is compiled with -mavx512f, and
+ * its functions may only be called when CPUFeatures::HasAVX512F() returns true. They work
+ * like the AVX2 versions in sumthreshold-avx2.cpp, but with sixteen lanes, and use
+ * AVX-512 mask registers instead of and-ing with the condition.
+ */
+
+namespace {
+
+	/**
+	 * Returns a mask with the bits set for each of the sixteen bools that is false.
+	 */
+	inline __mmask16 unflaggedMask(const bool *flags)
+	{
+		return _mm512_cmpeq_epi32_mask(
+			_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(flags))),
+			_mm512_setzero_si512());
+	}
+	
+	/**
+	 * Converts sixteen stored 32-bit conditions into a mask.
+	 */
+	inline __mmask16 conditionMask(const int32_t *conditions)
+	{
+		const __m512i c = _mm512_load_si512(conditions);
+		return _mm512_test_epi32_mask(c, c);
+	}
+	
+	/**
+	 * Returns 0xFFFFFFFF for each of the eight bools that is false, 0 otherwise.
+	 */
+	inline __m256i unflaggedCondition8(const bool *flags)
+	{
+		return _mm256_cmpeq_epi32(
+			_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(flags))),
+			_mm256_setzero_si256());
+	}
+	
+	inline void transpose8x8(__m256 *r)
+	{
+		const __m256
+			t0 = _mm256_unpacklo_ps(r[0], r[1]),
+			t1 = _mm256_unpackhi_ps(r[0], r[1]),
+			t2 = _mm256_unpacklo_ps(r[2], r[3]),
+			t3 = _mm256_unpackhi_ps(r[2], r[3]),
+			t4 = _mm256_unpacklo_ps(r[4], r[5]),
+			t5 = _mm256_unpackhi_ps(r[4], r[5]),
+			t6 = _mm256_unpacklo_ps(r[6], r[7]),
+			t7 = _mm256_unpackhi_ps(r[6], r[7]);
+		const __m256
+			s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+			s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+			s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+			s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+			s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)),
+			s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2)),
+			s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)),
+			s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+		r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+		r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+		r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+		r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+		r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+		r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+		r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+		r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+	}
+	
+	/**
+	 * Transposes a tile of eight rows and (at most) eight columns, and stores column i at
+	 * destination + i * 16.
+	 */
+	inline void transposeTile(const num_t *values, size_t valueStride, const bool *flags, size_t flagStride, size_t tileWidth, num_t *valueDestination, int32_t *conditionDestination)
+	{
+		__m256 v[8], c[8];
+		for(size_t r=0;r<8;++r)
+		{
+			const num_t *valuePtr = values + r * valueStride;
+			const bool *flagPtr = flags + r * flagStride;
+			if(tileWidth == 8)
+			{
+				v[r] = _mm256_loadu_ps(valuePtr);
+				c[r] = _mm256_castsi256_ps(unflaggedCondition8(flagPtr));
+			} else {
+				// Last tile: don't read past the end of the row
+				num_t valueTile[8] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+				bool flagTile[8] = { true, true, true, true, true, true, true, true };
+				memcpy(valueTile, valuePtr, tileWidth * sizeof(num_t));
+				memcpy(flagTile, flagPtr, tileWidth * sizeof(bool));
+				v[r] = _mm256_loadu_ps(valueTile);
+				c[r] = _mm256_castsi256_ps(unflaggedCondition8(flagTile));
+			}
+		}
+		transpose8x8(v);
+		transpose8x8(c);
+		for(size_t i=0;i<tileWidth;++i)
+		{
+			_mm256_store_ps(valueDestination + i * 16, v[i]);
+			_mm256_store_ps(reinterpret_cast<float*>(conditionDestination) + i * 16, c[i]);
+		}
+	}
+}
+
+void ThresholdMitigater::verticalSumThresholdAVX512(const KernelData &data, size_t length, num_t threshold)
+{
+	const size_t vectorWidth = data.width - data.width % 16;
+	num_t *sums = static_cast<num_t*>(_mm_malloc((vectorWidth + 16) * sizeof(num_t), 64));
+	int32_t *counts = static_cast<int32_t*>(_mm_malloc((vectorWidth + 16) * sizeof(int32_t), 64));
+	for(size_t x=0;x<vectorWidth;++x)
+	{
+		sums[x] = 0.0;
+		counts[x] = 0;
+	}
+	const __m512 thresholdPos = _mm512_set1_ps(threshold);
+	const __m512 thresholdNeg = _mm512_set1_ps(-threshold);
+	const __m512i ones = _mm512_set1_epi32(1);
+	
+	size_t yBottom;
+	for(yBottom=0;yBottom<length-1;++yBottom)
+	{
+		const num_t *values = data.values + yBottom * data.valueStride;
+		const bool *flags = data.flags + yBottom * data.flagStride;
+		for(size_t x=0;x<vectorWidth;x+=16)
+		{
+			const __mmask16 unflagged = unflaggedMask(flags + x);
+			const __m512 sum = _mm512_load_ps(sums + x);
+			const __m512i count = _mm512_load_si512(counts + x);
+			_mm512_store_ps(sums + x, _mm512_mask_add_ps(sum, unflagged, sum, _mm512_loadu_ps(values + x)));
+			_mm512_store_si512(counts + x, _mm512_mask_add_epi32(count, unflagged, count, ones));
+		}
+	}
+	
+	size_t yTop = 0;
+	while(yBottom < data.height)
+	{
+		const num_t
+			*bottomValues = data.values + yBottom * data.valueStride,
+			*topValues = data.values + yTop * data.valueStride;
+		const bool
+			*bottomFlags = data.flags + yBottom * data.flagStride,
+			*topFlags = data.flags + yTop * data.flagStride;
+		for(size_t x=0;x<vectorWidth;x+=16)
+		{
+			__m512 sum = _mm512_load_ps(sums + x);
+			__m512i count = _mm512_load_si512(counts + x);
+			
+			// ** Add the samples at the bottom **
+			__mmask16 unflagged = unflaggedMask(bottomFlags + x);
+			sum = _mm512_mask_add_ps(sum, unflagged, sum, _mm512_loadu_ps(bottomValues + x));
+			count = _mm512_mask_add_epi32(count, unflagged, count, ones);
+			
+			// ** Check sum **
+			const __m512 avg = _mm512_div_ps(sum, _mm512_cvtepi32_ps(count));
+			const __mmask16 flagConditions =
+				_mm512_cmp_ps_mask(avg, thresholdPos, _CMP_GT_OQ) |
+				_mm512_cmp_ps_mask(avg, thresholdNeg, _CMP_LT_OQ);
+			if(flagConditions != 0)
+			{
+				const __m128i outputValues = _mm512_cvtepi32_epi8(_mm512_maskz_mov_epi32(flagConditions, ones));
+				for(size_t i=0;i<length;++i)
+				{
+					__m128i *outputPtr = reinterpret_cast<__m128i*>(data.output + (yTop + i) * data.flagStride + x);
+					_mm_storeu_si128(outputPtr, _mm_or_si128(_mm_loadu_si128(outputPtr), outputValues));
+				}
+			}
+			
+			// ** Subtract the samples at the top **
+			unflagged = unflaggedMask(topFlags + x);
+			sum = _mm512_mask_sub_ps(sum, unflagged, sum, _mm512_loadu_ps(topValues + x));
+			count = _mm512_mask_sub_epi32(count, unflagged, count, ones);
+			
+			_mm512_store_ps(sums + x, sum);
+			_mm512_store_si512(counts + x, count);
+		}
+		++yTop;
+		++yBottom;
+	}
+	_mm_free(sums);
+	_mm_free(counts);
+	
+	for(size_t x=vectorWidth;x<data.width;++x)
+		sumThresholdLine(data.values + x, data.valueStride, data.flags + x, data.output + x, data.flagStride, data.height, length, threshold);
+}
+
+void ThresholdMitigater::horizontalSumThresholdAVX512(const KernelData &data, size_t length, num_t threshold)
+{
+	const size_t width = data.width;
+	num_t *columnValues = static_cast<num_t*>(_mm_malloc(width * 16 * sizeof(num_t), 64));
+	int32_t *columnConditions = static_cast<int32_t*>(_mm_malloc(width * 16 * sizeof(int32_t), 64));
+	const __m512 thresholdPos = _mm512_set1_ps(threshold);
+	const __m512 thresholdNeg = _mm512_set1_ps(-threshold);
+	const __m512i ones = _mm512_set1_epi32(1);
+	
+	size_t y;
+	for(y=0;y+16<=data.height;y+=16)
+	{
+		for(size_t x=0;x<width;x+=8)
+		{
+			const size_t tileWidth = (x + 8 <= width) ? 8 : width - x;
+			for(size_t half=0;half!=16;half+=8)
+			{
+				transposeTile(
+					data.values + (y + half) * data.valueStride + x, data.valueStride,
+					data.flags + (y + half) * data.flagStride + x, data.flagStride,
+					tileWidth, columnValues + x * 16 + half, columnConditions + x * 16 + half);
+			}
+		}
+		
+		__m512 sum = _mm512_setzero_ps();
+		__m512i count = _mm512_setzero_si512();
+		size_t xRight;
+		for(xRight=0;xRight<length-1;++xRight)
+		{
+			const __mmask16 unflagged = conditionMask(columnConditions + xRight * 16);
+			sum = _mm512_mask_add_ps(sum, unflagged, sum, _mm512_load_ps(columnValues + xRight * 16));
+			count = _mm512_mask_add_epi32(count, unflagged, count, ones);
+		}
+		
+		size_t xLeft = 0;
+		while(xRight < width)
+		{
+			// ** Add the samples at the right **
+			__mmask16 unflagged = conditionMask(columnConditions + xRight * 16);
+			sum = _mm512_mask_add_ps(sum, unflagged, sum, _mm512_load_ps(columnValues + xRight * 16));
+			count = _mm512_mask_add_epi32(count, unflagged, count, ones);
+			
+			// ** Check sum **
+			const __m512 avg = _mm512_div_ps(sum, _mm512_cvtepi32_ps(count));
+			const unsigned flagConditions =
+				_mm512_cmp_ps_mask(avg, thresholdPos, _CMP_GT_OQ) |
+				_mm512_cmp_ps_mask(avg, thresholdNeg, _CMP_LT_OQ);
+			if(flagConditions != 0)
+			{
+				for(size_t r=0;r<16;++r)
+				{
+					if((flagConditions & (1 << r)) != 0)
+						memset(data.output + (y + r) * data.flagStride + xLeft, true, length * sizeof(bool));
+				}
+			}
+			
+			// ** Subtract the samples at the left **
+			unflagged = conditionMask(columnConditions + xLeft * 16);
+			sum = _mm512_mask_sub_ps(sum, unflagged, sum, _mm512_load_ps(columnValues + xLeft * 16));
+			count = _mm512_mask_sub_epi32(count, unflagged, count, ones);
+			
+			++xLeft;
+			++xRight;
+		}
+	}
+	_mm_free(columnValues);
+	_mm_free(columnConditions);
+	
+	for(;y<data.height;++y)
+		sumThresholdLine(data.values + y * data.valueStride, 1, data.flags + y * data.flagStride, data.output + y * data.flagStride, 1, width, length, threshold);
+}
@@ -239,6 +239,110 @@ void ThresholdMitigater::HorizontalSumThresholdLargeSSE(Image2DCPtr input, Mask2
 	}	
 }
 
+void ThresholdMitigater::sumThresholdWithKernel(SumThresholdKernel kernel, bool vertical, Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold)
+{
+	if(length == 1)
+	{
+		if(vertical)
+			VerticalSumThreshold<1>(input, mask, threshold);
+		else
+			HorizontalSumThreshold<1>(input, mask, threshold);
+		return;
+	}
+	if(length == 0 || length > 256 || (length & (length-1)) != 0)
+		throw BadUsageException("Invalid value for length");
+	if(length <= (vertical ? mask->Height() : mask->Width()))
+	{
+		Mask2D *maskCopy = Mask2D::CreateCopy(*mask);
+		KernelData data;
+		data.values = input->ValuePtr(0, 0);
+		data.valueStride = input->Stride();
+		data.flags = mask->ValuePtr(0, 0);
+		data.output = maskCopy->ValuePtr(0, 0);
+		data.flagStride = mask->Stride();
+		data.width = mask->Width();
+		data.height = mask->Height();
+		kernel(data, length, threshold);
+		mask->Swap(*maskCopy);
+		delete maskCopy;
+	}
+}
+
+void ThresholdMitigater::VerticalSumThresholdLargeAVX2(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold)
+{
+#ifdef HAVE_AVX2
+	sumThresholdWithKernel(&verticalSumThresholdAVX2, true, input, mask, length, threshold);
+#else
+	VerticalSumThresholdLargeSSE(input, mask, length, threshold);
+#endif
+}
+
+void ThresholdMitigater::HorizontalSumThresholdLargeAVX2(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold)
+{
+#ifdef HAVE_AVX2
+	sumThresholdWithKernel(&horizontalSumThresholdAVX2, false, input, mask, length, threshold);
+#else
+	HorizontalSumThresholdLargeSSE(input, mask, length, threshold);
+#endif
+}
+
+void ThresholdMitigater::VerticalSumThresholdLargeAVX512(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold)
+{
+#ifdef HAVE_AVX512F
+	sumThresholdWithKernel(&verticalSumThresholdAVX512, true, input, mask, length, threshold);
+#else
+	VerticalSumThresholdLargeAVX2(input, mask, length, threshold);
+#endif
+}
+
+void ThresholdMitigater::HorizontalSumThresholdLargeAVX512(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold)
+{
+#ifdef HAVE_AVX512F
+	sumThresholdWithKernel(&horizontalSumThresholdAVX512, false, input, mask, length, threshold);
+#else
+	HorizontalSumThresholdLargeAVX2(input, mask, length, threshold);
+#endif
+}
+
+void ThresholdMitigater::sumThresholdLine(const num_t *values, size_t valueStep, const bool *flags, bool *output, size_t flagStep, size_t n, size_t length, num_t threshold)
+{
+	// Like the SSE version, this does not test for count > 0: the samples of an empty
+	// window are all flagged already, so the result of the division does not matter.
+	num_t sum = 0.0;
+	int count = 0;
+	size_t last;
+	for(last=0;last<length-1;++last)
+	{
+		if(!flags[last * flagStep])
+		{
+			sum += values[last * valueStep];
+			++count;
+		}
+	}
+	size_t first = 0;
+	while(last < n)
+	{
+		if(!flags[last * flagStep])
+		{
+			sum += values[last * valueStep];
+			++count;
+		}
+		const num_t avg = sum / (num_t) count;
+		if(avg > threshold || avg < -threshold)
+		{
+			for(size_t i=0;i<length;++i)
+				output[(first + i) * flagStep] = true;
+		}
+		if(!flags[first * flagStep])
+		{
+			sum -= values[first * valueStep];
+			--count;
+		}
+		++first;
+		++last;
+	}
+}
+
 void ThresholdMitigater::HorizontalVarThreshold(Image2DCPtr input, Mask2DPtr mask, size_t length, num_t threshold)
 {
 	size_t width = input->Width()-length+1;
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2012 by A.R. Offringa                                   *
+ *   offringa@astro.rug.nl                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <AOFlagger/util/cpufeatures.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+#if defined(__x86_64__) || defined(__i386__)
+	/**
+	 * Reads the XCR0 register, which tells which register states the OS saves.
+	 * Only valid when CPUID reports OSXSAVE.
+	 */
+	unsigned long long readXCR0()
+	{
+		unsigned eax, edx;
+		__asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+		return ((unsigned long long) edx << 32) | eax;
+	}
+#endif
+
+}
+
+CPUFeatures::CPUFeatures() :
+	_hasAVX2(false),
+	_hasAVX512F(false)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned eax, ebx, ecx, edx;
+	if(__get_cpuid(0, &eax, &ebx, &ecx, &edx) == 0 || eax < 7)
+		return;
+	
+	__get_cpuid(1, &eax, &ebx, &ecx, &edx);
+	const bool
+		hasOSXSave = (ecx & (1 << 27)) != 0,
+		hasAVX = (ecx & (1 << 28)) != 0;
+	if(!hasOSXSave || !hasAVX)
+		return;
+	
+	// Bits 1 and 2: SSE and AVX state; bits 5-7: opmask and the upper ZMM registers
+	const unsigned long long xcr0 = readXCR0();
+	const bool
+		osSavesYMM = (xcr0 & 0x06) == 0x06,
+		osSavesZMM = (xcr0 & 0xE6) == 0xE6;
+	
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+#ifdef HAVE_AVX2
+	_hasAVX2 = osSavesYMM && (ebx & (1 << 5)) != 0;
+#endif
+#ifdef HAVE_AVX512F
+	_hasAVX512F = osSavesZMM && (ebx & (1 << 16)) != 0;
+#endif
+	(void) osSavesYMM;
+	(void) osSavesZMM;
+#endif
+}
@@ -40,6 +40,8 @@
 #include <DPPP/ApplyCal.h>
 
 #include <StationResponse/AntennaField.h>
+#include <StationResponse/BeamBatch.h>
+#include <StationResponse/Station.h>
 
 #include <DPPP/Stokes.h>
 #include <DPPP/PointSource.h>
@@ -79,50 +81,53 @@ void ApplyBeam::applyBeam(
       uint nSt = beamValues.size() / nCh;
       uint nBl = info.nbaselines();
 
-      // Store array factor in diagonal matrix (in other modes this variable
-      // is not used).
-      StationResponse::diag22c_t af_tmp;
-
-      double reffreq=info.refFreq();
-
-      // Apply the beam values of both stations to the ApplyBeamed data.
-      dcomplex tmp[4];
-      for (size_t ch = 0; ch < nCh; ++ch) {
-        if (useChannelFreq) {
-          reffreq=info.chanFreqs()[ch];
-        }
-
-        switch (mode) {
-        case DEFAULT:
-          // Fill beamValues for channel ch
-          for (size_t st = 0; st < nSt; ++st) {
-            beamValues[nCh * st + ch] = antBeamInfo[st]->response(time,
-                                          info.chanFreqs()[ch], srcdir,
-                                          reffreq, refdir, tiledir);
-            if (invert) {
-              ApplyCal::invert((dcomplex*)(&(beamValues[nCh * st + ch])));
+      // Compute the beam values of all stations for all channels at once in
+      // the modes that use the full station beam former. The layout of
+      // beamValues (station major) matches the layout used by the batched
+      // StationResponse functions.
+      if (mode == DEFAULT || mode == ARRAY_FACTOR) {
+        vector<double> freqs(info.chanFreqs().begin(),
+                             info.chanFreqs().end());
+        vector<double> reffreqs(useChannelFreq ? freqs :
+                                vector<double>(nCh, info.refFreq()));
+        StationResponse::BeamBatch batch(time, nCh, &(freqs[0]),
+                                         &(reffreqs[0]), refdir, tiledir);
+        batch.setDirections(1, &srcdir);
+
+        if (mode == DEFAULT) {
+          StationResponse::response(antBeamInfo.begin(),
+                                    antBeamInfo.begin() + nSt, batch,
+                                    &(beamValues[0]));
+          if (invert) {
+            for (size_t i = 0; i < nSt * nCh; ++i) {
+              ApplyCal::invert((dcomplex*)(&(beamValues[i])));
             }
           }
-          break;
-        case ARRAY_FACTOR:
-          // Fill beamValues for channel ch
-          for (size_t st = 0; st < nSt; ++st) {
-            af_tmp = antBeamInfo[st]->arrayFactor(time,
-                                          info.chanFreqs()[ch], srcdir,
-                                          reffreq, refdir, tiledir);
-            beamValues[nCh * st + ch][0][1]=0.;
-            beamValues[nCh * st + ch][1][0]=0.;
+        } else {
+          // Store array factor in diagonal matrix.
+          vector<StationResponse::diag22c_t> af(nSt * nCh);
+          StationResponse::arrayFactor(antBeamInfo.begin(),
+                                       antBeamInfo.begin() + nSt, batch,
+                                       &(af[0]));
+          for (size_t i = 0; i < nSt * nCh; ++i) {
+            beamValues[i][0][1]=0.;
+            beamValues[i][1][0]=0.;
 
             if (invert) {
-              beamValues[nCh * st + ch][0][0]=1./af_tmp[0];
-              beamValues[nCh * st + ch][1][1]=1./af_tmp[1];
+              beamValues[i][0][0]=1./af[i][0];
+              beamValues[i][1][1]=1./af[i][1];
             } else {
-              beamValues[nCh * st + ch][0][0]=af_tmp[0];
-              beamValues[nCh * st + ch][1][1]=af_tmp[1];
+              beamValues[i][0][0]=af[i][0];
+              beamValues[i][1][1]=af[i][1];
             }
           }
-          break;
-        case ELEMENT:
+        }
+      }
+
+      // Apply the beam values of both stations to the ApplyBeamed data.
+      dcomplex tmp[4];
+      for (size_t ch = 0; ch < nCh; ++ch) {
+        if (mode == ELEMENT) {
           // Fill beamValues for channel ch
           for (size_t st = 0; st < nSt; ++st) {
             LOFAR::StationResponse::AntennaField::ConstPtr field =
@@ -135,7 +140,6 @@ void ApplyBeam::applyBeam(
               ApplyCal::invert((dcomplex*)(&(beamValues[nCh * st + ch])));
             }
           }
-          break;
         }
 
         // Apply beam for channel ch on all baselines
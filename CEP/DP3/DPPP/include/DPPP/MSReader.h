@@ -34,7 +34,9 @@
 #include <tables/Tables/TableIter.h>
 #include <tables/Tables/RefRows.h>
 #include <casa/Arrays/Slicer.h>
+#include <Common/LofarTypes.h>
 #include <Common/lofar_vector.h>
+#include <Common/Thread/Mutex.h>
 
 namespace LOFAR {
 
@@ -61,6 +63,8 @@ namespace LOFAR {
     //           WEIGHT]
     //  <li> msin.starttime: first time to use [first time in MS]
     //  <li> msin.endtime: last time to use [last time in MS]
+    //  <li> msin.readahead: number of time slots to read ahead in a
+    //           separate thread [0] (handled by DPRun using a ThreadStep)
     // </ul>
     //
     // If a time slot is missing, it is inserted with flagged data set to zero.
@@ -72,6 +76,10 @@ namespace LOFAR {
     // too much data is kept in memory.
     // Other columns (like WEIGHT, UVW) can be read when needed by using the
     // appropriate DPInput::fetch function.
+    // <br>All access to the MS is serialized by a mutex (see ioMutex),
+    // so the fetch functions can be used from other threads than the one
+    // calling process (e.g. when reading ahead) and an MSUpdater can write
+    // the MS while it is being read.
     //
     // The data columns are handled in the following way:
     // <table>
@@ -257,6 +265,15 @@ namespace LOFAR {
       const DPBuffer& getBuffer() const
         { return itsBuffer; }
 
+      // Get the mutex serializing the access to the MS.
+      // A step writing into the MS (i.e., MSUpdater) has to lock it.
+      Mutex& ioMutex()
+        { return itsIOMutex; }
+
+      // Get the number of bytes read from the MS.
+      int64 nrBytesRead() const
+        { return itsNrBytesRead; }
+
       // Flags inf and NaN
       static void flagInfNaN(const casa::Cube<casa::Complex>& dataCube,
                        casa::Cube<bool>& flagsCube, FlagCounter& flagCounter);
@@ -324,6 +341,8 @@ namespace LOFAR {
       casa::Vector<uint>  itsBaseRowNrs;    //# rownrs for meta of missing times
       FlagCounter         itsFlagCounter;
       NSTimer             itsTimer;
+      Mutex               itsIOMutex;       //# serializes access to the MS
+      int64               itsNrBytesRead;   //# nr of bytes read from the MS
     };
 
   } //# end namespace
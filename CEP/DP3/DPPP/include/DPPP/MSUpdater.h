@@ -49,6 +49,10 @@ namespace LOFAR {
     //
     // Like MSWriter it adds an entry to the HISTORY table of the MS
     // containing the parset values and DPPP version.
+    //
+    // The MS is written while holding the reader's I/O mutex, because the
+    // reader can read the same MS in another thread. Thus the writes can be
+    // done behind in a separate thread (see msout.writebehind in MSWriter).
 
     class MSUpdater: public DPStep
     {
@@ -121,6 +125,7 @@ namespace LOFAR {
       bool         itsDataColAdded; //# has data column been added?
       bool         itsWeightColAdded; //# has weight column been added?
       bool         itsWriteHistory; //# Should history be written?
+      int64        itsNrBytesWritten;
       NSTimer      itsTimer;
     };
 
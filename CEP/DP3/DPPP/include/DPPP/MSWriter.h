@@ -34,6 +34,7 @@
 #include <tables/Tables/ScalarColumn.h>
 #include <tables/Tables/ArrayColumn.h>
 #include <tables/Tables/TiledColumnStMan.h>
+#include <tables/Tables/DataManager.h>
 
 namespace LOFAR {
   class ParameterSet;
@@ -56,6 +57,17 @@ namespace LOFAR {
     // The OBSERVATION table will be updated for the correct start and end time.
     // The HISTORY table gets an entry containing the parset values and the
     // DPPP version.
+    //
+    // If msout.writebehind is given, DPRun puts a ThreadStep in front of the
+    // output step (MSWriter or MSUpdater), so the data are written in a
+    // separate thread while the next time slots are processed. Its value is
+    // the maximum number of time slots queued for writing [0 = no queue].
+    //
+    // If msout.storagemanager=compress is given, the DATA, FLAG and
+    // WEIGHT_SPECTRUM columns are stored with the CompressStMan, which
+    // quantizes the visibilities and weights to msout.storagemanager.databits
+    // and msout.storagemanager.weightbits bits (default 16). The flags are
+    // stored losslessly as bits. By default the TiledColumnStMan is used.
 
     class MSWriter: public DPStep
     {
@@ -93,7 +105,7 @@ namespace LOFAR {
       // Create an array column description and add to table with given
       // stoage manager (if given).
       void makeArrayColumn (casa::ColumnDesc desc, const casa::IPosition& shape,
-                            casa::TiledColumnStMan* tsm, casa::Table& table);
+                            casa::DataManager* dm, casa::Table& table);
 
       // Create the MS by cloning all subtables from the input MS.
       // All output columns in the main table are using normal storage managers.
@@ -178,6 +190,9 @@ namespace LOFAR {
       bool            itsWriteFullResFlags;
       uint            itsTileSize;
       uint            itsTileNChan;
+      std::string     itsStManName;   //# "" (tiled) or "compress"
+      uint            itsDataBits;    //# nr of bits for compressed data
+      uint            itsWeightBits;  //# nr of bits for compressed weights
       uint            itsNrCorr;
       uint            itsNrChan;
       uint            itsNrBl;
@@ -188,6 +203,7 @@ namespace LOFAR {
       uint            itsNrDone;      //# nr of time slots written
       std::string     itsVdsDir;      //# directory where to put VDS file
       std::string     itsClusterDesc; //# name of clusterdesc file
+      int64           itsNrBytesWritten;
       NSTimer         itsTimer;
     };
 
@@ -51,13 +51,16 @@ namespace LOFAR {
     // The test program tMirror.cc can be used to check the correctness of
     // the alogorithm to determine the channels to use.
     //
-    // Taking the median is an O(N) operation, thus doing it for all data
-    // points is an O(N^2) operation. The test program tMedian.cc can be
-    // used to test the performance of the algorithms to determine the median.
-    // It shows that casacore's kthLargest outperforms STL's nth_element.
-    // <br>
-    // Shuffling the data around to be able to determine the medians is also
-    // an expensive operation, but takes less time than the medians themselves.
+    // Taking the median is an O(N) operation, thus doing it from scratch for
+    // all data points is an O(N^2) operation. Therefore the unflagged values
+    // in the window are kept sorted per baseline and correlation, and only
+    // the channel leaving and the channel entering the window are merged in
+    // when the window slides to the next channel. The median is then found
+    // directly and the median of the absolute differences by a binary search.
+    // This is done by class MedianWindow. The results are the same as taking
+    // the element at index N/2 with casacore's kthLargest.
+    // Flags set while processing a time slot are removed from the windows
+    // of the next channels as well.
     //
     // When a correlation is flagged, all correlations for that data point
     // are flagged. It is possible to specify which correlations have to be
@@ -106,15 +109,6 @@ namespace LOFAR {
       // Process the result in the next step.
       void flag (uint index, const vector<uint>& timeEntries);
 
-      // Compute the median factors for given baseline, channel, and
-      // correlation.
-      void computeFactors (const vector<uint>& timeEntries,
-                           uint bl, int chan, int corr,
-                           int nchan, int ncorr,
-                           float& Z1, float& Z2,
-                           float* tempBuf,
-                           NSTimer& moveTimer, NSTimer& medianTimer);
-
       // Get the values of the expressions for each baseline.
       void getExprValues (int maxNChan, int maxNTime);
 
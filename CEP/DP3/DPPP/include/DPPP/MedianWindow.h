@@ -0,0 +1,125 @@
+//# MedianWindow.h: Sliding time/frequency window to determine medians
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef DPPP_MEDIANWINDOW_H
+#define DPPP_MEDIANWINDOW_H
+
+// @file
+// @brief Sliding time/frequency window to determine medians
+
+#include <Common/lofar_vector.h>
+#include <Common/LofarTypes.h>
+#include <casa/Arrays/Cube.h>
+
+namespace LOFAR {
+  namespace DPPP {
+    //# Forward Declarations.
+    class DPBuffer;
+
+    // @ingroup NDPPP
+
+    // Get the channel to use for position k in a window.
+    // Positions outside the band are mirrored at the edge channels.
+    // For example, for channel 1 and a window of 7 the channels
+    // 2,1,0,1,2,3,4 are used.
+    inline uint mirrorChannel (int k, uint nchan)
+    {
+      if (k < 0) {
+        return -k;
+      } else if (k >= int(nchan)) {
+        return 2*(nchan-1) - k;
+      }
+      return k;
+    }
+
+    // This class is used by MedFlagger to determine the median and the
+    // median of the absolute differences in the time/frequency window
+    // around each channel of a baseline and correlation.
+    //
+    // It keeps the unflagged amplitudes in the window as a sorted multiset.
+    // When the window slides one channel, the values of the channel leaving
+    // and the channel entering the window are merged into the sorted values
+    // in a single pass. This is much cheaper than determining both medians
+    // from scratch for each channel.
+    // The amplitudes and flags of the baseline/correlation are first
+    // gathered into a contiguous [ntime,nchan] plane.
+    // A NaN amplitude cannot be ordered, so it is treated as flagged.
+    //
+    // The results are the same as taking the element at index N/2 with
+    // casacore's kthLargest from all unflagged values in the window.
+    // This is tested in tMedianWindow.cc.
+
+    class MedianWindow
+    {
+    public:
+      // Gather the amplitudes and flags of the given baseline and correlation
+      // for the given time entries. The window is made empty.
+      void gather (const vector<casa::Cube<float> >& ampl,
+                   const vector<DPBuffer>& bufs,
+                   const uint* timeEntries, uint ntime,
+                   uint bl, uint corr, uint nchan, uint ncorr);
+
+      // Add or remove the unflagged values of a channel for all times.
+      // The change takes effect when update is called.
+      void addChannel (uint chan)
+        { collect (chan, itsAdd); }
+      void removeChannel (uint chan)
+        { collect (chan, itsRemove); }
+
+      // Flag the given channel for the given time positions and remove
+      // their values from the window as often as the channel occurs in it.
+      // The change takes effect when update is called.
+      void flagChannel (uint chan, const vector<uint>& timePos,
+                        uint multiplicity);
+
+      // Merge the added and removed values into the sorted values.
+      void update();
+
+      // Get the number of values in the window.
+      uint size() const
+        { return itsValues.size(); }
+
+      // Get the median as the element at index n/2 (as kthLargest does).
+      float median() const
+        { return itsValues[itsValues.size()/2]; }
+
+      // Get the median of the absolute differences with the median.
+      float medianAbsDiff (float median) const;
+
+    private:
+      // Append the unflagged values of a channel for all times to out.
+      void collect (uint chan, vector<float>& out) const;
+
+      //# Data members.
+      uint          itsNTime;
+      uint          itsNChan;
+      vector<float> itsAmpl;
+      vector<char>  itsFlags;
+      vector<float> itsValues;
+      vector<float> itsAdd;
+      vector<float> itsRemove;
+      vector<float> itsTemp;
+    };
+
+  } //# end namespace
+}
+
+#endif
@@ -35,6 +35,7 @@
 #include <tables/Tables/RefRows.h>
 #include <casa/Arrays/Slicer.h>
 #include <Common/lofar_vector.h>
+#include <Common/Thread/Mutex.h>
 
 namespace LOFAR {
 
@@ -189,7 +190,8 @@ namespace LOFAR {
       vector<string>        itsMSNames;
       vector<MSReader*>     itsReaders;   //# same as itsSteps
       vector<DPStep::ShPtr> itsSteps;     //# used for automatic destruction
-      vector<DPBuffer>      itsBuffers;
+      vector<DPBuffer>      itsBuffers;   //# per MS, for getWeights etc.
+      Mutex                 itsBuffersMutex; //# serializes use of itsBuffers
       uint                  itsFillNChan; //# nr of chans for missing MSs
       FlagCounter           itsFlagCounter;
       bool                  itsRegularChannels; // Are resulting channels regularly spaced
@@ -28,6 +28,8 @@
 // @brief DPPP step class to apply a calibration correction to the data
 #include <casa/Arrays/Cube.h>
 #include <casa/Arrays/ArrayMath.h>
+#include <vector>
+#include <cmath>
 
 namespace LOFAR {
 
@@ -58,14 +60,23 @@ namespace LOFAR {
       // The mapping is stored in the antenna map
       casa::Matrix<casa::DComplex> getSolution();
 
-      // Returns a reference to the visibility matrix
-      casa::Array<casa::DComplex>& getVis() {
-        return _vis;
-      }
-
-      // Returns a reference to the model visibility matrix
-      casa::Array<casa::DComplex>& getMVis() {
-        return _mvis;
+      // Stores correlation cr of the visibility and the model visibility of
+      // baseline (ant1,ant2), weighted by sqrt(weight), and their conjugates
+      // for baseline (ant2,ant1). ant1 and ant2 are in stefcal numbering.
+      void setVis(uint ant1, uint ant2, uint time, uint ch, uint cr,
+                  const casa::Complex& vis, const casa::Complex& mvis,
+                  float weight) {
+        const float sw = std::sqrt(weight);
+        const size_t i = visIndex(ant1, cr/2, time, ch, cr%2, ant2);
+        const size_t j = visIndex(ant2, cr%2, time, ch, cr/2, ant1);
+        _visRe[i]  = double(vis.real())  * sw;
+        _visIm[i]  = double(vis.imag())  * sw;
+        _mvisRe[i] = double(mvis.real()) * sw;
+        _mvisIm[i] = double(mvis.imag()) * sw;
+        _visRe[j]  = double(vis.real())  * sw;
+        _visIm[j]  = -double(vis.imag()) * sw;
+        _mvisRe[j] = double(mvis.real()) * sw;
+        _mvisIm[j] = -double(mvis.imag()) * sw;
       }
 
       // Returns a reference to the antenna map. This map has length
@@ -90,16 +101,25 @@ namespace LOFAR {
       void doStep_polarized();
       void doStep_unpolarized(bool phaseOnly);
 
+      // Index in the visibility matrices, which have shape
+      // (nSt,2,solInt,nChan,2,nSt) in Fortran order
+      size_t visIndex(uint st2, uint pol2, uint time, uint ch, uint pol1,
+                      uint st1) const {
+        return st2 + _nSt*(pol2 + 2*(time + _solInt*(ch + _nChan*(pol1 + 2*st1))));
+      }
+
       uint _savedNCr;
       std::vector<int> _antMap; // Length antennaNames, contains size(antennaNames)-nSt times the value -1
-      casa::Array<casa::DComplex> _vis; // Visibility matrix
-      casa::Array<casa::DComplex> _mvis; // Model visibility matrix
+      // Visibility and model visibility matrices, split in real and
+      // imaginary parts so that the steps vectorize over stations
+      std::vector<double> _visRe, _visIm;
+      std::vector<double> _mvisRe, _mvisIm;
       casa::Matrix<casa::DComplex> _g; // Solution, indexed by station, correlation
       casa::Matrix<casa::DComplex> _gx; // Previous solution
       casa::Matrix<casa::DComplex> _gxx; // Solution before previous solution
       casa::Matrix<casa::DComplex> _gold; // Previous solution
-      casa::Matrix<casa::DComplex> _h; // Hermitian transpose of previous solution
-      casa::Matrix<casa::DComplex> _z; // Internal stefcal vector
+      // Hermitian transpose of previous solution, indexed by correlation, station
+      std::vector<double> _hRe, _hIm;
 
       uint _nSt; // number of stations in the current solution
       uint _nUn; // number of unknowns
@@ -0,0 +1,131 @@
+//# ThreadStep.h: DPPP step class to run the next steps in a separate thread
+//# Copyright (C) 2015
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef DPPP_THREADSTEP_H
+#define DPPP_THREADSTEP_H
+
+// @file
+// @brief DPPP step class to run the next steps in a separate thread
+
+#include <DPPP/DPStep.h>
+#include <DPPP/DPBuffer.h>
+#include <Common/Timer.h>
+#include <Common/LofarTypes.h>
+#include <Common/lofar_smartptr.h>
+#include <Common/lofar_vector.h>
+
+#ifdef USE_THREADS
+# include <Common/Thread/Mutex.h>
+# include <Common/Thread/Condition.h>
+# include <Common/Thread/Queue.h>
+# include <Common/Thread/Thread.h>
+#endif
+
+namespace LOFAR {
+  namespace DPPP {
+    // @ingroup NDPPP
+
+    // This class is a DPStep class that decouples the steps before it from
+    // the steps after it, so both can run at the same time.
+    // It is inserted by DPRun if the pipeline mode is enabled (see
+    // DPRun::makeSteps).
+    //
+    // The process function makes a deep copy of the buffer into one of a
+    // fixed number of preallocated buffers and queues it. A separate thread
+    // takes the buffers from the queue and passes them to the next step.
+    // When all buffers are in use, process waits until the next steps have
+    // processed one (a stall), thereby limiting the memory used.
+    //
+    // The next steps fetch the weights, UVW, and fullRes flags from the
+    // input themselves, only if they need them. In that way they see the
+    // same data and flags as without threads (e.g. fullRes flags formed
+    // from the flags set by a preceding flagger). All access to the MS
+    // from the various threads is serialized by the (Multi)MSReader.
+    //
+    // showTimings reports the time the previous steps were stalled, the
+    // time the next steps were idle waiting for data, the average
+    // number of buffers queued (the occupancy), and the amount of data
+    // passed through the queue.
+    //
+    // Besides the pipeline mode, DPRun uses this class to read ahead
+    // (msin.readahead) and to write behind (msout.writebehind).
+    //
+    // If LOFAR is built without threads, this step only passes the buffers on.
+
+    class ThreadStep: public DPStep
+    {
+    public:
+      // Construct the object. At most <src>queueSize</src> buffers
+      // are queued.
+      ThreadStep (const string& name, uint queueSize);
+
+      virtual ~ThreadStep();
+
+      // Queue a copy of the buffer. It is processed by the next step
+      // in a separate thread.
+      virtual bool process (const DPBuffer&);
+
+      // Wait until all queued buffers are processed, and finish
+      // the next steps.
+      virtual void finish();
+
+      // Show the step parameters.
+      virtual void show (std::ostream&) const;
+
+      // Show the timings.
+      virtual void showTimings (std::ostream&, double duration) const;
+
+    private:
+      // Copy the buffer into itsBuffers[index].
+      void fill (uint index, const DPBuffer& buf);
+
+#ifdef USE_THREADS
+      // The body of the thread that processes the queued buffers.
+      void processQueue();
+
+      // Throw an exception if processQueue failed.
+      void checkError();
+#endif
+
+      //# Data members.
+      string           itsName;
+      vector<DPBuffer> itsBuffers;
+      NSTimer          itsTimer;       // time spent in process (incl. stalls)
+      NSTimer          itsStallTimer;  // time waiting for a free buffer
+      NSTimer          itsIdleTimer;   // time the thread waited for a buffer
+      NSTimer          itsBusyTimer;   // time the thread spent in the next steps
+      double           itsSumOccupancy;
+      uint             itsNrProcessed;
+      int64            itsNrBytes;     // bytes copied into the buffers
+#ifdef USE_THREADS
+      // Indices in itsBuffers; -1 signals end of data.
+      LOFAR::Queue<int> itsFree;
+      LOFAR::Queue<int> itsFilled;
+      scoped_ptr<Thread> itsThread;
+      Mutex            itsMutex;       // guards itsError
+      string           itsError;       // exception message from the thread
+#endif
+    };
+
+  } //# end namespace
+}
+
+#endif
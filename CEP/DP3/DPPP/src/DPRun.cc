@@ -45,6 +45,7 @@
 #include <DPPP/Filter.h>
 #include <DPPP/Counter.h>
 #include <DPPP/ProgressMeter.h>
+#include <DPPP/ThreadStep.h>
 #include <DPPP/DPLogger.h>
 #include <Common/Timer.h>
 #include <Common/StreamUtil.h>
@@ -55,6 +56,8 @@
 #include <casa/OS/Timer.h>
 #include <casa/OS/DynLib.h>
 
+#include <algorithm>
+
 namespace LOFAR {
   namespace DPPP {
 
@@ -274,8 +277,11 @@ namespace LOFAR {
       casa::String currentMSName (pathIn.absoluteName());
 
       // Create the other steps.
+      // They are linked after creation, because in pipeline mode
+      // ThreadSteps have to be inserted.
       firstStep = DPStep::ShPtr (reader);
-      lastStep = firstStep;
+      vector<DPStep::ShPtr> chain;
+      vector<string> chainNames;
       DPStep::ShPtr step;
       for (vector<string>::const_iterator iter = steps.begin();
            iter != steps.end(); ++iter) {
@@ -323,17 +329,52 @@ namespace LOFAR {
           // Maybe the step is defined in a dynamic library.
           step = findStepCtor(type) (reader, parset, prefix);
         }
-        lastStep->setNextStep (step);
-        lastStep = step;
-        // Define as first step if not defined yet.
-        if (!firstStep) {
-          firstStep = step;
-        }
+        chain.push_back (step);
+        chainNames.push_back (*iter);
       }
       step = makeOutputStep(reader, parset, "msout.",
                             inNames.size()>1, currentMSName);
-      lastStep->setNextStep (step);
-      lastStep = step;
+      chain.push_back (step);
+      chainNames.push_back ("msout");
+
+      // In pipeline mode a ThreadStep is inserted before the steps starting
+      // a new stage, so each stage runs in its own thread. By default the
+      // reader, the other steps and the writer each form a stage.
+      // Independently, msin.readahead and msout.writebehind insert a
+      // ThreadStep after the reader and before the writer.
+      // The queue sizes of ThreadSteps at the same place are combined.
+      bool pipeline = parset.getBool ("pipeline", false);
+      uint queueSize = parset.getUint ("pipeline.queuesize", 4);
+      uint readAhead = parset.getUint ("msin.readahead", 0);
+      uint writeBehind = parset.getUint ("msout.writebehind", 0);
+      vector<string> defStages;
+      if (! steps.empty()) {
+        defStages.push_back (steps[0]);
+      }
+      defStages.push_back ("msout");
+      vector<string> stages = parset.getStringVector ("pipeline.stages",
+                                                      defStages);
+      lastStep = firstStep;
+      for (uint i=0; i<chain.size(); ++i) {
+        uint nqueue = 0;
+        if (pipeline  &&  std::find (stages.begin(), stages.end(),
+                                     chainNames[i]) != stages.end()) {
+          nqueue = queueSize;
+        }
+        if (i == 0) {
+          nqueue = std::max (nqueue, readAhead);
+        }
+        if (i == chain.size() - 1) {
+          nqueue = std::max (nqueue, writeBehind);
+        }
+        if (nqueue > 0) {
+          step = DPStep::ShPtr (new ThreadStep (chainNames[i] + '.', nqueue));
+          lastStep->setNextStep (step);
+          lastStep = step;
+        }
+        lastStep->setNextStep (chain[i]);
+        lastStep = chain[i];
+      }
 
       // Let all steps fill their info using the info from the previous step.
       DPInfo lastInfo = firstStep->setInfo (DPInfo());
@@ -292,32 +292,28 @@ namespace LOFAR {
     void GainCal::fillMatrices (casa::Complex* model, casa::Complex* data, float* weight,
                                 const casa::Bool* flag) {
       const size_t nBl = info().nbaselines();
-      const size_t nCh = info().nchan();
+      const int nCh = info().nchan();    // OpenMP 2.5 needs signed iteration variables
       const size_t nCr = 4;
+      const Vector<Int>& antenna1 = info().getAnt1();
+      const Vector<Int>& antenna2 = info().getAnt2();
+
+      // Each channel fills its own part of the matrices.
+#pragma omp parallel for
+      for (int ch=0;ch<nCh;++ch) {
+        StefCal& solver = iS[ch/itsNChan];
+        const std::vector<int>& antMap = solver.getAntMap();
 
-      for (uint ch=0;ch<nCh;++ch) {
         for (uint bl=0;bl<nBl;++bl) {
-          int ant1=iS[ch/itsNChan].getAntMap()[info().getAnt1()[bl]];
-          int ant2=iS[ch/itsNChan].getAntMap()[info().getAnt2()[bl]];
+          int ant1=antMap[antenna1[bl]];
+          int ant2=antMap[antenna2[bl]];
           if (ant1==ant2 || ant1==-1 || ant2 == -1 || flag[bl*nCr*nCh+ch*nCr]) { // Only check flag of cr==0
             continue;
           }
 
           for (uint cr=0;cr<nCr;++cr) {
-            iS[ch/itsNChan].getVis() (IPosition(6,ant1,cr/2,itsNTimes,ch%itsNChan,cr%2,ant2)) =
-                DComplex(data [bl*nCr*nCh+ch*nCr+cr]) *
-                DComplex(sqrt(weight[bl*nCr*nCh+ch*nCr+cr]));
-            iS[ch/itsNChan].getMVis()(IPosition(6,ant1,cr/2,itsNTimes,ch%itsNChan,cr%2,ant2)) =
-                DComplex(model[bl*nCr*nCh+ch*nCr+cr]) *
-                DComplex(sqrt(weight[bl*nCr*nCh+ch*nCr+cr]));
-
-            // conjugate transpose
-            iS[ch/itsNChan].getVis() (IPosition(6,ant2,cr%2,itsNTimes,ch%itsNChan,cr/2,ant1)) =
-                DComplex(conj(data [bl*nCr*nCh+ch*nCr+cr])) *
-                DComplex(sqrt(weight[bl*nCr*nCh+ch*nCr+cr]));
-            iS[ch/itsNChan].getMVis()(IPosition(6,ant2,cr%2,itsNTimes,ch%itsNChan,cr/2,ant1)) =
-                DComplex(conj(model[bl*nCr*nCh+ch*nCr+cr] )) *
-                DComplex(sqrt(weight[bl*nCr*nCh+ch*nCr+cr]));
+            const size_t i = bl*nCr*nCh+ch*nCr+cr;
+            solver.setVis(ant1, ant2, itsNTimes, ch%itsNChan, cr,
+                          data[i], model[i], weight[i]);
           }
         }
       }
@@ -365,27 +361,36 @@ namespace LOFAR {
     void GainCal::stefcal () {
       itsTimerSolve.start();
 
-      for (uint freqCell=0; freqCell<itsNFreqCells; ++freqCell) {
+      const int nFreqCells = itsNFreqCells;   // OpenMP 2.5 needs signed iteration variables
+#pragma omp parallel for
+      for (int freqCell=0; freqCell<nFreqCells; ++freqCell) {
         iS[freqCell].init();
       }
 
-      uint iter=0;
-
+      // Each iteration steps the first frequency cell that has not converged
+      // yet. Only if that one still does not converge, the other cells that
+      // have not converged do a step as well (they are independent, so can
+      // be stepped in parallel). So the cells take the same steps as when
+      // stepping them one after the other.
       std::vector<StefCal::Status> converged(itsNFreqCells,StefCal::NOTCONVERGED);
-      for (;iter<itsMaxIter;++iter) {
-        bool allConverged=true;
-        for (uint freqCell=0; freqCell<itsNFreqCells; ++freqCell) {
-          if (converged[freqCell]==StefCal::CONVERGED) { // Do another step when stalled and not all converged
-            continue;
-          }
-          converged[freqCell] = iS[freqCell].doStep(iter);
-          if (converged[freqCell]==StefCal::NOTCONVERGED) {
-            allConverged = false;
-          }
-          if (allConverged) {
-            break;
+      for (uint iter=0;iter<itsMaxIter;++iter) {
+        int first=0;
+        while (first<nFreqCells && converged[first]==StefCal::CONVERGED) {
+          ++first;
+        }
+        if (first==nFreqCells) {
+          break;
+        }
+        converged[first] = iS[first].doStep(iter);
+        if (converged[first]==StefCal::NOTCONVERGED) {
+#pragma omp parallel for schedule(dynamic)
+          for (int freqCell=first+1; freqCell<nFreqCells; ++freqCell) {
+            if (converged[freqCell]!=StefCal::CONVERGED) { // Do another step when stalled and not all converged
+              converged[freqCell] = iS[freqCell].doStep(iter);
+            }
           }
-        }       } // End niter
+        }
+      } // End niter
 
       for (uint freqCell=0; freqCell<itsNFreqCells; ++freqCell) {
         switch (converged[freqCell]) {
@@ -59,7 +59,8 @@ namespace LOFAR {
       : itsReadVisData   (False),
         itsLastMSTime    (0),
         itsNrRead        (0),
-        itsNrInserted    (0)
+        itsNrInserted    (0),
+        itsNrBytesRead   (0)
     {}
 
     MSReader::MSReader (const string& msName,
@@ -70,7 +71,8 @@ namespace LOFAR {
         itsMissingData   (missingData),
         itsLastMSTime    (0),
         itsNrRead        (0),
-        itsNrInserted    (0)
+        itsNrInserted    (0),
+        itsNrBytesRead   (0)
     {
       NSTimer::StartStop sstime(itsTimer);
       // Get info from parset.
@@ -224,6 +226,9 @@ namespace LOFAR {
         ///cout<<(void*)(itsBuffer.getData().data())<<" upd"<<endl;
       }
       {
+        // Lock before starting the timer, because the fetch functions
+        // (possibly called from other threads) use the same timer.
+        ScopedLock lock(itsIOMutex);
         NSTimer::StartStop sstime(itsTimer);
         ///        itsBuffer.clear();
         // Use time from the current time slot in the MS.
@@ -298,6 +303,7 @@ namespace LOFAR {
               } else {
                 dataCol.getColumn (itsColSlicer, itsBuffer.getData());
               }
+              itsNrBytesRead += itsBuffer.getData().size() * sizeof(Complex);
             }
             ///if (itsNrRead%50 < 4) {
             ///cout<<(void*)(itsBuffer.getData().data())<<" rd2"<<endl;
@@ -309,6 +315,7 @@ namespace LOFAR {
               } else {
                 flagCol.getColumn(itsColSlicer, itsBuffer.getFlags());
               }
+              itsNrBytesRead += itsBuffer.getFlags().size() * sizeof(bool);
               // Set flags if FLAG_ROW is set.
               ROScalarColumn<bool> flagrowCol(itsIter.table(), "FLAG_ROW");
               for (uint i=0; i<itsIter.table().nrow(); ++i) {
@@ -415,7 +422,8 @@ namespace LOFAR {
     {
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
-      os << " MSReader" << endl;
+      os << " MSReader  (" << itsNrBytesRead / (1024.*1024.)
+         << " MB read)" << endl;
     }
 
     void MSReader::prepare (double& firstTime, double& lastTime,
@@ -662,6 +670,7 @@ namespace LOFAR {
 
     void MSReader::getUVW (const RefRows& rowNrs, double time, DPBuffer& buf)
     {
+      ScopedLock lock(itsIOMutex);
       NSTimer::StartStop sstime(itsTimer);
       // Calculate UVWs if empty rownrs (i.e., missing data).
       if (rowNrs.rowVector().empty()) {
@@ -669,11 +678,13 @@ namespace LOFAR {
       } else {
         ROArrayColumn<double> dataCol(itsMS, "UVW");
         dataCol.getColumnCells (rowNrs, buf.getUVW());
+        itsNrBytesRead += buf.getUVW().size() * sizeof(double);
       }
     }
 
     void MSReader::getWeights (const RefRows& rowNrs, DPBuffer& buf)
     {
+      ScopedLock lock(itsIOMutex);
       NSTimer::StartStop sstime(itsTimer);
       Cube<float>& weights = buf.getWeights();
       // Resize if needed (probably when called for first time).
@@ -695,10 +706,12 @@ namespace LOFAR {
             Cube<float> w = wsCol.getColumnCells (rowNrs);
             weights = w(itsArrSlicer);
           }
+          itsNrBytesRead += weights.size() * sizeof(float);
         } else {
           // No spectrum present; get global weights and assign to each channel.
           ROArrayColumn<float> wCol(itsMS, "WEIGHT");
           Matrix<float> inArr = wCol.getColumnCells (rowNrs);
+          itsNrBytesRead += inArr.size() * sizeof(float);
           float* inPtr  = inArr.data();
           float* outPtr = weights.data();
           for (uint i=0; i<itsNrBl; ++i) {
@@ -773,6 +786,7 @@ namespace LOFAR {
 
     bool MSReader::getFullResFlags (const RefRows& rowNrs, DPBuffer& buf)
     {
+      ScopedLock lock(itsIOMutex);
       NSTimer::StartStop sstime(itsTimer);
       Cube<bool>& flags = buf.getFullResFlags();
       int norigchan = itsNrChan * itsFullResNChanAvg;
@@ -793,6 +807,7 @@ namespace LOFAR {
       ROArrayColumn<uChar> fullResFlagCol(itsMS, "LOFAR_FULL_RES_FLAG");
       int origstart = itsStartChan * itsFullResNChanAvg;
       Array<uChar> chars = fullResFlagCol.getColumnCells (rowNrs);
+      itsNrBytesRead += chars.size();
       // The original flags are kept per channel, not per corr.
       // Per row the flags are stored as uchar[nchar,navgtime].
       // Each char contains a bit per channel, thus nchan/8 chars are needed.
@@ -821,6 +836,7 @@ namespace LOFAR {
     void MSReader::getModelData (const casa::RefRows& rowNrs,
                                  casa::Cube<casa::Complex>& arr)
     {
+      ScopedLock lock(itsIOMutex);
       NSTimer::StartStop sstime(itsTimer);
       if (rowNrs.rowVector().empty()) {
         arr.resize (itsNrCorr, itsNrChan, itsNrBl);
@@ -832,6 +848,7 @@ namespace LOFAR {
         } else {
           modelCol.getColumnCells (rowNrs, itsColSlicer, arr);
         }
+        itsNrBytesRead += arr.size() * sizeof(Complex);
       }
     }
 
@@ -55,7 +55,8 @@ namespace LOFAR {
         itsNrDone         (0),
         itsDataColAdded   (false),
         itsWeightColAdded (false),
-        itsWriteHistory   (writeHistory)
+        itsWriteHistory   (writeHistory),
+        itsNrBytesWritten (0)
     {
       itsDataColName   = parset.getString (prefix+"datacolumn",  "");
       itsWeightColName = parset.getString (prefix+"weightcolumn","");
@@ -100,25 +101,34 @@ namespace LOFAR {
     bool MSUpdater::process (const DPBuffer& buf)
     {
       NSTimer::StartStop sstime(itsTimer);
-      if (itsWriteFlags) {
-        putFlags (buf.getRowNrs(), buf.getFlags());
-      }
-      if (itsWriteData) {
-        putData (buf.getRowNrs(), buf.getData());
-      }
+      // Get the weights before locking, because the reader locks as well.
+      const Cube<float>* weights = 0;
       if (itsWriteWeights) {
         if (!buf.getWeights().empty()) {
           // Use weights from buffer
-          putWeights (buf.getRowNrs(), buf.getWeights());
+          weights = &buf.getWeights();
         } else {
           itsBuffer.referenceFilled (buf);
-          putWeights (buf.getRowNrs(),
-                      itsReader->fetchWeights(buf, itsBuffer, itsTimer));
+          weights = &itsReader->fetchWeights(buf, itsBuffer, itsTimer);
         }
       }
-      itsNrDone++;
-      if (itsNrTimesFlush > 0  &&  itsNrDone%itsNrTimesFlush == 0) {
-        itsMS.flush();
+      {
+        // The reader might access the MS at the same time in another
+        // thread (e.g. when reading ahead).
+        ScopedLock lock(itsReader->ioMutex());
+        if (itsWriteFlags) {
+          putFlags (buf.getRowNrs(), buf.getFlags());
+        }
+        if (itsWriteData) {
+          putData (buf.getRowNrs(), buf.getData());
+        }
+        if (itsWriteWeights) {
+          putWeights (buf.getRowNrs(), *weights);
+        }
+        itsNrDone++;
+        if (itsNrTimesFlush > 0  &&  itsNrDone%itsNrTimesFlush == 0) {
+          itsMS.flush();
+        }
       }
       getNextStep()->process(buf);
       return true;
@@ -223,7 +233,8 @@ namespace LOFAR {
     {
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
-      os << " MSUpdater " << itsName << endl;
+      os << " MSUpdater " << itsName << "  ("
+         << itsNrBytesWritten / (1024.*1024.) << " MB written)" << endl;
     }
 
     void MSUpdater::putFlags (const RefRows& rowNrs,
@@ -241,6 +252,7 @@ namespace LOFAR {
         ReadOnlyArrayIterator<bool> flagIter (flags, 2);
         for (uint i=0; i<rows.size(); ++i) {
           flagCol.putSlice (rows[i], colSlicer, flagIter.array());
+          itsNrBytesWritten += flagIter.array().size() * sizeof(bool);
           // If a new flag in a row is clear, the ROW_FLAG should not be set.
           // If all new flags are set, we leave it because we might have a
           // subset of the channels, so other flags might still be clear.
@@ -266,6 +278,7 @@ namespace LOFAR {
         ReadOnlyArrayIterator<float> weightIter (weights, 2);
         for (uint i=0; i<rows.size(); ++i) {
           weightCol.putSlice (rows[i], colSlicer, weightIter.array());
+          itsNrBytesWritten += weightIter.array().size() * sizeof(float);
           weightIter.next();
         }
       }
@@ -286,6 +299,7 @@ namespace LOFAR {
         ReadOnlyArrayIterator<Complex> dataIter (data, 2);
         for (uint i=0; i<rows.size(); ++i) {
           dataCol.putSlice (rows[i], colSlicer, dataIter.array());
+          itsNrBytesWritten += dataIter.array().size() * sizeof(Complex);
           dataIter.next();
         }
       }
@@ -29,6 +29,7 @@
 #include <DPPP/DPInfo.h>
 #include <DPPP/DPLogger.h>
 #include <MS/VdsMaker.h>
+#include <CompressStMan/CompressStMan.h>
 #include <Common/ParameterSet.h>
 #include <tables/Tables/TableCopy.h>
 #if defined(casacore)
@@ -59,7 +60,8 @@ namespace LOFAR {
         itsName         (prefix),
         itsOutName      (outName),
         itsParset       (parset),
-        itsNrDone       (0)
+        itsNrDone       (0),
+        itsNrBytesWritten (0)
     {
       // Get tile size (default 1024 KBytes).
       itsTileSize          = parset.getUint (prefix+"tilesize", 1024);
@@ -74,6 +76,20 @@ namespace LOFAR {
                                "WEIGHT_SPECTRUM");
       itsVdsDir            = parset.getString (prefix+"vdsdir", string());
       itsClusterDesc       = parset.getString (prefix+"clusterdesc", string());
+      itsStManName         = toLower (parset.getString
+                                      (prefix+"storagemanager", string()));
+      itsDataBits          = parset.getUint
+                                      (prefix+"storagemanager.databits", 16);
+      itsWeightBits        = parset.getUint
+                                      (prefix+"storagemanager.weightbits", 16);
+      ASSERTSTR (itsStManName.empty()  ||  itsStManName == "compress",
+                 "Unknown storage manager " << itsStManName << " given in "
+                 << prefix << "storagemanager; use compress or leave empty");
+      if (itsStManName == "compress") {
+        // Make the storage manager known to the table system, so the
+        // MS can be reopened in a later step.
+        CompressStMan::registerClass();
+      }
       ASSERTSTR (itsDataColName == "DATA", "Currently only the DATA column"
                  " can be used as output when writing a new MS");
       ASSERTSTR (itsWeightColName == "WEIGHT_SPECTRUM", "Currently only the "
@@ -181,17 +197,24 @@ namespace LOFAR {
       os << "  time interval:  " << itsInterval << std::endl;
       os << "  DATA column:    " << itsDataColName << std::endl;
       os << "  WEIGHT column:  " << itsWeightColName << std::endl;
+      if (itsStManName.empty()) {
+        os << "  storage manager: TiledColumnStMan" << std::endl;
+      } else {
+        os << "  storage manager: CompressStMan (databits=" << itsDataBits
+           << ", weightbits=" << itsWeightBits << ')' << std::endl;
+      }
     }
 
     void MSWriter::showTimings (std::ostream& os, double duration) const
     {
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
-      os << " MSWriter " << itsName << endl;
+      os << " MSWriter " << itsName << "  ("
+         << itsNrBytesWritten / (1024.*1024.) << " MB written)" << endl;
     }
 
     void MSWriter::makeArrayColumn (ColumnDesc desc, const IPosition& ipos,
-                                    TiledColumnStMan* tsm, Table& table)
+                                    DataManager* dm, Table& table)
     {
       desc.setOptions(0);
       desc.setShape(ipos);
@@ -199,11 +222,11 @@ namespace LOFAR {
       if (table.tableDesc().isColumn(desc.name())) {
         table.removeColumn(desc.name());
       }
-      // Use tiled storage manager if given.
-      if (tsm == 0) {
+      // Use the storage manager if given.
+      if (dm == 0) {
         table.addColumn (desc);
       } else {
-        table.addColumn (desc, *tsm);
+        table.addColumn (desc, *dm);
       }
     }
 
@@ -311,18 +334,48 @@ namespace LOFAR {
       // Bind all columns according to dminfo.
       newtab.bindCreate (dminfo);
       itsMS = Table(newtab);
-      {
-        // Add DATA column using tsm.
-        TiledColumnStMan tsm("TiledData", tileShape);
-        makeArrayColumn (tdesc["DATA"], dataShape, &tsm, itsMS);
-      }
-      {
-        // Add FLAG column using tsm.
-        // Use larger tile shape because flags are stored as bits.
-        IPosition tileShapeF(tileShape);
-        tileShapeF[2] *= 8;
-        TiledColumnStMan tsmf("TiledFlag", tileShapeF);
-        makeArrayColumn(tdesc["FLAG"], dataShape, &tsmf, itsMS);
+      if (itsStManName == "compress") {
+        // Add DATA, FLAG and WEIGHT_SPECTRUM using the compressing
+        // storage manager. The columns must be added in one go, because
+        // its row layout cannot change once the table has rows.
+        TableDesc cdesc;
+        cdesc.addColumn (tdesc["DATA"]);
+        cdesc.addColumn (tdesc["FLAG"]);
+        cdesc.addColumn (ArrayColumnDesc<float>("WEIGHT_SPECTRUM",
+                                                "weight per corr/chan"));
+        for (uint i=0; i<cdesc.ncolumn(); ++i) {
+          ColumnDesc& cd = cdesc.rwColumnDesc(i);
+          cd.setOptions(0);
+          cd.setShape(dataShape);
+          cd.setOptions(ColumnDesc::FixedShape);
+          if (itsMS.tableDesc().isColumn(cd.name())) {
+            itsMS.removeColumn(cd.name());
+          }
+        }
+        CompressStMan csm("CompressData", itsDataBits, itsWeightBits);
+        itsMS.addColumn (cdesc, csm);
+      } else {
+        {
+          // Add DATA column using tsm.
+          TiledColumnStMan tsm("TiledData", tileShape);
+          makeArrayColumn (tdesc["DATA"], dataShape, &tsm, itsMS);
+        }
+        {
+          // Add FLAG column using tsm.
+          // Use larger tile shape because flags are stored as bits.
+          IPosition tileShapeF(tileShape);
+          tileShapeF[2] *= 8;
+          TiledColumnStMan tsmf("TiledFlag", tileShapeF);
+          makeArrayColumn(tdesc["FLAG"], dataShape, &tsmf, itsMS);
+        }
+        {
+          // Add WEIGHT_SPECTRUM column using tsm.
+          TiledColumnStMan tsmw("TiledWeightSpectrum", tileShape);
+          ArrayColumnDesc<float> wsdesc("WEIGHT_SPECTRUM",
+                                        "weight per corr/chan",
+                                        dataShape, ColumnDesc::FixedShape);
+          makeArrayColumn(wsdesc, dataShape, &tsmw, itsMS);
+        }
       }
       if (itsWriteFullResFlags) {
         // Add LOFAR_FULL_RES_FLAG column using tsm.
@@ -337,13 +390,6 @@ namespace LOFAR {
                                       dataShapeF, ColumnDesc::FixedShape);
         makeArrayColumn(padesc, dataShapeF, &tsmf, itsMS);
       }
-      {
-        // Add WEIGHT_SPECTRUM column using tsm.
-        TiledColumnStMan tsmw("TiledWeightSpectrum", tileShape);
-        ArrayColumnDesc<float> wsdesc("WEIGHT_SPECTRUM", "weight per corr/chan",
-                                      dataShape, ColumnDesc::FixedShape);
-        makeArrayColumn(wsdesc, dataShape, &tsmw, itsMS);
-      }
       // If present handle the CORRECTED_DATA and MODEL_DATA column.
       if (!tdesc.isColumn("CORRECTED_DATA")) {
         itsCopyCorrData = false;
@@ -513,6 +559,8 @@ namespace LOFAR {
       // A row is flagged if no flags in the row are False.
       Vector<Bool> rowFlags (partialNFalse(buf.getFlags(), IPosition(2,0,1)) == 0u);
       flagRowCol.putColumn (rowFlags);
+      itsNrBytesWritten += buf.getData().size() * sizeof(Complex) +
+                           buf.getFlags().size() * sizeof(Bool);
       if (itsWriteFullResFlags) {
         writeFullResFlags (out, buf);
       }
@@ -524,9 +572,11 @@ namespace LOFAR {
       const Array<Float>& weights = itsReader->fetchWeights (buf, itsBuffer,
                                                              itsTimer);
       weightCol.putColumn (weights);
+      itsNrBytesWritten += weights.size() * sizeof(Float);
       const Array<Double>& uvws = itsReader->fetchUVW (buf, itsBuffer,
                                                        itsTimer);
       uvwCol.putColumn (uvws);
+      itsNrBytesWritten += uvws.size() * sizeof(Double);
     }
 
     void MSWriter::writeFullResFlags (Table& out, const DPBuffer& buf)
@@ -562,6 +612,7 @@ namespace LOFAR {
         fullResCol.rwKeywordSet().define ("NTIME_AVG", int(itsNTimeAvg));
       }
       fullResCol.putColumn (chars);
+      itsNrBytesWritten += chars.size();
     } 
 
     void MSWriter::writeMeta (Table& out, const DPBuffer& buf)
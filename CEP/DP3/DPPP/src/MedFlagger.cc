@@ -23,12 +23,14 @@
 
 #include <lofar_config.h>
 #include <DPPP/MedFlagger.h>
+#include <DPPP/MedianWindow.h>
 #include <DPPP/DPBuffer.h>
 #include <DPPP/DPInfo.h>
 #include <Common/ParameterSet.h>
 #include <Common/StreamUtil.h>
 #include <Common/LofarLogger.h>
 #include <casa/Arrays/ArrayMath.h>
+#include <casa/BasicMath/Math.h>
 #include <casa/Containers/Record.h>
 #include <casa/Containers/RecordField.h>
 #include <tables/Tables/ExprNode.h>
@@ -284,10 +286,13 @@ namespace LOFAR {
       // This can be done in parallel.
 #pragma omp parallel
       {
-        // Create a temporary buffer (per thread) to hold data for determining
-        // the medians.
+        // Create the median windows (per thread) for the correlations
+        // to flag on.
         // Also create thread-private counter and timer objects.
-        Block<float> tempBuf(itsFreqWindow*ntime);
+        vector<MedianWindow> windows(itsFlagCorr.size());
+        vector<uint> multiplicity(nchan);
+        vector<uint> centerPos;
+        centerPos.reserve (ntime);
         FlagCounter counter;
         counter.init (getInfo());
         NSTimer moveTimer;
@@ -307,12 +312,55 @@ namespace LOFAR {
           if ((!itsApplyAutoCorr  &&  itsBLength[ib] >= itsMinBLength  &&
               itsBLength[ib] <= itsMaxBLength)  ||
               (itsApplyAutoCorr  &&  ant1[ib] == ant2[ib])) {
+            moveTimer.start();
+            uint ntimeBl = std::min (itsTimeWindowArr[ib], ntime);
+            int hw = itsFreqWindowArr[ib]/2;
+            // Find the positions in the time window of the entry to flag.
+            // Flags set in it have to be removed from the windows.
+            centerPos.clear();
+            for (uint it=0; it<ntimeBl; ++it) {
+              if (timeEntries[it] == index) {
+                centerPos.push_back (it);
+              }
+            }
+            for (uint iw=0; iw<windows.size(); ++iw) {
+              windows[iw].gather (itsAmpl, itsBuf, &(timeEntries[0]),
+                                  ntimeBl, ib, itsFlagCorr[iw], nchan, ncorr);
+            }
+            // Fill the window of channel 0.
+            // The channels are mirrored at the edges, so a channel can
+            // occur multiple times in a window.
+            // This is tested in tMirror.cc.
+            std::fill (multiplicity.begin(), multiplicity.end(), 0);
+            for (int k=-hw; k<=hw; ++k) {
+              uint chan = mirrorChannel (k, nchan);
+              multiplicity[chan]++;
+              for (uint iw=0; iw<windows.size(); ++iw) {
+                windows[iw].addChannel (chan);
+              }
+            }
+            moveTimer.stop();
             for (uint ic=0; ic<nchan; ++ic) {
+              moveTimer.start();
+              if (ic > 0) {
+                // Slide the window one channel.
+                uint chanOut = mirrorChannel (int(ic)-1-hw, nchan);
+                uint chanIn  = mirrorChannel (int(ic)+hw, nchan);
+                multiplicity[chanOut]--;
+                multiplicity[chanIn]++;
+                for (uint iw=0; iw<windows.size(); ++iw) {
+                  windows[iw].removeChannel (chanOut);
+                  windows[iw].addChannel (chanIn);
+                }
+              }
+              for (uint iw=0; iw<windows.size(); ++iw) {
+                windows[iw].update();
+              }
+              moveTimer.stop();
               bool corrIsFlagged = false;
               // Iterate over given correlations.
-              for (vector<uint>::const_iterator iter = itsFlagCorr.begin();
-                  iter != itsFlagCorr.end(); ++iter) {
-                uint ip = *iter;
+              for (uint iw=0; iw<itsFlagCorr.size(); ++iw) {
+                uint ip = itsFlagCorr[iw];
                 // If one correlation is flagged, all of them will be flagged.
                 // So no need to check others.
                 if (flagPtr[ip]) {
@@ -320,9 +368,16 @@ namespace LOFAR {
                   break;
                 }
                 // Calculate values from the median.
-                computeFactors (timeEntries, ib, ic, ip, nchan, ncorr,
-                    Z1, Z2, tempBuf.storage(),
-                    moveTimer, medianTimer);
+                // If only flagged data, don't do anything.
+                if (windows[iw].size() == 0) {
+                  Z1 = -1.0;
+                  Z2 = 0.0;
+                } else {
+                  medianTimer.start();
+                  Z1 = windows[iw].median();
+                  Z2 = windows[iw].medianAbsDiff (Z1);
+                  medianTimer.stop();
+                }
                 if (dataPtr[ip] > Z1 + threshold * Z2 * MAD) {
                   corrIsFlagged = true;
                   counter.incrBaseline(ib);
@@ -332,6 +387,11 @@ namespace LOFAR {
                 }
               }
               if (corrIsFlagged) {
+                // The new flags also apply to the windows of the next
+                // channels.
+                for (uint iw=0; iw<windows.size(); ++iw) {
+                  windows[iw].flagChannel (ic, centerPos, multiplicity[ic]);
+                }
                 for (uint ip=0; ip<ncorr; ++ip) {
                   flagPtr[ip] = true;
                 }
@@ -402,76 +462,6 @@ namespace LOFAR {
       itsTimer.start();
     }
             
-    void MedFlagger::computeFactors (const vector<uint>& timeEntries,
-                                     uint bl, int chan, int corr,
-                                     int nchan, int ncorr,
-                                     float& Z1, float& Z2,
-                                     float* tempBuf,
-                                     NSTimer& moveTimer, NSTimer& medianTimer)
-    {
-      moveTimer.start();
-      // Collect all non-flagged data points for given baseline, channel,
-      // and correlation in the window around the channel.
-      uint np = 0;
-      // At the beginning or end of the window the values are wrapped.
-      // So we might need to move in two parts.
-      // This little piece of code is tested in tMirror.cc.
-      int hw = itsFreqWindowArr[bl]/2;
-      int s1 = chan - hw;
-      int e1 = chan + hw + 1;
-      int s2 = 1;
-      int e2 = 1;
-      if (s1 < 0) {
-        e2 = -s1 + 1;
-        s1 = 0;
-      } else if (e1 > nchan) {
-        s2 = nchan + nchan - e1 - 1; // e1-nchan+1 too far, go back that amount
-        e2 = nchan-1;
-        e1 = nchan;
-      }
-      // Iterate over all time entries.
-      const uint* iter = &(timeEntries[0]);
-      const uint* endIter = iter + itsTimeWindowArr[bl];
-      for (; iter!=endIter; ++iter) {
-        const DPBuffer& inbuf = itsBuf[*iter];
-        const Cube<float>& ampl = itsAmpl[*iter];
-        // Get pointers to given baseline and correlation.
-        uint offset = bl*nchan*ncorr + corr;
-        const float* dataPtr = ampl.data() + offset;
-        const bool*  flagPtr = inbuf.getFlags().data() + offset;
-        // Now move data from the two channel parts.
-        for (int i=s1*ncorr; i<e1*ncorr; i+=ncorr) {
-          if (!flagPtr[i]) {
-            tempBuf[np++] = dataPtr[i];
-          }
-        }
-        for (int i=s2*ncorr; i<e2*ncorr; i+=ncorr) {
-          if (!flagPtr[i]) {
-            tempBuf[np++] = dataPtr[i];
-          }
-        }
-      }
-      moveTimer.stop();
-      // If only flagged data, don't do anything.
-      if (np == 0) {
-        Z1 = -1.0;
-        Z2 = 0.0;
-      } else {
-        medianTimer.start();
-        // Get median of data and get median of absolute difference.
-        ///std::nth_element (tempBuf, tempBuf+np/2, tempBuf+np);
-        ///Z1 = *(tempBuf+np/2);
-        Z1 = GenSort<float>::kthLargest (tempBuf, np, np/2);
-        for (uint i=0; i<np; ++i) {
-          tempBuf[i] = std::abs(tempBuf[i] - Z1);
-        }
-        ///std::nth_element (tempBuf, tempBuf+np/2, tempBuf+np);
-        ///Z2 = *(tempBuf+np/2);
-        Z2 = GenSort<float>::kthLargest (tempBuf, np, np/2);
-        medianTimer.stop();
-      }
-    }
-
     void MedFlagger::getExprValues (int maxNChan, int maxNTime)
     {
       // Parse the expressions.
@@ -0,0 +1,147 @@
+//# MedianWindow.cc: Sliding time/frequency window to determine medians
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <DPPP/MedianWindow.h>
+#include <DPPP/DPBuffer.h>
+#include <Common/LofarLogger.h>
+#include <casa/BasicMath/Math.h>
+#include <algorithm>
+
+using namespace casa;
+
+namespace LOFAR {
+  namespace DPPP {
+
+    void MedianWindow::gather (const vector<Cube<float> >& ampl,
+                               const vector<DPBuffer>& bufs,
+                               const uint* timeEntries, uint ntime,
+                               uint bl, uint corr, uint nchan, uint ncorr)
+    {
+      itsNTime = ntime;
+      itsNChan = nchan;
+      itsAmpl.resize (ntime*nchan);
+      itsFlags.resize (ntime*nchan);
+      uint offset = bl*nchan*ncorr + corr;
+      for (uint it=0; it<ntime; ++it) {
+        const float* dataPtr = ampl[timeEntries[it]].data() + offset;
+        const bool*  flagPtr = bufs[timeEntries[it]].getFlags().data() + offset;
+        float* amplOut = &(itsAmpl[it*nchan]);
+        char*  flagOut = &(itsFlags[it*nchan]);
+        for (uint ic=0; ic<nchan; ++ic) {
+          amplOut[ic] = dataPtr[ic*ncorr];
+          // A NaN cannot be ordered, so it is treated as flagged.
+          flagOut[ic] = flagPtr[ic*ncorr] || isNaN(amplOut[ic]);
+        }
+      }
+      itsValues.clear();
+      itsAdd.clear();
+      itsRemove.clear();
+    }
+
+    void MedianWindow::flagChannel (uint chan, const vector<uint>& timePos,
+                                    uint multiplicity)
+    {
+      for (vector<uint>::const_iterator iter=timePos.begin();
+           iter!=timePos.end(); ++iter) {
+        uint inx = *iter*itsNChan + chan;
+        if (!itsFlags[inx]) {
+          itsFlags[inx] = true;
+          for (uint i=0; i<multiplicity; ++i) {
+            itsRemove.push_back (itsAmpl[inx]);
+          }
+        }
+      }
+    }
+
+    void MedianWindow::update()
+    {
+      std::sort (itsAdd.begin(), itsAdd.end());
+      std::sort (itsRemove.begin(), itsRemove.end());
+      itsTemp.clear();
+      itsTemp.reserve (itsValues.size() + itsAdd.size());
+      vector<float>::iterator addIter = itsAdd.begin();
+      vector<float>::iterator remIter = itsRemove.begin();
+      for (vector<float>::const_iterator iter=itsValues.begin();
+           iter!=itsValues.end(); ++iter) {
+        // The removed values are a subset of the values.
+        if (remIter != itsRemove.end()  &&  *remIter == *iter) {
+          ++remIter;
+        } else {
+          while (addIter != itsAdd.end()  &&  *addIter < *iter) {
+            itsTemp.push_back (*addIter++);
+          }
+          itsTemp.push_back (*iter);
+        }
+      }
+      DBGASSERT (remIter == itsRemove.end());
+      itsTemp.insert (itsTemp.end(), addIter, itsAdd.end());
+      itsValues.swap (itsTemp);
+      itsAdd.clear();
+      itsRemove.clear();
+    }
+
+    float MedianWindow::medianAbsDiff (float median) const
+    {
+      // The differences left of the median (going down) and right of it
+      // (going up) are both sorted, so element n/2 of their merge can be
+      // found with a binary search on the number of elements taken from
+      // the left side.
+      const float* values = &(itsValues[0]);
+      int np = itsValues.size();
+      int mid = np/2;
+      int nleft  = mid;          // differences median-values[mid-1-i]
+      int nright = np - mid;     // differences values[mid+j]-median
+      int ntake  = mid + 1;      // the number of smallest differences
+      int lo = std::max (0, ntake - nright);
+      int hi = std::min (ntake, nleft);
+      while (lo < hi) {
+        int nl = (lo + hi) / 2;
+        int nr = ntake - nl;
+        if (nr == 0  ||  values[mid+nr-1] - median <= median - values[mid-1-nl]) {
+          hi = nl;
+        } else {
+          lo = nl + 1;
+        }
+      }
+      int nr = ntake - lo;
+      float diff = 0;
+      if (lo > 0) {
+        diff = median - values[mid-lo];
+      }
+      if (nr > 0) {
+        diff = std::max (diff, values[mid+nr-1] - median);
+      }
+      return diff;
+    }
+
+    void MedianWindow::collect (uint chan, vector<float>& out) const
+    {
+      for (uint it=0; it<itsNTime; ++it) {
+        uint inx = it*itsNChan + chan;
+        if (!itsFlags[inx]) {
+          out.push_back (itsAmpl[inx]);
+        }
+      }
+    }
+
+  } //# end namespace
+}
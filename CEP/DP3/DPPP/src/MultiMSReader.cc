@@ -403,6 +403,8 @@ namespace LOFAR {
       }
       IPosition s(3, 0, 0, 0);
       IPosition e(3, itsNrCorr-1, 0, itsNrBl-1);
+      // Steps after a ThreadStep can call this from different threads.
+      ScopedLock lock(itsBuffersMutex);
       for (uint i=0; i<itsReaders.size(); ++i) {
         if (itsReaders[i]) {
           uint nchan = itsReaders[i]->getInfo().nchan();
@@ -439,6 +441,7 @@ namespace LOFAR {
       // Get the flags from all MSs and combine them.
       IPosition s(3, 0);
       IPosition e(flags.shape() - 1);
+      ScopedLock lock(itsBuffersMutex);
       for (uint i=0; i<itsReaders.size(); ++i) {
         if (itsReaders[i]) {
           itsReaders[i]->getFullResFlags (rowNrs, itsBuffers[i]);
@@ -69,10 +69,11 @@ namespace LOFAR {
 
     void StefCal::resetVis(uint nSt) {
       _nSt = nSt;
-      _vis.resize(IPosition(6,nSt,2,_solInt,_nChan,2,nSt));
-      _mvis.resize(IPosition(6,nSt,2,_solInt,_nChan,2,nSt));
-      _vis=0;
-      _mvis=0;
+      const size_t vissize = size_t(nSt)*2*_solInt*_nChan*2*nSt;
+      _visRe.assign(vissize, 0.);
+      _visIm.assign(vissize, 0.);
+      _mvisRe.assign(vissize, 0.);
+      _mvisIm.assign(vissize, 0.);
 
       if (_mode=="fulljones" || _mode=="scalarphase") {
         _nUn = _nSt;
@@ -91,20 +92,17 @@ namespace LOFAR {
       _gold.resize(_nUn,_nCr);
       _gx.resize(_nUn,_nCr);
       _gxx.resize(_nUn,_nCr);
-      _h.resize(_nUn,_nCr);
-      _z.resize(_nUn*_nChan*_solInt*_nSp,_nCr);
+      _hRe.resize(_nUn*_nCr);
+      _hIm.resize(_nUn*_nCr);
 
       // Initialize all vectors
       double fronormvis=0;
       double fronormmod=0;
 
-      DComplex* t_vis_p=_vis.data();
-      DComplex* t_mvis_p=_mvis.data();
-
-      uint vissize=_vis.size();
-      for (uint i=0;i<vissize;++i) {
-        fronormvis+=norm(t_vis_p[i]);
-        fronormmod+=norm(t_mvis_p[i]);
+      size_t vissize=_visRe.size();
+      for (size_t i=0;i<vissize;++i) {
+        fronormvis+=_visRe[i]*_visRe[i] + _visIm[i]*_visIm[i];
+        fronormmod+=_mvisRe[i]*_mvisRe[i] + _mvisIm[i]*_mvisIm[i];
       }
 
       fronormvis=sqrt(fronormvis);
@@ -140,108 +138,147 @@ namespace LOFAR {
       }
     }
 
+    // The steps below work on the split real and imaginary parts, and sum
+    // over the stations in the innermost loops, which the compiler can
+    // vectorize (OpenMP 4.0 "omp simd" tells it so). Instead of storing the
+    // internal stefcal vector z, they accumulate its products with itself
+    // and with the visibilities at once.
+
     void StefCal::doStep_polarized() {
       _gold = _g;
 
-      for (uint st=0;st<_nSt;++st) {
-        _h(st,0)=conj(_g(st,0));
-        _h(st,1)=conj(_g(st,1));
-        _h(st,2)=conj(_g(st,2));
-        _h(st,3)=conj(_g(st,3));
+      if (_nSt==0) {
+        return;
       }
 
-      for (uint st1=0;st1<_nSt;++st1) {
-        DComplex* vis_p;
-        DComplex* mvis_p;
-        Vector<DComplex> w(_nCr);
-        Vector<DComplex> t(_nCr);
-
-        for (uint time=0;time<_solInt;++time) {
-          for (uint ch=0;ch<_nChan;++ch) {
-            uint zoff=_nSt*ch+_nSt*_nChan*time;
-            mvis_p=&_mvis(IPosition(6,0,0,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,0)  = _h(st2,0) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,0,time,ch,0,st1))
-            mvis_p=&_mvis(IPosition(6,0,1,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,0) += _h(st2,2) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,0,time,ch,1,st1))
-            mvis_p=&_mvis(IPosition(6,0,0,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,1)  = _h(st2,0) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,1,time,ch,0,st1))
-            mvis_p=&_mvis(IPosition(6,0,1,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,1) += _h(st2,2) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,1,time,ch,1,st1))
-            mvis_p=&_mvis(IPosition(6,0,0,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,2)  = _h(st2,1) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,0,time,ch,0,st1))
-            mvis_p=&_mvis(IPosition(6,0,1,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,2) += _h(st2,3) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,0,time,ch,1,st1))
-            mvis_p=&_mvis(IPosition(6,0,0,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,3)  = _h(st2,1) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,1,time,ch,0,st1))
-            mvis_p=&_mvis(IPosition(6,0,1,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,3) += _h(st2,3) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,1,time,ch,1,st1))
-          }
+      for (uint cr=0;cr<4;++cr) {
+        for (uint st=0;st<_nSt;++st) {
+          _hRe[cr*_nSt+st]=  real(_g(st,cr));
+          _hIm[cr*_nSt+st]= -imag(_g(st,cr));
         }
+      }
 
-        w=0;
+      const double* h0Re=&_hRe[0];      const double* h0Im=&_hIm[0];
+      const double* h1Re=&_hRe[_nSt];   const double* h1Im=&_hIm[_nSt];
+      const double* h2Re=&_hRe[2*_nSt]; const double* h2Im=&_hIm[2*_nSt];
+      const double* h3Re=&_hRe[3*_nSt]; const double* h3Im=&_hIm[3*_nSt];
 
-        for (uint time=0;time<_solInt;++time) {
-          for (uint ch=0;ch<_nChan;++ch) {
-            for (uint st2=0;st2<_nSt;++st2) {
-              uint zoff=st2+_nSt*ch+_nSt*_nChan*time;
-              w(0) += conj(_z(zoff,0))*_z(zoff,0) + conj(_z(zoff,2))*_z(zoff,2);
-              w(1) += conj(_z(zoff,0))*_z(zoff,1) + conj(_z(zoff,2))*_z(zoff,3);
-              w(3) += conj(_z(zoff,1))*_z(zoff,1) + conj(_z(zoff,3))*_z(zoff,3);
-            }
-          }
-        }
-        w(2)=conj(w(1));
-
-        t=0;
-
-        for (uint time=0;time<_solInt;++time) {
-          for (uint ch=0;ch<_nChan;++ch) {
-            vis_p=&_vis(IPosition(6,0,0,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { t(0) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,0)) * vis_p[st2]; }// itsVis(IPosition(6,st2,0,time,ch,0,st1))
-            vis_p=&_vis(IPosition(6,0,1,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { t(0) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,2)) * vis_p[st2]; }// itsVis(IPosition(6,st2,0,time,ch,1,st1))
-            vis_p=&_vis(IPosition(6,0,0,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { t(1) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,0)) * vis_p[st2]; }// itsVis(IPosition(6,st2,1,time,ch,0,st1))
-            vis_p=&_vis(IPosition(6,0,1,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { t(1) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,2)) * vis_p[st2]; }// itsVis(IPosition(6,st2,1,time,ch,1,st1))
-            vis_p=&_vis(IPosition(6,0,0,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { t(2) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,1)) * vis_p[st2]; }// itsVis(IPosition(6,st2,0,time,ch,0,st1))
-            vis_p=&_vis(IPosition(6,0,1,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { t(2) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,3)) * vis_p[st2]; }// itsVis(IPosition(6,st2,0,time,ch,1,st1))
-            vis_p=&_vis(IPosition(6,0,0,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { t(3) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,1)) * vis_p[st2]; }// itsVis(IPosition(6,st2,1,time,ch,0,st1))
-            vis_p=&_vis(IPosition(6,0,1,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { t(3) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,3)) * vis_p[st2]; }// itsVis(IPosition(6,st2,1,time,ch,1,st1))
+      const uint nRows=_solInt*_nChan; // (time,ch) combinations
+
+      for (uint st1=0;st1<_nSt;++st1) {
+        double w0=0, w3=0, w1Re=0, w1Im=0;
+        double t0Re=0, t0Im=0, t1Re=0, t1Im=0, t2Re=0, t2Im=0, t3Re=0, t3Im=0;
+
+        for (uint row=0;row<nRows;++row) {
+          // _mvis(IPosition(6,st2,pol2,time,ch,pol1,st1)) is m<pol2><pol1>[st2]
+          const size_t i00=visIndex(0,0,row,0,0,st1); // time+_solInt*ch==row
+          const size_t i10=i00+_nSt;
+          const size_t i01=visIndex(0,0,row,0,1,st1);
+          const size_t i11=i01+_nSt;
+
+          const double* m00Re=&_mvisRe[i00]; const double* m00Im=&_mvisIm[i00];
+          const double* m10Re=&_mvisRe[i10]; const double* m10Im=&_mvisIm[i10];
+          const double* m01Re=&_mvisRe[i01]; const double* m01Im=&_mvisIm[i01];
+          const double* m11Re=&_mvisRe[i11]; const double* m11Im=&_mvisIm[i11];
+          const double* v00Re=&_visRe[i00];  const double* v00Im=&_visIm[i00];
+          const double* v10Re=&_visRe[i10];  const double* v10Im=&_visIm[i10];
+          const double* v01Re=&_visRe[i01];  const double* v01Im=&_visIm[i01];
+          const double* v11Re=&_visRe[i11];  const double* v11Im=&_visIm[i11];
+
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(+:w0,w3,w1Re,w1Im,t0Re,t0Im,t1Re,t1Im,t2Re,t2Im,t3Re,t3Im)
+#endif
+          for (uint st2=0;st2<_nSt;++st2) {
+            // z0 = h0*m00 + h2*m10, z1 = h0*m01 + h2*m11
+            // z2 = h1*m00 + h3*m10, z3 = h1*m01 + h3*m11
+            const double z0Re = h0Re[st2]*m00Re[st2] - h0Im[st2]*m00Im[st2] + h2Re[st2]*m10Re[st2] - h2Im[st2]*m10Im[st2];
+            const double z0Im = h0Re[st2]*m00Im[st2] + h0Im[st2]*m00Re[st2] + h2Re[st2]*m10Im[st2] + h2Im[st2]*m10Re[st2];
+            const double z1Re = h0Re[st2]*m01Re[st2] - h0Im[st2]*m01Im[st2] + h2Re[st2]*m11Re[st2] - h2Im[st2]*m11Im[st2];
+            const double z1Im = h0Re[st2]*m01Im[st2] + h0Im[st2]*m01Re[st2] + h2Re[st2]*m11Im[st2] + h2Im[st2]*m11Re[st2];
+            const double z2Re = h1Re[st2]*m00Re[st2] - h1Im[st2]*m00Im[st2] + h3Re[st2]*m10Re[st2] - h3Im[st2]*m10Im[st2];
+            const double z2Im = h1Re[st2]*m00Im[st2] + h1Im[st2]*m00Re[st2] + h3Re[st2]*m10Im[st2] + h3Im[st2]*m10Re[st2];
+            const double z3Re = h1Re[st2]*m01Re[st2] - h1Im[st2]*m01Im[st2] + h3Re[st2]*m11Re[st2] - h3Im[st2]*m11Im[st2];
+            const double z3Im = h1Re[st2]*m01Im[st2] + h1Im[st2]*m01Re[st2] + h3Re[st2]*m11Im[st2] + h3Im[st2]*m11Re[st2];
+
+            // w0 += |z0|^2 + |z2|^2, w1 += conj(z0)*z1 + conj(z2)*z3, w3 += |z1|^2 + |z3|^2
+            w0   += z0Re*z0Re + z0Im*z0Im + z2Re*z2Re + z2Im*z2Im;
+            w3   += z1Re*z1Re + z1Im*z1Im + z3Re*z3Re + z3Im*z3Im;
+            w1Re += z0Re*z1Re + z0Im*z1Im + z2Re*z3Re + z2Im*z3Im;
+            w1Im += z0Re*z1Im - z0Im*z1Re + z2Re*z3Im - z2Im*z3Re;
+
+            // t0 += conj(z0)*v00 + conj(z2)*v10, t1 += conj(z0)*v01 + conj(z2)*v11
+            // t2 += conj(z1)*v00 + conj(z3)*v10, t3 += conj(z1)*v01 + conj(z3)*v11
+            t0Re += z0Re*v00Re[st2] + z0Im*v00Im[st2] + z2Re*v10Re[st2] + z2Im*v10Im[st2];
+            t0Im += z0Re*v00Im[st2] - z0Im*v00Re[st2] + z2Re*v10Im[st2] - z2Im*v10Re[st2];
+            t1Re += z0Re*v01Re[st2] + z0Im*v01Im[st2] + z2Re*v11Re[st2] + z2Im*v11Im[st2];
+            t1Im += z0Re*v01Im[st2] - z0Im*v01Re[st2] + z2Re*v11Im[st2] - z2Im*v11Re[st2];
+            t2Re += z1Re*v00Re[st2] + z1Im*v00Im[st2] + z3Re*v10Re[st2] + z3Im*v10Im[st2];
+            t2Im += z1Re*v00Im[st2] - z1Im*v00Re[st2] + z3Re*v10Im[st2] - z3Im*v10Re[st2];
+            t3Re += z1Re*v01Re[st2] + z1Im*v01Im[st2] + z3Re*v11Re[st2] + z3Im*v11Im[st2];
+            t3Im += z1Re*v01Im[st2] - z1Im*v01Re[st2] + z3Re*v11Im[st2] - z3Im*v11Re[st2];
           }
         }
-        DComplex invdet= 1./(w(0) * w (3) - w(1)*w(2));
-        _g(st1,0) = invdet * ( w(3) * t(0) - w(1) * t(2) );
-        _g(st1,1) = invdet * ( w(3) * t(1) - w(1) * t(3) );
-        _g(st1,2) = invdet * ( w(0) * t(2) - w(2) * t(0) );
-        _g(st1,3) = invdet * ( w(0) * t(3) - w(2) * t(1) );
+
+        const DComplex w1(w1Re,w1Im);
+        const DComplex w2=conj(w1);
+        const DComplex t0(t0Re,t0Im), t1(t1Re,t1Im), t2(t2Re,t2Im), t3(t3Re,t3Im);
+
+        double invdet= 1./(w0 * w3 - norm(w1));
+        _g(st1,0) = invdet * ( w3 * t0 - w1 * t2 );
+        _g(st1,1) = invdet * ( w3 * t1 - w1 * t3 );
+        _g(st1,2) = invdet * ( w0 * t2 - w2 * t0 );
+        _g(st1,3) = invdet * ( w0 * t3 - w2 * t1 );
       }
     }
 
     void StefCal::doStep_unpolarized(bool phaseOnly) {
       _gold=_g;
 
+      if (_nSt==0) {
+        return;
+      }
+
       for (uint st=0;st<_nUn;++st) {
-        _h(st,0)=conj(_g(st,0));
+        _hRe[st]=  real(_g(st,0));
+        _hIm[st]= -imag(_g(st,0));
       }
 
+      const double* hRe=&_hRe[0];
+      const double* hIm=&_hIm[0];
+
+      // The data of st1 is contiguous. Per row, element st2 is multiplied by
+      // h[st2], with st2 running over all unknowns (pol2*_nSt+st for diagonal
+      // and phaseonly, st for scalarphase which has _nSp rows per (time,ch)).
+      const size_t blockSize=size_t(_nSt)*2*_solInt*_nChan;
+      const size_t nRows=blockSize/_nUn;
+
       for (uint st1=0;st1<_nUn;++st1) {
-        DComplex* vis_p;
-        DComplex* mvis_p;
         double ww=0; // Same as w, but specifically for pol==false
-        DComplex tt=0; // Same as t, but specifically for pol==false
-
-        DComplex* z_p=_z.data();
-        mvis_p=&_mvis(IPosition(6,0,0,0,0,st1/_nSt,st1%_nSt));
-        vis_p = &_vis(IPosition(6,0,0,0,0,st1/_nSt,st1%_nSt));
-        for (uint st1pol=0;st1pol<_nSp;++st1pol) {
-          for (uint ch=0;ch<_nChan;++ch) {
-            for (uint time=0;time<_solInt;++time) {
-              DComplex* h_p=_h.data();
-              for (uint st2=0;st2<_nUn;++st2) {
-                *z_p = h_p[st2] * *mvis_p; //itsMVis(IPosition(6,st2%nSt,st2/nSt,time,ch,st1/nSt,st1%nSt));
-                ww+=norm(*z_p);
-                tt+=conj(*z_p) * *vis_p; //itsVis(IPosition(6,st2%nSt,st2/nSt,time,ch,st1/nSt,st1%nSt));
-                mvis_p++;
-                vis_p++;
-                z_p++;
-              }
-              //cout<<"iS.z bij ch="<<ch<<"="<<iS.z<<endl<<"----"<<endl;
-            }
+        double ttRe=0, ttIm=0; // Same as t, but specifically for pol==false
+
+        // _mvis(IPosition(6,0,0,0,0,st1/_nSt,st1%_nSt))
+        const size_t offset=visIndex(0,0,0,0,st1/_nSt,st1%_nSt);
+
+        for (size_t row=0;row<nRows;++row) {
+          const double* mRe=&_mvisRe[offset+row*_nUn];
+          const double* mIm=&_mvisIm[offset+row*_nUn];
+          const double* vRe=&_visRe[offset+row*_nUn];
+          const double* vIm=&_visIm[offset+row*_nUn];
+
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(+:ww,ttRe,ttIm)
+#endif
+          for (uint st2=0;st2<_nUn;++st2) {
+            // z = h*mvis, ww += |z|^2, tt += conj(z)*vis
+            const double zRe = hRe[st2]*mRe[st2] - hIm[st2]*mIm[st2];
+            const double zIm = hRe[st2]*mIm[st2] + hIm[st2]*mRe[st2];
+            ww   += zRe*zRe + zIm*zIm;
+            ttRe += zRe*vRe[st2] + zIm*vIm[st2];
+            ttIm += zRe*vIm[st2] - zIm*vRe[st2];
           }
         }
-        //cout<<"st1="<<st1%nSt<<(st1>=nSt?"y":"x")<<", t="<<tt<<"       ";
-        //cout<<", w="<<ww<<"       ";
-        _g(st1,0)=tt/ww;
-        //cout<<", g="<<iS.g(st1,0)<<endl;
+
+        _g(st1,0)=DComplex(ttRe,ttIm)/ww;
         if (phaseOnly) {
           _g(st1,0)/=abs(_g(st1,0));
         }
@@ -0,0 +1,207 @@
+//# ThreadStep.cc: DPPP step class to run the next steps in a separate thread
+//# Copyright (C) 2015
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <DPPP/ThreadStep.h>
+#include <DPPP/FlagCounter.h>
+#include <Common/LofarLogger.h>
+#include <iostream>
+
+using namespace casa;
+
+namespace LOFAR {
+  namespace DPPP {
+
+    ThreadStep::ThreadStep (const string& name, uint queueSize)
+      : itsName         (name),
+        itsBuffers      (queueSize),
+        itsSumOccupancy (0),
+        itsNrProcessed  (0),
+        itsNrBytes      (0)
+    {
+      ASSERTSTR (queueSize > 0, "ThreadStep " << name
+                 << ": the queue size must be at least 1");
+#ifdef USE_THREADS
+      for (uint i=0; i<queueSize; ++i) {
+        itsFree.append (i);
+      }
+      itsThread.reset (new Thread(this, &ThreadStep::processQueue,
+                                  "ThreadStep " + name));
+#endif
+    }
+
+    ThreadStep::~ThreadStep()
+    {
+#ifdef USE_THREADS
+      // Stop the thread if finish was not called (e.g. after an exception).
+      if (itsThread) {
+        itsFilled.append (-1);
+        itsThread.reset();
+      }
+#endif
+    }
+
+    void ThreadStep::show (std::ostream& os) const
+    {
+      os << "ThreadStep " << itsName << std::endl;
+      os << "  queue size:     " << itsBuffers.size() << std::endl;
+#ifndef USE_THREADS
+      os << "  (no threads available; processing synchronously)" << std::endl;
+#endif
+    }
+
+    void ThreadStep::showTimings (std::ostream& os, double duration) const
+    {
+      os << "  ";
+      FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
+      os << " ThreadStep " << itsName << endl;
+      os << "          ";
+      FlagCounter::showPerc1 (os, itsStallTimer.getElapsed(), duration);
+      os << " stalled (previous steps waiting for a free buffer)" << endl;
+      os << "          ";
+      FlagCounter::showPerc1 (os, itsIdleTimer.getElapsed(), duration);
+      os << " idle (next steps waiting for a buffer)" << endl;
+      os << "          ";
+      FlagCounter::showPerc1 (os, itsBusyTimer.getElapsed(), duration);
+      os << " busy (next steps processing)" << endl;
+      os << "          average occupancy "
+         << (itsNrProcessed == 0 ? 0. : itsSumOccupancy / itsNrProcessed)
+         << " of " << itsBuffers.size() << " buffers; "
+         << itsNrBytes / (1024.*1024.) << " MB passed" << endl;
+    }
+
+    void ThreadStep::fill (uint index, const DPBuffer& buf)
+    {
+      DPBuffer& out = itsBuffers[index];
+      // DPBuffer::copy leaves arrays alone that are empty in the input,
+      // so clear those explicitly.
+      out.copy (buf);
+      if (buf.getData().empty()) {
+        out.setData (Cube<Complex>());
+      }
+      if (buf.getFlags().empty()) {
+        out.setFlags (Cube<bool>());
+      }
+      if (buf.getWeights().empty()) {
+        out.setWeights (Cube<float>());
+      }
+      if (buf.getUVW().empty()) {
+        out.setUVW (Matrix<double>());
+      }
+      if (buf.getFullResFlags().empty()) {
+        out.setFullResFlags (Cube<bool>());
+      }
+      itsNrBytes += (out.getData().size() * sizeof(Complex) +
+                     out.getFlags().size() * sizeof(bool) +
+                     out.getWeights().size() * sizeof(float) +
+                     out.getUVW().size() * sizeof(double) +
+                     out.getFullResFlags().size() * sizeof(bool));
+    }
+
+#ifdef USE_THREADS
+
+    bool ThreadStep::process (const DPBuffer& buf)
+    {
+      NSTimer::StartStop sstime(itsTimer);
+      checkError();
+      itsSumOccupancy += itsFilled.size();
+      itsNrProcessed++;
+      // Get a free buffer; stall if the next steps are behind.
+      itsStallTimer.start();
+      int index = itsFree.remove();
+      itsStallTimer.stop();
+      checkError();
+      fill (index, buf);
+      itsFilled.append (index);
+      return true;
+    }
+
+    void ThreadStep::finish()
+    {
+      // Let the thread process the remaining buffers and wait for it.
+      itsTimer.start();
+      if (itsThread) {
+        itsFilled.append (-1);
+        itsThread.reset();
+      }
+      itsTimer.stop();
+      checkError();
+      // The next steps can now be finished in this thread.
+      getNextStep()->finish();
+    }
+
+    void ThreadStep::processQueue()
+    {
+      bool failed = false;
+      for (;;) {
+        itsIdleTimer.start();
+        int index = itsFilled.remove();
+        itsIdleTimer.stop();
+        if (index < 0) {
+          break;
+        }
+        // After a failure, keep recycling the buffers, so process
+        // does not wait forever and can report the error.
+        if (! failed) {
+          try {
+            NSTimer::StartStop sstime(itsBusyTimer);
+            getNextStep()->process (itsBuffers[index]);
+          } catch (std::exception& x) {
+            ScopedLock lock(itsMutex);
+            itsError = x.what();
+            failed   = true;
+          }
+        }
+        itsFree.append (index);
+      }
+    }
+
+    void ThreadStep::checkError()
+    {
+      ScopedLock lock(itsMutex);
+      if (! itsError.empty()) {
+        THROW (Exception, "ThreadStep " << itsName
+               << ": error in next steps: " << itsError);
+      }
+    }
+
+#else
+
+    bool ThreadStep::process (const DPBuffer& buf)
+    {
+      {
+        NSTimer::StartStop sstime(itsTimer);
+        fill (0, buf);
+      }
+      NSTimer::StartStop sstime(itsBusyTimer);
+      getNextStep()->process (itsBuffers[0]);
+      return true;
+    }
+
+    void ThreadStep::finish()
+    {
+      getNextStep()->finish();
+    }
+
+#endif
+
+  } //# end namespace
+}
@@ -0,0 +1,404 @@
+//# tMedianWindow.cc: Test program for class MedianWindow
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <DPPP/MedianWindow.h>
+#include <DPPP/DPBuffer.h>
+#include <Common/LofarLogger.h>
+#include <casa/Utilities/GenSort.h>
+#include <vector>
+#include <limits>
+#include <cstdlib>
+#include <iostream>
+
+using namespace LOFAR;
+using namespace LOFAR::DPPP;
+using namespace casa;
+using namespace std;
+
+// The windows of a time slot: the amplitudes and flags of a number of time
+// entries for 2 baselines, of which baseline 1 is flagged.
+struct Windows
+{
+  Windows (uint ntime, uint nchan, uint ncorr)
+    : nchan(nchan), ncorr(ncorr), ampl(ntime), bufs(ntime)
+  {
+    for (uint it=0; it<ntime; ++it) {
+      ampl[it].resize (ncorr, nchan, 2);
+      Cube<bool> flags(ncorr, nchan, 2);
+      flags = false;
+      bufs[it].setFlags (flags);
+    }
+  }
+
+  // Make a deep copy (DPBuffer and Cube copies reference the data).
+  Windows (const Windows& that)
+    : nchan(that.nchan), ncorr(that.ncorr), ampl(that.ampl.size()),
+      bufs(that.bufs.size())
+  {
+    for (uint it=0; it<ampl.size(); ++it) {
+      ampl[it] = that.ampl[it].copy();
+      bufs[it].setFlags (that.bufs[it].getFlags().copy());
+    }
+  }
+
+  uint nchan, ncorr;
+  vector<Cube<float> > ampl;
+  vector<DPBuffer> bufs;
+};
+
+// The flags of the center time slot and the medians found for each channel.
+struct Result
+{
+  vector<bool>  flags;
+  vector<float> Z1;
+  vector<float> Z2;
+};
+
+// Flag baseline 1 of time entry index the way MedFlagger did before it
+// used MedianWindow: for each channel and correlation, collect the unflagged
+// values in the window and determine the median and the median of the
+// absolute differences from scratch with kthLargest.
+Result flagReference (Windows& w, uint index, const vector<uint>& timeEntries,
+                      uint ntime, int freqWindow, const vector<uint>& flagCorr,
+                      float threshold)
+{
+  Result result;
+  const uint nchan = w.nchan;
+  const uint ncorr = w.ncorr;
+  bool* flagPtr = w.bufs[index].getFlags().data() + nchan*ncorr;
+  const float* dataPtr = w.ampl[index].data() + nchan*ncorr;
+  vector<float> tempBuf;
+  for (uint ic=0; ic<nchan; ++ic) {
+    bool corrIsFlagged = false;
+    for (uint iw=0; iw<flagCorr.size(); ++iw) {
+      uint ip = flagCorr[iw];
+      if (flagPtr[ip]) {
+        corrIsFlagged = true;
+        break;
+      }
+      // The channels are mirrored at the edges in two parts.
+      int hw = freqWindow/2;
+      int s1 = int(ic) - hw;
+      int e1 = int(ic) + hw + 1;
+      int s2 = 1;
+      int e2 = 1;
+      if (s1 < 0) {
+        e2 = -s1 + 1;
+        s1 = 0;
+      } else if (e1 > int(nchan)) {
+        s2 = nchan + nchan - e1 - 1;
+        e2 = nchan-1;
+        e1 = nchan;
+      }
+      tempBuf.clear();
+      for (uint it=0; it<ntime; ++it) {
+        uint offset = nchan*ncorr + ip;
+        const float* data = w.ampl[timeEntries[it]].data() + offset;
+        const bool*  flag = w.bufs[timeEntries[it]].getFlags().data() + offset;
+        for (int i=s1*ncorr; i<e1*int(ncorr); i+=ncorr) {
+          if (!flag[i]) tempBuf.push_back (data[i]);
+        }
+        for (int i=s2*ncorr; i<e2*int(ncorr); i+=ncorr) {
+          if (!flag[i]) tempBuf.push_back (data[i]);
+        }
+      }
+      uint np = tempBuf.size();
+      float Z1 = -1;
+      float Z2 = 0;
+      if (np > 0) {
+        Z1 = GenSort<float>::kthLargest (&(tempBuf[0]), np, np/2);
+        for (uint i=0; i<np; ++i) {
+          tempBuf[i] = std::abs(tempBuf[i] - Z1);
+        }
+        Z2 = GenSort<float>::kthLargest (&(tempBuf[0]), np, np/2);
+      }
+      result.Z1.push_back (Z1);
+      result.Z2.push_back (Z2);
+      if (dataPtr[ip] > Z1 + threshold * Z2 * 1.4826) {
+        corrIsFlagged = true;
+        break;
+      }
+    }
+    if (corrIsFlagged) {
+      for (uint ip=0; ip<ncorr; ++ip) {
+        flagPtr[ip] = true;
+      }
+    }
+    result.flags.push_back (corrIsFlagged);
+    dataPtr += ncorr;
+    flagPtr += ncorr;
+  }
+  return result;
+}
+
+// Flag baseline 1 of time entry index with MedianWindow as MedFlagger::flag
+// does.
+Result flagWindow (Windows& w, uint index, const vector<uint>& timeEntries,
+                   uint ntime, int freqWindow, const vector<uint>& flagCorr,
+                   float threshold)
+{
+  Result result;
+  const uint nchan = w.nchan;
+  const uint ncorr = w.ncorr;
+  bool* flagPtr = w.bufs[index].getFlags().data() + nchan*ncorr;
+  const float* dataPtr = w.ampl[index].data() + nchan*ncorr;
+  vector<MedianWindow> windows(flagCorr.size());
+  vector<uint> multiplicity(nchan, 0);
+  vector<uint> centerPos;
+  for (uint it=0; it<ntime; ++it) {
+    if (timeEntries[it] == index) {
+      centerPos.push_back (it);
+    }
+  }
+  for (uint iw=0; iw<windows.size(); ++iw) {
+    windows[iw].gather (w.ampl, w.bufs, &(timeEntries[0]), ntime,
+                        1, flagCorr[iw], nchan, ncorr);
+  }
+  int hw = freqWindow/2;
+  for (int k=-hw; k<=hw; ++k) {
+    uint chan = mirrorChannel (k, nchan);
+    multiplicity[chan]++;
+    for (uint iw=0; iw<windows.size(); ++iw) {
+      windows[iw].addChannel (chan);
+    }
+  }
+  for (uint ic=0; ic<nchan; ++ic) {
+    if (ic > 0) {
+      uint chanOut = mirrorChannel (int(ic)-1-hw, nchan);
+      uint chanIn  = mirrorChannel (int(ic)+hw, nchan);
+      multiplicity[chanOut]--;
+      multiplicity[chanIn]++;
+      for (uint iw=0; iw<windows.size(); ++iw) {
+        windows[iw].removeChannel (chanOut);
+        windows[iw].addChannel (chanIn);
+      }
+    }
+    for (uint iw=0; iw<windows.size(); ++iw) {
+      windows[iw].update();
+    }
+    bool corrIsFlagged = false;
+    for (uint iw=0; iw<flagCorr.size(); ++iw) {
+      uint ip = flagCorr[iw];
+      if (flagPtr[ip]) {
+        corrIsFlagged = true;
+        break;
+      }
+      float Z1 = -1;
+      float Z2 = 0;
+      if (windows[iw].size() > 0) {
+        Z1 = windows[iw].median();
+        Z2 = windows[iw].medianAbsDiff (Z1);
+      }
+      result.Z1.push_back (Z1);
+      result.Z2.push_back (Z2);
+      if (dataPtr[ip] > Z1 + threshold * Z2 * 1.4826) {
+        corrIsFlagged = true;
+        break;
+      }
+    }
+    if (corrIsFlagged) {
+      for (uint iw=0; iw<windows.size(); ++iw) {
+        windows[iw].flagChannel (ic, centerPos, multiplicity[ic]);
+      }
+      for (uint ip=0; ip<ncorr; ++ip) {
+        flagPtr[ip] = true;
+      }
+    }
+    result.flags.push_back (corrIsFlagged);
+    dataPtr += ncorr;
+    flagPtr += ncorr;
+  }
+  return result;
+}
+
+// A random window setup as MedFlagger can create it.
+struct Setup
+{
+  Setup()
+    : nchan (1 + rand()%40),
+      ncorr (1 + rand()%4),
+      ntime (1 + 2*(rand()%5)),
+      windows (ntime, nchan, ncorr)
+  {
+    // An odd frequency window, at most the number of channels.
+    freqWindow = 1 + 2*(rand()%((nchan+1)/2));
+    if (freqWindow > int(nchan)) {
+      freqWindow -= 2;
+    }
+    // Duplicate values (to test equal values), outliers and
+    // partial flagging.
+    float flagFraction = (rand()%4) * 0.1;
+    for (uint it=0; it<ntime; ++it) {
+      float* ampl = windows.ampl[it].data();
+      bool* flags = windows.bufs[it].getFlags().data();
+      for (uint i=0; i<windows.ampl[it].size(); ++i) {
+        ampl[i] = (rand()%3 == 0  ?  float(rand()%5) :
+                   10.*rand()/RAND_MAX + (rand()%20 == 0 ? 100 : 0));
+        flags[i] = float(rand())/RAND_MAX < flagFraction;
+      }
+    }
+    // The time entries can contain the center entry and other entries
+    // multiple times (as mirrored at the begin or end).
+    index = rand()%ntime;
+    timeEntries.push_back (index);
+    for (uint i=1; i<ntime; ++i) {
+      timeEntries.push_back (rand()%3 == 0  ?  index : rand()%ntime);
+    }
+    ntimeBl = 1 + rand()%ntime;
+    uint nflagCorr = 1 + rand()%ncorr;
+    for (uint i=0; i<nflagCorr; ++i) {
+      flagCorr.push_back (rand()%ncorr);
+    }
+    threshold = (rand()%4) * 0.5;
+  }
+
+  uint nchan, ncorr, ntime;
+  Windows windows;
+  int freqWindow;
+  uint index;
+  vector<uint> timeEntries;
+  uint ntimeBl;
+  vector<uint> flagCorr;
+  float threshold;
+};
+
+void checkEqual (const Result& ref, const Result& res)
+{
+  ASSERT (ref.flags == res.flags);
+  ASSERT (ref.Z1 == res.Z1);
+  ASSERT (ref.Z2 == res.Z2);
+}
+
+// Compare the flags and medians with those determined from scratch.
+void testRandom (uint ntest)
+{
+  uint nflagged = 0;
+  for (uint i=0; i<ntest; ++i) {
+    Setup setup;
+    Windows copy(setup.windows);
+    Result ref = flagReference (setup.windows, setup.index, setup.timeEntries,
+                                setup.ntimeBl, setup.freqWindow,
+                                setup.flagCorr, setup.threshold);
+    Result res = flagWindow (copy, setup.index, setup.timeEntries,
+                             setup.ntimeBl, setup.freqWindow,
+                             setup.flagCorr, setup.threshold);
+    checkEqual (ref, res);
+    for (uint ic=0; ic<ref.flags.size(); ++ic) {
+      nflagged += ref.flags[ic];
+    }
+  }
+  cout << "testRandom: " << ntest << " windows, "
+       << nflagged << " channels flagged" << endl;
+  // Make sure the test is meaningful.
+  ASSERT (nflagged > 0);
+}
+
+// A NaN amplitude is treated as flagged: the medians and flags must be
+// the same as when those values are flagged.
+// The time entry to flag has no NaNs, because MedFlagger does not flag a
+// NaN itself (it is not larger than the threshold).
+void testNaN (uint ntest)
+{
+  uint nnan = 0;
+  for (uint i=0; i<ntest; ++i) {
+    Setup setup;
+    Windows flagged(setup.windows);
+    for (uint it=0; it<setup.ntime; ++it) {
+      if (it != setup.index) {
+        float* ampl = setup.windows.ampl[it].data();
+        bool* flags = flagged.bufs[it].getFlags().data();
+        for (uint j=0; j<setup.windows.ampl[it].size(); ++j) {
+          if (rand()%5 == 0) {
+            ampl[j] = std::numeric_limits<float>::quiet_NaN();
+            flags[j] = true;
+            nnan++;
+          }
+        }
+      }
+    }
+    Result ref = flagReference (flagged, setup.index, setup.timeEntries,
+                                setup.ntimeBl, setup.freqWindow,
+                                setup.flagCorr, setup.threshold);
+    Result res = flagWindow (setup.windows, setup.index, setup.timeEntries,
+                             setup.ntimeBl, setup.freqWindow,
+                             setup.flagCorr, setup.threshold);
+    checkEqual (ref, res);
+  }
+  cout << "testNaN: " << ntest << " windows, " << nnan << " NaNs" << endl;
+  ASSERT (nnan > 0);
+}
+
+// Test the median and MAD of a single window with known values.
+void testSimple()
+{
+  Windows w(1, 5, 1);
+  float values[] = {3, 1, 4, 1, 5};
+  for (uint ic=0; ic<5; ++ic) {
+    w.ampl[0](0,ic,1) = values[ic];
+  }
+  vector<uint> timeEntries(1, 0);
+  MedianWindow window;
+  window.gather (w.ampl, w.bufs, &(timeEntries[0]), 1, 1, 0, 5, 1);
+  for (uint ic=0; ic<5; ++ic) {
+    window.addChannel (ic);
+  }
+  window.update();
+  // Sorted: 1 1 3 4 5; differences with 3: 0 1 2 2 2
+  ASSERT (window.size() == 5);
+  ASSERT (window.median() == 3);
+  ASSERT (window.medianAbsDiff(3) == 2);
+  // Remove the 5 and add it twice (as for a mirrored channel).
+  window.removeChannel (4);
+  window.addChannel (4);
+  window.addChannel (4);
+  window.update();
+  // Sorted: 1 1 3 4 5 5; differences with 4: 0 1 1 1 3 3
+  ASSERT (window.size() == 6);
+  ASSERT (window.median() == 4);
+  ASSERT (window.medianAbsDiff(4) == 1);
+  // A NaN (replacing the 4) is ignored.
+  w.ampl[0](0,2,1) = std::numeric_limits<float>::quiet_NaN();
+  window.gather (w.ampl, w.bufs, &(timeEntries[0]), 1, 1, 0, 5, 1);
+  for (uint ic=0; ic<5; ++ic) {
+    window.addChannel (ic);
+  }
+  window.update();
+  // Sorted: 1 1 3 5; differences with 3: 0 2 2 2
+  ASSERT (window.size() == 4);
+  ASSERT (window.median() == 3);
+  ASSERT (window.medianAbsDiff(3) == 2);
+}
+
+int main()
+{
+  INIT_LOGGER ("tMedianWindow");
+  try {
+    srand (5);
+    testSimple();
+    testRandom (3000);
+    testNaN (1000);
+  } catch (std::exception& x) {
+    cout << "Unexpected exception: " << x.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -347,6 +347,85 @@ void testAvg1()
   checkAvg ("tNDPPP_tmp.MS2");
 }
 
+void testPipeline()
+{
+  cout << endl << "** testPipeline 1 **" << endl;
+  {
+    // Copy with reading and writing in separate threads.
+    ofstream ostr("tNDPPP_tmp.parset");
+    ostr << "msin=tNDPPP_tmp.MS" << endl;
+    ostr << "msin.starttime=03-Aug-2000/13:21:45" << endl;
+    ostr << "msin.endtime=03-Aug-2000/13:33:15" << endl;
+    ostr << "msout=tNDPPP_tmp.MS1" << endl;
+    ostr << "msout.overwrite=true" << endl;
+    ostr << "steps=[]" << endl;
+    ostr << "pipeline=true" << endl;
+  }
+  DPRun::execute ("tNDPPP_tmp.parset");
+  checkCopy ("tNDPPP_tmp.MS", "tNDPPP_tmp.MS1", 1);
+
+  cout << endl << "** testPipeline 2 **" << endl;
+  {
+    // Average with each step in its own thread and a minimal queue.
+    ofstream ostr("tNDPPP_tmp.parset");
+    ostr << "msin.name=tNDPPP_tmp.MS" << endl;
+    ostr << "msin.starttime=03-Aug-2000/13:22:20" << endl;
+    ostr << "msin.endtime=03-Aug-2000/13:31:45" << endl;
+    ostr << "msout.name=tNDPPP_tmp.MS2" << endl;
+    ostr << "msout.overwrite=true" << endl;
+    ostr << "steps=[avg,count]" << endl;
+    ostr << "avg.type=average" << endl;
+    ostr << "avg.timestep=20" << endl;
+    ostr << "avg.freqstep=100" << endl;
+    ostr << "pipeline=true" << endl;
+    ostr << "pipeline.stages=[avg,count,msout]" << endl;
+    ostr << "pipeline.queuesize=1" << endl;
+  }
+  DPRun::execute ("tNDPPP_tmp.parset");
+  checkAvg ("tNDPPP_tmp.MS2");
+}
+
+void testReadAhead()
+{
+  cout << endl << "** testReadAhead 1 **" << endl;
+  {
+    // Average with reading ahead and writing behind.
+    ofstream ostr("tNDPPP_tmp.parset");
+    ostr << "msin.name=tNDPPP_tmp.MS" << endl;
+    ostr << "msin.starttime=03-Aug-2000/13:22:20" << endl;
+    ostr << "msin.endtime=03-Aug-2000/13:31:45" << endl;
+    ostr << "msin.readahead=3" << endl;
+    ostr << "msout.name=tNDPPP_tmp.MS2" << endl;
+    ostr << "msout.overwrite=true" << endl;
+    ostr << "msout.writebehind=2" << endl;
+    ostr << "steps=[avg]" << endl;
+    ostr << "avg.type=average" << endl;
+    ostr << "avg.timestep=20" << endl;
+    ostr << "avg.freqstep=100" << endl;
+  }
+  DPRun::execute ("tNDPPP_tmp.parset");
+  checkAvg ("tNDPPP_tmp.MS2");
+
+  cout << endl << "** testReadAhead 2 **" << endl;
+  {
+    // Update the flags in place while reading ahead.
+    Table tab("tNDPPP_tmp.MS");
+    tab.deepCopy ("tNDPPP_tmp.MS_copy2", Table::New);
+    ofstream ostr("tNDPPP_tmp.parset");
+    ostr << "msin=tNDPPP_tmp.MS_copy2" << endl;
+    ostr << "msin.readahead=4" << endl;
+    ostr << "msout=." << endl;
+    ostr << "msout.writebehind=2" << endl;
+    ostr << "steps=[preflag]" << endl;
+    ostr << "preflag.blmin=1e6" << endl;     // should flag all data
+  }
+  DPRun::execute ("tNDPPP_tmp.parset");
+  {
+    Table tab("tNDPPP_tmp.MS_copy2");
+    ASSERT (allEQ(ROArrayColumn<bool>(tab,"FLAG").getColumn(), true));
+  }
+}
+
 void testAvg2()
 {
   cout << endl << "** testAvg2 **" << endl;
@@ -615,6 +694,72 @@ void testFlags1()
   checkFlags ("tNDPPP_tmp.MS5");
 }
 
+template<typename T>
+void checkSameArrayColumn (const Table& t1, const Table& t2, const String& name)
+{
+  ASSERT (allEQ(ROArrayColumn<T>(t1,name).getColumn(),
+                ROArrayColumn<T>(t2,name).getColumn()));
+}
+
+template<typename T>
+void checkSameScalarColumn (const Table& t1, const Table& t2, const String& name)
+{
+  ASSERT (allEQ(ROScalarColumn<T>(t1,name).getColumn(),
+                ROScalarColumn<T>(t2,name).getColumn()));
+}
+
+// Check that two output MSs are exactly the same.
+void checkSame (const String& name1, const String& name2)
+{
+  Table t1(name1);
+  Table t2(name2);
+  ASSERT (t1.nrow() == t2.nrow());
+  checkSameArrayColumn<Complex> (t1, t2, "DATA");
+  checkSameArrayColumn<Bool>    (t1, t2, "FLAG");
+  checkSameArrayColumn<float>   (t1, t2, "WEIGHT_SPECTRUM");
+  checkSameArrayColumn<uChar>   (t1, t2, "LOFAR_FULL_RES_FLAG");
+  checkSameArrayColumn<double>  (t1, t2, "UVW");
+  checkSameScalarColumn<double> (t1, t2, "TIME");
+  checkSameScalarColumn<double> (t1, t2, "TIME_CENTROID");
+  checkSameScalarColumn<double> (t1, t2, "INTERVAL");
+  checkSameScalarColumn<double> (t1, t2, "EXPOSURE");
+  checkSameScalarColumn<Int>    (t1, t2, "ANTENNA1");
+  checkSameScalarColumn<Int>    (t1, t2, "ANTENNA2");
+}
+
+void testFlagsThreads()
+{
+  cout << endl << "** testFlagsThreads **" << endl;
+  // The input MS has no LOFAR_FULL_RES_FLAG column, so the full-res flags
+  // are formed from the flags set by the preflagger. Reading ahead and the
+  // pipeline mode should give exactly the same output as testFlags1.
+  for (int i=0; i<2; ++i) {
+    {
+      ofstream ostr("tNDPPP_tmp.parset");
+      ostr << "msin=tNDPPP_tmp.MS" << endl;
+      ostr << "msin.startchan=1" << endl;
+      ostr << "msin.nchan=12" << endl;
+      ostr << "msout=tNDPPP_tmp.MS5t" << endl;
+      ostr << "msout.overwrite=true" << endl;
+      ostr << "steps=[preflag,average]" << endl;
+      ostr << "preflag.expr='flag1 or flag2'" << endl;
+      ostr << "preflag.flag1.timeslot=[10,11]" << endl;
+      ostr << "preflag.flag2.chan=[0,2,6..8]" << endl;
+      ostr << "average.timestep=6" << endl;
+      if (i == 0) {
+        ostr << "msin.readahead=3" << endl;
+        ostr << "msout.writebehind=2" << endl;
+      } else {
+        ostr << "pipeline=true" << endl;
+        ostr << "pipeline.stages=[preflag,average,msout]" << endl;
+      }
+    }
+    DPRun::execute ("tNDPPP_tmp.parset");
+    checkFlags ("tNDPPP_tmp.MS5t");
+    checkSame ("tNDPPP_tmp.MS5", "tNDPPP_tmp.MS5t");
+  }
+}
+
 void testFlags2()
 {
   cout << endl << "** testFlags2 **" << endl;
@@ -1004,6 +1149,8 @@ int main()
     testCopyColumn();
     testMultiIn();
     testAvg1();
+    testPipeline();
+    testReadAhead();
     testAvg2();
     testAvg3();
     testAvg4();
@@ -1011,6 +1158,7 @@ int main()
     testUpdate2();
     testUpdateScale();
     testFlags1();
+    testFlagsThreads();
     testFlags2();
     testFlags3();
     testStationAdd();
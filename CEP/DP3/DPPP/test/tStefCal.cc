@@ -0,0 +1,293 @@
+//# tStefCal.cc: Test and benchmark of the StefCal solver
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+// Simulates visibilities for a number of frequency cells, solves them with
+// StefCal one cell after the other and with the cells in parallel (as
+// GainCal does), and checks that both give the same solutions, which
+// reproduce the simulated visibilities.
+//
+// Usage: tStefCal [nStations] [nFreqCells] [solInt] [nChan]
+
+#include <lofar_config.h>
+#include <DPPP/StefCal.h>
+#include <Common/Timer.h>
+#include <Common/LofarLogger.h>
+#include <Common/OpenMP.h>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+using namespace LOFAR;
+using namespace LOFAR::DPPP;
+using namespace casa;
+using namespace std;
+
+// A random complex number with amplitude around 1.
+DComplex randomComplex(double spread)
+{
+  return polar(1 + spread*(drand48()-0.5), 2*M_PI*drand48());
+}
+
+// Random Jones matrices (xx, xy, yx, yy per station) and model visibilities
+// for one frequency cell.
+struct Simulation
+{
+  Simulation(uint nSt, uint solInt, uint nChan, const string& mode)
+    : nSt(nSt), solInt(solInt), nChan(nChan),
+      jones(nSt*4), model(nSt*nSt*solInt*nChan*4)
+  {
+    const bool fullJones = mode=="fulljones";
+    const double spread = mode=="phaseonly" ? 0. : 0.4;
+    for (uint st=0; st<nSt; ++st) {
+      jones[st*4+0] = randomComplex(spread);
+      jones[st*4+1] = fullJones ? 0.2*randomComplex(spread) : 0.;
+      jones[st*4+2] = fullJones ? 0.2*randomComplex(spread) : 0.;
+      jones[st*4+3] = randomComplex(spread);
+    }
+    for (uint i=0; i<model.size(); ++i) {
+      model[i] = randomComplex(1.);
+    }
+  }
+
+  // Model visibility of correlation cr of baseline (st1,st2)
+  DComplex mvis(uint st1, uint st2, uint time, uint ch, uint cr) const
+  {
+    return model[(((st1*nSt+st2)*solInt+time)*nChan+ch)*4+cr];
+  }
+
+  // Correlation cr of J1 * M * J2^H
+  static DComplex corrupt(const DComplex* j1, const DComplex* m,
+                          const DComplex* j2, uint cr)
+  {
+    uint i=cr/2, j=cr%2;
+    DComplex sum=0;
+    for (uint k=0; k<2; ++k) {
+      for (uint l=0; l<2; ++l) {
+        sum += j1[i*2+k] * m[k*2+l] * conj(j2[j*2+l]);
+      }
+    }
+    return sum;
+  }
+
+  // Fills the visibilities of all baselines (st1<st2) in solver.
+  void fill(StefCal& solver) const
+  {
+    solver.resetVis(nSt);
+    for (uint st=0; st<nSt; ++st) {
+      solver.getAntMap()[st] = st;
+    }
+    for (uint st1=0; st1<nSt; ++st1) {
+      for (uint st2=st1+1; st2<nSt; ++st2) {
+        for (uint time=0; time<solInt; ++time) {
+          for (uint ch=0; ch<nChan; ++ch) {
+            DComplex m[4];
+            for (uint cr=0; cr<4; ++cr) {
+              m[cr] = mvis(st1, st2, time, ch, cr);
+            }
+            for (uint cr=0; cr<4; ++cr) {
+              DComplex vis = corrupt(&jones[st1*4], m, &jones[st2*4], cr);
+              solver.setVis(st1, st2, time, ch, cr, Complex(vis), Complex(m[cr]), 1.);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Relative difference between the visibilities and the model corrupted
+  // with the solution (of length nSt, with numCorrelations 2 or 4).
+  // The solution holds the Hermitian conjugates of the Jones matrices.
+  double residual(const Matrix<DComplex>& sol) const
+  {
+    vector<DComplex> solJones(nSt*4);
+    for (uint st=0; st<nSt; ++st) {
+      if (sol.ncolumn()==4) {
+        for (uint cr=0; cr<4; ++cr) {
+          solJones[st*4+cr] = conj(sol(st,(cr%2)*2+cr/2));
+        }
+      } else {
+        solJones[st*4+0] = conj(sol(st,0));
+        solJones[st*4+3] = conj(sol(st,1));
+      }
+    }
+
+    double sumDiff=0, sumVis=0;
+    for (uint st1=0; st1<nSt; ++st1) {
+      for (uint st2=st1+1; st2<nSt; ++st2) {
+        for (uint time=0; time<solInt; ++time) {
+          for (uint ch=0; ch<nChan; ++ch) {
+            DComplex m[4];
+            for (uint cr=0; cr<4; ++cr) {
+              m[cr] = mvis(st1, st2, time, ch, cr);
+            }
+            for (uint cr=0; cr<4; ++cr) {
+              // visibilities are stored in single precision
+              DComplex vis = DComplex(Complex(corrupt(&jones[st1*4], m, &jones[st2*4], cr)));
+              sumDiff += norm(vis - corrupt(&solJones[st1*4], m, &solJones[st2*4], cr));
+              sumVis += norm(vis);
+            }
+          }
+        }
+      }
+    }
+    return sqrt(sumDiff/sumVis);
+  }
+
+  uint nSt, solInt, nChan;
+  vector<DComplex> jones;
+  vector<DComplex> model;
+};
+
+// Solves all cells, one after the other in each iteration (as GainCal did
+// before it solved them in parallel), or as GainCal does now.
+// Returns the number of cells that converged.
+uint solve(vector<StefCal>& cells, uint maxIter, bool parallel)
+{
+  const int nCells = cells.size();
+  vector<StefCal::Status> converged(cells.size(), StefCal::NOTCONVERGED);
+  for (int cell=0; cell<nCells; ++cell) {
+    cells[cell].init();
+  }
+
+  if (!parallel) {
+    for (uint iter=0; iter<maxIter; ++iter) {
+      bool allConverged=true;
+      for (int cell=0; cell<nCells; ++cell) {
+        if (converged[cell]==StefCal::CONVERGED) {
+          continue;
+        }
+        converged[cell] = cells[cell].doStep(iter);
+        if (converged[cell]==StefCal::NOTCONVERGED) {
+          allConverged = false;
+        }
+        if (allConverged) {
+          break;
+        }
+      }
+    }
+  } else {
+    // Same as GainCal::stefcal
+    for (uint iter=0; iter<maxIter; ++iter) {
+      int first=0;
+      while (first<nCells && converged[first]==StefCal::CONVERGED) {
+        ++first;
+      }
+      if (first==nCells) {
+        break;
+      }
+      converged[first] = cells[first].doStep(iter);
+      if (converged[first]==StefCal::NOTCONVERGED) {
+#pragma omp parallel for schedule(dynamic)
+        for (int cell=first+1; cell<nCells; ++cell) {
+          if (converged[cell]!=StefCal::CONVERGED) {
+            converged[cell] = cells[cell].doStep(iter);
+          }
+        }
+      }
+    }
+  }
+
+  uint nConverged=0;
+  for (uint cell=0; cell<cells.size(); ++cell) {
+    if (converged[cell]==StefCal::CONVERGED) {
+      nConverged++;
+    }
+  }
+  return nConverged;
+}
+
+void test(const string& mode, uint nSt, uint nCells, uint solInt, uint nChan)
+{
+  const uint maxIter=200;
+  vector<Simulation> sims;
+  vector<StefCal> cells;
+  for (uint cell=0; cell<nCells; ++cell) {
+    sims.push_back(Simulation(nSt, solInt, nChan, mode));
+    cells.push_back(StefCal(solInt, nChan, mode, 1.e-8, nSt, false, 0));
+    sims[cell].fill(cells[cell]);
+  }
+
+  NSTimer serialTimer, parallelTimer;
+
+  serialTimer.start();
+  uint nConverged = solve(cells, maxIter, false);
+  serialTimer.stop();
+  ASSERT(nConverged==nCells);
+
+  vector<Matrix<DComplex> > serialSols;
+  for (uint cell=0; cell<nCells; ++cell) {
+    serialSols.push_back(cells[cell].getSolution());
+    double residual = sims[cell].residual(serialSols[cell]);
+    ASSERTSTR(residual<1.e-5, "Residual of cell " << cell << " is " << residual);
+  }
+
+  parallelTimer.start();
+  nConverged = solve(cells, maxIter, true);
+  parallelTimer.stop();
+  ASSERT(nConverged==nCells);
+
+  // The cells take the same steps, so the solutions must be identical
+  for (uint cell=0; cell<nCells; ++cell) {
+    Matrix<DComplex> sol = cells[cell].getSolution();
+    for (uint st=0; st<nSt; ++st) {
+      for (uint cr=0; cr<sol.ncolumn(); ++cr) {
+        ASSERT(sol(st,cr)==serialSols[cell](st,cr));
+      }
+    }
+  }
+
+  cout << setw(10) << mode << setw(4) << nSt << " stations, "
+       << nCells << " cells: "
+       << setw(10) << serialTimer.getElapsed() << " s serial, "
+       << setw(10) << parallelTimer.getElapsed() << " s with "
+       << OpenMP::maxThreads() << " threads" << endl;
+}
+
+int main (int argc, char* argv[])
+{
+  INIT_LOGGER("tStefCal");
+
+  uint nSt = 0;            // 0: 60 and 80 stations
+  uint nCells = 8;
+  uint solInt = 2;
+  uint nChan = 2;
+  if (argc > 1) nSt = atoi(argv[1]);
+  if (argc > 2) nCells = atoi(argv[2]);
+  if (argc > 3) solInt = atoi(argv[3]);
+  if (argc > 4) nChan = atoi(argv[4]);
+
+  try {
+    for (uint n=60; n<=80; n+=20) {
+      uint stations = nSt>0 ? nSt : n;
+      test("diagonal", stations, nCells, solInt, nChan);
+      test("fulljones", stations, nCells, solInt, nChan);
+      test("phaseonly", stations, nCells, solInt, nChan);
+      if (nSt>0) {
+        break;
+      }
+    }
+  } catch (std::exception& x) {
+    cout << "Unexpected exception: " << x.what() << endl;
+    return 1;
+  }
+  return 0;
+}
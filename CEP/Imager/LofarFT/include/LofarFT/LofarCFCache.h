@@ -0,0 +1,105 @@
+//# LofarCFCache.h: Persistent cache of W-terms and A-terms on disk
+//#
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_LOFARFT_LOFARCFCACHE_H
+#define LOFAR_LOFARFT_LOFARCFCACHE_H
+
+#include <Common/LofarTypes.h>
+
+#include <casa/Arrays/Array.h>
+#include <casa/BasicSL/Complex.h>
+#include <casa/BasicSL/String.h>
+#include <map>
+#include <vector>
+#include <iosfwd>
+
+namespace LOFAR {
+
+  // Persistent cache of the W-terms and A-terms that LofarConvolutionFunction
+  // uses to make the convolution functions. An entry is a list of complex
+  // arrays stored under a key string. The key of an entry is the setup key
+  // (describing the station layout, frequencies, image coordinates,
+  // oversampling, etc.) followed by the entry's own key (e.g. the w-plane or
+  // time slot). The file name of an entry is the hash of its key, so the
+  // cache is content-addressed and can be shared by all awimager runs on the
+  // same data. The full key is stored in the file as well to detect hash
+  // collisions.
+  //
+  // Each entry is a single file with a small header, the key, a table with
+  // the shape and offset of each array, and the array data. The data of
+  // each array starts at a 64-byte boundary, so the file can be memory
+  // mapped and used as is. A file is written under a temporary name and
+  // renamed, so concurrent runs never see partial entries. Damaged or
+  // mismatching files are treated as a miss and rewritten.
+  //
+  // The cache is thread-safe; get and put can be called from OpenMP loops.
+  class LofarCFCache
+  {
+  public:
+    // Create a cache in the given directory, which is created if needed.
+    // An empty directory name gives an inactive cache (get always fails,
+    // put does nothing).
+    LofarCFCache (const casa::String& directory = casa::String(),
+                  const casa::String& setupKey = casa::String());
+
+    // Is the cache active?
+    bool isActive() const
+      { return !itsDirectory.empty(); }
+
+    // Get the arrays of the entry with the given key and kind.
+    // The kind (e.g. "W-term") is only used for the statistics.
+    // It returns false if the entry is not in the cache.
+    bool get (const casa::String& kind, const casa::String& key,
+              std::vector<casa::Array<casa::Complex> >& arrays);
+
+    // Store the arrays under the given key.
+    // Failure to write the entry is reported, but is not an error.
+    void put (const casa::String& key,
+              const std::vector<casa::Array<casa::Complex> >& arrays);
+
+    // Get the number of hits and misses of the given kind.
+    uint64 nHits (const casa::String& kind) const;
+    uint64 nMisses (const casa::String& kind) const;
+
+    // Show the hit and miss rates per kind.
+    void showStatistics (std::ostream&) const;
+
+    // Get the file name of the entry with the given key.
+    casa::String fileName (const casa::String& key) const;
+
+    // Get the 64-bit FNV-1a hash of a string.
+    static uint64 hash (const casa::String& str);
+
+  private:
+    void count (const casa::String& kind, bool hit);
+
+    //# Data members.
+    casa::String itsDirectory;
+    casa::String itsSetupKey;
+    bool         itsWriteFailed;
+    //# Number of hits and misses per kind.
+    std::map<casa::String, std::pair<uint64,uint64> > itsCounts;
+  };
+
+} // end namespace
+
+#endif
@@ -26,6 +26,7 @@
 #include <LofarFT/LofarATerm.h>
 #include <LofarFT/LofarWTerm.h>
 #include <LofarFT/LofarCFStore.h>
+#include <LofarFT/LofarCFCache.h>
 #include <LofarFT/FFTCMatrix.h>
 #include <Common/Timer.h>
 
@@ -556,6 +557,11 @@ namespace LOFAR
     // of the spheroidal in the image plane
     Double makeSpheroidCut();
 
+    // Make the setup key of the CF cache. It describes everything the
+    // W-terms and A-terms depend on, apart from the w-plane and time.
+    String makeCFCacheSetupKey(const MeasurementSet& ms,
+                               int ApplyBeamCode) const;
+
     // Return the angular resolution required for making the image of the
     // angular size determined by coordinates and shape.
     // The resolution is assumed to be the same on both direction axes.
@@ -934,6 +940,8 @@ namespace LOFAR
     Int                 its_ChanBlockSize;
     Matrix<Complex>     spheroid_cut_element_fft;
     vector< vector< Matrix< Complex > > > GridsMueller;
+    //# Persistent cache of the W-terms and A-terms.
+    LofarCFCache        itsCFCache;
     LogIO &logIO() const
       {
         return m_logIO;
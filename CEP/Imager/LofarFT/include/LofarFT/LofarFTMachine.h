@@ -216,6 +216,13 @@ public:
   
   void putSplitWplanesOverlap(const VisBuffer& vb, Int row, Bool dopsf,
 			      FTMachine::Type type);
+  // Make the convolution functions of a batch of baseline chunks in
+  // parallel. It is used by the tiled gridder, which needs the functions
+  // of all chunks it grids together.
+  void makeCFBatch(vector<LofarCFStore>& cfs, const LofarVBStore& vbs,
+                   const Vector<Double>& times,
+                   const vector<vector<uInt> >& chunks,
+                   const Vector<uInt>& blockCF, uInt nchan, Bool degrid);
   void putSplitWplanes(const VisBuffer& vb, Int row, Bool dopsf,
                          FTMachine::Type type);
   void putTraditional(const VisBuffer& vb, Int row, Bool dopsf,
@@ -395,6 +402,7 @@ protected:
   Bool itsAllAtermsDone;
   Bool its_UseMasksDegrid;
   Bool its_SingleGridMode;
+  Bool its_TiledGridding;
   Bool its_makeDirtyCorr;
   uInt its_NGrids;
 
@@ -95,14 +95,14 @@ namespace LOFAR { //# NAMESPACE CASA - BEGIN
   class LofarVisResampler: public AWVisResampler
   {
   public:
-    LofarVisResampler(): AWVisResampler()  {}
+    LofarVisResampler(): AWVisResampler(), itsTileSize(64)  {}
     virtual ~LofarVisResampler()                                    {}
 
     virtual VisibilityResamplerBase* clone()
     {return new LofarVisResampler(*this);}
 
     void copy(const LofarVisResampler& other)
-    {AWVisResampler::copy(other); }
+    {AWVisResampler::copy(other); itsTileSize=other.itsTileSize; }
 
     // Re-sample the griddedData on the VisBuffer (a.k.a gridding).
     void lofarDataToGrid (Array<Complex>& griddedData, LofarVBStore& vbs,
@@ -163,6 +163,32 @@ namespace LOFAR { //# NAMESPACE CASA - BEGIN
                          LofarCFStore& cfs0,
                          LofarCFStore& cfs1);
 
+    // Grid the visibilities of a set of row chunks (usually a baseline in a
+    // time window) in parallel. Chunk i is gridded with convolution function
+    // cfs[i]. The visibilities are sorted on uv-tile and each thread grids a
+    // tile into its own tile buffer, which is added to the grid thereafter.
+    // The tiles are done in 4 passes (even/odd tile in x and y), so the
+    // buffers added simultaneously never overlap.
+    // The result is the same as lofarDataToGrid_interp for each chunk.
+    template <class T>
+    void lofarDataToGrid_tiled(Array<T>& grid, LofarVBStore& vbs,
+                               const vector<vector<uInt> >& rows,
+                               const vector<LofarCFStore>& cfs,
+                               Matrix<Double>& sumwt,
+                               const Bool& dopsf);
+
+    // Degrid the visibilities of a set of row chunks in parallel.
+    // The result is the same as lofarGridToData_interp for each chunk.
+    void lofarGridToData_tiled(LofarVBStore& vbs,
+                               const Array<Complex>& grid,
+                               const vector<vector<uInt> >& rows,
+                               const vector<LofarCFStore>& cfs);
+
+    // Set the size of the uv-tiles used by the tiled (de)gridding.
+    // The tiles are made at least twice the largest support.
+    void setTileSize(Int tileSize)
+    {itsTileSize=tileSize;}
+
     Vector<uInt> ChanCFMap;
     void setChanCFMaps(Vector<uInt> ChanMap)
     {ChanCFMap=ChanMap.copy();}
@@ -224,7 +250,35 @@ namespace LOFAR { //# NAMESPACE CASA - BEGIN
                           LofarCFStore& cfs);
 
 
+    // A visibility (row,channel) to be (de)gridded by the tiled gridder.
+    struct TileSample {
+      uInt   chunk;
+      uInt   row;
+      Int    chan;
+      Int    gridChan;
+      Int    locx, locy;
+      // First value of its convolution function to use.
+      const Complex* cf;
+    };
+
+    // The visibilities of the chunks sorted on uv-tile.
+    // The support, the step between the convolution function values used
+    // (the oversampling) and the step between its rows are kept per chunk.
+    struct TilePlan {
+      Int tileSize, nTileX, nTileY, maxSupport;
+      vector<Int> xSupport, ySupport, xStep, yStride;
+      vector<TileSample> samples;
+      // Start of the samples of each tile (nTileX*nTileY+1 values).
+      vector<size_t> tileStart;
+    };
+
+    void makeTilePlan(TilePlan& plan, const LofarVBStore& vbs,
+                      const vector<vector<uInt> >& rows,
+                      const vector<LofarCFStore>& cfs,
+                      Int nGridX, Int nGridY, Int nGridChan);
+
     Vector<Int> cfMap_p, conjCFMap_p;
+    Int itsTileSize;
   };
 
 } //# NAMESPACE CASA - END
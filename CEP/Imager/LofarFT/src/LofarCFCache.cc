@@ -0,0 +1,333 @@
+//# LofarCFCache.cc: Persistent cache of W-terms and A-terms on disk
+//#
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <LofarFT/LofarCFCache.h>
+#include <Common/LofarLogger.h>
+#include <Common/OpenMP.h>
+
+#include <casa/sstream.h>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <iomanip>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace casa;
+
+namespace LOFAR
+{
+
+  namespace
+  {
+    // Layout of a cache file:
+    //   FileHeader
+    //   key (keyLength chars), padded to 8 bytes
+    //   per array: uint64 ndim, uint64 offset, int64 shape[ndim]
+    //   data of each array at its offset (a multiple of DataAlign)
+    const char   theMagic[8] = {'L','O','F','A','R','C','F','\0'};
+    const uint32 theVersion  = 1;
+    const uint64 DataAlign   = 64;
+
+    struct FileHeader
+    {
+      char   magic[8];
+      uint32 version;
+      uint32 keyLength;
+      uint64 nArrays;
+      uint64 fileSize;
+    };
+
+    inline uint64 align (uint64 offset, uint64 alignment)
+    {
+      return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // Write the buffer completely.
+    bool writeAll (int fd, const void* buf, size_t size)
+    {
+      const char* ptr = static_cast<const char*>(buf);
+      while (size > 0) {
+        ssize_t n = ::write (fd, ptr, size);
+        if (n < 0) {
+          if (errno == EINTR) continue;
+          return false;
+        }
+        ptr  += n;
+        size -= n;
+      }
+      return true;
+    }
+
+    // Check a mapped cache file and copy its arrays.
+    // It returns false if the file does not match the key or is damaged.
+    bool readEntry (const char* data, uint64 size, const String& key,
+                    std::vector<Array<Complex> >& arrays)
+    {
+      if (size < sizeof(FileHeader)) {
+        return false;
+      }
+      FileHeader header;
+      memcpy (&header, data, sizeof(FileHeader));
+      if (memcmp (header.magic, theMagic, sizeof(theMagic)) != 0  ||
+          header.version != theVersion  ||  header.fileSize != size  ||
+          header.keyLength != key.size()) {
+        return false;
+      }
+      uint64 offset = sizeof(FileHeader);
+      if (offset + header.keyLength > size  ||
+          memcmp (data+offset, key.data(), key.size()) != 0) {
+        return false;
+      }
+      offset = align (offset + header.keyLength, 8);
+      if (header.nArrays > size / (2*sizeof(uint64))) {
+        return false;
+      }
+      arrays.resize (header.nArrays);
+      for (uint64 i=0; i<header.nArrays; ++i) {
+        uint64 desc[2];
+        if (offset + sizeof(desc) > size) {
+          return false;
+        }
+        memcpy (desc, data+offset, sizeof(desc));
+        offset += sizeof(desc);
+        uint64 ndim = desc[0];
+        if (ndim == 0  ||  ndim > 8  ||  offset + ndim*sizeof(int64) > size) {
+          return false;
+        }
+        int64 shp[8];
+        memcpy (shp, data+offset, ndim*sizeof(int64));
+        offset += ndim*sizeof(int64);
+        IPosition shape(ndim);
+        uint64 nelem = 1;
+        for (uint64 j=0; j<ndim; ++j) {
+          if (shp[j] < 0) {
+            return false;
+          }
+          shape[j] = shp[j];
+          nelem *= shp[j];
+        }
+        if (desc[1] % DataAlign != 0  ||
+            desc[1] + nelem*sizeof(Complex) > size) {
+          return false;
+        }
+        arrays[i].resize (shape);
+        memcpy (arrays[i].data(), data+desc[1], nelem*sizeof(Complex));
+      }
+      return true;
+    }
+
+  } //# unnamed namespace
+
+
+  LofarCFCache::LofarCFCache (const String& directory, const String& setupKey)
+    : itsDirectory   (directory),
+      itsSetupKey    (setupKey),
+      itsWriteFailed (false)
+  {
+    if (!itsDirectory.empty()) {
+      if (::mkdir (itsDirectory.c_str(), 0777) != 0  &&  errno != EEXIST) {
+        LOG_WARN_STR ("CF cache directory " << itsDirectory
+                      << " cannot be created: " << strerror(errno)
+                      << "; the CF cache is not used");
+        itsDirectory = String();
+      }
+    }
+  }
+
+  uint64 LofarCFCache::hash (const String& str)
+  {
+    uint64 h = 14695981039346656037ULL;
+    for (String::size_type i=0; i<str.size(); ++i) {
+      h ^= static_cast<unsigned char>(str[i]);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  String LofarCFCache::fileName (const String& key) const
+  {
+    std::ostringstream os;
+    os << itsDirectory << "/cf-" << std::hex << std::setfill('0')
+       << std::setw(16) << hash(itsSetupKey + '\n' + key);
+    return os.str();
+  }
+
+  bool LofarCFCache::get (const String& kind, const String& key,
+                          std::vector<Array<Complex> >& arrays)
+  {
+    if (!isActive()) {
+      return false;
+    }
+    bool found = false;
+    String name = fileName(key);
+    int fd = ::open (name.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      struct stat st;
+      if (fstat (fd, &st) == 0  &&  st.st_size > 0) {
+        void* ptr = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+          found = readEntry (static_cast<const char*>(ptr), st.st_size,
+                             itsSetupKey + '\n' + key, arrays);
+          munmap (ptr, st.st_size);
+        }
+      }
+      ::close (fd);
+      if (!found) {
+        LOG_WARN_STR ("CF cache file " << name
+                      << " is damaged or has another key; it is rewritten");
+      }
+    }
+    if (!found) {
+      arrays.clear();
+    }
+    count (kind, found);
+    return found;
+  }
+
+  void LofarCFCache::put (const String& key,
+                          const std::vector<Array<Complex> >& arrays)
+  {
+    if (!isActive()) {
+      return;
+    }
+    String fullKey = itsSetupKey + '\n' + key;
+    // Make the header, key and array table; then determine the data offsets.
+    FileHeader header;
+    memcpy (header.magic, theMagic, sizeof(theMagic));
+    header.version   = theVersion;
+    header.keyLength = fullKey.size();
+    header.nArrays   = arrays.size();
+    uint64 tableSize = 0;
+    for (uint i=0; i<arrays.size(); ++i) {
+      tableSize += (2 + arrays[i].ndim()) * sizeof(uint64);
+    }
+    uint64 tableStart = align (sizeof(FileHeader) + fullKey.size(), 8);
+    std::vector<char> meta(tableStart + tableSize, 0);
+    std::vector<uint64> offsets(arrays.size());
+    uint64 offset = tableStart + tableSize;
+    char* tablePtr = &meta[0] + tableStart;
+    for (uint i=0; i<arrays.size(); ++i) {
+      offset = align (offset, DataAlign);
+      offsets[i] = offset;
+      uint64 desc[2] = {arrays[i].ndim(), offset};
+      memcpy (tablePtr, desc, sizeof(desc));
+      tablePtr += sizeof(desc);
+      for (uint j=0; j<arrays[i].ndim(); ++j) {
+        int64 len = arrays[i].shape()[j];
+        memcpy (tablePtr, &len, sizeof(len));
+        tablePtr += sizeof(len);
+      }
+      offset += arrays[i].nelements() * sizeof(Complex);
+    }
+    header.fileSize = offset;
+    memcpy (&meta[0], &header, sizeof(FileHeader));
+    memcpy (&meta[sizeof(FileHeader)], fullKey.data(), fullKey.size());
+    // Write into a file with a unique name and rename it when complete,
+    // so other threads or processes never see a partial entry.
+    String name = fileName(key);
+    std::ostringstream tmpName;
+    tmpName << name << ".tmp." << getpid() << '.' << OpenMP::threadNum();
+    bool ok = false;
+    int fd = ::open (tmpName.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                     0666);
+    if (fd >= 0) {
+      ok = writeAll (fd, &meta[0], meta.size());
+      uint64 pos = meta.size();
+      static const char zeroes[DataAlign] = {0};
+      for (uint i=0; ok && i<arrays.size(); ++i) {
+        ok = writeAll (fd, zeroes, offsets[i] - pos);
+        Bool deleteIt;
+        const Complex* data = arrays[i].getStorage (deleteIt);
+        uint64 nbytes = arrays[i].nelements() * sizeof(Complex);
+        ok = ok && writeAll (fd, data, nbytes);
+        arrays[i].freeStorage (data, deleteIt);
+        pos = offsets[i] + nbytes;
+      }
+      ok = (::close(fd) == 0) && ok;
+      ok = ok && ::rename (tmpName.str().c_str(), name.c_str()) == 0;
+    }
+    if (!ok) {
+      ::unlink (tmpName.str().c_str());
+      // Report the first failure only.
+      bool report = false;
+#pragma omp critical(LofarCFCache_put)
+      {
+        report = !itsWriteFailed;
+        itsWriteFailed = true;
+      }
+      if (report) {
+        LOG_WARN_STR ("CF cache file " << name << " cannot be written: "
+                      << strerror(errno));
+      }
+    }
+  }
+
+  void LofarCFCache::count (const String& kind, bool hit)
+  {
+#pragma omp critical(LofarCFCache_count)
+    {
+      std::pair<uint64,uint64>& cnt = itsCounts[kind];
+      if (hit) {
+        cnt.first++;
+      } else {
+        cnt.second++;
+      }
+    }
+  }
+
+  uint64 LofarCFCache::nHits (const String& kind) const
+  {
+    std::map<String, std::pair<uint64,uint64> >::const_iterator iter =
+      itsCounts.find(kind);
+    return iter == itsCounts.end()  ?  0 : iter->second.first;
+  }
+
+  uint64 LofarCFCache::nMisses (const String& kind) const
+  {
+    std::map<String, std::pair<uint64,uint64> >::const_iterator iter =
+      itsCounts.find(kind);
+    return iter == itsCounts.end()  ?  0 : iter->second.second;
+  }
+
+  void LofarCFCache::showStatistics (std::ostream& os) const
+  {
+    if (!isActive()) {
+      return;
+    }
+    os << "  CF cache " << itsDirectory << endl;
+    for (std::map<String, std::pair<uint64,uint64> >::const_iterator iter =
+           itsCounts.begin(); iter != itsCounts.end(); ++iter) {
+      uint64 total = iter->second.first + iter->second.second;
+      int perc = (total==0  ?  0 :
+                  int(1000. * iter->second.first / total + 0.5));
+      os << "    " << std::setw(8) << iter->first << "  hits="
+         << iter->second.first << "  misses=" << iter->second.second
+         << "  hit rate=" << perc/10 << '.' << perc%10 << '%' << endl;
+    }
+  }
+
+} // end namespace
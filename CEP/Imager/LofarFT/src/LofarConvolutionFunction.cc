@@ -309,6 +309,14 @@ namespace LOFAR
     //Matrix<Complex> Avg_PB_padded00(give_normalized_fft(Stack_pb_cf0,false));
     //store(Avg_PB_padded00,"Avg_PB_padded00.img");
 
+    // Use a persistent cache for the W-terms and A-terms if a directory
+    // is given.
+    if (parameters.isDefined("CFCacheDir")  &&
+        !parameters.asString("CFCacheDir").empty()) {
+      itsCFCache = LofarCFCache(parameters.asString("CFCacheDir"),
+                                makeCFCacheSetupKey(ms, ApplyBeamCode));
+    }
+
     // Precalculate the Wtwerm fft for all w-planes.
     store_all_W_images();
     itsFilledVectorMasks=false;
@@ -490,6 +498,16 @@ namespace LOFAR
       for (uInt i=0; i<m_nWPlanes; ++i) {
         timerPar.start();
         Double w = m_wScale.center(i);
+        ostringstream cacheKey;
+        cacheKey.precision(17);
+        cacheKey << "W-term " << i << ' ' << w;
+        vector< Array<Complex> > cached;
+        if (itsCFCache.get ("W-term", cacheKey.str(), cached)  &&
+            cached.size() == 1  &&  cached[0].ndim() == 2) {
+          m_WplanesStore[i].reference (cached[0]);
+          timerPar.stop();
+          continue;
+        }
   //cout<<"i="<<i<<", w="<<w<<endl;
         Double wPixelAngSize = min(m_pixelSizeSpheroidal,
                                    estimateWResolution(m_shape,
@@ -513,6 +531,7 @@ namespace LOFAR
   //store(m_coordinates,wTerm ,"wTerm."+String::toString(i)+".img");
         //normalized_fft(timerFFT, wTerm);
         m_WplanesStore[i].reference (wTerm);
+        itsCFCache.put (cacheKey.str(), vector< Array<Complex> >(1, wTerm));
         timerPar.stop();
       }
       // Update the timing info.
@@ -568,6 +587,46 @@ namespace LOFAR
     aTermList.resize (m_nStations);
     aTermList_element.resize (m_nStations);
     aTermList_station.resize (m_nStations);
+    // Get the A-terms from the CF cache if there. Per station the entry
+    // contains the element beam cubes followed by the m_nChannelBlocks
+    // station beam cubes. A-terms with the ionosphere are not cached,
+    // because they depend on the contents of the parmdb.
+    Bool useCache = (itsCFCache.isActive()  &&
+                     !itsParameters.asBool("applyIonosphere"));
+    ostringstream cacheKey;
+    cacheKey.precision(17);
+    cacheKey << "A-term " << time;
+    if (useCache) {
+      vector< Array<Complex> > cached;
+      uInt nPerStation = 0;
+      Bool ok = (itsCFCache.get ("A-term", cacheKey.str(), cached)  &&
+                 m_nStations > 0);
+      if (ok) {
+        nPerStation = cached.size() / m_nStations;
+        ok = (nPerStation * m_nStations == cached.size()  &&
+              nPerStation >= m_nChannelBlocks);
+        for (uInt i=0; ok && i<cached.size(); ++i) {
+          ok = (cached[i].ndim() == 3);
+        }
+      }
+      if (ok) {
+        uInt nElement = nPerStation - m_nChannelBlocks;
+        for (uInt i=0; i<m_nStations; ++i) {
+          aTermList_element[i].resize (nElement);
+          aTermList_station[i].resize (m_nChannelBlocks);
+          for (uInt j=0; j<nElement; ++j) {
+            aTermList_element[i][j].reference (cached[i*nPerStation + j]);
+          }
+          for (uInt j=0; j<m_nChannelBlocks; ++j) {
+            aTermList_station[i][j].reference
+              (cached[i*nPerStation + nElement + j]);
+          }
+        }
+        aTimer.stop();
+        itsTimeA = aTimer.getReal();
+        return;
+      }
+    }
     ///#pragma omp parallel
     {
       // Thread private variables.
@@ -744,6 +803,16 @@ namespace LOFAR
       ///#pragma omp atomic
       itsTimeApar += ptime;
     } // end omp parallel
+    if (useCache) {
+      vector< Array<Complex> > arrays;
+      for (uInt i=0; i<m_nStations; ++i) {
+        arrays.insert (arrays.end(), aTermList_element[i].begin(),
+                       aTermList_element[i].end());
+        arrays.insert (arrays.end(), aTermList_station[i].begin(),
+                       aTermList_station[i].end());
+      }
+      itsCFCache.put (cacheKey.str(), arrays);
+    }
     aTimer.stop();
     itsTimeA = aTimer.getReal();
     //logIO()<<"LofarConvolutionFunction::computeAterm "<<"...Done!"<< LogIO::POST;//<<endl;
@@ -2384,6 +2453,41 @@ namespace LOFAR
     os << "  (";
     showPerc1 (os, itsTimeCFfft, duration);
     os << " of total;   #ffts=" << itsTimeCFcnt << ')' << endl;
+    itsCFCache.showStatistics (os);
+  }
+
+  String LofarConvolutionFunction::makeCFCacheSetupKey
+  (const MeasurementSet& ms, int ApplyBeamCode) const
+  {
+    // Use full precision, so different setups cannot get the same key.
+    // Increment the version if the way the W-terms or A-terms are
+    // computed changes.
+    ostringstream os;
+    os.precision(17);
+    os << "LofarConvolutionFunction version 1" << endl;
+    os << "shape " << m_shape << " increment " << m_coordinates.increment()
+       << " refval " << m_coordinates.referenceValue()
+       << " refpix " << m_coordinates.referencePixel() << endl;
+    os << "oversampling " << m_oversampling << " maxsupport " << itsMaxSupport
+       << " nwplanes " << m_nWPlanes << " wmax " << m_maxW
+       << " spheroidal " << m_pixelSizeSpheroidal << endl;
+    os << "freqspw " << list_freq_spw << " freqblock " << list_freq_chanBlock
+       << endl;
+    os << "beam " << its_Use_EJones << ' ' << ApplyBeamCode;
+    if (itsParameters.isDefined("applyBeam")) {
+      os << ' ' << itsParameters.asBool("applyBeam");
+    }
+    os << endl;
+    ROMSAntennaColumns antenna(ms.antenna());
+    for (uInt i=0; i<antenna.nrow(); ++i) {
+      os << "station " << antenna.name()(i) << ' ' << antenna.position()(i)
+         << endl;
+    }
+    ROMSFieldColumns field(ms.field());
+    if (field.nrow() > 0) {
+      os << "delaydir " << field.delayDir()(0) << endl;
+    }
+    return os.str();
   }
 
   void LofarConvolutionFunction::showPerc1 (ostream& os,
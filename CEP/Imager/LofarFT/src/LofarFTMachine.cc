@@ -84,6 +84,7 @@
 #include <casa/OS/HostInfo.h>
 #include <casa/BasicMath/Random.h>
 #include <time.h>
+#include <algorithm>
 
 //#include <fftw3.h>
 #include <LofarFT/FFTCMatrix.h>
@@ -181,6 +182,8 @@ LofarFTMachine::LofarFTMachine(Long icachesize, Int itilesize,
   its_TimeWindow=itsParameters.asDouble("timewindow");
   its_UseWSplit=itsParameters.asBool("UseWSplit");
   its_SingleGridMode=itsParameters.asBool("SingleGridMode");
+  its_TiledGridding=(itsParameters.isDefined("TiledGridding") &&
+                     itsParameters.asBool("TiledGridding"));
   its_NGrids=itsNThread;
   if(its_SingleGridMode){its_NGrids=1;}
   its_t0=-1.;
@@ -328,6 +331,7 @@ LofarFTMachine& LofarFTMachine::operator=(const LofarFTMachine& other)
     its_ApplyBeamCode=other.its_ApplyBeamCode;
     itsStepApplyElement=other.itsStepApplyElement;
     its_SingleGridMode=other.its_SingleGridMode;
+    its_TiledGridding=other.its_TiledGridding;
     its_Already_Initialized= other.its_Already_Initialized;
     its_reallyDoPSF = other.its_reallyDoPSF;
     its_PBCut= other.its_PBCut;
@@ -1294,6 +1298,29 @@ void LofarFTMachine::putSplitWplanesOverlap(const VisBuffer& vb, Int row, Bool d
       cout<<"  put::grid ..."<<endl;
     }
     countw+=1;
+  if (its_TiledGridding) {
+    // Grid the chunks of all groups of this W-plane together with the
+    // tiled gridder. The convolution functions are made per batch of
+    // chunks to limit the memory they need.
+    vector<vector<uInt> > chunks;
+    for(uInt igrid=0; igrid<MapBlTimesW_grid[iwplane].size(); ++igrid){
+      chunks.insert (chunks.end(), MapBlTimesW_grid[iwplane][igrid].begin(),
+                     MapBlTimesW_grid[iwplane][igrid].end());
+    }
+    uInt batchSize = 4*itsNThread;
+    for(uInt first=0; first<chunks.size(); first+=batchSize){
+      uInt last = std::min(first+batchSize, uInt(chunks.size()));
+      vector<vector<uInt> > batch(chunks.begin()+first, chunks.begin()+last);
+      vector<LofarCFStore> cfs;
+      makeCFBatch (cfs, vbs, times, batch, BlockCF, Nchannels, false);
+      PrecTimer gridTimer;
+      gridTimer.start();
+      visResamplers_p.lofarDataToGrid_tiled((*itsGriddedData)[0], vbs, batch,
+                                            cfs, itsSumWeight[0], dopsf);
+      gridTimer.stop();
+      itsGriddingTime += gridTimer.getReal();
+    }
+  } else {
   for(uInt igrid=0; igrid<MapBlTimesW_grid[iwplane].size(); ++igrid){
 
     vector<vector<uInt > > MapBlTimes=MapBlTimesW_grid[iwplane][igrid];
@@ -1453,6 +1480,7 @@ void LofarFTMachine::putSplitWplanesOverlap(const VisBuffer& vb, Int row, Bool d
   }//end While loop
 
   }//end grids loop
+  }//end tiled gridding
   tmp_stacked_GriddedData = Complex();
   SumGridsOMP(tmp_stacked_GriddedData, (*itsGriddedData));
   // for (int i=0; i<itsNThread; ++i) {
@@ -1630,6 +1658,60 @@ void LofarFTMachine::putSplitWplanesOverlap(const VisBuffer& vb, Int row, Bool d
 
 }
 
+void LofarFTMachine::makeCFBatch(vector<LofarCFStore>& cfs,
+                                 const LofarVBStore& vbs,
+                                 const Vector<Double>& times,
+                                 const vector<vector<uInt> >& chunks,
+                                 const Vector<uInt>& blockCF,
+                                 uInt nchan, Bool degrid)
+{
+  cfs.resize(chunks.size());
+#pragma omp parallel
+  {
+    PrecTimer cfTimer;
+#pragma omp for schedule(dynamic)
+    for (int i=0; i<int(chunks.size()); ++i) {
+      if (chunks[i].empty()) {
+        cfs[i] = LofarCFStore();
+        continue;
+      }
+      Int ist  = chunks[i].front();
+      Int iend = chunks[i].back();
+      int threadNum = OpenMP::threadNum();
+      // Average weight of the chunk for the CF averaging (gridding only).
+      double average_weight=0.;
+      if (!degrid && itsDonePB==false) {
+        uInt Nvis=0;
+        for (uInt j=0; j<chunks[i].size(); ++j) {
+          uInt row=chunks[i][j];
+          if (!vbs.rowFlag_p[row]) {
+            Nvis+=1;
+            for (uInt k=0; k<nchan; ++k) {
+              average_weight+=vbs.imagingWeight_p(k,row);
+            }
+          }
+        }
+        if (Nvis>0) average_weight/=Nvis;
+      }
+      // Copy the block map per chunk, because a Vector shares its data.
+      Vector<uInt> chanBlock(blockCF.copy());
+      cfTimer.start();
+      cfs[i] = itsConvFunc->makeConvolutionFunction
+        (ant1[ist], ant2[ist], 0.5*(times[ist] + times[iend]),
+         0.5*(vbs.uvw_p(2,ist) + vbs.uvw_p(2,iend)),
+         degrid ? itsDegridMuellerMask : itsGridMuellerMask,
+         degrid, average_weight,
+         itsSumPB[threadNum], itsSumCFWeight[threadNum],
+         chanBlock, thisterm_p, itsRefFreq,
+         itsStackMuellerNew[threadNum], 0, false);
+      cfTimer.stop();
+    }
+    double cftime = cfTimer.getReal();
+#pragma omp atomic
+    itsCFTime += cftime;
+  }
+}
+
 
 
 // Degrid
@@ -1834,6 +1916,24 @@ void LofarFTMachine::getSplitWplanes(VisBuffer& vb, Int row)
     //cout<<" get: degrid "<<iwplane<<endl;
     //itsGridToDegrid.reference(its_stacked_GriddedData);
 
+  if (its_TiledGridding) {
+    // Degrid all chunks of this W-plane with the tiled degridder.
+    uInt batchSize = 4*itsNThread;
+    for(uInt first=0; first<MapBlTimes.size(); first+=batchSize){
+      uInt last = std::min(first+batchSize, uInt(MapBlTimes.size()));
+      vector<vector<uInt> > batch(MapBlTimes.begin()+first,
+                                  MapBlTimes.begin()+last);
+      vector<LofarCFStore> cfs;
+      makeCFBatch (cfs, vbs, times, batch, BlockCF, 0, true);
+      PrecTimer degridTimer;
+      degridTimer.start();
+      visResamplers_p.lofarGridToData_tiled(vbs, itsGridToDegrid, batch, cfs);
+      degridTimer.stop();
+      itsGriddingTime += degridTimer.getReal();
+    }
+    all_done = true;
+  }
+
   while(!all_done){
 
     
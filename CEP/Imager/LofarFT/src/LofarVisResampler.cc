@@ -26,6 +26,7 @@
 #include <coordinates/Coordinates/SpectralCoordinate.h>
 #include <coordinates/Coordinates/CoordinateSystem.h>
 #include <cassert>
+#include <algorithm>
 #include <Common/OpenMP.h>
 
 namespace LOFAR {
@@ -415,6 +416,412 @@ namespace LOFAR {
     //assert(false);
   }
 
+  // Helper functions for the tiled gridder.
+  namespace {
+
+    // Get complex data as interleaved real and imaginary parts.
+    inline Float* realData (Complex* data)
+      { return reinterpret_cast<Float*>(data); }
+    inline Double* realData (DComplex* data)
+      { return reinterpret_cast<Double*>(data); }
+    inline const Float* realData (const Complex* data)
+      { return reinterpret_cast<const Float*>(data); }
+
+    // Add vis[p] * cf to the nx*ny part of a tile buffer, which holds the
+    // npol polarizations of a grid point contiguously. The grid points are
+    // bufXStep apart and the rows bufStride. The x-values of the convolution
+    // function are xStep apart and its rows yStride.
+    // The loop over polarizations is written out on the real and imaginary
+    // parts, so the compiler can vectorize it.
+    template <class RT>
+    inline void gridKernel (RT* __restrict__ buf, Int bufXStep, Int bufStride,
+                            Int npol,
+                            const Complex* __restrict__ cf,
+                            Int xStep, Int yStride, Int nx, Int ny,
+                            const Float* __restrict__ vis)
+    {
+      for (Int y=0; y<ny; ++y) {
+        RT* __restrict__ bufPtr = buf + 2*y*bufStride;
+        const Complex* __restrict__ cfPtr = cf + y*yStride;
+        for (Int x=0; x<nx; ++x) {
+          RT cr = cfPtr->real();
+          RT ci = cfPtr->imag();
+          for (Int p=0; p<npol; ++p) {
+            bufPtr[2*p]   += vis[2*p]*cr - vis[2*p+1]*ci;
+            bufPtr[2*p+1] += vis[2*p]*ci + vis[2*p+1]*cr;
+          }
+          bufPtr += 2*bufXStep;
+          cfPtr  += xStep;
+        }
+      }
+    }
+
+    // Return the sum of grid * cf over the nx*ny part of a grid plane.
+    // The products are first summed over y per x in acc (2*nx values),
+    // which the compiler can vectorize. Only the final sum over x is serial.
+    inline Complex degridKernel (const Float* __restrict__ grid, Int gridStride,
+                                 const Complex* __restrict__ cf,
+                                 Int xStep, Int yStride, Int nx, Int ny,
+                                 Float* __restrict__ acc)
+    {
+      const Float* __restrict__ cfData = realData(cf);
+      for (Int x=0; x<2*nx; ++x) {
+        acc[x] = 0;
+      }
+      for (Int y=0; y<ny; ++y) {
+        const Float* __restrict__ gridPtr = grid + 2*y*gridStride;
+        const Float* __restrict__ cfPtr = cfData + 2*y*yStride;
+        for (Int x=0; x<nx; ++x) {
+          Float gr = gridPtr[2*x];
+          Float gi = gridPtr[2*x+1];
+          Float cr = cfPtr[2*x*xStep];
+          Float ci = cfPtr[2*x*xStep+1];
+          acc[2*x]   += gr*cr - gi*ci;
+          acc[2*x+1] += gr*ci + gi*cr;
+        }
+      }
+      Float sr = 0;
+      Float si = 0;
+      for (Int x=0; x<nx; ++x) {
+        sr += acc[2*x];
+        si += acc[2*x+1];
+      }
+      return Complex(sr, si);
+    }
+
+  } // end anonymous namespace
+
+
+  void LofarVisResampler::makeTilePlan(TilePlan& plan,
+                                       const LofarVBStore& vbs,
+                                       const vector<vector<uInt> >& rows,
+                                       const vector<LofarCFStore>& cfs,
+                                       Int nGridX, Int nGridY, Int nGridChan)
+  {
+    AlwaysAssert (rows.size() == cfs.size(), AipsError);
+    Int nchunk    = rows.size();
+    Int nVisPol   = vbs.flagCube_p.shape()[0];
+    Int nVisChan  = vbs.flagCube_p.shape()[1];
+    // Get the channel mapping once, because the serial gridders map all
+    // channels to grid channel 0 once they have been used (see below).
+    Vector<Int> gridChans(nVisChan);
+    for (Int visChan=0; visChan<nVisChan; ++visChan) {
+      gridChans[visChan] = chanMap_p[visChan];
+    }
+    // The tiles must be at least twice the largest support, otherwise the
+    // buffers of the tiles gridded simultaneously could overlap.
+    plan.xSupport.resize (nchunk);
+    plan.ySupport.resize (nchunk);
+    plan.xStep.resize (nchunk);
+    plan.yStride.resize (nchunk);
+    plan.maxSupport = 0;
+    Bool hasRows = False;
+    for (Int i=0; i<nchunk; ++i) {
+      plan.xSupport[i] = plan.ySupport[i] = 0;
+      plan.xStep[i] = plan.yStride[i] = 0;
+      if (! rows[i].empty()) {
+        hasRows = True;
+        plan.xSupport[i] = cfs[i].xSupport[0];
+        plan.ySupport[i] = cfs[i].ySupport[0];
+        plan.xStep[i]    = SynthesisUtils::nint (cfs[i].sampling[0]);
+        plan.yStride[i]  = SynthesisUtils::nint (cfs[i].sampling[1]) *
+                           (*(cfs[i].vdata))[0][0][0].shape()[0];
+        plan.maxSupport = std::max(plan.maxSupport,
+                                   std::max(plan.xSupport[i], plan.ySupport[i]));
+      }
+    }
+    plan.tileSize = std::max(itsTileSize, 2*plan.maxSupport);
+    plan.nTileX   = (nGridX + plan.tileSize - 1) / plan.tileSize;
+    plan.nTileY   = (nGridY + plan.tileSize - 1) / plan.tileSize;
+
+    // Determine the samples per chunk in parallel.
+    // Flagged samples and samples off the grid are left out.
+    vector<vector<TileSample> > threadSamples(OpenMP::maxThreads());
+#pragma omp parallel for schedule(dynamic)
+    for (Int i=0; i<nchunk; ++i) {
+      if (rows[i].empty()) {
+        continue;
+      }
+      vector<TileSample>& samples = threadSamples[OpenMP::threadNum()];
+      const LofarCFStore& cf = cfs[i];
+      Int nConvX = (*(cf.vdata))[0][0][0].shape()[0];
+      Int nConvY = (*(cf.vdata))[0][0][0].shape()[1];
+      Int sampx = plan.xStep[i];
+      Int sampy = SynthesisUtils::nint (cf.sampling[1]);
+      Int supx = plan.xSupport[i];
+      Int supy = plan.ySupport[i];
+      for (uInt inx=0; inx<rows[i].size(); ++inx) {
+        uInt irow = rows[i][inx];
+        const Double* uvwPtr = vbs.uvw_p.data() + irow*3;
+        for (Int visChan=0; visChan<nVisChan; ++visChan) {
+          Int gridChan = gridChans[visChan];
+          if (gridChan < 0  ||  gridChan >= nGridChan) {
+            continue;
+          }
+          const Bool* flagPtr = vbs.flagCube_p.data() +
+                                (size_t(irow) * nVisChan + visChan) * nVisPol;
+          Bool allFlagged = True;
+          for (Int ipol=0; ipol<nVisPol; ++ipol) {
+            allFlagged = allFlagged && flagPtr[ipol];
+          }
+          if (allFlagged) {
+            continue;
+          }
+          // Determine the grid position as in lofarDataToGrid_interp.
+          Double recipWvl = vbs.freq_p[visChan] / C::c;
+          Double posx = uvwScale_p[0] * uvwPtr[0] * recipWvl + offset_p[0];
+          Double posy = uvwScale_p[1] * uvwPtr[1] * recipWvl + offset_p[1];
+          Int locx = SynthesisUtils::nint (posx);
+          Int locy = SynthesisUtils::nint (posy);
+          // Only use visibility point if the full support is within grid.
+          if (locx-supx < 0  ||  locx+supx >= nGridX  ||
+              locy-supy < 0  ||  locy+supy >= nGridY) {
+            continue;
+          }
+          Int offx = SynthesisUtils::nint ((locx - posx) * sampx);
+          Int offy = SynthesisUtils::nint ((locy - posy) * sampy);
+          offx += (nConvX-1)/2;
+          offy += (nConvY-1)/2;
+          // Keep the support within the convolution function. The serial
+          // gridders read just outside it for an offset of half a pixel.
+          offx = std::min(std::max(offx, supx*sampx), nConvX-1 - supx*sampx);
+          offy = std::min(std::max(offy, supy*sampy), nConvY-1 - supy*sampy);
+          TileSample sample;
+          sample.chunk    = i;
+          sample.row      = irow;
+          sample.chan     = visChan;
+          sample.gridChan = gridChan;
+          sample.locx     = locx;
+          sample.locy     = locy;
+          sample.cf       = (*cf.vdata)[ChanCFMap[visChan]][0][0].data() +
+                            size_t(offy - supy*sampy) * nConvX + offx - supx*sampx;
+          samples.push_back (sample);
+        }
+      }
+    }
+
+    // Sort the samples on tile (counting sort).
+    Int ntile = plan.nTileX * plan.nTileY;
+    plan.tileStart.assign (ntile+1, 0);
+    for (uInt t=0; t<threadSamples.size(); ++t) {
+      for (uInt i=0; i<threadSamples[t].size(); ++i) {
+        const TileSample& sample = threadSamples[t][i];
+        Int tile = (sample.locy / plan.tileSize) * plan.nTileX +
+                   sample.locx / plan.tileSize;
+        plan.tileStart[tile+1]++;
+      }
+    }
+    for (Int tile=0; tile<ntile; ++tile) {
+      plan.tileStart[tile+1] += plan.tileStart[tile];
+    }
+    plan.samples.resize (plan.tileStart[ntile]);
+    vector<size_t> next(plan.tileStart.begin(), plan.tileStart.end() - 1);
+    for (uInt t=0; t<threadSamples.size(); ++t) {
+      for (uInt i=0; i<threadSamples[t].size(); ++i) {
+        const TileSample& sample = threadSamples[t][i];
+        Int tile = (sample.locy / plan.tileSize) * plan.nTileX +
+                   sample.locx / plan.tileSize;
+        plan.samples[next[tile]++] = sample;
+      }
+    }
+
+    // !! dirty trick to select all channels (as done by the serial gridders)
+    if (hasRows) {
+      for (Int visChan=0; visChan<nVisChan; ++visChan) {
+        chanMap_p[visChan]=0;
+      }
+    }
+  }
+
+
+  template
+  void LofarVisResampler::lofarDataToGrid_tiled(Array<Complex>& grid,
+                                                LofarVBStore& vbs,
+                                                const vector<vector<uInt> >& rows,
+                                                const vector<LofarCFStore>& cfs,
+                                                Matrix<Double>& sumwt,
+                                                const Bool& dopsf);
+
+  template
+  void LofarVisResampler::lofarDataToGrid_tiled(Array<DComplex>& grid,
+                                                LofarVBStore& vbs,
+                                                const vector<vector<uInt> >& rows,
+                                                const vector<LofarCFStore>& cfs,
+                                                Matrix<Double>& sumwt,
+                                                const Bool& dopsf);
+
+  template <class T>
+  void LofarVisResampler::lofarDataToGrid_tiled(Array<T>& grid,
+                                                LofarVBStore& vbs,
+                                                const vector<vector<uInt> >& rows,
+                                                const vector<LofarCFStore>& cfs,
+                                                Matrix<Double>& sumwt,
+                                                const Bool& dopsf)
+  {
+    // grid[nx,ny,np,nf]
+    // vbs.data[np,nf,nrow]
+    Int nGridX    = grid.shape()[0];
+    Int nGridY    = grid.shape()[1];
+    Int nGridPol  = grid.shape()[2];
+    Int nGridChan = grid.shape()[3];
+    Int nVisPol   = vbs.flagCube_p.shape()[0];
+    Int nVisChan  = vbs.flagCube_p.shape()[1];
+    Int nPlane    = nGridPol * nGridChan;
+    size_t planeSize = size_t(nGridX) * nGridY;
+
+    TilePlan plan;
+    makeTilePlan (plan, vbs, rows, cfs, nGridX, nGridY, nGridChan);
+    // A tile buffer can hold the tile and a margin of the largest support.
+    Int maxBufX = plan.tileSize + 2*plan.maxSupport;
+
+    Double* __restrict__ sumWtPtr = sumwt.data();
+    Complex psfValues[4];
+    psfValues[0] = psfValues[1] = psfValues[2] = psfValues[3] = Complex(1,0);
+
+#pragma omp parallel
+    {
+      // Thread-private tile buffer [ny,nx,nf,np] and weight sums.
+      vector<T> buffer(size_t(maxBufX) * maxBufX * nPlane);
+      vector<Complex> visWt(nGridPol);
+      vector<Double> sumWt(nPlane, 0.);
+      // Tiles with the same x and y parity are at least a tile apart, so
+      // their buffers can be added to the grid simultaneously. The implicit
+      // barrier of the omp for separates the passes.
+      for (Int pass=0; pass<4; ++pass) {
+        Int px = pass % 2;
+        Int py = pass / 2;
+        Int ntx = (plan.nTileX - px + 1) / 2;
+        Int nty = (plan.nTileY - py + 1) / 2;
+#pragma omp for schedule(dynamic)
+        for (Int it=0; it<ntx*nty; ++it) {
+          Int tile = (py + 2*(it/ntx)) * plan.nTileX + px + 2*(it%ntx);
+          size_t first = plan.tileStart[tile];
+          size_t last  = plan.tileStart[tile+1];
+          if (first == last) {
+            continue;
+          }
+          // Only use the part of the buffer covered by the samples.
+          Int x0 = nGridX;
+          Int y0 = nGridY;
+          Int x1 = 0;
+          Int y1 = 0;
+          for (size_t is=first; is<last; ++is) {
+            const TileSample& sample = plan.samples[is];
+            x0 = std::min(x0, sample.locx - plan.xSupport[sample.chunk]);
+            x1 = std::max(x1, sample.locx + plan.xSupport[sample.chunk] + 1);
+            y0 = std::min(y0, sample.locy - plan.ySupport[sample.chunk]);
+            y1 = std::max(y1, sample.locy + plan.ySupport[sample.chunk] + 1);
+          }
+          Int nBufX = x1 - x0;
+          std::fill (buffer.begin(), buffer.begin() + size_t(nBufX) * (y1-y0) * nPlane,
+                     T());
+          for (size_t is=first; is<last; ++is) {
+            const TileSample& sample = plan.samples[is];
+            size_t doff = (size_t(sample.row) * nVisChan + sample.chan) * nVisPol;
+            const Complex* visPtr  = vbs.visCube_p.data()  + doff;
+            const Bool*    flagPtr = vbs.flagCube_p.data() + doff;
+            if (dopsf) {
+              visPtr = psfValues;
+            }
+            Float imgWt = vbs.imagingWeight_p.data()[size_t(sample.row) * nVisChan +
+                                                     sample.chan];
+            // Weighted visibility per grid polarization.
+            std::fill (visWt.begin(), visWt.end(), Complex());
+            for (Int ipol=0; ipol<nVisPol; ++ipol) {
+              if (! flagPtr[ipol]) {
+                Int gridPol = polMap_p(ipol);
+                if (gridPol >= 0  &&  gridPol < nGridPol) {
+                  visWt[gridPol] += visPtr[ipol] * imgWt;
+                  sumWt[gridPol + sample.gridChan*nGridPol] += imgWt;
+                }
+              }
+            }
+            Int supx = plan.xSupport[sample.chunk];
+            Int supy = plan.ySupport[sample.chunk];
+            T* bufPtr = &(buffer[((size_t(sample.locy - supy - y0) * nBufX +
+                                   sample.locx - supx - x0) * nGridChan +
+                                  sample.gridChan) * nGridPol]);
+            gridKernel (realData(bufPtr), nPlane, nBufX * nPlane, nGridPol,
+                        sample.cf,
+                        plan.xStep[sample.chunk], plan.yStride[sample.chunk],
+                        2*supx+1, 2*supy+1, realData(&(visWt[0])));
+          }
+          // Add the buffer to the grid planes.
+          for (Int plane=0; plane<nPlane; ++plane) {
+            for (Int y=y0; y<y1; ++y) {
+              T* __restrict__ gridPtr = grid.data() + plane*planeSize +
+                                        size_t(y)*nGridX + x0;
+              const T* __restrict__ bufPtr = &(buffer[size_t(y-y0) * nBufX * nPlane +
+                                                      plane]);
+              for (Int x=0; x<nBufX; ++x) {
+                gridPtr[x] += bufPtr[x*nPlane];
+              }
+            }
+          }
+        } // end omp for
+      } // end for pass
+#pragma omp critical(LofarVisResampler_tiled_sumwt)
+      {
+        for (Int i=0; i<nPlane; ++i) {
+          sumWtPtr[i] += sumWt[i];
+        }
+      }
+    } // end omp parallel
+  }
+
+
+  void LofarVisResampler::lofarGridToData_tiled(LofarVBStore& vbs,
+                                                const Array<Complex>& grid,
+                                                const vector<vector<uInt> >& rows,
+                                                const vector<LofarCFStore>& cfs)
+  {
+    Int nGridX    = grid.shape()[0];
+    Int nGridY    = grid.shape()[1];
+    Int nGridPol  = grid.shape()[2];
+    Int nGridChan = grid.shape()[3];
+    Int nVisPol   = vbs.flagCube_p.shape()[0];
+    Int nVisChan  = vbs.flagCube_p.shape()[1];
+    size_t planeSize = size_t(nGridX) * nGridY;
+
+    TilePlan plan;
+    makeTilePlan (plan, vbs, rows, cfs, nGridX, nGridY, nGridChan);
+    Int ntile = plan.nTileX * plan.nTileY;
+
+    // The grid is only read and each sample writes its own visibilities,
+    // so all tiles can be done simultaneously. The tiles keep the part of
+    // the grid used by a thread small.
+#pragma omp parallel
+    {
+      vector<Float> acc(2 * (2*plan.maxSupport + 1));
+#pragma omp for schedule(dynamic)
+      for (Int tile=0; tile<ntile; ++tile) {
+        for (size_t is=plan.tileStart[tile]; is<plan.tileStart[tile+1]; ++is) {
+          const TileSample& sample = plan.samples[is];
+          Int supx = plan.xSupport[sample.chunk];
+          Int supy = plan.ySupport[sample.chunk];
+          size_t doff = (size_t(sample.row) * nVisChan + sample.chan) * nVisPol;
+          Complex*    visPtr  = vbs.visCube_p.data()  + doff;
+          const Bool* flagPtr = vbs.flagCube_p.data() + doff;
+          for (Int ipol=0; ipol<nVisPol; ++ipol) {
+            if (! flagPtr[ipol]) {
+              visPtr[ipol] = Complex(0,0);
+              Int gridPol = polMap_p(ipol);
+              if (gridPol >= 0  &&  gridPol < nGridPol) {
+                const Complex* gridPtr = grid.data() +
+                  (size_t(sample.gridChan)*nGridPol + gridPol) * planeSize +
+                  size_t(sample.locy - supy) * nGridX + sample.locx - supx;
+                visPtr[ipol] = degridKernel (realData(gridPtr), nGridX,
+                                             sample.cf, plan.xStep[sample.chunk],
+                                             plan.yStride[sample.chunk],
+                                             2*supx+1, 2*supy+1, &(acc[0]));
+              }
+            }
+          }
+        }
+      } // end omp for
+    } // end omp parallel
+  }
+
 
   void LofarVisResampler::lofarGridToData_linear(LofarVBStore& vbs,
                                           const Array<Complex>& grid,
@@ -519,6 +519,12 @@ int main (Int argc, char** argv)
     inputs.create ("SingleGridMode", "true",
 		   "If set to true, then the FTMachine uses only one grid.",
 		   "bool");
+    inputs.create ("TiledGridding", "false",
+		   "If set to true, then the baselines of a W-plane are gridded and degridded together by the tiled gridder, which uses all threads also if the convolution functions are small.",
+		   "bool");
+    inputs.create ("CFCacheDir", "",
+		   "Directory of a persistent cache of the W-terms and A-terms. It can be reused by later runs on the same data. No cache is used if empty.",
+		   "string");
     inputs.create ("FindNWplanes", "true",
 		   "If set to true, then find the optimal number of W-planes, given spheroid support, wmax and field of view.",
 		   "bool");
@@ -623,7 +629,9 @@ int main (Int argc, char** argv)
     Double t0 = inputs.getDouble("t0");
     Double t1 = inputs.getDouble("t1");
     Bool SingleGridMode    = inputs.getBool("SingleGridMode");
+    Bool TiledGridding     = inputs.getBool("TiledGridding");
     Bool FindNWplanes    = inputs.getBool("FindNWplanes");
+    String CFCacheDir    = inputs.getString("CFCacheDir");
     Int ChanBlockSize   = inputs.getInt("ChanBlockSize");
     String antenna   = inputs.getString("antenna");
     
@@ -782,7 +790,9 @@ int main (Int argc, char** argv)
     params.define ("t0", t0);
     params.define ("t1", t1);
     params.define ("SingleGridMode", SingleGridMode);
+    params.define ("TiledGridding", TiledGridding);
     params.define ("FindNWplanes", FindNWplanes);
+    params.define ("CFCacheDir", CFCacheDir);
     params.define ("ChanBlockSize", ChanBlockSize);
 
     
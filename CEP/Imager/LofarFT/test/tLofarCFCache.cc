@@ -0,0 +1,108 @@
+//# tLofarCFCache.cc: Test program for class LofarCFCache
+//#
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <LofarFT/LofarCFCache.h>
+#include <casa/Arrays/Cube.h>
+#include <casa/Arrays/Matrix.h>
+#include <casa/Arrays/ArrayMath.h>
+#include <casa/Arrays/ArrayLogical.h>
+#include <casa/OS/Directory.h>
+#include <casa/Utilities/Assert.h>
+#include <casa/iostream.h>
+#include <fstream>
+
+using namespace LOFAR;
+using namespace casa;
+
+void checkEqual (const vector<Array<Complex> >& arr1,
+                 const vector<Array<Complex> >& arr2)
+{
+  AlwaysAssertExit (arr1.size() == arr2.size());
+  for (uInt i=0; i<arr1.size(); ++i) {
+    AlwaysAssertExit (arr1[i].shape().isEqual (arr2[i].shape()));
+    AlwaysAssertExit (allEQ (arr1[i], arr2[i]));
+  }
+}
+
+int main()
+{
+  String dirName ("tLofarCFCache_tmp.cache");
+  Directory dir(dirName);
+  if (dir.exists()) {
+    dir.removeRecursive();
+  }
+  vector<Array<Complex> > arrays;
+  Matrix<Complex> mat(5,7);
+  indgen (mat, Complex(1,2), Complex(0.5,-1));
+  arrays.push_back (mat);
+  Cube<Complex> cube(3,4,4);
+  indgen (cube);
+  arrays.push_back (cube);
+  arrays.push_back (Matrix<Complex>(0,3));
+
+  vector<Array<Complex> > result;
+  {
+    // An inactive cache never finds anything.
+    LofarCFCache cache;
+    AlwaysAssertExit (!cache.isActive());
+    cache.put ("key", arrays);
+    AlwaysAssertExit (!cache.get ("W-term", "key", result));
+  }
+  {
+    LofarCFCache cache(dirName, "setup1");
+    AlwaysAssertExit (cache.isActive());
+    AlwaysAssertExit (!cache.get ("W-term", "w 1", result));
+    cache.put ("w 1", arrays);
+    AlwaysAssertExit (cache.get ("W-term", "w 1", result));
+    checkEqual (arrays, result);
+    // An empty entry.
+    cache.put ("w 2", vector<Array<Complex> >());
+    AlwaysAssertExit (cache.get ("W-term", "w 2", result));
+    AlwaysAssertExit (result.empty());
+    AlwaysAssertExit (cache.nHits("W-term") == 2);
+    AlwaysAssertExit (cache.nMisses("W-term") == 1);
+    AlwaysAssertExit (cache.nHits("A-term") == 0);
+    cache.showStatistics (cout);
+  }
+  {
+    // A new cache object (as in a later run) finds the entries.
+    LofarCFCache cache(dirName, "setup1");
+    AlwaysAssertExit (cache.get ("W-term", "w 1", result));
+    checkEqual (arrays, result);
+    // Another setup does not find them.
+    LofarCFCache cache2(dirName, "setup2");
+    AlwaysAssertExit (!cache2.get ("W-term", "w 1", result));
+    // A damaged entry is a miss and can be rewritten.
+    {
+      std::ofstream ofs(cache.fileName("w 1").c_str(),
+                        std::ios::out | std::ios::trunc);
+      ofs << "garbage";
+    }
+    AlwaysAssertExit (!cache.get ("W-term", "w 1", result));
+    cache.put ("w 1", arrays);
+    AlwaysAssertExit (cache.get ("W-term", "w 1", result));
+    checkEqual (arrays, result);
+  }
+  dir.removeRecursive();
+  return 0;
+}
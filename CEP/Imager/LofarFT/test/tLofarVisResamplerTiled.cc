@@ -0,0 +1,248 @@
+//# tLofarVisResamplerTiled.cc: Test and benchmark of the tiled gridder
+//#
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <LofarFT/LofarVisResampler.h>
+#include <LofarFT/LofarCFStore.h>
+#include <Common/OpenMP.h>
+#include <casa/Arrays/Matrix.h>
+#include <casa/Arrays/Cube.h>
+#include <casa/Arrays/ArrayMath.h>
+#include <casa/Arrays/ArrayLogical.h>
+#include <casa/Utilities/CountedPtr.h>
+#include <casa/BasicSL/Constants.h>
+#include <casa/OS/Timer.h>
+#include <casa/iostream.h>
+#include <casa/sstream.h>
+#include <cstdlib>
+
+using namespace LOFAR;
+using namespace casa;
+
+// This program compares the tiled gridder and degridder of LofarVisResampler
+// with the serial ones (lofarDataToGrid_interp and lofarGridToData_interp)
+// on the uvw tracks of a synthetic array and shows the timings of both.
+//   Usage: tLofarVisResamplerTiled [nant [ntime [nchan [support]]]]
+// Set OMP_NUM_THREADS to see the scaling of the tiled gridder.
+
+// Fill the uvw coordinates of all cross-correlations for ntime hour angles
+// of an array of random antenna positions (in meters) of the given size.
+// The rows are in time order and each baseline is split in chunks of
+// chunkSize times, as done by LofarFTMachine.
+void fillTracks (int nant, int ntime, int chunkSize, double arraySize,
+                 Matrix<Double>& uvw, vector<vector<uInt> >& chunks)
+{
+  srand(1);
+  Matrix<Double> antPos(3, nant);
+  for (int i=0; i<nant; ++i) {
+    antPos(0,i) = arraySize * (rand() / (RAND_MAX+1.) - 0.5);
+    antPos(1,i) = arraySize * (rand() / (RAND_MAX+1.) - 0.5);
+    antPos(2,i) = 0.05 * arraySize * (rand() / (RAND_MAX+1.) - 0.5);
+  }
+  int nbl = nant*(nant-1)/2;
+  uvw.resize (3, nbl*ntime);
+  double dec = 0.9;
+  int bl = 0;
+  for (int a1=0; a1<nant; ++a1) {
+    for (int a2=a1+1; a2<nant; ++a2) {
+      double lx = antPos(0,a2) - antPos(0,a1);
+      double ly = antPos(1,a2) - antPos(1,a1);
+      double lz = antPos(2,a2) - antPos(2,a1);
+      for (int t0=0; t0<ntime; t0+=chunkSize) {
+        vector<uInt> chunk;
+        for (int t=t0; t<std::min(ntime, t0+chunkSize); ++t) {
+          // Hour angle from -3 to +3 hours.
+          double ha = (t / double(ntime) - 0.5) * C::pi / 4;
+          uInt row = t*nbl + bl;
+          uvw(0,row) = sin(ha)*lx + cos(ha)*ly;
+          uvw(1,row) = -sin(dec)*cos(ha)*lx + sin(dec)*sin(ha)*ly + cos(dec)*lz;
+          uvw(2,row) = cos(dec)*cos(ha)*lx - cos(dec)*sin(ha)*ly + sin(dec)*lz;
+          chunk.push_back (row);
+        }
+        chunks.push_back (chunk);
+      }
+      bl++;
+    }
+  }
+}
+
+void fillVBStore (LofarVBStore& vbs, const Matrix<Double>& uvw, int nchan)
+{
+  int nrow = uvw.ncolumn();
+  vbs.nRow_p = nrow;
+  vbs.uvw_p.reference (uvw);
+  vbs.rowFlag_p.resize (nrow);
+  vbs.rowFlag_p = False;
+  vbs.flagCube_p.resize (4, nchan, nrow);
+  vbs.visCube_p.resize (4, nchan, nrow);
+  vbs.imagingWeight_p.resize (nchan, nrow);
+  Bool* flagPtr = vbs.flagCube_p.data();
+  Complex* visPtr = vbs.visCube_p.data();
+  for (uInt i=0; i<vbs.visCube_p.size(); ++i) {
+    visPtr[i] = Complex(sin(0.1*i), cos(0.3*i));
+    flagPtr[i] = (i%17 == 0);
+  }
+  Float* wghtPtr = vbs.imagingWeight_p.data();
+  for (uInt i=0; i<vbs.imagingWeight_p.size(); ++i) {
+    wghtPtr[i] = 1 + i%5;
+  }
+  vbs.freq_p.resize (nchan);
+  indgen (vbs.freq_p, 120e6, 1e6);
+  vbs.dopsf_p = False;
+  vbs.useCorrected_p = True;
+}
+
+// Make a convolution function with 2 CF channels. The serial gridders
+// only use the first Mueller term.
+LofarCFStore fillCFStore (int oversampling, int support, int seed)
+{
+  Vector<Float> samp(2);
+  samp[0] = samp[1] = oversampling;
+  Vector<Int> xsup(2), ysup(2);
+  xsup[0] = xsup[1] = ysup[0] = ysup[1] = support;
+  Int maxXSup=100, maxYSup=100;     // not used
+  Quantity pa;                      // not used
+  CoordinateSystem cs;              // not used
+  CountedPtr<CFTypeVec> dataPtr(new CFTypeVec);
+  CFTypeVec& cfuncs = *dataPtr;
+  cfuncs.resize (2);
+  int cfsz = (2*support + 1) * oversampling;
+  for (int ch=0; ch<2; ++ch) {
+    cfuncs[ch].resize (1);
+    cfuncs[ch][0].resize (1);
+    Matrix<Complex> mat(cfsz, cfsz);
+    Complex* matPtr = mat.data();
+    for (int i=0; i<cfsz*cfsz; ++i) {
+      matPtr[i] = Complex(sin(0.01*i + seed + ch), cos(0.02*i - seed));
+    }
+    cfuncs[ch][0][0].reference (mat);
+  }
+  Matrix<Bool> muellerMask(4,4);
+  muellerMask = False;
+  muellerMask.diagonal() = True;
+  return LofarCFStore(dataPtr, cs, samp, xsup, ysup, maxXSup, maxYSup,
+                      pa, 0, muellerMask);
+}
+
+// Get the largest absolute difference relative to the largest value.
+double relDiff (const Array<Complex>& arr1, const Array<Complex>& arr2)
+{
+  Float maxVal  = max(amplitude(arr1));
+  Float maxDiff = max(amplitude(arr1 - arr2));
+  return maxVal == 0 ? maxDiff : maxDiff / maxVal;
+}
+
+int main (int argc, char* argv[])
+{
+  int nant    = 30;
+  int ntime   = 120;
+  int nchan   = 16;
+  int support = 8;
+  if (argc > 1) istringstream(argv[1]) >> nant;
+  if (argc > 2) istringstream(argv[2]) >> ntime;
+  if (argc > 3) istringstream(argv[3]) >> nchan;
+  if (argc > 4) istringstream(argv[4]) >> support;
+  int nx = 1024;
+  int oversampling = 9;
+  double arraySize = 3000;
+  cout << "nant=" << nant << " ntime=" << ntime << " nchan=" << nchan
+       << " support=" << support << " nthreads=" << OpenMP::maxThreads()
+       << endl;
+
+  // Create the tracks and visibilities and a few different convolution
+  // functions to be used by the chunks in turn.
+  Matrix<Double> uvw;
+  vector<vector<uInt> > chunks;
+  fillTracks (nant, ntime, 10, arraySize, uvw, chunks);
+  LofarVBStore vbs;
+  fillVBStore (vbs, uvw, nchan);
+  vector<LofarCFStore> cfs;
+  for (uInt i=0; i<chunks.size(); ++i) {
+    cfs.push_back (fillCFStore (oversampling, support + i%3, i%3));
+  }
+  // Set up the gridder such that the longest baseline fits in the grid.
+  // The last polarization is not used and the even and odd channels use
+  // the 2 different CF channels.
+  LofarVisResampler gridder;
+  Vector<Int> chanMap(nchan, 0);
+  Vector<Int> polMap(4);
+  indgen (polMap);
+  polMap[3] = -1;
+  Vector<uInt> cfChanMap(nchan);
+  for (int i=0; i<nchan; ++i) {
+    cfChanMap[i] = i%2;
+  }
+  Double maxuv = 1.5 * arraySize * max(vbs.freq_p) / C::c;
+  Vector<Double> uvScale(3, (nx/2 - 2*support) / maxuv);
+  Vector<Double> uvOffset(3, nx/2);
+  uvOffset[2] = 0;
+  Vector<Double> dphase(uvw.ncolumn(), 0.);
+  gridder.setParams (uvScale, uvOffset, dphase);
+
+  // Grid serially per chunk and with the tiled gridder.
+  Array<Complex> grid1(IPosition(4, nx, nx, 4, 1), Complex());
+  Array<Complex> grid2(IPosition(4, nx, nx, 4, 1), Complex());
+  Matrix<Double> sumWeight1(4, 1, 0.);
+  Matrix<Double> sumWeight2(4, 1, 0.);
+  gridder.setMaps (chanMap, polMap);
+  gridder.setChanCFMaps (cfChanMap);
+  Timer timer;
+  for (uInt i=0; i<chunks.size(); ++i) {
+    gridder.lofarDataToGrid_interp (grid1, vbs, Vector<uInt>(chunks[i]),
+                                    sumWeight1, False, cfs[i]);
+  }
+  double serialTime = timer.real();
+  gridder.setMaps (chanMap, polMap);
+  timer.mark();
+  gridder.lofarDataToGrid_tiled (grid2, vbs, chunks, cfs, sumWeight2, False);
+  double tiledTime = timer.real();
+  cout << "gridding:   serial " << serialTime << " sec, tiled " << tiledTime
+       << " sec" << endl;
+  AlwaysAssertExit (relDiff(grid1, grid2) < 1e-5);
+  AlwaysAssertExit (allNear (sumWeight1, sumWeight2, 1e-10));
+  AlwaysAssertExit (sumWeight1(3,0) == 0  &&  sumWeight1(0,0) > 0);
+
+  // Degrid both ways from the gridded data.
+  Cube<Complex> origVis = vbs.visCube_p.copy();
+  timer.mark();
+  for (uInt i=0; i<chunks.size(); ++i) {
+    gridder.lofarGridToData_interp (vbs, grid1, Vector<uInt>(chunks[i]),
+                                    cfs[i]);
+  }
+  serialTime = timer.real();
+  Cube<Complex> vis1 = vbs.visCube_p.copy();
+  vbs.visCube_p = origVis;
+  timer.mark();
+  gridder.lofarGridToData_tiled (vbs, grid1, chunks, cfs);
+  tiledTime = timer.real();
+  cout << "degridding: serial " << serialTime << " sec, tiled " << tiledTime
+       << " sec" << endl;
+  AlwaysAssertExit (relDiff(vis1, vbs.visCube_p) < 1e-5);
+  // Flagged visibilities must be untouched.
+  const Bool* flagPtr = vbs.flagCube_p.data();
+  for (uInt i=0; i<origVis.size(); ++i) {
+    if (flagPtr[i]) {
+      AlwaysAssertExit (vbs.visCube_p.data()[i] == origVis.data()[i]);
+    }
+  }
+  return 0;
+}
@@ -46,7 +46,7 @@ namespace BBS {
     ParmDBMeta();
 
     // Construct from a given type and file/table name.
-    // The type can be empty, casa or blob.
+    // The type can be empty, casa, blob, or snapshot.
     // If empty, the code doing the open will detect the exact type. At the
     // moment that can only be used for SourceDB.
     ParmDBMeta (const std::string& type, const std::string& tableName);
@@ -0,0 +1,156 @@
+//# ParmDBSnapshot.h: Read-only ParmDB held in a memory-mapped snapshot file
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+// @file
+// @brief Read-only ParmDB held in a memory-mapped snapshot file
+
+#ifndef LOFAR_PARMDB_PARMDBSNAPSHOT_H
+#define LOFAR_PARMDB_PARMDBSNAPSHOT_H
+
+//# Includes
+#include <ParmDB/ParmDB.h>
+#include <ParmDB/SnapshotFile.h>
+
+
+namespace LOFAR {
+namespace BBS {
+
+
+  // @ingroup ParmDB
+  // @{
+
+  // @brief Read-only ParmDB held in a memory-mapped snapshot file.
+
+  // This class gives access to a snapshot file created by
+  // SnapshotFile::create (e.g. using the program makesnapshotdb).
+  // It gives the same results as the ParmDB the snapshot was made from,
+  // but the queries are served from memory using the indices in the file.
+  // This makes it suitable for calibration and imaging runs that need to
+  // look up many parameters for many domains.
+  // <br>The snapshot cannot be changed; functions doing so throw an
+  // exception.
+  class ParmDBSnapshot : public ParmDBRep
+  {
+  public:
+    explicit ParmDBSnapshot (const std::string& fileName, bool forceNew=false);
+
+    virtual ~ParmDBSnapshot();
+
+    // Create a snapshot file from the given ParmDB.
+    static void create (const std::string& fileName, ParmDB& parmDB);
+
+    // Flush possible changes to disk.
+    // It does not do anything.
+    virtual void flush (bool fsync);
+
+    // Writelock and unlock the file.
+    // They do not do anything.
+    // <group>
+    virtual void lock (bool lockForWrite);
+    virtual void unlock();
+    // </group>
+
+    // Get the domain range (time,freq) of the given parameters in the table.
+    // This is the minimum and maximum value of these axes for all parameters.
+    // An empty name pattern is the same as * (all parms).
+    // <group>
+    virtual Box getRange (const std::string& parmNamePattern) const;
+    virtual Box getRange (const std::vector<std::string>& parmNames) const;
+    // </group>
+
+    // Set the default step values.
+    // It throws an exception.
+    virtual void setDefaultSteps (const vector<double>&);
+
+    // Get the parameter values for the given parameters and domain.
+    // The parmids form the indices in the result vector.
+    virtual void getValues (vector<ParmValueSet>& values,
+                            const vector<uint>& nameIds,
+                            const vector<ParmId>& parmIds,
+                            const Box& domain);
+
+    // Put the values for the given parameter name and id.
+    // It throws an exception.
+    virtual void putValues (const string& parmName, int& nameId,
+                            ParmValueSet& values);
+
+    // Delete the value records for the given parameters and domain.
+    // It throws an exception.
+    virtual void deleteValues (const std::string& parmNamePattern,
+                               const Box& domain);
+
+    // Get the default value for the given parameters.
+    // Only * and ? should be used in the pattern (no [] and {}).
+    virtual void getDefValues (ParmMap& result,
+                               const std::string& parmNamePattern);
+
+    // Put the default value.
+    // It throws an exception.
+    virtual void putDefValue (const string& name, const ParmValueSet& value,
+                              bool check=true);
+
+    // Delete the default value records for the given parameters.
+    // It throws an exception.
+    virtual void deleteDefValues (const std::string& parmNamePattern);
+
+    // Get the names of all parms matching the given (filename like) pattern.
+    virtual std::vector<std::string> getNames (const std::string& pattern);
+
+    // Get the id of a parameter.
+    // If not found in the Names table, it returns -1.
+    virtual int getNameId (const std::string& parmName);
+
+    // Clear database or table.
+    // It throws an exception.
+    virtual void clearTables();
+
+  private:
+    // Fill the map with default values.
+    virtual void fillDefMap (ParmMap& defMap);
+
+    // Get the ids of the names matching the pattern.
+    vector<uint> getNameIds (const std::string& parmNamePattern) const;
+
+    // Get the bounding box of the values of the given parameters.
+    Box findRange (const vector<uint>& nameIds) const;
+
+    // Find the value records of a parameter overlapping the domain.
+    void findValues (vector<const SnapshotFile::ValueRecord*>& values,
+                     const SnapshotFile::NameRecord& name,
+                     const Box& domain) const;
+
+    // Convert a default value record to a ParmValueSet.
+    ParmValueSet makeDefValue (const SnapshotFile::DefValueRecord&) const;
+
+    // Get an axis of a scalar ParmValue.
+    Axis::ShPtr getInterval (uint64 offset, double st, double end,
+                             uint n) const;
+
+    SnapshotFile itsFile;
+  };
+
+  // @}
+
+} // namespace BBS
+} // namespace LOFAR
+
+#endif
@@ -0,0 +1,255 @@
+//# SnapshotFile.h: Read-only memory-mapped snapshot of a ParmDB or SourceDB
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+// @file
+// @brief Read-only memory-mapped snapshot of a ParmDB or SourceDB
+
+#ifndef LOFAR_PARMDB_SNAPSHOTFILE_H
+#define LOFAR_PARMDB_SNAPSHOTFILE_H
+
+//# Includes
+#include <Common/LofarTypes.h>
+#include <Common/lofar_smartptr.h>
+#include <Common/lofar_string.h>
+#include <Common/lofar_vector.h>
+#include <casa/Arrays/Array.h>
+
+namespace LOFAR {
+
+  //# Forward Declarations.
+  class Mmap;
+
+namespace BBS {
+
+  //# Forward Declarations.
+  class ParmDB;
+  class SourceDB;
+
+  // @ingroup ParmDB
+  // @{
+
+  // @brief Read-only memory-mapped snapshot of a ParmDB or SourceDB.
+  // A snapshot holds the full contents of a ParmDB (and optionally the
+  // patches and sources of a SourceDB) in a single file that is mapped
+  // into memory as a whole. Queries do not need any I/O or table access:
+  // <ul>
+  //  <li> Names are found with an open addressing hash index.
+  //  <li> The value records of a parameter are stored consecutively and
+  //       sorted on start of the first axis. Together with the running
+  //       maximum of the end of the first axis they form an interval index,
+  //       so the records overlapping a domain are found by a binary search
+  //       followed by a short linear scan.
+  //  <li> All values, errors, and intervals are stored in one contiguous
+  //       array of doubles.
+  //  <li> Patches are stored in the order returned by getPatches, so
+  //       selecting patches does not need to sort.
+  //  <li> Sources are stored as SourceData blobs, grouped per patch via
+  //       a list of source indices.
+  // </ul>
+  // The file is written in native byte order, which is checked when it is
+  // opened. All records are 8-byte aligned.
+  class SnapshotFile
+  {
+  public:
+    // Value used for a missing index or offset.
+    static const uint64 NONE = ~uint64(0);
+
+    // The sections in the file.
+    enum SectionId {
+      // Nul-terminated names, blob-encoded sources, and solvable masks.
+      BYTES,
+      // NameRecord per parameter; the index is the nameId.
+      NAMES,
+      // Hash index (uint32) on the parameter names.
+      NAME_INDEX,
+      // ValueRecord per value domain, grouped per parameter.
+      VALUES,
+      // Running maximum (double) of the end of the first axis per
+      // ValueRecord, reset at the first record of each parameter.
+      MAX_ENDS,
+      // Values, errors, and intervals.
+      DOUBLES,
+      // DefValueRecord per default value.
+      DEF_VALUES,
+      // PatchRecord per patch, sorted on category, brightness, and name.
+      PATCHES,
+      // Hash index (uint32) on the patch names.
+      PATCH_INDEX,
+      // Index (uint32) in SOURCES of the sources of each patch.
+      PATCH_MEMBERS,
+      // SourceRecord per source in the original order.
+      SOURCES,
+      // Hash index (uint32) on the source names.
+      SOURCE_INDEX,
+      N_SECTION
+    };
+
+    // Offset and size (in bytes) of a section.
+    struct Section {
+      uint64 offset;
+      uint64 size;
+    };
+
+    struct Header {
+      char    magic[8];
+      uint32  version;
+      uint32  byteOrder;
+      double  defSteps[2];
+      Section sections[N_SECTION];
+    };
+
+    // Reference to an array of at most 2 dimensions.
+    // The offset is an element index in DOUBLES (or BYTES for a mask).
+    // A zero ndim means the array is not defined.
+    struct ArrayRef {
+      uint64 offset;
+      uint32 ndim;
+      uint32 shape[2];
+      uint32 pad;
+    };
+
+    struct NameRecord {
+      uint64   name;                   //# offset in BYTES
+      int32    type;                   //# ParmValue::FunkletType
+      uint32   pertRel;
+      double   perturbation;
+      double   range[4];               //# sx, ex, sy, ey of all values
+      ArrayRef mask;
+      uint64   firstValue;             //# index in VALUES
+      uint64   nValues;
+    };
+
+    struct ValueRecord {
+      double   sx, ex, sy, ey;
+      int64    rowId;
+      ArrayRef values;
+      ArrayRef errors;
+      uint64   intervalsX;             //# offset of (center,width) in DOUBLES
+      uint64   intervalsY;             //# or NONE for a regular axis
+    };
+
+    struct DefValueRecord {
+      uint64   name;
+      int32    type;
+      uint32   pertRel;
+      double   perturbation;
+      double   scaleDomain[4];         //# sx, ex, sy, ey
+      ArrayRef values;
+      ArrayRef mask;
+    };
+
+    struct PatchRecord {
+      uint64 name;
+      int32  category;
+      uint32 pad;
+      double ra;
+      double dec;
+      double brightness;
+      uint64 firstMember;              //# index in PATCH_MEMBERS
+      uint64 nMembers;
+    };
+
+    struct SourceRecord {
+      uint64 name;
+      uint64 patch;                    //# index in PATCHES or NONE
+      uint64 data;                     //# offset of SourceData blob in BYTES
+      uint64 size;
+    };
+
+    // Map the given snapshot file into memory.
+    // An exception is thrown if it is not a valid snapshot file.
+    explicit SnapshotFile (const string& fileName);
+
+    ~SnapshotFile();
+
+    // Test if the given file is a snapshot file.
+    static bool isSnapshot (const string& fileName);
+
+    // Create a snapshot file from the given ParmDB and, if given, the
+    // patches and sources of a SourceDB. Normally the ParmDB is the one
+    // returned by SourceDB::getParmDB.
+    static void create (const string& fileName, ParmDB& parmDB,
+                        SourceDB* sourceDB=0);
+
+    const string& fileName() const
+      { return itsFileName; }
+
+    const Header& header() const
+      { return *itsHeader; }
+
+    // Get the number of records in a section.
+    template<typename T>
+    uint64 size (SectionId id) const
+      { return itsHeader->sections[id].size / sizeof(T); }
+
+    // Get a pointer to the records in a section.
+    template<typename T>
+    const T* records (SectionId id) const
+      { return reinterpret_cast<const T*>
+          (itsData + itsHeader->sections[id].offset); }
+
+    // Get a string or blob from the BYTES section.
+    const char* getBytes (uint64 offset) const
+      { return records<char>(BYTES) + offset; }
+
+    // Get a pointer into the DOUBLES section.
+    const double* getDoubles (uint64 offset) const
+      { return records<double>(DOUBLES) + offset; }
+
+    // Copy an array from the DOUBLES or BYTES section.
+    // <group>
+    casa::Array<double> getArray (const ArrayRef&) const;
+    casa::Array<bool> getMask (const ArrayRef&) const;
+    // </group>
+
+    // Find a name using a hash index.
+    // It returns the index of the record in the indexed section or -1.
+    // <group>
+    int64 findName (const string& name) const;
+    int64 findPatch (const string& name) const;
+    int64 findSource (const string& name) const;
+    // </group>
+
+    // Hash function used for the indices.
+    static uint32 hash (const char* str, size_t length);
+
+  private:
+    // Forbid copy and assignment.
+    SnapshotFile (const SnapshotFile&);
+    SnapshotFile& operator= (const SnapshotFile&);
+
+    // Look up a name in the hash index of the given section.
+    template<typename T>
+    int64 find (SectionId index, SectionId section, const string& name) const;
+
+    string             itsFileName;
+    scoped_ptr<Mmap>   itsMap;
+    const char*        itsData;
+    const Header*      itsHeader;
+  };
+
+  // @}
+
+} // namespace BBS
+} // namespace LOFAR
+
+#endif
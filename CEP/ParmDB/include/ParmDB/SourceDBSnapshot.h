@@ -0,0 +1,179 @@
+//# SourceDBSnapshot.h: Read-only SourceDB held in a memory-mapped snapshot file
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+// @file
+// @brief Read-only SourceDB held in a memory-mapped snapshot file
+
+#ifndef LOFAR_PARMDB_SOURCEDBSNAPSHOT_H
+#define LOFAR_PARMDB_SOURCEDBSNAPSHOT_H
+
+//# Includes
+#include <ParmDB/SourceDB.h>
+#include <ParmDB/SnapshotFile.h>
+
+namespace LOFAR {
+namespace BBS {
+
+  // @ingroup ParmDB
+  // @{
+
+  // @brief Read-only SourceDB held in a memory-mapped snapshot file.
+
+  // This class gives access to the patches and sources in a snapshot file
+  // created by SnapshotFile::create (e.g. using the program
+  // makesnapshotdb). The default values of the source parameters are
+  // served by the ParmDBSnapshot on the same file.
+  // <br>The patches are stored in the order of getPatches, so selecting
+  // patches does not need to sort. The sources of a patch and a source
+  // by name are found using the indices in the file.
+  // <br>The snapshot cannot be changed; functions doing so throw an
+  // exception.
+  class SourceDBSnapshot : public SourceDBRep
+  {
+  public:
+    SourceDBSnapshot (const ParmDBMeta& pdm, bool forceNew);
+
+    virtual ~SourceDBSnapshot();
+
+    // Create a snapshot file from the given SourceDB and its ParmDB.
+    static void create (const string& fileName, SourceDB& sourceDB);
+
+    // Check for duplicate patches or sources.
+    // An exception is thrown if that is the case.
+    virtual void checkDuplicates();
+
+    // Find non-unique patch names.
+    virtual vector<string> findDuplicatePatches();
+
+    // Find non-unique source names.
+    virtual vector<string> findDuplicateSources();
+
+    // Test if the patch already exists.
+    virtual bool patchExists (const string& patchName);
+
+    // Test if the source already exists.
+    virtual bool sourceExists (const string& sourceName);
+
+    // Add a patch and return its patchId.
+    // It throws an exception.
+    virtual uint addPatch (const string& patchName, int catType,
+                           double apparentBrightness,
+                           double ra, double dec,
+                           bool check);
+
+    // Update the ra/dec and apparent brightness of a patch.
+    // It throws an exception.
+    virtual void updatePatch (uint patchId,
+                              double apparentBrightness,
+                              double ra, double dec);
+
+    // Add a source to a patch.
+    // It throws an exception.
+    // <group>
+    virtual void addSource (const SourceInfo& sourceInfo,
+                            const string& patchName,
+                            const ParmMap& defaultParameters,
+                            double ra, double dec,
+                            bool check);
+    virtual void addSource (const SourceData& source,
+                            bool check);
+    virtual void addSource (const SourceInfo& sourceInfo,
+                            const string& patchName,
+                            int catType,
+                            double apparentBrightness,
+                            const ParmMap& defaultParameters,
+                            double ra, double dec,
+                            bool check);
+    // </group>
+
+    // Get patch names in order of category and decreasing apparent flux.
+    // category < 0 means all categories.
+    // A brightness < 0 means no test on brightness.
+    virtual vector<string> getPatches (int category, const string& pattern,
+                                       double minBrightness,
+                                       double maxBrightness);
+
+    // Get the info of all patches (name, ra, dec).
+    virtual vector<PatchInfo> getPatchInfo (int category,
+                                            const string& pattern,
+                                            double minBrightness,
+                                            double maxBrightness);
+
+    // Get the sources belonging to the given patch.
+    virtual vector<SourceInfo> getPatchSources (const string& patchName);
+
+    // Get all data of the sources belonging to the given patch.
+    virtual vector<SourceData> getPatchSourceData (const string& patchName);
+
+    // Get the source info of the given source.
+    virtual SourceInfo getSource (const string& sourceName);
+
+    // Get the info of all sources matching the given (filename like) pattern.
+    virtual vector<SourceInfo> getSources (const string& pattern);
+
+    // Delete the sources records matching the given (filename like) pattern.
+    // It throws an exception.
+    virtual void deleteSources (const std::string& sourceNamePattern);
+
+    // Clear file (i.e. remove everything).
+    // It throws an exception.
+    virtual void clearTables();
+
+    // Get the next source from the file.
+    // An exception is thrown if there are no more sources.
+    virtual void getNextSource (SourceData& src);
+
+    // Tell if we are the end of the file.
+    virtual bool atEnd();
+
+    // Reset to the beginning of the file.
+    virtual void rewind();
+
+  private:
+    // Get the indices of the patches matching the selection criteria.
+    vector<uint> selectPatches (int category, const string& pattern,
+                                double minBrightness,
+                                double maxBrightness) const;
+
+    // Get the indices of the sources of a patch.
+    // An empty range is returned for an unknown patch.
+    std::pair<const uint32*, const uint32*>
+    getMembers (const string& patchName) const;
+
+    // Decode the source with the given index.
+    void readSource (uint64 index, SourceData& src) const;
+
+    // Find the names occurring more than once in a section.
+    template<typename T>
+    vector<string> findDuplicates (SnapshotFile::SectionId section) const;
+
+    //# Data members
+    SnapshotFile itsFile;
+    uint64       itsNext;
+  };
+
+  // @}
+
+} // namespace BBS
+} // namespace LOFAR
+
+#endif
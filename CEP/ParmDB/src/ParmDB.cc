@@ -25,6 +25,7 @@
 #include <ParmDB/ParmDB.h>
 #include <ParmDB/ParmDBCasa.h>
 #include <ParmDB/ParmDBBlob.h>
+#include <ParmDB/ParmDBSnapshot.h>
 #if 0
 #include <ParmDB/ParmDBPostgres.h>
 #endif
@@ -143,6 +144,8 @@ namespace BBS {
       itsRep = new ParmDBCasa (ptm.getTableName(), forceNew);
     } else if (ptm.getType() == "blob") {
       itsRep = new ParmDBBlob (ptm.getTableName(), forceNew);
+    } else if (ptm.getType() == "snapshot") {
+      itsRep = new ParmDBSnapshot (ptm.getTableName(), forceNew);
       ///  } else if (ptm.getType() == "bdb") {
       ///itsRep = new ParmDBBDB (ptm, forceNew);
     } else if (ptm.getType() == "postgres") {
@@ -0,0 +1,368 @@
+//# ParmDBSnapshot.cc: Read-only ParmDB held in a memory-mapped snapshot file
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <ParmDB/ParmDBSnapshot.h>
+#include <ParmDB/ParmMap.h>
+#include <Common/LofarLogger.h>
+
+#include <casa/BasicMath/Math.h>
+#include <casa/BasicSL/String.h>
+#include <casa/Utilities/Regex.h>
+#include <algorithm>
+
+using namespace std;
+using namespace casa;
+
+namespace LOFAR {
+namespace BBS {
+
+  namespace {
+    bool compareRowId (const SnapshotFile::ValueRecord* v1,
+                       const SnapshotFile::ValueRecord* v2)
+    {
+      return v1->rowId < v2->rowId;
+    }
+
+    bool compareStart (const SnapshotFile::ValueRecord& v, double value)
+    {
+      return v.sx < value;
+    }
+
+    // Test if an interval overlaps [lower,upper] in the same way as
+    // ParmDBCasa selects the records.
+    bool overlaps (double lower, double upper, double st, double end)
+    {
+      return lower < end  &&  !near(lower, end, 1e-12)  &&
+        upper > st  &&  !near(upper, st, 1e-12);
+    }
+  }
+
+  ParmDBSnapshot::ParmDBSnapshot (const string& fileName, bool forceNew)
+    : itsFile (fileName)
+  {
+    ASSERTSTR (!forceNew, "ParmDBSnapshot " << fileName
+               << " is read-only and cannot be created");
+    setDefStep (0, itsFile.header().defSteps[0]);
+    setDefStep (1, itsFile.header().defSteps[1]);
+  }
+
+  ParmDBSnapshot::~ParmDBSnapshot()
+  {}
+
+  void ParmDBSnapshot::create (const string& fileName, ParmDB& parmDB)
+  {
+    SnapshotFile::create (fileName, parmDB);
+  }
+
+  void ParmDBSnapshot::flush (bool)
+  {}
+
+  void ParmDBSnapshot::lock (bool)
+  {}
+
+  void ParmDBSnapshot::unlock()
+  {}
+
+  void ParmDBSnapshot::clearTables()
+  {
+    THROW (Exception, "ParmDBSnapshot is read-only");
+  }
+
+  void ParmDBSnapshot::setDefaultSteps (const vector<double>&)
+  {
+    THROW (Exception, "ParmDBSnapshot is read-only");
+  }
+
+  int ParmDBSnapshot::getNameId (const std::string& parmName)
+  {
+    return itsFile.findName (parmName);
+  }
+
+  vector<uint> ParmDBSnapshot::getNameIds (const string& parmNamePattern) const
+  {
+    uint nname = itsFile.size<SnapshotFile::NameRecord>(SnapshotFile::NAMES);
+    const SnapshotFile::NameRecord* names =
+      itsFile.records<SnapshotFile::NameRecord>(SnapshotFile::NAMES);
+    vector<uint> nameIds;
+    nameIds.reserve (nname);
+    if (parmNamePattern.empty()  ||  parmNamePattern == "*") {
+      for (uint i=0; i<nname; ++i) {
+        nameIds.push_back (i);
+      }
+    } else {
+      Regex regex(Regex::fromPattern(parmNamePattern));
+      for (uint i=0; i<nname; ++i) {
+        if (String(itsFile.getBytes(names[i].name)).matches (regex)) {
+          nameIds.push_back (i);
+        }
+      }
+    }
+    return nameIds;
+  }
+
+  Box ParmDBSnapshot::getRange (const string& parmNamePattern) const
+  {
+    return findRange (getNameIds (parmNamePattern));
+  }
+
+  Box ParmDBSnapshot::getRange (const std::vector<std::string>& parmNames) const
+  {
+    if (parmNames.empty()) {
+      return findRange (getNameIds (""));
+    }
+    vector<uint> nameIds;
+    nameIds.reserve (parmNames.size());
+    for (uint i=0; i<parmNames.size(); ++i) {
+      int64 id = itsFile.findName (parmNames[i]);
+      if (id >= 0) {
+        nameIds.push_back (id);
+      }
+    }
+    return findRange (nameIds);
+  }
+
+  Box ParmDBSnapshot::findRange (const vector<uint>& nameIds) const
+  {
+    const SnapshotFile::NameRecord* names =
+      itsFile.records<SnapshotFile::NameRecord>(SnapshotFile::NAMES);
+    bool found = false;
+    double range[4] = {0, 0, 0, 0};
+    for (vector<uint>::const_iterator iter=nameIds.begin();
+         iter!=nameIds.end(); ++iter) {
+      const SnapshotFile::NameRecord& name = names[*iter];
+      if (name.nValues > 0) {
+        if (!found) {
+          std::copy (name.range, name.range+4, range);
+          found = true;
+        } else {
+          range[0] = std::min(range[0], name.range[0]);
+          range[1] = std::max(range[1], name.range[1]);
+          range[2] = std::min(range[2], name.range[2]);
+          range[3] = std::max(range[3], name.range[3]);
+        }
+      }
+    }
+    if (!found) {
+      return Box();
+    }
+    return Box (Point(range[0], range[2]), Point(range[1], range[3]));
+  }
+
+  void ParmDBSnapshot::findValues
+  (vector<const SnapshotFile::ValueRecord*>& values,
+   const SnapshotFile::NameRecord& name,
+   const Box& domain) const
+  {
+    values.clear();
+    const SnapshotFile::ValueRecord* first =
+      itsFile.records<SnapshotFile::ValueRecord>(SnapshotFile::VALUES)
+      + name.firstValue;
+    const SnapshotFile::ValueRecord* last = first + name.nValues;
+    bool selx = domain.lowerX() < domain.upperX();
+    bool sely = domain.lowerY() < domain.upperY();
+    if (selx) {
+      // The records are sorted on start, so records starting at or after
+      // the end of the domain cannot overlap. Scan backwards until the
+      // running maximum of the end shows that no earlier record can reach
+      // the start of the domain.
+      const double* maxEnds =
+        itsFile.records<double>(SnapshotFile::MAX_ENDS) + name.firstValue;
+      last = lower_bound (first, last, domain.upperX(), compareStart);
+      for (const SnapshotFile::ValueRecord* iter = last;
+           iter != first  &&  maxEnds[iter - first - 1] > domain.lowerX(); ) {
+        --iter;
+        if (overlaps (domain.lowerX(), domain.upperX(), iter->sx, iter->ex)
+        &&  (!sely  ||  overlaps (domain.lowerY(), domain.upperY(),
+                                  iter->sy, iter->ey))) {
+          values.push_back (iter);
+        }
+      }
+    } else {
+      for (const SnapshotFile::ValueRecord* iter = first;
+           iter != last;  ++iter) {
+        if (!sely  ||  overlaps (domain.lowerY(), domain.upperY(),
+                                 iter->sy, iter->ey)) {
+          values.push_back (iter);
+        }
+      }
+    }
+    // Return the records in the order they had in the original ParmDB.
+    sort (values.begin(), values.end(), compareRowId);
+  }
+
+  Axis::ShPtr ParmDBSnapshot::getInterval (uint64 offset, double st,
+                                           double end, uint n) const
+  {
+    if (offset == SnapshotFile::NONE) {
+      return Axis::ShPtr(new RegularAxis (st, end, n, true));
+    }
+    const double* arrp = itsFile.getDoubles (offset);
+    vector<double> vc, vw;
+    vc.reserve(n);
+    vw.reserve(n);
+    for (uint i=0; i<n; ++i) {
+      vc.push_back (*arrp++);
+      vw.push_back (*arrp++);
+    }
+    return Axis::ShPtr(new OrderedAxis (vc, vw, false));
+  }
+
+  void ParmDBSnapshot::getValues (vector<ParmValueSet>& psets,
+                                  const vector<uint>& nameIds,
+                                  const vector<ParmId>& parmIds,
+                                  const Box& domain)
+  {
+    uint nname = itsFile.size<SnapshotFile::NameRecord>(SnapshotFile::NAMES);
+    const SnapshotFile::NameRecord* names =
+      itsFile.records<SnapshotFile::NameRecord>(SnapshotFile::NAMES);
+    vector<const SnapshotFile::ValueRecord*> records;
+    for (uint inx=0; inx<nameIds.size(); ++inx) {
+      ParmValueSet& pvset = psets[parmIds[inx]];
+      uint id = nameIds[inx];
+      ASSERTSTR (id < nname, "Invalid nameId " << id << " in ParmDBSnapshot "
+                 << itsFile.fileName());
+      const SnapshotFile::NameRecord& name = names[id];
+      ParmValue::FunkletType type = ParmValue::FunkletType(name.type);
+      findValues (records, name, domain);
+      if (! records.empty()) {
+        vector<ParmValue::ShPtr> values;
+        vector<Box> domains;
+        values.reserve (records.size());
+        domains.reserve (records.size());
+        for (uint i=0; i<records.size(); ++i) {
+          const SnapshotFile::ValueRecord& rec = *records[i];
+          ParmValue::ShPtr pval = ParmValue::ShPtr (new ParmValue);
+          if (type != ParmValue::Scalar) {
+            pval->setCoeff (itsFile.getArray(rec.values));
+          } else {
+            uint nx = rec.values.shape[0];
+            uint ny = rec.values.shape[1];
+            pval->setScalars (Grid(getInterval(rec.intervalsX,
+                                               rec.sx, rec.ex, nx),
+                                   getInterval(rec.intervalsY,
+                                               rec.sy, rec.ey, ny)),
+                              itsFile.getArray(rec.values));
+          }
+          if (rec.errors.ndim > 0) {
+            pval->setErrors (itsFile.getArray(rec.errors));
+          }
+          pval->setRowId (rec.rowId);
+          values.push_back (pval);
+          domains.push_back (Box(Point(rec.sx,rec.sy), Point(rec.ex,rec.ey)));
+        }
+        pvset = ParmValueSet (domains, values, ParmValue(),
+                              type, name.perturbation, name.pertRel);
+      } else {
+        // No matching values, so get default value.
+        // Use perturbation, etc. from the name record.
+        ParmValueSet pvdef = getDefValue (itsFile.getBytes(name.name),
+                                          ParmValue());
+        pvset = ParmValueSet (pvdef.getFirstParmValue(),
+                              type, name.perturbation, name.pertRel);
+      }
+      if (name.mask.ndim > 0) {
+        pvset.setSolvableMask (itsFile.getMask(name.mask));
+      }
+    }
+  }
+
+  ParmValueSet ParmDBSnapshot::makeDefValue
+  (const SnapshotFile::DefValueRecord& rec) const
+  {
+    ParmValue pval;
+    ParmValue::FunkletType type = ParmValue::FunkletType(rec.type);
+    Box scaleDomain;
+    if (type == ParmValue::Scalar) {
+      pval.setScalars (Grid(), itsFile.getArray(rec.values));
+    } else {
+      scaleDomain = Box(Point(rec.scaleDomain[0], rec.scaleDomain[2]),
+                        Point(rec.scaleDomain[1], rec.scaleDomain[3]));
+      pval.setCoeff (itsFile.getArray(rec.values));
+    }
+    ParmValueSet valset(pval, type, rec.perturbation, rec.pertRel,
+                        scaleDomain);
+    if (rec.mask.ndim > 0) {
+      valset.setSolvableMask (itsFile.getMask(rec.mask));
+    }
+    return valset;
+  }
+
+  void ParmDBSnapshot::fillDefMap (ParmMap& defMap)
+  {
+    defMap.clear();
+    getDefValues (defMap, "*");
+  }
+
+  void ParmDBSnapshot::getDefValues (ParmMap& result,
+                                     const string& parmNamePattern)
+  {
+    uint ndef = itsFile.size<SnapshotFile::DefValueRecord>
+      (SnapshotFile::DEF_VALUES);
+    const SnapshotFile::DefValueRecord* defs =
+      itsFile.records<SnapshotFile::DefValueRecord>(SnapshotFile::DEF_VALUES);
+    Regex regex(Regex::fromPattern(parmNamePattern));
+    for (uint i=0; i<ndef; ++i) {
+      String name(itsFile.getBytes(defs[i].name));
+      if (name.matches (regex)) {
+        result.define (name, makeDefValue(defs[i]));
+      }
+    }
+  }
+
+  void ParmDBSnapshot::putValues (const string&, int&, ParmValueSet&)
+  {
+    THROW (Exception, "ParmDBSnapshot is read-only");
+  }
+
+  void ParmDBSnapshot::putDefValue (const string&, const ParmValueSet&,
+                                    bool)
+  {
+    THROW (Exception, "ParmDBSnapshot is read-only");
+  }
+
+  void ParmDBSnapshot::deleteValues (const string&,
+                                     const Box&)
+  {
+    THROW (Exception, "ParmDBSnapshot is read-only");
+  }
+
+  void ParmDBSnapshot::deleteDefValues (const string&)
+  {
+    THROW (Exception, "ParmDBSnapshot is read-only");
+  }
+
+  vector<string> ParmDBSnapshot::getNames (const string& parmNamePattern)
+  {
+    const SnapshotFile::NameRecord* names =
+      itsFile.records<SnapshotFile::NameRecord>(SnapshotFile::NAMES);
+    vector<uint> nameIds = getNameIds (parmNamePattern);
+    vector<string> result;
+    result.reserve (nameIds.size());
+    for (uint i=0; i<nameIds.size(); ++i) {
+      result.push_back (itsFile.getBytes(names[nameIds[i]].name));
+    }
+    return result;
+  }
+
+} // namespace BBS
+} // namespace LOFAR
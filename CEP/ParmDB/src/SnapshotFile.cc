@@ -0,0 +1,594 @@
+//# SnapshotFile.cc: Read-only memory-mapped snapshot of a ParmDB or SourceDB
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <ParmDB/SnapshotFile.h>
+#include <ParmDB/ParmDB.h>
+#include <ParmDB/ParmMap.h>
+#include <ParmDB/SourceDB.h>
+#include <Blob/BlobOBufVector.h>
+#include <Blob/BlobOStream.h>
+#include <Common/LofarLogger.h>
+#include <Common/Mmap.h>
+#include <Common/SystemCallException.h>
+#include <Common/lofar_map.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace casa;
+
+namespace LOFAR {
+namespace BBS {
+
+  namespace {
+
+    const char   theMagic[8] = {'L','O','F','A','R','S','N','P'};
+    const uint32 theVersion  = 1;
+    const uint32 theByteOrder = 0x01020304;
+
+    // Number of parameters read at once when creating a snapshot.
+    const uint theBlockSize = 1024;
+
+    // Sort order of the patches (as used by SourceDB::getPatches).
+    struct PatchOrder
+    {
+      explicit PatchOrder (const vector<PatchInfo>& patches)
+        : itsPatches (patches)
+      {}
+      bool operator() (uint i, uint j) const
+      {
+        const PatchInfo& p1 = itsPatches[i];
+        const PatchInfo& p2 = itsPatches[j];
+        if (p1.getCategory() != p2.getCategory()) {
+          return p1.getCategory() < p2.getCategory();
+        }
+        if (p1.apparentBrightness() != p2.apparentBrightness()) {
+          return p1.apparentBrightness() > p2.apparentBrightness();
+        }
+        return p1.getName() < p2.getName();
+      }
+      const vector<PatchInfo>& itsPatches;
+    };
+
+    // Collect the sections of a snapshot file and write them.
+    class SnapshotWriter
+    {
+    public:
+      void addParmDB (ParmDB& parmDB);
+      void addSourceDB (SourceDB& sourceDB);
+      void write (const string& fileName, const vector<double>& defSteps);
+
+    private:
+      void addParm (const string& name, const ParmValueSet& pset);
+      void addDefValue (const string& name, const ParmValueSet& pset);
+      uint64 addString (const string& str);
+      uint64 addBytes (const vector<uchar>& data);
+      uint64 addIntervals (const Axis& axis);
+      SnapshotFile::ArrayRef addArray (const Array<double>& array);
+      SnapshotFile::ArrayRef addMask (const Array<bool>& mask);
+      static SnapshotFile::ArrayRef makeRef (uint64 offset,
+                                             const IPosition& shape);
+      static vector<uint32> makeIndex (const vector<string>& names);
+      static void writeSection (ofstream& file, SnapshotFile::Header& header,
+                                SnapshotFile::SectionId id,
+                                const void* data, uint64 size);
+      template<typename T>
+      static void writeSection (ofstream& file, SnapshotFile::Header& header,
+                                SnapshotFile::SectionId id,
+                                const vector<T>& records)
+        { writeSection (file, header, id,
+                        records.empty() ? 0 : &(records[0]),
+                        records.size() * sizeof(T)); }
+
+      vector<char>                         itsBytes;
+      vector<SnapshotFile::NameRecord>     itsNames;
+      vector<string>                       itsNameStrings;
+      vector<SnapshotFile::ValueRecord>    itsValues;
+      vector<double>                       itsMaxEnds;
+      vector<double>                       itsDoubles;
+      vector<SnapshotFile::DefValueRecord> itsDefValues;
+      vector<SnapshotFile::PatchRecord>    itsPatches;
+      vector<string>                       itsPatchStrings;
+      vector<uint32>                       itsMembers;
+      vector<SnapshotFile::SourceRecord>   itsSources;
+      vector<string>                       itsSourceStrings;
+    };
+
+    bool compareStart (const SnapshotFile::ValueRecord& v1,
+                       const SnapshotFile::ValueRecord& v2)
+    {
+      return v1.sx < v2.sx  ||  (v1.sx == v2.sx  &&  v1.sy < v2.sy);
+    }
+
+    void SnapshotWriter::addParmDB (ParmDB& parmDB)
+    {
+      vector<string> names = parmDB.getNames ("");
+      // Read the values in blocks of parameters to limit memory usage.
+      for (uint first=0; first<names.size(); first+=theBlockSize) {
+        uint n = std::min(theBlockSize, uint(names.size()) - first);
+        vector<uint> nameIds(n);
+        vector<ParmId> parmIds(n);
+        for (uint i=0; i<n; ++i) {
+          nameIds[i] = parmDB.getNameId (names[first+i]);
+          parmIds[i] = i;
+        }
+        vector<ParmValueSet> psets(n);
+        parmDB.getValues (psets, nameIds, parmIds, Box());
+        for (uint i=0; i<n; ++i) {
+          addParm (names[first+i], psets[i]);
+        }
+      }
+      ParmMap defValues;
+      parmDB.getDefValues (defValues, "*");
+      for (ParmMap::const_iterator iter=defValues.begin();
+           iter!=defValues.end(); ++iter) {
+        addDefValue (iter->first, iter->second);
+      }
+    }
+
+    void SnapshotWriter::addParm (const string& name, const ParmValueSet& pset)
+    {
+      SnapshotFile::NameRecord rec;
+      memset (&rec, 0, sizeof(rec));
+      rec.name         = addString (name);
+      rec.type         = pset.getType();
+      rec.pertRel      = pset.getPertRel();
+      rec.perturbation = pset.getPerturbation();
+      rec.mask         = addMask (pset.getSolvableMask());
+      rec.firstValue   = itsValues.size();
+      // Add the values actually stored in the ParmDB; a value set without
+      // row ids is the default value.
+      const Grid& grid = pset.getGrid();
+      for (uint i=0; i<pset.size(); ++i) {
+        const ParmValue& pval = pset.getParmValue(i);
+        if (pval.getRowId() < 0) {
+          continue;
+        }
+        Box domain = grid.getCell(i);
+        SnapshotFile::ValueRecord value;
+        memset (&value, 0, sizeof(value));
+        value.sx     = domain.lowerX();
+        value.ex     = domain.upperX();
+        value.sy     = domain.lowerY();
+        value.ey     = domain.upperY();
+        value.rowId  = pval.getRowId();
+        value.values = addArray (pval.getValues());
+        if (pval.hasErrors()) {
+          value.errors = addArray (pval.getErrors());
+        }
+        value.intervalsX = SnapshotFile::NONE;
+        value.intervalsY = SnapshotFile::NONE;
+        if (pset.getType() == ParmValue::Scalar) {
+          value.intervalsX = addIntervals (*pval.getGrid().getAxis(0));
+          value.intervalsY = addIntervals (*pval.getGrid().getAxis(1));
+        }
+        itsValues.push_back (value);
+      }
+      rec.nValues = itsValues.size() - rec.firstValue;
+      // Sort the records on start and determine the running maximum of the
+      // end, which forms the interval index on the first axis.
+      vector<SnapshotFile::ValueRecord>::iterator first =
+        itsValues.begin() + rec.firstValue;
+      stable_sort (first, itsValues.end(), compareStart);
+      if (rec.nValues > 0) {
+        rec.range[0] = first->sx;
+        rec.range[1] = first->ex;
+        rec.range[2] = first->sy;
+        rec.range[3] = first->ey;
+      }
+      double maxEnd = 0;
+      for (; first!=itsValues.end(); ++first) {
+        if (itsMaxEnds.size() == rec.firstValue  ||  first->ex > maxEnd) {
+          maxEnd = first->ex;
+        }
+        itsMaxEnds.push_back (maxEnd);
+        rec.range[0] = std::min(rec.range[0], first->sx);
+        rec.range[1] = std::max(rec.range[1], first->ex);
+        rec.range[2] = std::min(rec.range[2], first->sy);
+        rec.range[3] = std::max(rec.range[3], first->ey);
+      }
+      itsNames.push_back (rec);
+      itsNameStrings.push_back (name);
+    }
+
+    void SnapshotWriter::addDefValue (const string& name,
+                                      const ParmValueSet& pset)
+    {
+      SnapshotFile::DefValueRecord rec;
+      memset (&rec, 0, sizeof(rec));
+      rec.name           = addString (name);
+      rec.type           = pset.getType();
+      rec.pertRel        = pset.getPertRel();
+      rec.perturbation   = pset.getPerturbation();
+      rec.scaleDomain[0] = pset.getScaleDomain().lowerX();
+      rec.scaleDomain[1] = pset.getScaleDomain().upperX();
+      rec.scaleDomain[2] = pset.getScaleDomain().lowerY();
+      rec.scaleDomain[3] = pset.getScaleDomain().upperY();
+      rec.values         = addArray (pset.getFirstParmValue().getValues());
+      rec.mask           = addMask (pset.getSolvableMask());
+      itsDefValues.push_back (rec);
+    }
+
+    void SnapshotWriter::addSourceDB (SourceDB& sourceDB)
+    {
+      // Store the patches in the order used by getPatches.
+      vector<PatchInfo> patches = sourceDB.getPatchInfo (-1, "", -1, -1);
+      vector<uint> order(patches.size());
+      for (uint i=0; i<order.size(); ++i) {
+        order[i] = i;
+      }
+      stable_sort (order.begin(), order.end(), PatchOrder(patches));
+      for (uint i=0; i<order.size(); ++i) {
+        const PatchInfo& info = patches[order[i]];
+        SnapshotFile::PatchRecord rec;
+        memset (&rec, 0, sizeof(rec));
+        rec.name       = addString (info.getName());
+        rec.category   = info.getCategory();
+        rec.ra         = info.getRa();
+        rec.dec        = info.getDec();
+        rec.brightness = info.apparentBrightness();
+        itsPatches.push_back (rec);
+        itsPatchStrings.push_back (info.getName());
+      }
+      // Store the sources in their original order.
+      map<string,uint> patchIds;
+      for (uint i=0; i<itsPatchStrings.size(); ++i) {
+        patchIds.insert (make_pair(itsPatchStrings[i], i));
+      }
+      vector<vector<uint32> > members(itsPatches.size());
+      SourceData src;
+      sourceDB.rewind();
+      while (! sourceDB.atEnd()) {
+        sourceDB.getNextSource (src);
+        vector<uchar> data;
+        BlobOBufVector<uchar> buf(data);
+        BlobOStream bos(buf);
+        src.writeSource (bos);
+        data.resize (buf.size());
+        SnapshotFile::SourceRecord rec;
+        rec.name  = addString (src.getInfo().getName());
+        rec.patch = SnapshotFile::NONE;
+        rec.data  = addBytes (data);
+        rec.size  = data.size();
+        map<string,uint>::const_iterator patch =
+          patchIds.find (src.getPatchName());
+        if (patch != patchIds.end()) {
+          rec.patch = patch->second;
+        }
+        if (rec.patch != SnapshotFile::NONE) {
+          members[rec.patch].push_back (itsSources.size());
+        }
+        itsSources.push_back (rec);
+        itsSourceStrings.push_back (src.getInfo().getName());
+      }
+      for (uint i=0; i<itsPatches.size(); ++i) {
+        itsPatches[i].firstMember = itsMembers.size();
+        itsPatches[i].nMembers    = members[i].size();
+        itsMembers.insert (itsMembers.end(),
+                           members[i].begin(), members[i].end());
+      }
+    }
+
+    uint64 SnapshotWriter::addString (const string& str)
+    {
+      uint64 offset = itsBytes.size();
+      itsBytes.insert (itsBytes.end(), str.begin(), str.end());
+      itsBytes.push_back (0);
+      return offset;
+    }
+
+    uint64 SnapshotWriter::addBytes (const vector<uchar>& data)
+    {
+      // Keep blobs 8-byte aligned.
+      itsBytes.resize ((itsBytes.size() + 7) / 8 * 8);
+      uint64 offset = itsBytes.size();
+      itsBytes.insert (itsBytes.end(), data.begin(), data.end());
+      return offset;
+    }
+
+    uint64 SnapshotWriter::addIntervals (const Axis& axis)
+    {
+      // Only irregular axes need to store their intervals.
+      if (dynamic_cast<const RegularAxis*>(&axis)) {
+        return SnapshotFile::NONE;
+      }
+      uint64 offset = itsDoubles.size();
+      for (uint i=0; i<axis.size(); ++i) {
+        itsDoubles.push_back (axis.center(i));
+        itsDoubles.push_back (axis.width(i));
+      }
+      return offset;
+    }
+
+    SnapshotFile::ArrayRef SnapshotWriter::makeRef (uint64 offset,
+                                                    const IPosition& shape)
+    {
+      ASSERTSTR (shape.size() <= 2, "A snapshot can only hold arrays with "
+                 "at most 2 dimensions");
+      SnapshotFile::ArrayRef ref;
+      memset (&ref, 0, sizeof(ref));
+      ref.offset = offset;
+      ref.ndim   = shape.size();
+      for (uint i=0; i<shape.size(); ++i) {
+        ref.shape[i] = shape[i];
+      }
+      return ref;
+    }
+
+    SnapshotFile::ArrayRef SnapshotWriter::addArray (const Array<double>& array)
+    {
+      SnapshotFile::ArrayRef ref = makeRef (itsDoubles.size(), array.shape());
+      bool deleteIt;
+      const double* data = array.getStorage (deleteIt);
+      itsDoubles.insert (itsDoubles.end(), data, data + array.size());
+      array.freeStorage (data, deleteIt);
+      return ref;
+    }
+
+    SnapshotFile::ArrayRef SnapshotWriter::addMask (const Array<bool>& mask)
+    {
+      SnapshotFile::ArrayRef ref = makeRef (itsBytes.size(), mask.shape());
+      for (Array<bool>::const_iterator iter=mask.begin();
+           iter!=mask.end(); ++iter) {
+        itsBytes.push_back (*iter ? 1 : 0);
+      }
+      return ref;
+    }
+
+    vector<uint32> SnapshotWriter::makeIndex (const vector<string>& names)
+    {
+      ASSERT (names.size() < 0x7fffffff);
+      // Use a table that is at most half full, so lookups stay short.
+      uint32 size = 1;
+      while (size < 2 * names.size()) {
+        size *= 2;
+      }
+      vector<uint32> index(names.empty() ? 0 : size, 0);
+      uint32 mask = size - 1;
+      for (uint32 id=0; id<names.size(); ++id) {
+        uint32 i = SnapshotFile::hash (names[id].c_str(),
+                                       names[id].size()) & mask;
+        // Only the first of duplicate names is indexed.
+        while (index[i] != 0  &&  names[index[i] - 1] != names[id]) {
+          i = (i+1) & mask;
+        }
+        if (index[i] == 0) {
+          index[i] = id + 1;
+        }
+      }
+      return index;
+    }
+
+    void SnapshotWriter::writeSection (ofstream& file,
+                                       SnapshotFile::Header& header,
+                                       SnapshotFile::SectionId id,
+                                       const void* data, uint64 size)
+    {
+      // Start each section at an 8-byte boundary.
+      static const char padding[8] = {0,0,0,0,0,0,0,0};
+      uint64 offset = file.tellp();
+      file.write (padding, (8 - offset % 8) % 8);
+      header.sections[id].offset = file.tellp();
+      header.sections[id].size   = size;
+      if (size > 0) {
+        file.write (static_cast<const char*>(data), size);
+      }
+    }
+
+    void SnapshotWriter::write (const string& fileName,
+                                const vector<double>& defSteps)
+    {
+      SnapshotFile::Header header;
+      memset (&header, 0, sizeof(header));
+      memcpy (header.magic, theMagic, sizeof(theMagic));
+      header.version   = theVersion;
+      header.byteOrder = theByteOrder;
+      for (uint i=0; i<2 && i<defSteps.size(); ++i) {
+        header.defSteps[i] = defSteps[i];
+      }
+      ofstream file(fileName.c_str(), ios::out | ios::trunc | ios::binary);
+      ASSERTSTR (file, "Snapshot file " << fileName << " cannot be created");
+      // Write a preliminary header, which is rewritten at the end when all
+      // section offsets are known.
+      file.write (reinterpret_cast<const char*>(&header), sizeof(header));
+      writeSection (file, header, SnapshotFile::BYTES, itsBytes);
+      writeSection (file, header, SnapshotFile::NAMES, itsNames);
+      writeSection (file, header, SnapshotFile::NAME_INDEX,
+                    makeIndex(itsNameStrings));
+      writeSection (file, header, SnapshotFile::VALUES, itsValues);
+      writeSection (file, header, SnapshotFile::MAX_ENDS, itsMaxEnds);
+      writeSection (file, header, SnapshotFile::DOUBLES, itsDoubles);
+      writeSection (file, header, SnapshotFile::DEF_VALUES, itsDefValues);
+      writeSection (file, header, SnapshotFile::PATCHES, itsPatches);
+      writeSection (file, header, SnapshotFile::PATCH_INDEX,
+                    makeIndex(itsPatchStrings));
+      writeSection (file, header, SnapshotFile::PATCH_MEMBERS, itsMembers);
+      writeSection (file, header, SnapshotFile::SOURCES, itsSources);
+      writeSection (file, header, SnapshotFile::SOURCE_INDEX,
+                    makeIndex(itsSourceStrings));
+      file.seekp (0);
+      file.write (reinterpret_cast<const char*>(&header), sizeof(header));
+      file.close();
+      ASSERTSTR (file, "Error while writing snapshot file " << fileName);
+    }
+
+  } //# end unnamed namespace
+
+
+  const uint64 SnapshotFile::NONE;
+
+  SnapshotFile::SnapshotFile (const string& fileName)
+    : itsFileName (fileName),
+      itsData     (0),
+      itsHeader   (0)
+  {
+    int fd = ::open (fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+      THROW_SYSCALL ("open " + fileName);
+    }
+    struct stat st;
+    if (::fstat (fd, &st) < 0) {
+      int err = errno;
+      ::close (fd);
+      throw SystemCallException ("fstat " + fileName, err, THROW_ARGS);
+    }
+    uint64 fileSize = st.st_size;
+    if (fileSize < sizeof(Header)) {
+      ::close (fd);
+      THROW (Exception, fileName << " is not a snapshot file");
+    }
+    try {
+      itsMap.reset (new Mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0));
+    } catch (...) {
+      ::close (fd);
+      throw;
+    }
+    // The mapping stays valid after closing the file.
+    ::close (fd);
+    itsData   = static_cast<const char*>((*itsMap)());
+    itsHeader = reinterpret_cast<const Header*>(itsData);
+    ASSERTSTR (memcmp (itsHeader->magic, theMagic, sizeof(theMagic)) == 0,
+               fileName << " is not a snapshot file");
+    ASSERTSTR (itsHeader->version == theVersion,
+               "Snapshot file " << fileName << " has version "
+               << itsHeader->version << "; expected " << theVersion);
+    ASSERTSTR (itsHeader->byteOrder == theByteOrder,
+               "Snapshot file " << fileName
+               << " was written with another byte order");
+    for (uint i=0; i<N_SECTION; ++i) {
+      const Section& section = itsHeader->sections[i];
+      ASSERTSTR (section.offset % 8 == 0  &&  section.offset <= fileSize  &&
+                 section.size <= fileSize - section.offset,
+                 "Snapshot file " << fileName << " is corrupt");
+    }
+  }
+
+  SnapshotFile::~SnapshotFile()
+  {}
+
+  bool SnapshotFile::isSnapshot (const string& fileName)
+  {
+    ifstream file(fileName.c_str(), ios::in | ios::binary);
+    char magic[sizeof(theMagic)];
+    return file.read (magic, sizeof(magic))  &&
+      memcmp (magic, theMagic, sizeof(theMagic)) == 0;
+  }
+
+  void SnapshotFile::create (const string& fileName, ParmDB& parmDB,
+                             SourceDB* sourceDB)
+  {
+    SnapshotWriter writer;
+    writer.addParmDB (parmDB);
+    if (sourceDB) {
+      writer.addSourceDB (*sourceDB);
+    }
+    writer.write (fileName, parmDB.getDefaultSteps());
+  }
+
+  Array<double> SnapshotFile::getArray (const ArrayRef& ref) const
+  {
+    if (ref.ndim == 0) {
+      return Array<double>();
+    }
+    IPosition shape(ref.ndim);
+    for (uint i=0; i<ref.ndim; ++i) {
+      shape[i] = ref.shape[i];
+    }
+    return Array<double>(shape, getDoubles(ref.offset));
+  }
+
+  Array<bool> SnapshotFile::getMask (const ArrayRef& ref) const
+  {
+    if (ref.ndim == 0) {
+      return Array<bool>();
+    }
+    IPosition shape(ref.ndim);
+    for (uint i=0; i<ref.ndim; ++i) {
+      shape[i] = ref.shape[i];
+    }
+    Array<bool> mask(shape);
+    const char* data = getBytes(ref.offset);
+    bool* maskp = mask.data();
+    for (uint i=0; i<mask.size(); ++i) {
+      maskp[i] = data[i] != 0;
+    }
+    return mask;
+  }
+
+  int64 SnapshotFile::findName (const string& name) const
+  {
+    return find<NameRecord> (NAME_INDEX, NAMES, name);
+  }
+
+  int64 SnapshotFile::findPatch (const string& name) const
+  {
+    return find<PatchRecord> (PATCH_INDEX, PATCHES, name);
+  }
+
+  int64 SnapshotFile::findSource (const string& name) const
+  {
+    return find<SourceRecord> (SOURCE_INDEX, SOURCES, name);
+  }
+
+  template<typename T>
+  int64 SnapshotFile::find (SectionId index, SectionId section,
+                            const string& name) const
+  {
+    uint64 nslot = size<uint32>(index);
+    if (nslot == 0) {
+      return -1;
+    }
+    const uint32* slots = records<uint32>(index);
+    const T* recs = records<T>(section);
+    uint64 mask = nslot - 1;
+    // The index is at most half full, so an empty slot is always found.
+    for (uint64 i = hash(name.c_str(), name.size()) & mask;
+         slots[i] != 0;  i = (i+1) & mask) {
+      const char* str = getBytes (recs[slots[i] - 1].name);
+      if (strncmp (str, name.c_str(), name.size()) == 0  &&
+          str[name.size()] == 0) {
+        return slots[i] - 1;
+      }
+    }
+    return -1;
+  }
+
+  uint32 SnapshotFile::hash (const char* str, size_t length)
+  {
+    // 32-bit FNV-1a.
+    uint32 h = 2166136261u;
+    for (size_t i=0; i<length; ++i) {
+      h ^= uchar(str[i]);
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+} // namespace BBS
+} // namespace LOFAR
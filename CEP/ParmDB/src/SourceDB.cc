@@ -24,6 +24,7 @@
 #include <ParmDB/SourceDB.h>
 #include <ParmDB/SourceDBCasa.h>
 #include <ParmDB/SourceDBBlob.h>
+#include <ParmDB/SourceDBSnapshot.h>
 #include <ParmDB/ParmDB.h>
 #include <Common/LofarLogger.h>
 
@@ -54,7 +55,7 @@ namespace BBS {
   {
     ParmDBMeta pm(ptm);
     // Determine type if not given.
-    // Default is casa, but an existing regular file is blob.
+    // Default is casa, but an existing regular file is blob or snapshot.
     if (pm.getType().empty()) {
       pm = ParmDBMeta("casa", pm.getTableName());
       if (!forceNew) {
@@ -63,6 +64,9 @@ namespace BBS {
         File file(ptm.getTableName());
         if (file.exists()  &&  file.isRegular()) {
           pm = ParmDBMeta("blob", pm.getTableName());
+          if (SnapshotFile::isSnapshot (ptm.getTableName())) {
+            pm = ParmDBMeta("snapshot", pm.getTableName());
+          }
         }
       }
     }
@@ -70,6 +74,8 @@ namespace BBS {
       itsRep = new SourceDBCasa (pm, forceNew);
     } else if (pm.getType() == "blob") {
       itsRep = new SourceDBBlob (pm, forceNew);
+    } else if (pm.getType() == "snapshot") {
+      itsRep = new SourceDBSnapshot (pm, forceNew);
     } else {
       ASSERTSTR(false, "unknown sourceTableType: " << pm.getType());
     }
@@ -0,0 +1,301 @@
+//# SourceDBSnapshot.cc: Read-only SourceDB held in a memory-mapped snapshot file
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <ParmDB/SourceDBSnapshot.h>
+#include <Blob/BlobIBufChar.h>
+#include <Blob/BlobIStream.h>
+#include <Common/Exception.h>
+
+#include <casa/BasicSL/String.h>
+#include <casa/Utilities/Regex.h>
+#include <algorithm>
+
+using namespace casa;
+using namespace std;
+
+namespace LOFAR {
+namespace BBS {
+
+  SourceDBSnapshot::SourceDBSnapshot (const ParmDBMeta& pdm, bool forceNew)
+    : SourceDBRep (pdm, forceNew),
+      itsFile     (pdm.getTableName()),
+      itsNext     (0)
+  {}
+
+  SourceDBSnapshot::~SourceDBSnapshot()
+  {}
+
+  void SourceDBSnapshot::create (const string& fileName, SourceDB& sourceDB)
+  {
+    SnapshotFile::create (fileName, sourceDB.getParmDB(), &sourceDB);
+  }
+
+  void SourceDBSnapshot::clearTables()
+  {
+    THROW (Exception, "SourceDBSnapshot is read-only");
+  }
+
+  template<typename T>
+  vector<string> SourceDBSnapshot::findDuplicates
+  (SnapshotFile::SectionId section) const
+  {
+    uint64 nrec = itsFile.size<T>(section);
+    const T* recs = itsFile.records<T>(section);
+    vector<string> names;
+    names.reserve (nrec);
+    for (uint64 i=0; i<nrec; ++i) {
+      names.push_back (itsFile.getBytes(recs[i].name));
+    }
+    sort (names.begin(), names.end());
+    vector<string> result;
+    for (uint64 i=1; i<names.size(); ++i) {
+      if (names[i] == names[i-1]  &&
+          (result.empty()  ||  result.back() != names[i])) {
+        result.push_back (names[i]);
+      }
+    }
+    return result;
+  }
+
+  void SourceDBSnapshot::checkDuplicates()
+  {
+    vector<string> patches = findDuplicatePatches();
+    ASSERTSTR (patches.empty(), "The snapshot has " << patches.size()
+               << " duplicate patch names");
+    vector<string> sources = findDuplicateSources();
+    ASSERTSTR (sources.empty(), "The snapshot has " << sources.size()
+               << " duplicate source names");
+  }
+
+  vector<string> SourceDBSnapshot::findDuplicatePatches()
+  {
+    return findDuplicates<SnapshotFile::PatchRecord> (SnapshotFile::PATCHES);
+  }
+
+  vector<string> SourceDBSnapshot::findDuplicateSources()
+  {
+    return findDuplicates<SnapshotFile::SourceRecord> (SnapshotFile::SOURCES);
+  }
+
+  bool SourceDBSnapshot::patchExists (const string& patchName)
+  {
+    return itsFile.findPatch (patchName) >= 0;
+  }
+
+  bool SourceDBSnapshot::sourceExists (const string& sourceName)
+  {
+    return itsFile.findSource (sourceName) >= 0;
+  }
+
+  uint SourceDBSnapshot::addPatch (const string&, int, double, double, double,
+                                   bool)
+  {
+    THROW (Exception, "SourceDBSnapshot is read-only");
+  }
+
+  void SourceDBSnapshot::updatePatch (uint, double, double, double)
+  {
+    THROW (Exception, "SourceDBSnapshot is read-only");
+  }
+
+  void SourceDBSnapshot::addSource (const SourceInfo&, const string&,
+                                    const ParmMap&, double, double, bool)
+  {
+    THROW (Exception, "SourceDBSnapshot is read-only");
+  }
+
+  void SourceDBSnapshot::addSource (const SourceData&, bool)
+  {
+    THROW (Exception, "SourceDBSnapshot is read-only");
+  }
+
+  void SourceDBSnapshot::addSource (const SourceInfo&, const string&, int,
+                                    double, const ParmMap&, double, double,
+                                    bool)
+  {
+    THROW (Exception, "SourceDBSnapshot is read-only");
+  }
+
+  void SourceDBSnapshot::deleteSources (const string&)
+  {
+    THROW (Exception, "SourceDBSnapshot is read-only");
+  }
+
+  vector<uint> SourceDBSnapshot::selectPatches (int category,
+                                                const string& pattern,
+                                                double minBrightness,
+                                                double maxBrightness) const
+  {
+    uint npatch = itsFile.size<SnapshotFile::PatchRecord>
+      (SnapshotFile::PATCHES);
+    const SnapshotFile::PatchRecord* patches =
+      itsFile.records<SnapshotFile::PatchRecord>(SnapshotFile::PATCHES);
+    Regex regex;
+    if (pattern.size() > 0) {
+      regex = Regex::fromPattern(pattern);
+    }
+    // The patches are already in order of category, brightness, and name.
+    vector<uint> result;
+    for (uint i=0; i<npatch; ++i) {
+      const SnapshotFile::PatchRecord& patch = patches[i];
+      if ((category < 0       ||  patch.category == category)  &&
+          (minBrightness < 0  ||  patch.brightness >= minBrightness)  &&
+          (maxBrightness < 0  ||  patch.brightness <= maxBrightness)  &&
+          (pattern.size() == 0  ||
+           String(itsFile.getBytes(patch.name)).matches (regex))) {
+        result.push_back (i);
+      }
+    }
+    return result;
+  }
+
+  vector<string> SourceDBSnapshot::getPatches (int category,
+                                               const string& pattern,
+                                               double minBrightness,
+                                               double maxBrightness)
+  {
+    const SnapshotFile::PatchRecord* patches =
+      itsFile.records<SnapshotFile::PatchRecord>(SnapshotFile::PATCHES);
+    vector<uint> index = selectPatches (category, pattern, minBrightness,
+                                        maxBrightness);
+    vector<string> names;
+    names.reserve (index.size());
+    for (uint i=0; i<index.size(); ++i) {
+      names.push_back (itsFile.getBytes(patches[index[i]].name));
+    }
+    return names;
+  }
+
+  vector<PatchInfo> SourceDBSnapshot::getPatchInfo (int category,
+                                                    const string& pattern,
+                                                    double minBrightness,
+                                                    double maxBrightness)
+  {
+    const SnapshotFile::PatchRecord* patches =
+      itsFile.records<SnapshotFile::PatchRecord>(SnapshotFile::PATCHES);
+    vector<uint> index = selectPatches (category, pattern, minBrightness,
+                                        maxBrightness);
+    vector<PatchInfo> info;
+    info.reserve (index.size());
+    for (uint i=0; i<index.size(); ++i) {
+      const SnapshotFile::PatchRecord& patch = patches[index[i]];
+      info.push_back (PatchInfo(itsFile.getBytes(patch.name), patch.ra,
+                                patch.dec, patch.category, patch.brightness));
+    }
+    return info;
+  }
+
+  pair<const uint32*, const uint32*>
+  SourceDBSnapshot::getMembers (const string& patchName) const
+  {
+    int64 id = itsFile.findPatch (patchName);
+    if (id < 0) {
+      return make_pair((const uint32*)0, (const uint32*)0);
+    }
+    const SnapshotFile::PatchRecord& patch =
+      itsFile.records<SnapshotFile::PatchRecord>(SnapshotFile::PATCHES)[id];
+    const uint32* members =
+      itsFile.records<uint32>(SnapshotFile::PATCH_MEMBERS) + patch.firstMember;
+    return make_pair(members, members + patch.nMembers);
+  }
+
+  void SourceDBSnapshot::readSource (uint64 index, SourceData& src) const
+  {
+    const SnapshotFile::SourceRecord& rec =
+      itsFile.records<SnapshotFile::SourceRecord>(SnapshotFile::SOURCES)[index];
+    BlobIBufChar buf(itsFile.getBytes(rec.data), rec.size);
+    BlobIStream bis(buf);
+    src.readSource (bis);
+  }
+
+  vector<SourceInfo> SourceDBSnapshot::getPatchSources (const string& patchName)
+  {
+    pair<const uint32*, const uint32*> members = getMembers (patchName);
+    vector<SourceInfo> info;
+    info.reserve (members.second - members.first);
+    SourceData src;
+    for (const uint32* iter=members.first; iter!=members.second; ++iter) {
+      readSource (*iter, src);
+      info.push_back (src.getInfo());
+    }
+    return info;
+  }
+
+  vector<SourceData> SourceDBSnapshot::getPatchSourceData
+  (const string& patchName)
+  {
+    pair<const uint32*, const uint32*> members = getMembers (patchName);
+    vector<SourceData> result(members.second - members.first);
+    for (uint i=0; i<result.size(); ++i) {
+      readSource (members.first[i], result[i]);
+    }
+    return result;
+  }
+
+  SourceInfo SourceDBSnapshot::getSource (const string& sourceName)
+  {
+    int64 id = itsFile.findSource (sourceName);
+    ASSERTSTR (id >= 0, "Source name " << sourceName
+               << " not found in " << itsFile.fileName());
+    SourceData src;
+    readSource (id, src);
+    return src.getInfo();
+  }
+
+  vector<SourceInfo> SourceDBSnapshot::getSources (const string& pattern)
+  {
+    uint64 nsrc = itsFile.size<SnapshotFile::SourceRecord>
+      (SnapshotFile::SOURCES);
+    const SnapshotFile::SourceRecord* sources =
+      itsFile.records<SnapshotFile::SourceRecord>(SnapshotFile::SOURCES);
+    Regex regex(Regex::fromPattern(pattern));
+    vector<SourceInfo> info;
+    SourceData src;
+    for (uint64 i=0; i<nsrc; ++i) {
+      if (String(itsFile.getBytes(sources[i].name)).matches (regex)) {
+        readSource (i, src);
+        info.push_back (src.getInfo());
+      }
+    }
+    return info;
+  }
+
+  bool SourceDBSnapshot::atEnd()
+  {
+    return itsNext >= itsFile.size<SnapshotFile::SourceRecord>
+      (SnapshotFile::SOURCES);
+  }
+
+  void SourceDBSnapshot::rewind()
+  {
+    itsNext = 0;
+  }
+
+  void SourceDBSnapshot::getNextSource (SourceData& src)
+  {
+    ASSERTSTR (!atEnd(), "No more sources in " << itsFile.fileName());
+    readSource (itsNext++, src);
+  }
+
+} // namespace BBS
+} // namespace LOFAR
@@ -0,0 +1,94 @@
+//# makesnapshotdb.cc: Make a memory-mapped snapshot of a ParmDB or SourceDB
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+// This program makes a read-only snapshot of a ParmDB or SourceDB.
+// The snapshot is a single file that is memory-mapped when opened, which
+// makes looking up parameters and sources much faster than in the
+// original tables. It can be opened using type 'snapshot'; a SourceDB
+// snapshot is also recognized automatically.
+//
+// The program can be run as:
+//    makesnapshotdb in=inname out=outname type=sourcedb|parmdb
+// in            name of the input ParmDB or SourceDB.
+// out           name of the output snapshot file.
+// type          sourcedb = snapshot of the patches, sources, and parameters
+//               parmdb   = snapshot of the parameters only
+
+#include <lofar_config.h>
+#include <ParmDB/ParmDBSnapshot.h>
+#include <ParmDB/SourceDBSnapshot.h>
+#include <ParmDB/Package__Version.h>
+#include <Common/StringUtil.h>
+#include <Common/SystemUtil.h>
+#include <Common/Exception.h>
+
+#include <casa/Inputs/Input.h>
+
+using namespace std;
+using namespace casa;
+using namespace LOFAR;
+using namespace BBS;
+
+// Use a terminate handler that can produce a backtrace.
+Exception::TerminateHandler t(Exception::terminate);
+
+
+int main (int argc, char* argv[])
+{
+  TEST_SHOW_VERSION (argc, argv, ParmDB);
+  INIT_LOGGER(basename(string(argv[0])));
+  try {
+    // Define the input parameters.
+    Input inputs(1);
+    inputs.version ("2013-Oct-01");
+    inputs.create ("in", "",
+                   "Input ParmDB or SourceDB", "string");
+    inputs.create ("out", "",
+                   "Output snapshot file", "string");
+    inputs.create ("type", "sourcedb",
+                   "sourcedb=snapshot of a SourceDB, "
+                   "parmdb=snapshot of a ParmDB",
+                   "string");
+    // Read and check the input parameters.
+    inputs.readArguments(argc, argv);
+    string in = inputs.getString("in");
+    ASSERTSTR (!in.empty(), "no input name given");
+    string out = inputs.getString("out");
+    ASSERTSTR (!out.empty(), "no output snapshot name given");
+    string type = toLower(inputs.getString("type"));
+    ASSERTSTR (type=="sourcedb" || type=="parmdb", "incorrect type given");
+    if (type == "sourcedb") {
+      SourceDB sourceDB((ParmDBMeta(string(), in)));
+      SourceDBSnapshot::create (out, sourceDB);
+    } else {
+      ParmDB parmDB((ParmDBMeta("casa", in)));
+      ParmDBSnapshot::create (out, parmDB);
+    }
+  } catch (Exception& x) {
+    cerr << "Caught LOFAR exception: " << x << endl;
+    return 1;
+  } catch (AipsError& x) {
+    cerr << "Caught AIPS error: " << x.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,286 @@
+//# tParmDBSnapshot.cc: Test program for ParmDB and SourceDB snapshots
+//#
+//# Copyright (C) 2013
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <ParmDB/ParmDBSnapshot.h>
+#include <ParmDB/SourceDBSnapshot.h>
+#include <ParmDB/ParmMap.h>
+#include <Common/LofarLogger.h>
+#include <Common/Timer.h>
+#include <casa/Arrays/ArrayMath.h>
+#include <casa/Arrays/ArrayLogical.h>
+#include <iostream>
+
+using namespace LOFAR;
+using namespace LOFAR::BBS;
+using namespace casa;
+using namespace std;
+
+void checkEqual (const ParmValueSet& pset1, const ParmValueSet& pset2)
+{
+  ASSERT (pset1.size() == pset2.size());
+  ASSERT (pset1.getType() == pset2.getType());
+  ASSERT (pset1.getPerturbation() == pset2.getPerturbation());
+  ASSERT (pset1.getPertRel() == pset2.getPertRel());
+  ASSERT (pset1.getSolvableMask().shape().isEqual
+          (pset2.getSolvableMask().shape()));
+  ASSERT (allEQ (pset1.getSolvableMask(), pset2.getSolvableMask()));
+  ASSERT (pset1.getScaleDomain() == pset2.getScaleDomain());
+  for (uint i=0; i<pset1.size(); ++i) {
+    const ParmValue& pval1 = pset1.getParmValue(i);
+    const ParmValue& pval2 = pset2.getParmValue(i);
+    ASSERT (pval1.getRowId() == pval2.getRowId());
+    ASSERT (pset1.getGrid().getCell(i) == pset2.getGrid().getCell(i));
+    ASSERT (pval1.getValues().shape().isEqual (pval2.getValues().shape()));
+    ASSERT (allEQ (pval1.getValues(), pval2.getValues()));
+    ASSERT (pval1.getGrid() == pval2.getGrid());
+    ASSERT (pval1.hasErrors() == pval2.hasErrors());
+    if (pval1.hasErrors()) {
+      ASSERT (allEQ (pval1.getErrors(), pval2.getErrors()));
+    }
+  }
+  if (pset1.empty()) {
+    ASSERT (allEQ (pset1.getFirstParmValue().getValues(),
+                   pset2.getFirstParmValue().getValues()));
+  }
+}
+
+void createParmDB (ParmDB& pdb)
+{
+  // Put some default values.
+  Array<double> coeff(IPosition(2,2,3));
+  indgen(coeff, 1.);
+  pdb.putDefValue ("gain", ParmValueSet(ParmValue(1)));
+  ParmValue polc;
+  polc.setCoeff (coeff);
+  pdb.putDefValue ("polc", ParmValueSet(polc, ParmValue::Polc, 1e-5, false,
+                                        Box(Point(1,2), Point(3,5))));
+  // Put values on a regular grid of 10x20 domains for some parameters.
+  for (int p=0; p<20; ++p) {
+    ostringstream name;
+    name << "gain:" << p << ":" << (p%2 == 0 ? "real" : "imag");
+    vector<ParmValue::ShPtr> values;
+    vector<Box> domains;
+    for (int i=0; i<10; ++i) {
+      for (int j=0; j<20; ++j) {
+        ParmValue::ShPtr pval(new ParmValue);
+        if (p%3 == 0) {
+          pval->setCoeff (coeff + double(p+i+j));
+        } else {
+          pval->setScalar (p + 0.5*i + 0.25*j);
+        }
+        if (p%4 == 0) {
+          pval->setErrors (Array<double>(pval->getValues().shape(), 0.1*p));
+        }
+        values.push_back (pval);
+        domains.push_back (Box(Point(j*2,i*3), Point(j*2+2,i*3+3)));
+      }
+    }
+    ParmValueSet pset(Grid(domains), values, ParmValue(),
+                      (p%3 == 0 ? ParmValue::Polc : ParmValue::Scalar),
+                      1e-6*(p+1), p%2 == 0);
+    if (p%5 == 0) {
+      pset.setSolvableMask (Array<bool>(IPosition(2,2,3), true));
+    }
+    int nameId = -1;
+    pdb.putValues (name.str(), nameId, pset);
+  }
+  // A parameter with values for a single, overlapping domain.
+  {
+    vector<ParmValue::ShPtr> values(1, ParmValue::ShPtr(new ParmValue(3)));
+    ParmValueSet pset(Grid(vector<Box>(1, Box(Point(5,4), Point(31,17)))),
+                      values);
+    int nameId = -1;
+    pdb.putValues ("gain:20:real", nameId, pset);
+  }
+}
+
+void checkValues (ParmDB& pdb, ParmDB& snapshot, const Box& domain)
+{
+  vector<string> names = pdb.getNames ("*");
+  vector<uint> nameIds, snapshotIds;
+  vector<ParmId> parmIds;
+  for (uint i=0; i<names.size(); ++i) {
+    nameIds.push_back (pdb.getNameId (names[i]));
+    snapshotIds.push_back (snapshot.getNameId (names[i]));
+    parmIds.push_back (i);
+  }
+  vector<ParmValueSet> values(names.size());
+  vector<ParmValueSet> snapshotValues(names.size());
+  pdb.getValues (values, nameIds, parmIds, domain);
+  snapshot.getValues (snapshotValues, snapshotIds, parmIds, domain);
+  for (uint i=0; i<names.size(); ++i) {
+    checkEqual (values[i], snapshotValues[i]);
+  }
+}
+
+void testParmDB()
+{
+  ParmDB pdb(ParmDBMeta("casa", "tParmDBSnapshot_tmp.tab"), true);
+  createParmDB (pdb);
+  vector<double> steps(2);
+  steps[0] = 2000;
+  steps[1] = 10;
+  pdb.setDefaultSteps (steps);
+  ParmDBSnapshot::create ("tParmDBSnapshot_tmp.snp", pdb);
+  ParmDB snapshot(ParmDBMeta("snapshot", "tParmDBSnapshot_tmp.snp"));
+  // Check the names, ids, and ranges.
+  ASSERT (snapshot.getDefaultSteps() == pdb.getDefaultSteps());
+  ASSERT (snapshot.getNames("*") == pdb.getNames("*"));
+  ASSERT (snapshot.getNames("gain:1*") == pdb.getNames("gain:1*"));
+  ASSERT (snapshot.getNameId("gain:3:imag") >= 0);
+  ASSERT (snapshot.getNameId("gain:3:real") == -1);
+  ASSERT (snapshot.getRange("") == pdb.getRange(""));
+  ASSERT (snapshot.getRange("gain:20:*") == pdb.getRange("gain:20:*"));
+  ASSERT (snapshot.getRange(vector<string>(1, "gain:2:real")) ==
+          pdb.getRange(vector<string>(1, "gain:2:real")));
+  // Check the values for various domains.
+  checkValues (pdb, snapshot, Box());
+  checkValues (pdb, snapshot, Box(Point(3,4), Point(9,10)));
+  checkValues (pdb, snapshot, Box(Point(4,0), Point(6,30)));
+  checkValues (pdb, snapshot, Box(Point(0,4.5), Point(40,4.6)));
+  checkValues (pdb, snapshot, Box(Point(30.5,0), Point(100,100)));
+  checkValues (pdb, snapshot, Box(Point(100,100), Point(200,200)));
+  // Check the default values.
+  ParmMap defs, snapshotDefs;
+  pdb.getDefValues (defs, "*");
+  snapshot.getDefValues (snapshotDefs, "*");
+  ASSERT (defs.size() == snapshotDefs.size());
+  for (ParmMap::const_iterator iter=defs.begin(); iter!=defs.end(); ++iter) {
+    checkEqual (iter->second, snapshotDefs.find(iter->first)->second);
+  }
+  // The snapshot is read-only.
+  bool ok = false;
+  try {
+    snapshot.deleteValues ("*", Box());
+  } catch (std::exception& x) {
+    cout << "Expected exception: " << x.what() << endl;
+    ok = true;
+  }
+  ASSERT (ok);
+  // Compare the time to look up all values per domain.
+  NSTimer casaTimer, snapshotTimer;
+  for (int i=0; i<10; ++i) {
+    for (int j=0; j<20; ++j) {
+      Box domain(Point(j*2+0.5,i*3+0.5), Point(j*2+1.5,i*3+1.5));
+      casaTimer.start();
+      ParmMap result;
+      pdb.getValues (result, "*", domain);
+      casaTimer.stop();
+      snapshotTimer.start();
+      ParmMap snapshotResult;
+      snapshot.getValues (snapshotResult, "*", domain);
+      snapshotTimer.stop();
+      ASSERT (result.size() == snapshotResult.size());
+    }
+  }
+  cout << "casa: " << casaTimer.getElapsed() << " s snapshot: "
+       << snapshotTimer.getElapsed() << " s" << endl;
+}
+
+void testSourceDB()
+{
+  {
+    SourceDB sdb(ParmDBMeta("casa", "tParmDBSnapshot_tmp.src"), true);
+    ParmMap defValues;
+    defValues.define ("I", ParmValueSet(ParmValue(2)));
+    defValues.define ("Q", ParmValueSet(ParmValue(0.1)));
+    defValues.define ("SpectralIndex:0", ParmValueSet(ParmValue(-0.7)));
+    for (int i=0; i<50; ++i) {
+      ostringstream patch;
+      patch << "patch" << i;
+      sdb.addPatch (patch.str(), i%3, 50.-i%7, 0.01*i, -0.01*i);
+      for (int j=0; j<3; ++j) {
+        ostringstream src;
+        src << "src" << i << "_" << j;
+        sdb.addSource (SourceInfo(src.str(), SourceInfo::POINT), patch.str(),
+                       defValues, 0.01*i+0.001*j, -0.01*i);
+      }
+    }
+  }
+  SourceDB sdb(ParmDBMeta("casa", "tParmDBSnapshot_tmp.src"));
+  SourceDBSnapshot::create ("tParmDBSnapshot_tmp.srcsnp", sdb);
+  // The type should be detected automatically.
+  SourceDB snapshot(ParmDBMeta("", "tParmDBSnapshot_tmp.srcsnp"));
+  snapshot.checkDuplicates();
+  ASSERT (snapshot.getPatches() == sdb.getPatches());
+  ASSERT (snapshot.getPatches(1) == sdb.getPatches(1));
+  ASSERT (snapshot.getPatches(-1, "patch1*", 45, 48) ==
+          sdb.getPatches(-1, "patch1*", 45, 48));
+  ASSERT (snapshot.patchExists ("patch3"));
+  ASSERT (!snapshot.patchExists ("patch50"));
+  ASSERT (snapshot.sourceExists ("src3_1"));
+  ASSERT (!snapshot.sourceExists ("src3_3"));
+  ASSERT (snapshot.getSource("src7_2").getName() == "src7_2");
+  ASSERT (snapshot.getSources("src1*").size() == sdb.getSources("src1*").size());
+  vector<PatchInfo> patches = sdb.getPatchInfo();
+  vector<PatchInfo> snapshotPatches = snapshot.getPatchInfo();
+  ASSERT (patches.size() == snapshotPatches.size());
+  for (uint i=0; i<patches.size(); ++i) {
+    ASSERT (patches[i].getName() == snapshotPatches[i].getName());
+    ASSERT (patches[i].getRa() == snapshotPatches[i].getRa());
+    ASSERT (patches[i].getDec() == snapshotPatches[i].getDec());
+    vector<SourceData> src = sdb.getPatchSourceData (patches[i].getName());
+    vector<SourceData> snapshotSrc =
+      snapshot.getPatchSourceData (patches[i].getName());
+    ASSERT (src.size() == snapshotSrc.size());
+    for (uint j=0; j<src.size(); ++j) {
+      ASSERT (src[j].getInfo().getName() == snapshotSrc[j].getInfo().getName());
+      ASSERT (src[j].getRa() == snapshotSrc[j].getRa());
+      ASSERT (src[j].getDec() == snapshotSrc[j].getDec());
+      ASSERT (src[j].getI() == snapshotSrc[j].getI());
+      ASSERT (src[j].getQ() == snapshotSrc[j].getQ());
+    }
+  }
+  // Iterate over all sources.
+  SourceData src, snapshotSrc;
+  uint nsrc = 0;
+  sdb.rewind();
+  snapshot.rewind();
+  while (!sdb.atEnd()) {
+    ASSERT (!snapshot.atEnd());
+    sdb.getNextSource (src);
+    snapshot.getNextSource (snapshotSrc);
+    ASSERT (src.getInfo().getName() == snapshotSrc.getInfo().getName());
+    ASSERT (src.getPatchName() == snapshotSrc.getPatchName());
+    ++nsrc;
+  }
+  ASSERT (snapshot.atEnd());
+  ASSERT (nsrc == 150);
+  // The default values of the sources are in the ParmDB part.
+  ParmMap defs;
+  snapshot.getParmDB().getDefValues (defs, "I:src4_*");
+  ASSERT (defs.size() == 3);
+}
+
+int main()
+{
+  try {
+    INIT_LOGGER("tParmDBSnapshot");
+    testParmDB();
+    testSourceDB();
+  } catch (std::exception& x) {
+    cout << "Unexpected exception: " << x.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -76,6 +76,7 @@ if(NOT DEFINED LOFAR_PACKAGE_LIST_INCLUDED)
   set(Transport_SOURCE_DIR ${CMAKE_SOURCE_DIR}/LCS/Transport)
   set(MSLofar_SOURCE_DIR ${CMAKE_SOURCE_DIR}/LCS/MSLofar)
   set(LofarStMan_SOURCE_DIR ${CMAKE_SOURCE_DIR}/LCS/LofarStMan)
+  set(CompressStMan_SOURCE_DIR ${CMAKE_SOURCE_DIR}/LCS/CompressStMan)
   set(PyCommon_SOURCE_DIR ${CMAKE_SOURCE_DIR}/LCS/PyCommon)
   set(ObservationStartListener_SOURCE_DIR ${CMAKE_SOURCE_DIR}/LCS/MessageDaemons/ObservationStartListener)
   set(PyMessaging_SOURCE_DIR ${CMAKE_SOURCE_DIR}/LCS/Messaging/python/messaging)
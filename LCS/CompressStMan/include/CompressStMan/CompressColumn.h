@@ -0,0 +1,187 @@
+//# CompressColumn.h: A Column in the compressing Storage Manager
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_COMPRESSSTMAN_COMPRESSCOLUMN_H
+#define LOFAR_COMPRESSSTMAN_COMPRESSCOLUMN_H
+
+
+//# Includes
+#include <CompressStMan/CompressStMan.h>
+#include <Common/lofar_vector.h>
+#if defined(casacore)
+#include <tables/DataMan/StManColumn.h>
+#else
+#include <tables/Tables/StManColumn.h>
+#endif
+#include <casa/Arrays/IPosition.h>
+
+namespace LOFAR {
+
+// <summary>
+// A column in the compressing Storage Manager.
+// </summary>
+
+// <use visibility=local>
+
+// <reviewed reviewer="UNKNOWN" date="before2004/08/25" tests="tCompressStMan.cc">
+// </reviewed>
+
+// <prerequisite>
+//# Classes you should understand before using this one.
+//   <li> <linkto class=CompressStMan>CompressStMan</linkto>
+// </prerequisite>
+
+// <synopsis>
+// For each data type a specific Column class exists.
+// Each column stores a cell of fixed size at its offset in a row of the
+// data file. The size is rounded up to a multiple of 8 bytes, so the
+// scale factors and quantized values are aligned in the bucket.
+// </synopsis>
+
+class CompressColumn : public casa::StManColumn
+{
+public:
+  explicit CompressColumn (CompressStMan* parent, const casa::String& name,
+                           int dtype)
+    : StManColumn (dtype),
+      itsParent   (parent),
+      itsName     (name),
+      itsOffset   (0)
+  {}
+  virtual ~CompressColumn();
+  // All columns are writable.
+  virtual casa::Bool isWritable() const;
+  // Set the shape of the fixed shape column.
+  virtual void setShapeColumn (const casa::IPosition& shape);
+  // Get the shape of a cell, which is the same for all rows.
+  virtual casa::IPosition shape (casa::uInt rownr);
+  // Get the name of the column.
+  const casa::String& name() const
+    { return itsName; }
+  // Get the shape of the column.
+  const casa::IPosition& shapeColumn() const
+    { return itsShape; }
+  // Get the nr of bytes of a cell in the data file.
+  virtual casa::uInt cellSize() const = 0;
+  // Set the offset of the cell in a row.
+  void setOffset (casa::uInt offset)
+    { itsOffset = offset; }
+protected:
+  CompressStMan*  itsParent;
+  casa::String    itsName;
+  casa::IPosition itsShape;
+  casa::uInt      itsOffset;
+};
+
+// <summary>Column of quantized floating point values.</summary>
+// <use visibility=local>
+// <synopsis>
+// A cell is stored as a scale factor per value on the first axis, followed
+// by the values quantized to 8 or 16 bit signed integers. The largest
+// negative integer represents NaN. If 32 bits are used, the values are
+// stored as is.
+// </synopsis>
+class QuantizedColumn : public CompressColumn
+{
+public:
+  // Create the column. A complex value consists of <src>nfloat</src>=2
+  // floats sharing the same scale factor.
+  explicit QuantizedColumn (CompressStMan* parent, const casa::String& name,
+                            int dtype, casa::uInt nbits, casa::uInt nfloat)
+    : CompressColumn (parent, name, dtype),
+      itsNBits       (nbits),
+      itsNFloat      (nfloat)
+  {}
+  virtual ~QuantizedColumn();
+  virtual casa::uInt cellSize() const;
+protected:
+  // Compress the floats of a cell and store them in the row.
+  void putFloats (casa::uInt rownr, const float* data);
+  // Get the floats of a cell from the row and decompress them.
+  void getFloats (casa::uInt rownr, float* data);
+private:
+  // Get the nr of scale factors and of floats in a cell.
+  // <group>
+  casa::uInt nscale() const
+    { return itsShape.empty() ? 0 : itsShape[0]; }
+  casa::uInt nfloat() const
+    { return itsShape.product() * itsNFloat; }
+  // </group>
+
+  casa::uInt    itsNBits;
+  casa::uInt    itsNFloat;
+  vector<float> itsFactors;
+  vector<char>  itsSwapBuf;
+};
+
+// <summary>Complex column in the compressing Storage Manager.</summary>
+// <use visibility=local>
+class ComplexColumn : public QuantizedColumn
+{
+public:
+  explicit ComplexColumn (CompressStMan* parent, const casa::String& name,
+                          int dtype)
+    : QuantizedColumn (parent, name, dtype, parent->dataBits(), 2) {}
+  virtual ~ComplexColumn();
+  virtual void getArrayComplexV (casa::uInt rowNr,
+                                 casa::Array<casa::Complex>* dataPtr);
+  virtual void putArrayComplexV (casa::uInt rowNr,
+                                 const casa::Array<casa::Complex>* dataPtr);
+};
+
+// <summary>Float column in the compressing Storage Manager.</summary>
+// <use visibility=local>
+class FloatColumn : public QuantizedColumn
+{
+public:
+  explicit FloatColumn (CompressStMan* parent, const casa::String& name,
+                        int dtype)
+    : QuantizedColumn (parent, name, dtype, parent->weightBits(), 1) {}
+  virtual ~FloatColumn();
+  virtual void getArrayfloatV (casa::uInt rowNr,
+                               casa::Array<casa::Float>* dataPtr);
+  virtual void putArrayfloatV (casa::uInt rowNr,
+                               const casa::Array<casa::Float>* dataPtr);
+};
+
+// <summary>Bool column in the compressing Storage Manager.</summary>
+// <use visibility=local>
+// <synopsis>
+// The flags are stored as bits (lossless).
+// </synopsis>
+class BoolColumn : public CompressColumn
+{
+public:
+  explicit BoolColumn (CompressStMan* parent, const casa::String& name,
+                       int dtype)
+    : CompressColumn (parent, name, dtype) {}
+  virtual ~BoolColumn();
+  virtual casa::uInt cellSize() const;
+  virtual void getArrayBoolV (casa::uInt rowNr,
+                              casa::Array<casa::Bool>* dataPtr);
+  virtual void putArrayBoolV (casa::uInt rowNr,
+                              const casa::Array<casa::Bool>* dataPtr);
+};
+
+
+} //# end namespace
+
+#endif
@@ -0,0 +1,321 @@
+//# CompressStMan.h: Storage Manager storing visibilities in compressed form
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_COMPRESSSTMAN_COMPRESSSTMAN_H
+#define LOFAR_COMPRESSSTMAN_COMPRESSSTMAN_H
+
+//# Includes
+#include <tables/Tables/DataManager.h>
+#include <casa/IO/LargeFiledesIO.h>
+#include <casa/Containers/Block.h>
+#include <casa/Containers/Record.h>
+#include <Common/LofarTypes.h>
+#include <Common/lofar_vector.h>
+
+
+namespace LOFAR {
+
+//# Forward Declarations.
+class CompressColumn;
+
+// <summary>
+// Storage Manager storing visibility data, weights and flags compressed
+// </summary>
+
+// <use visibility=export>
+
+// <reviewed reviewer="UNKNOWN" date="before2004/08/25" tests="tCompressStMan.cc">
+// </reviewed>
+
+// <prerequisite>
+//# Classes you should understand before using this one.
+//   <li> The Table Data Managers concept as described in module file
+//        <linkto module="Tables:Data Managers">Tables.h</linkto>
+// </prerequisite>
+
+// <etymology>
+// CompressStMan is the data manager which stores the data in compressed form.
+// </etymology>
+
+// <synopsis>
+// CompressStMan is a storage manager for the bulky columns of a
+// MeasurementSet (DATA, WEIGHT_SPECTRUM and FLAG). It can hold fixed shaped
+// array columns of type Complex, Float and Bool.
+// <ul>
+//  <li> Complex values (visibilities) are quantized to signed integers
+//       of <src>dataBits</src> bits (8 or 16). Each cell has a scale
+//       factor per correlation (i.e. per value on the first axis), being
+//       the maximum absolute value of the real and imaginary parts.
+//       In this way the cross-correlations keep their precision next to
+//       the much larger auto-correlations. The absolute error of a value is
+//       at most scale / (2 * (2^(nbits-1) - 1)).
+//  <li> Float values (weights) are quantized in the same way using
+//       <src>weightBits</src> bits.
+//  <li> Bool values (flags) are stored losslessly as bits.
+// </ul>
+// Using 32 bits stores the Complex or Float values as is (bit-exact).
+// A NaN or infinite value is stored as NaN.
+//
+// Because of the fixed quantization each row has the same size on disk.
+// This makes random access and in-place updates possible without an index.
+// The rows are stored consecutively in the file <src>table.fNdata</src>.
+// The meta data (column shapes, quantization) are stored in the file
+// <src>table.fNmeta</src>. The rows are read and written in buckets of about
+// 1 MB, which are decompressed cell by cell on access.
+//
+// Like all storage managers it can be bound to columns in a SetupNewTable
+// or used in Table::addColumn. It is used by DPPP if
+// <src>msout.storagemanager=compress</src> is given.
+// </synopsis>
+
+// <motivation>
+// The visibility data and weights dominate the size of a MeasurementSet.
+// Their full float precision is much more than the noise level warrants.
+// </motivation>
+
+// <example>
+// The following example shows how to create a table and how to attach
+// the storage manager to some columns.
+// <srcblock>
+//   SetupNewTable newtab("name.data", tableDesc, Table::New);
+//   CompressStMan stman("CompressData", 16, 12);
+//   newtab.bindColumn ("DATA", stman);    // bind column to st.man.
+//   newtab.bindColumn ("FLAG", stman);    // bind column to st.man.
+//   Table tab(newtab);                    // actually create table
+// </srcblock>
+// </example>
+
+//# <todo asof="$DATE:$">
+//# A List of bugs, limitations, extensions or planned refinements.
+//# </todo>
+
+
+class CompressStMan : public casa::DataManager
+{
+public:
+  // Create a compressing storage manager with the given name and the
+  // nr of bits used for Complex (data) and Float (weight) columns.
+  // If no name is used, it is set to "CompressStMan"
+  explicit CompressStMan (const casa::String& dataManagerName = "CompressStMan",
+                          uint dataBits = 16, uint weightBits = 16);
+
+  // Create a compressing storage manager with the given name.
+  // The specifications are part of the record (as created by dataManagerSpec).
+  CompressStMan (const casa::String& dataManagerName, const casa::Record& spec);
+
+  ~CompressStMan();
+
+  // Clone this object.
+  virtual casa::DataManager* clone() const;
+
+  // Get the type name of the data manager (i.e. CompressStMan).
+  virtual casa::String dataManagerType() const;
+
+  // Get the name given to the storage manager (in the constructor).
+  virtual casa::String dataManagerName() const;
+
+  // Record a record containing data manager specifications.
+  virtual casa::Record dataManagerSpec() const;
+
+  // Get the number of rows in this storage manager.
+  uint getNRow() const
+    { return itsNrRows; }
+
+  // The storage manager can add rows.
+  virtual casa::Bool canAddRow() const;
+
+  // The storage manager can only delete the last rows.
+  virtual casa::Bool canRemoveRow() const;
+
+  // The storage manager cannot add columns, because it would change the
+  // layout of the rows.
+  virtual casa::Bool canAddColumn() const;
+
+  // Columns can be removed, but it does not do anything at all.
+  virtual casa::Bool canRemoveColumn() const;
+
+  // Make the object from the type name string.
+  // This function gets registered in the DataManager "constructor" map.
+  // The caller has to delete the object.
+  static casa::DataManager* makeObject (const casa::String& aDataManType,
+                                        const casa::Record& spec);
+
+  // Register the class name and the static makeObject "constructor".
+  // This will make the engine known to the table system.
+  static void registerClass();
+
+  // Get the nr of bits used for Complex and Float columns.
+  // <group>
+  uint dataBits() const
+    { return itsDataBits; }
+  uint weightBits() const
+    { return itsWeightBits; }
+  // </group>
+
+  // Tell if the data in the file have to be byte-swapped.
+  bool doSwap() const
+    { return itsDoSwap; }
+
+  // Get a pointer to the data of a row in the bucket.
+  // The write pointer marks the bucket as changed.
+  // <group>
+  const char* getReadPointer (casa::uInt rownr, casa::uInt offset)
+    { return getRow(rownr) + offset; }
+  char* getWritePointer (casa::uInt rownr, casa::uInt offset)
+  {
+    char* ptr = getRow(rownr) + offset;
+    itsDirty = true;
+    return ptr;
+  }
+  // </group>
+
+private:
+  // Copy constructor cannot be used.
+  CompressStMan (const CompressStMan& that);
+
+  // Assignment cannot be used.
+  CompressStMan& operator= (const CompressStMan& that);
+
+  // Flush and optionally fsync the data.
+  // The meta data are written in their own file, so it returns False.
+  virtual casa::Bool flush (casa::AipsIO&, casa::Bool doFsync);
+
+  // Let the storage manager create files as needed for a new table.
+  virtual void create (casa::uInt nrrow);
+
+  // Open the storage manager file for an existing table.
+  // Return the number of rows in the data file.
+  // <group>
+  virtual void open (casa::uInt nrrow, casa::AipsIO&); //# should never be called
+  virtual casa::uInt open1 (casa::uInt nrrow, casa::AipsIO&);
+  // </group>
+
+  // Resync the storage manager with the new file contents.
+  // <group>
+  virtual void resync (casa::uInt nrrow);   //# should never be called
+  virtual casa::uInt resync1 (casa::uInt nrrow);
+  // </group>
+
+  // Reopen the storage manager files for read/write.
+  virtual void reopenRW();
+
+  // The data manager will be deleted (because all its columns are
+  // requested to be deleted).
+  // So clean up the things needed (e.g. delete files).
+  virtual void deleteManager();
+
+  // Add rows to the storage manager.
+  // The file is extended with zeroes, which read back as zero values.
+  virtual void addRow (casa::uInt nrrow);
+
+  // Delete a row from all columns.
+  // Only the last row can be deleted.
+  virtual void removeRow (casa::uInt rowNr);
+
+  // Do the final addition of a column.
+  // It can only be done if the table is still empty.
+  virtual void addColumn (casa::DataManagerColumn*);
+
+  // Remove a column from the data file.
+  // It won't do anything.
+  virtual void removeColumn (casa::DataManagerColumn*);
+
+  // Create a column in the storage manager on behalf of a table column.
+  // Only fixed shaped arrays of type Complex, Float and Bool can be handled.
+  // The caller has to delete the newly created object.
+  // <group>
+  // Create a scalar column.
+  virtual casa::DataManagerColumn* makeScalarColumn (const casa::String& aName,
+                                               int aDataType,
+                                               const casa::String& aDataTypeID);
+  // Create a direct array column.
+  virtual casa::DataManagerColumn* makeDirArrColumn (const casa::String& aName,
+                                               int aDataType,
+                                               const casa::String& aDataTypeID);
+  // Create an indirect array column.
+  virtual casa::DataManagerColumn* makeIndArrColumn (const casa::String& aName,
+                                               int aDataType,
+                                               const casa::String& aDataTypeID);
+  // </group>
+
+  // Check if the nr of bits is valid.
+  static void checkBits (uint nbits);
+
+  // Determine the offsets of the columns in a row and the bucket size.
+  void setLayout();
+
+  // Write or read the meta file.
+  // <group>
+  void writeMeta();
+  void readMeta();
+  // </group>
+
+  // Open the data file.
+  void openFile (bool writable);
+
+  // Write the bucket if changed and close the data file.
+  void closeFile();
+
+  // Get a pointer to a row in the bucket, reading the bucket if needed.
+  char* getRow (casa::uInt rownr)
+  {
+    if (int64(rownr) < itsBucketStart  ||
+        int64(rownr) >= itsBucketStart + itsBucketNRow) {
+      readBucket (rownr);
+    }
+    return itsBucket.storage() + (rownr - itsBucketStart) * itsRowSize;
+  }
+
+  // Read the bucket containing the given row after writing the current one.
+  void readBucket (casa::uInt rownr);
+
+  // Write the bucket if it has been changed.
+  void writeBucket();
+
+
+  //# Declare member variables.
+  // Name of data manager.
+  casa::String itsDataManName;
+  // The number of rows in the columns.
+  uint         itsNrRows;
+  // The nr of bits for Complex and Float columns.
+  uint         itsDataBits;
+  uint         itsWeightBits;
+  // The column objects.
+  vector<CompressColumn*> itsColumns;
+  // The data file.
+  int    itsFD;
+  casa::LargeFiledesIO* itsFile;
+  bool   itsDoSwap;         //# True = byte-swapping is needed
+  bool   itsMetaChanged;    //# True = meta file has to be written
+  int64  itsRowSize;        //# nr of bytes in a row
+  // The bucket holding a block of consecutive rows.
+  casa::Block<char> itsBucket;
+  int64  itsRowsPerBucket;
+  int64  itsBucketStart;    //# first row in bucket (-1 = none)
+  int64  itsBucketNRow;     //# nr of rows in bucket
+  bool   itsDirty;          //# True = bucket has been changed
+};
+
+
+} //# end namespace
+
+#endif
@@ -0,0 +1,270 @@
+//# CompressColumn.cc: A Column in the compressing Storage Manager
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <CompressStMan/CompressColumn.h>
+
+#include <tables/Tables/DataManError.h>
+#include <casa/Arrays/Array.h>
+#include <casa/BasicMath/Math.h>
+#include <casa/OS/CanonicalConversion.h>
+#include <casa/OS/Conversion.h>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstring>
+
+using namespace casa;
+
+
+namespace LOFAR {
+
+  namespace {
+
+    // Quantize the floats. The floats are divided in groups as:
+    //   nfloat floats of group 0, nfloat floats of group 1, ...,
+    //   nfloat floats of group ngroup-1, nfloat floats of group 0, ...
+    // The scale of a group is its maximum absolute finite value, which is
+    // mapped to the maximum integer. Non-finite values map to the minimum
+    // integer.
+    template<typename T>
+    void quantize (const float* data, uInt nval, uInt nfloat, uInt ngroup,
+                   float* scales, vector<float>& factors, T* out)
+    {
+      const long maxq = std::numeric_limits<T>::max();
+      const T    nanq = std::numeric_limits<T>::min();
+      const uInt step = nfloat * ngroup;
+      for (uInt g=0; g<ngroup; ++g) {
+        float maxv = 0;
+        for (uInt i=g*nfloat; i<nval; i+=step) {
+          for (uInt f=0; f<nfloat; ++f) {
+            float v = std::abs(data[i+f]);
+            if (v > maxv  &&  isFinite(v)) {
+              maxv = v;
+            }
+          }
+        }
+        scales[g]  = maxv;
+        factors[g] = (maxv > 0  ?  maxq / maxv : 0);
+      }
+      for (uInt i=0; i<nval; i+=step) {
+        for (uInt g=0; g<ngroup; ++g) {
+          float factor = factors[g];
+          for (uInt f=0; f<nfloat; ++f, ++data, ++out) {
+            if (isFinite(*data)) {
+              long q = lrintf(*data * factor);
+              *out = T(std::max (-maxq, std::min (maxq, q)));
+            } else {
+              *out = nanq;
+            }
+          }
+        }
+      }
+    }
+
+    // Convert the quantized values back to floats.
+    template<typename T>
+    void dequantize (const T* in, uInt nval, uInt nfloat, uInt ngroup,
+                     const float* scales, vector<float>& factors, float* data)
+    {
+      const float maxq = std::numeric_limits<T>::max();
+      const T     nanq = std::numeric_limits<T>::min();
+      const float nan  = std::numeric_limits<float>::quiet_NaN();
+      const uInt  step = nfloat * ngroup;
+      for (uInt g=0; g<ngroup; ++g) {
+        factors[g] = scales[g] / maxq;
+      }
+      for (uInt i=0; i<nval; i+=step) {
+        for (uInt g=0; g<ngroup; ++g) {
+          float factor = factors[g];
+          for (uInt f=0; f<nfloat; ++f, ++in, ++data) {
+            *data = (*in == nanq  ?  nan : *in * factor);
+          }
+        }
+      }
+    }
+
+    // Byte-swap the scales and values of a cell in place.
+    void swapCell (char* ptr, uInt nscale, uInt nval, uInt nbits)
+    {
+      uInt val4;
+      uShort val2;
+      for (uInt i=0; i<nscale; ++i, ptr+=4) {
+        CanonicalConversion::reverse4 (&val4, ptr);
+        memcpy (ptr, &val4, 4);
+      }
+      if (nbits == 16) {
+        for (uInt i=0; i<nval; ++i, ptr+=2) {
+          CanonicalConversion::reverse2 (&val2, ptr);
+          memcpy (ptr, &val2, 2);
+        }
+      } else if (nbits == 32) {
+        for (uInt i=0; i<nval; ++i, ptr+=4) {
+          CanonicalConversion::reverse4 (&val4, ptr);
+          memcpy (ptr, &val4, 4);
+        }
+      }
+    }
+
+    // Round the cell size up to a multiple of 8 bytes.
+    uInt alignCell (uInt size)
+    {
+      return (size + 7) / 8 * 8;
+    }
+
+  } // end anonymous namespace
+
+
+  CompressColumn::~CompressColumn()
+  {}
+  Bool CompressColumn::isWritable() const
+  {
+    return True;
+  }
+  void CompressColumn::setShapeColumn (const IPosition& shape)
+  {
+    itsShape = shape;
+  }
+  IPosition CompressColumn::shape (uInt)
+  {
+    return itsShape;
+  }
+
+  QuantizedColumn::~QuantizedColumn()
+  {}
+  uInt QuantizedColumn::cellSize() const
+  {
+    if (itsNBits == 32) {
+      return alignCell (nfloat() * sizeof(float));
+    }
+    return alignCell (nscale() * sizeof(float) + nfloat() * itsNBits / 8);
+  }
+  void QuantizedColumn::putFloats (uInt rownr, const float* data)
+  {
+    char* ptr = itsParent->getWritePointer (rownr, itsOffset);
+    uInt nsc  = nscale();
+    uInt nval = nfloat();
+    if (itsNBits == 32) {
+      nsc = 0;
+      memcpy (ptr, data, nval * sizeof(float));
+    } else {
+      itsFactors.resize (nsc);
+      float* scales = reinterpret_cast<float*>(ptr);
+      if (itsNBits == 8) {
+        quantize (data, nval, itsNFloat, nsc, scales, itsFactors,
+                  reinterpret_cast<signed char*>(scales + nsc));
+      } else {
+        quantize (data, nval, itsNFloat, nsc, scales, itsFactors,
+                  reinterpret_cast<Short*>(scales + nsc));
+      }
+    }
+    if (itsParent->doSwap()) {
+      swapCell (ptr, nsc, nval, itsNBits);
+    }
+  }
+  void QuantizedColumn::getFloats (uInt rownr, float* data)
+  {
+    const char* ptr = itsParent->getReadPointer (rownr, itsOffset);
+    uInt nsc  = nscale();
+    uInt nval = nfloat();
+    if (itsNBits == 32) {
+      nsc = 0;
+    }
+    if (itsParent->doSwap()) {
+      // Swap a copy of the cell.
+      itsSwapBuf.resize (cellSize());
+      memcpy (&(itsSwapBuf[0]), ptr, itsSwapBuf.size());
+      swapCell (&(itsSwapBuf[0]), nsc, nval, itsNBits);
+      ptr = &(itsSwapBuf[0]);
+    }
+    if (itsNBits == 32) {
+      memcpy (data, ptr, nval * sizeof(float));
+    } else {
+      itsFactors.resize (nsc);
+      const float* scales = reinterpret_cast<const float*>(ptr);
+      if (itsNBits == 8) {
+        dequantize (reinterpret_cast<const signed char*>(scales + nsc), nval,
+                    itsNFloat, nsc, scales, itsFactors, data);
+      } else {
+        dequantize (reinterpret_cast<const Short*>(scales + nsc), nval,
+                    itsNFloat, nsc, scales, itsFactors, data);
+      }
+    }
+  }
+
+  ComplexColumn::~ComplexColumn()
+  {}
+  void ComplexColumn::getArrayComplexV (uInt rownr, Array<Complex>* dataPtr)
+  {
+    Bool deleteIt;
+    Complex* data = dataPtr->getStorage(deleteIt);
+    getFloats (rownr, reinterpret_cast<float*>(data));
+    dataPtr->putStorage (data, deleteIt);
+  }
+  void ComplexColumn::putArrayComplexV (uInt rownr,
+                                        const Array<Complex>* dataPtr)
+  {
+    Bool deleteIt;
+    const Complex* data = dataPtr->getStorage(deleteIt);
+    putFloats (rownr, reinterpret_cast<const float*>(data));
+    dataPtr->freeStorage (data, deleteIt);
+  }
+
+  FloatColumn::~FloatColumn()
+  {}
+  void FloatColumn::getArrayfloatV (uInt rownr, Array<Float>* dataPtr)
+  {
+    Bool deleteIt;
+    Float* data = dataPtr->getStorage(deleteIt);
+    getFloats (rownr, data);
+    dataPtr->putStorage (data, deleteIt);
+  }
+  void FloatColumn::putArrayfloatV (uInt rownr, const Array<Float>* dataPtr)
+  {
+    Bool deleteIt;
+    const Float* data = dataPtr->getStorage(deleteIt);
+    putFloats (rownr, data);
+    dataPtr->freeStorage (data, deleteIt);
+  }
+
+  BoolColumn::~BoolColumn()
+  {}
+  uInt BoolColumn::cellSize() const
+  {
+    return alignCell ((itsShape.product() + 7) / 8);
+  }
+  void BoolColumn::getArrayBoolV (uInt rownr, Array<Bool>* dataPtr)
+  {
+    const char* ptr = itsParent->getReadPointer (rownr, itsOffset);
+    Bool deleteIt;
+    Bool* data = dataPtr->getStorage(deleteIt);
+    Conversion::bitToBool (data, ptr, dataPtr->nelements());
+    dataPtr->putStorage (data, deleteIt);
+  }
+  void BoolColumn::putArrayBoolV (uInt rownr, const Array<Bool>* dataPtr)
+  {
+    char* ptr = itsParent->getWritePointer (rownr, itsOffset);
+    Bool deleteIt;
+    const Bool* data = dataPtr->getStorage(deleteIt);
+    Conversion::boolToBit (ptr, data, dataPtr->nelements());
+    dataPtr->freeStorage (data, deleteIt);
+  }
+
+} //# end namespace
@@ -0,0 +1,449 @@
+//# CompressStMan.cc: Storage Manager storing visibilities in compressed form
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <CompressStMan/CompressStMan.h>
+#include <CompressStMan/CompressColumn.h>
+#include <tables/Tables/Table.h>
+#include <tables/Tables/DataManError.h>
+#include <casa/Containers/Record.h>
+#include <casa/Arrays/IPosition.h>
+#include <casa/IO/AipsIO.h>
+#include <casa/OS/HostInfo.h>
+#include <casa/OS/DOos.h>
+#include <casa/Utilities/DataType.h>
+#include <algorithm>
+#include <unistd.h>
+
+using namespace casa;
+
+
+namespace LOFAR {
+
+CompressStMan::CompressStMan (const String& dataManName,
+                              uint dataBits, uint weightBits)
+: DataManager    (),
+  itsDataManName (dataManName),
+  itsNrRows      (0),
+  itsDataBits    (dataBits),
+  itsWeightBits  (weightBits),
+  itsFD          (-1),
+  itsFile        (0),
+  itsDoSwap      (false),
+  itsMetaChanged (false),
+  itsRowSize     (0),
+  itsBucketStart (-1),
+  itsBucketNRow  (0),
+  itsDirty       (false)
+{
+  checkBits (itsDataBits);
+  checkBits (itsWeightBits);
+}
+
+CompressStMan::CompressStMan (const String& dataManName,
+                              const Record& spec)
+: DataManager    (),
+  itsDataManName (dataManName),
+  itsNrRows      (0),
+  itsDataBits    (16),
+  itsWeightBits  (16),
+  itsFD          (-1),
+  itsFile        (0),
+  itsDoSwap      (false),
+  itsMetaChanged (false),
+  itsRowSize     (0),
+  itsBucketStart (-1),
+  itsBucketNRow  (0),
+  itsDirty       (false)
+{
+  if (spec.isDefined ("dataBits")) {
+    itsDataBits = spec.asInt ("dataBits");
+  }
+  if (spec.isDefined ("weightBits")) {
+    itsWeightBits = spec.asInt ("weightBits");
+  }
+  checkBits (itsDataBits);
+  checkBits (itsWeightBits);
+}
+
+CompressStMan::CompressStMan (const CompressStMan& that)
+: DataManager    (),
+  itsDataManName (that.itsDataManName),
+  itsNrRows      (0),
+  itsDataBits    (that.itsDataBits),
+  itsWeightBits  (that.itsWeightBits),
+  itsFD          (-1),
+  itsFile        (0),
+  itsDoSwap      (false),
+  itsMetaChanged (false),
+  itsRowSize     (0),
+  itsBucketStart (-1),
+  itsBucketNRow  (0),
+  itsDirty       (false)
+{}
+
+CompressStMan::~CompressStMan()
+{
+  closeFile();
+  for (uInt i=0; i<itsColumns.size(); i++) {
+    delete itsColumns[i];
+  }
+}
+
+DataManager* CompressStMan::clone() const
+{
+  return new CompressStMan (*this);
+}
+
+String CompressStMan::dataManagerType() const
+{
+  return "CompressStMan";
+}
+
+String CompressStMan::dataManagerName() const
+{
+  return itsDataManName;
+}
+
+Record CompressStMan::dataManagerSpec() const
+{
+  Record spec;
+  spec.define ("dataBits", Int(itsDataBits));
+  spec.define ("weightBits", Int(itsWeightBits));
+  return spec;
+}
+
+void CompressStMan::checkBits (uint nbits)
+{
+  if (nbits != 8  &&  nbits != 16  &&  nbits != 32) {
+    throw DataManError ("CompressStMan: nr of bits " +
+                        String::toString(nbits) + " must be 8, 16 or 32");
+  }
+}
+
+
+DataManagerColumn* CompressStMan::makeScalarColumn (const String& name,
+                                                    int,
+                                                    const String&)
+{
+  throw DataManError ("CompressStMan cannot hold scalar column " + name);
+}
+
+DataManagerColumn* CompressStMan::makeDirArrColumn (const String& name,
+                                                    int dtype,
+                                                    const String&)
+{
+  CompressColumn* col;
+  switch (dtype) {
+  case TpComplex:
+    col = new ComplexColumn(this, name, dtype);
+    break;
+  case TpFloat:
+    col = new FloatColumn(this, name, dtype);
+    break;
+  case TpBool:
+    col = new BoolColumn(this, name, dtype);
+    break;
+  default:
+    throw DataManError ("CompressStMan can only hold columns of type "
+                        "Complex, Float or Bool; column " + name + " is not");
+  }
+  itsColumns.push_back (col);
+  return col;
+}
+
+DataManagerColumn* CompressStMan::makeIndArrColumn (const String& name,
+                                                    int,
+                                                    const String&)
+{
+  throw DataManError ("CompressStMan can only hold fixed shape arrays; "
+                      "column " + name + " is not");
+}
+
+DataManager* CompressStMan::makeObject (const String& group, const Record& spec)
+{
+  // This function is called when reading a table back.
+  return new CompressStMan (group, spec);
+}
+
+void CompressStMan::registerClass()
+{
+  DataManager::registerCtor ("CompressStMan", makeObject);
+}
+
+Bool CompressStMan::canAddRow() const
+{
+  return True;
+}
+Bool CompressStMan::canRemoveRow() const
+{
+  return True;
+}
+Bool CompressStMan::canAddColumn() const
+{
+  return False;
+}
+Bool CompressStMan::canRemoveColumn() const
+{
+  return True;
+}
+
+void CompressStMan::addRow (uInt nrrow)
+{
+  itsNrRows += nrrow;
+  // Extend the file; the new rows read as zeroes.
+  if (::ftruncate (itsFD, itsNrRows * itsRowSize) != 0) {
+    throw DataManError ("CompressStMan: could not extend file " +
+                        itsFile->fileName());
+  }
+  // The last bucket might get more rows.
+  if (itsBucketStart >= 0  &&
+      itsBucketStart + itsRowsPerBucket > itsNrRows - nrrow) {
+    int64 nrow = std::min (itsRowsPerBucket, itsNrRows - itsBucketStart);
+    memset (itsBucket.storage() + itsBucketNRow*itsRowSize, 0,
+            (nrow - itsBucketNRow) * itsRowSize);
+    itsBucketNRow = nrow;
+  }
+  itsMetaChanged = true;
+}
+
+void CompressStMan::removeRow (uInt rownr)
+{
+  if (rownr != itsNrRows-1) {
+    throw DataManError ("CompressStMan can only remove the last row");
+  }
+  writeBucket();
+  itsBucketStart = -1;
+  itsBucketNRow  = 0;
+  itsNrRows--;
+  if (::ftruncate (itsFD, itsNrRows * itsRowSize) != 0) {
+    throw DataManError ("CompressStMan: could not truncate file " +
+                        itsFile->fileName());
+  }
+  itsMetaChanged = true;
+}
+
+void CompressStMan::addColumn (DataManagerColumn*)
+{
+  // The column is already part of the layout if created with the storage
+  // manager. Otherwise it can only be added as long as there are no rows.
+  int64 rowSize = itsRowSize;
+  writeBucket();
+  setLayout();
+  if (itsRowSize != rowSize) {
+    if (itsNrRows > 0) {
+      throw DataManError ("CompressStMan cannot add columns");
+    }
+    writeMeta();
+  }
+}
+void CompressStMan::removeColumn (DataManagerColumn*)
+{}
+
+Bool CompressStMan::flush (AipsIO&, Bool doFsync)
+{
+  writeBucket();
+  if (itsMetaChanged) {
+    writeMeta();
+  }
+  if (doFsync  &&  itsFD >= 0) {
+    ::fsync (itsFD);
+  }
+  return False;
+}
+
+void CompressStMan::create (uInt nrrow)
+{
+  itsDoSwap = false;
+  setLayout();
+  openFile (true);
+  itsNrRows = 0;
+  if (nrrow > 0) {
+    addRow (nrrow);
+  }
+  writeMeta();
+}
+
+void CompressStMan::open (uInt, AipsIO&)
+{
+  throw DataManError ("CompressStMan::open should never be called");
+}
+uInt CompressStMan::open1 (uInt, AipsIO&)
+{
+  readMeta();
+  openFile (table().isWritable());
+  return itsNrRows;
+}
+
+void CompressStMan::resync (uInt)
+{
+  throw DataManError ("CompressStMan::resync should never be called");
+}
+uInt CompressStMan::resync1 (uInt)
+{
+  // Another process might have changed the data, so clear the bucket.
+  itsBucketStart = -1;
+  itsBucketNRow  = 0;
+  readMeta();
+  return itsNrRows;
+}
+
+void CompressStMan::reopenRW()
+{
+  openFile (true);
+}
+
+void CompressStMan::deleteManager()
+{
+  itsDirty = false;
+  closeFile();
+  DOos::remove (fileName()+"meta", False, False);
+  DOos::remove (fileName()+"data", False, False);
+}
+
+void CompressStMan::setLayout()
+{
+  // The cells are stored in the order of the columns.
+  itsRowSize = 0;
+  for (uInt i=0; i<itsColumns.size(); ++i) {
+    if (itsColumns[i]->shapeColumn().empty()) {
+      throw DataManError ("CompressStMan: column " + itsColumns[i]->name() +
+                          " must have a fixed shape");
+    }
+    itsColumns[i]->setOffset (itsRowSize);
+    itsRowSize += itsColumns[i]->cellSize();
+  }
+  // Use buckets of about 1 MB.
+  itsRowsPerBucket = std::max (int64(1), (int64(1)<<20) / std::max(itsRowSize,
+                                                                   int64(1)));
+  itsBucket.resize (itsRowsPerBucket * itsRowSize);
+  itsBucketStart = -1;
+  itsBucketNRow  = 0;
+}
+
+void CompressStMan::writeMeta()
+{
+  AipsIO aio(fileName() + "meta", ByteIO::New);
+  aio.putstart ("CompressStMan", 1);
+  aio << (itsDoSwap ? !HostInfo::bigEndian() : HostInfo::bigEndian());
+  aio << itsDataBits << itsWeightBits << itsNrRows << uInt(itsColumns.size());
+  for (uInt i=0; i<itsColumns.size(); ++i) {
+    aio << itsColumns[i]->name() << itsColumns[i]->dataType()
+        << itsColumns[i]->shapeColumn();
+  }
+  aio.putend();
+  itsMetaChanged = false;
+}
+
+void CompressStMan::readMeta()
+{
+  AipsIO aio(fileName() + "meta");
+  uInt version = aio.getstart ("CompressStMan");
+  if (version > 1) {
+    throw DataManError ("CompressStMan can only handle up to version 1");
+  }
+  Bool bigEndian;
+  uInt ncol;
+  aio >> bigEndian >> itsDataBits >> itsWeightBits >> itsNrRows >> ncol;
+  itsDoSwap = (bigEndian != HostInfo::bigEndian());
+  if (ncol != itsColumns.size()) {
+    throw DataManError ("CompressStMan: mismatching nr of columns in "
+                        "meta file " + fileName() + "meta");
+  }
+  // The columns are stored in the order of creation, which is also the
+  // order of the cells in a row. Find them by name.
+  vector<CompressColumn*> columns(ncol, (CompressColumn*)0);
+  for (uInt i=0; i<ncol; ++i) {
+    String name;
+    Int dtype;
+    IPosition shape;
+    aio >> name >> dtype >> shape;
+    for (uInt j=0; j<itsColumns.size(); ++j) {
+      if (itsColumns[j]->name() == name) {
+        if (itsColumns[j]->dataType() != dtype) {
+          throw DataManError ("CompressStMan: column " + name +
+                              " has a different data type in the meta file");
+        }
+        itsColumns[j]->setShapeColumn (shape);
+        columns[i] = itsColumns[j];
+      }
+    }
+    if (columns[i] == 0) {
+      throw DataManError ("CompressStMan: column " + name +
+                          " in the meta file is unknown");
+    }
+  }
+  aio.getend();
+  itsColumns.swap (columns);
+  setLayout();
+}
+
+void CompressStMan::openFile (bool writable)
+{
+  // First close if needed.
+  closeFile();
+  String fname (fileName() + "data");
+  if (DOos::fileExists (fname)) {
+    itsFD = LargeFiledesIO::open (fname.c_str(), writable);
+  } else {
+    itsFD = LargeFiledesIO::create (fname.c_str());
+  }
+  itsFile = new LargeFiledesIO (itsFD, fname);
+}
+
+void CompressStMan::closeFile()
+{
+  if (itsFD >= 0) {
+    writeBucket();
+    if (itsMetaChanged) {
+      writeMeta();
+    }
+    LargeFiledesIO::close (itsFD);
+    itsFD = -1;
+  }
+  delete itsFile;
+  itsFile = 0;
+  itsBucketStart = -1;
+  itsBucketNRow  = 0;
+}
+
+void CompressStMan::readBucket (uInt rownr)
+{
+  writeBucket();
+  if (rownr >= itsNrRows) {
+    throw DataManError ("CompressStMan: row " + String::toString(rownr) +
+                        " does not exist");
+  }
+  itsBucketStart = rownr / itsRowsPerBucket * itsRowsPerBucket;
+  itsBucketNRow  = std::min (itsRowsPerBucket, itsNrRows - itsBucketStart);
+  itsFile->seek (itsBucketStart * itsRowSize);
+  itsFile->read (itsBucketNRow * itsRowSize, itsBucket.storage());
+}
+
+void CompressStMan::writeBucket()
+{
+  if (itsDirty) {
+    itsFile->seek (itsBucketStart * itsRowSize);
+    itsFile->write (itsBucketNRow * itsRowSize, itsBucket.storage());
+    itsDirty = false;
+  }
+}
+
+} //# end namespace
@@ -0,0 +1,261 @@
+//# tCompressStMan.cc: Test program for class CompressStMan
+//# Copyright (C) 2016
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <CompressStMan/CompressStMan.h>
+#include <tables/Tables/TableDesc.h>
+#include <tables/Tables/SetupNewTab.h>
+#include <tables/Tables/Table.h>
+#include <tables/Tables/ArrColDesc.h>
+#include <tables/Tables/ArrayColumn.h>
+#include <tables/Tables/TiledColumnStMan.h>
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/ArrayMath.h>
+#include <casa/Arrays/ArrayLogical.h>
+#include <casa/OS/DOos.h>
+#include <casa/OS/Timer.h>
+#include <casa/Utilities/Assert.h>
+#include <casa/Exceptions/Error.h>
+#include <casa/iostream.h>
+#include <casa/sstream.h>
+#include <cstdlib>
+#include <limits>
+
+using namespace LOFAR;
+using namespace casa;
+
+// This program tests the class CompressStMan and related classes.
+// It writes a table with DATA, WEIGHT_SPECTRUM and FLAG columns, reads it
+// back and checks if the values are within the quantization error.
+// Thereafter it compares the size and the read and write speed with the
+// TiledColumnStMan. The timings are only shown if TCOMPRESSSTMAN_PERF is set,
+// so the output is reproducible.
+
+// Fill the arrays for a given row.
+// The auto-correlations (first and last) are much larger than the others.
+void fillRow (uInt row, Array<Complex>& data, Array<Float>& weights,
+              Array<Bool>& flags)
+{
+  uInt npol  = data.shape()[0];
+  uInt nchan = data.shape()[1];
+  Complex* dataPtr = data.data();
+  Float* wghtPtr = weights.data();
+  Bool* flagPtr = flags.data();
+  for (uInt i=0; i<nchan; ++i) {
+    for (uInt j=0; j<npol; ++j) {
+      Float ampl = (j==0 || j==npol-1 ? 1000 : 1);
+      *dataPtr++ = ampl * Complex(sin(0.01*(row+i+j)), cos(0.02*(row*i+j)));
+      *wghtPtr++ = 1 + (row+i)%7;
+      *flagPtr++ = (row+i+j)%5 == 0;
+    }
+  }
+  // Put in a NaN.
+  if (row%3 == 0) {
+    data.data()[1] = std::numeric_limits<float>::quiet_NaN();
+  }
+}
+
+void createTable (const String& name, uInt nrow, uInt npol, uInt nchan,
+                  DataManager& dm)
+{
+  IPosition shape(2, npol, nchan);
+  TableDesc td("", "1", TableDesc::Scratch);
+  td.addColumn (ArrayColumnDesc<Complex>("DATA", shape,
+                                         ColumnDesc::FixedShape));
+  td.addColumn (ArrayColumnDesc<Float>("WEIGHT_SPECTRUM", shape,
+                                       ColumnDesc::FixedShape));
+  td.addColumn (ArrayColumnDesc<Bool>("FLAG", shape,
+                                      ColumnDesc::FixedShape));
+  SetupNewTable newtab(name, td, Table::New);
+  newtab.bindAll (dm);
+  Table tab(newtab);
+  ArrayColumn<Complex> dataCol(tab, "DATA");
+  ArrayColumn<Float> wghtCol(tab, "WEIGHT_SPECTRUM");
+  ArrayColumn<Bool> flagCol(tab, "FLAG");
+  Array<Complex> data(shape);
+  Array<Float> weights(shape);
+  Array<Bool> flags(shape);
+  // Add the rows in blocks as done by DPPP.
+  for (uInt row=0; row<nrow; ++row) {
+    if (row%100 == 0) {
+      tab.addRow (std::min(100u, nrow-row));
+    }
+    fillRow (row, data, weights, flags);
+    dataCol.put (row, data);
+    wghtCol.put (row, weights);
+    flagCol.put (row, flags);
+  }
+}
+
+void checkTable (const String& name, uInt dataBits, uInt weightBits)
+{
+  Table tab(name);
+  ROArrayColumn<Complex> dataCol(tab, "DATA");
+  ROArrayColumn<Float> wghtCol(tab, "WEIGHT_SPECTRUM");
+  ROArrayColumn<Bool> flagCol(tab, "FLAG");
+  IPosition shape = dataCol.shape(0);
+  uInt npol = shape[0];
+  Array<Complex> data(shape);
+  Array<Float> weights(shape);
+  Array<Bool> flags(shape);
+  for (uInt row=0; row<tab.nrow(); ++row) {
+    fillRow (row, data, weights, flags);
+    Array<Complex> dataRead = dataCol(row);
+    Array<Float> wghtRead = wghtCol(row);
+    // Flags must be exact.
+    AlwaysAssertExit (allEQ (flagCol(row), flags));
+    // Check the data per correlation against the quantization error.
+    for (uInt j=0; j<npol; ++j) {
+      IPosition st(2,j,0);
+      IPosition end(2,j,shape[1]-1);
+      Array<Complex> d = data(st,end);
+      Array<Complex> dr = dataRead(st,end);
+      double scale = 0;
+      for (uInt i=0; i<d.size(); ++i) {
+        Complex v = d.data()[i];
+        if (isFinite(v.real())) {
+          scale = std::max (scale, double(std::max (abs(v.real()),
+                                                     abs(v.imag()))));
+        }
+      }
+      double maxErr = 0;
+      if (dataBits < 32) {
+        maxErr = scale / (2 * ((1 << (dataBits-1)) - 1)) * 1.0001;
+      }
+      for (uInt i=0; i<d.size(); ++i) {
+        Complex v  = d.data()[i];
+        Complex vr = dr.data()[i];
+        if (!isFinite(v.real())) {
+          AlwaysAssertExit (isNaN(vr.real()));
+        } else {
+          AlwaysAssertExit (abs(v.real() - vr.real()) <= maxErr);
+          AlwaysAssertExit (abs(v.imag() - vr.imag()) <= maxErr);
+        }
+      }
+    }
+    if (weightBits < 32) {
+      Float maxErr = max(weights) / (2 * ((1 << (weightBits-1)) - 1)) * 1.0001;
+      AlwaysAssertExit (allNearAbs (wghtRead, weights, maxErr));
+    } else {
+      AlwaysAssertExit (allEQ (wghtRead, weights));
+    }
+  }
+}
+
+void updateTable (const String& name)
+{
+  // Overwrite a row in the middle and check it.
+  Table tab(name, Table::Update);
+  ArrayColumn<Bool> flagCol(tab, "FLAG");
+  uInt row = tab.nrow() / 2;
+  Array<Bool> flags = flagCol(row);
+  flags = !flags;
+  flagCol.put (row, flags);
+  AlwaysAssertExit (allEQ (flagCol(row), flags));
+  flagCol.put (row, !flags);
+}
+
+double readTable (const String& name)
+{
+  Timer timer;
+  Table tab(name);
+  ROArrayColumn<Complex> dataCol(tab, "DATA");
+  ROArrayColumn<Float> wghtCol(tab, "WEIGHT_SPECTRUM");
+  ROArrayColumn<Bool> flagCol(tab, "FLAG");
+  Array<Complex> data;
+  Array<Float> weights;
+  Array<Bool> flags;
+  for (uInt row=0; row<tab.nrow(); ++row) {
+    dataCol.get (row, data, True);
+    wghtCol.get (row, weights, True);
+    flagCol.get (row, flags, True);
+  }
+  return timer.real();
+}
+
+void testPerf (uInt nrow, uInt npol, uInt nchan, uInt dataBits,
+               uInt weightBits)
+{
+  Timer timer;
+  {
+    IPosition tileShape(3, npol, nchan, std::max(1u, 131072/(npol*nchan)));
+    TiledColumnStMan tsm("TiledData", tileShape);
+    createTable ("tCompressStMan_tmp.tiled", nrow, npol, nchan, tsm);
+  }
+  double tiledWrite = timer.real();
+  timer.mark();
+  {
+    CompressStMan csm("CompressData", dataBits, weightBits);
+    createTable ("tCompressStMan_tmp.comp", nrow, npol, nchan, csm);
+  }
+  double compWrite = timer.real();
+  double tiledRead = readTable ("tCompressStMan_tmp.tiled");
+  double compRead  = readTable ("tCompressStMan_tmp.comp");
+  Vector<String> names(2);
+  names[0] = "tCompressStMan_tmp.tiled";
+  names[1] = "tCompressStMan_tmp.comp";
+  Vector<Double> sizes = DOos::totalSize (names);
+  cout << "dataBits=" << dataBits << " weightBits=" << weightBits
+       << "  compression ratio=" << sizes[0] / sizes[1] << endl;
+  if (getenv("TCOMPRESSSTMAN_PERF")) {
+    double mbytes = sizes[0] / (1024.*1024.);
+    cout << "  write: tiled " << mbytes/tiledWrite << " MB/s, compressed "
+         << mbytes/compWrite << " MB/s" << endl;
+    cout << "  read:  tiled " << mbytes/tiledRead << " MB/s, compressed "
+         << mbytes/compRead << " MB/s" << endl;
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  try {
+    // Register CompressStMan to be able to read it back.
+    CompressStMan::registerClass();
+    // Get nrow, npol, nchan from argv.
+    uInt nrow=1000;
+    uInt npol=4;
+    uInt nchan=64;
+    if (argc > 1) {
+      istringstream istr(argv[1]);
+      istr >> nrow;
+    }
+    if (argc > 2) {
+      istringstream istr(argv[2]);
+      istr >> nchan;
+    }
+    uInt bits[][2] = {{16,16}, {8,8}, {16,32}, {32,32}};
+    for (uInt i=0; i<4; ++i) {
+      cout << "Test dataBits=" << bits[i][0]
+           << " weightBits=" << bits[i][1] << endl;
+      {
+        CompressStMan csm("CompressData", bits[i][0], bits[i][1]);
+        createTable ("tCompressStMan_tmp.data", nrow, npol, nchan, csm);
+      }
+      checkTable ("tCompressStMan_tmp.data", bits[i][0], bits[i][1]);
+      updateTable ("tCompressStMan_tmp.data");
+      checkTable ("tCompressStMan_tmp.data", bits[i][0], bits[i][1]);
+      testPerf (nrow, npol, nchan, bits[i][0], bits[i][1]);
+    }
+  } catch (AipsError& x) {
+    cout << "Caught an exception: " << x.getMesg() << endl;
+    return 1;
+  }
+  return 0;                           // exit with success status
+}
@@ -34,8 +34,10 @@
 #include <measures/Measures/MeasFrame.h>
 #include <measures/Measures/MDirection.h>
 #include <measures/Measures/MBaseline.h>
+#include <tables/Tables/RefRows.h>
 #include <casa/Arrays/Vector.h>
 #include <casa/Arrays/IPosition.h>
+#include <casa/Arrays/Slicer.h>
 #include <casa/Containers/Block.h>
 #include <casa/OS/Conversion.h>
 
@@ -57,6 +59,10 @@ namespace LOFAR {
 
 // <synopsis>
 // For each column a specific Column class exists.
+// <br>The columns supporting bulk access implement readRows to read the
+// cells of consecutive rows in one go. The helper functions getCells and
+// getSliceCells use it to get the cells of an arbitrary set of rows, where
+// runs of consecutive rows are read with a single call.
 // </synopsis>
 
 class LofarColumn : public casa::StManColumn
@@ -74,6 +80,20 @@ public:
   // Prepare the column. By default it does nothing.
   virtual void prepareCol();
 protected:
+  // Read the cells of <src>nrow</src> consecutive rows starting at rownr
+  // into the buffer. By default it throws an exception.
+  virtual void readRows (casa::uInt rownr, casa::uInt nrow, void* buf);
+
+  // Get the cells of the given rows using readRows.
+  template<typename T>
+  void getCells (const casa::RefRows& rownrs, casa::Array<T>* dataPtr);
+
+  // Get a slice of the cells of the given rows using readRows.
+  // The rows are read per time slot at most.
+  template<typename T>
+  void getSliceCells (const casa::RefRows& rownrs, const casa::Slicer& slicer,
+                      casa::Array<T>* dataPtr);
+
   LofarStMan* itsParent;
 };
 
@@ -188,6 +208,19 @@ public:
                                  casa::Array<casa::Complex>* dataPtr);
   virtual void putArrayComplexV (casa::uInt rowNr,
                                  const casa::Array<casa::Complex>* dataPtr);
+  virtual casa::Bool canAccessArrayColumn (casa::Bool& reask) const;
+  virtual casa::Bool canAccessArrayColumnCells (casa::Bool& reask) const;
+  virtual casa::Bool canAccessColumnSlice (casa::Bool& reask) const;
+  virtual void getArrayColumnComplexV (casa::Array<casa::Complex>* dataPtr);
+  virtual void getArrayColumnCellsComplexV (const casa::RefRows& rownrs,
+                                            casa::Array<casa::Complex>* dataPtr);
+  virtual void getColumnSliceComplexV (const casa::Slicer& slicer,
+                                       casa::Array<casa::Complex>* dataPtr);
+  virtual void getColumnSliceCellsComplexV (const casa::RefRows& rownrs,
+                                            const casa::Slicer& slicer,
+                                            casa::Array<casa::Complex>* dataPtr);
+private:
+  virtual void readRows (casa::uInt rownr, casa::uInt nrow, void* buf);
 };
 
 // <summary>FLAG column in the LOFAR Storage Manager.</summary>
@@ -201,6 +234,20 @@ public:
   virtual casa::IPosition shape (casa::uInt rownr);
   virtual void getArrayBoolV (casa::uInt rowNr,
                               casa::Array<casa::Bool>* dataPtr);
+  virtual casa::Bool canAccessArrayColumn (casa::Bool& reask) const;
+  virtual casa::Bool canAccessArrayColumnCells (casa::Bool& reask) const;
+  virtual casa::Bool canAccessColumnSlice (casa::Bool& reask) const;
+  virtual void getArrayColumnBoolV (casa::Array<casa::Bool>* dataPtr);
+  virtual void getArrayColumnCellsBoolV (const casa::RefRows& rownrs,
+                                         casa::Array<casa::Bool>* dataPtr);
+  virtual void getColumnSliceBoolV (const casa::Slicer& slicer,
+                                    casa::Array<casa::Bool>* dataPtr);
+  virtual void getColumnSliceCellsBoolV (const casa::RefRows& rownrs,
+                                         const casa::Slicer& slicer,
+                                         casa::Array<casa::Bool>* dataPtr);
+private:
+  virtual void readRows (casa::uInt rownr, casa::uInt nrow, void* buf);
+  casa::Block<casa::uInt> itsNSample;
 };
 
 // <summary>WEIGHT column in the LOFAR Storage Manager.</summary>
@@ -212,8 +259,13 @@ public:
     : LofarColumn(parent, dtype) {}
   virtual ~WeightColumn();
   virtual casa::IPosition shape (casa::uInt rownr);
+  virtual casa::Bool canAccessArrayColumn (casa::Bool& reask) const;
+  virtual casa::Bool canAccessArrayColumnCells (casa::Bool& reask) const;
   virtual void getArrayfloatV (casa::uInt rowNr,
                                casa::Array<casa::Float>* dataPtr);
+  virtual void getArrayColumnfloatV (casa::Array<casa::Float>* dataPtr);
+  virtual void getArrayColumnCellsfloatV (const casa::RefRows& rownrs,
+                                          casa::Array<casa::Float>* dataPtr);
 };
 
 // <summary>SIGMA column in the LOFAR Storage Manager.</summary>
@@ -225,8 +277,13 @@ public:
     : LofarColumn(parent, dtype) {}
   virtual ~SigmaColumn();
   virtual casa::IPosition shape (casa::uInt rownr);
+  virtual casa::Bool canAccessArrayColumn (casa::Bool& reask) const;
+  virtual casa::Bool canAccessArrayColumnCells (casa::Bool& reask) const;
   virtual void getArrayfloatV (casa::uInt rowNr,
                                casa::Array<casa::Float>* dataPtr);
+  virtual void getArrayColumnfloatV (casa::Array<casa::Float>* dataPtr);
+  virtual void getArrayColumnCellsfloatV (const casa::RefRows& rownrs,
+                                          casa::Array<casa::Float>* dataPtr);
 };
 
 // <summary>WEIGHT_SPECTRUM column in the LOFAR Storage Manager.</summary>
@@ -240,6 +297,20 @@ public:
   virtual casa::IPosition shape (casa::uInt rownr);
   virtual void getArrayfloatV (casa::uInt rowNr,
                                casa::Array<casa::Float>* dataPtr);
+  virtual casa::Bool canAccessArrayColumn (casa::Bool& reask) const;
+  virtual casa::Bool canAccessArrayColumnCells (casa::Bool& reask) const;
+  virtual casa::Bool canAccessColumnSlice (casa::Bool& reask) const;
+  virtual void getArrayColumnfloatV (casa::Array<casa::Float>* dataPtr);
+  virtual void getArrayColumnCellsfloatV (const casa::RefRows& rownrs,
+                                          casa::Array<casa::Float>* dataPtr);
+  virtual void getColumnSlicefloatV (const casa::Slicer& slicer,
+                                     casa::Array<casa::Float>* dataPtr);
+  virtual void getColumnSliceCellsfloatV (const casa::RefRows& rownrs,
+                                          const casa::Slicer& slicer,
+                                          casa::Array<casa::Float>* dataPtr);
+private:
+  virtual void readRows (casa::uInt rownr, casa::uInt nrow, void* buf);
+  casa::Block<casa::uInt> itsNSample;
 };
 
 // <summary>FLAG_CATEGORY column in the LOFAR Storage Manager.</summary>
@@ -90,6 +90,13 @@ class LofarColumn;
 // the online system does not have the resources to do it.
 //
 // All columns are readonly with the exception of DATA.
+//
+// The DATA, FLAG and WEIGHT_SPECTRUM columns can be read in bulk (using
+// e.g. getColumn, getColumnRange or getColumnCells). Consecutive rows in the
+// same time slot are contiguous in the data file, so they are read in a
+// single read directly into the user's array. When the time slots are
+// accessed in sequential order, the kernel is told to read ahead the next
+// time slots, so the disk reads overlap with the processing of the data.
 // </synopsis>
 
 // <motivation>
@@ -186,7 +193,19 @@ public:
     { return itsMaxNrSample; }
   void getData (uint rownr, casa::Complex* buf);
   void putData (uint rownr, const casa::Complex* buf);
+  // </group>
+
+  // Get the data of <src>nrow</src> consecutive rows starting at rownr.
+  // The rows in a time slot are read with a single read.
+  void getData (uint rownr, uint nrow, casa::Complex* buf);
+
+  // Get the nr of valid samples of <src>nrow</src> consecutive rows
+  // starting at rownr. Similar to getNSample1/2/4, invalid values are
+  // set to 0.
+  void getNSample (uint rownr, uint nrow, casa::uInt* buf);
 
+  // Get the nr of valid samples of a single row.
+  // <group>
   const casa::uChar*  getNSample1 (uint rownr, bool swapIfNeeded);
   const casa::uShort* getNSample2 (uint rownr, bool swapIfNeeded);
   const casa::uInt*   getNSample4 (uint rownr, bool swapIfNeeded); 
@@ -309,9 +328,18 @@ private:
 
   // Read or write the data for regular files.
   void* readFile  (casa::uInt blocknr, casa::uInt offset, casa::uInt size);
+  void  readFile  (casa::uInt blocknr, casa::uInt offset, int64 size,
+                   void* buf);
   void* getBuffer (casa::uInt size);
   void  writeFile (casa::uInt blocknr, casa::uInt offset, casa::uInt size);
 
+  // Tell the kernel to read ahead the next time slots if the blocks
+  // are accessed sequentially.
+  void prefetch (casa::uInt blocknr);
+
+  // Byte-swap and/or conjugate the data read as needed.
+  void convertData (casa::Complex* buf, int64 size) const;
+
 
   //# Declare member variables.
   // Name of data manager.
@@ -340,6 +368,9 @@ private:
   int64  itsBLDataSize;   //# data size of a single baseline
   int64  itsDataStart;    //# start of data in a block
   int64  itsSampStart;    //# start of nsamples in a block
+  int64  itsLastBlock;    //# last block read (-1 = none)
+  int64  itsPrefetchEnd;  //# first block not advised to be read ahead
+  int64  itsNrPrefetch;   //# nr of blocks to read ahead
   //# Buffer to hold nsample values.
   casa::Block<casa::uChar> itsNSampleBuf1;
   casa::Block<casa::uShort> itsNSampleBuf2;
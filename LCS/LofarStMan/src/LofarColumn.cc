@@ -39,6 +39,7 @@
 #include <casa/Arrays/Array.h>
 #include <casa/Utilities/Assert.h>
 #include <casa/Exceptions/Error.h>
+#include <algorithm>
 
 using namespace casa;
 
@@ -55,6 +56,89 @@ namespace LOFAR {
   {}
   void LofarColumn::prepareCol()
   {}
+  void LofarColumn::readRows (uInt, uInt, void*)
+  {
+    throw DataManError ("LofarStMan: column cannot be read in bulk");
+  }
+
+  template<typename T>
+  void LofarColumn::getCells (const RefRows& rownrs, Array<T>* dataPtr)
+  {
+    if (dataPtr->nelements() == 0) {
+      return;
+    }
+    // The last axis of the array is the row axis.
+    uInt ndim = dataPtr->ndim();
+    uInt cellSize = dataPtr->shape().getFirst(ndim-1).product();
+    Bool deleteIt;
+    T* data = dataPtr->getStorage (deleteIt);
+    T* ptr  = data;
+    RefRowsSliceIter iter(rownrs);
+    while (!iter.pastEnd()) {
+      uInt rownr = iter.sRow();
+      uInt erow  = iter.eRow();
+      uInt incr  = iter.incr();
+      if (incr == 1) {
+        readRows (rownr, erow-rownr+1, ptr);
+        ptr += (erow-rownr+1) * cellSize;
+      } else {
+        for (; rownr<=erow; rownr+=incr) {
+          readRows (rownr, 1, ptr);
+          ptr += cellSize;
+        }
+      }
+      iter++;
+    }
+    dataPtr->putStorage (data, deleteIt);
+  }
+
+  template<typename T>
+  void LofarColumn::getSliceCells (const RefRows& rownrs,
+                                   const Slicer& slicer, Array<T>* dataPtr)
+  {
+    if (dataPtr->nelements() == 0) {
+      return;
+    }
+    IPosition cellShape = shape(0);
+    uInt ndim = cellShape.size();
+    IPosition blc, trc, inc;
+    slicer.inferShapeFromSource (cellShape, blc, trc, inc);
+    blc.append (IPosition(1, 0));
+    trc.append (IPosition(1, 0));
+    inc.append (IPosition(1, 1));
+    IPosition outBlc(ndim+1, 0);
+    IPosition outTrc(dataPtr->shape() - 1);
+    uInt nrbl = itsParent->ant1().size();
+    // Read the full cells of (at most) a time slot and copy the slice.
+    Array<T> buf;
+    uInt outRow = 0;
+    RefRowsSliceIter iter(rownrs);
+    while (!iter.pastEnd()) {
+      uInt rownr = iter.sRow();
+      uInt erow  = iter.eRow();
+      uInt incr  = iter.incr();
+      while (rownr <= erow) {
+        uInt nrow = 1;
+        if (incr == 1) {
+          nrow = std::min (erow-rownr+1, nrbl - rownr%nrbl);
+        }
+        IPosition bufShape(cellShape);
+        bufShape.append (IPosition(1, nrow));
+        buf.resize (bufShape);
+        Bool deleteIt;
+        T* data = buf.getStorage (deleteIt);
+        readRows (rownr, nrow, data);
+        buf.putStorage (data, deleteIt);
+        trc[ndim]    = nrow-1;
+        outBlc[ndim] = outRow;
+        outTrc[ndim] = outRow + nrow-1;
+        (*dataPtr)(outBlc, outTrc) = buf(blc, trc, inc);
+        outRow += nrow;
+        rownr  += nrow * incr;
+      }
+      iter++;
+    }
+  }
 
   Ant1Column::~Ant1Column()
   {}
@@ -243,6 +327,45 @@ namespace LOFAR {
     itsParent->putData (rownr, data);
     dataPtr->freeStorage (data, deleteIt);
   }
+  Bool DataColumn::canAccessArrayColumn (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  Bool DataColumn::canAccessArrayColumnCells (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  Bool DataColumn::canAccessColumnSlice (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  void DataColumn::getArrayColumnComplexV (Array<Complex>* dataPtr)
+  {
+    getCells (RefRows(0, itsParent->getNRow()-1), dataPtr);
+  }
+  void DataColumn::getArrayColumnCellsComplexV (const RefRows& rownrs,
+                                                Array<Complex>* dataPtr)
+  {
+    getCells (rownrs, dataPtr);
+  }
+  void DataColumn::getColumnSliceComplexV (const Slicer& slicer,
+                                           Array<Complex>* dataPtr)
+  {
+    getSliceCells (RefRows(0, itsParent->getNRow()-1), slicer, dataPtr);
+  }
+  void DataColumn::getColumnSliceCellsComplexV (const RefRows& rownrs,
+                                                const Slicer& slicer,
+                                                Array<Complex>* dataPtr)
+  {
+    getSliceCells (rownrs, slicer, dataPtr);
+  }
+  void DataColumn::readRows (uInt rownr, uInt nrow, void* buf)
+  {
+    itsParent->getData (rownr, nrow, static_cast<Complex*>(buf));
+  }
 
   FlagColumn::~FlagColumn()
   {}
@@ -360,6 +483,56 @@ namespace LOFAR {
     }
   }
 
+  Bool FlagColumn::canAccessArrayColumn (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  Bool FlagColumn::canAccessArrayColumnCells (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  Bool FlagColumn::canAccessColumnSlice (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  void FlagColumn::getArrayColumnBoolV (Array<Bool>* dataPtr)
+  {
+    getCells (RefRows(0, itsParent->getNRow()-1), dataPtr);
+  }
+  void FlagColumn::getArrayColumnCellsBoolV (const RefRows& rownrs,
+                                             Array<Bool>* dataPtr)
+  {
+    getCells (rownrs, dataPtr);
+  }
+  void FlagColumn::getColumnSliceBoolV (const Slicer& slicer,
+                                        Array<Bool>* dataPtr)
+  {
+    getSliceCells (RefRows(0, itsParent->getNRow()-1), slicer, dataPtr);
+  }
+  void FlagColumn::getColumnSliceCellsBoolV (const RefRows& rownrs,
+                                             const Slicer& slicer,
+                                             Array<Bool>* dataPtr)
+  {
+    getSliceCells (rownrs, slicer, dataPtr);
+  }
+  void FlagColumn::readRows (uInt rownr, uInt nrow, void* buf)
+  {
+    uInt npol   = itsParent->npol();
+    uInt nsamp  = nrow * itsParent->nchan();
+    itsNSample.resize (nsamp, False, False);
+    itsParent->getNSample (rownr, nrow, itsNSample.storage());
+    Bool* flags = static_cast<Bool*>(buf);
+    for (uInt i=0; i<nsamp; ++i) {
+      Bool flagged = (itsNSample[i] == 0);
+      for (uInt j=0; j<npol; ++j) {
+        *flags++ = flagged;
+      }
+    }
+  }
+
 
   WeightColumn::~WeightColumn()
   {}
@@ -371,6 +544,24 @@ namespace LOFAR {
   {
     *dataPtr = float(1);
   }
+  Bool WeightColumn::canAccessArrayColumn (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  Bool WeightColumn::canAccessArrayColumnCells (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  void WeightColumn::getArrayColumnfloatV (Array<Float>* dataPtr)
+  {
+    *dataPtr = float(1);
+  }
+  void WeightColumn::getArrayColumnCellsfloatV (const RefRows&, Array<Float>* dataPtr)
+  {
+    *dataPtr = float(1);
+  }
 
   SigmaColumn::~SigmaColumn()
   {}
@@ -382,6 +573,24 @@ namespace LOFAR {
   {
     *dataPtr = float(1);
   }
+  Bool SigmaColumn::canAccessArrayColumn (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  Bool SigmaColumn::canAccessArrayColumnCells (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  void SigmaColumn::getArrayColumnfloatV (Array<Float>* dataPtr)
+  {
+    *dataPtr = float(1);
+  }
+  void SigmaColumn::getArrayColumnCellsfloatV (const RefRows&, Array<Float>* dataPtr)
+  {
+    *dataPtr = float(1);
+  }
 
   WSpectrumColumn::~WSpectrumColumn()
   {}
@@ -500,6 +709,56 @@ namespace LOFAR {
       throw;
     }
   }
+  Bool WSpectrumColumn::canAccessArrayColumn (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  Bool WSpectrumColumn::canAccessArrayColumnCells (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  Bool WSpectrumColumn::canAccessColumnSlice (Bool& reask) const
+  {
+    reask = False;
+    return True;
+  }
+  void WSpectrumColumn::getArrayColumnfloatV (Array<Float>* dataPtr)
+  {
+    getCells (RefRows(0, itsParent->getNRow()-1), dataPtr);
+  }
+  void WSpectrumColumn::getArrayColumnCellsfloatV (const RefRows& rownrs,
+                                                   Array<Float>* dataPtr)
+  {
+    getCells (rownrs, dataPtr);
+  }
+  void WSpectrumColumn::getColumnSlicefloatV (const Slicer& slicer,
+                                              Array<Float>* dataPtr)
+  {
+    getSliceCells (RefRows(0, itsParent->getNRow()-1), slicer, dataPtr);
+  }
+  void WSpectrumColumn::getColumnSliceCellsfloatV (const RefRows& rownrs,
+                                                   const Slicer& slicer,
+                                                   Array<Float>* dataPtr)
+  {
+    getSliceCells (rownrs, slicer, dataPtr);
+  }
+  void WSpectrumColumn::readRows (uInt rownr, uInt nrow, void* buf)
+  {
+    double maxn = itsParent->maxnSample();
+    uInt npol   = itsParent->npol();
+    uInt nsamp  = nrow * itsParent->nchan();
+    itsNSample.resize (nsamp, False, False);
+    itsParent->getNSample (rownr, nrow, itsNSample.storage());
+    Float* weights = static_cast<Float*>(buf);
+    for (uInt i=0; i<nsamp; ++i) {
+      Float weight = itsNSample[i] / maxn;
+      for (uInt j=0; j<npol; ++j) {
+        *weights++ = weight;
+      }
+    }
+  }
 
   FlagCatColumn::~FlagCatColumn()
   {}
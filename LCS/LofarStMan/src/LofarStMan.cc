@@ -31,6 +31,8 @@
 #include <casa/OS/DOos.h>
 #include <casa/Utilities/Assert.h>
 #include <casa/iostream.h>
+#include <algorithm>
+#include <fcntl.h>
 
 using namespace casa;
 
@@ -236,6 +238,13 @@ void LofarStMan::openFiles (bool writable)
   if (int64(itsBuffer.size()) < itsBLDataSize) {
     itsBuffer.resize (itsBLDataSize);
   }
+  // Read ahead about 32 MB when the time slots are accessed sequentially.
+  itsLastBlock   = -1;
+  itsPrefetchEnd = 0;
+  itsNrPrefetch  = std::max (int64(2), (int64(32)<<20) / itsBlockSize);
+#if defined(POSIX_FADV_SEQUENTIAL)
+  posix_fadvise (itsFD, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
   itsSpec.define ("useSeqnrFile", itsSeqFile!=0);
 }
 
@@ -396,25 +405,41 @@ Double LofarStMan::time (uInt blocknr)
 
 void LofarStMan::getData (uInt rownr, Complex* buf)
 {
-  uInt blocknr = rownr / itsAnt1.size();
-  uInt baseline = rownr - blocknr*itsAnt1.size();
-  uInt offset  = itsDataStart + baseline * itsBLDataSize;
-  const void* ptr = getReadPointer (blocknr, offset, itsBLDataSize);
+  getData (rownr, 1, buf);
+}
+
+void LofarStMan::getData (uInt rownr, uInt nrow, Complex* buf)
+{
+  uInt nrbl = itsAnt1.size();
+  while (nrow > 0) {
+    // Read the rows in this time slot directly into the buffer.
+    uInt blocknr  = rownr / nrbl;
+    uInt baseline = rownr - blocknr*nrbl;
+    uInt n = std::min (nrow, nrbl - baseline);
+    int64 size = n * itsBLDataSize;
+    readFile (blocknr, itsDataStart + baseline * itsBLDataSize, size, buf);
+    convertData (buf, size);
+    buf   += size / sizeof(Complex);
+    rownr += n;
+    nrow  -= n;
+  }
+}
+
+void LofarStMan::convertData (Complex* buf, int64 size) const
+{
   if (itsDoSwap) {
-    const char* from = (const char*)ptr;
-    char* to = (char*)buf;
-    const char* fromend = from + itsBLDataSize;
-    while (from < fromend) {
-      CanonicalConversion::reverse4 (to, from);
-      to += 4;
-      from += 4;
+    char* ptr = (char*)buf;
+    const char* end = ptr + size;
+    uInt val;
+    while (ptr < end) {
+      CanonicalConversion::reverse4 (&val, ptr);
+      memcpy (ptr, &val, 4);
+      ptr += 4;
     }
-  } else {
-    memcpy (buf, ptr, itsBLDataSize);
   }
   if (itsVersion < 3) {
     // The first RTCP versions generated conjugate data.
-    for (uint i=0; i<itsBLDataSize/sizeof(Complex); ++i) {
+    for (int64 i=0; i<size/int64(sizeof(Complex)); ++i) {
       buf[i] = conj(buf[i]);
     }
   }
@@ -526,15 +551,106 @@ const uInt* LofarStMan::getNSample4 (uInt rownr, Bool)
   return to;
 }
 
+void LofarStMan::getNSample (uInt rownr, uInt nrow, uInt* buf)
+{
+  uInt nrbl = itsAnt1.size();
+  uInt nbytes = itsNChan * itsNrBytesPerNrValidSamples;
+  while (nrow > 0) {
+    uInt blocknr  = rownr / nrbl;
+    uInt baseline = rownr - blocknr*nrbl;
+    uInt n = std::min (nrow, nrbl - baseline);
+    uInt nsamp = n * itsNChan;
+    if (itsBuffer.size() < n*nbytes) {
+      itsBuffer.resize (n*nbytes);
+    }
+    const void* ptr = getReadPointer (blocknr,
+                                      itsSampStart + baseline*nbytes,
+                                      n*nbytes);
+    switch (itsNrBytesPerNrValidSamples) {
+    case 1:
+    {
+      const uChar* from = (const uChar*)ptr;
+      for (uInt i=0; i<nsamp; ++i) {
+        buf[i] = from[i];
+      }
+    } break;
+    case 2:
+    {
+      const uShort* from = (const uShort*)ptr;
+      if (!itsDoSwap) {
+        for (uInt i=0; i<nsamp; ++i) {
+          buf[i] = from[i];
+        }
+      } else {
+        uShort val;
+        for (uInt i=0; i<nsamp; ++i) {
+          CanonicalConversion::reverse2 (&val, from+i);
+          buf[i] = val;
+        }
+      }
+    } break;
+    case 4:
+    {
+      const uInt* from = (const uInt*)ptr;
+      if (!itsDoSwap) {
+        memcpy (buf, from, nsamp*sizeof(uInt));
+      } else {
+        for (uInt i=0; i<nsamp; ++i) {
+          CanonicalConversion::reverse4 (buf+i, from+i);
+        }
+      }
+    } break;
+    }
+    for (uInt i=0; i<nsamp; ++i) {
+      if (buf[i] > itsMaxNrSample) {
+        buf[i] = 0;
+      }
+    }
+    buf   += nsamp;
+    rownr += n;
+    nrow  -= n;
+  }
+}
+
 
 void* LofarStMan::readFile (uInt blocknr, uInt offset, uInt size)
 {
   AlwaysAssert (size <= itsBuffer.size(), AipsError);
+  prefetch (blocknr);
   itsRegFile->seek (blocknr*itsBlockSize + offset);
   itsRegFile->read (size, itsBuffer.storage());
   return itsBuffer.storage();
 }
 
+void LofarStMan::readFile (uInt blocknr, uInt offset, int64 size, void* buf)
+{
+  prefetch (blocknr);
+  itsRegFile->seek (blocknr*itsBlockSize + offset);
+  itsRegFile->read (size, buf);
+}
+
+void LofarStMan::prefetch (uInt blocknr)
+{
+  if (blocknr == itsLastBlock) {
+    return;
+  }
+  if (blocknr != itsLastBlock+1) {
+    // Random access; do not read ahead.
+    itsPrefetchEnd = blocknr + 1;
+  } else if (blocknr + itsNrPrefetch/2 >= itsPrefetchEnd) {
+    // Sequential access; advise the next time slots once half of the
+    // previous advice has been consumed.
+    int64 start = std::max (itsPrefetchEnd, int64(blocknr) + 1);
+    int64 end   = blocknr + 1 + itsNrPrefetch;
+#if defined(POSIX_FADV_WILLNEED)
+    posix_fadvise (itsFD, start*itsBlockSize, (end-start)*itsBlockSize,
+                   POSIX_FADV_WILLNEED);
+#endif
+    itsPrefetchEnd = end;
+  }
+  itsLastBlock = blocknr;
+}
+
 void* LofarStMan::getBuffer (uInt size)
 {
   AlwaysAssert (size <= itsBuffer.size(), AipsError);
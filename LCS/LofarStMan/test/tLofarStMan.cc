@@ -48,9 +48,12 @@
 #include <casa/IO/RawIO.h>
 #include <casa/IO/CanonicalIO.h>
 #include <casa/OS/HostInfo.h>
+#include <casa/OS/Timer.h>
 #include <casa/Exceptions/Error.h>
 #include <casa/iostream.h>
 #include <casa/sstream.h>
+#include <algorithm>
+#include <cstdlib>
 
 using namespace LOFAR;
 using namespace casa;
@@ -521,6 +524,102 @@ void readTable (uInt nseq, uInt nant, uInt nchan, uInt npol,
   Array<float> wg = wspecCol.getColumnCells (rownrs);
 }
 
+template<typename T>
+void checkBulkColumn (const ROArrayColumn<T>& col, uInt nbasel)
+{
+  uInt nrow = col.nrow();
+  // Get the entire column and check it against the individual rows.
+  Array<T> all = col.getColumn();
+  IPosition cellShape = col.shape(0);
+  uInt nd = cellShape.size();
+  IPosition blc(nd+1, 0);
+  IPosition trc(cellShape);
+  trc.append (IPosition(1, 0));
+  trc -= 1;
+  for (uInt row=0; row<nrow; ++row) {
+    blc[nd] = trc[nd] = row;
+    AlwaysAssertExit (allEQ (all(blc,trc).reform(cellShape), col(row)));
+  }
+  // Get a range of rows spanning a time slot boundary.
+  uInt strow = nbasel/2;
+  uInt nr = std::min (nbasel, nrow-strow);
+  Array<T> range = col.getColumnRange (Slicer(IPosition(1,strow),
+                                              IPosition(1,nr)));
+  blc[nd] = strow;
+  trc[nd] = strow + nr - 1;
+  AlwaysAssertExit (allEQ (range, all(blc,trc)));
+  // Get every third row, which are not consecutive.
+  RefRows strided(1, nrow-1, 3);
+  Array<T> cells = col.getColumnCells (strided);
+  AlwaysAssertExit (cells.shape()[nd] == Int((nrow-2)/3 + 1));
+  for (uInt i=0; i<(nrow-2)/3 + 1; ++i) {
+    blc[nd] = trc[nd] = 1 + 3*i;
+    IPosition cblc(nd+1, 0);
+    IPosition ctrc(cells.shape() - 1);
+    cblc[nd] = ctrc[nd] = i;
+    AlwaysAssertExit (allEQ (cells(cblc,ctrc), all(blc,trc)));
+  }
+  // Get a slice (the last polarization and every other channel).
+  IPosition sblc(2, cellShape[0]-1, 0);
+  IPosition strc(2, cellShape[0]-1, cellShape[1]-1);
+  IPosition sinc(2, 1, 2);
+  Array<T> slice = col.getColumn (Slicer(sblc, strc, sinc,
+                                         Slicer::endIsLast));
+  sblc.append (IPosition(1, 0));
+  strc.append (IPosition(1, nrow-1));
+  sinc.append (IPosition(1, 1));
+  AlwaysAssertExit (allEQ (slice, all(sblc,strc,sinc)));
+}
+
+void checkBulk (uInt nbasel)
+{
+  // Check that bulk access gives the same results as access per row.
+  Table tab("tLofarStMan_tmp.data");
+  checkBulkColumn (ROArrayColumn<Complex>(tab, "DATA"), nbasel);
+  checkBulkColumn (ROArrayColumn<Bool>(tab, "FLAG"), nbasel);
+  checkBulkColumn (ROArrayColumn<Float>(tab, "WEIGHT_SPECTRUM"), nbasel);
+  AlwaysAssertExit (allEQ (ROArrayColumn<Float>(tab, "WEIGHT").getColumn(),
+                           Float(1)));
+  AlwaysAssertExit (allEQ (ROArrayColumn<Float>(tab, "SIGMA").getColumn(),
+                           Float(1)));
+}
+
+void readPerf (uInt nbasel)
+{
+  // Compare the read throughput of access per row with access per time slot.
+  Table tab("tLofarStMan_tmp.data");
+  uInt nrow = tab.nrow();
+  ROArrayColumn<Complex> dataCol(tab, "DATA");
+  ROArrayColumn<Bool> flagCol(tab, "FLAG");
+  ROArrayColumn<Float> wspecCol(tab, "WEIGHT_SPECTRUM");
+  double nbytes = double(nrow) * dataCol.shape(0).product() * sizeof(Complex);
+  Array<Complex> data;
+  Array<Bool> flags;
+  Array<Float> weights;
+  Timer timer;
+  for (uInt row=0; row<nrow; ++row) {
+    dataCol.get (row, data, True);
+    flagCol.get (row, flags, True);
+    wspecCol.get (row, weights, True);
+  }
+  double perRow = timer.real();
+  timer.mark();
+  for (uInt row=0; row<nrow; row+=nbasel) {
+    Slicer rows(IPosition(1,row), IPosition(1,std::min(nbasel, nrow-row)));
+    dataCol.getColumnRange (rows, data, True);
+    flagCol.getColumnRange (rows, flags, True);
+    wspecCol.getColumnRange (rows, weights, True);
+  }
+  double perSlot = timer.real();
+  // Only print timings if explicitly asked, so the output is reproducible.
+  if (getenv("TLOFARSTMAN_PERF")) {
+    cout << "readPerf: per row  " << nbytes/1e6/std::max(perRow, 1e-6)
+         << " MB/s" << endl;
+    cout << "readPerf: per slot " << nbytes/1e6/std::max(perSlot, 1e-6)
+         << " MB/s" << endl;
+  }
+}
+
 void updateTable (uInt nchan, uInt npol, const Complex& startValue)
 {
   // Open the table for write.
@@ -600,6 +699,7 @@ int main (int argc, char* argv[])
                     Complex(0.1, 0.1), 512, True, v, nbytesPerSample[v], v%2==0);
         readTable (nseq, nant, nchan, npol, startTime, interval,
                    Complex(0.1, 0.1), maxWeight[v]);
+        checkBulk (nant*nant);
         // Update the table and check again.
         updateTable (nchan, npol, Complex(-3.52, -20.3));
         readTable (nseq, nant, nchan, npol, startTime, interval,
@@ -613,6 +713,8 @@ int main (int argc, char* argv[])
         updateTable (nchan, npol, Complex(3.52, 20.3));
         readTable (nseq, nant, nchan, npol, startTime, interval,
                    Complex(3.52, 20.3), maxWeight[v]);
+        checkBulk (nant*nant);
+        readPerf (nant*nant);
         copyTable();
       }
     }
@@ -0,0 +1,105 @@
+//# SharedMemoryRingStream.h: Stream through a ring buffer in POSIX shared memory
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_LCS_STREAM_SHARED_MEMORY_RING_STREAM_H
+#define LOFAR_LCS_STREAM_SHARED_MEMORY_RING_STREAM_H
+
+#include <Stream/Stream.h>
+
+#include <string>
+
+
+namespace LOFAR {
+
+// A stream between processes on the same node, which passes the data
+// through two ring buffers (one per direction) in POSIX shared memory.
+//
+// Like NamedPipeStream, both sides open the same name; the server side
+// reads what the client side writes, and vice versa. The shared memory
+// objects are called "/NAME-0" and "/NAME-1"; the side that reads from
+// an object removes it when the stream is destroyed. Both sides must use
+// the same capacity, which is rounded up to a multiple of the page size.
+//
+// Data written before the reading side opened the stream are only kept
+// while the writing side is there: if the writing side is destroyed or
+// dies first, it removes the object (or the reading side replaces it).
+// An object that an earlier session with the same name left behind is
+// replaced as well, so a new session never sees its data.
+//
+// Each ring buffer is mapped twice at consecutive addresses, so every
+// block of at most capacity() bytes is contiguous in memory. Besides the
+// (copying) Stream interface, this allows to produce and consume the data
+// in place:
+//
+//   void *buf = stream.acquireWriteBuffer(size); // wait for free space
+//   ... fill buf ...
+//   stream.commitWriteBuffer(size);              // pass it to the reader
+//
+//   const void *buf = stream.acquireReadBuffer(size); // wait for data
+//   ... use buf ...
+//   stream.commitReadBuffer(size);                    // release the space
+//
+// A waiting side sleeps on a futex in the shared memory, which the other
+// side only wakes up if there is a sleeper, so a busy stream does no
+// system calls at all.
+//
+// If the writing side is destroyed, the reading side gets the remaining
+// data and then an EndOfStreamException. Writing to a stream whose
+// reading side is destroyed throws an EndOfStreamException as well.
+// A side that waits checks every second whether the process on the other
+// side still exists, so this also happens (after at most a second) if that
+// process dies. Both processes must see the same process ids.
+class SharedMemoryRingStream : public Stream
+{
+  public:
+    static const size_t defaultCapacity = 16 * 1024 * 1024;
+
+		   SharedMemoryRingStream(const std::string &name, bool serverSide, size_t capacity = defaultCapacity);
+    virtual	   ~SharedMemoryRingStream();
+
+    virtual size_t tryRead(void *ptr, size_t size);
+    virtual size_t tryWrite(const void *ptr, size_t size);
+
+    // Wait until `size' bytes can be written, and return a pointer to them.
+    void	   *acquireWriteBuffer(size_t size);
+
+    // Pass the first `size' bytes of the acquired buffer to the reader.
+    void	   commitWriteBuffer(size_t size);
+
+    // Wait until `size' bytes can be read, and return a pointer to them.
+    // Throws EndOfStreamException if the writer has gone and less than
+    // `size' bytes are left.
+    const void	   *acquireReadBuffer(size_t size);
+
+    // Release the first `size' bytes of the acquired buffer.
+    void	   commitReadBuffer(size_t size);
+
+    // The size of each ring buffer in bytes.
+    size_t	   capacity() const;
+
+  private:
+    class Ring;
+
+    Ring	   *itsReadRing, *itsWriteRing;
+};
+
+} // namespace LOFAR
+
+#endif
@@ -0,0 +1,591 @@
+//# SharedMemoryRingStream.cc: Stream through a ring buffer in POSIX shared memory
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <Stream/SharedMemoryRingStream.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <Common/SystemCallException.h>
+#include <Common/Thread/Cancellation.h>
+#include <Common/LofarLogger.h>
+
+#include <boost/lexical_cast.hpp>
+
+
+namespace LOFAR {
+
+const size_t SharedMemoryRingStream::defaultCapacity;
+
+
+namespace {
+
+// The control block at the start of each shared memory object. It is
+// zero-initialised by ftruncate(), which is a valid empty state. The
+// fields written by the writer and by the reader are on separate cache
+// lines.
+struct Control
+{
+  uint64_t capacity;      // set by the first side opening the object
+  char     pad0[56];
+
+  uint64_t head;          // total nr of bytes committed by the writer
+  uint32_t headFutex;     // incremented when head changes or writer closes
+  uint32_t readerWaiting;
+  uint32_t writerClosed;
+  int32_t  writerPid;     // set when the writer attaches, see Ring::attach()
+  char     pad1[40];
+
+  uint64_t tail;          // total nr of bytes committed by the reader
+  uint32_t tailFutex;     // incremented when tail changes or reader closes
+  uint32_t writerWaiting;
+  uint32_t readerClosed;
+  int32_t  readerPid;     // set when the reader attaches, see Ring::attach()
+  char     pad2[40];
+};
+
+
+// Value of writerPid or readerPid if that side will never attach, because
+// the other side closed before it came.
+const int32_t abandoned = -1;
+
+
+template <typename T> inline T load(const T &var)
+{
+  return __atomic_load_n(&var, __ATOMIC_SEQ_CST);
+}
+
+
+template <typename T> inline void store(T &var, T value)
+{
+  __atomic_store_n(&var, value, __ATOMIC_SEQ_CST);
+}
+
+
+// Returns whether the wait timed out.
+bool futexWait(uint32_t *futex, uint32_t value)
+{
+  bool timedOut;
+
+#ifdef __linux__
+  // Wake up once in a while to allow the thread to be cancelled, and to
+  // check whether the other side is still there.
+  struct timespec timeout = { 1, 0 };
+
+  if (syscall(SYS_futex, futex, FUTEX_WAIT, value, &timeout, 0, 0) == 0) {
+    timedOut = false;
+  } else if (errno == EAGAIN || errno == EINTR || errno == ETIMEDOUT) {
+    timedOut = errno == ETIMEDOUT;
+  } else {
+    THROW_SYSCALL("futex wait");
+  }
+#else
+  (void)futex; (void)value;
+  usleep(100);
+  timedOut = true;
+#endif
+
+  Cancellation::point();
+  return timedOut;
+}
+
+
+// Whether the process `pid' has died. A zombie has died too: the other side
+// may well be its parent.
+bool died(int32_t pid)
+{
+  if (pid <= 0)
+    return false;
+
+  if (kill(pid, 0) < 0 && errno == ESRCH)
+    return true;
+
+#ifdef __linux__
+  // The state follows the command name in parentheses, which can contain
+  // anything.
+  std::ifstream stat(("/proc/" + boost::lexical_cast<std::string>(pid) + "/stat").c_str());
+  std::string line;
+
+  if (getline(stat, line)) {
+    std::string::size_type pos = line.rfind(')');
+
+    if (pos != std::string::npos && pos + 2 < line.size())
+      return line[pos + 2] == 'Z' || line[pos + 2] == 'X';
+  }
+#endif
+
+  return false;
+}
+
+
+void futexWake(uint32_t *futex)
+{
+#ifdef __linux__
+  if (syscall(SYS_futex, futex, FUTEX_WAKE, INT_MAX, 0, 0, 0) < 0)
+    THROW_SYSCALL("futex wake");
+#else
+  (void)futex;
+#endif
+}
+
+} // namespace
+
+
+// One direction of the stream: a single-producer/single-consumer ring
+// buffer in a POSIX shared memory object.
+class SharedMemoryRingStream::Ring
+{
+  public:
+    Ring(const std::string &name, size_t capacity, bool readSide);
+    ~Ring();
+
+    // Wait until at least `minSize' bytes can be written, and return the
+    // nr of free bytes.
+    size_t waitForSpace(size_t minSize);
+
+    // Wait until at least `minSize' bytes can be read, and return the
+    // nr of available bytes (which is less than minSize only at the end
+    // of the stream).
+    size_t waitForData(size_t minSize);
+
+    char   *writePtr() { return data + control->head % capacity; }
+    char   *readPtr()  { return data + control->tail % capacity; }
+
+    void   commitWrite(size_t size);
+    void   commitRead(size_t size);
+
+    const size_t capacity;
+
+  private:
+    // Take our side of the object. Returns false if the object was left
+    // behind by an earlier session, which is the case if our side was
+    // taken or abandoned before, or if the other side died before we came.
+    bool   attach();
+
+    // Remove the object, unless its name already refers to a new object.
+    void   removeObject();
+
+    // Sleep on `futex' until `ready' holds, announcing it in `waiting'.
+    template <typename Pred> void wait(uint32_t &futex, uint32_t &waiting, Pred ready);
+
+    // If the process on the other side died without closing, close its
+    // side for it.
+    void   checkPeer();
+
+    const std::string name;
+    const bool   readSide;
+    const size_t pageSize;
+    int          fd;
+    Control      *control;
+    char         *data;     // capacity bytes, mapped twice
+};
+
+
+namespace {
+
+size_t roundUp(size_t size, size_t multiple)
+{
+  return (size + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+
+SharedMemoryRingStream::Ring::Ring(const std::string &name, size_t capacity, bool readSide)
+:
+  capacity(roundUp(std::max(capacity, (size_t) 1), sysconf(_SC_PAGESIZE))),
+  name(name),
+  readSide(readSide),
+  pageSize(sysconf(_SC_PAGESIZE)),
+  fd(-1),
+  control(static_cast<Control *>(MAP_FAILED)),
+  data(static_cast<char *>(MAP_FAILED))
+{
+  try {
+    const off_t size = pageSize + this->capacity;
+    struct stat st;
+
+    for (;;) {
+      if ((fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600)) < 0)
+        THROW_SYSCALL(std::string("shm_open ") + name);
+
+      // The first side to open the object sets its size.
+      if (fstat(fd, &st) < 0)
+        THROW_SYSCALL(std::string("fstat ") + name);
+
+      if (st.st_size == 0) {
+        if (ftruncate(fd, size) < 0)
+          THROW_SYSCALL(std::string("ftruncate ") + name);
+
+        st.st_size = size;
+      } else if (st.st_size < (off_t) pageSize) {
+        THROW(Exception, "shm:" << name << " has size " << st.st_size << " instead of " << size);
+      }
+
+      control = static_cast<Control *>(mmap(0, pageSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+
+      if (control == MAP_FAILED)
+        THROW_SYSCALL("mmap");
+
+      if (attach())
+        break;
+
+      // Replace the object of the earlier session by a new one. If the
+      // other side found it as well, only the first of us removes it.
+      LOG_WARN_STR("shm:" << name << ": replacing an object left behind by an earlier session");
+      removeObject();
+
+      munmap(control, pageSize);
+      control = static_cast<Control *>(MAP_FAILED);
+      close(fd);
+      fd = -1;
+    }
+
+    if (st.st_size != size)
+      THROW(Exception, "shm:" << name << " has size " << st.st_size << " instead of " << size);
+
+    // Reserve twice the capacity, and map the buffer into both halves, so
+    // that a block wrapping around the end of the buffer is contiguous.
+    data = static_cast<char *>(mmap(0, 2 * this->capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+
+    if (data == MAP_FAILED)
+      THROW_SYSCALL("mmap");
+
+    for (size_t half = 0; half < 2; half ++)
+      if (mmap(data + half * this->capacity, this->capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, pageSize) == MAP_FAILED)
+        THROW_SYSCALL("mmap");
+
+    uint64_t expected = 0;
+
+    if (!__atomic_compare_exchange_n(&control->capacity, &expected, (uint64_t) this->capacity, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) && expected != this->capacity)
+      THROW(Exception, "shm:" << name << " has capacity " << expected << " instead of " << this->capacity);
+  } catch (...) {
+    if (data != MAP_FAILED)
+      munmap(data, 2 * this->capacity);
+
+    if (control != MAP_FAILED)
+      munmap(control, pageSize);
+
+    if (fd >= 0)
+      close(fd);
+
+    throw;
+  }
+}
+
+
+SharedMemoryRingStream::Ring::~Ring()
+{
+  // Tell the other side that we are gone. If it did not attach yet, it
+  // never will: it will find the object abandoned and replace it.
+  int32_t notAttached = 0;
+  bool    peerAttached;
+
+  if (readSide) {
+    store(control->readerClosed, (uint32_t) 1);
+    __atomic_add_fetch(&control->tailFutex, 1, __ATOMIC_SEQ_CST);
+    futexWake(&control->tailFutex);
+
+    peerAttached = !__atomic_compare_exchange_n(&control->writerPid, &notAttached, abandoned, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  } else {
+    store(control->writerClosed, (uint32_t) 1);
+    __atomic_add_fetch(&control->headFutex, 1, __ATOMIC_SEQ_CST);
+    futexWake(&control->headFutex);
+
+    peerAttached = !__atomic_compare_exchange_n(&control->readerPid, &notAttached, abandoned, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  }
+
+  munmap(data, 2 * capacity);
+  munmap(control, pageSize);
+
+  ScopedDelayCancellation dc; // shm_open and close are cancellation points
+
+  // The reader removes the object, so the writer can go away before
+  // all data are read. If no reader attached, the data will never be
+  // read, and the writer removes the object.
+  if (readSide || !peerAttached)
+    removeObject();
+
+  close(fd);
+}
+
+
+bool SharedMemoryRingStream::Ring::attach()
+{
+  int32_t &ownPid  = readSide ? control->readerPid : control->writerPid;
+  int32_t &peerPid = readSide ? control->writerPid : control->readerPid;
+  int32_t notAttached = 0;
+
+  return __atomic_compare_exchange_n(&ownPid, &notAttached, (int32_t) getpid(), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) &&
+         !died(load(peerPid));
+}
+
+
+void SharedMemoryRingStream::Ring::removeObject()
+{
+  int current = shm_open(name.c_str(), O_RDONLY, 0);
+
+  if (current < 0)
+    return; // already removed
+
+  struct stat ours, theirs;
+  const bool same = fstat(fd, &ours) == 0 && fstat(current, &theirs) == 0 &&
+                    ours.st_dev == theirs.st_dev && ours.st_ino == theirs.st_ino;
+
+  close(current);
+
+  if (same)
+    shm_unlink(name.c_str());
+}
+
+
+template <typename Pred> void SharedMemoryRingStream::Ring::wait(uint32_t &futex, uint32_t &waiting, Pred ready)
+{
+  while (!ready()) {
+    uint32_t value = load(futex);
+
+    // Announce the sleep before checking again, so the other side either
+    // sees us waiting, or we see its update.
+    store(waiting, (uint32_t) 1);
+
+    if (!ready() && futexWait(&futex, value))
+      checkPeer();
+
+    store(waiting, (uint32_t) 0);
+  }
+}
+
+
+void SharedMemoryRingStream::Ring::checkPeer()
+{
+  if (readSide) {
+    if (!load(control->writerClosed) && died(load(control->writerPid))) {
+      LOG_WARN_STR("shm:" << name << ": writer (pid " << control->writerPid << ") died");
+      store(control->writerClosed, (uint32_t) 1);
+    }
+  } else {
+    if (!load(control->readerClosed) && died(load(control->readerPid))) {
+      LOG_WARN_STR("shm:" << name << ": reader (pid " << control->readerPid << ") died");
+      store(control->readerClosed, (uint32_t) 1);
+
+      // Remove the object in its place.
+      ScopedDelayCancellation dc;
+      removeObject();
+    }
+  }
+}
+
+
+namespace {
+
+struct HasSpace
+{
+  const Control &control;
+  const uint64_t needed;
+
+  HasSpace(const Control &control, uint64_t needed) : control(control), needed(needed) {}
+
+  bool operator () () const
+  {
+    return load(control.readerClosed) ||
+           control.head - load(control.tail) + needed <= control.capacity;
+  }
+};
+
+
+struct HasData
+{
+  const Control &control;
+  const uint64_t needed;
+
+  HasData(const Control &control, uint64_t needed) : control(control), needed(needed) {}
+
+  bool operator () () const
+  {
+    return load(control.writerClosed) ||
+           load(control.head) - control.tail >= needed;
+  }
+};
+
+} // namespace
+
+
+size_t SharedMemoryRingStream::Ring::waitForSpace(size_t minSize)
+{
+  ASSERTSTR(minSize <= capacity, "shm:" << name << ": cannot write " << minSize << " bytes at once into a ring of " << capacity << " bytes");
+
+  wait(control->tailFutex, control->writerWaiting, HasSpace(*control, minSize));
+
+  if (load(control->readerClosed))
+    throw EndOfStreamException("shm: reader has gone", THROW_ARGS);
+
+  return capacity - (control->head - load(control->tail));
+}
+
+
+size_t SharedMemoryRingStream::Ring::waitForData(size_t minSize)
+{
+  ASSERTSTR(minSize <= capacity, "shm:" << name << ": cannot read " << minSize << " bytes at once from a ring of " << capacity << " bytes");
+
+  wait(control->headFutex, control->readerWaiting, HasData(*control, minSize));
+
+  // Recheck the data after seeing the writer closed, as it might have
+  // written more before closing.
+  return load(control->head) - control->tail;
+}
+
+
+void SharedMemoryRingStream::Ring::commitWrite(size_t size)
+{
+  store(control->head, control->head + size);
+  __atomic_add_fetch(&control->headFutex, 1, __ATOMIC_SEQ_CST);
+
+  if (load(control->readerWaiting))
+    futexWake(&control->headFutex);
+}
+
+
+void SharedMemoryRingStream::Ring::commitRead(size_t size)
+{
+  store(control->tail, control->tail + size);
+  __atomic_add_fetch(&control->tailFutex, 1, __ATOMIC_SEQ_CST);
+
+  if (load(control->writerWaiting))
+    futexWake(&control->tailFutex);
+}
+
+
+namespace {
+
+std::string objectName(const std::string &name, bool serverSide, bool readSide)
+{
+  // POSIX shared memory names start with, and contain no other, slash.
+  std::string objName = "/" + name + ((serverSide == readSide) ? "-0" : "-1");
+
+  std::replace(objName.begin() + 1, objName.end(), '/', '_');
+  return objName;
+}
+
+} // namespace
+
+
+SharedMemoryRingStream::SharedMemoryRingStream(const std::string &name, bool serverSide, size_t capacity)
+:
+  itsReadRing(0),
+  itsWriteRing(0)
+{
+  try {
+    itsReadRing  = new Ring(objectName(name, serverSide, true), capacity, true);
+    itsWriteRing = new Ring(objectName(name, serverSide, false), capacity, false);
+  } catch (...) {
+    delete itsReadRing;
+    throw;
+  }
+}
+
+
+SharedMemoryRingStream::~SharedMemoryRingStream()
+{
+  delete itsReadRing;
+  delete itsWriteRing;
+}
+
+
+size_t SharedMemoryRingStream::capacity() const
+{
+  return itsReadRing->capacity;
+}
+
+
+size_t SharedMemoryRingStream::tryRead(void *ptr, size_t size)
+{
+  if (size == 0)
+    return 0;
+
+  size_t bytes = std::min(size, itsReadRing->waitForData(1));
+
+  if (bytes == 0)
+    throw EndOfStreamException("shm: writer has gone", THROW_ARGS);
+
+  memcpy(ptr, itsReadRing->readPtr(), bytes);
+  itsReadRing->commitRead(bytes);
+  return bytes;
+}
+
+
+size_t SharedMemoryRingStream::tryWrite(const void *ptr, size_t size)
+{
+  if (size == 0)
+    return 0;
+
+  size_t bytes = std::min(size, itsWriteRing->waitForSpace(1));
+
+  memcpy(itsWriteRing->writePtr(), ptr, bytes);
+  itsWriteRing->commitWrite(bytes);
+  return bytes;
+}
+
+
+void *SharedMemoryRingStream::acquireWriteBuffer(size_t size)
+{
+  itsWriteRing->waitForSpace(size);
+  return itsWriteRing->writePtr();
+}
+
+
+void SharedMemoryRingStream::commitWriteBuffer(size_t size)
+{
+  itsWriteRing->commitWrite(size);
+}
+
+
+const void *SharedMemoryRingStream::acquireReadBuffer(size_t size)
+{
+  if (itsReadRing->waitForData(size) < size)
+    throw EndOfStreamException("shm: writer has gone", THROW_ARGS);
+
+  return itsReadRing->readPtr();
+}
+
+
+void SharedMemoryRingStream::commitReadBuffer(size_t size)
+{
+  itsReadRing->commitRead(size);
+}
+
+} // namespace LOFAR
@@ -34,6 +34,7 @@
 #include <Stream/SocketStream.h>
 #include <Stream/PortBroker.h>
 #include <Stream/NamedPipeStream.h>
+#include <Stream/SharedMemoryRingStream.h>
 
 namespace LOFAR
 {
@@ -70,6 +71,10 @@ namespace LOFAR
     else if (split.size() == 2 && split[0] == "pipe")
       return new NamedPipeStream(split[1].c_str(), asServer);
 
+    // shm:NAME[:CAPACITY]
+    else if ((split.size() == 2 || split.size() == 3) && split[0] == "shm")
+      return new SharedMemoryRingStream(split[1], asServer, split.size() > 2 ? boost::lexical_cast<size_t>(split[2]) : SharedMemoryRingStream::defaultCapacity);
+
     // HOST:PORT (udp)
     else if (split.size() == 2)
       return new SocketStream(split[0].c_str(), boost::lexical_cast<unsigned short>(split[1]), SocketStream::UDP, asServer ? SocketStream::Server : SocketStream::Client, deadline, true, "");
@@ -0,0 +1,314 @@
+//# tSharedMemoryRingStream.cc: test program for the SharedMemoryRingStream class
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+//# Always #include <lofar_config.h> first!
+#include <lofar_config.h>
+
+//# Includes
+#include <Stream/SharedMemoryRingStream.h>
+#include <Stream/StreamFactory.h>
+#include <Common/LofarLogger.h>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+using namespace LOFAR;
+using namespace std;
+
+const size_t capacity = 65536;
+const size_t nrBytes  = 3 * 1024 * 1024 + 17;
+const size_t nrBlocks = 100;
+const size_t blockSize = 24 * 1024; // wraps around the ring
+
+string name;
+
+char pattern(size_t i)
+{
+  return i * 7 + i / 251;
+}
+
+// Runs in a child process: write through the stream, check the replies,
+// and go away.
+void client()
+{
+  SharedMemoryRingStream s(name, false, capacity);
+
+  // Byte stream in odd chunks.
+  vector<char> buf(10007);
+
+  for (size_t done = 0; done < nrBytes; ) {
+    size_t size = min(buf.size(), nrBytes - done);
+
+    for (size_t i = 0; i < size; i++)
+      buf[i] = pattern(done + i);
+
+    s.write(&buf[0], size);
+    done += size;
+  }
+
+  // Blocks produced in place.
+  for (size_t b = 0; b < nrBlocks; b++) {
+    char *block = static_cast<char *>(s.acquireWriteBuffer(blockSize));
+
+    for (size_t i = 0; i < blockSize; i++)
+      block[i] = pattern(b * blockSize + i);
+
+    s.commitWriteBuffer(blockSize);
+  }
+
+  // The other direction.
+  size_t reply;
+  s.read(&reply, sizeof reply);
+  ASSERT(reply == nrBytes + nrBlocks * blockSize);
+
+  // Leave some data that the parent has to read after we are gone.
+  s.write("bye", 3);
+}
+
+void testByteStream(Stream &s)
+{
+  vector<char> buf(4093);
+
+  for (size_t done = 0; done < nrBytes; ) {
+    size_t size = s.tryRead(&buf[0], min(buf.size(), nrBytes - done));
+
+    for (size_t i = 0; i < size; i++)
+      ASSERTSTR(buf[i] == pattern(done + i), "Mismatch at byte " << done + i);
+
+    done += size;
+  }
+}
+
+void testZeroCopy(SharedMemoryRingStream &s)
+{
+  for (size_t b = 0; b < nrBlocks; b++) {
+    const char *block = static_cast<const char *>(s.acquireReadBuffer(blockSize));
+
+    for (size_t i = 0; i < blockSize; i++)
+      ASSERTSTR(block[i] == pattern(b * blockSize + i), "Mismatch in block " << b << " at byte " << i);
+
+    s.commitReadBuffer(blockSize);
+  }
+}
+
+void testEndOfStream(SharedMemoryRingStream &s)
+{
+  int status;
+  ASSERT(wait(&status) > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  // The remaining data can still be read once the writer has gone.
+  char bye[3];
+  s.read(bye, sizeof bye);
+  ASSERT(string(bye, 3) == "bye");
+
+  try {
+    s.read(bye, 1);
+    ASSERTSTR(false, "Expected EndOfStreamException");
+  } catch (EndOfStreamException &) {
+  }
+}
+
+void test(bool useFactory)
+{
+  name = "tSharedMemoryRingStream-" + boost::lexical_cast<string>(getpid());
+
+  pid_t pid = fork();
+  ASSERT(pid >= 0);
+
+  if (pid == 0) {
+    try {
+      client();
+    } catch (Exception &e) {
+      LOG_ERROR_STR(e);
+      _exit(1);
+    }
+    _exit(0);
+  }
+
+  boost::scoped_ptr<Stream> stream(useFactory ?
+    createStream("shm:" + name + ":" + boost::lexical_cast<string>(capacity), true) :
+    new SharedMemoryRingStream(name, true, capacity));
+  SharedMemoryRingStream &s = dynamic_cast<SharedMemoryRingStream &>(*stream);
+
+  ASSERT(s.capacity() == capacity);
+
+  testByteStream(s);
+  testZeroCopy(s);
+
+  size_t reply = nrBytes + nrBlocks * blockSize;
+  s.write(&reply, sizeof reply);
+
+  testEndOfStream(s);
+}
+
+// The child writes a few bytes, then dies without closing the stream. The
+// parent must not wait forever for it, neither to read nor to write.
+void testPeerDied()
+{
+  name = "tSharedMemoryRingStream-" + boost::lexical_cast<string>(getpid());
+
+  pid_t pid = fork();
+  ASSERT(pid >= 0);
+
+  if (pid == 0) {
+    SharedMemoryRingStream s(name, false, capacity);
+
+    s.write("abc", 3);
+
+    // Die only once the parent has opened the stream as well.
+    char x;
+    s.read(&x, 1);
+
+    kill(getpid(), SIGKILL);
+  }
+
+  SharedMemoryRingStream s(name, true, capacity);
+
+  s.write("x", 1);
+
+  // The data written before dying can be read; then the stream ends.
+  char abc[3];
+  s.read(abc, sizeof abc);
+  ASSERT(string(abc, 3) == "abc");
+
+  try {
+    s.read(abc, 1);
+    ASSERTSTR(false, "Expected EndOfStreamException");
+  } catch (EndOfStreamException &) {
+  }
+
+  // Fill the ring until the writer has to wait for the dead reader.
+  vector<char> buf(capacity + 1);
+
+  try {
+    s.write(&buf[0], buf.size());
+    ASSERTSTR(false, "Expected EndOfStreamException");
+  } catch (EndOfStreamException &) {
+  }
+
+  int status;
+  ASSERT(waitpid(pid, &status, 0) == pid && WIFSIGNALED(status));
+}
+
+// Whether any of the shared memory objects of the stream `name' exists.
+bool objectsExist()
+{
+  for (int i = 0; i < 2; i++) {
+    int fd = shm_open(("/" + name + "-" + boost::lexical_cast<string>(i)).c_str(), O_RDONLY, 0);
+
+    if (fd >= 0) {
+      close(fd);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// A new session must not see anything of an earlier one.
+void testNewSession()
+{
+  {
+    SharedMemoryRingStream server(name, true, capacity);
+    SharedMemoryRingStream client(name, false, capacity);
+
+    client.write("xyz", 3);
+    server.write("123", 3);
+
+    char buf[3];
+    server.read(buf, sizeof buf);
+    ASSERT(string(buf, 3) == "xyz");
+    client.read(buf, sizeof buf);
+    ASSERT(string(buf, 3) == "123");
+  }
+
+  ASSERT(!objectsExist());
+}
+
+// Sessions in which the client goes away before the server opened the
+// stream, after which the name is used again.
+void testAbandonedSession()
+{
+  name = "tSharedMemoryRingStream-" + boost::lexical_cast<string>(getpid());
+
+  // The client closes: its data will never be read, so it removes the
+  // objects.
+  {
+    SharedMemoryRingStream s(name, false, capacity);
+
+    s.write("abc", 3);
+  }
+
+  ASSERT(!objectsExist());
+  testNewSession();
+
+  // The client dies and leaves the objects behind. The new session
+  // replaces them.
+  pid_t pid = fork();
+  ASSERT(pid >= 0);
+
+  if (pid == 0) {
+    SharedMemoryRingStream s(name, false, capacity);
+
+    s.write("abc", 3);
+
+    kill(getpid(), SIGKILL);
+  }
+
+  int status;
+  ASSERT(waitpid(pid, &status, 0) == pid && WIFSIGNALED(status));
+  ASSERT(objectsExist());
+  testNewSession();
+}
+
+int main(int /*argc*/, const char* argv[])
+{
+  INIT_LOGGER(argv[0]);
+
+  try {
+    alarm(60);
+
+    LOG_INFO("Testing SharedMemoryRingStream...");
+    test(false);
+
+    LOG_INFO("Testing shm: descriptor...");
+    test(true);
+
+    LOG_INFO("Testing a peer that dies...");
+    testPeerDied();
+
+    LOG_INFO("Testing reuse of the name of an abandoned session...");
+    testAbandonedSession();
+
+  } catch (Exception& e) {
+    LOG_ERROR_STR(e);
+    return 1;
+  }
+  LOG_INFO("Program terminated successfully");
+  return 0;
+}
@@ -0,0 +1,161 @@
+//# tStreamPerf.cc: throughput and latency of process-to-process streams
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+//# Always #include <lofar_config.h> first!
+#include <lofar_config.h>
+
+//# Includes
+#include <Stream/StreamFactory.h>
+#include <Stream/SharedMemoryRingStream.h>
+#include <Common/LofarLogger.h>
+#include <Common/Timer.h>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// Measures, between two processes:
+// - the throughput of 1 MB blocks (copied in and out of the stream)
+// - the throughput of 1 MB blocks using the zero-copy API of shm:
+// - the round-trip latency of 64-byte messages
+// for shm:, pipe:, and tcp: over the loopback interface.
+
+using namespace LOFAR;
+using namespace std;
+
+const size_t blockSize   = 1024 * 1024;
+const size_t nrBlocks    = 256;
+const size_t msgSize     = 64;
+const size_t nrRoundTrips = 10000;
+
+enum Mode { COPY, ZERO_COPY };
+
+// Send the blocks, then echo the messages.
+void client(const string &descriptor, Mode mode)
+{
+  boost::scoped_ptr<Stream> s(createStream(descriptor, false, time(0) + 10));
+  vector<char> block(blockSize, 1);
+
+  for (size_t b = 0; b < nrBlocks; b++) {
+    if (mode == COPY) {
+      s->write(&block[0], blockSize);
+    } else {
+      SharedMemoryRingStream &shm = dynamic_cast<SharedMemoryRingStream &>(*s);
+      // Only the first bytes are produced, as a producer filling the
+      // buffer in place would have to do that anyway.
+      *static_cast<size_t *>(shm.acquireWriteBuffer(blockSize)) = b;
+      shm.commitWriteBuffer(blockSize);
+    }
+  }
+
+  char msg[msgSize];
+
+  for (size_t i = 0; i < nrRoundTrips; i++) {
+    s->read(msg, msgSize);
+    s->write(msg, msgSize);
+  }
+}
+
+void server(const string &descriptor, Mode mode)
+{
+  boost::scoped_ptr<Stream> s(createStream(descriptor, true, time(0) + 10));
+  vector<char> block(blockSize);
+
+  NSTimer throughputTimer;
+  throughputTimer.start();
+
+  for (size_t b = 0; b < nrBlocks; b++) {
+    if (mode == COPY) {
+      s->read(&block[0], blockSize);
+    } else {
+      SharedMemoryRingStream &shm = dynamic_cast<SharedMemoryRingStream &>(*s);
+      ASSERT(*static_cast<const size_t *>(shm.acquireReadBuffer(blockSize)) == b);
+      shm.commitReadBuffer(blockSize);
+    }
+  }
+
+  throughputTimer.stop();
+
+  char msg[msgSize];
+  memset(msg, 0, msgSize);
+
+  NSTimer latencyTimer;
+  latencyTimer.start();
+
+  for (size_t i = 0; i < nrRoundTrips; i++) {
+    s->write(msg, msgSize);
+    s->read(msg, msgSize);
+  }
+
+  latencyTimer.stop();
+
+  cout << descriptor << (mode == ZERO_COPY ? " (zero-copy)" : "") << ": "
+       << nrBlocks * blockSize / throughputTimer.getElapsed() / 1e6 << " MB/s, "
+       << latencyTimer.getElapsed() / nrRoundTrips * 1e6 << " us round trip" << endl;
+}
+
+void measure(const string &descriptor, Mode mode = COPY)
+{
+  pid_t pid = fork();
+  ASSERT(pid >= 0);
+
+  if (pid == 0) {
+    try {
+      client(descriptor, mode);
+    } catch (Exception &e) {
+      LOG_ERROR_STR(e);
+      _exit(1);
+    }
+    _exit(0);
+  }
+
+  server(descriptor, mode);
+
+  int status;
+  ASSERT(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(int /*argc*/, const char* argv[])
+{
+  INIT_LOGGER(argv[0]);
+
+  try {
+    alarm(300);
+
+    const string id = boost::lexical_cast<string>(getpid());
+
+    measure("shm:tStreamPerf-" + id);
+    measure("shm:tStreamPerf-" + id, ZERO_COPY);
+    measure("pipe:/tmp/tStreamPerf-" + id);
+    measure("tcp:localhost:" + boost::lexical_cast<string>(20000 + getpid() % 10000));
+
+  } catch (Exception& e) {
+    LOG_ERROR_STR(e);
+    return 1;
+  }
+  LOG_INFO("Program terminated successfully");
+  return 0;
+}
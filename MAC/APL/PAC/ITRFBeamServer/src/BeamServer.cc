@@ -41,6 +41,7 @@
 
 #include "BeamServer.h"
 #include "BeamServerConstants.h"
+#include "BeamWeights.h"
 #include <ITRFBeamServer/Package__Version.h>
 
 #include <getopt.h>
@@ -1211,9 +1212,7 @@ void BeamServer::_createBeamPool()
 	int	nPlanes          = MAX_BITS_PER_SAMPLE / itsCurrentBitsPerSample;
 	int	beamletsPerPlane = maxBeamletsPerPlane(itsCurrentBitsPerSample);
 	LOG_DEBUG(formatString("Size weights arrays set to %d x %d x %d", itsMaxRCUs, nPlanes, beamletsPerPlane));
-	itsWeights.resize   (itsMaxRCUs, nPlanes, beamletsPerPlane);
-	itsWeights16.resize (itsMaxRCUs, nPlanes, beamletsPerPlane);
-	itsWeights   = complex<double>(0,0);
+	itsWeights16.resize (1, itsMaxRCUs, nPlanes, beamletsPerPlane);
 	itsWeights16 = complex<int16_t>(0,0);
 }
 
@@ -1534,66 +1533,38 @@ void BeamServer::_logBeamAdministration()
 // -------------------- Reconstruction of calibrationfactor --------------------
 
 //
-// _getCalFactor(rcumode, rcu, subbandNr)
+// _getCalTable(antennaSet, band)
 //
-complex<double>	BeamServer::_getCalFactor(const string& antennaSet, const string& band, uint rcu, uint subbandNr)
+StatCal*	BeamServer::_getCalTable(const string& antennaSet, const string& band) const
 {
-    complex<double>	result(1.0, 0.0);
-	//LOG_DEBUG_STR("calFactor(" << antennaSet << "," << band <<  "," << rcu << "," << subbandNr << ")=" << result);
-
     if (band == "10_90") {
-        if      (antennaSet == "LBA_INNER") { if (itsCalTable_LBA_INNER_10_90) result = itsCalTable_LBA_INNER_10_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_OUTER") { if (itsCalTable_LBA_OUTER_10_90) result = itsCalTable_LBA_OUTER_10_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_SPARSE_EVEN") { if(itsCalTable_LBA_SPARSE_EVEN_10_90) result = itsCalTable_LBA_SPARSE_EVEN_10_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_SPARSE_ODD") { if(itsCalTable_LBA_SPARSE_ODD_10_90) result = itsCalTable_LBA_SPARSE_ODD_10_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_X") { if(itsCalTable_LBA_X_10_90) result = itsCalTable_LBA_X_10_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_Y") { if(itsCalTable_LBA_Y_10_90) result = itsCalTable_LBA_Y_10_90->calFactor(rcu, subbandNr); }
+        if      (antennaSet == "LBA_INNER")       { return (itsCalTable_LBA_INNER_10_90); }
+        else if (antennaSet == "LBA_OUTER")       { return (itsCalTable_LBA_OUTER_10_90); }
+        else if (antennaSet == "LBA_SPARSE_EVEN") { return (itsCalTable_LBA_SPARSE_EVEN_10_90); }
+        else if (antennaSet == "LBA_SPARSE_ODD")  { return (itsCalTable_LBA_SPARSE_ODD_10_90); }
+        else if (antennaSet == "LBA_X")           { return (itsCalTable_LBA_X_10_90); }
+        else if (antennaSet == "LBA_Y")           { return (itsCalTable_LBA_Y_10_90); }
     }
     else if (band == "30_90") {
-        if      (antennaSet == "LBA_INNER") { if(itsCalTable_LBA_INNER_30_90) result = itsCalTable_LBA_INNER_30_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_OUTER") { if(itsCalTable_LBA_OUTER_30_90) result = itsCalTable_LBA_OUTER_30_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_SPARSE_EVEN") { if(itsCalTable_LBA_SPARSE_EVEN_30_90)result = itsCalTable_LBA_SPARSE_EVEN_30_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_SPARSE_ODD") { if(itsCalTable_LBA_SPARSE_ODD_30_90)  result = itsCalTable_LBA_SPARSE_ODD_30_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_X") { if(itsCalTable_LBA_X_30_90) result = itsCalTable_LBA_X_30_90->calFactor(rcu, subbandNr); }
-        else if (antennaSet == "LBA_Y") { if(itsCalTable_LBA_Y_30_90) result = itsCalTable_LBA_Y_30_90->calFactor(rcu, subbandNr); }
+        if      (antennaSet == "LBA_INNER")       { return (itsCalTable_LBA_INNER_30_90); }
+        else if (antennaSet == "LBA_OUTER")       { return (itsCalTable_LBA_OUTER_30_90); }
+        else if (antennaSet == "LBA_SPARSE_EVEN") { return (itsCalTable_LBA_SPARSE_EVEN_30_90); }
+        else if (antennaSet == "LBA_SPARSE_ODD")  { return (itsCalTable_LBA_SPARSE_ODD_30_90); }
+        else if (antennaSet == "LBA_X")           { return (itsCalTable_LBA_X_30_90); }
+        else if (antennaSet == "LBA_Y")           { return (itsCalTable_LBA_Y_30_90); }
     }
-    else if (band == "110_190") { if(itsCalTable_HBA_110_190) result = itsCalTable_HBA_110_190->calFactor(rcu, subbandNr); }
-    else if (band == "170_230") { if(itsCalTable_HBA_170_230) result = itsCalTable_HBA_170_230->calFactor(rcu, subbandNr); }
-    else if (band == "210_250") { if(itsCalTable_HBA_210_250) result = itsCalTable_HBA_210_250->calFactor(rcu, subbandNr); }
-
-
-	//LOG_INFO_STR("calFactor(" << antennaSet << "," << band <<  "," << rcu << "," << subbandNr << ")=" << result);
-	return (result);
+    else if (band == "110_190") { return (itsCalTable_HBA_110_190); }
+    else if (band == "170_230") { return (itsCalTable_HBA_170_230); }
+    else if (band == "210_250") { return (itsCalTable_HBA_210_250); }
+	return (0);
 }
 
 //
-// _getCalFactor(rcumode, rcu, subbandNr)
+// _isCalTableValid(antennaSet, band)
 //
 bool BeamServer::_isCalTableValid(const string& antennaSet, const string& band)
 {
-    bool result;
-
-    result = false;
-    if (band == "10_90") {
-        if      (antennaSet == "LBA_INNER") { if (itsCalTable_LBA_INNER_10_90) result = true; }
-        else if (antennaSet == "LBA_OUTER") { if (itsCalTable_LBA_OUTER_10_90) result = true; }
-        else if (antennaSet == "LBA_SPARSE_EVEN") { if(itsCalTable_LBA_SPARSE_EVEN_10_90) result = true; }
-        else if (antennaSet == "LBA_SPARSE_ODD") { if(itsCalTable_LBA_SPARSE_ODD_10_90) result = true; }
-        else if (antennaSet == "LBA_X") { if(itsCalTable_LBA_X_10_90) result = true; }
-        else if (antennaSet == "LBA_Y") { if(itsCalTable_LBA_Y_10_90) result = true; }
-    }
-    else if (band == "30_90") {
-        if      (antennaSet == "LBA_INNER") { if(itsCalTable_LBA_INNER_30_90) result = true; }
-        else if (antennaSet == "LBA_OUTER") { if(itsCalTable_LBA_OUTER_30_90) result = true; }
-        else if (antennaSet == "LBA_SPARSE_EVEN") { if(itsCalTable_LBA_SPARSE_EVEN_30_90)result = true; }
-        else if (antennaSet == "LBA_SPARSE_ODD") { if(itsCalTable_LBA_SPARSE_ODD_30_90)  result = true; }
-        else if (antennaSet == "LBA_X") { if(itsCalTable_LBA_X_30_90) result = true; }
-        else if (antennaSet == "LBA_Y") { if(itsCalTable_LBA_Y_30_90) result = true; }
-    }
-    else if (band == "110_190") { if(itsCalTable_HBA_110_190) result = true; }
-    else if (band == "170_230") { if(itsCalTable_HBA_170_230) result = true; }
-    else if (band == "210_250") { if(itsCalTable_HBA_210_250) result = true; }
-	return (result);
+	return (_getCalTable(antennaSet, band) != 0);
 }
 
 void BeamServer::_loadCalTable(const string& antennaSet, const string& band, uint nrRSPBoards)
@@ -1646,16 +1617,6 @@ vector<double>	BeamServer::blitz2vector(const blitz::Array<double,1>&	anBA) cons
 	return (resultVect);
 }
 
-//
-// Convert the weights to 16-bits signed integer.
-//
-inline complex<int16_t> convert2complex_int16_t(complex<double> cd)
-{
-	return complex<int16_t>((int16_t)(round(cd.real() * gBeamformerGain)),
-							(int16_t)(round(cd.imag() * gBeamformerGain)));
-}
-BZ_DECLARE_FUNCTION_RET(convert2complex_int16_t, complex<int16_t>)
-
 //
 // compute_weights(time)
 //
@@ -1673,14 +1634,19 @@ void BeamServer::compute_weights(Timestamp weightTime)
 	LOG_INFO_STR("Calculating weights for time " << weightTime);
 
 	// reset all weights
-	LOG_DEBUG_STR("Weights array has size: " << itsWeights.extent(firstDim) << "x" <<
-								itsWeights.extent(secondDim) << "x" << itsWeights.extent(thirdDim));
-	itsWeights = 0.0;
+	itsWeights16 = complex<int16_t>(0,0);
+	const int	nrRCUs		= itsWeights16.extent(secondDim);
+	const int	rowLength	= itsWeights16.extent(thirdDim) * itsWeights16.extent(fourthDim);
+	complex<int16_t>*	weightsData = itsWeights16.data();
 
 	// get ptr to antennafield information
 	AntennaField *gAntField = globalAntennaField();
 
-	int beamletsPerPlane = maxBeamletsPerPlane(itsCurrentBitsPerSample);
+	// work buffers, reused for all beams
+	BeamletSet				beamlets;
+	vector<complex<double> >	calFactors;
+	vector<double>			phases;
+
 	// Check both LBA and HBA antennas
 	for (uint	fieldNr = 0; fieldNr < 4; fieldNr++) {
 		string	fieldName;
@@ -1705,11 +1671,9 @@ void BeamServer::compute_weights(Timestamp weightTime)
 			LOG_DEBUG_STR("No antennas defined in this field");
 			continue;
 		}
-//		LOG_DEBUG_STR("ITRFRCUPos = " << rcuPosITRF);
 
 		// Get geographical location of subarray in ITRF
 		blitz::Array<double, 1> fieldCentreITRF = gAntField->Centre(fieldName);
-//		LOG_DEBUG_STR("ITRF position antennaField: " << fieldCentreITRF);
 
 		// convert ITRF position of all antennas to J2000 for timestamp t
 		blitz::Array<double,2>	rcuJ2000Pos; // [rcu, xyz]
@@ -1720,30 +1684,33 @@ void BeamServer::compute_weights(Timestamp weightTime)
 
 		// Lengths of the vector of the antennaPosition i.r.t. the fieldCentre,
 		blitz::Array<double,1>	rcuPosLengths = gAntField->RCULengths(fieldName);
-//		LOG_DEBUG_STR("rcuPosLengths = " << rcuPosLengths);
 
 		// denormalize length of vector
 		rcuJ2000Pos = rcuJ2000Pos(tensor::i, tensor::j) * rcuPosLengths(tensor::i);
-//		LOG_DEBUG_STR("J2000RCUPos@fullLength=" << rcuJ2000Pos);
+
+		// Note: Beamlet numbers depend on the ring.
+		int	firstBeamlet(gAntField->ringNr(fieldName) * itsCurrentMaxBeamlets);
+		LOG_DEBUG_STR("first beamlet of field " << fieldName << "=" << firstBeamlet);
 
 		// for all beams using this field
 		map<string, DigitalBeam*>::iterator	beamIter = itsBeamPool.begin();
 		map<string, DigitalBeam*>::iterator	end		 = itsBeamPool.end();
 		for ( ; beamIter != end; ++beamIter) {
+			DigitalBeam*	beam = beamIter->second;
 			// must be of the same antenna field.
-			if (globalAntennaSets()->antennaField(beamIter->second->antennaSetName()) != fieldName) {
+			if (globalAntennaSets()->antennaField(beam->antennaSetName()) != fieldName) {
 				continue;
 			}
 			// Get the RCU index-schema for this antennaSet.
-			vector<int16>	posIndex = globalAntennaSets()->positionIndex(beamIter->second->antennaSetName());
+			vector<int16>	posIndex = globalAntennaSets()->positionIndex(beam->antennaSetName());
 
 			// Get the right pointing
-			Pointing	currentPointing = beamIter->second->pointingAtTime(weightTime);
+			Pointing	currentPointing = beam->pointingAtTime(weightTime);
 			blitz::Array<double,2>	sourceJ2000xyz;		// [1, xyz]
 			blitz::Array<double,2>	curPoint(1,2);		// [1, angles]
 			curPoint(0,0) = currentPointing.angle0();
 			curPoint(0,1) = currentPointing.angle1();
-			LOG_INFO_STR("current pointing for beam " << beamIter->second->name() << ":" << currentPointing);
+			LOG_INFO_STR("current pointing for beam " << beam->name() << ":" << currentPointing);
 			if (!itsJ2000Converter->doConversion(currentPointing.getType(), curPoint, fieldCentreITRF, weightTime, sourceJ2000xyz)) {
 				LOG_FATAL_STR("Conversion of source to J2000 failed");
 				continue;
@@ -1751,55 +1718,54 @@ void BeamServer::compute_weights(Timestamp weightTime)
 			LOG_INFO(formatString("sourceJ2000xyz: [ %9.6f, %9.6f, %9.6f ]",
 							sourceJ2000xyz(0,0), sourceJ2000xyz(0,1), sourceJ2000xyz(0,2)));
 
-			// Note: Beamlet numbers depend on the ring.
-			int	firstBeamlet(gAntField->ringNr(fieldName) * itsCurrentMaxBeamlets);
-			LOG_DEBUG_STR("first beamlet of field " << fieldName << "=" << firstBeamlet);
+			// Collect the beamlets of this beam once instead of per RCU.
+			// The weight of an RCU for a beamlet is:
+			//   CalFactor * exp(scaling * (rcuPos . sourcePos))
+			// scaling is (0, -2.pi.f/c), so only its imaginary part is used.
+			boost::dynamic_bitset<>	beamletAllocation = beam->allocation().getBeamletBitset(itsCurrentMaxBeamlets);
+			beamlets.clear();
+			int		nrBeamlets = std::min((int)beamletAllocation.size(), rowLength);
+			for (int	beamlet = 0; beamlet < nrBeamlets; beamlet++) {
+				if (beamletAllocation.test(beamlet)) {
+					const BeamletAlloc_t&	alloc = itsBeamletAllocation[beamlet+firstBeamlet];
+					beamlets.add(beamlet, alloc.subbandNr, alloc.scaling.imag());
+				}
+			}
+			if (beamlets.size() == 0) {
+				continue;
+			}
+			phases.resize(beamlets.size());
+			calFactors.resize(beamlets.size());
+			StatCal*	calTable = _getCalTable(beam->antennaSetName(), beam->bandName());
+
+			double	srcX = sourceJ2000xyz(0,0);
+			double	srcY = sourceJ2000xyz(0,1);
+			double	srcZ = sourceJ2000xyz(0,2);
+
 			// Note: RCUallocation is stationbased, rest info is fieldbased,
-			bitset<MAX_RCUS>	RCUallocation(beamIter->second->rcuMask());
-			for (int rcu = 0; rcu < MAX_RCUS; rcu++) {
+			bitset<MAX_RCUS>	RCUallocation(beam->rcuMask());
+			for (int rcu = 0; rcu < nrRCUs; rcu++) {
 				if (!RCUallocation.test(rcu)) {			// all RCUS switched on in LBA/HBA mode
 					continue;
 				}
-
-				//
-				// For all beamlets that belong to this beam calculate the weight
-				// Note: weight is in-procduct for RCUpos and source Pos and depends on
-				// the frequency of the subband.
-				//
-				boost::dynamic_bitset<>	beamletAllocation;
-				beamletAllocation.resize(itsCurrentMaxBeamlets);
-				beamletAllocation = beamIter->second->allocation().getBeamletBitset(itsCurrentMaxBeamlets);
-				int		nrBeamlets = beamletAllocation.size();
-				for (int	beamlet = 0; beamlet < nrBeamlets; beamlet++) {
-					if (!beamletAllocation.test(beamlet)) {
-						continue;
+				int		posNr = posIndex[rcu];
+				double	delay = rcuJ2000Pos(posNr, 0) * srcX +
+								rcuJ2000Pos(posNr, 1) * srcY +
+								rcuJ2000Pos(posNr, 2) * srcZ;
+				if (calTable) {
+					for (size_t i = 0; i < beamlets.size(); i++) {
+						calFactors[i] = calTable->calFactor(rcu, beamlets.subbandNrs[i]);
 					}
-                    //LOG_DEBUG_STR("get CalFactor for " << beamIter->second->antennaSetName() << ", " <<  beamIter->second->bandName());
-					complex<double>	CalFactor = _getCalFactor(beamIter->second->antennaSetName(), beamIter->second->bandName(),
-                                                              rcu, itsBeamletAllocation[beamlet+firstBeamlet].subbandNr);
-					int	bitPlane = beamlet / beamletsPerPlane;
-					itsWeights(rcu, bitPlane, beamlet % beamletsPerPlane) =
-						CalFactor * exp(itsBeamletAllocation[beamlet+firstBeamlet].scaling *
-								(rcuJ2000Pos((int)posIndex[rcu], 0) * sourceJ2000xyz(0,0) +
-								 rcuJ2000Pos((int)posIndex[rcu], 1) * sourceJ2000xyz(0,1) +
-								 rcuJ2000Pos((int)posIndex[rcu], 2) * sourceJ2000xyz(0,2)));
-
-					// some debugging
-					if (beamlet%100==0) {
-						LOG_DEBUG_STR("itsWeights(" << rcu << "," << bitPlane << "," << beamlet << ")="
-										<< itsWeights(rcu, bitPlane, beamlet)
-										<< " : rcuPos[" << posIndex[rcu] << "]=" << rcuJ2000Pos((int)posIndex[rcu],0)
-										<< " : CalFactor=" << CalFactor);
-					}
-				} // beamlets
+				}
+				computeRCUWeights(delay, beamlets, calTable ? &calFactors[0] : 0,
+								  gBeamformerGain, &phases[0], weightsData + rcu * rowLength);
 			} // rcus
+			LOG_DEBUG_STR("weights of beam " << beam->name() << " computed for "
+							<< RCUallocation.count() << " RCUs and " << beamlets.size() << " beamlets");
 		} // beams
 	} // antennafield
 
-	// convert the weights from double to int16
-	itsWeights16 = convert2complex_int16_t(itsWeights);
-
-	LOG_DEBUG(formatString("sizeof(itsWeights16) = %d", itsWeights16.size()*sizeof(int16_t)));
+	LOG_DEBUG(formatString("sizeof(itsWeights16) = %d", itsWeights16.size()*sizeof(complex<int16_t>)));
 }
 
 //
@@ -1821,9 +1787,8 @@ void BeamServer::send_weights(Timestamp time)
 		sw.rcumask.set(i);
 	}
 
-	int	nPlanes = MAX_BITS_PER_SAMPLE / itsCurrentBitsPerSample;
-	sw.weights().resize(1, itsMaxRCUs, nPlanes, itsCurrentMaxBeamlets / nPlanes);
-	sw.weights()(0, Range::all(), Range::all(), Range::all()) = itsWeights16;
+	// itsWeights16 already has the layout of the message, so no copy is needed.
+	sw.weights().reference(itsWeights16);
 
 	LOG_INFO_STR("sending weights for interval " << time << " : " << time + (long)(itsComputeInterval-1));
 
@@ -1831,7 +1796,7 @@ void BeamServer::send_weights(Timestamp time)
 //	blitz::Array<std::complex<int16>, 2>	sample;
 //	sample.resize (10, 40);		// first 10 antennas and first 40 subbands
 //	sample = complex<int16_t>(0,0);
-//	sample = itsWeights16(0, Range(64,74), Range(0,40));
+//	sample = itsWeights16(0, 0, Range(64,74), Range(0,40));
 //	LOG_DEBUG_STR("weights sample=" << sample);
 
 	itsRSPDriver->send(sw);
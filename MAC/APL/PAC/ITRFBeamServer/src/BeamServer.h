@@ -179,7 +179,7 @@ private:
 	void _logBeamAdministration();
 
 	// RCU calibration
-	std::complex<double>	_getCalFactor(const string& antennaSet, const string& band, uint rcu, uint subbandNr);
+	StatCal*				_getCalTable (const string& antennaSet, const string& band) const;
 	void 					_loadCalTable(const string& antennaSet, const string& band, uint nrRSPBoards);
     bool                    _isCalTableValid(const string& antennaSet, const string& band);
 	// ### data members ###
@@ -199,9 +199,9 @@ private:
 	} BeamletAlloc_t;
 	vector<BeamletAlloc_t>		itsBeamletAllocation;
 
-	// Weights array [MAX_RCUS, MAX_BEAMLETS]
-	blitz::Array<std::complex<double>,  3> itsWeights;
-	blitz::Array<std::complex<int16_t>, 3> itsWeights16;
+	// Weights array [1, MAX_RCUS, nPlanes, beamletsPerPlane] in the layout of
+	// the RSP SetWeights message.
+	blitz::Array<std::complex<int16_t>, 4> itsWeights16;
 
 	// RCU Allocations in the AntennaArrays. Remember that each RCU can participate
 	// in more than one beam.
@@ -0,0 +1,91 @@
+//#  BeamWeights.cc: kernel computing the beamformer weights of an RCU
+//#
+//#  Copyright (C) 2016
+//#  ASTRON (Netherlands Foundation for Research in Astronomy)
+//#  P.O.Box 2, 7990 AA Dwingeloo, The Netherlands, softwaresupport@astron.nl
+//#
+//#  This program is free software; you can redistribute it and/or modify
+//#  it under the terms of the GNU General Public License as published by
+//#  the Free Software Foundation; either version 2 of the License, or
+//#  (at your option) any later version.
+//#
+//#  This program is distributed in the hope that it will be useful,
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//#  GNU General Public License for more details.
+//#
+//#  You should have received a copy of the GNU General Public License
+//#  along with this program; if not, write to the Free Software
+//#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//#
+//#  $Id$
+
+#include <lofar_config.h>
+#include "BeamWeights.h"
+#include <cmath>
+
+namespace LOFAR {
+  namespace BS {
+
+// Calculate sin and cos of the phases.
+// Unlike sincos from libm this loop has no calls and branches, so the compiler
+// can vectorize it. The phase is reduced to [-pi/4,pi/4] around a multiple of
+// pi/2, for which the Taylor series are accurate to 1e-11, which is much
+// better than the 16 bits weights need.
+static void vectorSinCos(const double* phases, int n, double* sinp, double* cosp)
+{
+	const double	TWO_OVER_PI = 0.63661977236758134308;
+	const double	PIO2_HI     = 1.57079632673412561417e+00;	// first 33 bits of pi/2
+	const double	PIO2_LO     = 6.07710050650619224932e-11;	// pi/2 - PIO2_HI
+
+	for (int i = 0; i < n; i++) {
+		double	qd = floor(phases[i] * TWO_OVER_PI + 0.5);
+		double	r  = (phases[i] - qd * PIO2_HI) - qd * PIO2_LO;
+		double	r2 = r * r;
+		double	s  = r + r * r2 * (-1.0/6 + r2 * (1.0/120 + r2 * (-1.0/5040 +
+							r2 * (1.0/362880 + r2 * (-1.0/39916800)))));
+		double	c  = 1.0 + r2 * (-0.5 + r2 * (1.0/24 + r2 * (-1.0/720 +
+							r2 * (1.0/40320 + r2 * (-1.0/3628800 + r2 * (1.0/479001600))))));
+		// rotate back over q*pi/2
+		int		q  = (int)qd & 3;
+		double	sq = (q & 1) ? c : s;
+		double	cq = (q & 1) ? s : c;
+		sinp[i] = (q & 2)       ? -sq : sq;
+		cosp[i] = ((q + 1) & 2) ? -cq : cq;
+	}
+}
+
+void computeRCUWeights(double					delay,
+					   const BeamletSet&		beamlets,
+					   const std::complex<double>*	calFactors,
+					   double					gain,
+					   double*					work,
+					   std::complex<int16_t>*	rcuWeights)
+{
+	const int		nrBeamlets = beamlets.size();
+	const double*	phaseFactors = &beamlets.phaseFactors[0];
+	const int*		beamletNrs   = &beamlets.beamletNrs[0];
+	double*			sinp = work;
+	double*			cosp = work + nrBeamlets;
+
+	// first the phases over a contiguous array, so the compiler can vectorize it
+	for (int i = 0; i < nrBeamlets; i++) {
+		sinp[i] = phaseFactors[i] * delay;
+	}
+	vectorSinCos(sinp, nrBeamlets, sinp, cosp);
+
+	for (int i = 0; i < nrBeamlets; i++) {
+		double	re = gain * cosp[i];
+		double	im = gain * sinp[i];
+		if (calFactors) {
+			const std::complex<double>&	cal = calFactors[i];
+			double	tmp = re * cal.real() - im * cal.imag();
+			im = re * cal.imag() + im * cal.real();
+			re = tmp;
+		}
+		rcuWeights[beamletNrs[i]] = std::complex<int16_t>((int16_t)lrint(re), (int16_t)lrint(im));
+	}
+}
+
+  } // namespace BS
+} // namespace LOFAR
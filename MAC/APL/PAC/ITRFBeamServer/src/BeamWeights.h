@@ -0,0 +1,68 @@
+//#  BeamWeights.h: kernel computing the beamformer weights of an RCU
+//#
+//#  Copyright (C) 2016
+//#  ASTRON (Netherlands Foundation for Research in Astronomy)
+//#  P.O.Box 2, 7990 AA Dwingeloo, The Netherlands, softwaresupport@astron.nl
+//#
+//#  This program is free software; you can redistribute it and/or modify
+//#  it under the terms of the GNU General Public License as published by
+//#  the Free Software Foundation; either version 2 of the License, or
+//#  (at your option) any later version.
+//#
+//#  This program is distributed in the hope that it will be useful,
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//#  GNU General Public License for more details.
+//#
+//#  You should have received a copy of the GNU General Public License
+//#  along with this program; if not, write to the Free Software
+//#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//#
+//#  $Id$
+
+#ifndef BEAMWEIGHTS_H_
+#define BEAMWEIGHTS_H_
+
+#include <lofar_config.h>
+#include <Common/lofar_complex.h>
+#include <Common/lofar_vector.h>
+#include <stdint.h>
+
+namespace LOFAR {
+  namespace BS {
+
+// The beamlets of one beam in a form suitable for computing the weights:
+// contiguous arrays instead of the allocation maps and bitsets.
+class BeamletSet {
+public:
+	void clear()	{ beamletNrs.clear(); subbandNrs.clear(); phaseFactors.clear(); }
+	size_t size() const	{ return (beamletNrs.size()); }
+	void add(int beamletNr, int subbandNr, double phaseFactor) {
+		beamletNrs.push_back(beamletNr);
+		subbandNrs.push_back(subbandNr);
+		phaseFactors.push_back(phaseFactor);
+	}
+
+	vector<int>		beamletNrs;		// index of the weight in the RCU row
+	vector<int>		subbandNrs;		// for the calibration factor
+	vector<double>	phaseFactors;	// phase per meter delay (-2.pi.f/c)
+};
+
+// Compute the weights of the beamlets of one beam for one RCU and store
+// them as 16 bits integers in the row of that RCU (the layout used in the
+// RSP SetWeights message).
+//   weight = gain * calFactor * exp(i * phaseFactor * delay)
+// calFactors contains the calibration factor per beamlet of the set or is 0
+// if no calibration has to be applied.
+// work is a buffer of at least 2*beamlets.size() elements.
+void computeRCUWeights(double					delay,
+					   const BeamletSet&		beamlets,
+					   const std::complex<double>*	calFactors,
+					   double					gain,
+					   double*					work,
+					   std::complex<int16_t>*	rcuWeights);
+
+  } // namespace BS
+} // namespace LOFAR
+
+#endif
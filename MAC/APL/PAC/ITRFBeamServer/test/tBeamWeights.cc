@@ -0,0 +1,118 @@
+//#  tBeamWeights.cc: test and benchmark of the beamformer weight kernel
+//#
+//#  Copyright (C) 2016
+//#  ASTRON (Netherlands Foundation for Research in Astronomy)
+//#  P.O.Box 2, 7990 AA Dwingeloo, The Netherlands, softwaresupport@astron.nl
+//#
+//#  This program is free software; you can redistribute it and/or modify
+//#  it under the terms of the GNU General Public License as published by
+//#  the Free Software Foundation; either version 2 of the License, or
+//#  (at your option) any later version.
+//#
+//#  This program is distributed in the hope that it will be useful,
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//#  GNU General Public License for more details.
+//#
+//#  You should have received a copy of the GNU General Public License
+//#  along with this program; if not, write to the Free Software
+//#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//#
+//#  $Id$
+
+//# Always #include <lofar_config.h> first!
+#include <lofar_config.h>
+
+//# Includes
+#include <ITRFBeamServer/BeamWeights.h>
+#include <sys/time.h>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+
+using namespace LOFAR;
+using namespace BS;
+using namespace std;
+
+static double now()
+{
+	struct timeval	tv;
+	gettimeofday(&tv, 0);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+// Computes the weights for the maximum nr of RCUs and beamlets with the
+// kernel used by the BeamServer and with the original per-element formula,
+// checks that they are equal (within rounding) and shows the timings.
+int main(int argc, char* argv[])
+{
+	const int		nrRCUs     = (argc > 1) ? atoi(argv[1]) : 192;	// international station
+	const int		nrBeamlets = (argc > 2) ? atoi(argv[2]) : 976;	// 4 bit mode
+	const int		nrRuns     = (argc > 3) ? atoi(argv[3]) : 10;
+	const double	gain       = 8000;
+	const double	speedOfLight = 299792458.0;
+
+	// geometry: RCUs up to 50m from the centre, some pointing direction.
+	vector<double>	delays(nrRCUs);
+	srand(1);
+	for (int rcu = 0; rcu < nrRCUs; rcu++) {
+		double	x = 100.0 * (rand() / (RAND_MAX + 1.0)) - 50.0;
+		double	y = 100.0 * (rand() / (RAND_MAX + 1.0)) - 50.0;
+		delays[rcu] = x * 0.3 + y * 0.5;
+	}
+	BeamletSet	beamlets;
+	vector<complex<double> >	calFactors(nrBeamlets);
+	for (int b = 0; b < nrBeamlets; b++) {
+		int		subband = 100 + b % 400;
+		double	freq    = subband * 200e6 / 1024;
+		beamlets.add(b, subband, -2.0 * M_PI * freq / speedOfLight);
+		calFactors[b] = polar(0.8 + 0.4 * (rand() / (RAND_MAX + 1.0)), 2*M_PI * (rand() / (RAND_MAX + 1.0)));
+	}
+
+	vector<complex<int16_t> >	weights(nrRCUs * nrBeamlets);
+	vector<complex<int16_t> >	refWeights(nrRCUs * nrBeamlets);
+	vector<double>				work(2 * nrBeamlets);
+
+	// original formula: CalFactor * exp(scaling * delay)
+	double	start = now();
+	for (int run = 0; run < nrRuns; run++) {
+		for (int rcu = 0; rcu < nrRCUs; rcu++) {
+			for (int b = 0; b < nrBeamlets; b++) {
+				complex<double>	scaling(0.0, beamlets.phaseFactors[b]);
+				complex<double>	w = calFactors[b] * exp(scaling * delays[rcu]);
+				refWeights[rcu * nrBeamlets + b] = complex<int16_t>((int16_t)round(w.real() * gain),
+																	(int16_t)round(w.imag() * gain));
+			}
+		}
+	}
+	double	refTime = (now() - start) / nrRuns;
+
+	start = now();
+	for (int run = 0; run < nrRuns; run++) {
+		for (int rcu = 0; rcu < nrRCUs; rcu++) {
+			computeRCUWeights(delays[rcu], beamlets, &calFactors[0], gain, &work[0],
+							  &weights[rcu * nrBeamlets]);
+		}
+	}
+	double	newTime = (now() - start) / nrRuns;
+
+	// the order of the multiplications differs, so allow 1 unit difference.
+	int	nrDiff = 0;
+	for (size_t i = 0; i < weights.size(); i++) {
+		if (abs(weights[i].real() - refWeights[i].real()) > 1 ||
+			abs(weights[i].imag() - refWeights[i].imag()) > 1) {
+			if (nrDiff++ < 10) {
+				cerr << "weight " << i << ": " << weights[i] << " != " << refWeights[i] << endl;
+			}
+		}
+	}
+	if (nrDiff > 0) {
+		cerr << nrDiff << " weights differ" << endl;
+		return (1);
+	}
+
+	cout << nrRCUs << " RCUs x " << nrBeamlets << " beamlets:" << endl;
+	cout << "  original formula: " << refTime * 1e3 << " ms" << endl;
+	cout << "  weight kernel:    " << newTime * 1e3 << " ms" << endl;
+	return (0);
+}
@@ -36,11 +36,23 @@ namespace LOFAR  {
 #define SCHEDULING_DELAY 2
 
 int Scheduler::SYNC_INTERVAL_INT = 1; // default
+int Scheduler::TIMING_REPORT_INTERVAL = 0; // default: no reports
 int MAX_SEQUENCIAL_BOARD_ERRORS = 50;
 
-Scheduler::Scheduler()
+Scheduler::Scheduler() :
+	itsScheduleTimer("scheduleCommands"),
+	itsProcessTimer ("processCommands"),
+	itsSyncTimer    ("sync"),
+	itsSwapTimer    ("swapBuffers"),
+	itsCompleteTimer("completeCommands"),
+	itsSyncBusy     (false),
+	itsNrAcks       (0),
+	itsNrAckBytes   (0),
+	itsLastReport   (0)
 {
 	SYNC_INTERVAL_INT = (int)trunc(GET_CONFIG("RSPDriver.SYNC_INTERVAL", f)+0.5);
+	// Optional key, older configuration files do not have it.
+	TIMING_REPORT_INTERVAL = globalParameterSet()->getInt32("RSPDriver.TIMING_REPORT_INTERVAL", 0);
 }
 
 Scheduler::~Scheduler()
@@ -107,6 +119,8 @@ GCFEvent::TResult Scheduler::run(GCFEvent& event, GCFPortInterface& /*port*/)
 			completeSync();
 		}
 
+		reportTiming(timeout->sec);
+
 		// round to nearest second t, warn if time is too far off from top of second
 		//
 		//        t-1        t         t+1
@@ -120,8 +134,12 @@ GCFEvent::TResult Scheduler::run(GCFEvent& event, GCFPortInterface& /*port*/)
 		}
 		setCurrentTime(topofsecond, 0);
 
+		itsScheduleTimer.start();
 		scheduleCommands();
+		itsScheduleTimer.stop();
+		itsProcessTimer.start();
 		processCommands();
+		itsProcessTimer.stop();
 
 		initiateSync(event); // matched by completeSync
 	}
@@ -144,6 +162,9 @@ GCFEvent::TResult Scheduler::dispatch(GCFEvent& event, GCFPortInterface& port)
 	GCFEvent* 	 	  current_event = &event;
 	bool 			  sync_completed = true;
 
+	itsNrAcks++;
+	itsNrAckBytes += event.length;
+
 	// Dispatch the event to the first SyncAction that
 	// has not yet reached its 'final' state.
 	vector<SyncAction*>::iterator sa;
@@ -519,6 +540,11 @@ void Scheduler::initiateSync(GCFEvent& event)
 
 	m_sync_completed.clear();
 
+	if (!itsSyncBusy) {
+		itsSyncTimer.start();
+		itsSyncBusy = true;
+	}
+
 	// Send the first syncaction for each board the timer
 	// event to set of the data communication to each board.
 	map< GCFPortInterface*, vector<SyncAction*> >::iterator 	iter = m_syncactions.begin();
@@ -573,6 +599,11 @@ void Scheduler::completeSync()
 {
 //	LOG_INFO("Scheduler::completeSync");
 
+	if (itsSyncBusy) {
+		itsSyncTimer.stop();
+		itsSyncBusy = false;
+	}
+
 	// print current state for all registers
 	ostringstream logStream;
 	Cache::getInstance().getState().print(logStream);
@@ -587,10 +618,14 @@ void Scheduler::completeSync()
 	// swap the buffers
 	// new data from the boards which was in the back buffers
 	// will end up in the front buffers.
+	itsSwapTimer.start();
 	Cache::getInstance().swapBuffers();
+	itsSwapTimer.stop();
 
 	// complete any outstanding commands
+	itsCompleteTimer.start();
 	completeCommands();
+	itsCompleteTimer.stop();
 
 	// clear all registers from DONE to IDLE state
 	Cache::getInstance().getState().clear();
@@ -656,5 +691,58 @@ void Scheduler::completeCommands()
 	}
 }
 
+//
+// averageMs(timer)
+//
+static double averageMs(const NSTimer& timer)
+{
+	return (timer.getCount() ? 1e3 * timer.getAverage() : 0.0);
+}
+
+//
+// reportTiming(now)
+//
+// Log the average time spent in the parts of the update cycle and the
+// message rate of the boards once every TIMING_REPORT_INTERVAL seconds.
+// Run the driver with SYNC_MODE=2 to get the maximum update rate.
+//
+void Scheduler::reportTiming(long now)
+{
+	if (TIMING_REPORT_INTERVAL <= 0) {
+		return;
+	}
+	if (itsLastReport == 0) {
+		itsLastReport = now;
+		return;
+	}
+	long	interval = now - itsLastReport;
+	if (interval < TIMING_REPORT_INTERVAL) {
+		return;
+	}
+
+	LOG_INFO(formatString("TIMING: %d boards, %.1f cycles/s, %.0f msgs/s, %.3f MB/s",
+				(int)m_syncactions.size(),
+				(double)itsSyncTimer.getCount() / interval,
+				(double)itsNrAcks / interval,
+				itsNrAckBytes / (1e6 * interval)));
+	LOG_INFO(formatString("TIMING: avg sync=%.3f ms, scheduleCommands=%.3f ms, processCommands=%.3f ms, "
+				"swapBuffers=%.3f ms, completeCommands=%.3f ms",
+				averageMs(itsSyncTimer),
+				averageMs(itsScheduleTimer),
+				averageMs(itsProcessTimer),
+				averageMs(itsSwapTimer),
+				averageMs(itsCompleteTimer)));
+
+	// Called when no sync is in progress, so all timers are stopped.
+	itsSyncTimer.reset();
+	itsScheduleTimer.reset();
+	itsProcessTimer.reset();
+	itsSwapTimer.reset();
+	itsCompleteTimer.reset();
+	itsNrAcks     = 0;
+	itsNrAckBytes = 0;
+	itsLastReport = now;
+}
+
   } // namespace RSP
 } // namespace LOFAR
@@ -26,6 +26,7 @@
 #define SCHEDULER_H_
 
 #include <queue>
+#include <Common/Timer.h>
 #include <GCF/TM/GCF_PortInterface.h>
 #include <APL/RTCCommon/Timestamp.h>
 #include "Command.h"
@@ -97,6 +98,7 @@ private:
 
 	// Constants from the config file converted to the correct type.
 	static int SYNC_INTERVAL_INT;
+	static int TIMING_REPORT_INTERVAL;
 
 	/*@{*/
 	// Helper methods for the Scheduler::run method.
@@ -109,6 +111,10 @@ private:
 	void	completeCommands();
 	/*@}*/
 
+	// Log the timing and throughput statistics when the report interval
+	// has passed and reset them.
+	void	reportTiming(long now);
+
 	pqueue	m_later_queue;				// commands to be exec later
 	pqueue	m_periodic_queue;			// commands to be executed peiodically
 	pqueue	m_now_queue;				// filled every second from later and periodic queue
@@ -121,6 +127,17 @@ private:
 	std::map< GCFPortInterface*, int >  					itsBoardErrCount;
 
 	RTC::Timestamp 			m_current_time;
+
+	// Timing and throughput statistics (see TIMING_REPORT_INTERVAL).
+	NSTimer		itsScheduleTimer;		// scheduleCommands()
+	NSTimer		itsProcessTimer;		// processCommands()
+	NSTimer		itsSyncTimer;			// from initiateSync() until completeSync()
+	NSTimer		itsSwapTimer;			// Cache::swapBuffers()
+	NSTimer		itsCompleteTimer;		// completeCommands()
+	bool		itsSyncBusy;			// itsSyncTimer is running
+	uint64		itsNrAcks;				// nr of messages received from the boards
+	uint64		itsNrAckBytes;			// nr of bytes received from the boards
+	long		itsLastReport;			// time of the last report
 };
 
   }; // namespace RSP
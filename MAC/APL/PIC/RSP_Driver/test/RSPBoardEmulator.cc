@@ -0,0 +1,442 @@
+//#
+//#  RSPBoardEmulator.cc: emulates a number of RSP boards on an ethernet interface
+//#
+//#  Copyright (C) 2016
+//#  ASTRON (Netherlands Foundation for Research in Astronomy)
+//#  P.O.Box 2, 7990 AA Dwingeloo, The Netherlands, softwaresupport@astron.nl
+//#
+//#  This program is free software; you can redistribute it and/or modify
+//#  it under the terms of the GNU General Public License as published by
+//#  the Free Software Foundation; either version 2 of the License, or
+//#  (at your option) any later version.
+//#
+//#  This program is distributed in the hope that it will be useful,
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//#  GNU General Public License for more details.
+//#
+//#  You should have received a copy of the GNU General Public License
+//#  along with this program; if not, write to the Free Software
+//#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//#
+//#  $Id$
+//#
+//#  Usage: RSPBoardEmulator ifname RSPDriver.conf [nrBoards [reportInterval]]
+//#
+//#  Answers the EPA requests of the RSPDriver for nrBoards boards (default:
+//#  all RSPDriver.MAC_ADDR_<n> keys in the given configuration file) on the
+//#  given interface. Unlike EPAStub, which emulates one board with a fixed
+//#  register map through a GCFETHRawPort, all boards are served by one raw
+//#  socket and every register is accepted: writes are stored per board, BLP
+//#  and register, reads return the stored value (zeros if never written) and
+//#  reads of the statistics registers return a pattern that changes every
+//#  read. The boards answer immediately, so the RSPDriver is the bottleneck.
+//#
+//#  Every reportInterval seconds (default 10) the request rate and traffic
+//#  is printed. Stop the emulator with ^C to get the totals per board.
+//#  See rspdriverbench for running it against the RSPDriver.
+
+#include <lofar_config.h>
+#include <Common/LofarLogger.h>
+#include <Common/ParameterSet.h>
+#include <Common/StringUtil.h>
+#include <Common/lofar_map.h>
+#include <Common/lofar_vector.h>
+
+#include <APL/RSP_Protocol/MEPHeader.h>
+
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <net/if.h>
+#include <netpacket/packet.h>
+#include <linux/if_ether.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+namespace LOFAR {
+  using namespace EPA_Protocol;
+  namespace RSP_Test {
+
+#define ETHERTYPE_EPA 0x10FA
+
+static volatile sig_atomic_t	gStop = 0;
+
+static void stopHandler(int)
+{
+	gStop = 1;
+}
+
+//
+// EmulatedBoard: the registers and counters of one RSP board.
+//
+class EmulatedBoard
+{
+public:
+	EmulatedBoard() : itsNrReads(0), itsNrWrites(0), itsBytesIn(0), itsBytesOut(0) {}
+
+	// Handle the EPA message in request and put the acknowledgement in reply.
+	// Returns the size of the reply, 0 if the message is ignored.
+	size_t handle(const char* request, size_t size, char* reply);
+
+	uint64	itsNrReads;
+	uint64	itsNrWrites;
+	uint64	itsBytesIn;
+	uint64	itsBytesOut;
+
+private:
+	// Get the memory of a register, enlarged to at least size bytes.
+	char* getRegister(int target, uint8 pid, uint8 regid, size_t size);
+
+	// The registers per target (BLP 0..3, RSP = 4), pid and regid.
+	map<uint32, vector<char> >	itsRegisters;
+};
+
+// Convert a dstid bit to the index of the target.
+static int targetIndex(uint16 bit)
+{
+	return (bit == MEPHeader::DST_RSP ? MEPHeader::N_BLPS : ffs(bit) - 1);
+}
+
+char* EmulatedBoard::getRegister(int target, uint8 pid, uint8 regid, size_t size)
+{
+	vector<char>&	reg = itsRegisters[(target << 16) | (pid << 8) | regid];
+	if (reg.size() < size) {
+		reg.resize(size, 0);
+	}
+	return (&reg[0]);
+}
+
+size_t EmulatedBoard::handle(const char* request, size_t size, char* reply)
+{
+	if (size < MEPHeader::SIZE) {
+		return (0);
+	}
+
+	MEPHeader::FieldsType	hdr;
+	memcpy(&hdr, request, MEPHeader::SIZE);
+	uint16	length = hdr.payload_length;
+	size_t	end    = hdr.offset + length;
+	uint16	dstid  = hdr.addr.dstid & MEPHeader::DST_ALL;
+	if (!dstid || length > ETH_DATA_LEN - MEPHeader::SIZE) {
+		return (0);
+	}
+	itsBytesIn += size;
+
+	MEPHeader::FieldsType	ack(hdr);
+	ack.status = 0;
+
+	switch (hdr.type) {
+	case MEPHeader::READ: {
+		// Read from the first addressed target.
+		char*	data = reply + MEPHeader::SIZE;
+		if (hdr.addr.pid == MEPHeader::SST || hdr.addr.pid == MEPHeader::BST ||
+			hdr.addr.pid == MEPHeader::XST) {
+			uint32	value = itsNrReads + hdr.offset / sizeof(uint32);
+			for (size_t i = 0; i + sizeof(uint32) <= length; i += sizeof(uint32), value++) {
+				memcpy(data + i, &value, sizeof(uint32));
+			}
+		}
+		else {
+			char*	reg = getRegister(targetIndex(dstid & -dstid), hdr.addr.pid, hdr.addr.regid, end);
+			memcpy(data, reg + hdr.offset, length);
+		}
+		ack.type         = MEPHeader::READACK;
+		ack.frame_length = MEPHeader::SIZE + length;
+		itsNrReads++;
+		break;
+	}
+
+	case MEPHeader::WRITE:
+		if (size < MEPHeader::SIZE + length) {
+			return (0);
+		}
+		// Write to all addressed targets.
+		for (uint16 bits = dstid; bits; bits &= bits - 1) {
+			char*	reg = getRegister(targetIndex(bits & -bits), hdr.addr.pid, hdr.addr.regid, end);
+			memcpy(reg + hdr.offset, request + MEPHeader::SIZE, length);
+		}
+		ack.type         = MEPHeader::WRITEACK;
+		ack.frame_length = MEPHeader::SIZE;
+		itsNrWrites++;
+		break;
+
+	default:
+		return (0);
+	}
+
+	memcpy(reply, &ack, MEPHeader::SIZE);
+	itsBytesOut += ack.frame_length;
+	return (ack.frame_length);
+}
+
+//
+// RSPBoardEmulator: serves all boards on one raw socket.
+//
+class RSPBoardEmulator
+{
+public:
+	RSPBoardEmulator(const string& ifname, const vector<string>& macAddresses);
+	~RSPBoardEmulator();
+
+	// Serve the requests until ^C, report every reportInterval seconds.
+	void run(int reportInterval);
+
+private:
+	// Handle one frame, returns false if it was not for one of the boards.
+	bool handleFrame(char* frame, size_t size);
+
+	// Print the rates since the previous report.
+	void report(double seconds);
+
+	// Print the totals per board.
+	void summary() const;
+
+	// Convert a MAC address to a key in itsBoardMap.
+	static uint64 macKey(const unsigned char* mac);
+
+	int							itsFD;
+	int							itsIfIndex;
+	vector<EmulatedBoard>		itsBoards;
+	vector<vector<unsigned char> >	itsMacs;
+	map<uint64, int>			itsBoardMap;
+	char						itsReply[ETH_FRAME_LEN];
+	uint64						itsNrFrames;
+	uint64						itsLastBytes;
+	uint64						itsLastFrames;
+};
+
+uint64 RSPBoardEmulator::macKey(const unsigned char* mac)
+{
+	uint64	key = 0;
+	for (int i = 0; i < ETH_ALEN; i++) {
+		key = (key << 8) | mac[i];
+	}
+	return (key);
+}
+
+RSPBoardEmulator::RSPBoardEmulator(const string& ifname, const vector<string>& macAddresses) :
+	itsFD		 (-1),
+	itsIfIndex	 (0),
+	itsBoards	 (macAddresses.size()),
+	itsNrFrames	 (0),
+	itsLastBytes (0),
+	itsLastFrames(0)
+{
+	for (size_t b = 0; b < macAddresses.size(); b++) {
+		unsigned int	hx[ETH_ALEN] = { 0, 0, 0, 0, 0, 0 };
+		ASSERTSTR(sscanf(macAddresses[b].c_str(), "%x:%x:%x:%x:%x:%x",
+						 &hx[0], &hx[1], &hx[2], &hx[3], &hx[4], &hx[5]) == ETH_ALEN,
+				  "Invalid MAC address " << macAddresses[b]);
+		vector<unsigned char>	mac(hx, hx + ETH_ALEN);
+		itsMacs.push_back(mac);
+		itsBoardMap[macKey(&mac[0])] = b;
+	}
+
+	itsFD = socket(PF_PACKET, SOCK_RAW, htons(ETHERTYPE_EPA));
+	ASSERTSTR(itsFD >= 0, "socket(PF_PACKET): " << strerror(errno));
+
+	int	val = 4*1024*1024;
+	(void)setsockopt(itsFD, SOL_SOCKET, SO_RCVBUF, &val, sizeof(val));
+	(void)setsockopt(itsFD, SOL_SOCKET, SO_SNDBUF, &val, sizeof(val));
+
+	struct ifreq	ifr;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, ifname.c_str(), IFNAMSIZ-1);
+	ASSERTSTR(ioctl(itsFD, SIOCGIFINDEX, &ifr) == 0,
+			  "ioctl(SIOCGIFINDEX, " << ifname << "): " << strerror(errno));
+	itsIfIndex = ifr.ifr_ifindex;
+
+	struct sockaddr_ll	addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family   = AF_PACKET;
+	addr.sll_protocol = htons(ETHERTYPE_EPA);
+	addr.sll_ifindex  = itsIfIndex;
+	ASSERTSTR(bind(itsFD, (struct sockaddr*)&addr, sizeof(addr)) == 0,
+			  "bind(" << ifname << "): " << strerror(errno));
+
+	// The frames are addressed to the MAC addresses of the boards.
+	struct packet_mreq	mreq;
+	memset(&mreq, 0, sizeof(mreq));
+	mreq.mr_ifindex = itsIfIndex;
+	mreq.mr_type    = PACKET_MR_PROMISC;
+	if (setsockopt(itsFD, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+		LOG_WARN_STR("Cannot set " << ifname << " in promiscuous mode: " << strerror(errno));
+	}
+}
+
+RSPBoardEmulator::~RSPBoardEmulator()
+{
+	if (itsFD >= 0) {
+		close(itsFD);
+	}
+}
+
+bool RSPBoardEmulator::handleFrame(char* frame, size_t size)
+{
+	if (size < sizeof(struct ethhdr)) {
+		return (false);
+	}
+	struct ethhdr*	eth = (struct ethhdr*)frame;
+	map<uint64, int>::const_iterator	iter = itsBoardMap.find(macKey(eth->h_dest));
+	if (iter == itsBoardMap.end()) {
+		return (false);
+	}
+
+	struct ethhdr*	hdr       = (struct ethhdr*)itsReply;
+	size_t			replySize = itsBoards[iter->second].handle(frame + sizeof(struct ethhdr),
+										size - sizeof(struct ethhdr), itsReply + sizeof(struct ethhdr));
+	if (!replySize) {
+		return (true);
+	}
+	memcpy(hdr->h_dest,   eth->h_source,				ETH_ALEN);
+	memcpy(hdr->h_source, &itsMacs[iter->second][0],	ETH_ALEN);
+	hdr->h_proto = htons(ETHERTYPE_EPA);
+	replySize += sizeof(struct ethhdr);
+	if (replySize < ETH_ZLEN) {
+		memset(itsReply + replySize, 0, ETH_ZLEN - replySize);
+		replySize = ETH_ZLEN;
+	}
+
+	struct sockaddr_ll	addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family  = AF_PACKET;
+	addr.sll_ifindex = itsIfIndex;
+	addr.sll_halen   = ETH_ALEN;
+	memcpy(addr.sll_addr, hdr->h_dest, ETH_ALEN);
+	if (sendto(itsFD, itsReply, replySize, 0, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		LOG_WARN_STR("sendto: " << strerror(errno));
+	}
+	return (true);
+}
+
+void RSPBoardEmulator::run(int reportInterval)
+{
+	char			frame[ETH_FRAME_LEN + 64];
+	struct timeval	start, last, now;
+	gettimeofday(&start, 0);
+	last = start;
+
+	struct pollfd	pfd;
+	pfd.fd     = itsFD;
+	pfd.events = POLLIN;
+
+	while (!gStop) {
+		if (poll(&pfd, 1, 100) < 0 && errno != EINTR) {
+			LOG_ERROR_STR("poll: " << strerror(errno));
+			break;
+		}
+
+		// Empty the socket before polling again.
+		for (;;) {
+			struct sockaddr_ll	from;
+			socklen_t			fromLen = sizeof(from);
+			ssize_t	size = recvfrom(itsFD, frame, sizeof(frame), MSG_DONTWAIT,
+									(struct sockaddr*)&from, &fromLen);
+			if (size < 0) {
+				break;
+			}
+			// Skip our own replies on the same interface.
+			if (from.sll_pkttype == PACKET_OUTGOING) {
+				continue;
+			}
+			if (handleFrame(frame, size)) {
+				itsNrFrames++;
+			}
+		}
+
+		gettimeofday(&now, 0);
+		double	seconds = (now.tv_sec - last.tv_sec) + (now.tv_usec - last.tv_usec) / 1e6;
+		if (reportInterval > 0 && seconds >= reportInterval) {
+			report(seconds);
+			last = now;
+		}
+	}
+
+	summary();
+}
+
+void RSPBoardEmulator::report(double seconds)
+{
+	uint64	bytes = 0;
+	int		active = 0;
+	for (size_t b = 0; b < itsBoards.size(); b++) {
+		bytes += itsBoards[b].itsBytesIn + itsBoards[b].itsBytesOut;
+		if (itsBoards[b].itsNrReads + itsBoards[b].itsNrWrites) {
+			active++;
+		}
+	}
+	cout << formatString("%d active boards, %.0f msgs/s, %.3f MB/s",
+						 active,
+						 (itsNrFrames - itsLastFrames) / seconds,
+						 (bytes - itsLastBytes) / (1e6 * seconds)) << endl;
+	itsLastFrames = itsNrFrames;
+	itsLastBytes  = bytes;
+}
+
+void RSPBoardEmulator::summary() const
+{
+	cout << "board       reads      writes    bytes in   bytes out" << endl;
+	for (size_t b = 0; b < itsBoards.size(); b++) {
+		const EmulatedBoard&	board = itsBoards[b];
+		cout << formatString("%5d %11llu %11llu %11llu %11llu", (int)b,
+							 (unsigned long long)board.itsNrReads,
+							 (unsigned long long)board.itsNrWrites,
+							 (unsigned long long)board.itsBytesIn,
+							 (unsigned long long)board.itsBytesOut) << endl;
+	}
+}
+
+  } // namespace RSP_Test
+} // namespace LOFAR
+
+using namespace LOFAR;
+using namespace RSP_Test;
+
+int main(int argc, char** argv)
+{
+	if (argc < 3) {
+		cerr << "Usage: " << argv[0] << " ifname RSPDriver.conf [nrBoards [reportInterval]]" << endl;
+		return (1);
+	}
+
+	INIT_LOGGER("RSPBoardEmulator");
+
+	try {
+		ParameterSet	ps(argv[2]);
+		int		nrBoards       = (argc > 3) ? atoi(argv[3]) : -1;
+		int		reportInterval = (argc > 4) ? atoi(argv[4]) : 10;
+
+		vector<string>	macAddresses;
+		for (int b = 0; nrBoards < 0 || b < nrBoards; b++) {
+			string	key(formatString("RSPDriver.MAC_ADDR_%d", b));
+			if (!ps.isDefined(key)) {
+				ASSERTSTR(nrBoards < 0, "No " << key << " in " << argv[2]);
+				break;
+			}
+			macAddresses.push_back(ps.getString(key));
+		}
+
+		RSPBoardEmulator	emulator(argv[1], macAddresses);
+		cout << "Emulating " << macAddresses.size() << " RSP boards on " << argv[1] << endl;
+
+		signal(SIGINT,  stopHandler);
+		signal(SIGTERM, stopHandler);
+		emulator.run(reportInterval);
+	}
+	catch (Exception& e) {
+		cerr << e << endl;
+		return (1);
+	}
+
+	return (0);
+}
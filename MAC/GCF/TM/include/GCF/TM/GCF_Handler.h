@@ -24,6 +24,7 @@
 #define GCF_HANDLER_H
 
 //# Includes
+#include <Common/LofarTypes.h>
 
 
 namespace LOFAR {
@@ -76,6 +77,13 @@ namespace LOFAR {
   --------+-------
   PVSS    | 1µs
   Socket  | 10ms 
+
+  Nowadays only the Socket (file) handler blocks. It waits in epoll until a
+  file becomes readable or until the earliest moment another handler needs to
+  be invoked again, which each handler tells with waitTime(). The timer
+  handler returns the time until its first timer expires, so timers do not
+  need polling. Handlers that still need polling (like PVSS) keep the default
+  of 10ms.
  */
 
 class GCFHandler
@@ -90,6 +98,10 @@ public:
   
     virtual void workProc () = 0;
     virtual void stop () = 0;
+    /// @return max nr of microseconds the main loop may block before the
+    /// workProc of this handler has to be called again (-1 = no limit,
+    /// the handler is only woken up by file I/O). The default is 10ms.
+    virtual int64 waitTime () const { return (10000); }
     virtual ~GCFHandler() {;}
 
 protected:
@@ -147,6 +147,11 @@ public:
     // deregisters a GCFHandler from the mainloop
     void deregisterHandler (GCFHandler& handler);
 
+    // returns the max nr of microseconds the main loop may block waiting
+    // for I/O; it is 0 if events are queued, otherwise the minimum of
+    // the waitTime of all handlers (-1 = no limit).
+    int64 maxWaitTime () const;
+
     // stops the application; it stops all registered handlers
     void stop () {  itsDoExit = true; }
 
@@ -237,6 +242,9 @@ private:
 
 	bool	itsUseQueue;
 
+	// Time (sec since epoch) a limited run stops, 0.0 if not limited.
+	double	itsTerminateTime;
+
 	// Route administration
 	class RouteInfo {
 	public:
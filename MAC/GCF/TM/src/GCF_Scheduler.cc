@@ -73,6 +73,7 @@ GCFScheduler::GCFScheduler() :
 	itsDelayedQuit	(false),
 	itsIsInitialized(false),
 	itsUseQueue		(true),
+	itsTerminateTime(0.0),
 	itsFrameworkPort(0)
 {
  	itsFrameworkPort = new GCFDummyPort(0, "FrameWork", F_FSM_PROTOCOL);
@@ -164,6 +165,7 @@ void GCFScheduler::run(double maxSecondsToRun)
 		gettimeofday(&TV, 0);
 		terminateTime = TV.tv_sec + (TV.tv_usec / 10000000) + maxSecondsToRun;
 	}
+	itsTerminateTime = terminateTime;
 
 	LOG_DEBUG("Entering main loop of GCFScheduler");
 
@@ -195,6 +197,8 @@ void GCFScheduler::run(double maxSecondsToRun)
 		}
 	} // while
 
+	itsTerminateTime = 0.0;
+
 	if (!itsDelayedQuit) {
 		stopHandlers();
 	}
@@ -264,6 +268,38 @@ void GCFScheduler::deregisterHandler(GCFHandler& handler)
 	itsHandlers.erase(&handler);
 }
 
+//
+// maxWaitTime()
+//
+int64 GCFScheduler::maxWaitTime() const
+{
+	if (!theEventQueue.empty() || itsDoExit) {
+		return (0);
+	}
+	int64	waitTime(-1);
+	for (HandlerMap_t::const_iterator iter = itsHandlers.begin(); iter != itsHandlers.end(); ++iter) {
+		if (iter->second) {
+			int64	handlerWait(iter->first->waitTime());
+			if (handlerWait >= 0 && (waitTime < 0 || handlerWait < waitTime)) {
+				waitTime = handlerWait;
+			}
+		}
+	}
+	// don't sleep beyond the end of a limited run.
+	if (itsTerminateTime > 0.0) {
+		struct timeval	TV;
+		gettimeofday(&TV, 0);
+		int64	untilEnd = (int64)((itsTerminateTime - TV.tv_sec) * 1000000.0) - TV.tv_usec;
+		if (untilEnd < 0) {
+			untilEnd = 0;
+		}
+		if (waitTime < 0 || untilEnd < waitTime) {
+			waitTime = untilEnd;
+		}
+	}
+	return (waitTime);
+}
+
 //
 // _sendEvent
 //
@@ -26,12 +26,20 @@
 #include "GTM_FileHandler.h"
 #include "GTM_File.h"
 #include <GCF/TM/GCF_Task.h>
+#include <GCF/TM/GCF_Scheduler.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <cstring>
+#include <cerrno>
 
 namespace LOFAR {
  namespace GCF {
   namespace TM {
 GTMFileHandler* GTMFileHandler::_pInstance = 0;
 
+// Max number of ready filedescriptors handled per workProc call.
+static const int MAX_EVENTS = 64;
+
 GTMFileHandler* GTMFileHandler::instance()
 {
 	if (0 == _pInstance) {
@@ -55,56 +63,107 @@ void GTMFileHandler::release()
 }
 
 GTMFileHandler::GTMFileHandler() : 
+	_epollFD(-1),
+	_timerFD(-1),
 	_running(true)
 {
-	FD_ZERO(&_readFDs);
+	_epollFD = ::epoll_create1(EPOLL_CLOEXEC);
+	ASSERTSTR(_epollFD >= 0, "epoll_create1 failed: " << strerror(errno));
+
+	// The timerfd wakes up the epoll_wait when another handler needs attention.
+	_timerFD = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	ASSERTSTR(_timerFD >= 0, "timerfd_create failed: " << strerror(errno));
+	struct epoll_event	event;
+	memset(&event, 0, sizeof(event));
+	event.events  = EPOLLIN;
+	event.data.fd = _timerFD;
+	ASSERTSTR(::epoll_ctl(_epollFD, EPOLL_CTL_ADD, _timerFD, &event) == 0,
+			  "epoll_ctl failed for timerfd: " << strerror(errno));
+}
+
+GTMFileHandler::~GTMFileHandler()
+{
+	::close(_timerFD);
+	::close(_epollFD);
+	_pInstance = 0;
 }
 
 void GTMFileHandler::registerFile(GTMFile& file)
 {
 	LOG_TRACE_OBJ_STR("Adding filedescriptor " << file.getFD());
-	FD_SET(file.getFD(), &_readFDs);
+	struct epoll_event	event;
+	memset(&event, 0, sizeof(event));
+	event.events  = EPOLLIN;
+	event.data.fd = file.getFD();
+	int	op = (_files.find(file.getFD()) == _files.end()) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+	if (::epoll_ctl(_epollFD, op, file.getFD(), &event) != 0) {
+		if (errno == EPERM) {
+			// A regular file: it never blocks, so it is always ready.
+			LOG_DEBUG_STR("Filedescriptor " << file.getFD() << " cannot be polled, handling it in every pass");
+			_alwaysReady.insert(file.getFD());
+		}
+		else {
+			LOG_ERROR_STR("Cannot add filedescriptor " << file.getFD() << " to epoll: " << strerror(errno));
+		}
+	}
 	_files[file.getFD()] = &file;
 }
 
 void GTMFileHandler::deregisterFile(GTMFile& file)
 {
 	LOG_TRACE_OBJ_STR("Removing filedescriptor " << file.getFD());
-	FD_CLR(file.getFD(), &_readFDs);
+	// Note: the kernel already removed it if the fd was closed, so ignore errors.
+	struct epoll_event	event;
+	(void)::epoll_ctl(_epollFD, EPOLL_CTL_DEL, file.getFD(), &event);
+	_alwaysReady.erase(file.getFD());
 	_files.erase(file.getFD());  
 }
 
 void GTMFileHandler::workProc()
 {
-	int				result;
-	TFiles 			testFiles;
-	struct timeval	select_timeout;
-
- 	//
-	// because select call changes the timeout value to
-	// contain the remaining time we need to set it to 10ms
-	// on every call to workProc
-	// 
-	select_timeout.tv_sec  = 0;
-	select_timeout.tv_usec = 10000;
+	// Determine how long we may sleep: not at all when events are waiting
+	// to be handled, otherwise until the first handler wants to run.
+	int64	waitTime = GCFScheduler::instance()->maxWaitTime();
+	int		timeout(-1);
+	struct itimerspec	alarm;
+	memset(&alarm, 0, sizeof(alarm));
+	if (waitTime == 0 || !_alwaysReady.empty()) {
+		timeout = 0;
+	}
+	else if (waitTime > 0) {
+		alarm.it_value.tv_sec  = waitTime / 1000000;
+		alarm.it_value.tv_nsec = (waitTime % 1000000) * 1000;
+	}
+	// (re)arm or disarm the wakeup timer.
+	::timerfd_settime(_timerFD, 0, &alarm, 0);
 
 	_running = true;
-	fd_set testFDs = _readFDs;
-	testFiles = _files;
-
-	// map keys are sorted low-to-high, so last key is highest
-	int maxfd = testFiles.empty() ? 0 : testFiles.rbegin()->first;
-
-	// wait for any file to be readable, or for our timeout
-	result = ::select(maxfd + 1, &testFDs, (fd_set *) 0, (fd_set *) 0, &select_timeout);
-
-	if (result >= 0) {
-		for (TFiles::iterator i = testFiles.begin(); i != testFiles.end() && _running; ++i) {
-			int fd = i->first;
-			GTMFile *file = i->second;
+	struct epoll_event	events[MAX_EVENTS];
+	int	result = ::epoll_wait(_epollFD, events, MAX_EVENTS, timeout);
+
+	for (int i = 0; i < result && _running; ++i) {
+		int	fd = events[i].data.fd;
+		if (fd == _timerFD) {
+			uint64	expirations;
+			(void)::read(_timerFD, &expirations, sizeof(expirations));
+			continue;
+		}
+		// look up the file at this moment: an earlier doWork may have
+		// closed it.
+		TFiles::iterator	iter = _files.find(fd);
+		if (iter != _files.end()) {
+			iter->second->doWork();
+		}
+	}
 
-			if (FD_ISSET(fd, &testFDs)) {
-				file->doWork();
+	// The files epoll cannot watch are always ready. Copy the set, because
+	// doWork may close files.
+	if (!_alwaysReady.empty()) {
+		set<int>	readyFDs(_alwaysReady);
+		for (set<int>::iterator fdIter = readyFDs.begin(); fdIter != readyFDs.end() && _running; ++fdIter) {
+			TFiles::iterator	iter = _files.find(*fdIter);
+			if (iter != _files.end()) {
+				iter->second->doWork();
 			}
 		}
 	}
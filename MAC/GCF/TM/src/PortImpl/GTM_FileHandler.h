@@ -25,6 +25,7 @@
 
 #include <GCF/TM/GCF_Handler.h>
 #include <Common/lofar_map.h>
+#include <Common/lofar_set.h>
 #include <sys/time.h>
 
 namespace LOFAR 
@@ -38,14 +39,19 @@ class GTMFile;
 
 /**
  * This singleton class implements the main loop part of message exchange 
- * handling, which uses the "file" pattern. It calls one select for all file 
- * descriptors of the registered "files".
+ * handling, which uses the "file" pattern. It waits in one epoll for all file 
+ * descriptors of the registered "files". Regular files cannot be waited for
+ * and are handled in every pass, as select() reported them always readable.
+ * The wait is bounded by a timerfd which is armed at the moment the next
+ * handler (e.g. the first timer) needs attention (see
+ * GCFScheduler::maxWaitTime), so the process sleeps when idle and timers
+ * expire without the jitter of a polling interval.
  */
 class GTMFileHandler : public GCFHandler
 {
 public: 
 	// constructors, destructors and default operators
-    virtual ~GTMFileHandler () { _pInstance = 0;}
+    virtual ~GTMFileHandler ();
 
 	// GTMFileHandler specific member methods
     /// singleton pattern methods
@@ -54,6 +60,7 @@ public:
 
     void workProc (); /// part of the mainloop
     void stop ();
+    int64 waitTime () const { return (-1); } /// only woken up by I/O
     void registerFile (GTMFile& file);
     void deregisterFile (GTMFile& file); 
 
@@ -72,11 +79,15 @@ private:
     /// all registered "files"
     typedef map<int, GTMFile*> TFiles;
     TFiles _files;
+
+    /// registered files that epoll cannot watch (regular files); like
+    /// select(), we regard them as always readable
+    set<int> _alwaysReady;
    
-    /// needed for the "::select" method
-    fd_set _readFDs;
-    fd_set _writeFDs;
-    fd_set _errorFDs;
+    /// needed for the "::epoll_wait" method
+    int _epollFD;
+    /// bounds the time of the "::epoll_wait"
+    int _timerFD;
     
     bool _running;    
 };
@@ -44,41 +44,35 @@ GTMTimer::GTMTimer(GCFRawPort& port,
                    uint64 timeVal, 
                    uint64 intervalTime, 
                    void* arg) :
-  _port(port), _id(id), _time(timeVal),
-  _timeLeft(timeVal), 
+  _port(port), _id(id), _expiry(now() + timeVal),
   _intervalTime(intervalTime), 
   _arg(arg), _elapsed(false), _canceled(false)
 {
-  saveTime();
   LOG_DEBUG(formatString("Creation of timer %d of port %s", id, port.getName().c_str()));
 }
  
-void GTMTimer::decreaseTime()
+uint64 GTMTimer::now()
 {
-	int64 uSec = getElapsedTime();
-//	if (_port.getName() == "childControlTimer") {
-//		LOG_TRACE_STAT(formatString("Timer %d(%s): Telapsed= %lld, Tleft=%llu", _id, _port.getName().c_str(), uSec, _timeLeft));
-//	}
+	struct timespec	ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
 
-	// REO: uSec < 0 ??? 
-	if ((uSec < (int64)(_timeLeft)) || (uSec < 0)) {
-		_timeLeft -= uSec;
-		if (uSec < 0) {
-			LOG_WARN(formatString("Elapsed time of timer %d (%s) is NEGATIVE!: %llu", _id, _port.getName().c_str(), uSec));
-		}
-//		if (_port.getName() == "childControlTimer") {
-//			LOG_TRACE_STAT(formatString("Timer %d(%s): Tleft=>%llu", _id, _port.getName().c_str(), _timeLeft));
-//		}
-		return;
-	}
+double GTMTimer::getTimeLeft() const
+{
+	uint64	curTime(now());
+	return ((_expiry > curTime) ? (double)(_expiry - curTime) / 1000000.0 : 0.0);
+}
 
+bool GTMTimer::expire(uint64 curTime)
+{
 	// timer expired
-	struct timeval now;
-	(void)gettimeofday(&now, NULL);
+	struct timeval wallTime;
+	(void)gettimeofday(&wallTime, NULL);
 
 	GCFTimerEvent te;
-	te.sec  = now.tv_sec;
-	te.usec = now.tv_usec;
+	te.sec  = wallTime.tv_sec;
+	te.usec = wallTime.tv_usec;
 	te.id   = _id;
 	te.arg  = _arg;
 	GCFScheduler::instance()->queueEvent(0, te, &_port);
@@ -86,42 +80,21 @@ void GTMTimer::decreaseTime()
 	if (_intervalTime == 0) {
 		_elapsed = true;
 		LOG_TRACE_STAT(formatString("Timer %d(%s): elapsed", _id, _port.getName().c_str()));
-		return;
+		return (false);
 	}
 
-	uint64 timeoverflow = uSec - _timeLeft;
+	uint64 timeoverflow = curTime - _expiry;
 	if (_intervalTime < timeoverflow) {
 		LOG_ERROR(formatString(
-			"Timerinterval %fsec of timer %d is to small for performance reasons (tdelta: %lld, tleft: %llu).",
-			((double) _intervalTime) / 1000000.0, _id, uSec, _timeLeft));
-		do {
-		  timeoverflow -= _intervalTime;
-		} while (_intervalTime < timeoverflow);        
+			"Timerinterval %fsec of timer %d is to small for performance reasons (tdelta: %llu).",
+			((double) _intervalTime) / 1000000.0, _id, timeoverflow));
+		// skip the missed intervals
+		timeoverflow %= _intervalTime;
 	}
 
-	_timeLeft = _intervalTime - timeoverflow;
-	LOG_TRACE_STAT(formatString("RepTimer %d(%s): Tleft=>%llu", _id, _port.getName().c_str(), _timeLeft));
-}
-
-void GTMTimer::saveTime()
-{
-	struct timezone timeZone;
-	gettimeofday(&_savedTime, &timeZone);
-}
-
-int64 GTMTimer::getElapsedTime()
-{
-	timeval oldTime(_savedTime);
-	int64 	uSecDiff(0);
-
-	saveTime();
-
-	uSecDiff = ((uint64) (_savedTime.tv_usec) + 
-				(uint64) (_savedTime.tv_sec) * 1000000) - 
-			   ((uint64) (oldTime.tv_usec) +
-				(uint64) (oldTime.tv_sec) * 1000000);
-
-	return (uSecDiff);
+	_expiry = curTime + _intervalTime - timeoverflow;
+	LOG_TRACE_STAT(formatString("RepTimer %d(%s): Tleft=>%llu", _id, _port.getName().c_str(), _expiry - curTime));
+	return (true);
 }
 
 #if 0
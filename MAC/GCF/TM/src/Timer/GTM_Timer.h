@@ -41,6 +41,8 @@ class GTMTimerHandler;
  * This class represents an initialised timer on user request. It supports 
  * single and interval timers. On each timer an object can be attached. A timer 
  * can only be initialised by means of a certain port via the timer handler.
+ * The timer holds the absolute (monotonic) time it expires, so the timer
+ * handler can keep the timers ordered on expiry time.
  */
 class GTMTimer
 {
@@ -57,33 +59,35 @@ public:
 	inline bool		   isElapsed  () const 	{ return (_elapsed);	}
 	inline bool		   isCanceled () const 	{ return (_canceled);	}
 	inline void		   cancel     () 		{ _canceled = true;		}
-	inline double	   getTimeLeft() const	{ return ((double)_timeLeft / 1000000.0); }
+	inline unsigned long getID    () const	{ return (_id);			}
+	inline uint64	   getExpiry  () const	{ return (_expiry);		}
+	double			   getTimeLeft() const;
     
 	/**
-	 * Decreases the time of this timer 
-	 * It will be called by workProc method of the GTMTimerHandler, which 
-	 * determines the elapsed time to the previous workProc invocation for all 
-	 * registered timers once.
+	 * Sends the F_TIMER event to the port and, for an interval timer,
+	 * calculates the next expiry time.
+	 * It will be called by workProc method of the GTMTimerHandler when the
+	 * expiry time has passed.
+	 * @return true if the timer has to be scheduled again (interval timer).
 	 */
-	void decreaseTime ();
+	bool expire (uint64 now);
 
-private: 
-	// helper methods
-	void	saveTime ();
-	int64	getElapsedTime();
+	/**
+	 * Returns the current monotonic time in uSec.
+	 */
+	static uint64 now ();
 
+private: 
 	// attributes
 	GCFRawPort&     _port;
 	unsigned long   _id;
-	uint64          _time;				// in uSec
-	uint64          _timeLeft;			// in uSec
+	uint64          _expiry;			// monotonic time in uSec
 	uint64          _intervalTime;		// in uSec
 	void*           _arg; // this pointer should NEVER be modified by the GTMTimer class!!
 
 	// helper attribs.
 	bool            _elapsed;
 	bool            _canceled;
-	timeval         _savedTime;
 };
   } // namespace TM
  } // namespace GCF
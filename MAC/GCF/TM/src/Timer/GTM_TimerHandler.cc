@@ -59,7 +59,8 @@ void GTMTimerHandler::release()
 }
 
 GTMTimerHandler::GTMTimerHandler() :
-  _running(true)
+  _running(true),
+  _nextTimerID(1)
 {  
 }
 
@@ -72,6 +73,8 @@ GTMTimerHandler::~GTMTimerHandler()
     delete pCurTimer;
   }
   _timers.clear();
+  _expiryQueue.clear();
+  _garbage.clear();
   _pInstance = 0;
 }
 
@@ -82,40 +85,61 @@ void GTMTimerHandler::stop()
  
 void GTMTimerHandler::workProc()
 {
-  GTMTimer* pCurTimer(0);
-
-  TTimers tempTimers;
-  tempTimers.insert(_timers.begin(), _timers.end());
-    
-  for (TTimers::iterator iter = tempTimers.begin(); iter != tempTimers.end() && _running; ++iter) {
-    pCurTimer = iter->second;
-    ASSERT(pCurTimer);
-    if (pCurTimer->isElapsed() || pCurTimer->isCanceled()) {
-	  LOG_TRACE_STAT(formatString("Deleting timer %d(%s),elapse=%c,cancel=%c", iter->first, pCurTimer->getPort().getName().c_str(),
+  // delete the timers that elapsed or were canceled since the last call.
+  // Note: they are kept until now, because their port may still refer to them.
+  for (vector<unsigned long>::iterator iter = _garbage.begin(); iter != _garbage.end(); ++iter) {
+    TTimers::iterator timerIter = _timers.find(*iter);
+    if (timerIter != _timers.end()) {
+      GTMTimer* pCurTimer(timerIter->second);
+      LOG_TRACE_STAT(formatString("Deleting timer %d(%s),elapse=%c,cancel=%c", *iter, pCurTimer->getPort().getName().c_str(),
 						(pCurTimer->isElapsed() ? 'Y' : 'N'), (pCurTimer->isCanceled() ? 'Y' : 'N')));
       delete pCurTimer;
-      _timers.erase(iter->first);
+      _timers.erase(timerIter);
+    }
+  }
+  _garbage.clear();
+
+  // expire all timers of which the expiry time has passed.
+  uint64 now(GTMTimer::now());
+  while (_running && !_expiryQueue.empty() && _expiryQueue.begin()->first <= now) {
+    unsigned long timerid(_expiryQueue.begin()->second);
+    _expiryQueue.erase(_expiryQueue.begin());
+    TTimers::iterator timerIter = _timers.find(timerid);
+    ASSERT(timerIter != _timers.end());
+    GTMTimer* pCurTimer(timerIter->second);
+    // Note: expire may send the event directly, which can add or cancel timers.
+    if (pCurTimer->expire(now) && !pCurTimer->isCanceled()) {
+      _expiryQueue.insert(make_pair(pCurTimer->getExpiry(), timerid));
     }
     else {
-      pCurTimer->decreaseTime();	// and dispatch F_TIMER when elapsed
+      _garbage.push_back(timerid);
     }
   }
 }
 
+int64 GTMTimerHandler::waitTime() const
+{
+  if (!_garbage.empty()) {
+    return (0);
+  }
+  if (_expiryQueue.empty()) {
+    return (-1);
+  }
+  uint64 now(GTMTimer::now());
+  uint64 expiry(_expiryQueue.begin()->first);
+  return ((expiry > now) ? (int64)(expiry - now) : 0);
+}
+
 unsigned long GTMTimerHandler::setTimer(GCFRawPort& port, 
 					uint64 delaySeconds, 
 					uint64 intervalSeconds,
 					void*  arg)
 {
-  unsigned long timerid(1);
-
-  // search the first unused timerid
-  TTimers::iterator iter;
-  do {
-    timerid++;
-    iter = _timers.find(timerid);
+  // take the next unused timerid (0 is never used)
+  while (_nextTimerID == 0 || _timers.find(_nextTimerID) != _timers.end()) {
+    _nextTimerID++;
   }
-  while (iter != _timers.end());  
+  unsigned long timerid(_nextTimerID++);
 
   GTMTimer* pNewTimer = new GTMTimer(port, 
 				     timerid,
@@ -123,10 +147,20 @@ unsigned long GTMTimerHandler::setTimer(GCFRawPort& port,
 				     intervalSeconds,
 				     arg);
   _timers[timerid] = pNewTimer;
+  _expiryQueue.insert(make_pair(pNewTimer->getExpiry(), timerid));
 
   return timerid;
 }
 
+void GTMTimerHandler::removeTimer(GTMTimer* pTimer)
+{
+  // Note: the timer is not in the queue while it is expiring.
+  if (_expiryQueue.erase(make_pair(pTimer->getExpiry(), pTimer->getID())) > 0) {
+    _garbage.push_back(pTimer->getID());
+  }
+  pTimer->cancel();		// Note: sets internal flag in Timer.
+}
+
 int GTMTimerHandler::cancelTimer(unsigned long timerid, void** arg)
 {
 	// allow timerid 0
@@ -150,7 +184,9 @@ int GTMTimerHandler::cancelTimer(unsigned long timerid, void** arg)
 	if (arg) {
 		*arg = pCurTimer->getTimerArg();
 	}
-	pCurTimer->cancel();		// Note: sets internal flag in Timer.
+	if (!pCurTimer->isCanceled() && !pCurTimer->isElapsed()) {
+		removeTimer(pCurTimer);
+	}
 
 	return (1);
 }
@@ -164,7 +200,9 @@ int GTMTimerHandler::cancelAllTimers(GCFRawPort& port)
     pCurTimer = iter->second;
     ASSERT(pCurTimer);
     if (&(pCurTimer->getPort()) == &port) {  
-      pCurTimer->cancel();
+      if (!pCurTimer->isCanceled() && !pCurTimer->isElapsed()) {
+        removeTimer(pCurTimer);
+      }
       result++;
     }
   }
@@ -24,6 +24,8 @@
 #define GTM_TIMERHANDLER_H
 
 #include <Common/lofar_map.h>
+#include <Common/lofar_set.h>
+#include <Common/lofar_vector.h>
 #include <Common/LofarTypes.h>
 #include <GCF/TM/GCF_Handler.h>
 
@@ -38,6 +40,9 @@ class GCFRawPort;
  * This singleton class implements the part of the application main loop, which 
  * provides the possibility to receive asynchronous time outs in a task of the 
  * application.
+ * The running timers are kept ordered on expiry time, so setting, canceling
+ * and expiring a timer takes O(log n) and the main loop knows how long it can
+ * sleep (see waitTime).
  */
 class GTMTimerHandler : GCFHandler
 {
@@ -48,6 +53,8 @@ class GTMTimerHandler : GCFHandler
 
     void workProc ();
     void stop ();
+    /// @return uSec until the first timer expires (-1 = no timers)
+    int64 waitTime () const;
 
     unsigned long setTimer (GCFRawPort& port, 
                             uint64 delaySeconds, 
@@ -67,9 +74,18 @@ class GTMTimerHandler : GCFHandler
     GTMTimerHandler (const GTMTimerHandler&);
     GTMTimerHandler& operator= (const GTMTimerHandler&);
     
+    // Remove the timer from the expiry queue and schedule it for deletion.
+    void removeTimer (GTMTimer* pTimer);
+
     bool        _running;
     typedef map<unsigned long, GTMTimer*> TTimers;
     TTimers _timers;
+    /// the running timers ordered on expiry time
+    typedef set<pair<uint64, unsigned long> > TExpiryQueue;
+    TExpiryQueue _expiryQueue;
+    /// ids of elapsed or canceled timers to be deleted in the next workProc
+    vector<unsigned long> _garbage;
+    unsigned long _nextTimerID;
 };
   } // namespace TM
  } // namespace GCF
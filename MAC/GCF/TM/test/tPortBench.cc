@@ -0,0 +1,213 @@
+//
+//  tPortBench.cc: Benchmark of the event latency and idle cpu of the GCF mainloop with many ports.
+//
+//  Copyright (C) 2016
+//  ASTRON (Netherlands Foundation for Research in Astronomy)
+//  P.O.Box 2, 7990 AA Dwingeloo, The Netherlands, softwaresupport@astron.nl
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  $Id$
+//
+//  Usage: tPortBench [nrPorts [seconds]]
+//  Opens nrPorts device ports on named pipes. Every 10 ms a timestamp is
+//  written into a random one of the pipes. Reports the latency of the
+//  F_DATAIN events (moment the task receives the event minus the moment the
+//  timestamp was written) and the cpu time used by the process, which mainly
+//  waits. Run it with different numbers of ports to see how the mainloop
+//  scales with the number of idle ports.
+
+#include <lofar_config.h>
+#include <Common/LofarLogger.h>
+#include <Common/StringUtil.h>
+#include <Common/lofar_vector.h>
+#include <GCF/TM/GCF_Control.h>
+#include <GCF/TM/GCF_DevicePort.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+namespace LOFAR {
+ namespace GCF {
+  namespace TM {
+
+class tPortBench : public GCFTask
+{
+public:
+	tPortBench (string name, int nrPorts, const string& dir);
+	~tPortBench();
+
+	GCFEvent::TResult test1 (GCFEvent& e, GCFPortInterface& p);
+
+	void showResults (double seconds) const;
+
+private:
+	static double wallTime();
+	string pipeName (int nr) const;
+
+	GCFTimerPort*			itsTimerPort;
+	vector<GCFDevicePort*>	itsPorts;
+	vector<int>				itsWriteFDs;
+	int						itsNrPorts;
+	int						itsNrConnected;
+	string					itsDir;
+	vector<double>			itsLatencies;
+};
+
+tPortBench::tPortBench(string name, int nrPorts, const string& dir) :
+	GCFTask         ((State)&tPortBench::test1, name),
+	itsTimerPort    (0),
+	itsNrPorts		(nrPorts),
+	itsNrConnected	(0),
+	itsDir			(dir)
+{
+}
+
+tPortBench::~tPortBench()
+{
+	for (uint i = 0; i < itsPorts.size(); i++) {
+		delete itsPorts[i];
+	}
+	for (uint i = 0; i < itsWriteFDs.size(); i++) {
+		::close(itsWriteFDs[i]);
+		::unlink(pipeName(i).c_str());
+	}
+	delete itsTimerPort;
+}
+
+double tPortBench::wallTime()
+{
+	struct timeval	tv;
+	gettimeofday(&tv, 0);
+	return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+string tPortBench::pipeName(int nr) const
+{
+	return (formatString("%s/pipe%d", itsDir.c_str(), nr));
+}
+
+GCFEvent::TResult tPortBench::test1(GCFEvent& event, GCFPortInterface& port)
+{
+	GCFEvent::TResult status = GCFEvent::HANDLED;
+
+	switch (event.signal) {
+	case F_ENTRY:
+		itsTimerPort = new GCFTimerPort(*this, "timerPort");
+		ASSERTSTR(itsTimerPort, "Failed to open timerport");
+		break;
+
+	case F_INIT:
+		// Opening a fifo for reading and writing does not wait for the other side.
+		for (int i = 0; i < itsNrPorts; i++) {
+			ASSERTSTR(::mkfifo(pipeName(i).c_str(), 0600) == 0, "Cannot create " << pipeName(i));
+			int	fd = ::open(pipeName(i).c_str(), O_RDWR | O_NONBLOCK);
+			ASSERTSTR(fd >= 0, "Cannot open " << pipeName(i));
+			itsWriteFDs.push_back(fd);
+
+			GCFDevicePort*	devPort = new GCFDevicePort(*this, formatString("port%d", i), 0, pipeName(i), true);
+			itsPorts.push_back(devPort);
+			devPort->open();
+		}
+		break;
+
+	case F_CONNECTED:
+		if (++itsNrConnected == itsNrPorts) {
+			LOG_INFO_STR(itsNrPorts << " ports opened");
+			srand(1);
+			itsTimerPort->setTimer(0.01, 0.01);
+		}
+		break;
+
+	case F_TIMER: {
+		double	now = wallTime();
+		ssize_t	written = ::write(itsWriteFDs[rand() % itsNrPorts], &now, sizeof(now));
+		ASSERTSTR(written == sizeof(now), "Cannot write to a pipe");
+		break;
+	}
+
+	case F_DATAIN: {
+		double	sent;
+		if (port.recv(&sent, sizeof(sent)) == sizeof(sent)) {
+			itsLatencies.push_back(wallTime() - sent);
+		}
+		break;
+	}
+
+	default:
+		status = GCFEvent::NOT_HANDLED;
+		break;
+	}
+
+	return status;
+}
+
+void tPortBench::showResults(double seconds) const
+{
+	struct rusage	usage;
+	getrusage(RUSAGE_SELF, &usage);
+	double	cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+				  usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+
+	vector<double>	lat(itsLatencies);
+	std::sort(lat.begin(), lat.end());
+	std::cout << "ports:           " << itsNrPorts << std::endl;
+	std::cout << "events:          " << lat.size() << std::endl;
+	if (!lat.empty()) {
+		std::cout << "latency median:  " << lat[lat.size()/2] * 1e6 << " us" << std::endl;
+		std::cout << "latency 99%:     " << lat[lat.size()*99/100] * 1e6 << " us" << std::endl;
+		std::cout << "latency max:     " << lat.back() * 1e6 << " us" << std::endl;
+	}
+	std::cout << "cpu usage:       " << 100.0 * cpu / seconds << " %" << std::endl;
+}
+
+  } // namespace TM
+ } // namespace GCF
+} // namespace LOFAR
+
+using namespace LOFAR::GCF::TM;
+
+//
+// MAIN()
+//
+int main(int argc, char* argv[])
+{
+	int		nrPorts = (argc > 1) ? atoi(argv[1]) : 400;
+	double	seconds = (argc > 2) ? atof(argv[2]) : 10.0;
+
+	char	dir[] = "/tmp/tPortBench.XXXXXX";
+	ASSERTSTR(::mkdtemp(dir), "Cannot create a temporary directory");
+
+	GCFScheduler::instance()->init(argc, argv);
+
+	{
+		tPortBench	benchTask("PortBench", nrPorts, dir);
+
+		benchTask.start(); // make initial transition
+
+		GCFScheduler::instance()->run(seconds);
+
+		benchTask.showResults(seconds);
+	}
+
+	::rmdir(dir);
+
+	return (0);
+}
@@ -0,0 +1,169 @@
+//
+//  tTimerBench.cc: Benchmark of the timer latency and idle cpu of the GCF mainloop.
+//
+//  Copyright (C) 2016
+//  ASTRON (Netherlands Foundation for Research in Astronomy)
+//  P.O.Box 2, 7990 AA Dwingeloo, The Netherlands, softwaresupport@astron.nl
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  $Id$
+//
+//  Usage: tTimerBench [nrTimers [seconds]]
+//  Starts nrTimers interval timers with intervals between 0.1 and 1 sec and
+//  reports the latency of the F_TIMER events (moment the task receives the
+//  event minus the moment the timer should expire) and the cpu time used by
+//  the process while it mainly waits.
+
+#include <lofar_config.h>
+#include <Common/LofarLogger.h>
+#include <Common/lofar_map.h>
+#include <Common/lofar_vector.h>
+#include <GCF/TM/GCF_Control.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+namespace LOFAR {
+ namespace GCF {
+  namespace TM {
+
+class tTimerBench : public GCFTask
+{
+public:
+	tTimerBench (string name, int nrTimers);
+	~tTimerBench();
+
+	GCFEvent::TResult test1 (GCFEvent& e, GCFPortInterface& p);
+
+	void showResults (double seconds) const;
+
+private:
+	static double wallTime();
+
+	GCFTimerPort*	itsTimerPort;
+	int				itsNrTimers;
+	// expected expiry time and interval per timer id
+	map<long, pair<double,double> >	itsTimers;
+	vector<double>	itsLatencies;
+};
+
+tTimerBench::tTimerBench(string name, int nrTimers) :
+	GCFTask         ((State)&tTimerBench::test1, name),
+	itsTimerPort    (0),
+	itsNrTimers		(nrTimers)
+{
+}
+
+tTimerBench::~tTimerBench()
+{
+	delete itsTimerPort;
+}
+
+double tTimerBench::wallTime()
+{
+	struct timeval	tv;
+	gettimeofday(&tv, 0);
+	return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+GCFEvent::TResult tTimerBench::test1(GCFEvent& event, GCFPortInterface& /*port*/)
+{
+	GCFEvent::TResult status = GCFEvent::HANDLED;
+
+	switch (event.signal) {
+	case F_ENTRY:
+		itsTimerPort = new GCFTimerPort(*this, "timerPort");
+		ASSERTSTR(itsTimerPort, "Failed to open timerport");
+		break;
+
+	case F_INIT: {
+		srand(1);
+		double	now = wallTime();
+		for (int i = 0; i < itsNrTimers; i++) {
+			double	interval = 0.1 + 0.9 * (rand() / (RAND_MAX + 1.0));
+			long	timerID  = itsTimerPort->setTimer(interval, interval);
+			itsTimers[timerID] = make_pair(now + interval, interval);
+		}
+		LOG_INFO_STR(itsNrTimers << " timers started");
+		break;
+	}
+
+	case F_TIMER: {
+		GCFTimerEvent& timerEvent = static_cast<GCFTimerEvent&>(event);
+		double	now = wallTime();
+		map<long, pair<double,double> >::iterator	iter = itsTimers.find(timerEvent.id);
+		if (iter != itsTimers.end()) {
+			itsLatencies.push_back(now - iter->second.first);
+			iter->second.first += iter->second.second;
+		}
+		break;
+	}
+
+	default:
+		status = GCFEvent::NOT_HANDLED;
+		break;
+	}
+
+	return status;
+}
+
+void tTimerBench::showResults(double seconds) const
+{
+	struct rusage	usage;
+	getrusage(RUSAGE_SELF, &usage);
+	double	cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+				  usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+
+	vector<double>	lat(itsLatencies);
+	std::sort(lat.begin(), lat.end());
+	std::cout << "timers:          " << itsNrTimers << std::endl;
+	std::cout << "events:          " << lat.size() << std::endl;
+	if (!lat.empty()) {
+		std::cout << "latency median:  " << lat[lat.size()/2] * 1e6 << " us" << std::endl;
+		std::cout << "latency 99%:     " << lat[lat.size()*99/100] * 1e6 << " us" << std::endl;
+		std::cout << "latency max:     " << lat.back() * 1e6 << " us" << std::endl;
+	}
+	std::cout << "cpu usage:       " << 100.0 * cpu / seconds << " %" << std::endl;
+}
+
+  } // namespace TM
+ } // namespace GCF
+} // namespace LOFAR
+
+using namespace LOFAR::GCF::TM;
+
+//
+// MAIN()
+//
+int main(int argc, char* argv[])
+{
+	int		nrTimers = (argc > 1) ? atoi(argv[1]) : 2000;
+	double	seconds  = (argc > 2) ? atof(argv[2]) : 10.0;
+
+	GCFScheduler::instance()->init(argc, argv);
+
+	tTimerBench	benchTask("TimerBench", nrTimers);
+
+	benchTask.start(); // make initial transition
+
+	GCFScheduler::instance()->run(seconds);
+
+	benchTask.showResults(seconds);
+
+	return (0);
+}
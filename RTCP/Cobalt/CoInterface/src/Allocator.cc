@@ -23,10 +23,20 @@
 #include <CoInterface/Allocator.h>
 
 #include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <iostream>
 #include <malloc.h>
+#include <sys/mman.h>
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
 
 #include <Common/NewHandler.h>
 #include <Common/LofarLogger.h>
+#include <Common/SystemCallException.h>
 #include <CoInterface/Align.h>
 #include <CoInterface/Exceptions.h>
 
@@ -58,6 +68,68 @@ namespace LOFAR
     }
 
 
+    MappedArena::MappedArena(size_t size, bool hugePages, int numaNode)
+      :
+      itsMappedSize(size),
+      itsHugePages(false)
+    {
+      void *ptr = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+      if (hugePages) {
+        // explicit huge pages, if the administrator reserved enough of them
+        const size_t hugePageSize = 2 * 1024 * 1024;
+
+        itsMappedSize = align(size, hugePageSize);
+        ptr = mmap(0, itsMappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (ptr == MAP_FAILED) {
+          LOG_WARN_STR("MappedArena: could not map " << size << " bytes of huge pages (" << strerror(errno) << "), trying transparent huge pages");
+          itsMappedSize = size;
+        } else {
+          itsHugePages = true;
+        }
+      }
+#endif
+
+      if (ptr == MAP_FAILED) {
+        ptr = mmap(0, itsMappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (ptr == MAP_FAILED)
+          THROW(BadAllocException,"MappedArena could not map " << size << " bytes");
+
+#ifdef MADV_HUGEPAGE
+        if (hugePages && madvise(ptr, itsMappedSize, MADV_HUGEPAGE) == 0)
+          itsHugePages = true;
+#endif
+      }
+
+      if (numaNode >= 0) {
+#ifdef HAVE_LIBNUMA
+        if (numa_available() != -1) {
+          numa_tonode_memory(ptr, itsMappedSize, numaNode);
+        } else {
+          LOG_WARN("MappedArena: cannot bind memory (libnuma says there is no numa available)");
+        }
+#else
+        LOG_WARN("MappedArena: cannot bind memory (no libnuma support)");
+#endif
+      }
+
+      // fault in all pages now (on the bound node), not during processing
+      memset(ptr, 0, itsMappedSize);
+
+      itsBegin = ptr;
+      itsSize = size;
+    }
+
+
+    MappedArena::~MappedArena()
+    {
+      munmap(itsBegin, itsMappedSize);
+    }
+
+
     Allocator::~Allocator()
     {
     }
@@ -159,6 +231,378 @@ namespace LOFAR
     }
 
 
+    namespace
+    {
+      // Precedes each pointer returned by SizeClassAllocator.
+      struct BlockHeader
+      {
+        size_t magic;
+        size_t size;          // as requested
+        size_t offset;        // of the pointer in its block
+        unsigned blockClass;  // the free list the block belongs to
+      };
+
+      const size_t blockMagic = 0x5C0A110CA7EDULL;
+
+      // Blocks are aligned to (and offsets are at least) this, which leaves room for the header.
+      const size_t blockAlignment = 64;
+
+      // The maximum number of free blocks a thread caches per size class.
+      const size_t maxCachedBlocks = 32;
+
+      inline BlockHeader *header(void *ptr)
+      {
+        return reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr) - sizeof(BlockHeader));
+      }
+    }
+
+
+    struct SizeClassAllocator::ThreadCache
+    {
+      ThreadCache(SizeClassAllocator &allocator)
+        :
+        allocator(allocator),
+        blocks(allocator.classSizes.size()),
+        cachedBytes(0),
+        allocatedBytes(0),
+        blockBytes(0),
+        nrAllocations(0),
+        nrAllocateCalls(0),
+        nrLockedCalls(0)
+      {
+        for (size_t c = 0; c < blocks.size(); c++)
+          blocks[c].reserve(allocator.cacheCapacity[c]);
+      }
+
+      SizeClassAllocator &allocator;
+
+      // free blocks per size class
+      std::vector< std::vector<char *> > blocks;
+      size_t cachedBytes;
+
+      // Only changed by the owning thread. A block can be freed by another
+      // thread than the one that allocated it, so these only add up to
+      // the right values over all threads (modulo 2^64).
+      size_t allocatedBytes;
+      size_t blockBytes;
+      size_t nrAllocations;
+      size_t nrAllocateCalls;
+      size_t nrLockedCalls;
+    };
+
+
+    SizeClassAllocator::SizeClassAllocator(const Arena &arena, size_t cacheBytes)
+      :
+      arenaBegin(static_cast<char *>(arena.begin())),
+      arenaEnd(arenaBegin + arena.size()),
+      next(align(arenaBegin, blockAlignment)),
+      freeListBytes(0),
+      retired(0)
+    {
+      // 64, 128, ..., 512 bytes, then 8 classes per power of two, up to the arena size
+      for (size_t size = blockAlignment; ; ) {
+        classSizes.push_back(size);
+        cacheCapacity.push_back(std::min(maxCachedBlocks, cacheBytes / size));
+
+        if (size >= arena.size())
+          break;
+
+        size_t powerOfTwoBelow = 1;
+        while (powerOfTwoBelow * 2 <= size)
+          powerOfTwoBelow *= 2;
+
+        size += std::max(blockAlignment, powerOfTwoBelow / 8);
+      }
+
+      freeLists.resize(classSizes.size());
+
+      int error = pthread_key_create(&cacheKey, &SizeClassAllocator::releaseThreadCache);
+
+      if (error != 0)
+        throw SystemCallException("pthread_key_create", error, THROW_ARGS);
+
+      retired = new ThreadCache(*this);
+    }
+
+
+    SizeClassAllocator::~SizeClassAllocator()
+    {
+      // Threads that exit later do not call releaseThreadCache() anymore.
+      pthread_key_delete(cacheKey);
+
+      for (size_t i = 0; i < caches.size(); i++)
+        delete caches[i];
+
+      delete retired;
+    }
+
+
+    unsigned SizeClassAllocator::sizeClass(size_t size) const
+    {
+      std::vector<size_t>::const_iterator it = std::lower_bound(classSizes.begin(), classSizes.end(), size);
+
+      if (it == classSizes.end())
+        THROW(CoInterfaceException,"SizeClassAllocator could not allocate " << size << " bytes");
+
+      return it - classSizes.begin();
+    }
+
+
+    SizeClassAllocator::ThreadCache &SizeClassAllocator::threadCache()
+    {
+      ThreadCache *cache = static_cast<ThreadCache *>(pthread_getspecific(cacheKey));
+
+      if (cache == 0) {
+        cache = new ThreadCache(*this);
+
+        {
+          ScopedLock sl(mutex);
+          caches.push_back(cache);
+        }
+
+        int error = pthread_setspecific(cacheKey, cache);
+
+        if (error != 0)
+          throw SystemCallException("pthread_setspecific", error, THROW_ARGS);
+      }
+
+      return *cache;
+    }
+
+
+    void SizeClassAllocator::releaseThreadCache(void *arg)
+    {
+      ThreadCache *cache = static_cast<ThreadCache *>(arg);
+      SizeClassAllocator &allocator = cache->allocator;
+
+      ScopedLock sl(allocator.mutex);
+
+      for (unsigned c = 0; c < cache->blocks.size(); c++)
+        allocator.flush(*cache, c, cache->blocks[c].size());
+
+      ThreadCache &retired = *allocator.retired;
+      retired.allocatedBytes  += cache->allocatedBytes;
+      retired.blockBytes      += cache->blockBytes;
+      retired.nrAllocations   += cache->nrAllocations;
+      retired.nrAllocateCalls += cache->nrAllocateCalls;
+      retired.nrLockedCalls   += cache->nrLockedCalls;
+
+      allocator.caches.erase(std::find(allocator.caches.begin(), allocator.caches.end(), cache));
+      delete cache;
+    }
+
+
+    void SizeClassAllocator::flush(ThreadCache &cache, unsigned sizeClass, size_t nrBlocks)
+    {
+      // mutex must be held
+      std::vector<char *> &cached = cache.blocks[sizeClass];
+      std::vector<char *> &freeList = freeLists[sizeClass];
+
+      freeList.insert(freeList.end(), cached.end() - nrBlocks, cached.end());
+      cached.resize(cached.size() - nrBlocks);
+
+      cache.cachedBytes -= nrBlocks * classSizes[sizeClass];
+      freeListBytes += nrBlocks * classSizes[sizeClass];
+    }
+
+
+    char *SizeClassAllocator::allocateBlock(ThreadCache &cache, unsigned sizeClass, unsigned &blockClass)
+    {
+      ScopedLock sl(mutex);
+
+      cache.nrLockedCalls++;
+
+      std::vector<char *> &freeList = freeLists[sizeClass];
+
+      if (!freeList.empty()) {
+        char *block = freeList.back();
+        freeList.pop_back();
+        freeListBytes -= classSizes[sizeClass];
+
+        // move more blocks to our cache, to avoid locking for the next ones
+        const size_t nrBlocks = std::min(freeList.size(), cacheCapacity[sizeClass] / 2);
+        std::vector<char *> &cached = cache.blocks[sizeClass];
+
+        cached.insert(cached.end(), freeList.end() - nrBlocks, freeList.end());
+        freeList.resize(freeList.size() - nrBlocks);
+
+        cache.cachedBytes += nrBlocks * classSizes[sizeClass];
+        freeListBytes -= nrBlocks * classSizes[sizeClass];
+
+        return block;
+      }
+
+      if (classSizes[sizeClass] <= (size_t) (arenaEnd - next)) {
+        char *block = next;
+        next += classSizes[sizeClass];
+        return block;
+      }
+
+      // The arena is full. Return our cached blocks, and use a free block of a larger class.
+      for (unsigned c = 0; c < cache.blocks.size(); c++)
+        flush(cache, c, cache.blocks[c].size());
+
+      for (unsigned c = sizeClass + 1; c < freeLists.size(); c++) {
+        if (!freeLists[c].empty()) {
+          char *block = freeLists[c].back();
+          freeLists[c].pop_back();
+          freeListBytes -= classSizes[c];
+
+          blockClass = c;
+          return block;
+        }
+      }
+
+      THROW(CoInterfaceException,"SizeClassAllocator could not allocate " << classSizes[sizeClass] << " bytes");
+    }
+
+
+    void SizeClassAllocator::deallocateBlock(ThreadCache &cache, char *block, unsigned blockClass)
+    {
+      std::vector<char *> &cached = cache.blocks[blockClass];
+
+      if (cached.size() < cacheCapacity[blockClass]) {
+        cached.push_back(block);
+        cache.cachedBytes += classSizes[blockClass];
+        return;
+      }
+
+      ScopedLock sl(mutex);
+
+      cache.nrLockedCalls++;
+
+      freeLists[blockClass].push_back(block);
+      freeListBytes += classSizes[blockClass];
+
+      // make room for the next blocks freed by this thread
+      flush(cache, blockClass, cached.size() / 2);
+    }
+
+
+    void *SizeClassAllocator::allocate(size_t size, size_t alignment)
+    {
+      ASSERT(powerOfTwo(alignment));
+
+      if (size > (size_t) (arenaEnd - arenaBegin))
+        THROW(CoInterfaceException,"SizeClassAllocator could not allocate " << size << " bytes");
+
+      // room for the header, and for aligning the pointer within the block
+      const size_t offset = std::max(alignment, blockAlignment);
+      const unsigned sizeClass = this->sizeClass(size + offset);
+
+      ThreadCache &cache = threadCache();
+      cache.nrAllocateCalls++;
+
+      unsigned blockClass = sizeClass;
+      char *block;
+      std::vector<char *> &cached = cache.blocks[sizeClass];
+
+      if (!cached.empty()) {
+        block = cached.back();
+        cached.pop_back();
+        cache.cachedBytes -= classSizes[sizeClass];
+      } else {
+        block = allocateBlock(cache, sizeClass, blockClass);
+      }
+
+      char *ptr = align(block + sizeof(BlockHeader), offset);
+
+      BlockHeader *h = header(ptr);
+      h->magic = blockMagic;
+      h->size = size;
+      h->offset = ptr - block;
+      h->blockClass = blockClass;
+
+      cache.allocatedBytes += size;
+      cache.blockBytes += classSizes[blockClass];
+      cache.nrAllocations++;
+
+      return ptr;
+    }
+
+
+    void SizeClassAllocator::deallocate(void *ptr)
+    {
+      if (ptr != 0) {
+        char *p = static_cast<char *>(ptr);
+        BlockHeader *h = header(ptr);
+
+        if (p < arenaBegin + blockAlignment || p > arenaEnd || h->magic != blockMagic)
+          THROW(CoInterfaceException,"Pointer was not allocated");
+
+        // catch double frees
+        h->magic = 0;
+
+        ThreadCache &cache = threadCache();
+        cache.allocatedBytes -= h->size;
+        cache.blockBytes -= classSizes[h->blockClass];
+        cache.nrAllocations--;
+
+        deallocateBlock(cache, p - h->offset, h->blockClass);
+      }
+    }
+
+
+    bool SizeClassAllocator::empty() const
+    {
+      return statistics().nrAllocations == 0;
+    }
+
+
+    SizeClassAllocator::Statistics SizeClassAllocator::statistics() const
+    {
+      ScopedLock sl(mutex);
+
+      Statistics stats;
+      stats.arenaSize = arenaEnd - arenaBegin;
+      stats.usedBytes = next - arenaBegin;
+      stats.freeBytes = freeListBytes;
+      stats.allocatedBytes = retired->allocatedBytes;
+      stats.blockBytes = retired->blockBytes;
+      stats.nrAllocations = retired->nrAllocations;
+      stats.nrAllocateCalls = retired->nrAllocateCalls;
+      stats.nrLockedCalls = retired->nrLockedCalls;
+
+      // Reads counters that other threads may be changing: good enough for statistics.
+      for (size_t i = 0; i < caches.size(); i++) {
+        const ThreadCache &cache = *caches[i];
+
+        stats.freeBytes += cache.cachedBytes;
+        stats.allocatedBytes += cache.allocatedBytes;
+        stats.blockBytes += cache.blockBytes;
+        stats.nrAllocations += cache.nrAllocations;
+        stats.nrAllocateCalls += cache.nrAllocateCalls;
+        stats.nrLockedCalls += cache.nrLockedCalls;
+      }
+
+      return stats;
+    }
+
+
+    double SizeClassAllocator::Statistics::internalFragmentation() const
+    {
+      return blockBytes == 0 ? 0.0 : 1.0 - (double) allocatedBytes / blockBytes;
+    }
+
+
+    double SizeClassAllocator::Statistics::externalFragmentation() const
+    {
+      return usedBytes == 0 ? 0.0 : (double) freeBytes / usedBytes;
+    }
+
+
+    std::ostream &operator<<(std::ostream &str, const SizeClassAllocator::Statistics &stats)
+    {
+      str << stats.nrAllocations << " allocations of " << stats.allocatedBytes << " bytes in "
+          << stats.blockBytes << " bytes of blocks, " << stats.freeBytes << " bytes free, "
+          << stats.usedBytes << " of " << stats.arenaSize << " arena bytes used"
+          << ", fragmentation: " << 100.0 * stats.internalFragmentation() << "% internal, "
+          << 100.0 * stats.externalFragmentation() << "% external"
+          << ", " << stats.nrLockedCalls << " locked calls for " << stats.nrAllocateCalls << " allocations";
+
+      return str;
+    }
+
+
   } // namespace Cobalt
 } // namespace LOFAR
-
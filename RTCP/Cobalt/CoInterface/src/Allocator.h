@@ -22,6 +22,9 @@
 #define LOFAR_INTERFACE_ALLOCATOR_H
 
 #include <map>
+#include <vector>
+#include <iosfwd>
+#include <pthread.h>
 
 #include <Common/Thread/Mutex.h>
 #include <CoInterface/SparseSet.h>
@@ -77,6 +80,31 @@ namespace LOFAR
     };
 
 
+    /*
+     * MappedArena maps anonymous memory, optionally backed by huge pages and
+     * bound to a NUMA node, so that the buffers in it are local to the socket
+     * that processes them. All pages are touched on construction, so they are
+     * present (and on the requested node) before first use.
+     */
+    class MappedArena : public Arena
+    {
+    public:
+      // numaNode: the node to allocate the memory on, or -1 for the default policy
+      MappedArena(size_t size, bool hugePages = false, int numaNode = -1);
+      ~MappedArena();
+
+      // Whether the memory is backed by (explicit or transparent) huge pages.
+      bool hugePages() const
+      {
+        return itsHugePages;
+      }
+
+    private:
+      size_t itsMappedSize;
+      bool itsHugePages;
+    };
+
+
     /*
      * An Allocator can both allocate and deallocate pointers.
      */
@@ -159,6 +187,80 @@ namespace LOFAR
       std::map<void *, size_t>    sizes;
     };
 
+
+    /*
+     * Allocates memory within an Arena, like SparseSetAllocator, but without
+     * taking a lock for most allocations:
+     *
+     * - Sizes are rounded up to a size class (8 per power of two, so at most
+     *   12.5% is lost), and each class has its own free list. Freed blocks are
+     *   reused for the same class, and are never split or merged.
+     * - Each thread caches free blocks per class (up to cacheBytes per class),
+     *   so small blocks are allocated and freed without locking.
+     *
+     * This suits the Cobalt buffers, which are allocated over and over again
+     * with the same sizes. SparseSetAllocator packs arbitrary sizes tighter.
+     */
+    class SizeClassAllocator : public Allocator
+    {
+    public:
+      SizeClassAllocator(const Arena &, size_t cacheBytes = 1024 * 1024);
+      virtual ~SizeClassAllocator();
+
+      virtual void                *allocate(size_t size, size_t alignment = 1);
+      virtual void                deallocate(void *);
+
+      bool                        empty() const;
+
+      struct Statistics {
+        size_t arenaSize;
+        size_t usedBytes;         // carved from the arena into blocks
+        size_t allocatedBytes;    // requested by the live allocations
+        size_t blockBytes;        // in the blocks of the live allocations
+        size_t freeBytes;         // in free blocks (free lists and thread caches)
+        size_t nrAllocations;     // live allocations
+        size_t nrAllocateCalls;
+        size_t nrLockedCalls;     // allocate() and deallocate() calls that took the lock
+
+        // Fraction of the live blocks lost to size classes, alignment and headers
+        double internalFragmentation() const;
+
+        // Fraction of the used bytes that is free, but only for its own size class
+        double externalFragmentation() const;
+      };
+
+      // Statistics summed over all threads. Not atomic w.r.t. concurrent (de)allocations.
+      Statistics                  statistics() const;
+
+    private:
+      struct ThreadCache;
+
+      unsigned                    sizeClass(size_t size) const;
+      ThreadCache                 &threadCache();
+      char                        *allocateBlock(ThreadCache &, unsigned sizeClass, unsigned &blockClass);
+      void                        deallocateBlock(ThreadCache &, char *block, unsigned blockClass);
+      void                        flush(ThreadCache &, unsigned sizeClass, size_t nrBlocks);
+
+      static void                 releaseThreadCache(void *);
+
+      mutable Mutex mutex;
+
+      char                        *const arenaBegin;
+      char                        *const arenaEnd;
+      char                        *next; // start of the part never used
+
+      std::vector<size_t>         classSizes;
+      std::vector<size_t>         cacheCapacity; // per class, in blocks
+      std::vector< std::vector<char *> > freeLists;
+      size_t                      freeListBytes;
+
+      pthread_key_t               cacheKey;
+      std::vector<ThreadCache *>  caches;
+      ThreadCache                 *retired; // counters of exited threads
+    };
+
+    std::ostream &operator<<(std::ostream &, const SizeClassAllocator::Statistics &);
+
   } // namespace Cobalt
 } // namespace LOFAR
 
@@ -0,0 +1,562 @@
+//# LockFreeQueue.h: Bounded lock-free queues with the interface of Queue
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_COINTERFACE_LOCKFREEQUEUE_H
+#define LOFAR_COINTERFACE_LOCKFREEQUEUE_H
+
+#ifdef USE_THREADS
+
+#include <Common/LofarLogger.h>
+#include <Common/Thread/Condition.h>
+#include <Common/Thread/Mutex.h>
+#include <CoInterface/TimeFuncs.h>
+#include <CoInterface/RunningStatistics.h>
+
+#include <vector>
+#include <string>
+#include <time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+
+namespace LOFAR {
+
+  namespace Cobalt {
+
+/*
+ * Bounded, lock-free alternatives for Queue<T>. Elements are stored in a
+ * ring buffer with a fixed capacity (rounded up to a power of two), so
+ * append() and remove() do not allocate and do not lock as long as the
+ * queue is neither full nor empty. Only when a thread has to wait does it
+ * fall back to a mutex and condition variable.
+ *
+ *   SPSCQueue<T>: exactly one thread appends, and exactly one thread removes.
+ *   MPMCQueue<T>: any number of threads append and remove.
+ *
+ * Contrary to Queue<T>:
+ *   * append() blocks while the queue is full.
+ *   * prepend() and oldest() are not supported.
+ *   * Statistics are only gathered for one in every `statsInterval'
+ *     elements (0 = no statistics), instead of for every operation.
+ *
+ * The shared counters and indices are accessed with the GCC __atomic builtins, so this
+ * does not require C++11.
+ *
+ * Both queues share the implementation of waiting and statistics in
+ * LockFreeQueue<T, Derived>, which requires Derived to implement
+ *
+ *   bool tryPush(const T&, const struct timespec &arrival_time);
+ *   bool tryPop(T&, struct timespec &arrival_time);
+ *   size_t size() const;
+ */
+template <typename T, class Derived> class LockFreeQueue
+{
+  public:
+    // Add an element to the back of the queue, waiting for room
+    // if the queue is full.
+    //
+    // If timed, this element is taken into account for timing statistics.
+    void     append(const T&, bool timed = true);
+
+    // Remove the front element; waits until `deadline' for an element,
+    // and returns `null' if the deadline passed.
+    T        remove(const struct timespec &deadline = TimeSpec::universe_heat_death, T null = 0);
+
+    bool     empty() const;
+    size_t   capacity() const;
+    std::string name() const;
+
+  protected:
+    LockFreeQueue(const std::string &name, size_t capacity, bool warnIfEmptyOnRemove, unsigned statsInterval);
+
+    // Log queue statistics
+    ~LockFreeQueue();
+
+    const std::string itsName;
+
+    // Always a power of two
+    const size_t itsCapacity;
+
+    const bool warn_if_empty;
+
+    // Sample statistics once every statsInterval elements (0 = never)
+    const unsigned statsInterval;
+
+  private:
+    LockFreeQueue(const LockFreeQueue&);
+    LockFreeQueue& operator=(const LockFreeQueue&);
+
+    Derived &derived() { return static_cast<Derived&>(*this); }
+    const Derived &derived() const { return static_cast<const Derived&>(*this); }
+
+    // Waiting is done under itsMutex. A thread announces that it waits by
+    // incrementing a waiting counter, after which it has to retry its
+    // operation before blocking. The other side only needs to lock and
+    // signal if it sees a waiting thread.
+    mutable Mutex     itsMutex;
+    Condition         itsNotEmpty, itsNotFull;
+    unsigned          nrWaitingForElement, nrWaitingForRoom;
+
+    // Wake up threads waiting on `condition', if any.
+    void     notify(unsigned &nrWaiting, Condition &condition);
+
+    // Try an operation a number of times before a thread blocks on a full
+    // or empty queue. Spinning for a short while avoids the mutex in the
+    // common case that the other side is just about to deliver, but only
+    // makes sense if the other side can run at the same time.
+    static unsigned nrSpins();
+
+    bool     spinPush(const T&, const struct timespec &arrival_time);
+    bool     spinPop(T&, struct timespec &arrival_time);
+
+    // Sample counters, and whether the next sample is due
+    unsigned appendCount, removeCount;
+    bool     sampleNow(unsigned &count);
+
+    // Statistics, see Queue<T>. Protected by statsMutex, as
+    // they are only updated for sampled elements.
+    Mutex             statsMutex;
+    RunningStatistics retention_time;
+    RunningStatistics remove_on_empty_queue;
+    RunningStatistics remove_wait_time;
+    RunningStatistics queue_size_on_append;
+};
+
+
+/*
+ * Single-producer, single-consumer ring buffer.
+ */
+template <typename T> class SPSCQueue: public LockFreeQueue< T, SPSCQueue<T> >
+{
+  public:
+    // Create a named queue that can hold at least `capacity' elements.
+    SPSCQueue(const std::string &name, size_t capacity, bool warnIfEmptyOnRemove = false, unsigned statsInterval = 0);
+
+    size_t   size() const;
+
+  private:
+    friend class LockFreeQueue< T, SPSCQueue<T> >;
+
+    bool     tryPush(const T&, const struct timespec &arrival_time);
+    bool     tryPop(T&, struct timespec &arrival_time);
+
+    struct Element {
+      T value;
+      struct timespec arrival_time;
+    };
+
+    std::vector<Element> itsElements;
+    const size_t itsMask;
+
+    // Next position to write, only modified by the producer. The producer
+    // caches the last known value of `head', and vice versa, to avoid
+    // bouncing the cache lines on every operation.
+    size_t tail;
+    size_t cachedHead;
+    char pad1[64];
+
+    // Next position to read, only modified by the consumer.
+    size_t head;
+    size_t cachedTail;
+    char pad2[64];
+};
+
+
+/*
+ * Multi-producer, multi-consumer ring buffer. Each slot carries a sequence
+ * number that tells whether it is ready to be written or read in the
+ * current lap, so producers and consumers only contend on claiming a
+ * position.
+ */
+template <typename T> class MPMCQueue: public LockFreeQueue< T, MPMCQueue<T> >
+{
+  public:
+    // Create a named queue that can hold at least `capacity' elements.
+    MPMCQueue(const std::string &name, size_t capacity, bool warnIfEmptyOnRemove = false, unsigned statsInterval = 0);
+
+    size_t   size() const;
+
+  private:
+    friend class LockFreeQueue< T, MPMCQueue<T> >;
+
+    bool     tryPush(const T&, const struct timespec &arrival_time);
+    bool     tryPop(T&, struct timespec &arrival_time);
+
+    struct Slot {
+      // == position:     slot is free to be written at `position'
+      // == position + 1: slot is filled and can be read at `position'
+      size_t sequence;
+
+      T value;
+      struct timespec arrival_time;
+    };
+
+    std::vector<Slot> itsSlots;
+    const size_t itsMask;
+
+    size_t tail;
+    char pad1[64];
+
+    size_t head;
+    char pad2[64];
+};
+
+
+// Round up to the nearest power of two
+inline size_t lockFreeQueueCapacity(size_t capacity)
+{
+  size_t result = 1;
+
+  while (result < capacity)
+    result <<= 1;
+
+  return result;
+}
+
+
+template <typename T, class Derived> LockFreeQueue<T, Derived>::LockFreeQueue(const std::string &name, size_t capacity, bool warnIfEmptyOnRemove, unsigned statsInterval)
+:
+  itsName(name),
+  itsCapacity(lockFreeQueueCapacity(capacity)),
+  warn_if_empty(warnIfEmptyOnRemove),
+  statsInterval(statsInterval),
+  nrWaitingForElement(0),
+  nrWaitingForRoom(0),
+  appendCount(0),
+  removeCount(0),
+  retention_time("s"),
+  remove_on_empty_queue("%"),
+  remove_wait_time("s"),
+  queue_size_on_append("elements")
+{
+  ASSERT(capacity > 0);
+}
+
+
+template <typename T, class Derived> LockFreeQueue<T, Derived>::~LockFreeQueue()
+{
+  // See Queue<T>::~Queue() for an explanation of these values.
+  if (itsName != "" && statsInterval > 0)
+    LOG_INFO_STR("Queue " << itsName << ": avg #elements on append = " << queue_size_on_append.mean() << ", queue empty on remove = " << remove_on_empty_queue.mean() << "%, remove wait time = " << remove_wait_time.mean() << " s, element retention time: " << retention_time << " (sampled 1 in " << statsInterval << ")");
+}
+
+
+template <typename T, class Derived> inline bool LockFreeQueue<T, Derived>::sampleNow(unsigned &count)
+{
+  return statsInterval > 0 && __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED) % statsInterval == 0;
+}
+
+
+template <typename T, class Derived> inline void LockFreeQueue<T, Derived>::notify(unsigned &nrWaiting, Condition &condition)
+{
+  // Order our push/pop before reading nrWaiting, pairing with the
+  // increment of nrWaiting by the waiting thread.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n(&nrWaiting, __ATOMIC_RELAXED) > 0) {
+    ScopedLock scopedLock(itsMutex);
+    condition.broadcast();
+  }
+}
+
+
+template <typename T, class Derived> inline unsigned LockFreeQueue<T, Derived>::nrSpins()
+{
+  static const unsigned spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 1000 : 1;
+
+  return spins;
+}
+
+
+template <typename T, class Derived> inline bool LockFreeQueue<T, Derived>::spinPush(const T& element, const struct timespec &arrival_time)
+{
+  const unsigned spins = nrSpins();
+
+  for (unsigned i = 0; i < spins; ++i)
+    if (derived().tryPush(element, arrival_time))
+      return true;
+
+  return false;
+}
+
+
+template <typename T, class Derived> inline bool LockFreeQueue<T, Derived>::spinPop(T& element, struct timespec &arrival_time)
+{
+  const unsigned spins = nrSpins();
+
+  for (unsigned i = 0; i < spins; ++i)
+    if (derived().tryPop(element, arrival_time))
+      return true;
+
+  return false;
+}
+
+
+template <typename T, class Derived> inline void LockFreeQueue<T, Derived>::append(const T& element, bool timed)
+{
+  const bool sample = timed && sampleNow(appendCount);
+  const struct timespec arrival_time = sample ? TimeSpec::now() : TimeSpec::big_bang;
+
+  if (sample) {
+    const size_t size = derived().size();
+
+    ScopedLock scopedLock(statsMutex);
+    queue_size_on_append.push(size);
+  }
+
+  if (!spinPush(element, arrival_time)) {
+    ScopedLock scopedLock(itsMutex);
+
+    __atomic_fetch_add(&nrWaitingForRoom, 1, __ATOMIC_SEQ_CST);
+
+    while (!derived().tryPush(element, arrival_time))
+      itsNotFull.wait(itsMutex);
+
+    __atomic_fetch_sub(&nrWaitingForRoom, 1, __ATOMIC_RELAXED);
+  }
+
+  notify(nrWaitingForElement, itsNotEmpty);
+}
+
+
+template <typename T, class Derived> inline T LockFreeQueue<T, Derived>::remove(const struct timespec &deadline, T null)
+{
+  using namespace LOFAR::Cobalt::TimeSpec;
+
+  // Return null if deadline passed
+  if (deadline != TimeSpec::universe_heat_death && TimeSpec::now() > deadline)
+    return null;
+
+  T value;
+  struct timespec arrival_time;
+
+  const bool sample = sampleNow(removeCount);
+
+  if (spinPop(value, arrival_time)) {
+    if (sample) {
+      ScopedLock scopedLock(statsMutex);
+      remove_on_empty_queue.push(0.0);
+    }
+  } else {
+    if (warn_if_empty)
+      LOG_WARN_STR("remove() called on empty queue: " << name());
+
+    const struct timespec begin = sample ? TimeSpec::now() : TimeSpec::big_bang;
+
+    {
+      ScopedLock scopedLock(itsMutex);
+
+      __atomic_fetch_add(&nrWaitingForElement, 1, __ATOMIC_SEQ_CST);
+
+      while (!derived().tryPop(value, arrival_time)) {
+        if (!itsNotEmpty.wait(itsMutex, deadline)) {
+          __atomic_fetch_sub(&nrWaitingForElement, 1, __ATOMIC_RELAXED);
+          return null;
+        }
+      }
+
+      __atomic_fetch_sub(&nrWaitingForElement, 1, __ATOMIC_RELAXED);
+    }
+
+    if (sample) {
+      ScopedLock scopedLock(statsMutex);
+      remove_on_empty_queue.push(100.0);
+      remove_wait_time.push(TimeSpec::now() - begin);
+    }
+  }
+
+  notify(nrWaitingForRoom, itsNotFull);
+
+  if (arrival_time != TimeSpec::big_bang) {
+    const double retention = TimeSpec::now() - arrival_time;
+
+    ScopedLock scopedLock(statsMutex);
+    retention_time.push(retention);
+  }
+
+  return value;
+}
+
+
+template <typename T, class Derived> inline bool LockFreeQueue<T, Derived>::empty() const
+{
+  return derived().size() == 0;
+}
+
+
+template <typename T, class Derived> inline size_t LockFreeQueue<T, Derived>::capacity() const
+{
+  return itsCapacity;
+}
+
+
+template <typename T, class Derived> inline std::string LockFreeQueue<T, Derived>::name() const
+{
+  return itsName;
+}
+
+
+template <typename T> SPSCQueue<T>::SPSCQueue(const std::string &name, size_t capacity, bool warnIfEmptyOnRemove, unsigned statsInterval)
+:
+  LockFreeQueue< T, SPSCQueue<T> >(name, capacity, warnIfEmptyOnRemove, statsInterval),
+  itsElements(this->itsCapacity),
+  itsMask(this->itsCapacity - 1),
+  tail(0),
+  cachedHead(0),
+  head(0),
+  cachedTail(0)
+{
+}
+
+
+template <typename T> inline bool SPSCQueue<T>::tryPush(const T& element, const struct timespec &arrival_time)
+{
+  const size_t pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+
+  if (pos - cachedHead == this->itsCapacity) {
+    cachedHead = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+
+    if (pos - cachedHead == this->itsCapacity)
+      return false;
+  }
+
+  Element &e = itsElements[pos & itsMask];
+  e.value        = element;
+  e.arrival_time = arrival_time;
+
+  __atomic_store_n(&tail, pos + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+
+template <typename T> inline bool SPSCQueue<T>::tryPop(T& element, struct timespec &arrival_time)
+{
+  const size_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+
+  if (pos == cachedTail) {
+    cachedTail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+
+    if (pos == cachedTail)
+      return false;
+  }
+
+  Element &e = itsElements[pos & itsMask];
+  element      = e.value;
+  arrival_time = e.arrival_time;
+
+  __atomic_store_n(&head, pos + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+
+template <typename T> inline size_t SPSCQueue<T>::size() const
+{
+  const size_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  const size_t t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+
+  return t >= h ? t - h : 0;
+}
+
+
+template <typename T> MPMCQueue<T>::MPMCQueue(const std::string &name, size_t capacity, bool warnIfEmptyOnRemove, unsigned statsInterval)
+:
+  LockFreeQueue< T, MPMCQueue<T> >(name, capacity, warnIfEmptyOnRemove, statsInterval),
+  itsSlots(this->itsCapacity),
+  itsMask(this->itsCapacity - 1),
+  tail(0),
+  head(0)
+{
+  for (size_t i = 0; i < this->itsCapacity; ++i)
+    itsSlots[i].sequence = i;
+}
+
+
+template <typename T> inline bool MPMCQueue<T>::tryPush(const T& element, const struct timespec &arrival_time)
+{
+  size_t pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+
+  for (;;) {
+    Slot &slot = itsSlots[pos & itsMask];
+    const size_t seq = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+    const ssize_t diff = (ssize_t)seq - (ssize_t)pos;
+
+    if (diff == 0) {
+      // Slot is free, try to claim it
+      if (__atomic_compare_exchange_n(&tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        slot.value        = element;
+        slot.arrival_time = arrival_time;
+        __atomic_store_n(&slot.sequence, pos + 1, __ATOMIC_RELEASE);
+        return true;
+      }
+      // pos is updated by __atomic_compare_exchange_n
+    } else if (diff < 0) {
+      // Slot still holds the element of the previous lap: queue is full
+      return false;
+    } else {
+      // Another producer claimed pos
+      pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+
+template <typename T> inline bool MPMCQueue<T>::tryPop(T& element, struct timespec &arrival_time)
+{
+  size_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+
+  for (;;) {
+    Slot &slot = itsSlots[pos & itsMask];
+    const size_t seq = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+    const ssize_t diff = (ssize_t)seq - (ssize_t)(pos + 1);
+
+    if (diff == 0) {
+      // Slot is filled, try to claim it
+      if (__atomic_compare_exchange_n(&head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        element      = slot.value;
+        arrival_time = slot.arrival_time;
+        __atomic_store_n(&slot.sequence, pos + this->itsCapacity, __ATOMIC_RELEASE);
+        return true;
+      }
+    } else if (diff < 0) {
+      // Slot not written yet: queue is empty
+      return false;
+    } else {
+      // Another consumer claimed pos
+      pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+
+template <typename T> inline size_t MPMCQueue<T>::size() const
+{
+  const size_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  const size_t t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+
+  return t >= h ? t - h : 0;
+}
+
+} // namespace Cobalt
+
+} // namespace LOFAR
+
+#endif
+
+#endif
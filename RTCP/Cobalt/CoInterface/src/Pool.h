@@ -31,13 +31,19 @@ namespace LOFAR
     // The pool operates using a free and a filled queue to cycle through buffers. Producers
     // move elements free->filled, and consumers move elements filled->free. By
     // wrapping the elements in a SmartPtr, memory leaks are prevented.
-    template <typename T>
+    //
+    // The queue type can be replaced by one of the bounded queues in
+    // LockFreeQueue.h (include it yourself), for example Pool<T, SPSCQueue< SmartPtr<T> > > if only
+    // one thread produces and one thread consumes. Such pools are constructed
+    // with the maximum number of elements they will hold.
+    template <typename T, typename QueueT = Queue< SmartPtr<T> > >
     struct Pool
     {
       typedef T element_type;
+      typedef QueueT queue_type;
 
-      Queue< SmartPtr<element_type> > free;
-      Queue< SmartPtr<element_type> > filled;
+      queue_type free;
+      queue_type filled;
 
       Pool(const std::string &name, bool complain_on_empty_free_queue)
       :
@@ -45,6 +51,15 @@ namespace LOFAR
         filled(name + " [.filled]", false)
       {
       }
+
+      // For bounded queues, which sample their statistics
+      // once every `statsInterval' elements.
+      Pool(const std::string &name, bool complain_on_empty_free_queue, size_t capacity, unsigned statsInterval = 0)
+      :
+        free(name + " [.free]", capacity, complain_on_empty_free_queue, statsInterval),
+        filled(name + " [.filled]", capacity, false, statsInterval)
+      {
+      }
     };
   }
 }
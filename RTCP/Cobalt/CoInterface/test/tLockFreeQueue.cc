@@ -0,0 +1,150 @@
+//# tLockFreeQueue.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <unistd.h>
+#include <vector>
+#include <omp.h>
+
+#include <Common/LofarLogger.h>
+#include <CoInterface/LockFreeQueue.h>
+#include <CoInterface/Pool.h>
+#include <CoInterface/SmartPtr.h>
+
+using namespace LOFAR;
+using namespace Cobalt;
+using namespace std;
+
+template<typename QueueT>
+void test_fifo()
+{
+  // capacity is rounded up to a power of two
+  QueueT queue("test_fifo", 10, false, 1);
+  ASSERT(queue.capacity() == 16);
+  ASSERT(queue.empty());
+
+  for (size_t i = 0; i < queue.capacity(); ++i) {
+    queue.append(100 + i);
+    ASSERT(queue.size() == i + 1);
+  }
+
+  for (size_t i = 0; i < queue.capacity(); ++i) {
+    ASSERT(queue.remove() == 100 + i);
+  }
+
+  ASSERT(queue.empty());
+}
+
+template<typename QueueT>
+void test_deadline()
+{
+  QueueT queue("test_deadline", 4);
+
+  // remove() on an empty queue returns `null' after the deadline
+  struct timespec deadline = TimeSpec::now();
+  TimeSpec::inc(deadline, 0.1);
+
+  ASSERT(queue.remove(deadline, 42) == 42);
+}
+
+template<typename QueueT>
+void test_blocking(size_t nrProducers, size_t nrConsumers)
+{
+  // A small queue, to exercise both waiting for room and waiting
+  // for elements.
+  QueueT queue("test_blocking", 4);
+
+  const size_t nrElements = 100000;
+
+  // sum of all removed elements, per consumer
+  vector<size_t> sums(nrConsumers, 0);
+
+  size_t nrProducersDone = 0;
+
+# pragma omp parallel num_threads(nrProducers + nrConsumers)
+  {
+    const size_t thread = omp_get_thread_num();
+
+    if (thread < nrProducers) {
+      // producers append [1, nrElements]
+      for (size_t i = thread + 1; i <= nrElements; i += nrProducers)
+        queue.append(i);
+
+      // the last producer to finish signals end-of-stream to all consumers
+      if (__atomic_add_fetch(&nrProducersDone, 1, __ATOMIC_SEQ_CST) == nrProducers)
+        for (size_t i = 0; i < nrConsumers; ++i)
+          queue.append(0);
+    } else {
+      // consumers remove until they see 0
+      size_t &sum = sums[thread - nrProducers];
+      size_t e;
+
+      while ((e = queue.remove()) > 0)
+        sum += e;
+    }
+  }
+
+  size_t total = 0;
+  for (size_t i = 0; i < nrConsumers; ++i)
+    total += sums[i];
+
+  ASSERT(total == nrElements * (nrElements + 1) / 2);
+}
+
+void test_pool()
+{
+  Pool<int, SPSCQueue< SmartPtr<int> > > pool("test_pool", false, 4);
+
+  for (size_t i = 0; i < 4; ++i)
+    pool.free.append(new int(i));
+
+  // elements are transferred, not copied
+  SmartPtr<int> e = pool.free.remove();
+  ASSERT(*e == 0);
+
+  pool.filled.append(e);
+  ASSERT(!e);
+
+  ASSERT(*pool.filled.remove() == 0);
+}
+
+int main()
+{
+  INIT_LOGGER( "tLockFreeQueue" );
+
+  // abort program if code blocks
+  alarm(30);
+
+  test_fifo< SPSCQueue<size_t> >();
+  test_fifo< MPMCQueue<size_t> >();
+
+  test_deadline< SPSCQueue<size_t> >();
+  test_deadline< MPMCQueue<size_t> >();
+
+  test_blocking< SPSCQueue<size_t> >(1, 1);
+  test_blocking< MPMCQueue<size_t> >(1, 1);
+  test_blocking< MPMCQueue<size_t> >(4, 4);
+
+  test_pool();
+
+  return 0;
+}
+
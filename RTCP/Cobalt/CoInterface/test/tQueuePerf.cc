@@ -0,0 +1,146 @@
+//# tQueuePerf.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <omp.h>
+
+#include <Common/LofarLogger.h>
+#include <CoInterface/Queue.h>
+#include <CoInterface/LockFreeQueue.h>
+#include <CoInterface/SmartPtr.h>
+
+using namespace LOFAR;
+using namespace Cobalt;
+using namespace std;
+
+// Compares the throughput and latency of Queue, SPSCQueue and MPMCQueue.
+//
+// Usage: tQueuePerf [nrElements]
+
+// Create queues with the same interface for each type
+template<typename QueueT> struct Factory;
+
+template<typename T> struct Factory< Queue<T> > {
+  static Queue<T> *create(const string &name, size_t) { return new Queue<T>(name); }
+};
+
+template<typename T> struct Factory< SPSCQueue<T> > {
+  static SPSCQueue<T> *create(const string &name, size_t capacity) { return new SPSCQueue<T>(name, capacity); }
+};
+
+template<typename T> struct Factory< MPMCQueue<T> > {
+  static MPMCQueue<T> *create(const string &name, size_t capacity) { return new MPMCQueue<T>(name, capacity); }
+};
+
+
+// Moves nrElements through a queue, from nrProducers to nrConsumers threads.
+// Returns the number of elements per second.
+template<typename QueueT>
+double throughput(size_t nrProducers, size_t nrConsumers, size_t nrElements)
+{
+  SmartPtr<QueueT> queue = Factory<QueueT>::create("", 1024);
+
+  const double start = omp_get_wtime();
+
+# pragma omp parallel num_threads(nrProducers + nrConsumers)
+  {
+    const size_t thread = omp_get_thread_num();
+
+    if (thread < nrProducers) {
+      for (size_t i = thread; i < nrElements; i += nrProducers)
+        queue->append(i + 1, false);
+    } else {
+      const size_t consumer = thread - nrProducers;
+
+      for (size_t i = consumer; i < nrElements; i += nrConsumers)
+        (void)queue->remove();
+    }
+  }
+
+  return nrElements / (omp_get_wtime() - start);
+}
+
+
+// Passes an element back and forth between two threads.
+// Returns the average one-way latency, in seconds.
+template<typename QueueT>
+double latency(size_t nrRoundTrips)
+{
+  SmartPtr<QueueT> ping = Factory<QueueT>::create("", 16);
+  SmartPtr<QueueT> pong = Factory<QueueT>::create("", 16);
+
+  const double start = omp_get_wtime();
+
+# pragma omp parallel sections num_threads(2)
+  {
+#   pragma omp section
+    for (size_t i = 0; i < nrRoundTrips; ++i) {
+      ping->append(i + 1, false);
+      (void)pong->remove();
+    }
+
+#   pragma omp section
+    for (size_t i = 0; i < nrRoundTrips; ++i) {
+      pong->append(ping->remove(), false);
+    }
+  }
+
+  return (omp_get_wtime() - start) / nrRoundTrips / 2;
+}
+
+
+template<typename QueueT>
+void report(const string &name, size_t nrElements, bool multi)
+{
+  cout << setw(10) << name
+       << setw(14) << throughput<QueueT>(1, 1, nrElements) << " el/s (1:1)";
+
+  if (multi)
+    cout << setw(14) << throughput<QueueT>(4, 4, nrElements) << " el/s (4:4)";
+  else
+    cout << setw(14) << "-" << " el/s (4:4)";
+
+  cout << setw(14) << latency<QueueT>(nrElements / 10) * 1e6 << " us latency" << endl;
+}
+
+
+int main(int argc, char **argv)
+{
+  INIT_LOGGER("tQueuePerf");
+
+  const size_t nrElements = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  try {
+    report< Queue<size_t> >("Queue", nrElements, true);
+    report< SPSCQueue<size_t> >("SPSCQueue", nrElements, false);
+    report< MPMCQueue<size_t> >("MPMCQueue", nrElements, true);
+  } catch (Exception &ex) {
+    cout << "Unexpected exception: " << ex << endl;
+    return 1;
+  }
+
+  return 0;
+}
+
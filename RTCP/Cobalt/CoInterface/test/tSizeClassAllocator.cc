@@ -0,0 +1,219 @@
+//# tSizeClassAllocator.cc
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <CoInterface/Allocator.h>
+#include <CoInterface/Exceptions.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <omp.h>
+
+#include <Common/LofarLogger.h>
+
+using namespace LOFAR;
+using namespace Cobalt;
+using namespace std;
+
+bool inArena(const Arena &arena, void *ptr, size_t size)
+{
+  char *begin = static_cast<char *>(arena.begin());
+
+  return static_cast<char *>(ptr) >= begin && static_cast<char *>(ptr) + size <= begin + arena.size();
+}
+
+void testAlignment()
+{
+  MallocedArena arena(1024 * 1024, 64);
+  SizeClassAllocator allocator(arena);
+
+  const size_t alignments[] = { 1, 8, 64, 512, 4096 };
+  vector<void *> ptrs;
+
+  for (size_t a = 0; a < sizeof alignments / sizeof alignments[0]; a++)
+    for (size_t size = 1; size < 20000; size = size * 3 + 1) {
+      void *ptr = allocator.allocate(size, alignments[a]);
+
+      assert(reinterpret_cast<size_t>(ptr) % alignments[a] == 0);
+      assert(inArena(arena, ptr, size));
+
+      memset(ptr, 0xAA, size);
+      ptrs.push_back(ptr);
+    }
+
+  SizeClassAllocator::Statistics stats = allocator.statistics();
+  assert(stats.nrAllocations == ptrs.size());
+  assert(stats.blockBytes >= stats.allocatedBytes);
+  cout << stats << endl;
+
+  for (size_t i = 0; i < ptrs.size(); i++)
+    allocator.deallocate(ptrs[i]);
+
+  assert(allocator.empty());
+  assert(allocator.statistics().allocatedBytes == 0);
+}
+
+void testReuse()
+{
+  MallocedArena arena(1024 * 1024, 64);
+  SizeClassAllocator allocator(arena);
+
+  void *ptr = allocator.allocate(1000);
+  allocator.deallocate(ptr);
+
+  // the same size class gets the same block back
+  assert(allocator.allocate(990) == ptr);
+  allocator.deallocate(ptr);
+
+  allocator.deallocate(0);
+  assert(allocator.empty());
+}
+
+void testErrors()
+{
+  MallocedArena arena(1024 * 1024, 64);
+  SizeClassAllocator allocator(arena);
+
+  // too large
+  try {
+    (void)allocator.allocate(2 * 1024 * 1024);
+    assert(false);
+  } catch (CoInterfaceException &) {
+  }
+
+  // not ours
+  int onStack;
+  try {
+    allocator.deallocate(&onStack);
+    assert(false);
+  } catch (CoInterfaceException &) {
+  }
+
+  // double free
+  void *ptr = allocator.allocate(100);
+  allocator.deallocate(ptr);
+  try {
+    allocator.deallocate(ptr);
+    assert(false);
+  } catch (CoInterfaceException &) {
+  }
+
+  assert(allocator.empty());
+}
+
+void testFull()
+{
+  const size_t arenaSize = 1024 * 1024;
+  MallocedArena arena(arenaSize, 64);
+  SizeClassAllocator allocator(arena);
+
+  // fill the arena with large blocks
+  vector<void *> ptrs;
+
+  try {
+    for (;;)
+      ptrs.push_back(allocator.allocate(60000));
+  } catch (CoInterfaceException &) {
+  }
+
+  assert(ptrs.size() >= arenaSize / 65536 - 1);
+
+  for (size_t i = 0; i < ptrs.size(); i++)
+    allocator.deallocate(ptrs[i]);
+
+  // smaller allocations fit in the freed larger blocks
+  ptrs.clear();
+  for (size_t i = 0; i < arenaSize / 65536 - 1; i++)
+    ptrs.push_back(allocator.allocate(1000));
+
+  for (size_t i = 0; i < ptrs.size(); i++)
+    allocator.deallocate(ptrs[i]);
+
+  assert(allocator.empty());
+}
+
+void testThreads()
+{
+  MallocedArena arena(16 * 1024 * 1024, 64);
+  SizeClassAllocator allocator(arena, 64 * 1024);
+
+  const size_t nrThreads = 4, nrBlocks = 1000;
+  vector<void *> ptrs(nrThreads * nrBlocks);
+
+  // allocate in one thread, free in another
+# pragma omp parallel num_threads(nrThreads)
+  {
+    const size_t thread = omp_get_thread_num();
+
+    for (size_t round = 0; round < 10; round++) {
+      for (size_t i = thread * nrBlocks; i < (thread + 1) * nrBlocks; i++) {
+        ptrs[i] = allocator.allocate(64 + (i * 37) % 2000, 32);
+        memset(ptrs[i], thread, 64);
+      }
+
+#     pragma omp barrier
+
+      const size_t other = (thread + 1) % nrThreads;
+      for (size_t i = other * nrBlocks; i < (other + 1) * nrBlocks; i++)
+        allocator.deallocate(ptrs[i]);
+
+#     pragma omp barrier
+    }
+  }
+
+  SizeClassAllocator::Statistics stats = allocator.statistics();
+  cout << stats << endl;
+
+  assert(stats.nrAllocations == 0);
+  assert(stats.allocatedBytes == 0);
+  assert(stats.nrAllocateCalls == 10 * nrThreads * nrBlocks);
+  assert(stats.nrLockedCalls < stats.nrAllocateCalls);
+}
+
+void testMappedArena()
+{
+  MappedArena arena(3 * 1024 * 1024, true, 0);
+  assert(arena.size() == 3 * 1024 * 1024);
+
+  cout << "MappedArena: huge pages: " << arena.hugePages() << endl;
+
+  SizeClassAllocator allocator(arena);
+  void *ptr = allocator.allocate(arena.size() / 2);
+  memset(ptr, 0, arena.size() / 2);
+  allocator.deallocate(ptr);
+}
+
+int main()
+{
+  INIT_LOGGER("tSizeClassAllocator");
+
+  testAlignment();
+  testReuse();
+  testErrors();
+  testFull();
+  testThreads();
+  testMappedArena();
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+//# tSizeClassAllocatorPerf.cc
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+#include <Common/LofarLogger.h>
+#include <CoInterface/Allocator.h>
+
+using namespace LOFAR;
+using namespace Cobalt;
+using namespace std;
+
+// Compares the throughput of HeapAllocator, SparseSetAllocator and
+// SizeClassAllocator. Each thread keeps a window of live allocations,
+// and replaces the oldest one by a new one of a random size per step.
+//
+// Usage: tSizeClassAllocatorPerf [nrSteps] [maxThreads]
+
+const size_t arenaSize = 256 * 1024 * 1024;
+const size_t windowSize = 64;
+
+// Block sizes as used for sample and visibility buffers, plus small bookkeeping.
+const size_t sizes[] = { 64, 200, 1024, 3000, 16384, 49152, 131072, 524288 };
+const size_t nrSizes = sizeof sizes / sizeof sizes[0];
+
+// Returns the number of allocate+deallocate pairs per second, over all threads.
+double throughput(Allocator &allocator, size_t nrThreads, size_t nrSteps)
+{
+  const double start = omp_get_wtime();
+
+# pragma omp parallel num_threads(nrThreads)
+  {
+    unsigned short seed[3] = { 1, 2, (unsigned short)omp_get_thread_num() };
+    vector<void *> window(windowSize, (void *) 0);
+
+    for (size_t i = 0; i < nrSteps; i++) {
+      void *&slot = window[i % windowSize];
+
+      allocator.deallocate(slot);
+      slot = allocator.allocate(sizes[nrand48(seed) % nrSizes], 64);
+    }
+
+    for (size_t i = 0; i < windowSize; i++)
+      allocator.deallocate(window[i]);
+  }
+
+  return nrThreads * nrSteps / (omp_get_wtime() - start);
+}
+
+
+void report(const string &name, Allocator &allocator, size_t nrSteps, size_t maxThreads)
+{
+  cout << setw(20) << name;
+
+  for (size_t nrThreads = 1; nrThreads <= maxThreads; nrThreads *= 2)
+    cout << setw(14) << throughput(allocator, nrThreads, nrSteps) << " op/s (" << nrThreads << ")";
+
+  cout << endl;
+}
+
+
+int main(int argc, char **argv)
+{
+  INIT_LOGGER("tSizeClassAllocatorPerf");
+
+  const size_t nrSteps = argc > 1 ? atoi(argv[1]) : 100000;
+  const size_t maxThreads = argc > 2 ? atoi(argv[2]) : 4;
+
+  try {
+    report("HeapAllocator", heapAllocator, nrSteps, maxThreads);
+
+    {
+      MallocedArena arena(arenaSize, 64);
+      SparseSetAllocator allocator(arena);
+      report("SparseSetAllocator", allocator, nrSteps / 10, maxThreads);
+    }
+
+    {
+      MappedArena arena(arenaSize, true);
+      SizeClassAllocator allocator(arena);
+      report("SizeClassAllocator", allocator, nrSteps, maxThreads);
+
+      cout << allocator.statistics() << endl;
+    }
+  } catch (Exception &ex) {
+    cout << "Unexpected exception: " << ex << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -33,8 +33,10 @@
 # include <GPUProc/cuda/Kernels/IncoherentStokesTransposeKernel.h>
 #elif defined (USE_OPENCL)
 # include <GPUProc/opencl/Kernels/IncoherentStokesTransposeKernel.h>
+#elif defined (USE_CPU)
+# include <GPUProc/cpu/Kernels/IncoherentStokesTransposeKernel.h>
 #else
-# error "Either CUDA or OpenCL must be enabled, not neither"
+# error "Either CUDA, OpenCL or CPU must be enabled, not neither"
 #endif
 
 #endif
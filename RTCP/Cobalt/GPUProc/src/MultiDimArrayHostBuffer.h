@@ -33,8 +33,10 @@
 # include "cuda/MultiDimArrayHostBuffer.h"
 #elif defined (USE_OPENCL)
 # include "opencl/MultiDimArrayHostBuffer.h"
+#elif defined (USE_CPU)
+# include "cpu/MultiDimArrayHostBuffer.h"
 #else
-# error "Either CUDA or OpenCL must be enabled, not neither"
+# error "Either CUDA, OpenCL or CPU must be enabled, not neither"
 #endif
 
 #endif
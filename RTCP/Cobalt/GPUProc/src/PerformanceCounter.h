@@ -33,8 +33,10 @@
 # include "cuda/PerformanceCounter.h"
 #elif defined (USE_OPENCL)
 # include "opencl/PerformanceCounter.h"
+#elif defined (USE_CPU)
+# include "cpu/PerformanceCounter.h"
 #else
-# error "Either CUDA or OpenCL must be enabled, not neither"
+# error "Either CUDA, OpenCL or CPU must be enabled, not neither"
 #endif
 
 #endif
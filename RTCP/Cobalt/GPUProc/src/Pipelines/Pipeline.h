@@ -33,8 +33,11 @@
 # include <GPUProc/cuda/Pipelines/Pipeline.h>
 #elif defined (USE_OPENCL)
 # include <GPUProc/opencl/Pipelines/Pipeline.h>
+#elif defined (USE_CPU)
+// The CUDA version only uses the generic gpu:: API, so it is shared.
+# include <GPUProc/cuda/Pipelines/Pipeline.h>
 #else
-# error "Either CUDA or OpenCL must be enabled, not neither"
+# error "Either CUDA, OpenCL or CPU must be enabled, not neither"
 #endif
 
 #endif
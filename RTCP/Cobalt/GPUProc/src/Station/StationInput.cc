@@ -361,7 +361,8 @@ namespace LOFAR {
             // Write valid packets to the current and/or next packet
             //copyRSPTimer.start();
 
-            for (size_t p = 0; p < RT_PACKET_BATCH_SIZE; ++p) {
+            // Only the first nrRead packets have been received
+            for (size_t p = 0; p < rspData->packets.nrRead; ++p) {
               struct RSP &packet = rspData->packets[p];
 
               if (packet.payloadError())
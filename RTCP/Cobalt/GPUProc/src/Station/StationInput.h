@@ -38,6 +38,7 @@
 #include <InputProc/Buffer/BoardMode.h>
 #include <InputProc/RSPTimeStamp.h>
 #include <InputProc/Station/RSP.h>
+#include <InputProc/Station/PacketReader.h>
 
 #include "StationTranspose.h"
 
@@ -90,9 +91,10 @@ namespace LOFAR {
 
       static const unsigned NONRT_PACKET_BATCH_SIZE = 1;
 
-      // Data received from an RSP board
+      // Data received from an RSP board. The packets are received
+      // in place, and read from there by writeRSP*().
       struct RSPData {
-        std::vector<struct RSP> packets;
+        PacketBatch packets;
         size_t board; // annotation used in non-rt mode
 
         RSPData(size_t numPackets):
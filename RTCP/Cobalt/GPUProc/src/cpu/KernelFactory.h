@@ -0,0 +1,92 @@
+//# KernelFactory.h
+//#
+//# Copyright (C) 2012-2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_GPUPROC_CPU_KERNELFACTORY_H
+#define LOFAR_GPUPROC_CPU_KERNELFACTORY_H
+
+#include <string>
+#include <CoInterface/Parset.h>
+#include <GPUProc/Kernels/Kernel.h>
+#include <GPUProc/gpu_wrapper.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    // Abstract base class of the templated KernelFactory class.
+    class KernelFactoryBase
+    {
+    public:
+      // Pure virtual destructor, because this is an abstract base class.
+      virtual ~KernelFactoryBase() = 0;
+    };
+
+    // Declaration of a generic factory class. Each concrete Kernel class
+    // (e.g. FIR_FilterKernel) must provide a constructor taking a stream,
+    // buffers and parameters, and a Parameters::bufferSize() method.
+    //
+    // Unlike the CUDA version, there is nothing to compile at run-time: CPU
+    // kernels are compiled along with the rest of the code.
+    template<typename T> class KernelFactory : public KernelFactoryBase
+    {
+    public:
+      // typedef typename T::Parameters Parameters;
+      typedef typename T::BufferType BufferType;
+      typedef typename T::Buffers Buffers;
+
+      // Construct a factory for creating Kernel objects of type \c T, using the
+      // settings provided by \a params.
+      KernelFactory(const typename T::Parameters &params) :
+        itsParameters(params)
+      {
+      }
+
+      // Create a new Kernel object of type \c T.
+      T* create(const gpu::Stream& stream,
+                gpu::DeviceMemory &inputBuffer,
+                gpu::DeviceMemory &outputBuffer) const
+      {
+        const typename T::Buffers buffers(inputBuffer, outputBuffer);
+
+        // Since we use overlapping input/output buffers, their size
+        // could be larger than we need.
+        ASSERT(buffers.input.size() >= bufferSize(T::INPUT_DATA));
+        ASSERT(buffers.output.size() >= bufferSize(T::OUTPUT_DATA));
+
+        return new T(stream, buffers, itsParameters);
+      }
+
+      // Return required buffer size for \a bufferType
+      size_t bufferSize(BufferType bufferType) const
+      {
+        return itsParameters.bufferSize(bufferType);
+      }
+
+    private:
+      // Additional parameters needed to create a Kernel object of type \c T.
+      typename T::Parameters itsParameters;
+    };
+
+  } // namespace Cobalt
+
+} // namespace LOFAR
+
+#endif
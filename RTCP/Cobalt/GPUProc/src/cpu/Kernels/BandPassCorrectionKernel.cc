@@ -0,0 +1,143 @@
+//# BandPassCorrectionKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "BandPassCorrectionKernel.h"
+
+#include <GPUProc/BandPass.h>
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarLogger.h>
+
+#include <boost/format.hpp>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    BandPassCorrectionKernel::Parameters::Parameters(const Parset& ps) :
+      Kernel::Parameters("bandpassCorrection"),
+      nrStations(ps.settings.antennaFields.size()),
+
+      nrDelayCompensationChannels(ps.settings.beamFormer.nrDelayCompensationChannels),
+      nrHighResolutionChannels(ps.settings.beamFormer.nrHighResolutionChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrHighResolutionChannels),
+
+      correctBandPass(ps.settings.corrections.bandPass)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.BandPassCorrectionKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_BandPassCorrectionKernel.dat") % 
+            ps.settings.observationID );
+    }
+
+    size_t BandPassCorrectionKernel::Parameters::bufferSize(BandPassCorrectionKernel::BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case BandPassCorrectionKernel::INPUT_DATA: 
+        return 
+            (size_t) nrStations * NR_POLARIZATIONS * 
+            nrSamplesPerChannel *
+            nrHighResolutionChannels *
+            sizeof(std::complex<float>);
+      case BandPassCorrectionKernel::OUTPUT_DATA:
+        return
+            (size_t) nrStations * NR_POLARIZATIONS * 
+            nrSamplesPerChannel *
+            nrHighResolutionChannels *
+            sizeof(std::complex<float>);
+      case BandPassCorrectionKernel::BAND_PASS_CORRECTION_WEIGHTS:
+        return
+            (size_t) nrHighResolutionChannels * sizeof(float);
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+    BandPassCorrectionKernel::BandPassCorrectionKernel(const gpu::Stream& stream,
+                                       const Buffers& buffers,
+                                       const Parameters& params) :
+      Kernel(stream, buffers, params),
+      itsKernelParameters(params),
+      bandPassCorrectionWeights(stream.getContext(), params.bufferSize(BAND_PASS_CORRECTION_WEIGHTS))
+    {
+      ASSERT(params.nrHighResolutionChannels %
+             params.nrDelayCompensationChannels == 0);
+
+      size_t nrSamples = params.nrStations * params.nrSamplesPerChannel *
+                         params.nrHighResolutionChannels * NR_POLARIZATIONS;
+      nrOperations = nrSamples ;
+      nrBytesRead = nrBytesWritten = nrSamples * sizeof(std::complex<float>);
+
+      BandPass::computeCorrectionFactors(
+        static_cast<float*>(bandPassCorrectionWeights.get()),
+        params.nrHighResolutionChannels,
+        1.0 / params.nrHighResolutionChannels);
+    }
+
+
+    void BandPassCorrectionKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+
+      const unsigned nrChannels1 = p.nrDelayCompensationChannels;
+      const unsigned nrChannels2 = p.nrHighResolutionChannels / nrChannels1;
+      const unsigned nrSamples = p.nrSamplesPerChannel;
+
+      const float *weights =
+        static_cast<const float*>(bandPassCorrectionWeights.get());
+      const fcomplex *input = static_cast<const fcomplex*>(itsBuffers.input.get());
+      fcomplex *output = static_cast<fcomplex*>(itsBuffers.output.get());
+
+      const int nrJobs = p.nrStations * nrChannels1;
+
+#     pragma omp parallel for schedule(static)
+      for (int job = 0; job < nrJobs; job++) {
+        const unsigned station = job / nrChannels1;
+        const unsigned channel1 = job % nrChannels1;
+
+        for (unsigned sample = 0; sample < nrSamples; sample++) {
+          for (unsigned channel2 = 0; channel2 < nrChannels2; channel2++) {
+            const unsigned channel = channel1 * nrChannels2 + channel2;
+            const float weight = p.correctBandPass ? weights[channel] : 1.0f;
+
+            // [station][channel][sample][pol]
+            fcomplex *out = output +
+              (((size_t)station * p.nrHighResolutionChannels + channel)
+                * nrSamples + sample) * NR_POLARIZATIONS;
+
+            for (unsigned pol = 0; pol < NR_POLARIZATIONS; pol++) {
+              // [station][pol][channel1][sample][channel2]
+              out[pol] = weight * input[
+                ((((size_t)station * NR_POLARIZATIONS + pol) * nrChannels1
+                  + channel1) * nrSamples + sample) * nrChannels2 + channel2];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
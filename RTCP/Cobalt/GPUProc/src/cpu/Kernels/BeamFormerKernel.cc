@@ -0,0 +1,187 @@
+//# BeamFormerKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "BeamFormerKernel.h"
+
+#include <Common/lofar_complex.h>
+#include <Common/LofarLogger.h>
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+
+#include <boost/format.hpp>
+#include <cmath>
+#include <vector>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    BeamFormerKernel::Parameters::Parameters(const Parset& ps) :
+      Kernel::Parameters("beamFormer"),
+      nrStations(ps.settings.antennaFields.size()),
+
+      nrChannels(ps.settings.beamFormer.nrHighResolutionChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrChannels),
+
+      nrSAPs(ps.settings.beamFormer.SAPs.size()),
+      nrTABs(ps.settings.beamFormer.maxNrCoherentTABsPerSAP()),
+      subbandBandwidth(ps.settings.subbandWidth()),
+      doFlysEye(ps.settings.beamFormer.doFlysEye)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.BeamFormerKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_BeamFormerKernel.dat") % 
+            ps.settings.observationID);
+    }
+
+
+    size_t BeamFormerKernel::Parameters::bufferSize(BufferType bufferType) const {
+      switch (bufferType) {
+      case BeamFormerKernel::INPUT_DATA: 
+        return
+          (size_t) nrChannels *
+          nrSamplesPerChannel * NR_POLARIZATIONS *
+          nrStations * sizeof(std::complex<float>);
+      case BeamFormerKernel::OUTPUT_DATA:
+        return
+          (size_t) nrChannels * 
+          nrSamplesPerChannel * NR_POLARIZATIONS *
+          nrTABs * sizeof(std::complex<float>);
+      case BeamFormerKernel::BEAM_FORMER_DELAYS:
+        return 
+          (size_t) nrSAPs * nrStations *
+          nrTABs * sizeof(double);
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+
+    BeamFormerKernel::BeamFormerKernel(const gpu::Stream& stream,
+                                       const Buffers& buffers,
+                                       const Parameters& params) :
+      Kernel(stream, buffers, params),
+      beamFormerDelays(stream.getContext(), params.bufferSize(BEAM_FORMER_DELAYS)),
+      itsKernelParameters(params),
+      itsSubbandFrequency(0.0),
+      itsSAP(0)
+    {
+      ASSERT(!params.doFlysEye || params.nrStations == params.nrTABs);
+
+      nrOperations = (size_t) params.nrChannels * params.nrSamplesPerChannel *
+                     NR_POLARIZATIONS * params.nrStations * params.nrTABs * 8;
+      nrBytesRead = params.bufferSize(INPUT_DATA);
+      nrBytesWritten = params.bufferSize(OUTPUT_DATA);
+    }
+
+    void BeamFormerKernel::enqueue(const BlockID &blockId,
+                                   double subbandFrequency, unsigned SAP)
+    {
+      ASSERT(SAP < itsKernelParameters.nrSAPs);
+
+      itsSubbandFrequency = subbandFrequency;
+      itsSAP = SAP;
+      Kernel::enqueue(blockId);
+    }
+
+
+    void BeamFormerKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+
+      const unsigned nrChannels = p.nrChannels;
+      const unsigned nrSamples = p.nrSamplesPerChannel;
+      const unsigned nrStations = p.nrStations;
+      const unsigned nrTABs = p.nrTABs;
+
+      const fcomplex *input = static_cast<const fcomplex*>(itsBuffers.input.get());
+      fcomplex *output = static_cast<fcomplex*>(itsBuffers.output.get());
+
+      // [sap][station][tab]
+      const double *delays = static_cast<const double*>(beamFormerDelays.get()) +
+                             (size_t)itsSAP * nrStations * nrTABs;
+
+#     pragma omp parallel for schedule(static)
+      for (int ch = 0; ch < (int)nrChannels; ch++) {
+        const unsigned channel = ch;
+
+        if (p.doFlysEye) {
+          // Only transpose [station][channel][time][pol] to
+          // [channel][time][tab][pol], with tab == station.
+          for (unsigned time = 0; time < nrSamples; time++)
+            for (unsigned tab = 0; tab < nrTABs; tab++)
+              for (unsigned pol = 0; pol < NR_POLARIZATIONS; pol++)
+                output[(((size_t)channel * nrSamples + time) * nrTABs + tab)
+                         * NR_POLARIZATIONS + pol] =
+                  input[(((size_t)tab * nrChannels + channel) * nrSamples + time)
+                         * NR_POLARIZATIONS + pol];
+          continue;
+        }
+
+        const double frequency = nrChannels == 1
+          ? itsSubbandFrequency
+          : itsSubbandFrequency - 0.5 * p.subbandBandwidth +
+            channel * (p.subbandBandwidth / nrChannels);
+
+        // Compute the weights in double precision, because the phase can
+        // become large (see dphaseShift() in gpu_math.cuh).
+        std::vector<fcomplex> weights((size_t)nrStations * nrTABs);
+
+        for (unsigned station = 0; station < nrStations; station++) {
+          for (unsigned tab = 0; tab < nrTABs; tab++) {
+            const double phi =
+              -2.0 * M_PI * delays[station * nrTABs + tab] * frequency;
+
+            weights[station * nrTABs + tab] = fcomplex(cos(phi), sin(phi));
+          }
+        }
+
+        for (unsigned time = 0; time < nrSamples; time++) {
+          // [channel][time][tab][pol]
+          fcomplex *out = output +
+            ((size_t)channel * nrSamples + time) * nrTABs * NR_POLARIZATIONS;
+
+          for (unsigned i = 0; i < nrTABs * NR_POLARIZATIONS; i++)
+            out[i] = 0.0f;
+
+          for (unsigned station = 0; station < nrStations; station++) {
+            // [station][channel][time][pol]
+            const fcomplex *in = input +
+              (((size_t)station * nrChannels + channel) * nrSamples + time)
+                * NR_POLARIZATIONS;
+
+            for (unsigned tab = 0; tab < nrTABs; tab++) {
+              const fcomplex weight = weights[station * nrTABs + tab];
+
+              for (unsigned pol = 0; pol < NR_POLARIZATIONS; pol++)
+                out[tab * NR_POLARIZATIONS + pol] += weight * in[pol];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
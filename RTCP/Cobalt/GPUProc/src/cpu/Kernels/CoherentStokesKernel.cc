@@ -0,0 +1,155 @@
+//# CoherentStokesKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "CoherentStokesKernel.h"
+
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarLogger.h>
+
+#include <boost/format.hpp>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    CoherentStokesKernel::Parameters::Parameters(const Parset& ps) :
+      Kernel::Parameters("coherentStokes"),
+      nrChannels(ps.settings.beamFormer.coherentSettings.nrChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrChannels),
+      nrTABs(ps.settings.beamFormer.maxNrCoherentTABsPerSAP()),
+
+      nrStokes(ps.settings.beamFormer.coherentSettings.nrStokes),
+      outputComplexVoltages(ps.settings.beamFormer.coherentSettings.type == STOKES_XXYY),
+      timeIntegrationFactor(ps.settings.beamFormer.coherentSettings.timeIntegrationFactor)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.CoherentStokesKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_CoherentStokesKernel.dat") % 
+            ps.settings.observationID);
+    }
+
+
+    size_t CoherentStokesKernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case CoherentStokesKernel::INPUT_DATA:
+        return
+          (size_t) nrChannels * nrSamplesPerChannel *
+            NR_POLARIZATIONS * nrTABs * sizeof(std::complex<float>);
+      case CoherentStokesKernel::OUTPUT_DATA:
+        return 
+          (size_t) nrTABs * nrStokes * nrSamplesPerChannel /
+            timeIntegrationFactor * nrChannels * sizeof(float);
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+
+    CoherentStokesKernel::CoherentStokesKernel(const gpu::Stream& stream,
+                                               const Buffers& buffers,
+                                               const Parameters& params) :
+      Kernel(stream, buffers, params),
+      itsKernelParameters(params)
+    {
+      ASSERT(params.timeIntegrationFactor > 0);
+      ASSERT(params.nrSamplesPerChannel % params.timeIntegrationFactor == 0);
+      ASSERT(params.nrStokes == 1 || params.nrStokes == 4);
+      ASSERT(!params.outputComplexVoltages || params.nrStokes == 4);
+
+      nrOperations = (size_t) params.nrChannels * params.nrSamplesPerChannel * params.nrTABs * (params.nrStokes == 1 ? 8 : 20 + 2.0 / params.timeIntegrationFactor);
+      nrBytesRead = params.bufferSize(INPUT_DATA);
+      nrBytesWritten = params.bufferSize(OUTPUT_DATA);
+    }
+
+
+    void CoherentStokesKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+
+      const unsigned nrChannels = p.nrChannels;
+      const unsigned nrSamples = p.nrSamplesPerChannel;
+      const unsigned nrIntegrations = nrSamples / p.timeIntegrationFactor;
+
+      const fcomplex *input = static_cast<const fcomplex*>(itsBuffers.input.get());
+      float *output = static_cast<float*>(itsBuffers.output.get());
+
+      const int nrJobs = p.nrTABs * nrIntegrations;
+
+#     pragma omp parallel for schedule(static)
+      for (int job = 0; job < nrJobs; job++) {
+        const unsigned tab = job / nrIntegrations;
+        const unsigned integration = job % nrIntegrations;
+
+        // [tab][pol][time][channel]
+        const fcomplex *inX = input +
+          ((size_t)tab * NR_POLARIZATIONS + 0) * nrSamples * nrChannels;
+        const fcomplex *inY = input +
+          ((size_t)tab * NR_POLARIZATIONS + 1) * nrSamples * nrChannels;
+
+        // [tab][stokes][time / timeIntegrationFactor][channel]
+        float *out = output +
+          ((size_t)tab * p.nrStokes * nrIntegrations + integration) * nrChannels;
+        const size_t stokesStride = (size_t)nrIntegrations * nrChannels;
+
+        for (unsigned channel = 0; channel < nrChannels; channel++) {
+          float stokes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+          for (unsigned t = 0; t < p.timeIntegrationFactor; t++) {
+            const size_t time = (size_t)integration * p.timeIntegrationFactor + t;
+            const fcomplex X = inX[time * nrChannels + channel];
+            const fcomplex Y = inY[time * nrChannels + channel];
+
+            if (p.outputComplexVoltages) {
+              stokes[0] += real(X);
+              stokes[1] += imag(X);
+              stokes[2] += real(Y);
+              stokes[3] += imag(Y);
+            } else {
+              const float powerX = norm(X);
+              const float powerY = norm(Y);
+
+              stokes[0] += powerX + powerY;
+              stokes[1] += powerX - powerY;
+              stokes[2] += real(X) * real(Y) + imag(X) * imag(Y);
+              stokes[3] += imag(X) * real(Y) - real(X) * imag(Y);
+            }
+          }
+
+          if (!p.outputComplexVoltages) {
+            stokes[2] *= 2.0f;
+            stokes[3] *= 2.0f;
+          }
+
+          for (unsigned s = 0; s < p.nrStokes; s++)
+            out[s * stokesStride + channel] = stokes[s];
+        }
+      }
+    }
+  }
+}
+
@@ -0,0 +1,114 @@
+//# CoherentStokesTransposeKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "CoherentStokesTransposeKernel.h"
+
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarLogger.h>
+
+#include <boost/format.hpp>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    CoherentStokesTransposeKernel::Parameters::Parameters(const Parset& ps) :
+      Kernel::Parameters("coherentStokesTranspose"),
+      nrChannels(ps.settings.beamFormer.nrHighResolutionChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrChannels),
+      nrTABs(ps.settings.beamFormer.maxNrCoherentTABsPerSAP())
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.CoherentStokesTransposeKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_CoherentStokesTransposeKernel.dat") % 
+            ps.settings.observationID);
+    }
+
+
+    size_t CoherentStokesTransposeKernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case CoherentStokesTransposeKernel::INPUT_DATA: 
+      case CoherentStokesTransposeKernel::OUTPUT_DATA:
+        return
+          (size_t) nrChannels * nrSamplesPerChannel * 
+            NR_POLARIZATIONS * nrTABs * sizeof(std::complex<float>);
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+
+    CoherentStokesTransposeKernel::
+    CoherentStokesTransposeKernel(const gpu::Stream& stream,
+                                  const Buffers& buffers,
+                                  const Parameters& params) :
+      Kernel(stream, buffers, params),
+      itsKernelParameters(params)
+    {
+      ASSERT(params.nrSamplesPerChannel > 0);
+      ASSERT(params.nrTABs > 0);
+
+      nrOperations = 0;
+      nrBytesRead = nrBytesWritten =
+        (size_t) params.nrTABs * NR_POLARIZATIONS * params.nrChannels * 
+        params.nrSamplesPerChannel * sizeof(std::complex<float>);
+    }
+
+
+    void CoherentStokesTransposeKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+
+      const unsigned nrChannels = p.nrChannels;
+      const unsigned nrSamples = p.nrSamplesPerChannel;
+      const unsigned nrTABs = p.nrTABs;
+
+      const fcomplex *input = static_cast<const fcomplex*>(itsBuffers.input.get());
+      fcomplex *output = static_cast<fcomplex*>(itsBuffers.output.get());
+
+      const int nrJobs = nrTABs * NR_POLARIZATIONS;
+
+#     pragma omp parallel for schedule(static)
+      for (int job = 0; job < nrJobs; job++) {
+        const unsigned tab = job / NR_POLARIZATIONS;
+        const unsigned pol = job % NR_POLARIZATIONS;
+
+        // [tab][pol][time][channel]
+        fcomplex *out = output + (size_t)job * nrSamples * nrChannels;
+
+        for (unsigned time = 0; time < nrSamples; time++)
+          for (unsigned channel = 0; channel < nrChannels; channel++)
+            // [channel][time][tab][pol]
+            out[time * nrChannels + channel] =
+              input[(((size_t)channel * nrSamples + time) * nrTABs + tab)
+                      * NR_POLARIZATIONS + pol];
+      }
+    }
+  }
+}
+
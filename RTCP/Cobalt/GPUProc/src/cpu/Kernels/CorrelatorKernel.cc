@@ -0,0 +1,158 @@
+//# CorrelatorKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "CorrelatorKernel.h"
+
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarLogger.h>
+
+#include <boost/format.hpp>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    CorrelatorKernel::Parameters::Parameters(const Parset& ps) :
+      Kernel::Parameters("correlator"),
+      nrStations(ps.settings.antennaFields.size()),
+      // Not used by the CPU implementation, but kept for compatibility
+      // with the GPU parameters.
+      nrStationsPerThread(2),
+
+      nrChannels(ps.settings.correlator.nrChannels),
+      nrSamplesPerIntegration(ps.settings.correlator.nrSamplesPerBlock / ps.settings.correlator.nrIntegrationsPerBlock),
+      nrIntegrationsPerBlock(ps.settings.correlator.nrIntegrationsPerBlock)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.CorrelatorKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_CorrelatorKernel.dat") % 
+            ps.settings.observationID);
+    }
+
+    unsigned CorrelatorKernel::Parameters::nrBaselines() const {
+      return nrStations * (nrStations + 1) / 2;
+    }
+
+    size_t CorrelatorKernel::Parameters::nrSamplesPerBlock() const {
+      return nrSamplesPerIntegration * nrIntegrationsPerBlock;
+    }
+
+    size_t CorrelatorKernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case CorrelatorKernel::INPUT_DATA:
+        return
+          (size_t) nrChannels * nrSamplesPerBlock() * nrStations * 
+            NR_POLARIZATIONS * sizeof(std::complex<float>);
+      case CorrelatorKernel::OUTPUT_DATA:
+        return 
+          (size_t) nrIntegrationsPerBlock * nrBaselines() * nrChannels * 
+            NR_POLARIZATIONS * NR_POLARIZATIONS * sizeof(std::complex<float>);
+      default: 
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+    CorrelatorKernel::CorrelatorKernel(const gpu::Stream& stream,
+                                       const Buffers& buffers,
+                                       const Parameters& params) :
+      Kernel(stream, buffers, params),
+      itsKernelParameters(params)
+    {
+      nrOperations = (size_t) params.nrChannels * params.nrBaselines() *
+                     params.nrSamplesPerBlock() * 32;
+      nrBytesRead = params.bufferSize(INPUT_DATA);
+      nrBytesWritten = params.bufferSize(OUTPUT_DATA);
+    }
+
+
+    void CorrelatorKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+
+      const unsigned nrChannels = p.nrChannels;
+      const unsigned nrSamples = p.nrSamplesPerIntegration;
+      const unsigned nrIntegrations = p.nrIntegrationsPerBlock;
+
+      // Channel 0 is "corrupted" by the second PPF and is not correlated,
+      // unless it is the only channel. Its output is left untouched, as on
+      // the GPU.
+      const unsigned firstChannel = nrChannels == 1 ? 0 : 1;
+
+      const fcomplex *input = static_cast<const fcomplex*>(itsBuffers.input.get());
+      fcomplex *output = static_cast<fcomplex*>(itsBuffers.output.get());
+
+      const int nrJobs = p.nrBaselines() * (nrChannels - firstChannel);
+
+#     pragma omp parallel for schedule(dynamic)
+      for (int job = 0; job < nrJobs; job++) {
+        const unsigned baseline = job / (nrChannels - firstChannel);
+        const unsigned channel = firstChannel + job % (nrChannels - firstChannel);
+
+        // baseline = major * (major + 1) / 2 + minor, with major >= minor
+        unsigned major = 0;
+        while ((major + 1) * (major + 2) / 2 <= baseline)
+          major++;
+        const unsigned minor = baseline - major * (major + 1) / 2;
+
+        for (unsigned integration = 0; integration < nrIntegrations; integration++) {
+          // [station][channel][integration][sample][pol]
+          const fcomplex *sample0 = input +
+            (((size_t)major * nrChannels + channel) * nrIntegrations
+              + integration) * nrSamples * NR_POLARIZATIONS;
+          const fcomplex *sampleA = input +
+            (((size_t)minor * nrChannels + channel) * nrIntegrations
+              + integration) * nrSamples * NR_POLARIZATIONS;
+
+          fcomplex vis[NR_POLARIZATIONS][NR_POLARIZATIONS];
+
+          for (unsigned pol0 = 0; pol0 < NR_POLARIZATIONS; pol0++)
+            for (unsigned polA = 0; polA < NR_POLARIZATIONS; polA++)
+              vis[pol0][polA] = 0.0f;
+
+          for (unsigned time = 0; time < nrSamples; time++)
+            for (unsigned pol0 = 0; pol0 < NR_POLARIZATIONS; pol0++)
+              for (unsigned polA = 0; polA < NR_POLARIZATIONS; polA++)
+                vis[pol0][polA] +=
+                  sample0[time * NR_POLARIZATIONS + pol0] *
+                  conj(sampleA[time * NR_POLARIZATIONS + polA]);
+
+          // [integration][baseline][channel][pol][pol]
+          fcomplex *out = output +
+            (((size_t)integration * p.nrBaselines() + baseline) * nrChannels
+              + channel) * NR_POLARIZATIONS * NR_POLARIZATIONS;
+
+          // NOTE: XY and YX polarizations are swapped (see issue #5640)
+          for (unsigned pol0 = 0; pol0 < NR_POLARIZATIONS; pol0++)
+            for (unsigned polA = 0; polA < NR_POLARIZATIONS; polA++)
+              out[polA * NR_POLARIZATIONS + pol0] = vis[pol0][polA];
+        }
+      }
+    }
+  }
+}
+
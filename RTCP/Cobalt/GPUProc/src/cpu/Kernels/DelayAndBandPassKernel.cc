@@ -0,0 +1,284 @@
+//# DelayAndBandPassKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "DelayAndBandPassKernel.h"
+#include "IntToFloat.h"
+
+#include <GPUProc/BandPass.h>
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarLogger.h>
+
+#include <boost/format.hpp>
+
+#include <cmath>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    namespace {
+      // Read sample [station][time][pol] from station data, and convert it
+      // to float.
+      fcomplex stationSample(const void *input, unsigned nrBitsPerSample,
+                             size_t index)
+      {
+        switch (nrBitsPerSample) {
+        case 16: {
+          const i16complex s = static_cast<const i16complex*>(input)[index];
+          return fcomplex(convertIntToFloat(real(s)), convertIntToFloat(imag(s)));
+        }
+
+        case 8: {
+          const i8complex s = static_cast<const i8complex*>(input)[index];
+          return fcomplex(convertIntToFloat(real(s)), convertIntToFloat(imag(s)));
+        }
+
+        default: {
+          const int8 s = static_cast<const int8*>(input)[index];
+          return fcomplex(convert4BitToFloat(extract4BitRI(s, false)),
+                          convert4BitToFloat(extract4BitRI(s, true)));
+        }
+        }
+      }
+    }
+
+    DelayAndBandPassKernel::Parameters::Parameters(const Parset& ps, bool correlator) :
+      Kernel::Parameters(correlator ? "delayAndBandPass" : "delayCompensation"),
+      nrStations(ps.settings.antennaFields.size()),
+      nrBitsPerSample(ps.settings.nrBitsPerSample),
+      inputIsStationData(correlator && ps.settings.correlator.nrChannels == 1
+                                    ? true
+                                    : false),
+
+      nrChannels(correlator ? ps.settings.correlator.nrChannels
+                            : ps.settings.beamFormer.nrDelayCompensationChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrChannels),
+      subbandBandwidth(ps.settings.subbandWidth()),
+
+      nrSAPs(ps.settings.SAPs.size()),
+      
+      delayCompensation(ps.settings.delayCompensation.enabled),
+      correctBandPass(correlator ? ps.settings.corrections.bandPass
+                                 : false),
+      transpose(correlator ? true
+                           : false)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.DelayAndBandPassKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_DelayAndBandPassKernel_%c%c%c.dat") % 
+            ps.settings.observationID %
+            (correctBandPass ? "B" : "b") %
+            (delayCompensation ? "D" : "d") %
+            (transpose ? "T" : "t"));
+    }
+
+
+    unsigned DelayAndBandPassKernel::Parameters::nrSamplesPerSubband() const {
+      return nrChannels * nrSamplesPerChannel;
+    }
+
+
+    unsigned DelayAndBandPassKernel::Parameters::nrBytesPerComplexSample() const {
+      return inputIsStationData
+               ? 2 * nrBitsPerSample / 8
+               : sizeof(std::complex<float>);
+    }
+
+
+    size_t DelayAndBandPassKernel::Parameters::bufferSize(BufferType bufferType) const {
+      switch (bufferType) {
+      case DelayAndBandPassKernel::INPUT_DATA: 
+        return 
+          (size_t) nrStations * NR_POLARIZATIONS * 
+            nrSamplesPerSubband() * nrBytesPerComplexSample();
+      case DelayAndBandPassKernel::OUTPUT_DATA:
+        return
+          (size_t) nrStations * NR_POLARIZATIONS * 
+            nrSamplesPerSubband() * sizeof(std::complex<float>);
+      case DelayAndBandPassKernel::DELAYS:
+        return 
+          (size_t) nrSAPs * nrStations * 
+            NR_POLARIZATIONS * sizeof(double);
+      case DelayAndBandPassKernel::PHASE_ZEROS:
+        return
+          (size_t) nrStations * NR_POLARIZATIONS * sizeof(double);
+      case DelayAndBandPassKernel::BAND_PASS_CORRECTION_WEIGHTS:
+        return
+          correctBandPass ? (size_t) nrChannels * sizeof(float) : 1UL;
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+
+    DelayAndBandPassKernel::DelayAndBandPassKernel(const gpu::Stream& stream,
+                                       const Buffers& buffers,
+                                       const Parameters& params) :
+      Kernel(stream, buffers, params),
+      delaysAtBegin(stream.getContext(), params.bufferSize(DELAYS)),
+      delaysAfterEnd(stream.getContext(), params.bufferSize(DELAYS)),
+      phase0s(stream.getContext(), params.bufferSize(PHASE_ZEROS)),
+      itsKernelParameters(params),
+      bandPassCorrectionWeights(stream.getContext(), params.bufferSize(BAND_PASS_CORRECTION_WEIGHTS)),
+      itsSubbandFrequency(0.0),
+      itsSAP(0)
+    {
+      LOG_DEBUG_STR("DelayAndBandPassKernel:" <<
+                    " delayCompensation=" <<
+                    (params.delayCompensation ? "true" : "false") <<
+                    " #channels/sb=" << params.nrChannels <<
+                    " correctBandPass=" << 
+                    (params.correctBandPass ? "true" : "false") <<
+                    " transpose=" << (params.transpose ? "true" : "false"));
+
+      ASSERT(params.nrChannels % 16 == 0 || params.nrChannels == 1);
+      ASSERT(params.nrSamplesPerChannel % 16 == 0);
+
+      size_t nrSamples = (size_t)params.nrStations * params.nrChannels * params.nrSamplesPerChannel * NR_POLARIZATIONS;
+      nrOperations = nrSamples * 12;
+      nrBytesRead = nrBytesWritten = nrSamples * params.nrBytesPerComplexSample();
+
+      // Initialise bandpass correction weights
+      if (params.correctBandPass)
+      {
+        BandPass::computeCorrectionFactors(
+          static_cast<float*>(bandPassCorrectionWeights.get()),
+          params.nrChannels);
+      }
+    }
+
+
+    void DelayAndBandPassKernel::enqueue(const BlockID &blockId,
+                                         double subbandFrequency, unsigned SAP)
+    {
+      ASSERT(SAP < itsKernelParameters.nrSAPs);
+
+      itsSubbandFrequency = subbandFrequency;
+      itsSAP = SAP;
+      Kernel::enqueue(blockId);
+    }
+
+
+    void DelayAndBandPassKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+
+      const unsigned nrChannels = p.nrChannels;
+      const unsigned nrSamples = p.nrSamplesPerChannel;
+
+      // Band pass correction only makes sense on channelised data
+      const bool correctBandPass = p.correctBandPass && nrChannels > 1;
+
+      const double *delaysBegin = static_cast<const double*>(delaysAtBegin.get());
+      const double *delaysEnd = static_cast<const double*>(delaysAfterEnd.get());
+      const double *phaseOffsets = static_cast<const double*>(phase0s.get());
+      const float *bandPassWeights =
+        static_cast<const float*>(bandPassCorrectionWeights.get());
+
+      const void *input = itsBuffers.input.get();
+      fcomplex *output = static_cast<fcomplex*>(itsBuffers.output.get());
+
+      const int nrJobs = p.nrStations * nrChannels;
+
+#     pragma omp parallel for schedule(static)
+      for (int job = 0; job < nrJobs; job++) {
+        const unsigned station = job / nrChannels;
+        const unsigned channel = job % nrChannels;
+
+        const float weight = correctBandPass ? bandPassWeights[channel] : 1.0f;
+
+        // Delay compensation means rotating the phase of each sample BACK.
+        // See DelayAndBandPass.cu for the derivation.
+        double phiAtBegin[NR_POLARIZATIONS] = { 0.0, 0.0 };
+        double phiAfterEnd[NR_POLARIZATIONS] = { 0.0, 0.0 };
+
+        if (p.delayCompensation) {
+          const double frequency = nrChannels == 1
+            ? itsSubbandFrequency
+            : itsSubbandFrequency - 0.5 * p.subbandBandwidth
+                + channel * (p.subbandBandwidth / nrChannels);
+
+          for (unsigned pol = 0; pol < NR_POLARIZATIONS; pol++) {
+            const size_t delayIdx =
+              ((size_t)itsSAP * p.nrStations + station) * NR_POLARIZATIONS + pol;
+
+            phiAtBegin[pol] = -2.0 * M_PI * frequency * delaysBegin[delayIdx]
+                              - phaseOffsets[station * NR_POLARIZATIONS + pol];
+            phiAfterEnd[pol] = -2.0 * M_PI * frequency * delaysEnd[delayIdx]
+                              - phaseOffsets[station * NR_POLARIZATIONS + pol];
+          }
+        }
+
+        for (unsigned time = 0; time < nrSamples; time++) {
+          fcomplex sample[NR_POLARIZATIONS];
+
+          for (unsigned pol = 0; pol < NR_POLARIZATIONS; pol++) {
+            if (p.inputIsStationData) {
+              // [station][time][pol]
+              sample[pol] = stationSample(input, p.nrBitsPerSample,
+                ((size_t)station * nrSamples + time) * NR_POLARIZATIONS + pol);
+            } else {
+              // [station][pol][time][channel]
+              sample[pol] = static_cast<const fcomplex*>(input)[
+                (((size_t)station * NR_POLARIZATIONS + pol) * nrSamples + time)
+                  * nrChannels + channel];
+            }
+
+            if (p.delayCompensation) {
+              // Offset of this sample between begin and end.
+              const double timeOffset = double(time) / nrSamples;
+
+              // Interpolate the required phase rotation for this sample.
+              const float phi = phiAtBegin[pol]  * (1.0 - timeOffset)
+                              + phiAfterEnd[pol] *        timeOffset;
+
+              sample[pol] *= fcomplex(cosf(phi), sinf(phi));
+            }
+
+            sample[pol] *= weight;
+          }
+
+          if (p.transpose) {
+            // [station][channel][time][pol]
+            fcomplex *out = output +
+              (((size_t)station * nrChannels + channel) * nrSamples + time)
+                * NR_POLARIZATIONS;
+
+            out[0] = sample[0];
+            out[1] = sample[1];
+          } else {
+            // [station][pol][channel][time]
+            for (unsigned pol = 0; pol < NR_POLARIZATIONS; pol++)
+              output[(((size_t)station * NR_POLARIZATIONS + pol) * nrChannels
+                       + channel) * nrSamples + time] = sample[pol];
+          }
+        }
+      }
+    }
+  }
+}
+
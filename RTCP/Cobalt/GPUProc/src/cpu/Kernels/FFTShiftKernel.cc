@@ -0,0 +1,91 @@
+//# FFTShiftKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "FFTShiftKernel.h"
+
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <Common/lofar_complex.h>
+
+#include <boost/format.hpp>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    FFTShiftKernel::Parameters::Parameters(const Parset& ps, unsigned nrSTABs, unsigned nrChannels, const std::string &name):
+      Kernel::Parameters(name),
+      nrSTABs(nrSTABs),
+
+      nrChannels(nrChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrChannels)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.FFTShiftKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_FFTShiftKernel.dat") % 
+            ps.settings.observationID);
+    }
+
+
+    size_t FFTShiftKernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case FFTShiftKernel::INPUT_DATA:  // fall tru
+      case FFTShiftKernel::OUTPUT_DATA:
+        return (size_t)nrSTABs * NR_POLARIZATIONS *
+          nrChannels * nrSamplesPerChannel *
+          sizeof(std::complex<float>);
+          
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+    FFTShiftKernel::FFTShiftKernel(const gpu::Stream& stream,
+                                   const Buffers& buffers,
+                                   const Parameters& params) :
+      Kernel(stream, buffers, params),
+      nrSamples((size_t)params.nrSTABs * NR_POLARIZATIONS *
+                params.nrChannels * params.nrSamplesPerChannel)
+    {
+      // Number of samples per channel must be even
+      ASSERT(params.nrSamplesPerChannel % 2 == 0);
+
+      nrOperations = nrSamples;
+      nrBytesRead = nrBytesWritten = nrSamples * sizeof(std::complex<float>);
+    }
+
+
+    void FFTShiftKernel::launch() const
+    {
+      fcomplex *data = static_cast<fcomplex*>(itsBuffers.input.get());
+
+#     pragma omp parallel for schedule(static)
+      for (long sample = 1; sample < (long)nrSamples; sample += 2)
+        data[sample] = -data[sample];
+    }
+  }
+}
+
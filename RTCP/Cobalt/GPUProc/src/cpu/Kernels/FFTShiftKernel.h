@@ -0,0 +1,75 @@
+//# FFTShiftKernel.h
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_GPUPROC_CPU_FFT_SHIFT_KERNEL_H
+#define LOFAR_GPUPROC_CPU_FFT_SHIFT_KERNEL_H
+
+#include <CoInterface/Parset.h>
+
+#include <GPUProc/Kernels/Kernel.h>
+#include <GPUProc/KernelFactory.h>
+#include <GPUProc/gpu_wrapper.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    // Multiply the odd samples by -1, in place in the input buffer. This
+    // shifts the zero frequency to the centre of the spectrum of the next
+    // FFT. See FFTShift.cu for the GPU version of this kernel.
+    class FFTShiftKernel : public Kernel
+    {
+    public:
+      enum BufferType
+      {
+        INPUT_DATA,
+        OUTPUT_DATA
+      };
+
+      // Parameters that must be passed to the constructor of the
+      // FFTShiftKernel class.
+      struct Parameters : Kernel::Parameters
+      {
+        Parameters(const Parset& ps, unsigned nrSTABs, unsigned nrChannels, const std::string &name = "FFT-shift");
+        unsigned nrSTABs;
+
+        unsigned nrChannels;
+        unsigned nrSamplesPerChannel;
+
+        size_t bufferSize(BufferType bufferType) const;
+      };
+
+      // Construct a FFTShift kernel.
+      // \pre The number of samples per channel must be even.
+      FFTShiftKernel(const gpu::Stream &stream,
+                     const Buffers &buffers,
+                     const Parameters &param);
+
+    protected:
+      void launch() const;
+
+    private:
+      const size_t nrSamples;
+    };
+  }
+}
+
+#endif
+
@@ -0,0 +1,121 @@
+//# FFT_Kernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "FFT_Kernel.h"
+
+#include <cmath>
+#include <complex>
+
+#include <Common/LofarLogger.h>
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <GPUProc/OpenMP_Lock.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    namespace {
+      // Only fftwf_execute*() is thread safe; FFTW planning is not.
+      OMP_Lock planLock;
+    }
+
+    FFT_Kernel::Parameters::Parameters(unsigned fftSize, unsigned nrSamples, bool forward, const std::string &name)
+    :
+      Kernel::Parameters(name),
+      fftSize(fftSize),
+      nrSamples(nrSamples),
+      forward(forward)
+    {
+    }
+
+    size_t FFT_Kernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case FFT_Kernel::INPUT_DATA: 
+      case FFT_Kernel::OUTPUT_DATA:
+        return (size_t) nrSamples * sizeof(std::complex<float>);
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+    FFT_Kernel::FFT_Kernel(const gpu::Stream &stream,
+                           const Buffers& buffers,
+                           const Parameters& params)
+      :
+      Kernel(stream, buffers, params),
+      fftSize(params.fftSize),
+      nrFFTs(params.nrSamples / params.fftSize)
+    {
+      // fftSize must fit into nrSamples an exact number of times
+      ASSERT(params.nrSamples % params.fftSize == 0);
+
+      fftwf_complex *in  = static_cast<fftwf_complex*>(buffers.input.get());
+      fftwf_complex *out = static_cast<fftwf_complex*>(buffers.output.get());
+
+      {
+        OMP_ScopedLock sl(planLock);
+
+        // FFTW_ESTIMATE does not touch the buffers. The plan is created for
+        // the actual buffers, so that it matches their in-place-ness; we
+        // execute it on other offsets in the same buffers, which need not
+        // have the same alignment.
+        plan = fftwf_plan_dft_1d(params.fftSize, in, out,
+                                 params.forward ? FFTW_FORWARD : FFTW_BACKWARD,
+                                 FFTW_ESTIMATE | FFTW_UNALIGNED);
+      }
+
+      if (plan == NULL)
+        THROW(gpu::CPUException, "fftwf_plan_dft_1d failed for fftSize=" <<
+              params.fftSize);
+
+      nrOperations = (size_t) nrFFTs * 5 * params.fftSize * log2(params.fftSize);
+      nrBytesRead = nrBytesWritten = params.bufferSize(INPUT_DATA);
+
+      LOG_DEBUG_STR("FFT_Kernel: " <<
+                    "fftSize=" << params.fftSize << 
+                    ", direction=" << (params.forward ? "forward" : "inverse") <<
+                    ", nrFFTs=" << nrFFTs);
+    }
+
+    FFT_Kernel::~FFT_Kernel()
+    {
+      OMP_ScopedLock sl(planLock);
+
+      fftwf_destroy_plan(plan);
+    }
+
+    void FFT_Kernel::launch() const
+    {
+      fftwf_complex *in  = static_cast<fftwf_complex*>(itsBuffers.input.get());
+      fftwf_complex *out = static_cast<fftwf_complex*>(itsBuffers.output.get());
+
+#     pragma omp parallel for schedule(static)
+      for (int fft = 0; fft < (int)nrFFTs; fft++) {
+        fftwf_execute_dft(plan, in  + (size_t)fft * fftSize,
+                                out + (size_t)fft * fftSize);
+      }
+    }
+  }
+}
+
@@ -0,0 +1,80 @@
+//# FFT_Kernel.h
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_GPUPROC_CPU_FFT_KERNEL_H
+#define LOFAR_GPUPROC_CPU_FFT_KERNEL_H
+
+#include <fftw3.h>
+
+#include <GPUProc/gpu_wrapper.h>
+#include <GPUProc/PerformanceCounter.h>
+#include <GPUProc/Kernels/Kernel.h>
+#include <GPUProc/KernelFactory.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    // Batch of complex-to-complex FFTs, implemented using FFTW. Like cuFFT,
+    // the result is not normalised.
+    class FFT_Kernel: public Kernel
+    {
+    public:
+      enum BufferType
+      {
+        INPUT_DATA,
+        OUTPUT_DATA
+      };
+
+      // Parameters that must be passed to the constructor of the
+      // FFT_Kernel class.
+      struct Parameters : Kernel::Parameters
+      {
+        Parameters(unsigned fftSize, unsigned nrSamples, bool forward, const std::string &name = "FFT");
+
+        unsigned fftSize;
+        unsigned nrSamples;
+        bool forward;
+
+        size_t bufferSize(FFT_Kernel::BufferType bufferType) const;
+      };
+
+      FFT_Kernel(const gpu::Stream &stream,
+                 const Buffers& buffers,
+                 const Parameters& params);
+
+      ~FFT_Kernel();
+
+    protected:
+      void launch() const;
+
+    private:
+      const unsigned fftSize;
+      const unsigned nrFFTs;
+
+      // Plan for a single FFT of fftSize points. Plans are executed
+      // concurrently on different parts of the buffers, which is safe
+      // for the fftwf_execute_dft() new-array interface.
+      fftwf_plan plan;
+    };
+  }
+}
+#endif
+
@@ -0,0 +1,388 @@
+//# FIR_FilterKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "FIR_FilterKernel.h"
+#include "IntToFloat.h"
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+
+#include <boost/format.hpp>
+
+#include <complex>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    namespace {
+      // Each of the input readers below returns half a complex sample (so
+      // real OR imag) as stored in the history buffer, and converts such a
+      // value to float. The history buffer stores samples in the input
+      // type, except for 4-bit mode in which each half is stored as a full
+      // byte, like in FIR_Filter.cu.
+
+      // Data comes from station: intX[stab][sample][channel][pol][ri]
+      template<typename T> struct StationInput
+      {
+        typedef T HistoryType;
+
+        StationInput(const void *data, unsigned nrSamplesPerChannel,
+                     unsigned nrChannels) :
+          data(static_cast<const T*>(data)),
+          nrSamplesPerChannel(nrSamplesPerChannel),
+          nrChannels(nrChannels)
+        {
+        }
+
+        T sample(unsigned stab, unsigned time, unsigned channel,
+                 unsigned pol_ri) const
+        {
+          return data[(((size_t)stab * nrSamplesPerChannel + time)
+                         * nrChannels + channel) * NR_POLARIZATIONS * 2 + pol_ri];
+        }
+
+        static float convert(T x)
+        {
+          return convertIntToFloat(x);
+        }
+
+        const T *data;
+        const unsigned nrSamplesPerChannel, nrChannels;
+      };
+
+      // Data comes from station: int4[stab][sample][channel][pol][ri], with
+      // real and imag packed in a single byte.
+      struct Station4BitInput
+      {
+        typedef int8 HistoryType;
+
+        Station4BitInput(const void *data, unsigned nrSamplesPerChannel,
+                         unsigned nrChannels) :
+          data(static_cast<const int8*>(data)),
+          nrSamplesPerChannel(nrSamplesPerChannel),
+          nrChannels(nrChannels)
+        {
+        }
+
+        int8 sample(unsigned stab, unsigned time, unsigned channel,
+                    unsigned pol_ri) const
+        {
+          return extract4BitRI(
+            data[(((size_t)stab * nrSamplesPerChannel + time)
+                    * nrChannels + channel) * NR_POLARIZATIONS + pol_ri / 2],
+            pol_ri % 2 == 1);
+        }
+
+        static float convert(int8 x)
+        {
+          return convert4BitToFloat(x);
+        }
+
+        const int8 *data;
+        const unsigned nrSamplesPerChannel, nrChannels;
+      };
+
+      // Data comes from beam-former pipeline: float[stab][pol][sample][channel][ri]
+      struct BeamFormedInput
+      {
+        typedef float HistoryType;
+
+        BeamFormedInput(const void *data, unsigned nrSamplesPerChannel,
+                        unsigned nrChannels) :
+          data(static_cast<const float*>(data)),
+          nrSamplesPerChannel(nrSamplesPerChannel),
+          nrChannels(nrChannels)
+        {
+        }
+
+        float sample(unsigned stab, unsigned time, unsigned channel,
+                     unsigned pol_ri) const
+        {
+          return data[((((size_t)stab * NR_POLARIZATIONS + pol_ri / 2)
+                         * nrSamplesPerChannel + time) * nrChannels + channel)
+                         * 2 + pol_ri % 2];
+        }
+
+        static float convert(float x)
+        {
+          return x;
+        }
+
+        const float *data;
+        const unsigned nrSamplesPerChannel, nrChannels;
+      };
+
+      // Apply the FIR filter for subband \a subbandIdx:
+      //
+      //   output[stab][pol][time][channel][ri] =
+      //     sum_{tap} weights[channel][tap] * x[stab][time - tap][channel][pol][ri]
+      //
+      // where x[..][-1 .. -(nrTaps-1)][..] is taken from the history.
+      template<typename Input>
+      void firFilter(const FIR_FilterKernel::Parameters &p,
+                     const Input &input,
+                     const float *weights,
+                     typename Input::HistoryType *history,
+                     unsigned subbandIdx,
+                     float *output)
+      {
+        const unsigned nrTaps = p.nrTaps;
+        const unsigned nrHistory = nrTaps - 1;
+        const unsigned nrChannels = p.nrChannels;
+        const unsigned nrSamples = p.nrSamplesPerChannel;
+        const int nrJobs = p.nrSTABs * nrChannels;
+
+#       pragma omp parallel
+        {
+          // delay line: the history, followed by the samples of this block
+          vector<float> line(nrHistory + nrSamples);
+
+#         pragma omp for schedule(static)
+          for (int job = 0; job < nrJobs; job++) {
+            const unsigned stab = job / nrChannels;
+            const unsigned channel = job % nrChannels;
+            const float *w = weights + (size_t)channel * nrTaps;
+
+            for (unsigned pol_ri = 0; pol_ri < NR_POLARIZATIONS * 2; pol_ri++) {
+              const unsigned pol = pol_ri / 2;
+              const unsigned ri = pol_ri % 2;
+
+              // history[subband][stab][tap][channel][pol_ri]
+              typename Input::HistoryType *hist = history +
+                ((size_t)subbandIdx * p.nrSTABs + stab) * nrHistory
+                  * nrChannels * NR_POLARIZATIONS * 2;
+
+              for (unsigned t = 0; t < nrHistory; t++)
+                line[t] = Input::convert(
+                  hist[((size_t)t * nrChannels + channel) * NR_POLARIZATIONS * 2 + pol_ri]);
+
+              for (unsigned time = 0; time < nrSamples; time++)
+                line[nrHistory + time] =
+                  Input::convert(input.sample(stab, time, channel, pol_ri));
+
+              float *out = output +
+                (((size_t)stab * NR_POLARIZATIONS + pol) * nrSamples * nrChannels
+                  + channel) * 2 + ri;
+
+              for (unsigned time = 0; time < nrSamples; time++) {
+                float sum = 0.0f;
+
+                for (unsigned tap = 0; tap < nrTaps; tap++)
+                  sum += w[tap] * line[nrHistory + time - tap];
+
+                out[(size_t)time * nrChannels * 2] = sum;
+              }
+
+              // Save the last samples as history for the next block
+              for (unsigned t = 0; t < nrHistory; t++)
+                hist[((size_t)t * nrChannels + channel) * NR_POLARIZATIONS * 2 + pol_ri] =
+                  input.sample(stab, nrSamples - nrHistory + t, channel, pol_ri);
+            }
+          }
+        }
+      }
+    }
+
+    FIR_FilterKernel::Parameters::Parameters(const Parset& ps, unsigned nrSTABs, bool inputIsStationData, unsigned nrSubbands, unsigned nrChannels, float scaleFactor, const std::string &name) :
+      Kernel::Parameters(name),
+      nrSTABs(nrSTABs),
+      nrBitsPerSample(ps.settings.nrBitsPerSample),
+
+      nrChannels(nrChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrChannels),
+
+      nrSubbands(nrSubbands),
+      scaleFactor(scaleFactor),
+      inputIsStationData(inputIsStationData)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.FIR_FilterKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_FIR_FilterKernel.dat") % 
+            ps.settings.observationID);
+
+    }
+
+    const unsigned FIR_FilterKernel::Parameters::nrTaps;
+
+    unsigned FIR_FilterKernel::Parameters::nrSamplesPerSubband() const
+    {
+      return nrChannels * nrSamplesPerChannel;
+    }
+
+    unsigned FIR_FilterKernel::Parameters::nrBytesPerComplexSample() const
+    {
+      return inputIsStationData
+               ? 2 * nrBitsPerSample / 8
+               : sizeof(std::complex<float>);
+    }
+
+    unsigned FIR_FilterKernel::Parameters::nrHistorySamples() const
+    {
+      return (nrTaps - 1) * nrChannels;
+    }
+
+    size_t FIR_FilterKernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case FIR_FilterKernel::INPUT_DATA: 
+        return
+          (size_t) nrSamplesPerSubband() *
+            nrSTABs * NR_POLARIZATIONS * 
+            nrBytesPerComplexSample();
+      case FIR_FilterKernel::OUTPUT_DATA:
+        return
+          (size_t) nrSamplesPerSubband() * nrSTABs * 
+            NR_POLARIZATIONS * sizeof(std::complex<float>);
+      case FIR_FilterKernel::FILTER_WEIGHTS:
+        return 
+          (size_t) nrChannels * nrTaps *
+            sizeof(float);
+      case FIR_FilterKernel::HISTORY_DATA:
+        // History is split over 2 bytes in 4-bit mode, to avoid unnecessary packing/unpacking
+        return
+          (size_t) nrSubbands *
+            nrHistorySamples() * nrSTABs * 
+            NR_POLARIZATIONS * (nrBitsPerSample == 4 ? 2U : nrBytesPerComplexSample());
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+    FIR_FilterKernel::FIR_FilterKernel(const gpu::Stream& stream,
+                                       const Buffers& buffers,
+                                       const Parameters& params) :
+      Kernel(stream, buffers, params),
+      params(params),
+      filterWeights(stream.getContext(), params.bufferSize(FILTER_WEIGHTS)),
+      historySamples(stream.getContext(), params.bufferSize(HISTORY_DATA)),
+      historyFlags(boost::extents[params.nrSubbands][params.nrSTABs]),
+      itsSubbandIdx(0)
+    {
+      ASSERT(params.nrSamplesPerChannel >= params.nrTaps - 1);
+      ASSERTSTR(!params.inputIsStationData ||
+                params.nrBitsPerSample == 4 ||
+                params.nrBitsPerSample == 8 ||
+                params.nrBitsPerSample == 16,
+                "Unsupported nrBitsPerSample: " << params.nrBitsPerSample);
+
+      unsigned nrSamples = 
+        params.nrSTABs * params.nrChannels * 
+        NR_POLARIZATIONS;
+
+      nrOperations = 
+        (size_t) nrSamples * params.nrSamplesPerChannel * params.nrTaps * 2 * 2;
+
+      nrBytesRead = 
+        (size_t) nrSamples * (params.nrTaps - 1 + params.nrSamplesPerChannel) * 
+          params.nrBytesPerComplexSample();
+
+      nrBytesWritten = 
+        (size_t) nrSamples * params.nrSamplesPerChannel * sizeof(std::complex<float>);
+
+      FilterBank filterBank(true, params.nrTaps, 
+                            params.nrChannels, KAISER);
+      filterBank.negateWeights();
+      filterBank.scaleWeights(params.scaleFactor);
+
+      std::memcpy(filterWeights.get(), filterBank.getWeights().origin(),
+                  filterWeights.size());
+
+      // start with all history samples flagged
+      for (size_t n = 0; n < historyFlags.num_elements(); ++n)
+        historyFlags.origin()[n].include(0, params.nrHistorySamples());
+
+      // set all history samples to 0, to prevent adding uninitialised data
+      // to the stream
+      historySamples.set(0);
+    }
+
+    void FIR_FilterKernel::enqueue(const BlockID &blockId,
+                                   unsigned subbandIdx)
+    {
+      ASSERT(subbandIdx < params.nrSubbands);
+
+      itsSubbandIdx = subbandIdx;
+      Kernel::enqueue(blockId);
+    }
+
+    void FIR_FilterKernel::launch() const
+    {
+      const float *weights = static_cast<const float*>(filterWeights.get());
+      float *output = static_cast<float*>(itsBuffers.output.get());
+      const void *input = itsBuffers.input.get();
+      void *history = historySamples.get();
+
+      if (!params.inputIsStationData) {
+        firFilter(params,
+                  BeamFormedInput(input, params.nrSamplesPerChannel, params.nrChannels),
+                  weights, static_cast<float*>(history), itsSubbandIdx, output);
+        return;
+      }
+
+      switch (params.nrBitsPerSample) {
+      case 16:
+        firFilter(params,
+                  StationInput<int16>(input, params.nrSamplesPerChannel, params.nrChannels),
+                  weights, static_cast<int16*>(history), itsSubbandIdx, output);
+        break;
+
+      case 8:
+        firFilter(params,
+                  StationInput<int8>(input, params.nrSamplesPerChannel, params.nrChannels),
+                  weights, static_cast<int8*>(history), itsSubbandIdx, output);
+        break;
+
+      case 4:
+        firFilter(params,
+                  Station4BitInput(input, params.nrSamplesPerChannel, params.nrChannels),
+                  weights, static_cast<int8*>(history), itsSubbandIdx, output);
+        break;
+      }
+    }
+
+    void FIR_FilterKernel::prefixHistoryFlags(MultiDimArray<SparseSet<unsigned>, 1> &inputFlags, unsigned subbandIdx) {
+      for (unsigned stationIdx = 0; stationIdx < params.nrSTABs; ++stationIdx) {
+        // shift sample flags to the right to make room for the history flags
+        inputFlags[stationIdx] += params.nrHistorySamples();
+
+        // add the history flags.
+        inputFlags[stationIdx] |= historyFlags[subbandIdx][stationIdx];
+
+        // Save the new history flags for the next block.
+        // Note that the nrSamples is the number of samples
+        // WITHOUT history samples, but we've also just shifted everything
+        // by nrHistorySamples.
+        historyFlags[subbandIdx][stationIdx] =
+          inputFlags[stationIdx].subset(params.nrSamplesPerSubband(), params.nrSamplesPerSubband() + params.nrHistorySamples());
+
+        // Shift the flags to index 0
+        historyFlags[subbandIdx][stationIdx] -= params.nrSamplesPerSubband();
+      }
+    }
+  }
+}
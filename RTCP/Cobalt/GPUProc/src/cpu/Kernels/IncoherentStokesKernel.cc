@@ -0,0 +1,149 @@
+//# IncoherentStokesKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "IncoherentStokesKernel.h"
+
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarLogger.h>
+
+#include <boost/format.hpp>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    IncoherentStokesKernel::Parameters::Parameters(const Parset& ps) :
+      Kernel::Parameters("incoherentStokes"),
+      nrStations(ps.settings.antennaFields.size()),
+      nrChannels(ps.settings.beamFormer.incoherentSettings.nrChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrChannels),
+
+      nrStokes(ps.settings.beamFormer.incoherentSettings.nrStokes),
+      timeIntegrationFactor(ps.settings.beamFormer.incoherentSettings.timeIntegrationFactor)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.IncoherentStokesKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_IncoherentStokesKernel.dat") % 
+            ps.settings.observationID);
+    }
+
+
+    size_t IncoherentStokesKernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case IncoherentStokesKernel::INPUT_DATA:
+        return 
+          (size_t) nrStations * NR_POLARIZATIONS * 
+          nrSamplesPerChannel * 
+          nrChannels * sizeof(std::complex<float>);
+      case IncoherentStokesKernel::OUTPUT_DATA:
+        return 
+          (size_t) nrStokes * nrSamplesPerChannel / 
+          timeIntegrationFactor * 
+          nrChannels * sizeof(float);
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+
+    IncoherentStokesKernel::IncoherentStokesKernel(const gpu::Stream& stream,
+                                                   const Buffers& buffers,
+                                                   const Parameters& params) :
+      Kernel(stream, buffers, params),
+      itsKernelParameters(params)
+    {
+      ASSERT(params.timeIntegrationFactor > 0);
+      ASSERT(params.nrSamplesPerChannel % params.timeIntegrationFactor == 0);
+      ASSERT(params.nrStokes == 1 || params.nrStokes == 4);
+
+      nrOperations = (size_t) params.nrStations * params.nrChannels *
+                     params.nrSamplesPerChannel * (params.nrStokes == 1 ? 8 : 20);
+      nrBytesRead = params.bufferSize(INPUT_DATA);
+      nrBytesWritten = params.bufferSize(OUTPUT_DATA);
+    }
+
+
+    void IncoherentStokesKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+
+      const unsigned nrChannels = p.nrChannels;
+      const unsigned nrSamples = p.nrSamplesPerChannel;
+      const unsigned nrIntegrations = nrSamples / p.timeIntegrationFactor;
+
+      const fcomplex *input = static_cast<const fcomplex*>(itsBuffers.input.get());
+      float *output = static_cast<float*>(itsBuffers.output.get());
+
+      const size_t stokesStride = (size_t)nrIntegrations * nrChannels;
+
+#     pragma omp parallel for schedule(static)
+      for (int i = 0; i < (int)nrIntegrations; i++) {
+        const unsigned integration = i;
+
+        for (unsigned channel = 0; channel < nrChannels; channel++) {
+          float stokesI = 0.0f, stokesQ = 0.0f;
+          float halfStokesU = 0.0f, halfStokesV = 0.0f;
+
+          for (unsigned station = 0; station < p.nrStations; station++) {
+            // [station][pol][time][channel]
+            const fcomplex *inX = input +
+              ((size_t)station * NR_POLARIZATIONS + 0) * nrSamples * nrChannels;
+            const fcomplex *inY = input +
+              ((size_t)station * NR_POLARIZATIONS + 1) * nrSamples * nrChannels;
+
+            for (unsigned t = 0; t < p.timeIntegrationFactor; t++) {
+              const size_t time = (size_t)integration * p.timeIntegrationFactor + t;
+              const fcomplex X = inX[time * nrChannels + channel];
+              const fcomplex Y = inY[time * nrChannels + channel];
+
+              const float powerX = norm(X);
+              const float powerY = norm(Y);
+
+              stokesI += powerX + powerY;
+              stokesQ += powerX - powerY;
+              halfStokesU += real(X) * real(Y) + imag(X) * imag(Y);
+              halfStokesV += imag(X) * real(Y) - real(X) * imag(Y);
+            }
+          }
+
+          // [stokes][time / timeIntegrationFactor][channel]
+          float *out = output + (size_t)integration * nrChannels + channel;
+
+          out[0] = stokesI;
+
+          if (p.nrStokes == 4) {
+            out[1 * stokesStride] = stokesQ;
+            out[2 * stokesStride] = 2.0f * halfStokesU;
+            out[3 * stokesStride] = 2.0f * halfStokesV;
+          }
+        }
+      }
+    }
+  }
+}
+
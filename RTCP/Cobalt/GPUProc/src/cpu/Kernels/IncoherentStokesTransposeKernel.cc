@@ -0,0 +1,130 @@
+//# IncoherentStokesTransposeKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "IncoherentStokesTransposeKernel.h"
+
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <CoInterface/Parset.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarLogger.h>
+
+#include <boost/format.hpp>
+#include <algorithm>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    IncoherentStokesTransposeKernel::Parameters::Parameters(const Parset& ps) :
+      Kernel::Parameters("incoherentStokesTranspose"),
+      nrStations(ps.settings.antennaFields.size()),
+      nrChannels(ps.settings.beamFormer.nrHighResolutionChannels),
+      nrSamplesPerChannel(ps.settings.blockSize / nrChannels),
+      tileSize(16)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.IncoherentStokesTransposeKernel.dumpOutput",
+                   false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_IncoherentStokesTransposeKernel.dat") % 
+            ps.settings.observationID);
+    }
+
+
+    size_t IncoherentStokesTransposeKernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case IncoherentStokesTransposeKernel::INPUT_DATA:
+      case IncoherentStokesTransposeKernel::OUTPUT_DATA:
+        return 
+          (size_t) nrStations * 
+          nrChannels * nrSamplesPerChannel * 
+          NR_POLARIZATIONS * sizeof(std::complex<float>);
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+
+    IncoherentStokesTransposeKernel::
+    IncoherentStokesTransposeKernel(const gpu::Stream& stream,
+                                    const Buffers& buffers,
+                                    const Parameters& params) :
+      Kernel(stream, buffers, params),
+      itsKernelParameters(params)
+    {
+      ASSERT(params.tileSize > 0);
+
+      nrOperations = 0;
+      nrBytesRead = nrBytesWritten = params.bufferSize(INPUT_DATA);
+    }
+
+
+    void IncoherentStokesTransposeKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+
+      const unsigned nrChannels = p.nrChannels;
+      const unsigned nrSamples = p.nrSamplesPerChannel;
+      const unsigned tileSize = p.tileSize;
+
+      const unsigned nrChannelTiles = (nrChannels + tileSize - 1) / tileSize;
+      const unsigned nrTimeTiles = (nrSamples + tileSize - 1) / tileSize;
+
+      const fcomplex *input = static_cast<const fcomplex*>(itsBuffers.input.get());
+      fcomplex *output = static_cast<fcomplex*>(itsBuffers.output.get());
+
+      const int nrJobs = p.nrStations * nrChannelTiles;
+
+#     pragma omp parallel for schedule(static)
+      for (int job = 0; job < nrJobs; job++) {
+        const unsigned station = job / nrChannelTiles;
+        const unsigned firstChannel = (job % nrChannelTiles) * tileSize;
+        const unsigned lastChannel = std::min(firstChannel + tileSize, nrChannels);
+
+        // [station][channel][time][pol]
+        const fcomplex *in = input +
+          (size_t)station * nrChannels * nrSamples * NR_POLARIZATIONS;
+
+        for (unsigned timeTile = 0; timeTile < nrTimeTiles; timeTile++) {
+          const unsigned firstTime = timeTile * tileSize;
+          const unsigned lastTime = std::min(firstTime + tileSize, nrSamples);
+
+          for (unsigned pol = 0; pol < NR_POLARIZATIONS; pol++) {
+            // [station][pol][time][channel]
+            fcomplex *out = output +
+              ((size_t)station * NR_POLARIZATIONS + pol) * nrSamples * nrChannels;
+
+            for (unsigned time = firstTime; time < lastTime; time++)
+              for (unsigned channel = firstChannel; channel < lastChannel; channel++)
+                out[(size_t)time * nrChannels + channel] =
+                  in[((size_t)channel * nrSamples + time) * NR_POLARIZATIONS + pol];
+          }
+        }
+      }
+    }
+  }
+}
+
@@ -0,0 +1,67 @@
+//# IntToFloat.h: Functions to convert integer samples to float
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_GPUPROC_CPU_INT_TO_FLOAT_H
+#define LOFAR_GPUPROC_CPU_INT_TO_FLOAT_H
+
+// \file
+// Functions to convert integer samples to float, mirroring IntToFloat.cuh.
+// The most negative value is clamped to balance the range, and 4 and 8 bit
+// samples are scaled to the 16 bit range, so that gains end up the same
+// regardless of the number of bits per sample.
+
+#include <Common/LofarTypes.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    inline float convertIntToFloat(int16 x)
+    {
+      return x;
+    }
+
+    inline float convertIntToFloat(int8 x)
+    {
+      // Edge case. -128 should be returned as -127
+      return 16.0f * (x == -128 ? -127 : x);
+    }
+
+    // Convert an extracted 4-bit real or imaginary part to float.
+    inline float convert4BitToFloat(int8 x)
+    {
+      // Edge case. -8 should be returned as -7
+      return 64.0f * (x == -8 ? -7 : x);
+    }
+
+    // Extract the 4-bit real or imaginary part of an 8-bit input sample.
+    // The imaginary part is in the top 4 bits. See also RSP::decode4bit() in
+    // InputProc/Station/RSP.h.
+    inline int8 extract4BitRI(int8 x, bool imag)
+    {
+      // intermediate after << will be int, not int8,
+      // so cast to get a signed int8 value.
+      return imag ? x >> 4 : (int8)(x << 4) >> 4; // preserve sign
+    }
+  }
+}
+
+#endif
+
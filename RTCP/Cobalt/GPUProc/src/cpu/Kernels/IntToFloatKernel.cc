@@ -0,0 +1,160 @@
+//# IntToFloatKernel.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "IntToFloatKernel.h"
+#include "IntToFloat.h"
+
+#include <CoInterface/BlockID.h>
+#include <CoInterface/Config.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarTypes.h>
+
+#include <boost/format.hpp>
+
+using boost::format;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    namespace {
+      inline fcomplex decode4Bit(int8 sample)
+      {
+        return fcomplex(convert4BitToFloat(extract4BitRI(sample, false)),
+                        convert4BitToFloat(extract4BitRI(sample, true)));
+      }
+    }
+
+    IntToFloatKernel::Parameters::Parameters(const Parset& ps) :
+      Kernel::Parameters("intToFloat"),
+      nrStations(ps.settings.antennaFields.size()),
+      nrBitsPerSample(ps.settings.nrBitsPerSample),
+
+      nrSamplesPerSubband(ps.settings.blockSize)
+    {
+      dumpBuffers = 
+        ps.getBool("Cobalt.Kernels.IntToFloatKernel.dumpOutput", false);
+      dumpFilePattern = 
+        str(format("L%d_SB%%03d_BL%%03d_IntToFloatKernel.dat") % 
+            ps.settings.observationID);
+    }
+
+
+    unsigned IntToFloatKernel::Parameters::nrBytesPerComplexSample() const {
+      return 2 * nrBitsPerSample / 8;
+    }
+
+
+    size_t IntToFloatKernel::Parameters::bufferSize(BufferType bufferType) const
+    {
+      switch (bufferType) {
+      case IntToFloatKernel::INPUT_DATA:
+        return
+          (size_t) nrStations * NR_POLARIZATIONS * 
+            nrSamplesPerSubband * nrBytesPerComplexSample();
+      case IntToFloatKernel::OUTPUT_DATA:
+        return
+          (size_t) nrStations * NR_POLARIZATIONS * 
+            nrSamplesPerSubband * sizeof(std::complex<float>);
+      default:
+        THROW(GPUProcException, "Invalid bufferType (" << bufferType << ")");
+      }
+    }
+
+
+    IntToFloatKernel::IntToFloatKernel(const gpu::Stream& stream,
+                                       const Buffers& buffers,
+                                       const Parameters& params) :
+      Kernel(stream, buffers, params),
+      itsKernelParameters(params)
+    {
+      ASSERTSTR(params.nrBitsPerSample == 4 ||
+                params.nrBitsPerSample == 8 ||
+                params.nrBitsPerSample == 16,
+                "Unsupported nrBitsPerSample: " << params.nrBitsPerSample);
+
+      unsigned nrSamples = params.nrStations * params.nrSamplesPerSubband * NR_POLARIZATIONS;
+      nrOperations = (size_t) nrSamples * 2;
+      nrBytesRead = (size_t) nrSamples * 2 * params.nrBitsPerSample / 8;
+      nrBytesWritten = (size_t) nrSamples * sizeof(std::complex<float>);
+    }
+
+
+    void IntToFloatKernel::launch() const
+    {
+      const Parameters &p = itsKernelParameters;
+      const size_t nrSamples = p.nrSamplesPerSubband;
+
+      fcomplex *output = static_cast<fcomplex*>(itsBuffers.output.get());
+
+#     pragma omp parallel for
+      for (int station = 0; station < (int)p.nrStations; station++) {
+        fcomplex *outX = output + ((size_t)station * NR_POLARIZATIONS + 0) * nrSamples;
+        fcomplex *outY = output + ((size_t)station * NR_POLARIZATIONS + 1) * nrSamples;
+
+        switch (p.nrBitsPerSample) {
+        case 16: {
+          const i16complex *in =
+            static_cast<const i16complex*>(itsBuffers.input.get()) +
+            (size_t)station * nrSamples * NR_POLARIZATIONS;
+
+          for (size_t time = 0; time < nrSamples; time++) {
+            outX[time] = fcomplex(convertIntToFloat(real(in[2 * time + 0])),
+                                  convertIntToFloat(imag(in[2 * time + 0])));
+            outY[time] = fcomplex(convertIntToFloat(real(in[2 * time + 1])),
+                                  convertIntToFloat(imag(in[2 * time + 1])));
+          }
+          break;
+        }
+
+        case 8: {
+          const i8complex *in =
+            static_cast<const i8complex*>(itsBuffers.input.get()) +
+            (size_t)station * nrSamples * NR_POLARIZATIONS;
+
+          for (size_t time = 0; time < nrSamples; time++) {
+            outX[time] = fcomplex(convertIntToFloat(real(in[2 * time + 0])),
+                                  convertIntToFloat(imag(in[2 * time + 0])));
+            outY[time] = fcomplex(convertIntToFloat(real(in[2 * time + 1])),
+                                  convertIntToFloat(imag(in[2 * time + 1])));
+          }
+          break;
+        }
+
+        case 4: {
+          const int8 *in =
+            static_cast<const int8*>(itsBuffers.input.get()) +
+            (size_t)station * nrSamples * NR_POLARIZATIONS;
+
+          for (size_t time = 0; time < nrSamples; time++) {
+            outX[time] = decode4Bit(in[2 * time + 0]);
+            outY[time] = decode4Bit(in[2 * time + 1]);
+          }
+          break;
+        }
+        }
+      }
+    }
+
+  }
+}
+
@@ -0,0 +1,84 @@
+//# Kernel.cc
+//# Copyright (C) 2012-2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <boost/format.hpp>
+
+#include <GPUProc/global_defines.h>
+#include <GPUProc/Kernels/Kernel.h>
+#include <GPUProc/PerformanceCounter.h>
+#include <CoInterface/Parset.h>
+#include <CoInterface/BlockID.h>
+#include <Common/LofarLogger.h>
+
+using namespace std;
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    Kernel::Parameters::Parameters(const std::string &name) :
+      name(name),
+      dumpBuffers(false)
+    {
+    }
+
+
+    Kernel::~Kernel()
+    {
+    }
+
+
+    Kernel::Kernel(const gpu::Stream& stream, 
+                   const Buffers &buffers,
+                   const Parameters &params)
+      : 
+      itsCounter(stream.getContext(), params.name),
+      itsStream(stream),
+      itsBuffers(buffers),
+      itsParameters(params)
+    {
+    }
+
+    void Kernel::enqueue(const BlockID &blockId)
+    {
+      // record duration of last invocation (or noop
+      // if there was none)
+      itsCounter.recordStart(itsStream);
+      launch();
+      itsCounter.recordStop(itsStream);
+
+      if (itsParameters.dumpBuffers && blockId.block >= 0) {
+        itsStream.synchronize();
+        dumpBuffers(blockId);
+      }
+    }
+
+    void Kernel::dumpBuffers(const BlockID &blockId) const
+    {
+      dumpBuffer(itsBuffers.output,
+                 str(boost::format(itsParameters.dumpFilePattern) %
+                     blockId.globalSubbandIdx %
+                     blockId.block));
+    }
+  }
+}
+
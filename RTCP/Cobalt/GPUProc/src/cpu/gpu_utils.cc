@@ -0,0 +1,58 @@
+//# gpu_utils.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <GPUProc/gpu_utils.h>
+
+#include <fstream>
+
+#include <Common/LofarLogger.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    // The CPU kernels are compiled along with the rest of the code, so there
+    // are no run-time compile definitions or flags.
+    CompileDefinitions defaultCompileDefinitions()
+    {
+      CompileDefinitions defs;
+      return defs;
+    }
+
+    CompileFlags defaultCompileFlags()
+    {
+      CompileFlags flags;
+      return flags;
+    }
+
+    void dumpBuffer(const gpu::DeviceMemory &deviceMemory, 
+                    const std::string &dumpFile)
+    {
+      LOG_INFO_STR("Dumping device memory to file: " << dumpFile);
+      std::ofstream ofs(dumpFile.c_str(), std::ios::binary);
+      ofs.write(static_cast<const char*>(deviceMemory.get()),
+                deviceMemory.size());
+    }
+
+  } // namespace Cobalt
+} // namespace LOFAR
+
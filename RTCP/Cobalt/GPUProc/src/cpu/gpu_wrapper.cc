@@ -0,0 +1,537 @@
+//# gpu_wrapper.cc: CPU-specific wrapper classes for GPU types.
+//#
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "gpu_wrapper.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <algorithm>  // for std::min and std::max
+#include <unistd.h>
+#include <omp.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <Common/Exception.h>
+#include <Common/LofarLogger.h>
+
+#include <GPUProc/global_defines.h>
+#include <GPUProc/PerformanceCounter.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    namespace gpu
+    {
+      namespace {
+        // All memory is aligned to (at least) a cache line, so kernels can
+        // vectorise without peeling.
+        const size_t memoryAlignment = 64;
+
+        void *allocate(size_t size)
+        {
+          void *ptr;
+
+          // Like cuMemAlloc, allow allocation of zero bytes
+          if (posix_memalign(&ptr, memoryAlignment, std::max((size_t)1, size)) != 0)
+            THROW(CPUException, "Could not allocate " << size << " bytes");
+
+          return ptr;
+        }
+      }
+
+      Grid::Grid(unsigned int x_, unsigned int y_, unsigned int z_) :
+        x(x_), y(y_), z(z_)
+      {
+      }
+
+      std::ostream& operator<<(std::ostream& os, const Grid& grid)
+      {
+        os << "[" << grid.x << ", " << grid.y << ", " << grid.z << "]";
+        return os;
+      }
+
+      Block::Block(unsigned int x_, unsigned int y_, unsigned int z_) :
+        x(x_), y(y_), z(z_)
+      {
+      }
+
+      std::ostream& operator<<(std::ostream& os, const Block& block)
+      {
+        os << "[" << block.x << ", " << block.y << ", " << block.z << "]";
+        return os;
+      }
+
+      ExecConfig::ExecConfig(Grid gr, Block bl, size_t dynShMem) :
+        grid(gr), block(bl), dynSharedMemSize(dynShMem)
+      {
+      }
+
+      std::ostream& operator<<(std::ostream& os, const ExecConfig& execConfig)
+      {
+        os << "{" << execConfig.grid << ", " << execConfig.block <<
+              ", " << execConfig.dynSharedMemSize << "}";
+        return os;
+      }
+
+
+      Platform::Platform(unsigned int /*flags*/)
+      {
+      }
+
+      int Platform::version() const
+      {
+        return 1000;
+      }
+
+      size_t Platform::size() const
+      {
+        return 1;
+      }
+
+      std::vector<Device> Platform::devices() const
+      {
+        return std::vector<Device>(1, Device(0));
+      }
+
+      std::string Platform::getName() const
+      {
+        return "CPU";
+      }
+
+      unsigned Platform::getMaxThreadsPerBlock() const
+      {
+        return Device(0).getMaxThreadsPerBlock();
+      }
+
+
+      Device::Device(int ordinal) :
+        _ordinal(ordinal)
+      {
+        if (ordinal != 0)
+          THROW(CPUException, "Invalid device ordinal " << ordinal <<
+                ": the CPU platform has only one device");
+      }
+
+      bool Device::operator<(const Device &other) const
+      {
+        return _ordinal < other._ordinal;
+      }
+
+      std::string Device::getName() const
+      {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+
+        while (std::getline(cpuinfo, line)) {
+          if (line.compare(0, 10, "model name") == 0) {
+            std::string::size_type colon = line.find(':');
+            if (colon != std::string::npos && colon + 2 <= line.size())
+              return line.substr(colon + 2);
+          }
+        }
+
+        return "CPU";
+      }
+
+      unsigned Device::getComputeCapabilityMajor() const
+      {
+        return 0;
+      }
+
+      unsigned Device::getComputeCapabilityMinor() const
+      {
+        return 0;
+      }
+
+      size_t Device::getTotalGlobalMem() const
+      {
+        return (size_t)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+      }
+
+      size_t Device::getBlockSharedMem() const
+      {
+        long l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+
+        return l1 > 0 ? (size_t)l1 : 32 * 1024;
+      }
+
+      size_t Device::getTotalConstMem() const
+      {
+        return getTotalGlobalMem();
+      }
+
+      std::string Device::pciId() const
+      {
+        return "0000:00";
+      }
+
+      unsigned Device::getMaxThreadsPerBlock() const
+      {
+        return omp_get_max_threads();
+      }
+
+      Block Device::getMaxBlockDims() const
+      {
+        return Block(getMaxThreadsPerBlock(), 1, 1);
+      }
+
+      Grid Device::getMaxGridDims() const
+      {
+        return Grid(~0U, ~0U, ~0U);
+      }
+
+      unsigned Device::getMultiProcessorCount() const
+      {
+        return std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+      }
+
+      unsigned Device::getMaxThreadsPerMultiProcessor() const
+      {
+        return 1;
+      }
+
+
+      class Context::Impl : boost::noncopyable
+      {
+      public:
+        Impl(const Device &device):
+          _device(device)
+        {
+        }
+
+        Device getDevice() const
+        {
+          return _device;
+        }
+
+      private:
+        const Device _device;
+      };
+
+      Context::Context(const Device &device, unsigned int /*flags*/) :
+        _impl(new Impl(device))
+      {
+      }
+
+      Device Context::getDevice() const
+      {
+        return _impl->getDevice();
+      }
+
+
+      ScopedCurrentContext::ScopedCurrentContext(const Context &context) :
+        _context(context)
+      {
+      }
+
+      ScopedCurrentContext::~ScopedCurrentContext()
+      {
+      }
+
+
+      class HostMemory::Impl : boost::noncopyable
+      {
+      public:
+        Impl(size_t size):
+          _ptr(allocate(size)),
+          _size(size)
+        {
+        }
+
+        ~Impl()
+        {
+          free(_ptr);
+        }
+
+        void *get() const
+        {
+          return _ptr;
+        }
+
+        size_t size() const
+        {
+          return _size;
+        }
+
+      private:
+        void *_ptr;
+        size_t _size;
+      };
+
+      HostMemory::HostMemory(const Context &/*context*/, size_t size,
+                             unsigned int /*flags*/) :
+        _impl(new Impl(size))
+      {
+      }
+
+      size_t HostMemory::size() const
+      {
+        return _impl->size();
+      }
+
+      void* HostMemory::getPtr() const
+      {
+        return _impl->get();
+      }
+
+
+      class DeviceMemory::Impl : boost::noncopyable
+      {
+      public:
+        Impl(const Context &context, size_t size):
+          _context(context),
+          _ptr(allocate(size)),
+          _size(size)
+        {
+        }
+
+        ~Impl()
+        {
+          free(_ptr);
+        }
+
+        void *get() const
+        {
+          return _ptr;
+        }
+
+        void set(unsigned char uc, size_t n) const
+        {
+          memset(_ptr, uc, n);
+        }
+
+        size_t size() const
+        {
+          return _size;
+        }
+
+        Context getContext() const
+        {
+          return _context;
+        }
+
+      private:
+        const Context _context;
+        void *_ptr;
+        size_t _size;
+      };
+
+      DeviceMemory::DeviceMemory(const Context &context, size_t size) :
+        _impl(new Impl(context, size))
+      {
+      }
+
+      void *DeviceMemory::get() const
+      {
+        return _impl->get();
+      }
+
+      void DeviceMemory::set(unsigned char uc, size_t n) const
+      {
+        _impl->set(uc, std::min(n, size()));
+      }
+
+      size_t DeviceMemory::size() const
+      {
+        return _impl->size();
+      }
+
+      HostMemory DeviceMemory::fetch() const
+      {
+        HostMemory host(_impl->getContext(), size());
+
+        memcpy(host.get<void>(), get(), size());
+
+        return host;
+      }
+
+
+      class Event::Impl : boost::noncopyable
+      {
+      public:
+        Impl():
+          _recorded(false)
+        {
+        }
+
+        void record()
+        {
+          clock_gettime(CLOCK_MONOTONIC, &_time);
+          _recorded = true;
+        }
+
+        float elapsedTime(const Impl &other) const
+        {
+          if (!_recorded || !other._recorded)
+            THROW(CPUException, "elapsedTime(): event not recorded");
+
+          return (_time.tv_sec  - other._time.tv_sec)  * 1e3 +
+                 (_time.tv_nsec - other._time.tv_nsec) * 1e-6;
+        }
+
+      private:
+        struct timespec _time;
+        bool _recorded;
+      };
+
+      Event::Event(const Context &/*context*/, unsigned int /*flags*/):
+        _impl(new Impl)
+      {
+      }
+
+      float Event::elapsedTime(Event &second) const
+      {
+        return _impl->elapsedTime(*second._impl);
+      }
+
+      void Event::wait()
+      {
+      }
+
+
+      class Stream::Impl : boost::noncopyable
+      {
+      public:
+        Impl(const Context &context):
+          _context(context)
+        {
+        }
+
+        Context getContext() const
+        {
+          return _context;
+        }
+
+      private:
+        const Context _context;
+      };
+
+      Stream::Stream(const Context &context, unsigned int /*flags*/):
+        _impl(new Impl(context))
+      {
+      }
+
+      void Stream::writeBuffer(const DeviceMemory &devMem,
+                               const HostMemory &hostMem,
+                               bool /*synchronous*/) const
+      {
+        if (hostMem.size() > devMem.size())
+        {
+          THROW(CPUException, "writeBuffer(): host buffer too large for device buffer: host buffer is " << hostMem.size() << " bytes, device buffer is " << devMem.size() << " bytes");
+        }
+
+        memcpy(devMem.get(), hostMem.get<void>(), hostMem.size());
+      }
+
+      void Stream::writeBuffer(const DeviceMemory &devMem, const HostMemory &hostMem,
+                         PerformanceCounter &counter, bool synchronous) const
+      {
+        counter.recordStart(*this);
+        writeBuffer(devMem, hostMem, synchronous);
+        counter.recordStop(*this);
+      }
+
+      void Stream::copyBuffer(const DeviceMemory &devTarget,
+                              const DeviceMemory &devSource,
+                              bool /*synchronous*/) const
+      {
+        if (devSource.size() > devTarget.size())
+        {
+          THROW(CPUException, "copyBuffer(): device source buffer too large for device target buffer: " <<
+                "source buffer is " << devSource.size() << " bytes, " <<
+                "device buffer is " << devTarget.size() << " bytes");
+        }
+
+        memmove(devTarget.get(), devSource.get(), devSource.size());
+      }
+
+      void Stream::copyBuffer(const DeviceMemory &devTarget,
+                              const DeviceMemory &devSource,
+                              PerformanceCounter &counter,
+                              bool synchronous) const
+      {
+        counter.recordStart(*this);
+        copyBuffer(devTarget, devSource, synchronous);
+        counter.recordStop(*this);
+      }
+
+      void Stream::readBuffer(const HostMemory &hostMem,
+                              const DeviceMemory &devMem,
+                              bool /*synchronous*/) const
+      {
+        // Host buffer can be smaller, because the device
+        // buffers can be used for multiple purposes in
+        // the pipeline, and thus can be larger than
+        // needed here.
+        size_t size = std::min(devMem.size(), hostMem.size());
+
+        memcpy(hostMem.get<void>(), devMem.get(), size);
+      }
+
+      void Stream::readBuffer(const HostMemory &hostMem, const DeviceMemory &devMem,
+                        PerformanceCounter &counter, bool synchronous) const
+      {
+        counter.recordStart(*this);
+        readBuffer(hostMem, devMem, synchronous);
+        counter.recordStop(*this);
+      }
+
+      bool Stream::query() const
+      {
+        return true;
+      }
+
+      void Stream::synchronize() const
+      {
+      }
+
+      void Stream::waitEvent(const Event &/*event*/) const
+      {
+      }
+
+      void Stream::recordEvent(const Event &event) const
+      {
+        event._impl->record();
+      }
+
+      Context Stream::getContext() const
+      {
+        return _impl->getContext();
+      }
+
+      bool Stream::isSynchronous() const
+      {
+        return true;
+      }
+
+    } // namespace gpu
+
+  } // namespace Cobalt
+
+} // namespace LOFAR
+
@@ -0,0 +1,409 @@
+//# gpu_wrapper.h: CPU-specific wrapper classes for GPU types.
+//#
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_GPUPROC_CPU_GPU_WRAPPER_H
+#define LOFAR_GPUPROC_CPU_GPU_WRAPPER_H
+
+// \file cpu/gpu_wrapper.h
+// C++ wrappers that mimic the CUDA wrappers, but execute everything on the
+// host. "Device" memory is ordinary (aligned) host memory and a Stream
+// executes all operations synchronously, in the calling thread. This allows
+// the complete Cobalt pipeline and its kernel tests to run on machines
+// without a GPU, and serves as a reference implementation for the GPU
+// kernels.
+// Uses the "Pimpl" idiom for resource managing classes, just like the CUDA
+// wrappers. Not Pimpl-ed are class Platform and Device.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+#include <boost/shared_ptr.hpp>
+#include "gpu_incl.h"
+
+#include <GPUProc/gpu_wrapper.h> // GPUException
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    class PerformanceCounter;
+
+    namespace gpu
+    {
+
+      // Exception class for errors in the CPU back-end.
+      EXCEPTION_CLASS(CPUException, GPUException);
+
+      // Struct representing a CUDA Grid, which is similar to the @c dim3 type
+      // in the CUDA Runtime API. Only used for logging on the CPU.
+      struct Grid
+      {
+        Grid(unsigned int x_ = 1, unsigned int y_ = 1, unsigned int z_ = 1);
+        unsigned int x;
+        unsigned int y;
+        unsigned int z;
+        friend std::ostream& operator<<(std::ostream& os, const Grid& grid);
+      };
+
+      // Struct representing a CUDA Block, which is similar to the @c dim3 type
+      // in the CUDA Runtime API. Only used for logging on the CPU.
+      struct Block
+      {
+        Block(unsigned int x_ = 1, unsigned int y_ = 1, unsigned int z_ = 1);
+        unsigned int x;
+        unsigned int y;
+        unsigned int z;
+        friend std::ostream& operator<<(std::ostream& os, const Block& block);
+      };
+
+      // Struct containing kernel launch configuration.
+      struct ExecConfig
+      {
+        ExecConfig(Grid gr = Grid(), Block bl = Block(), size_t dynShMem = 0);
+        Grid   grid;
+        Block  block;
+        size_t dynSharedMemSize;
+        friend std::ostream& operator<<(std::ostream& os,
+                                        const ExecConfig& execConfig);
+      };
+
+
+      // Forward declaration needed by Platform::devices.
+      class Device;
+
+      // This class is not strictly needed, because in the CPU back-end there
+      // is only one "platform": the host. It is provided to mirror the CUDA
+      // and OpenCL interfaces.
+      class Platform
+      {
+      public:
+        // Initialize the CPU platform.
+        // \param flags must be 0 (at least up till CUDA 5.0).
+        Platform(unsigned int flags = 0);
+
+        // The version of the CPU back-end, encoded like the CUDA driver
+        // version (1000 * major + 10 * minor).
+        int version() const;
+
+        // Returns the number of devices in the CPU platform, which is 1.
+        size_t size() const;
+
+        // Returns a vector of all devices in the CPU platform.
+        std::vector<Device> devices() const;
+
+        // Returns the name of the CPU platform.
+        std::string getName() const;
+
+        // Return the maximum number of threads per block, which is the
+        // number of OpenMP threads available.
+        unsigned getMaxThreadsPerBlock() const;
+      };
+
+      // Wrap the host CPU(s) as a device. All ordinals refer to the same
+      // host.
+      class Device
+      {
+      public:
+        // Create a device.
+        // \param ordinal is the device number;
+        //        valid range: [0, Platform.size()-1]
+        Device(int ordinal = 0);
+
+        // Order Devices by their ordinal.
+        bool operator<(const Device &other) const;
+
+        // Return the name of the device, as reported in /proc/cpuinfo.
+        std::string getName() const;
+
+        // Return the "compute capability". Always 0.0 on the CPU.
+        unsigned getComputeCapabilityMajor() const;
+        unsigned getComputeCapabilityMinor() const;
+
+        // Return the total amount of physical memory in bytes
+        size_t getTotalGlobalMem() const;
+
+        // Return the maximum amount of "shared memory" per block, which we
+        // define as the L1 data cache size.
+        size_t getBlockSharedMem() const;
+
+        // Return the total amount of "constant memory", which is the same as
+        // the total amount of global memory on the CPU.
+        size_t getTotalConstMem() const;
+
+        // Return the PCI ID (bus:device) of this GPU. Always "0000:00" on
+        // the CPU.
+        std::string pciId() const;
+
+        // Return the maximum number of threads per block
+        unsigned getMaxThreadsPerBlock() const;
+
+        // Return the maximum dimensions of a block of threads.
+        struct Block getMaxBlockDims() const;
+
+        // Return the maximum dimensions of a grid of blocks.
+        struct Grid getMaxGridDims() const;
+
+        // Return the number of multi-processors, i.e. the number of online
+        // CPU cores.
+        unsigned getMultiProcessorCount() const;
+
+        // Return the maximum number of threads that can be
+        // resident on a multi-processor.
+        unsigned getMaxThreadsPerMultiProcessor() const;
+
+      private:
+        // Context needs access to our \c _ordinal to create a context.
+        friend class Context;
+
+        // The device ordinal.
+        int _ordinal;
+      };
+
+
+      // Wrap a CPU "context". Refers to a Device; it holds no resources.
+      class Context
+      {
+      public:
+        // Create a new context that is associated with the given \a device.
+        // \param flags are ignored on the CPU.
+        Context(const Device &device, unsigned int flags = 0);
+
+        // Returns the device associated to this context.
+        Device getDevice() const;
+
+      private:
+        // Non-copyable implementation class.
+        class Impl;
+
+        // Reference counted pointer to the implementation class.
+        boost::shared_ptr<Impl> _impl;
+      };
+
+
+      // Make a certain context the current context for the lifetime of the
+      // ScopedCurrentContext object. A no-op on the CPU, provided to mirror
+      // the CUDA interface.
+      class ScopedCurrentContext
+      {
+      public:
+        ScopedCurrentContext( const Context &context );
+        ~ScopedCurrentContext();
+
+      private:
+        const Context &_context;
+      };
+
+
+      // Wrap host memory. Memory is aligned to a cache line.
+      class HostMemory
+      {
+      public:
+        // Allocate \a size bytes of host memory.
+        // \param context CPU context.
+        // \param size number of bytes to allocate
+        // \param flags are ignored on the CPU.
+        HostMemory(const Context &context, size_t size, unsigned int flags = 0);
+
+        // Return a pointer to the actual memory.
+        // \warning The returned pointer shall not have a lifetime beyond the
+        // lifetime of this object (actually the last copy).
+        template <typename T>
+        T *get() const;
+
+        // Return the size of this memory block.
+        size_t size() const;
+
+      private:
+        // Get a void pointer to the actual memory from our Impl class. This
+        // method is only used by our templated get() method.
+        void* getPtr() const;
+
+        // Non-copyable implementation class.
+        class Impl;
+
+        // Reference counted pointer to the implementation class.
+        boost::shared_ptr<Impl> _impl;
+      };
+
+
+      // Wrap "device" memory. On the CPU this is host memory as well, but it
+      // is only accessed by kernels and by the Stream's buffer transfers,
+      // exactly like real device memory.
+      class DeviceMemory
+      {
+      public:
+        // Allocate \a size bytes of device memory.
+        DeviceMemory(const Context &context, size_t size);
+
+        // Return a pointer to the actual memory, which can be dereferenced on
+        // the CPU (unlike the CUDA version).
+        void *get() const;
+
+        // Fill the first \a n bytes of memory with the constant byte \a uc.
+        // \param uc Constant byte value to put into memory
+        // \param n  Number of bytes to set. Defaults to the complete block.
+        //           If \a n is larger than the current memory block size, then
+        //           the complete block will be set to \a uc.
+        void set(unsigned char uc, size_t n = (size_t)-1) const;
+
+        // Return the size of this memory block.
+        size_t size() const;
+
+        // Fetch the contents of this buffer in a new HostMemory buffer.
+        HostMemory fetch() const;
+
+      private:
+        // Non-copyable implementation class.
+        class Impl;
+
+        // Reference counted pointer to the implementation class.
+        boost::shared_ptr<Impl> _impl;
+      };
+
+
+      // Wrap an event. On the CPU, an event records the wall-clock time at
+      // which it was recorded into a Stream. Because Streams are synchronous,
+      // this is also the time at which all preceding work finished.
+      class Event
+      {
+      public:
+        // Construct an event.
+        // \param flags are ignored on the CPU.
+        Event(const Context &context, unsigned int flags = 0);
+
+        // Return the elapsed time in milliseconds between this event and the
+        // \a second event.
+        float elapsedTime(Event &second) const;
+
+        // Wait until all work preceding this event in the same stream has
+        // completed. A no-op on the CPU.
+        void wait();
+
+      private:
+        // Stream needs access to our implementation to record an event.
+        friend class Stream;
+
+        // Non-copyable implementation class.
+        class Impl;
+
+        // Reference counted pointer to the implementation class.
+        boost::shared_ptr<Impl> _impl;
+      };
+
+
+      // Wrap a stream. All operations are executed synchronously in the
+      // thread that enqueues them; kernels parallelise internally using
+      // OpenMP. Hence, a Stream is always in the "completed" state when
+      // control returns to the caller.
+      class Stream
+      {
+      public:
+        // Create a stream.
+        // \param flags are ignored on the CPU.
+        explicit Stream(const Context &context, unsigned int flags = 0);
+
+        // Transfer data from host memory \a hostMem to device memory \a devMem.
+        // \param devMem Device memory that will be copied to.
+        // \param hostMem Host memory that will be copied from.
+        // \param synchronous Ignored: the transfer is always synchronous.
+        void writeBuffer(const DeviceMemory &devMem, const HostMemory &hostMem,
+                         bool synchronous = false) const;
+
+        // Transfer data from host memory \a hostMem to device memory \a devMem.
+        // When gpuProfiling is enabled this transfer is synchronous
+        // \param devMem Device memory that will be copied to.
+        // \param hostMem Host memory that will be copied from.
+        // \param counter PerformanceCounter that will receive transfer duration
+        // if  gpuProfiling is enabled
+        // \param synchronous Ignored: the transfer is always synchronous.
+        void writeBuffer(const DeviceMemory &devMem, const HostMemory &hostMem,
+                         PerformanceCounter &counter, bool synchronous = false) const;
+
+        // Transfer data from device memory \a devMem to host memory \a hostMem.
+        // \param hostMem Host memory that will be copied to.
+        // \param devMem Device memory that will be copied from.
+        // \param synchronous Ignored: the transfer is always synchronous.
+        void readBuffer(const HostMemory &hostMem, const DeviceMemory &devMem,
+                        bool synchronous = false) const;
+
+        // Transfer data from device memory \a devMem to host memory \a hostMem.
+        // \param hostMem Host memory that will be copied to.
+        // \param devMem Device memory that will be copied from.
+        // \param counter PerformanceCounter that will receive transfer duration
+        // if  gpuProfiling is enabled
+        // \param synchronous Ignored: the transfer is always synchronous.
+        void readBuffer(const HostMemory &hostMem, const DeviceMemory &devMem,
+                        PerformanceCounter &counter, bool synchronous = false) const;
+
+        // Transfer data from device memory \a devSource to device memory \a devTarget.
+        void copyBuffer(const DeviceMemory &devTarget, const DeviceMemory &devSource,
+                        bool synchronous = false) const;
+
+        // Transfer data from device memory \a devSource to device memory \a devTarget.
+        void copyBuffer(const DeviceMemory &devTarget, const DeviceMemory &devSource,
+                        PerformanceCounter &counter, bool synchronous = false) const;
+
+        // Check if all operations on this stream have completed. Always true
+        // on the CPU.
+        bool query() const;
+
+        // Wait until all operations on this stream have completed. A no-op on
+        // the CPU.
+        void synchronize() const;
+
+        // Let this stream wait on the event \a event. A no-op on the CPU.
+        void waitEvent(const Event &event) const;
+
+        // Record the event \a event for this stream.
+        void recordEvent(const Event &event) const;
+
+        // Return the context associated with this stream.
+        Context getContext() const;
+
+        // Returns whether this stream is synchronous. Always true on the CPU.
+        bool isSynchronous() const;
+
+      private:
+        // Non-copyable implementation class.
+        class Impl;
+
+        // Reference counted pointer to the implementation class.
+        boost::shared_ptr<Impl> _impl;
+      };
+
+      // Template implementation
+
+      template <typename T>
+      T * HostMemory::get() const
+      {
+        return static_cast<T *>(getPtr());
+      }
+
+    } // namespace gpu
+
+  } // namespace Cobalt
+
+} // namespace LOFAR
+
+#endif
+
@@ -33,8 +33,10 @@
 # include "cuda/gpu_incl.h"
 #elif defined (USE_OPENCL)
 # include "opencl/gpu_incl.h"
+#elif defined (USE_CPU)
+# include "cpu/gpu_incl.h"
 #else
-# error "Either CUDA or OpenCL must be enabled, not neither"
+# error "Either CUDA, OpenCL or CPU must be enabled, not neither"
 #endif
 
 #endif
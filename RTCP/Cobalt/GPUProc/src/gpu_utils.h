@@ -57,6 +57,8 @@ namespace LOFAR
     // Vector for storing all the GPU devices present in the system.
     typedef std::vector<gpu::Device> GPUDevices;
 
+    // The CPU back-end has no run-time kernel compilation.
+#if !defined (USE_CPU)
     // Compile \a srcFilename and return the PTX code as string.
     // \par srcFilename Name of the file containing the source code to be
     //      compiled to PTX. If \a srcFilename is a relative path and if the
@@ -87,6 +89,8 @@ namespace LOFAR
                              const std::string &srcFilename, 
                              const std::string &ptx);
 
+#endif
+
     // Dump the contents of a device memory buffer as raw binary data to file.
     // \par deviceMemory Device memory buffer to be dumped.
     // \par dumpFile Name of the dump file.
@@ -51,8 +51,10 @@ namespace LOFAR
 # include "cuda/gpu_wrapper.h"
 #elif defined (USE_OPENCL)
 # include "opencl/gpu_wrapper.h"
+#elif defined (USE_CPU)
+# include "cpu/gpu_wrapper.h"
 #else
-# error "Either CUDA or OpenCL must be enabled, not neither"
+# error "Either CUDA, OpenCL or CPU must be enabled, not neither"
 #endif
 
 #endif
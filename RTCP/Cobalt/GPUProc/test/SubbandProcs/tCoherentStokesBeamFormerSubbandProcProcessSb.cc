@@ -64,7 +64,7 @@ int main(/*int argc, char *argv[]*/) {
   try {
     gpu::Platform pf;
     cout << "Detected " << pf.size() << " CUDA devices" << endl;
-  } catch (gpu::CUDAException& e) {
+  } catch (gpu::GPUException& e) {
     cerr << e.what() << endl;
     return 3;
   }
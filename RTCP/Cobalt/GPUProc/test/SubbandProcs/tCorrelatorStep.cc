@@ -22,7 +22,7 @@
 
 #include <CoInterface/BudgetTimer.h>
 #include <GPUProc/cuda/SubbandProcs/CorrelatorStep.h>
-#include <GPUProc/cuda/gpu_wrapper.h>
+#include <GPUProc/gpu_wrapper.h>
 
 #include <UnitTest++.h>
 #include <iostream>
@@ -151,7 +151,7 @@ int main()
     Platform pf;
     LOG_INFO_STR("Detected " << pf.size() << " CUDA devices");
   } 
-  catch (CUDAException& e) 
+  catch (GPUException& e) 
   {
     LOG_ERROR_STR("Caught exception: " << e.what());
     return 3;
@@ -376,7 +376,7 @@ int main()
   try {
     gpu::Platform pf;
     LOG_INFO_STR("Detected " << pf.size() << " CUDA devices");
-  } catch (gpu::CUDAException& e) {
+  } catch (gpu::GPUException& e) {
     LOG_FATAL_STR("Caught exception: " << e.what());
     return 3;
   }
@@ -39,7 +39,7 @@ int main() {
   try {
     gpu::Platform pf;
     cout << "Detected " << pf.size() << " CUDA devices" << endl;
-  } catch (gpu::CUDAException& e) {
+  } catch (gpu::GPUException& e) {
     cerr << e.what() << endl;
     return 3;
   }
@@ -0,0 +1,151 @@
+//# tCorrelatorReference.cc: compare the CPU CorrelatorKernel with a reference
+//#
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <GPUProc/Kernels/CorrelatorKernel.h>
+#include <GPUProc/gpu_wrapper.h>
+#include <GPUProc/MultiDimArrayHostBuffer.h>
+#include <CoInterface/Parset.h>
+#include <CoInterface/Config.h>
+#include <CoInterface/BlockID.h>
+#include <Common/LofarLogger.h>
+#include <Common/lofar_complex.h>
+
+#include <UnitTest++.h>
+#include <boost/format.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <cstdlib>
+
+using namespace LOFAR;
+using namespace LOFAR::Cobalt;
+using boost::format;
+
+// Correlate random data with the CPU kernel, and compare every visibility
+// with a straightforward double-precision computation. Uses an odd number of
+// stations and several integrations per block to cover the baseline and
+// integration indexing.
+void testCorrelator(unsigned nrStations, unsigned nrChannels,
+                    unsigned nrIntegrationsPerBlock, unsigned nrSamplesPerIntegration)
+{
+  Parset ps;
+  ps.add("Observation.VirtualInstrument.stationList",   str(format("[%d*CS001]") % nrStations));
+  ps.add("Observation.antennaSet",                      "LBA_INNER");
+  ps.add("Observation.Dataslots.CS001LBA.RSPBoardList", "[0]");
+  ps.add("Observation.Dataslots.CS001LBA.DataslotList", "[0]");
+  ps.add("Observation.nrBeams",                         "1");
+  ps.add("Observation.Beam[0].subbandList",             "[128]");
+  ps.add("Observation.DataProducts.Output_Correlated.enabled", "T");
+  ps.add("Observation.DataProducts.Output_Correlated.filenames", "[SB000.MS]");
+  ps.add("Observation.DataProducts.Output_Correlated.locations", "[localhost:.]");
+  ps.add("Cobalt.Correlator.nrChannelsPerSubband",      str(format("%u") % nrChannels));
+  ps.add("Cobalt.Correlator.nrIntegrationsPerBlock",    str(format("%u") % nrIntegrationsPerBlock));
+  ps.add("Cobalt.blockSize",                            str(format("%u") % (nrChannels * nrIntegrationsPerBlock * nrSamplesPerIntegration)));
+  ps.updateSettings();
+
+  KernelFactory<CorrelatorKernel> factory(ps);
+
+  gpu::Platform platform;
+  gpu::Context context(platform.devices()[0]);
+  gpu::Stream stream(context);
+
+  gpu::DeviceMemory devInput(context, factory.bufferSize(CorrelatorKernel::INPUT_DATA));
+  gpu::DeviceMemory devOutput(context, factory.bufferSize(CorrelatorKernel::OUTPUT_DATA));
+
+  boost::scoped_ptr<CorrelatorKernel> kernel(factory.create(stream, devInput, devOutput));
+
+  const unsigned nrBaselines = nrStations * (nrStations + 1) / 2;
+  const unsigned nrSamples = nrIntegrationsPerBlock * nrSamplesPerIntegration;
+
+  MultiDimArrayHostBuffer<fcomplex, 4> hostInput(boost::extents[nrStations][nrChannels][nrSamples][NR_POLARIZATIONS], context);
+  MultiDimArrayHostBuffer<fcomplex, 5> hostOutput(boost::extents[nrIntegrationsPerBlock][nrBaselines][nrChannels][NR_POLARIZATIONS][NR_POLARIZATIONS], context);
+
+  srand(1);
+  for (size_t i = 0; i < hostInput.num_elements(); i++)
+    hostInput.data()[i] = fcomplex(rand() % 201 - 100, rand() % 201 - 100);
+
+  // Channel 0 is not correlated (unless it is the only channel), so mark it
+  // to check that it is left untouched.
+  const fcomplex marker(12345, -12345);
+  for (size_t i = 0; i < hostOutput.num_elements(); i++)
+    hostOutput.data()[i] = marker;
+
+  stream.writeBuffer(devInput, hostInput);
+  stream.writeBuffer(devOutput, hostOutput);
+  kernel->enqueue(BlockID());
+  stream.readBuffer(hostOutput, devOutput, true);
+
+  for (unsigned integration = 0; integration < nrIntegrationsPerBlock; integration++) {
+    for (unsigned st1 = 0; st1 < nrStations; st1++) {
+      for (unsigned st2 = 0; st2 <= st1; st2++) {
+        const unsigned bl = st1 * (st1 + 1) / 2 + st2;
+
+        for (unsigned ch = 0; ch < nrChannels; ch++) {
+          for (unsigned pol1 = 0; pol1 < NR_POLARIZATIONS; pol1++) {
+            for (unsigned pol2 = 0; pol2 < NR_POLARIZATIONS; pol2++) {
+              // NOTE: XY and YX polarizations are swapped (see issue #5640)
+              const fcomplex actual = hostOutput[integration][bl][ch][pol2][pol1];
+
+              if (ch == 0 && nrChannels > 1) {
+                CHECK_EQUAL(marker, actual);
+                continue;
+              }
+
+              dcomplex expected(0.0, 0.0);
+              for (unsigned t = 0; t < nrSamplesPerIntegration; t++) {
+                const unsigned time = integration * nrSamplesPerIntegration + t;
+                expected += dcomplex(hostInput[st1][ch][time][pol1]) *
+                            conj(dcomplex(hostInput[st2][ch][time][pol2]));
+              }
+
+              // The input is integer valued, so the single-precision sums are
+              // exact as long as they stay below 2^24.
+              CHECK_CLOSE(real(expected), real(actual), 1e-3);
+              CHECK_CLOSE(imag(expected), imag(actual), 1e-3);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(OneChannel)
+{
+  testCorrelator(3, 1, 1, 64);
+}
+
+TEST(ManyChannels)
+{
+  testCorrelator(7, 16, 1, 48);
+}
+
+TEST(IntegrationsPerBlock)
+{
+  testCorrelator(5, 8, 3, 32);
+}
+
+int main()
+{
+  INIT_LOGGER("tCorrelatorReference");
+
+  return UnitTest::RunAllTests() > 0;
+}
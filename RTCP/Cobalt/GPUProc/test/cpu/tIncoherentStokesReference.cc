@@ -0,0 +1,136 @@
+//# tIncoherentStokesReference.cc: compare the CPU IncoherentStokesKernel with a reference
+//#
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <GPUProc/Kernels/IncoherentStokesKernel.h>
+#include <GPUProc/gpu_wrapper.h>
+#include <GPUProc/MultiDimArrayHostBuffer.h>
+#include <CoInterface/Parset.h>
+#include <CoInterface/Config.h>
+#include <CoInterface/BlockID.h>
+#include <Common/LofarLogger.h>
+#include <Common/lofar_complex.h>
+
+#include <UnitTest++.h>
+#include <boost/format.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <cstdlib>
+
+using namespace LOFAR;
+using namespace LOFAR::Cobalt;
+using boost::format;
+
+// Compute the incoherent Stokes parameters of random data with the CPU
+// kernel, and compare them with the textbook definitions, evaluated in
+// double precision: I = |X|^2 + |Y|^2, Q = |X|^2 - |Y|^2, U = 2 Re(X Y*),
+// V = 2 Im(X Y*), summed over stations and integrated samples.
+void testIncoherentStokes(const std::string &which, unsigned nrStations,
+                          unsigned nrChannels, unsigned nrOutputSamples,
+                          unsigned timeIntegrationFactor)
+{
+  const unsigned nrInputSamples = nrOutputSamples * timeIntegrationFactor;
+
+  Parset ps;
+  ps.add("Observation.DataProducts.Output_IncoherentStokes.enabled", "true");
+  ps.add("Cobalt.BeamFormer.IncoherentStokes.timeIntegrationFactor", str(format("%u") % timeIntegrationFactor));
+  ps.add("Cobalt.BeamFormer.IncoherentStokes.nrChannelsPerSubband", str(format("%u") % nrChannels));
+  ps.add("Cobalt.BeamFormer.IncoherentStokes.which",                which);
+  ps.add("Observation.VirtualInstrument.stationList",               str(format("[%d*RS000]") % nrStations));
+  ps.add("Observation.antennaSet",                                  "LBA_INNER");
+  ps.add("Observation.rspBoardList",                                "[0]");
+  ps.add("Observation.rspSlotList",                                 "[0]");
+  ps.add("Cobalt.blockSize",                                        str(format("%u") % (nrChannels * nrInputSamples)));
+  ps.add("Observation.nrBeams",                                     "1");
+  ps.add("Observation.Beam[0].subbandList",                         "[0]");
+  ps.add("Cobalt.BeamFormer.nrDelayCompensationChannels",           "64");
+  ps.updateSettings();
+
+  KernelFactory<IncoherentStokesKernel> factory(ps);
+  const unsigned nrStokes = ps.settings.beamFormer.incoherentSettings.nrStokes;
+
+  gpu::Platform platform;
+  gpu::Context context(platform.devices()[0]);
+  gpu::Stream stream(context);
+
+  gpu::DeviceMemory devInput(context, factory.bufferSize(IncoherentStokesKernel::INPUT_DATA));
+  gpu::DeviceMemory devOutput(context, factory.bufferSize(IncoherentStokesKernel::OUTPUT_DATA));
+
+  boost::scoped_ptr<IncoherentStokesKernel> kernel(factory.create(stream, devInput, devOutput));
+
+  MultiDimArrayHostBuffer<fcomplex, 4> hostInput(boost::extents[nrStations][NR_POLARIZATIONS][nrInputSamples][nrChannels], context);
+  MultiDimArrayHostBuffer<float, 3> hostOutput(boost::extents[nrStokes][nrOutputSamples][nrChannels], context);
+
+  srand(1);
+  for (size_t i = 0; i < hostInput.num_elements(); i++)
+    hostInput.data()[i] = fcomplex((rand() % 2001 - 1000) / 100.0f,
+                                   (rand() % 2001 - 1000) / 100.0f);
+
+  stream.writeBuffer(devInput, hostInput);
+  kernel->enqueue(BlockID());
+  stream.readBuffer(hostOutput, devOutput, true);
+
+  for (unsigned out = 0; out < nrOutputSamples; out++) {
+    for (unsigned ch = 0; ch < nrChannels; ch++) {
+      double stokes[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+      for (unsigned st = 0; st < nrStations; st++) {
+        for (unsigned t = 0; t < timeIntegrationFactor; t++) {
+          const unsigned time = out * timeIntegrationFactor + t;
+          const dcomplex X(hostInput[st][0][time][ch]);
+          const dcomplex Y(hostInput[st][1][time][ch]);
+
+          stokes[0] += norm(X) + norm(Y);
+          stokes[1] += norm(X) - norm(Y);
+          stokes[2] += 2.0 * real(X * conj(Y));
+          stokes[3] += 2.0 * imag(X * conj(Y));
+        }
+      }
+
+      for (unsigned s = 0; s < nrStokes; s++) {
+        // relative to the total power, which bounds the rounding errors
+        CHECK_CLOSE(stokes[s], hostOutput[s][out][ch], 1e-5 * stokes[0]);
+      }
+    }
+  }
+}
+
+TEST(StokesI)
+{
+  testIncoherentStokes("I", 5, 16, 8, 4);
+}
+
+TEST(StokesIQUV)
+{
+  testIncoherentStokes("IQUV", 5, 16, 8, 4);
+}
+
+TEST(NoIntegration)
+{
+  testIncoherentStokes("IQUV", 3, 37, 29, 1);
+}
+
+int main()
+{
+  INIT_LOGGER("tIncoherentStokesReference");
+
+  return UnitTest::RunAllTests() > 0;
+}
@@ -0,0 +1,145 @@
+//# tIntToFloatReference.cc: compare the CPU IntToFloatKernel with a reference
+//#
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <GPUProc/Kernels/IntToFloatKernel.h>
+#include <GPUProc/gpu_wrapper.h>
+#include <GPUProc/MultiDimArrayHostBuffer.h>
+#include <CoInterface/Parset.h>
+#include <CoInterface/Config.h>
+#include <CoInterface/BlockID.h>
+#include <Common/LofarLogger.h>
+#include <Common/lofar_complex.h>
+#include <Common/LofarTypes.h>
+
+#include <UnitTest++.h>
+#include <boost/format.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <cstdlib>
+
+using namespace LOFAR;
+using namespace LOFAR::Cobalt;
+using boost::format;
+
+// The conversion as specified in IntToFloat.cu: 4 and 8 bit samples are
+// scaled to the 16 bit range, and their most negative value is clamped.
+float reference(int value, unsigned nrBits)
+{
+  switch (nrBits) {
+  case 4:
+    return 64.0f * (value == -8 ? -7 : value);
+  case 8:
+    return 16.0f * (value == -128 ? -127 : value);
+  default:
+    return value;
+  }
+}
+
+// The real (imag = false) or imaginary part of complex sample number
+// [station][time][pol] in input, which holds samples of nrBits bits.
+int inputSample(const char *input, unsigned nrBits, size_t sample, bool imag)
+{
+  switch (nrBits) {
+  case 4: {
+    // one byte per complex sample; the imaginary part in the top 4 bits
+    const unsigned char byte = input[sample];
+    const int nibble = imag ? byte >> 4 : byte & 0x0F;
+    return nibble >= 8 ? nibble - 16 : nibble;
+  }
+  case 8:
+    return (signed char)input[2 * sample + imag];
+  default:
+    return reinterpret_cast<const int16*>(input)[2 * sample + imag];
+  }
+}
+
+void testIntToFloat(unsigned nrBits, unsigned nrStations, unsigned nrSamples)
+{
+  Parset ps;
+  ps.add("Observation.VirtualInstrument.stationList", str(format("[%d*CS001]") % nrStations));
+  ps.add("Observation.antennaSet",                    "LBA_INNER");
+  ps.add("Observation.rspBoardList",                  "[0]");
+  ps.add("Observation.rspSlotList",                   "[0]");
+  ps.add("Observation.nrBeams",                       "1");
+  ps.add("Observation.Beam[0].subbandList",           "[0]");
+  ps.add("Observation.nrBitsPerSample",               str(format("%u") % nrBits));
+  ps.add("Cobalt.blockSize",                          str(format("%u") % nrSamples));
+  ps.updateSettings();
+
+  KernelFactory<IntToFloatKernel> factory(ps);
+
+  gpu::Platform platform;
+  gpu::Context context(platform.devices()[0]);
+  gpu::Stream stream(context);
+
+  gpu::DeviceMemory devInput(context, factory.bufferSize(IntToFloatKernel::INPUT_DATA));
+  gpu::DeviceMemory devOutput(context, factory.bufferSize(IntToFloatKernel::OUTPUT_DATA));
+
+  boost::scoped_ptr<IntToFloatKernel> kernel(factory.create(stream, devInput, devOutput));
+
+  MultiDimArrayHostBuffer<char, 1> hostInput(boost::extents[factory.bufferSize(IntToFloatKernel::INPUT_DATA)], context);
+  MultiDimArrayHostBuffer<fcomplex, 3> hostOutput(boost::extents[nrStations][NR_POLARIZATIONS][nrSamples], context);
+
+  // Random bytes cover all 4 and 8 bit values, including the clamped ones.
+  srand(1);
+  for (size_t i = 0; i < hostInput.num_elements(); i++)
+    hostInput.data()[i] = rand() & 0xFF;
+
+  stream.writeBuffer(devInput, hostInput);
+  kernel->enqueue(BlockID());
+  stream.readBuffer(hostOutput, devOutput, true);
+
+  for (unsigned st = 0; st < nrStations; st++) {
+    for (unsigned t = 0; t < nrSamples; t++) {
+      for (unsigned pol = 0; pol < NR_POLARIZATIONS; pol++) {
+        const size_t sample = ((size_t)st * nrSamples + t) * NR_POLARIZATIONS + pol;
+
+        CHECK_EQUAL(reference(inputSample(hostInput.data(), nrBits, sample, false), nrBits),
+                    real(hostOutput[st][pol][t]));
+        CHECK_EQUAL(reference(inputSample(hostInput.data(), nrBits, sample, true), nrBits),
+                    imag(hostOutput[st][pol][t]));
+      }
+    }
+  }
+}
+
+TEST(Bits16)
+{
+  testIntToFloat(16, 3, 1024);
+}
+
+TEST(Bits8)
+{
+  testIntToFloat(8, 3, 1024);
+}
+
+TEST(Bits4)
+{
+  testIntToFloat(4, 3, 1024);
+}
+
+int main()
+{
+  INIT_LOGGER("tIntToFloatReference");
+
+  return UnitTest::RunAllTests() > 0;
+}
@@ -26,6 +26,11 @@
 #include <sstream>
 #include <Common/LofarLogger.h>
 
+// The ranges are typically shared between processes, which requires
+// address-free (i.e. lock-free) atomics. Compilation fails here if
+// 64-bit atomics are not lock free.
+typedef char Ranges_requires_lock_free_64bit_atomics[__atomic_always_lock_free(sizeof(LOFAR::uint64), 0) ? 1 : -1];
+
 namespace LOFAR
 {
   namespace Cobalt
@@ -33,11 +38,22 @@ namespace LOFAR
 
     std::ostream& operator<<( std::ostream &str, const Ranges &r )
     {
-      for (struct Ranges::const_iterator i = r.begin(); i != r.end(); ++i) {
-       if (i != r.begin())
-         str << " ";
+      std::vector<Ranges::range_type> ranges;
+
+      if (r.len > 0) {
+        uint64 sequence;
 
-       str << "[" << i.from() << ", " << i.to() << ")";
+        do {
+          sequence = r.beginRead();
+          r.collect(0, ~0ULL, r.len, ranges);
+        } while (!r.endRead(sequence));
+      }
+
+      for (size_t i = 0; i < ranges.size(); ++i) {
+        if (i > 0)
+          str << " ";
+
+        str << "[" << ranges[i].first << ", " << ranges[i].second << ")";
       }
 
       return str;
@@ -46,10 +62,10 @@ namespace LOFAR
     void Ranges::dump() const {
       stringstream s;
       for (struct Range *i = _begin; i != _end; ++i) {
-        if (head == i) {
+        if (head() == i) {
           s << "HEAD -> ";
         }
-        s << "[" << i->from << ", " << i->to << ") ";
+        s << "[" << from(i) << ", " << to(i) << ") ";
       }
 
       LOG_DEBUG_STR(s.str());
@@ -59,10 +75,10 @@ namespace LOFAR
       :
       create(false),
       len(0),
+      header(0),
       ranges(0),
       _begin(0),
       _end(_begin),
-      head(_begin),
       minHistory(0)
     {
     }
@@ -70,11 +86,11 @@ namespace LOFAR
     Ranges::Ranges( void *data, size_t numBytes, value_type minHistory, bool create )
       :
       create(create),
-      len(numBytes / sizeof *ranges),
-      ranges(create ? new(data)Range[len] : static_cast<Range*>(data)),
+      len(numBytes >= sizeof *header ? (numBytes - sizeof *header) / sizeof *ranges : 0),
+      header(create ? new(data)Header : static_cast<Header*>(data)),
+      ranges(create ? new(header + 1)Range[len] : reinterpret_cast<Range*>(header + 1)),
       _begin(&ranges[0]),
       _end(&ranges[len]),
-      head(_begin),
       minHistory(minHistory)
     {
       ASSERT( len > 0 );
@@ -82,90 +98,158 @@ namespace LOFAR
 
     Ranges::~Ranges()
     {
-      if (create)
+      if (create) {
         for (struct Range *i = _begin; i != _end; ++i)
           i->~Range();
+
+        header->~Header();
+      }
+    }
+
+    Ranges::ScopedWrite::ScopedWrite( Header &header )
+      :
+      header(header),
+      sequence(__atomic_load_n(&header.sequence, __ATOMIC_RELAXED))
+    {
+      // Mark the start of the modification, and prevent the
+      // modifications from becoming visible before this mark.
+      __atomic_store_n(&header.sequence, sequence + 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    Ranges::ScopedWrite::~ScopedWrite()
+    {
+      __atomic_store_n(&header.sequence, sequence + 2, __ATOMIC_RELEASE);
+    }
+
+    uint64 Ranges::beginRead() const
+    {
+      uint64 sequence;
+
+      // wait for the writer to finish any modification
+      while ((sequence = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE)) & 1)
+        ;
+
+      return sequence;
+    }
+
+    bool Ranges::endRead( uint64 sequence ) const
+    {
+      // Prevent the reads of the ranges from being moved past
+      // the check of the sequence number.
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+      return __atomic_load_n(&header->sequence, __ATOMIC_RELAXED) == sequence;
+    }
+
+    void Ranges::collect( value_type first, value_type last, size_t max,
+                          std::vector<range_type> &result ) const
+    {
+      result.clear();
+
+      // The data can change under our feet, so never trust `head'
+      // to be in range.
+      const size_t tail = (__atomic_load_n(&header->head, __ATOMIC_RELAXED) + 1) % len;
+
+      // Binary search for the oldest range that ends after `first'. Unused
+      // ranges end at 0, and come before all others.
+      size_t low = 0, high = len;
+
+      while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+
+        if (to(&ranges[(tail + mid) % len]) > first)
+          high = mid;
+        else
+          low = mid + 1;
+      }
+
+      for (size_t n = low; n < len && result.size() < max; ++n) {
+        const Range *r = &ranges[(tail + n) % len];
+        const value_type r_from = from(r);
+        const value_type r_to = to(r);
+
+        if (r_from >= last)
+          break;
+
+        if (r_from < r_to)
+          result.push_back(range_type(r_from, r_to));
+      }
     }
 
     void Ranges::clear()
     {
+      ScopedWrite write(*header);
+
       for (struct Range *i = _begin; i != _end; ++i) {
-        // erase; delete 'to' first!
-        i->to = 0;
-        i->from = 0;
+        set(i, 0, 0);
       }
 
-      head = _begin;
+      setHead(_begin);
     }
 
     void Ranges::excludeBefore( value_type to )
     {
+      ScopedWrite write(*header);
+
       for (struct Range *i = _begin; i != _end; ++i) {
-        if (i->to <= to) {
-          // erase; delete 'to' first!
-          i->to = 0;
-          i->from = 0;
+        if (Ranges::to(i) <= to) {
+          // erase
+          set(i, 0, 0);
           continue;
         }
 
-        if (i->from < to) {
+        if (from(i) < to) {
           // shorten
-          i->from = to;
+          setFrom(i, to);
         }
       }
     }
 
     void Ranges::remove( Range *i )
     {
+      Range * const head = this->head();
+
       if (i != head) {
         // shift entries until `head'
         do {
           Range *prev = i;
           i = next_rr(i);
 
-          // copy 'from' first to invalidate 'prev' entry
-          prev->from = i->from;
-
-          // copy 'to' to complete (and validate) 'prev' entry
-          prev->to = i->to;
+          set(prev, from(i), to(i));
         } while (i != head);
       }
 
       // i == head: clear head and move head back one spot
-      i->to = 0;
-      i->from = 0;
-      head = prev_rr(i);
+      set(i, 0, 0);
+      setHead(prev_rr(i));
     }
 
     bool Ranges::insert_empty( Range *i, value_type to )
     {
-      if (i->to == 0) {
+      if (Ranges::to(i) == 0) {
         // spot already free
         return true;
       }
 
-      Range *tail = next_rr(head);
+      Range * const head = this->head();
+      Range * const tail = next_rr(head);
 
-      if (tail->to != 0 && (to < minHistory || tail->to >= to - minHistory)) {
+      if (Ranges::to(tail) != 0 && (to < minHistory || Ranges::to(tail) >= to - minHistory)) {
         // no room
         return false;
       }
 
       // shift entries from 'head' down to 'i'
       for(Range *b = head, *next = tail; next != i; next = b, b = prev_rr(b)) {
-        // copy 'to' first to invalidate 'b' entry
-        next->to = b->to;
-
-        // copy 'from' to complete (and validate) 'b' entry
-        next->from = b->from;
+        set(next, from(b), Ranges::to(b));
       }
 
       // shift head as well
-      head = tail;
+      setHead(tail);
 
       // clean our spot
-      i->to = 0;
-      i->from = 0;
+      set(i, 0, 0);
       return true;
     }
 
@@ -173,28 +257,30 @@ namespace LOFAR
     {
       ASSERTSTR( from < to, from << " < " << to );
 
-      if (head->to == 0) {
+      ScopedWrite write(*header);
+
+      Range * const head = this->head();
+
+      if (Ranges::to(head) == 0) {
         /*
          * Ranges are empty, fill *head
          */
 
-        // *head is unused, set 'from' first!
-        head->from = from;
-        head->to = to;
+        set(head, from, to);
         return true;
       }
 
-      if (head->to == from) {
+      if (Ranges::to(head) == from) {
         /*
          * In-order arrival, next packet arrived
          */
 
         // *head can be extended
-        head->to = to;
+        setTo(head, to);
         return true;
       }
 
-      if (head->to < from) {
+      if (Ranges::to(head) < from) {
         /*
          * In-order arrival, but packet loss
          */
@@ -202,12 +288,11 @@ namespace LOFAR
         // new range is needed
         struct Range * const next = next_rr(head);
 
-        if (next->to == 0 || (to > minHistory && next->to < to - minHistory)) {
+        if (Ranges::to(next) == 0 || (to > minHistory && Ranges::to(next) < to - minHistory)) {
           // range at 'next' is either unused or old enough to toss away
-          next->from = from;
-          next->to = to;
+          set(next, from, to);
 
-          head = next;
+          setHead(next);
           return true;
         }
 
@@ -215,7 +300,7 @@ namespace LOFAR
         return false;
       }
 
-      ASSERT(head->to > from);
+      ASSERT(Ranges::to(head) > from);
 
       /*
        * Out-of-order arrival
@@ -223,10 +308,13 @@ namespace LOFAR
 
       // scan all ranges to see where we fit in
       for (struct Range *i = _begin; i != _end; ++i) {
-        if (i->to == 0)
+        const value_type i_to = Ranges::to(i);
+        const value_type i_from = Ranges::from(i);
+
+        if (i_to == 0)
           continue;
 
-        if (to > i->from && from < i->to) {
+        if (to > i_from && from < i_to) {
           // If [from,to) falls into an already existing range,
           // we're receiving duplicate data. This occasionally
           // happens if a board resyncs.
@@ -238,10 +326,6 @@ namespace LOFAR
           //   2. i->from < from < to < i->to (overlap is to - from)
           //   3. i->from < from < i->to < to (overlap is i->to - from)
 
-          // Draw *i out of the volatile domain.
-          const value_type i_to = i->to;
-          const value_type i_from = i->from;
-
           const value_type overlap =
             std::min(i_to, to) - std::max(i_from, from);
 
@@ -259,28 +343,28 @@ namespace LOFAR
           }
         }
 
-        if (i->to == from) { // (i) (packet)
+        if (i_to == from) { // (i) (packet)
           // *i can be extended
-          i->to = to;
+          setTo(i, to);
 
           struct Range *next = next_rr(i);
 
-          if (i->to == next->from) {
+          if (to == Ranges::from(next)) {
             // merge *i and *next
-            i->to = next->to;
+            setTo(i, Ranges::to(next));
             remove(next);
           }
 
           return true;
-        } else if (i->from == to) { // (packet) (i)
+        } else if (i_from == to) { // (packet) (i)
           // *i can be extended
-          i->from = from;
+          setFrom(i, from);
 
           struct Range *prev = prev_rr(i);
 
-          if (prev->to == i->from) {
+          if (Ranges::to(prev) == from) {
             // merge *prev and *i
-            prev->to = i->to;
+            setTo(prev, Ranges::to(i));
             remove(i);
           }
 
@@ -292,7 +376,7 @@ namespace LOFAR
       for (struct Range *i = _begin; i != _end; ++i) {
         struct Range *prev = prev_rr(i);
 
-        if (prev->to < from && to < i->from) {
+        if (Ranges::to(prev) < from && to < Ranges::from(i)) {
           // we fit in right here.
 
           if (!insert_empty(i, to))
@@ -300,8 +384,7 @@ namespace LOFAR
             return false;
 
           // insert at the new spot
-          i->to = to;
-          i->from = from;
+          set(i, from, to);
           return true;
         }
       }
@@ -312,27 +395,38 @@ namespace LOFAR
 
     bool Ranges::anythingBetween( value_type first, value_type last ) const
     {
-      for(const_iterator i = begin(); i != end(); ++i) {
-        value_type from = std::max( i.from(), first );
-        value_type to = std::min( i.to(), last );
+      if (first >= last || len == 0)
+        return false;
 
-        if (from < to)
-          return true;
-      }
+      std::vector<range_type> found;
+      uint64 sequence;
 
-      return false;
+      do {
+        sequence = beginRead();
+        collect(first, last, 1, found);
+      } while (!endRead(sequence));
+
+      return !found.empty();
     }
 
     Ranges::flags_type Ranges::sparseSet( value_type first, value_type last ) const
     {
       Ranges::flags_type result;
 
-      if (first >= last)
+      if (first >= last || len == 0)
         return result;
 
-      for(const_iterator i = begin(); i != end(); ++i) {
-        value_type from = std::max( i.from(), first );
-        value_type to = std::min( i.to(), last );
+      std::vector<range_type> found;
+      uint64 sequence;
+
+      do {
+        sequence = beginRead();
+        collect(first, last, len, found);
+      } while (!endRead(sequence));
+
+      for (size_t i = 0; i < found.size(); ++i) {
+        value_type from = std::max( found[i].first, first );
+        value_type to = std::min( found[i].second, last );
 
         if (from < to)
           result.include(from, to);
@@ -22,12 +22,14 @@
 #define LOFAR_INPUT_PROC_RANGES_H
 
 #include <ostream>
-#include <iterator>
+#include <vector>
+#include <utility>
 
 #include <Common/LofarTypes.h>
 #include <Common/LofarLogger.h>
 #include <CoInterface/SparseSet.h>
 
+
 namespace LOFAR
 {
   namespace Cobalt
@@ -37,15 +39,21 @@ namespace LOFAR
     // Thread-safe, lock-free set of value_type [from,to) ranges.
     //
     // This implementation is thread safe for one writer and any number
-    // of readers.
+    // of readers, which may live in different processes if the data is
+    // put in shared memory.
+    //
+    // We maintain a fixed ring of [from,to) ranges, ordered from the oldest
+    // range (just after `head') to the newest range (at `head'). Unused
+    // ranges (from = to = 0) are always the oldest. The calling process
+    // needs to make sure that it updates ranges in an order that ensures
+    // integrity w.r.t. the data that is represented. That is, exclude ranges
+    // that will be overwritten before writing and including the new data.
     //
-    // To maintain integrity, we maintain a fixed set of [from,to)
-    // ranges. For any range, if to == 0, the range is either unused
-    // or in the process of being updated. The calling process needs
-    // to make sure that it updates ranges in an order that ensures
-    // integrity w.r.t. the data that is represented. That is,
-    // exclude ranges that will be overwritten before writing and
-    // including the new data.
+    // The writer never blocks. Every modification is wrapped in a sequence
+    // lock: the sequence number is odd while the writer modifies the ring,
+    // and readers retry if the sequence number changed while they were
+    // reading. Because the ring is ordered, readers locate the ranges of
+    // interest with a binary search.
 
     class Ranges
     {
@@ -77,93 +85,86 @@ namespace LOFAR
       void dump() const;
 
     private:
+      // Shared state, stored in front of the ranges. All shared fields
+      // are accessed with the GCC __atomic builtins.
+      struct Header {
+        // Odd while the writer is modifying the ranges.
+        uint64 sequence;
+
+        // Index of the newest range.
+        size_t head;
+
+        Header() : sequence(0), head(0)
+        {
+        }
+      };
+
       struct Range {
-        // Write 'from' before 'to' to allow the following invariant:
-        //
         // from <  to   : a valid range
-        // from >= to   : invalid range (being written)
         // from = to = 0: an unused range
-        volatile value_type from, to;
+        value_type from, to;
 
         Range() : from(0), to(0)
         {
         }
       };
 
+      typedef std::pair<value_type, value_type> range_type;
+
       bool create;
       size_t len;
+      Header *header;
       Range *ranges;
       Range *_begin;
       Range *_end;
-      Range *head;
 
       // minimal history to maintain (samples newer than this
       // will be maintained in favour of newly added ranges)
       value_type minHistory;
 
-      // An iterator that skips invalid Range entries. We keep this private
-      // to avoid external access to our volatile members.
-      //
-      // The iterator caches the range it points to, allowing it to keep
-      // the referenced value valid.
-      class const_iterator: public std::iterator<std::forward_iterator_tag, const struct Range> {
+      // Marks the writer's modifications, for the lifetime of this object.
+      class ScopedWrite {
       public:
-        const_iterator(pointer at, pointer const end): ptr(at), end(end) { moveToValid(); }
-        const_iterator(const const_iterator &other): ptr(other.ptr), end(other.end) {}
+        ScopedWrite( Header &header );
+        ~ScopedWrite();
 
-        Ranges::value_type from() const { return cache.from; }
-        Ranges::value_type to()   const { return cache.to;   }
+      private:
+        Header &header;
+        const uint64 sequence;
+      };
 
-        bool operator==(const const_iterator &other) { return ptr == other.ptr; }
-        bool operator!=(const const_iterator &other) { return ptr != other.ptr; }
+      // Start a read, returning the sequence number to validate against.
+      uint64 beginRead() const;
 
-        const_iterator &operator++() {
-          ++ptr;
-          moveToValid();
-          return *this;
-        }
+      // Returns whether nothing was modified since beginRead() returned
+      // `sequence'.
+      bool endRead( uint64 sequence ) const;
 
-      private:
-        // the item being referenced
-        pointer ptr;
-
-        // move the pointer until it hits a valid value
-        void moveToValid() {
-          if (ptr == end)
-            return;
-
-          // find the next valid entry before `end'
-          do {
-            cache = *ptr;
-          } while(!cacheValid() && ++ptr != end);
-        }
+      // Collect the valid ranges that intersect [first, last) in
+      // `result', up to `max' of them. Must be called between beginRead()
+      // and endRead(); the result is only valid if endRead() succeeds.
+      void collect( value_type first, value_type last, size_t max,
+                    std::vector<range_type> &result ) const;
 
-        // whether `cache' is a valid entry
-        bool cacheValid() const {
-          return from() < to();
-        }
-
-        // a non-volatile cache of *ptr
-        struct {
-          Ranges::value_type from, to;
+      // Field access for the writer, which can use relaxed ordering
+      // because the sequence lock orders its stores.
+      static value_type from( const Range *r ) { return __atomic_load_n(&r->from, __ATOMIC_RELAXED); }
+      static value_type to( const Range *r )   { return __atomic_load_n(&r->to, __ATOMIC_RELAXED); }
 
-          void operator=(const Range &r) {
-            // read in same order as fields are written
-            from = r.from;
-            to = r.to;
-          }
-        } cache;
+      static void set( Range *r, value_type from, value_type to ) {
+        __atomic_store_n(&r->from, from, __ATOMIC_RELAXED);
+        __atomic_store_n(&r->to, to, __ATOMIC_RELAXED);
+      }
 
-        // a cache of the end, to prevent skipping over it
-        pointer const end;
-      };
+      static void setFrom( Range *r, value_type from ) { __atomic_store_n(&r->from, from, __ATOMIC_RELAXED); }
+      static void setTo( Range *r, value_type to )     { __atomic_store_n(&r->to, to, __ATOMIC_RELAXED); }
 
-      const_iterator begin() const {
-        return const_iterator(_begin, _end);
+      Range *head() const {
+        return _begin + __atomic_load_n(&header->head, __ATOMIC_RELAXED);
       }
 
-      const_iterator end() const {
-        return const_iterator(_end, _end);
+      void setHead( Range *x ) {
+        __atomic_store_n(&header->head, (size_t)(x - _begin), __ATOMIC_RELAXED);
       }
 
       // Return a pointer to the next entry, wrapping around
@@ -194,7 +195,7 @@ namespace LOFAR
       // The size of this object for a given number of [from,to) pairs.
       static size_t size(size_t numElements)
       {
-        return numElements * sizeof(struct Range);
+        return sizeof(struct Header) + numElements * sizeof(struct Range);
       }
 
       friend std::ostream& operator<<( std::ostream &str, const Ranges &r );
@@ -23,11 +23,15 @@
 #include "PacketReader.h"
 
 #include <cmath>
+#include <cstring>
 #include <sys/time.h>
+#include <unistd.h>
 #include <typeinfo>
 #include <boost/format.hpp>
 
 #include <Common/LofarLogger.h>
+#include <Common/SystemCallException.h>
+#include <CoInterface/Allocator.h>
 #include <CoInterface/Stream.h>
 
 
@@ -35,6 +39,52 @@ namespace LOFAR
 {
   namespace Cobalt
   {
+    PacketBatch::PacketBatch( size_t nrPackets )
+      :
+      nrRead(0),
+      nrPackets(nrPackets),
+      packets(static_cast<struct RSP*>(heapAllocator.allocate(nrPackets * sizeof(struct RSP), sysconf(_SC_PAGESIZE)))),
+      iov(nrPackets),
+#ifdef __linux__
+      msgs(nrPackets),
+#endif
+      control(nrPackets * controlSize),
+      arrivalTimes(nrPackets)
+    {
+      ASSERT(nrPackets > 0);
+
+      for (size_t i = 0; i < nrPackets; ++i) {
+        // Invalidate all packets until they are read
+        memset(&packets[i].header, 0, sizeof packets[i].header);
+        packets[i].payloadError(true);
+
+        iov[i].iov_base = &packets[i];
+        iov[i].iov_len  = sizeof(struct RSP);
+
+#ifdef __linux__
+        struct msghdr &hdr = msgs[i].msg_hdr;
+
+        hdr.msg_name       = NULL; // we don't need to know who sent the data
+        hdr.msg_namelen    = 0;
+        hdr.msg_iov        = &iov[i];
+        hdr.msg_iovlen     = 1;
+        hdr.msg_control    = &control[i * controlSize];
+        hdr.msg_controllen = controlSize;
+        hdr.msg_flags      = 0;
+#endif
+
+        arrivalTimes[i].tv_sec  = 0;
+        arrivalTimes[i].tv_nsec = 0;
+      }
+    }
+
+
+    PacketBatch::~PacketBatch()
+    {
+      heapAllocator.deallocate(packets);
+    }
+
+
     // Create an 'invalid' mode to make it unique and not match any actually used mode.
     const BoardMode PacketReader::MODE_ANY(0, 0);
 
@@ -50,9 +100,23 @@ namespace LOFAR
       nrBadTime(0),
       nrBadData(0),
       nrBadOther(0),
+      nrMissed(0),
+      nrDropped(0),
+      sumGap(0.0),
+      sumGap2(0.0),
+      maxGap(0.0),
+      nrGaps(0),
+      nextTimeStamp(0),
+      lastDropCounter(0),
+      haveDropCounter(false),
+      lastHeaderPrefix(0),
+      lastPacketSize(0),
       hadSizeError(false),
       lastLogTime(0)
     {
+      lastArrival.tv_sec  = 0;
+      lastArrival.tv_nsec = 0;
+
       // Partial reads are not supported on UDP streams, because each read()
       // will consume a full packet.
       try {
@@ -64,6 +128,22 @@ namespace LOFAR
         // inputStream is not a SocketStream
         inputIsUDP = false;
       }
+
+#ifdef __linux__
+      if (inputIsUDP) {
+        const int fd = dynamic_cast<SocketStream&>(inputStream).fd;
+        const int on = 1;
+
+        // Have the kernel record the arrival time of each packet, and
+        // report the number of packets it dropped. Both are only used
+        // for statistics, so failure is not fatal.
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof on) < 0)
+          LOG_WARN_STR(this->logPrefix << "Cannot enable SO_TIMESTAMPNS: " << strerror(errno));
+
+        if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof on) < 0)
+          LOG_WARN_STR(this->logPrefix << "Cannot enable SO_RXQ_OVFL: " << strerror(errno));
+      }
+#endif
     }
 
 
@@ -81,7 +161,11 @@ namespace LOFAR
 
         // validate received packets
         for (size_t i = 0; i < numRead; ++i) {
-          packets[i].payloadError(!validatePacket(packets[i], recvdSizes[i]));
+          const bool valid = validatePacket(packets[i], recvdSizes[i]);
+          packets[i].payloadError(!valid);
+
+          if (valid)
+            registerSequence(packets[i]);
         }
       } else {
         // fall-back for non-UDP streams, emit packets
@@ -97,6 +181,113 @@ namespace LOFAR
     }
 
 
+    void PacketReader::readPackets( PacketBatch &batch )
+    {
+      size_t numRead;
+
+#ifdef __linux__
+      if (inputIsUDP) {
+        const int fd = dynamic_cast<SocketStream&>(inputStream).fd;
+
+        // Our buffers and descriptors are already in place, we only need to
+        // reset the fields the kernel writes to.
+        for (size_t i = 0; i < batch.nrPackets; ++i)
+          batch.msgs[i].msg_hdr.msg_controllen = PacketBatch::controlSize;
+
+        const int result = ::recvmmsg(fd, &batch.msgs[0], batch.nrPackets, 0, NULL);
+        if (result < 0)
+          THROW_SYSCALL("recvmmsg");
+
+        numRead = result;
+        nrReceived += numRead;
+
+        for (size_t i = 0; i < numRead; ++i) {
+          struct RSP &packet = batch.packets[i];
+          struct timespec &arrival = batch.arrivalTimes[i];
+          struct msghdr &hdr = batch.msgs[i].msg_hdr;
+
+          arrival.tv_sec  = 0;
+          arrival.tv_nsec = 0;
+
+          // Extract the arrival time and kernel drop counter
+          for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET)
+              continue;
+
+            if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
+              memcpy(&arrival, CMSG_DATA(cmsg), sizeof arrival);
+            } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+              uint32 dropCounter;
+              memcpy(&dropCounter, CMSG_DATA(cmsg), sizeof dropCounter);
+
+              if (haveDropCounter)
+                nrDropped += dropCounter - lastDropCounter;
+
+              lastDropCounter = dropCounter;
+              haveDropCounter = true;
+            }
+          }
+
+          const bool valid = validatePacket(packet, batch.msgs[i].msg_len);
+          packet.payloadError(!valid);
+
+          if (valid) {
+            registerSequence(packet);
+            registerArrival(arrival);
+          }
+        }
+      } else
+#endif
+      {
+        // fall-back for non-UDP streams, emit packets
+        // one at a time to avoid data loss on EndOfStream.
+        batch.packets[0].payloadError(!readPacket(batch.packets[0]));
+        batch.arrivalTimes[0].tv_sec  = 0;
+        batch.arrivalTimes[0].tv_nsec = 0;
+        numRead = 1;
+      }
+
+      // mark unused packet buffers as invalid
+      for (size_t i = numRead; i < batch.nrRead; ++i) {
+        batch.packets[i].payloadError(true);
+      }
+
+      batch.nrRead = numRead;
+    }
+
+
+    void PacketReader::registerSequence( const struct RSP &packet )
+    {
+      const uint64 timeStamp = packet.timeStamp();
+
+      // Count the packets skipped since the last one. Out-of-order
+      // packets are not compensated for.
+      if (nextTimeStamp > 0 && timeStamp > nextTimeStamp && packet.header.nrBlocks > 0)
+        nrMissed += (timeStamp - nextTimeStamp) / packet.header.nrBlocks;
+
+      if (timeStamp >= nextTimeStamp)
+        nextTimeStamp = timeStamp + packet.header.nrBlocks;
+    }
+
+
+    void PacketReader::registerArrival( const struct timespec &arrival )
+    {
+      if (arrival.tv_sec == 0 && arrival.tv_nsec == 0)
+        return;
+
+      if (lastArrival.tv_sec != 0 || lastArrival.tv_nsec != 0) {
+        const double gap = (arrival.tv_sec - lastArrival.tv_sec) + 1e-9 * (arrival.tv_nsec - lastArrival.tv_nsec);
+
+        sumGap  += gap;
+        sumGap2 += gap * gap;
+        maxGap = std::max(maxGap, gap);
+        ++nrGaps;
+      }
+
+      lastArrival = arrival;
+    }
+
+
     bool PacketReader::readPacket( struct RSP &packet )
     {
       size_t numbytes;
@@ -119,6 +310,27 @@ namespace LOFAR
     }
 
     bool PacketReader::validatePacket( const struct RSP &packet, size_t numbytes )
+    {
+      // Fast path: a packet from the same stream as the last valid one
+      // (same version, flags, modes, and size) only needs its time stamp
+      // checked.
+      uint64 headerPrefix;
+      memcpy(&headerPrefix, &packet.header, sizeof headerPrefix);
+
+      if (lastPacketSize > 0 && headerPrefix == lastHeaderPrefix && numbytes == lastPacketSize) {
+        if (packet.header.timestamp == ~0U) {
+          ++nrBadTime;
+          return false;
+        }
+
+        return true;
+      }
+
+      return validatePacketSlow(packet, numbytes);
+    }
+
+
+    bool PacketReader::validatePacketSlow( const struct RSP &packet, size_t numbytes )
     {
       // illegal size means illegal packet; don't touch
       if ( numbytes < sizeof(struct RSP::Header) 
@@ -162,6 +374,9 @@ namespace LOFAR
       }
 
       // everything is ok
+      memcpy(&lastHeaderPrefix, &packet.header, sizeof lastHeaderPrefix);
+      lastPacketSize = numbytes;
+
       return true;
     }
 
@@ -181,7 +396,16 @@ namespace LOFAR
       LOG_INFO_STR( logPrefix << (nrReceived / interval) << " pps: received " <<
                     nrReceived << " packets: " << nrBadTime << " bad timestamps, " <<
                     nrBadMode << " bad clock/bitmode, " << nrBadData << " payload errors, " <<
-                    nrBadOther << " otherwise bad packets" );
+                    nrBadOther << " otherwise bad packets, " << nrMissed << " missed, " <<
+                    nrDropped << " dropped by kernel" );
+
+      if (nrGaps > 0) {
+        const double meanGap = sumGap / nrGaps;
+        const double jitter  = sqrt(std::max(0.0, sumGap2 / nrGaps - meanGap * meanGap));
+
+        LOG_INFO_STR( logPrefix << "Packet arrival: mean interval " << meanGap * 1e6 <<
+                      " us, jitter " << jitter * 1e6 << " us, max interval " << maxGap * 1e6 << " us" );
+      }
 
       // Emit data points for monitoring (PVSS)
       // Reproduce PN_CSI_STREAM0_BLOCKS_IN or PN_CSI_STREAM0_REJECTED, but with the right nr.
@@ -198,6 +422,13 @@ namespace LOFAR
       nrBadMode = 0;
       nrBadData = 0;
       nrBadOther = 0;
+      nrMissed = 0;
+      nrDropped = 0;
+
+      sumGap = 0.0;
+      sumGap2 = 0.0;
+      maxGap = 0.0;
+      nrGaps = 0;
 
       hadSizeError = false;
 
@@ -22,6 +22,10 @@
 #define LOFAR_INPUT_PROC_PACKETREADER_H
 
 #include <string>
+#include <vector>
+#include <ctime>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <Common/Exception.h>
 #include <Stream/SocketStream.h>
@@ -35,6 +39,58 @@ namespace LOFAR
   namespace Cobalt
   {
 
+    /*
+     * A fixed set of packet buffers, to be filled by
+     * PacketReader::readPackets(). The buffers are page aligned, and the
+     * receive descriptors (iovecs, message headers, control buffers) are
+     * set up once, so the kernel can write the packets straight into place
+     * without any per-batch setup or copying.
+     *
+     * Next to the packets, the kernel arrival time of each packet is stored.
+     */
+    class PacketBatch
+    {
+    public:
+      PacketBatch( size_t nrPackets );
+      ~PacketBatch();
+
+      size_t size() const { return nrPackets; }
+
+      struct RSP &operator[]( size_t i ) { return packets[i]; }
+      const struct RSP &operator[]( size_t i ) const { return packets[i]; }
+
+      // The number of packets received by the last readPackets() call.
+      // Packets [nrRead, size()) are invalid.
+      size_t nrRead;
+
+      // The arrival time of packet i as recorded by the kernel, or
+      // 0 if unknown.
+      const struct timespec &arrivalTime( size_t i ) const { return arrivalTimes[i]; }
+
+    private:
+      friend class PacketReader;
+
+      // Space needed to receive the control messages for one packet
+      // (SO_TIMESTAMPNS, SO_RXQ_OVFL).
+      static const size_t controlSize = 64;
+
+      const size_t nrPackets;
+
+      // [nrPackets], page aligned
+      struct RSP *packets;
+
+      std::vector<struct iovec> iov;
+#ifdef __linux__
+      std::vector<struct mmsghdr> msgs;
+#endif
+      std::vector<char> control;
+      std::vector<struct timespec> arrivalTimes;
+
+      // Prevent copying, as msgs points into our own buffers
+      PacketBatch( const PacketBatch & );
+      PacketBatch &operator=( const PacketBatch & );
+    };
+
     /*
      * Reads RSP packets from a Stream, and collects statistics.
      *
@@ -52,6 +108,11 @@ namespace LOFAR
       // flag for all invalid packets.
       void readPackets( std::vector<struct RSP> &packets );
 
+      // Reads a set of packets from the input stream directly into `batch',
+      // and records their arrival times. Sets the payloadError flag for all
+      // invalid packets.
+      void readPackets( PacketBatch &batch );
+
       // Reads a packet from the input stream. Returns true if a packet was
       // succesfully read.
       bool readPacket( struct RSP &packet );
@@ -80,6 +141,29 @@ namespace LOFAR
       size_t nrBadTime; // nr. of packets with an illegal time stamp
       size_t nrBadData; // nr. of packets with payload errors
       size_t nrBadOther; // nr. of packets that are bad in another fashion (illegal header, packet size, etc)
+      size_t nrMissed; // nr. of packets missing in the sequence of time stamps
+      size_t nrDropped; // nr. of packets dropped by the kernel (socket buffer overflow)
+
+      // Arrival statistics (real-time UDP input only)
+      double sumGap; // sum of the gaps between arrival times
+      double sumGap2; // sum of the squares of the gaps between arrival times
+      double maxGap; // largest gap between arrival times
+      size_t nrGaps;
+      struct timespec lastArrival;
+
+      // The time stamp (in samples) following the last valid packet,
+      // to detect missed packets, or 0 if no packet was received yet.
+      uint64 nextTimeStamp;
+
+      // The kernel drop counter, as last reported by SO_RXQ_OVFL.
+      uint32 lastDropCounter;
+      bool haveDropCounter;
+
+      // The first 8 header bytes (version, source info, configuration,
+      // station, nrBeamlets, nrBlocks) and the size of the last valid packet.
+      // Packets matching these are validated quickly.
+      uint64 lastHeaderPrefix;
+      size_t lastPacketSize;
 
       bool hadSizeError; // already reported about wrongly sized packets since last logStatistics()
 
@@ -87,6 +171,16 @@ namespace LOFAR
 
       // numbytes is the actually received size, as indicated by the kernel
       bool validatePacket(const struct RSP &packet, size_t numbytes);
+
+      // Full validation of a packet, also updates lastHeaderPrefix and
+      // lastPacketSize for valid packets.
+      bool validatePacketSlow(const struct RSP &packet, size_t numbytes);
+
+      // Update the loss statistics with a valid packet.
+      void registerSequence(const struct RSP &packet);
+
+      // Update the arrival statistics with a valid packet.
+      void registerArrival(const struct timespec &arrival);
     };
 
 
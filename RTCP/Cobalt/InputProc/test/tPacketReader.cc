@@ -21,11 +21,17 @@
 #include <lofar_config.h>
 
 #include <string>
+#include <ctime>
+#include <unistd.h>
 
 #include <Common/LofarLogger.h>
 #include <Stream/FileStream.h>
+#include <Stream/SocketStream.h>
+#include <Stream/StreamFactory.h>
+#include <CoInterface/SmartPtr.h>
 
 #include <InputProc/Station/PacketReader.h>
+#include <InputProc/Station/PacketFactory.h>
 #include <InputProc/Station/RSP.h>
 
 using namespace LOFAR;
@@ -57,11 +63,61 @@ void test(const std::string &filename, unsigned bitmode, unsigned nrPackets)
   }
 }
 
+// Send packets over loopback UDP, and receive them in a PacketBatch.
+void testUDP(unsigned bitmode, unsigned nrBatches)
+{
+  const std::string desc = "udp:127.0.0.1:54322";
+
+  SmartPtr<Stream> in = createStream(desc, true);
+  SmartPtr<Stream> out = createStream(desc, false);
+
+  const struct BoardMode mode(bitmode, 200);
+  PacketFactory factory(mode);
+  PacketReader reader("", *in, mode);
+
+  const TimeStamp from(time(0), 0, mode.clockHz());
+
+  // Note: readPackets() waits until the batch is full. Keep the batches
+  // small enough to fit in the default socket buffer.
+  PacketBatch batch(8);
+
+  for (size_t b = 0; b < nrBatches; ++b) {
+    const TimeStamp batchStart = from + b * batch.size() * 16;
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      struct RSP packet;
+
+      ASSERT( factory.makePacket(packet, batchStart + i * 16, 0) );
+      out->write(&packet, packet.packetSize());
+    }
+
+    reader.readPackets(batch);
+
+    ASSERT( batch.nrRead == batch.size() );
+
+    for (size_t i = 0; i < batch.nrRead; ++i) {
+      // Packets arrive in-order over loopback
+      ASSERT( !batch[i].payloadError() );
+      ASSERT( batch[i].bitMode() == bitmode );
+      ASSERT( batch[i].timeStamp() == batchStart + i * 16 );
+
+      // The kernel should have recorded an arrival time
+      ASSERT( batch.arrivalTime(i).tv_sec > 0 );
+    }
+  }
+}
+
 int main()
 {
   INIT_LOGGER("tPacketReader");
 
+  // Don't run forever if communication fails for some reason
+  alarm(10);
+
   test("tPacketReader.in_16bit", 16, 2);
   test("tPacketReader.in_8bit",   8, 2);
+
+  testUDP(16, 8);
+  testUDP(8, 8);
 }
 
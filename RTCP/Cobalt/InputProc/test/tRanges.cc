@@ -184,6 +184,29 @@ SUITE(OutOfOrder) {
     CHECK(result);
   }
 
+  TEST_FIXTURE(Fixture, WrapAround) {
+    // fill the ring, expire the oldest ranges, and
+    // wrap around the end of the ring
+    r.include(10, 20);
+    r.include(30, 40);
+    r.include(50, 60);
+    r.include(70, 80);
+    r.include(90, 100);
+
+    r.excludeBefore(55);
+
+    r.include(110, 120);
+    r.include(130, 140);
+
+    CHECK_EQUAL("[55, 60) [70, 80) [90, 100) [110, 120) [130, 140)", toStr());
+
+    // insert out of order in the wrapped part
+    r.excludeBefore(75);
+    r.include(122, 125);
+
+    CHECK_EQUAL("[75, 80) [90, 100) [110, 120) [122, 125) [130, 140)", toStr());
+  }
+
   TEST_FIXTURE(Fixture, FillHole) {
     r.include(10, 20);
     r.include(30, 40);
@@ -230,6 +253,30 @@ SUITE(Subsets) {
     CHECK( s.test(39));
     CHECK(!s.test(40));
   }
+
+  TEST_FIXTURE(Fixture, SparseSetWrapped) {
+    r.include(10, 20);
+    r.include(30, 40);
+    r.include(50, 60);
+    r.include(70, 80);
+    r.include(90, 100);
+    r.excludeBefore(45);
+    r.include(110, 120);
+
+    // query a subset spanning the wrap point
+    Ranges::flags_type s = r.sparseSet(55, 115);
+
+    CHECK_EQUAL(30U, s.count());
+    CHECK(!s.test(54));
+    CHECK( s.test(55));
+    CHECK(!s.test(60));
+    CHECK( s.test(70));
+    CHECK( s.test(114));
+    CHECK(!s.test(115));
+
+    CHECK(!r.anythingBetween(100, 110));
+    CHECK( r.anythingBetween(100, 111));
+  }
 }
 
 int main()
@@ -0,0 +1,156 @@
+//# tRangesPerf.cc
+//# Copyright (C) 2013  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+#include <omp.h>
+
+#include <Common/LofarTypes.h>
+#include <Common/LofarLogger.h>
+
+#include <InputProc/Buffer/Ranges.h>
+
+using namespace LOFAR;
+using namespace Cobalt;
+using namespace std;
+
+// Stress test and benchmark for Ranges: one thread writes packets like
+// the packet reader does, while the other threads keep querying the
+// most recent data, as the transpose does. Readers verify the
+// flags of any data that is guaranteed to be stable.
+//
+// Usage: tRangesPerf [nrReaders [seconds]]
+
+// Number of samples per packet
+const Ranges::value_type packetSize = 16;
+
+// Every n-th packet is lost
+const Ranges::value_type lossInterval = 97;
+
+// History to keep in the buffer, in samples
+const Ranges::value_type history = 64 * lossInterval * packetSize;
+
+// The size of the blocks queried by the readers
+const Ranges::value_type blockSize = history / 4;
+
+bool isLost( Ranges::value_type packetNr )
+{
+  return packetNr % lossInterval == lossInterval - 1;
+}
+
+// Expected number of valid samples in [first, last), which
+// must be aligned to packet boundaries.
+size_t expectedCount( Ranges::value_type first, Ranges::value_type last )
+{
+  size_t count = 0;
+
+  for (Ranges::value_type p = first / packetSize; p < last / packetSize; ++p)
+    if (!isLost(p))
+      count += packetSize;
+
+  return count;
+}
+
+int main( int argc, char **argv )
+{
+  INIT_LOGGER("tRangesPerf");
+
+  const int nrReaders = argc > 1 ? atoi(argv[1]) : 4;
+  const double duration = argc > 2 ? atof(argv[2]) : 1.0;
+
+  vector<char> buf(Ranges::size(256));
+  Ranges ranges(&buf[0], buf.size(), history, true);
+
+  // The end of the data written so far
+  Ranges::value_type writePos = 0;
+  bool done = false;
+
+  size_t nrPackets = 0;
+  size_t nrQueries = 0;
+  size_t nrVerified = 0;
+  size_t nrErrors = 0;
+
+  const double start = omp_get_wtime();
+
+# pragma omp parallel num_threads(nrReaders + 1) reduction(+:nrQueries,nrVerified,nrErrors)
+  {
+    if (omp_get_thread_num() == 0) {
+      // The writer
+      for (Ranges::value_type p = 0; ; ++p) {
+        const Ranges::value_type from = p * packetSize;
+        const Ranges::value_type to = from + packetSize;
+
+        if (from > history)
+          ranges.excludeBefore(from - history);
+
+        if (!isLost(p))
+          ranges.include(from, to);
+
+        __atomic_store_n(&writePos, to, __ATOMIC_RELEASE);
+
+        // check the time only once in a while
+        if (p % 1024 == 0 && omp_get_wtime() - start > duration) {
+          nrPackets = p + 1;
+          break;
+        }
+      }
+
+      __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    } else {
+      // A reader
+      while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        const Ranges::value_type pos = __atomic_load_n(&writePos, __ATOMIC_ACQUIRE);
+
+        if (pos < history)
+          continue;
+
+        // query the block that lies halfway the history
+        const Ranges::value_type last = pos - history / 2;
+        const Ranges::value_type first = last - blockSize;
+
+        const Ranges::flags_type flags = ranges.sparseSet(first, last);
+        nrQueries++;
+
+        // Only verify if the block did not expire during our query
+        if (__atomic_load_n(&writePos, __ATOMIC_ACQUIRE) - history > first)
+          continue;
+
+        if (flags.count() != expectedCount(first, last)) {
+          LOG_ERROR_STR("Expected " << expectedCount(first, last) << " samples in [" << first << ", " << last << "), got " << flags.count());
+          nrErrors++;
+        }
+
+        nrVerified++;
+      }
+    }
+  }
+
+  const double elapsed = omp_get_wtime() - start;
+
+  cout << "Writer: " << nrPackets / elapsed << " packets/s" << endl;
+  cout << "Readers (" << nrReaders << "): " << nrQueries / elapsed << " queries/s, "
+       << nrVerified << " verified, " << nrErrors << " errors" << endl;
+
+  return nrErrors > 0 ? 1 : 0;
+}
+
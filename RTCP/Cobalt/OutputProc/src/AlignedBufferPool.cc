@@ -0,0 +1,206 @@
+//# AlignedBufferPool.cc: a bounded pool of aligned, pinned I/O buffers
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "AlignedBufferPool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+
+#include <Common/LofarLogger.h>
+#include <CoInterface/Exceptions.h>
+#include <CoInterface/SmartPtr.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    AlignedBufferPool::AlignedBufferPool(size_t nrSpareBuffers, size_t bufferSize)
+      :
+      itsBufferSize((bufferSize + alignment - 1) & ~(alignment - 1)),
+      itsPinned(true),
+      itsNrSpare(nrSpareBuffers),
+      itsNrReserved(0),
+      itsNrReservedInUse(0)
+    {
+      ASSERT(itsBufferSize > 0);
+
+      addBuffers(nrSpareBuffers);
+    }
+
+
+    AlignedBufferPool::~AlignedBufferPool()
+    {
+      if (itsFree.size() != itsBuffers.size())
+        LOG_ERROR_STR("AlignedBufferPool destroyed while " << itsBuffers.size() - itsFree.size() << " buffers are in use");
+
+      for (size_t i = 0; i < itsBuffers.size(); ++i) {
+        if (itsPinned)
+          (void)munlock(itsBuffers[i], itsBufferSize);
+
+        free(itsBuffers[i]);
+      }
+    }
+
+
+    void AlignedBufferPool::addBuffers(size_t nrBuffers)
+    {
+      itsBuffers.reserve(itsBuffers.size() + nrBuffers);
+      itsFree.reserve(itsBuffers.size() + nrBuffers);
+
+      for (size_t i = 0; i < nrBuffers; ++i) {
+        void *buf;
+
+        if (posix_memalign(&buf, alignment, itsBufferSize) != 0)
+          THROW( StorageException, "Not enough memory to allocate " << nrBuffers << " I/O buffers of " << itsBufferSize << " bytes");
+
+        // touch the memory, so it is really there when we need it
+        memset(buf, 0, itsBufferSize);
+
+        if (itsPinned && mlock(buf, itsBufferSize) != 0) {
+          LOG_WARN_STR("Could not lock I/O buffers in memory (" << strerror(errno) << "); raise the memlock limit to avoid page faults while writing");
+          itsPinned = false;
+        }
+
+        itsBuffers.push_back(static_cast<char*>(buf));
+        itsFree.push_back(static_cast<char*>(buf));
+      }
+    }
+
+
+    void AlignedBufferPool::reserve(size_t nrBuffers)
+    {
+      ScopedLock sl(itsMutex);
+
+      // Keep the spare buffers on top of the reserved ones. Buffers of
+      // writers that are gone are reused.
+      size_t nrAdd = 0;
+
+      if (itsBuffers.size() < itsNrSpare + itsNrReserved + nrBuffers)
+        nrAdd = itsNrSpare + itsNrReserved + nrBuffers - itsBuffers.size();
+
+      // The spare buffers may be borrowed now, while the reserved ones
+      // must be free.
+      const size_t nrNeeded = itsNrReserved + nrBuffers - itsNrReservedInUse;
+
+      if (itsFree.size() + nrAdd < nrNeeded)
+        nrAdd = nrNeeded - itsFree.size();
+
+      addBuffers(nrAdd);
+
+      itsNrReserved += nrBuffers;
+    }
+
+
+    void AlignedBufferPool::unreserve(size_t nrBuffers)
+    {
+      ScopedLock sl(itsMutex);
+
+      ASSERT(itsNrReserved - itsNrReservedInUse >= nrBuffers);
+
+      itsNrReserved -= nrBuffers;
+    }
+
+
+    char *AlignedBufferPool::getReserved()
+    {
+      ScopedLock sl(itsMutex);
+
+      ASSERT(itsNrReservedInUse < itsNrReserved);
+      ASSERT(!itsFree.empty());
+
+      itsNrReservedInUse++;
+
+      char *buffer = itsFree.back();
+      itsFree.pop_back();
+      return buffer;
+    }
+
+
+    char *AlignedBufferPool::tryGet()
+    {
+      ScopedLock sl(itsMutex);
+
+      // keep the free buffers needed for the reservations
+      if (itsFree.size() <= itsNrReserved - itsNrReservedInUse)
+        return 0;
+
+      char *buffer = itsFree.back();
+      itsFree.pop_back();
+      return buffer;
+    }
+
+
+    void AlignedBufferPool::release(char *buffer, bool reserved)
+    {
+      ScopedLock sl(itsMutex);
+
+      if (reserved) {
+        ASSERT(itsNrReservedInUse > 0);
+        itsNrReservedInUse--;
+      }
+
+      itsFree.push_back(buffer);
+    }
+
+
+    size_t AlignedBufferPool::nrBuffers() const
+    {
+      ScopedLock sl(itsMutex);
+
+      return itsBuffers.size();
+    }
+
+
+    namespace {
+      Mutex sharedPoolMutex;
+      size_t sharedNrSpareBuffers = 128;
+      size_t sharedBufferSize = 1024 * 1024;
+      SmartPtr<AlignedBufferPool> sharedPool;
+    }
+
+
+    void AlignedBufferPool::configureShared(size_t nrSpareBuffers, size_t bufferSize)
+    {
+      ScopedLock sl(sharedPoolMutex);
+
+      if (sharedPool)
+        THROW( StorageException, "The shared I/O buffer pool has already been created" );
+
+      sharedNrSpareBuffers = nrSpareBuffers;
+      sharedBufferSize = bufferSize;
+    }
+
+
+    AlignedBufferPool &AlignedBufferPool::shared()
+    {
+      ScopedLock sl(sharedPoolMutex);
+
+      if (!sharedPool)
+        sharedPool = new AlignedBufferPool(sharedNrSpareBuffers, sharedBufferSize);
+
+      return *sharedPool;
+    }
+  }
+}
+
@@ -0,0 +1,106 @@
+//# AlignedBufferPool.h: a bounded pool of aligned, pinned I/O buffers
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_STORAGE_ALIGNEDBUFFERPOOL_H
+#define LOFAR_STORAGE_ALIGNEDBUFFERPOOL_H
+
+#include <cstddef>
+#include <vector>
+#include <Common/Thread/Mutex.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    // A set of equally sized I/O buffers, aligned for O_DIRECT and locked
+    // in memory (if the memlock limit allows). The buffers are allocated
+    // up front, so the memory used for I/O is bounded.
+    //
+    // Each writer reserves the buffers it needs to make progress on its
+    // own, and the pool grows to keep those available. Buffers beyond the
+    // reservations are spare: writers borrow them with tryGet() to overlap
+    // their writes, but never wait for them. A writer thus never waits for
+    // buffers that other (possibly idle) writers hold.
+    class AlignedBufferPool
+    {
+    public:
+      // alignment of the buffers and of their sizes
+      static const size_t alignment = 4096;
+
+      // Creates a pool with nrSpareBuffers buffers, not reserved by writers.
+      AlignedBufferPool(size_t nrSpareBuffers, size_t bufferSize);
+      ~AlignedBufferPool();
+
+      // Reserves nrBuffers buffers for a writer, adding buffers to the pool
+      // if needed, or returns them.
+      void reserve(size_t nrBuffers);
+      void unreserve(size_t nrBuffers);
+
+      // Get one of the buffers reserved by the caller. Does not block: a
+      // reserved buffer is always free if the caller does not hold it.
+      char *getReserved();
+
+      // Get a spare buffer, or NULL if none is free.
+      char *tryGet();
+
+      // Return a buffer obtained by getReserved() (reserved = true), or by
+      // tryGet() (reserved = false).
+      void release(char *buffer, bool reserved);
+
+      size_t nrBuffers() const;
+      size_t bufferSize() const { return itsBufferSize; }
+
+      // Whether the buffers could be locked in memory.
+      bool pinned() const { return itsPinned; }
+
+      // The pool shared by all writers in this process. It is created on
+      // first use, with the sizes given by configureShared() if called
+      // before, or with the default sizes (128 spare buffers of 1 MiB).
+      static AlignedBufferPool &shared();
+      static void configureShared(size_t nrSpareBuffers, size_t bufferSize);
+
+    private:
+      AlignedBufferPool(const AlignedBufferPool&);
+      AlignedBufferPool& operator=(const AlignedBufferPool&);
+
+      const size_t itsBufferSize;
+      std::vector<char *> itsBuffers;
+      std::vector<char *> itsFree;
+      bool itsPinned;
+
+      const size_t itsNrSpare;
+
+      // The number of reserved buffers, and how many of those are in use.
+      // There are always at least itsNrReserved - itsNrReservedInUse free
+      // buffers.
+      size_t itsNrReserved;
+      size_t itsNrReservedInUse;
+
+      mutable Mutex itsMutex;
+
+      // Allocates nrBuffers more free buffers. Must be called with itsMutex
+      // locked.
+      void addBuffers(size_t nrBuffers);
+    };
+  }
+}
+
+#endif
+
@@ -0,0 +1,677 @@
+//# AsyncFileStream.cc: a file writer using asynchronous O_DIRECT writes
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "AsyncFileStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/aio_abi.h>
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#endif
+
+#include <Common/LofarLogger.h>
+#include <Common/SystemCallException.h>
+#include <CoInterface/TimeFuncs.h>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    // Submits writes and collects their completions.
+    class AsyncIOQueue
+    {
+    public:
+      struct Completion {
+        AsyncFileStream::Request *request;
+        long result; // number of bytes written, or -errno
+      };
+
+      virtual ~AsyncIOQueue() {}
+
+      virtual std::string method() const = 0;
+
+      // Submits the write of request->iov at request->offset.
+      virtual void submit(int fd, AsyncFileStream::Request *request) = 0;
+
+      // Appends the completed writes to `completions'; waits until at
+      // least minComplete writes completed.
+      virtual void reap(unsigned minComplete, std::vector<Completion> &completions) = 0;
+
+      // Creates the best queue available on this system.
+      static AsyncIOQueue *create(unsigned depth);
+    };
+
+
+    namespace
+    {
+#ifdef __NR_io_uring_setup
+      class IoUringQueue : public AsyncIOQueue
+      {
+      public:
+        IoUringQueue(unsigned depth)
+          :
+          itsRingFd(-1),
+          itsSQRing(MAP_FAILED),
+          itsCQRing(MAP_FAILED),
+          itsSQEs(MAP_FAILED)
+        {
+          struct io_uring_params params;
+          memset(&params, 0, sizeof params);
+
+          itsRingFd = syscall(__NR_io_uring_setup, depth, &params);
+
+          if (itsRingFd < 0)
+            THROW_SYSCALL("io_uring_setup");
+
+          itsSQRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+          itsCQRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+          itsSQEsSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+          bool singleMap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+          singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+#endif
+          if (singleMap)
+            itsSQRingSize = itsCQRingSize = std::max(itsSQRingSize, itsCQRingSize);
+
+          itsSQRing = mmap(0, itsSQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, itsRingFd, IORING_OFF_SQ_RING);
+          if (itsSQRing == MAP_FAILED)
+            fail("mmap io_uring SQ ring");
+
+          if (singleMap) {
+            itsCQRing = itsSQRing;
+          } else {
+            itsCQRing = mmap(0, itsCQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, itsRingFd, IORING_OFF_CQ_RING);
+            if (itsCQRing == MAP_FAILED)
+              fail("mmap io_uring CQ ring");
+          }
+
+          itsSQEs = mmap(0, itsSQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, itsRingFd, IORING_OFF_SQES);
+          if (itsSQEs == MAP_FAILED)
+            fail("mmap io_uring SQEs");
+
+          char *sq = static_cast<char*>(itsSQRing);
+          itsSQTail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+          itsSQMask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+          itsSQArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+          char *cq = static_cast<char*>(itsCQRing);
+          itsCQHead  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+          itsCQTail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+          itsCQMask  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+          itsCQEs    = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+        }
+
+        virtual ~IoUringQueue()
+        {
+          cleanup();
+        }
+
+        virtual std::string method() const
+        {
+          return "io_uring";
+        }
+
+        virtual void submit(int fd, AsyncFileStream::Request *request)
+        {
+          // we are the only producer, so the tail needs no atomic load
+          const unsigned tail = *itsSQTail;
+          const unsigned index = tail & *itsSQMask;
+
+          struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe*>(itsSQEs) + index;
+          memset(sqe, 0, sizeof *sqe);
+          sqe->opcode = IORING_OP_WRITEV;
+          sqe->fd = fd;
+          sqe->addr = reinterpret_cast<unsigned long>(&request->iov);
+          sqe->len = 1;
+          sqe->off = request->offset;
+          sqe->user_data = reinterpret_cast<unsigned long>(request);
+
+          itsSQArray[index] = index;
+          __atomic_store_n(itsSQTail, tail + 1, __ATOMIC_RELEASE);
+
+          int rv;
+          do {
+            rv = syscall(__NR_io_uring_enter, itsRingFd, 1, 0, 0, NULL, 0);
+          } while (rv < 0 && errno == EINTR);
+
+          if (rv < 0)
+            THROW_SYSCALL("io_uring_enter");
+        }
+
+        virtual void reap(unsigned minComplete, std::vector<Completion> &completions)
+        {
+          unsigned nrReaped = 0;
+
+          for (;;) {
+            unsigned head = *itsCQHead;
+            const unsigned tail = __atomic_load_n(itsCQTail, __ATOMIC_ACQUIRE);
+
+            for (; head != tail; ++head, ++nrReaped) {
+              const struct io_uring_cqe &cqe = itsCQEs[head & *itsCQMask];
+              Completion c = { reinterpret_cast<AsyncFileStream::Request*>(cqe.user_data), cqe.res };
+              completions.push_back(c);
+            }
+
+            __atomic_store_n(itsCQHead, head, __ATOMIC_RELEASE);
+
+            if (nrReaped >= minComplete)
+              break;
+
+            int rv = syscall(__NR_io_uring_enter, itsRingFd, 0, minComplete - nrReaped, IORING_ENTER_GETEVENTS, NULL, 0);
+
+            if (rv < 0 && errno != EINTR)
+              THROW_SYSCALL("io_uring_enter");
+          }
+        }
+
+      private:
+        void fail(const char *what)
+        {
+          int err = errno;
+          cleanup();
+          throw SystemCallException(what, err, THROW_ARGS);
+        }
+
+        void cleanup()
+        {
+          if (itsSQEs != MAP_FAILED)
+            munmap(itsSQEs, itsSQEsSize);
+          if (itsCQRing != MAP_FAILED && itsCQRing != itsSQRing)
+            munmap(itsCQRing, itsCQRingSize);
+          if (itsSQRing != MAP_FAILED)
+            munmap(itsSQRing, itsSQRingSize);
+          if (itsRingFd >= 0)
+            close(itsRingFd);
+
+          itsSQEs = itsCQRing = itsSQRing = MAP_FAILED;
+          itsRingFd = -1;
+        }
+
+        int itsRingFd;
+        void *itsSQRing, *itsCQRing, *itsSQEs;
+        size_t itsSQRingSize, itsCQRingSize, itsSQEsSize;
+
+        unsigned *itsSQTail, *itsSQMask, *itsSQArray;
+        unsigned *itsCQHead, *itsCQTail, *itsCQMask;
+        struct io_uring_cqe *itsCQEs;
+      };
+#endif
+
+
+      // Linux native AIO (io_submit(2)), used if io_uring is not available.
+      class AIOQueue : public AsyncIOQueue
+      {
+      public:
+        AIOQueue(unsigned depth)
+          :
+          itsContext(0),
+          itsEvents(depth)
+        {
+          if (syscall(__NR_io_setup, depth, &itsContext) < 0)
+            THROW_SYSCALL("io_setup");
+        }
+
+        virtual ~AIOQueue()
+        {
+          (void)syscall(__NR_io_destroy, itsContext);
+        }
+
+        virtual std::string method() const
+        {
+          return "aio";
+        }
+
+        virtual void submit(int fd, AsyncFileStream::Request *request)
+        {
+          struct iocb cb;
+          memset(&cb, 0, sizeof cb);
+          cb.aio_data = reinterpret_cast<unsigned long>(request);
+          cb.aio_lio_opcode = IOCB_CMD_PWRITE;
+          cb.aio_fildes = fd;
+          cb.aio_buf = reinterpret_cast<unsigned long>(request->iov.iov_base);
+          cb.aio_nbytes = request->iov.iov_len;
+          cb.aio_offset = request->offset;
+
+          struct iocb *cbs[1] = { &cb };
+          int rv;
+
+          do {
+            rv = syscall(__NR_io_submit, itsContext, 1, cbs);
+          } while (rv < 0 && errno == EINTR);
+
+          if (rv != 1)
+            THROW_SYSCALL("io_submit");
+        }
+
+        virtual void reap(unsigned minComplete, std::vector<Completion> &completions)
+        {
+          unsigned nrReaped = 0;
+
+          do {
+            int n = syscall(__NR_io_getevents, itsContext, minComplete - nrReaped, itsEvents.size(), &itsEvents[0], NULL);
+
+            if (n < 0) {
+              if (errno == EINTR)
+                continue;
+
+              THROW_SYSCALL("io_getevents");
+            }
+
+            for (int i = 0; i < n; ++i) {
+              Completion c = { reinterpret_cast<AsyncFileStream::Request*>(itsEvents[i].data), static_cast<long>(itsEvents[i].res) };
+              completions.push_back(c);
+            }
+
+            nrReaped += n;
+          } while (nrReaped < minComplete);
+        }
+
+      private:
+        aio_context_t itsContext;
+        std::vector<struct io_event> itsEvents;
+      };
+
+
+      // Synchronous pwrite(2), used if neither io_uring nor AIO is available.
+      class SyncQueue : public AsyncIOQueue
+      {
+      public:
+        virtual std::string method() const
+        {
+          return "pwrite";
+        }
+
+        virtual void submit(int fd, AsyncFileStream::Request *request)
+        {
+          // AsyncFileStream finishes a short write, like for the other queues.
+          ssize_t n;
+
+          do {
+            n = pwrite(fd, request->buffer, request->size, request->offset);
+          } while (n < 0 && errno == EINTR);
+
+          Completion c = { request, n < 0 ? -errno : n };
+          itsDone.push_back(c);
+        }
+
+        virtual void reap(unsigned, std::vector<Completion> &completions)
+        {
+          completions.insert(completions.end(), itsDone.begin(), itsDone.end());
+          itsDone.clear();
+        }
+
+      private:
+        std::vector<Completion> itsDone;
+      };
+    } // namespace
+
+
+    AsyncIOQueue *AsyncIOQueue::create(unsigned depth)
+    {
+#ifdef __NR_io_uring_setup
+      try {
+        return new IoUringQueue(depth);
+      } catch (SystemCallException &ex) {
+        LOG_DEBUG_STR("io_uring not available, trying Linux AIO: " << ex.what());
+      }
+#endif
+
+      try {
+        return new AIOQueue(depth);
+      } catch (SystemCallException &ex) {
+        LOG_WARN_STR("Linux AIO not available, writing synchronously: " << ex.what());
+      }
+
+      return new SyncQueue;
+    }
+
+
+    AsyncFileStream::AsyncFileStream(const std::string &name, int flags, int mode,
+                                     unsigned queueDepth, AlignedBufferPool &pool)
+      :
+      itsName(name),
+      itsPool(pool),
+      itsDirect(true),
+      itsInFlight(0),
+      itsBuffer(0),
+      itsBufferReserved(false),
+      itsBufferOffset(0),
+      itsFill(0),
+      itsHoldsReserved(false),
+      itsError(0),
+      itsLatency("ms"),
+      itsQueueDepth("writes"),
+      itsWaitTime("ms")
+    {
+      ASSERT(queueDepth > 0);
+
+      // We write at explicit offsets, so appending makes no sense.
+      ASSERT((flags & O_APPEND) == 0);
+
+      fd = ::open(name.c_str(), flags | O_DIRECT, mode);
+
+      if (fd < 0 && errno == EINVAL) {
+        // The file system does not support O_DIRECT (f.e. tmpfs).
+        LOG_WARN_STR("Cannot use O_DIRECT for " << name << ", writing through the page cache");
+        itsDirect = false;
+        fd = ::open(name.c_str(), flags, mode);
+      }
+
+      if (fd < 0)
+        THROW_SYSCALL(std::string("open ") + name);
+
+      itsQueue = AsyncIOQueue::create(queueDepth);
+
+      itsRequests.resize(queueDepth);
+      for (unsigned i = 0; i < queueDepth; ++i)
+        itsFreeRequests.push_back(&itsRequests[i]);
+
+      // The pool grows by a buffer per stream, so we can always continue
+      // with our own buffer once its write is done.
+      itsPool.reserve(1);
+    }
+
+
+    AsyncFileStream::~AsyncFileStream()
+    {
+      try {
+        const off_t finalSize = itsBufferOffset + itsFill;
+
+        if (itsBuffer && itsFill > 0)
+          submitCurrent(false);
+
+        drain();
+        checkError();
+
+        // remove the padding of the last block
+        if (ftruncate(fd, finalSize) < 0)
+          THROW_SYSCALL("ftruncate");
+      } catch (Exception &ex) {
+        LOG_ERROR_STR("Exception in destructor: " << ex);
+      }
+
+      if (itsBuffer) {
+        itsPool.release(itsBuffer, itsBufferReserved);
+
+        if (itsBufferReserved)
+          itsHoldsReserved = false;
+      }
+
+      // After an error, a buffer may still be in flight; keep it reserved.
+      if (!itsHoldsReserved)
+        itsPool.unreserve(1);
+
+      LOG_INFO_STR("Wrote " << itsName << " using " << method()
+                   << (itsDirect ? " with O_DIRECT" : "")
+                   << ": write latency " << itsLatency
+                   << ", queue depth " << itsQueueDepth
+                   << ", waited " << itsWaitTime);
+    }
+
+
+    std::string AsyncFileStream::method() const
+    {
+      return itsQueue->method();
+    }
+
+
+    size_t AsyncFileStream::tryWrite(const void *ptr, size_t size)
+    {
+      checkError();
+
+      const char *src = static_cast<const char*>(ptr);
+      const size_t bufferSize = itsPool.bufferSize();
+      size_t todo = size;
+
+      while (todo > 0) {
+        if (!itsBuffer)
+          getBuffer();
+
+        const size_t n = std::min(todo, bufferSize - itsFill);
+        memcpy(itsBuffer + itsFill, src, n);
+        itsFill += n;
+        src += n;
+        todo -= n;
+
+        if (itsFill == bufferSize) {
+          submitCurrent(false);
+          itsBufferOffset += bufferSize;
+          itsFill = 0;
+        }
+      }
+
+      return size;
+    }
+
+
+    void AsyncFileStream::getBuffer()
+    {
+      using namespace TimeSpec;
+      const struct timespec begin = TimeSpec::now();
+
+      // Release the buffers of our finished writes first.
+      if (itsInFlight > 0)
+        reap(0);
+
+      // Use our reserved buffer if we have it, else a spare one. If there
+      // is none, our reserved buffer is in flight: wait for its write.
+      for (;;) {
+        if (!itsHoldsReserved) {
+          itsBuffer = itsPool.getReserved();
+          itsBufferReserved = true;
+          itsHoldsReserved = true;
+          break;
+        }
+
+        if ((itsBuffer = itsPool.tryGet()) != 0) {
+          itsBufferReserved = false;
+          break;
+        }
+
+        ASSERT(itsInFlight > 0);
+        reap(1);
+      }
+
+      itsWaitTime.push(1000.0 * (TimeSpec::now() - begin));
+
+      // zeros for a skip() not written yet
+      memset(itsBuffer, 0, itsFill);
+    }
+
+
+    void AsyncFileStream::skip(size_t bytes)
+    {
+      checkError();
+
+      if (itsFill + bytes < itsPool.bufferSize()) {
+        // the skipped region fits in the current buffer
+        if (itsBuffer)
+          memset(itsBuffer + itsFill, 0, bytes);
+
+        itsFill += bytes;
+        return;
+      }
+
+      const off_t newPos = itsBufferOffset + itsFill + bytes;
+
+      // The padding of the current buffer lies in the skipped region.
+      if (itsBuffer)
+        submitCurrent(false);
+
+      // Leave a hole up to the block containing the new position.
+      itsBufferOffset = newPos & ~static_cast<off_t>(AlignedBufferPool::alignment - 1);
+      itsFill = newPos - itsBufferOffset;
+    }
+
+
+    void AsyncFileStream::sync()
+    {
+      checkError();
+
+      // Write the partial buffer, but keep filling it afterwards. It will be
+      // written again when full.
+      if (itsBuffer && itsFill > 0)
+        submitCurrent(true);
+
+      drain();
+      checkError();
+
+      if (fdatasync(fd) < 0)
+        THROW_SYSCALL("fdatasync");
+    }
+
+
+    size_t AsyncFileStream::size()
+    {
+      return itsBufferOffset + itsFill;
+    }
+
+
+    void AsyncFileStream::submitCurrent(bool keep)
+    {
+      const size_t alignment = AlignedBufferPool::alignment;
+      const size_t size = (itsFill + alignment - 1) & ~(alignment - 1);
+
+      memset(itsBuffer + itsFill, 0, size - itsFill);
+
+      if (itsFreeRequests.empty()) {
+        using namespace TimeSpec;
+        const struct timespec begin = TimeSpec::now();
+        reap(1);
+        itsWaitTime.push(1000.0 * (TimeSpec::now() - begin));
+      }
+
+      Request *request = itsFreeRequests.back();
+      request->buffer = itsBuffer;
+      request->size = size;
+      request->offset = itsBufferOffset;
+      request->release = !keep;
+      request->reserved = itsBufferReserved;
+      request->iov.iov_base = itsBuffer;
+      request->iov.iov_len = size;
+      request->submitTime = TimeSpec::now();
+
+      itsQueue->submit(fd, request);
+
+      itsFreeRequests.pop_back();
+      itsInFlight++;
+      itsQueueDepth.push(itsInFlight);
+
+      if (!keep)
+        itsBuffer = 0;
+    }
+
+
+    void AsyncFileStream::reap(unsigned minComplete)
+    {
+      std::vector<AsyncIOQueue::Completion> completions;
+      itsQueue->reap(minComplete, completions);
+
+      using namespace TimeSpec;
+      const struct timespec now = TimeSpec::now();
+
+      for (size_t i = 0; i < completions.size(); ++i) {
+        Request *request = completions[i].request;
+        long result = completions[i].result;
+
+        itsLatency.push(1000.0 * (now - request->submitTime));
+
+        if (result < 0) {
+          if (!itsError)
+            itsError = -result;
+        } else if (static_cast<size_t>(result) < request->size) {
+          finishWrite(*request, result);
+        }
+
+        if (request->release) {
+          itsPool.release(request->buffer, request->reserved);
+
+          if (request->reserved)
+            itsHoldsReserved = false;
+        }
+
+        itsFreeRequests.push_back(request);
+        itsInFlight--;
+      }
+    }
+
+
+    void AsyncFileStream::finishWrite(const Request &request, size_t written)
+    {
+      // The rest of a short write may start at an unaligned offset, which
+      // O_DIRECT rejects. Write it through the page cache.
+      const bool unaligned = itsDirect && written % AlignedBufferPool::alignment != 0;
+      int fdFlags = 0;
+
+      if (unaligned) {
+        fdFlags = fcntl(fd, F_GETFL);
+
+        if (fdFlags < 0 || fcntl(fd, F_SETFL, fdFlags & ~O_DIRECT) < 0) {
+          if (!itsError)
+            itsError = errno;
+          return;
+        }
+      }
+
+      while (written < request.size) {
+        ssize_t n = pwrite(fd, request.buffer + written, request.size - written, request.offset + written);
+
+        if (n <= 0) {
+          if (n < 0 && errno == EINTR)
+            continue;
+
+          if (!itsError)
+            itsError = n < 0 ? errno : EIO;
+          break;
+        }
+
+        written += n;
+      }
+
+      if (unaligned && fcntl(fd, F_SETFL, fdFlags) < 0 && !itsError)
+        itsError = errno;
+    }
+
+
+    void AsyncFileStream::drain()
+    {
+      if (itsInFlight > 0)
+        reap(itsInFlight);
+    }
+
+
+    void AsyncFileStream::checkError() const
+    {
+      if (itsError)
+        throw SystemCallException("write " + itsName, itsError, THROW_ARGS);
+    }
+  }
+}
+
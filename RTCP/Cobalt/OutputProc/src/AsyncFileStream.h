@@ -0,0 +1,157 @@
+//# AsyncFileStream.h: a file writer using asynchronous O_DIRECT writes
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_STORAGE_ASYNCFILESTREAM_H
+#define LOFAR_STORAGE_ASYNCFILESTREAM_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <Stream/FileDescriptorBasedStream.h>
+#include <CoInterface/SmartPtr.h>
+#include <CoInterface/RunningStatistics.h>
+#include "AlignedBufferPool.h"
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+    class AsyncIOQueue;
+
+    // A write-only file stream that collects the data in buffers from an
+    // AlignedBufferPool and writes full buffers asynchronously with O_DIRECT,
+    // keeping up to `queueDepth' writes in flight. A write() thus only
+    // blocks if all writes are in flight, or if the pool has no spare buffer
+    // and the buffer reserved for this stream is in flight. It then waits
+    // for its own writes, never for buffers held by other streams.
+    //
+    // The writes are done with io_uring, or with Linux AIO if io_uring is
+    // not available, or with pwrite() if neither is. Files on file systems
+    // that do not support O_DIRECT are written without it.
+    //
+    // Write errors are reported by the next write(), skip(), sync(), or
+    // by the destructor (which logs them).
+    class AsyncFileStream : public FileDescriptorBasedStream
+    {
+    public:
+      AsyncFileStream(const std::string &name, int flags, int mode,
+                      unsigned queueDepth = 4,
+                      AlignedBufferPool &pool = AlignedBufferPool::shared());
+
+      // Writes the remaining data, waits for all writes, and truncates the
+      // file to its exact size.
+      virtual ~AsyncFileStream();
+
+      virtual size_t tryWrite(const void *ptr, size_t size);
+
+      // Skipped regions read as zeros.
+      virtual void skip(size_t bytes);
+
+      // Writes all data written so far to disk.
+      virtual void sync();
+
+      // The number of bytes written or skipped.
+      virtual size_t size();
+
+      // Name of the I/O method used ("io_uring", "aio" or "pwrite").
+      std::string method() const;
+
+      // Whether the file is written with O_DIRECT.
+      bool direct() const { return itsDirect; }
+
+      // The time between submission and completion of the writes.
+      const RunningStatistics &latency() const { return itsLatency; }
+
+      // The number of writes in flight, sampled at each submission.
+      const RunningStatistics &queueDepth() const { return itsQueueDepth; }
+
+      // The time spent waiting for our writes to free a buffer or a write
+      // slot.
+      const RunningStatistics &waitTime() const { return itsWaitTime; }
+
+      // The data to write in one request.
+      struct Request {
+        char *buffer;
+        size_t size;
+        off_t offset;
+        bool release; // return the buffer to the pool when done
+        bool reserved; // the buffer is the one reserved for this stream
+        struct iovec iov;
+        struct timespec submitTime;
+      };
+
+    private:
+      // we only support writing
+      virtual size_t tryRead(void *, size_t size)
+      {
+        return size;
+      }
+
+      // Gets a buffer from the pool to fill.
+      void getBuffer();
+
+      // Submits the current buffer (padded to the alignment).
+      void submitCurrent(bool keep);
+
+      // Handles completed writes; waits for at least minComplete of them.
+      void reap(unsigned minComplete);
+
+      // Writes the rest of a request after a short write.
+      void finishWrite(const Request &request, size_t written);
+
+      // Waits for all writes in flight.
+      void drain();
+
+      // Throws if a write failed.
+      void checkError() const;
+
+      const std::string itsName;
+      AlignedBufferPool &itsPool;
+      bool itsDirect;
+      SmartPtr<AsyncIOQueue> itsQueue;
+
+      std::vector<Request> itsRequests;
+      std::vector<Request *> itsFreeRequests;
+      unsigned itsInFlight;
+
+      // The buffer being filled. It holds the file region starting at
+      // itsBufferOffset (a multiple of the alignment); itsFill bytes of it
+      // are valid. If itsBuffer is NULL, the first itsFill bytes of the
+      // next buffer are zeros (after a skip).
+      char *itsBuffer;
+      bool itsBufferReserved;
+      off_t itsBufferOffset;
+      size_t itsFill;
+
+      // Whether we hold our reserved buffer (as itsBuffer or in flight).
+      bool itsHoldsReserved;
+
+      int itsError;
+
+      RunningStatistics itsLatency;
+      RunningStatistics itsQueueDepth;
+      RunningStatistics itsWaitTime;
+    };
+  }
+}
+
+#endif
+
@@ -25,7 +25,7 @@
 
 #include <CoInterface/StreamableData.h>
 #include "MSWriter.h"
-#include <Stream/FileStream.h>
+#include "AsyncFileStream.h"
 
 namespace LOFAR
 {
@@ -49,7 +49,7 @@ namespace LOFAR
       virtual size_t getDataSize();
 
     protected:
-      FileStream itsFile;
+      AsyncFileStream itsFile;
     };
 
 
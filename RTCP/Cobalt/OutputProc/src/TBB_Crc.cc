@@ -0,0 +1,281 @@
+//# TBB_Crc.cc: CRC16 and CRC32 computation for TBB frames
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include "TBB_Crc.h"
+
+#include <cstring>
+#include <endian.h>
+
+#if defined __x86_64__ && defined __GNUC__
+#define TBB_CRC_HAVE_CLMUL 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+
+    namespace
+    {
+      const uint32_t crc32Poly = 0x04C11DB7;
+      const uint16_t crc16Poly = 0x8005;
+
+      // x^n mod P(x) for the crc32 polynomial.
+      uint32_t crc32XPow(unsigned n)
+      {
+        uint32_t r = 1;
+        for (unsigned i = 0; i < n; i++) {
+          r = (r & 0x80000000) ? (r << 1) ^ crc32Poly : r << 1;
+        }
+        return r;
+      }
+
+      /*
+       * Slicing-by-8 tables: table[k][i] is the crc of byte i followed by k zero bytes.
+       * Also the folding constants for the carry-less multiplication.
+       */
+      struct CrcTables {
+        uint32_t crc32[8][256];
+        uint16_t crc16[8][256];
+
+        uint64_t k128, k192, k512, k576; // x^n mod P(x)
+
+        bool haveClmul;
+
+        CrcTables()
+        {
+          for (unsigned i = 0; i < 256; i++) {
+            uint32_t c32 = i << 24;
+            uint16_t c16 = i << 8;
+            for (unsigned b = 0; b < 8; b++) {
+              c32 = (c32 & 0x80000000) ? (c32 << 1) ^ crc32Poly : c32 << 1;
+              c16 = (c16 & 0x8000) ? (c16 << 1) ^ crc16Poly : c16 << 1;
+            }
+            crc32[0][i] = c32;
+            crc16[0][i] = c16;
+          }
+
+          for (unsigned k = 1; k < 8; k++) {
+            for (unsigned i = 0; i < 256; i++) {
+              crc32[k][i] = (crc32[k - 1][i] << 8) ^ crc32[0][crc32[k - 1][i] >> 24];
+              crc16[k][i] = (uint16_t)(crc16[k - 1][i] << 8) ^ crc16[0][crc16[k - 1][i] >> 8];
+            }
+          }
+
+          k128 = crc32XPow(128);
+          k192 = crc32XPow(192);
+          k512 = crc32XPow(512);
+          k576 = crc32XPow(576);
+
+#ifdef TBB_CRC_HAVE_CLMUL
+          __builtin_cpu_init();
+          haveClmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#else
+          haveClmul = false;
+#endif
+        }
+      };
+
+      const CrcTables tables;
+
+      /*
+       * Continues crc over nWords byte-swapped words. Each 8 bytes, as a little-endian 64-bit q,
+       * are the stream bytes q[15:8], q[7:0], q[31:24], q[23:16], ..., so the first 4 stream bytes
+       * as a big-endian 32-bit value are the low half of q rotated by 16 bits.
+       */
+      uint32_t crc32Words(uint32_t crc, const unsigned char* p, size_t nWords)
+      {
+        const uint32_t (*t)[256] = tables.crc32;
+
+        for (; nWords >= 4; nWords -= 4, p += 8) {
+          uint64_t q;
+          memcpy(&q, p, sizeof q); // strict-aliasing safe
+          q = le64toh(q);
+
+          const uint32_t lo = (uint32_t)q;
+          crc ^= (lo << 16) | (lo >> 16);
+          crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xff] ^ t[5][(crc >> 8) & 0xff] ^ t[4][crc & 0xff] ^
+                t[3][(q >> 40) & 0xff] ^ t[2][(q >> 32) & 0xff] ^ t[1][q >> 56] ^ t[0][(q >> 48) & 0xff];
+        }
+
+        for (; nWords > 0; nWords--, p += 2) {
+          const uint32_t w = p[0] | (p[1] << 8);
+          crc ^= w << 16;
+          crc = (crc << 16) ^ t[1][crc >> 24] ^ t[0][(crc >> 16) & 0xff];
+        }
+
+        return crc;
+      }
+
+#ifdef TBB_CRC_HAVE_CLMUL
+      /*
+       * x (a 128-bit polynomial, x^127 in the top bit) times x^128 mod P(x), reduced to at most 96 bits.
+       * k holds the constants for x^(128+64) (high) and x^128 (low), or for another distance.
+       */
+      __attribute__((target("pclmul,ssse3")))
+      inline __m128i fold(__m128i x, __m128i k)
+      {
+        return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00));
+      }
+
+      // Loads 16 frame bytes as a 128-bit polynomial, swapping the bytes in each word.
+      __attribute__((target("pclmul,ssse3")))
+      inline __m128i load(const unsigned char* p, __m128i shuffle)
+      {
+        return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), shuffle);
+      }
+#endif
+    } // namespace
+
+
+    uint16_t tbbCrc16(const void* buf, size_t nWords)
+    {
+      const uint16_t (*t)[256] = tables.crc16;
+      const unsigned char* p = static_cast<const unsigned char*>(buf);
+      uint16_t crc = 0;
+
+      // As crc32Words(), but a 16-bit crc only absorbs the first word.
+      for (; nWords >= 4; nWords -= 4, p += 8) {
+        uint64_t q;
+        memcpy(&q, p, sizeof q); // strict-aliasing safe
+        q = le64toh(q);
+
+        crc ^= (uint16_t)q;
+        crc = t[7][crc >> 8] ^ t[6][crc & 0xff] ^ t[5][(q >> 24) & 0xff] ^ t[4][(q >> 16) & 0xff] ^
+              t[3][(q >> 40) & 0xff] ^ t[2][(q >> 32) & 0xff] ^ t[1][q >> 56] ^ t[0][(q >> 48) & 0xff];
+      }
+
+      for (; nWords > 0; nWords--, p += 2) {
+        crc ^= p[0] | (p[1] << 8);
+        crc = t[1][crc >> 8] ^ t[0][crc & 0xff];
+      }
+
+      return crc;
+    }
+
+    uint32_t tbbCrc32Slicing(const void* buf, size_t nWords)
+    {
+      return crc32Words(0, static_cast<const unsigned char*>(buf), nWords);
+    }
+
+#ifdef TBB_CRC_HAVE_CLMUL
+    /*
+     * Folds 4 x 16 bytes per iteration with carry-less multiplications, keeping the
+     * running value congruent to the message mod P(x). The crc of that 128-bit value
+     * equals the crc of the message so far, and the tail continues from there.
+     */
+    __attribute__((target("pclmul,ssse3")))
+    uint32_t tbbCrc32Clmul(const void* buf, size_t nWords)
+    {
+      const unsigned char* p = static_cast<const unsigned char*>(buf);
+      size_t nBytes = nWords * sizeof(int16_t);
+
+      if (nBytes < 128) {
+        return crc32Words(0, p, nWords);
+      }
+
+      // Byte lane k (x^(8k) .. x^(8k+7)) gets stream byte 15-k, which is frame byte (15-k)^1.
+      const __m128i shuffle = _mm_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+      const __m128i k128 = _mm_set_epi64x(tables.k192, tables.k128);
+      const __m128i k512 = _mm_set_epi64x(tables.k576, tables.k512);
+
+      __m128i x0 = load(p +  0, shuffle);
+      __m128i x1 = load(p + 16, shuffle);
+      __m128i x2 = load(p + 32, shuffle);
+      __m128i x3 = load(p + 48, shuffle);
+      p += 64;
+      nBytes -= 64;
+
+      for (; nBytes >= 64; nBytes -= 64, p += 64) {
+        x0 = _mm_xor_si128(fold(x0, k512), load(p +  0, shuffle));
+        x1 = _mm_xor_si128(fold(x1, k512), load(p + 16, shuffle));
+        x2 = _mm_xor_si128(fold(x2, k512), load(p + 32, shuffle));
+        x3 = _mm_xor_si128(fold(x3, k512), load(p + 48, shuffle));
+      }
+
+      x1 = _mm_xor_si128(fold(x0, k128), x1);
+      x2 = _mm_xor_si128(fold(x1, k128), x2);
+      x3 = _mm_xor_si128(fold(x2, k128), x3);
+
+      for (; nBytes >= 16; nBytes -= 16, p += 16) {
+        x3 = _mm_xor_si128(fold(x3, k128), load(p, shuffle));
+      }
+
+      // The crc of x3, most significant byte first.
+      unsigned char bytes[16];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(bytes), x3);
+      uint32_t crc = 0;
+      for (int i = 15; i >= 0; i--) {
+        crc = (crc << 8) ^ tables.crc32[0][(crc >> 24) ^ bytes[i]];
+      }
+
+      return crc32Words(crc, p, nBytes / sizeof(int16_t));
+    }
+#else
+    uint32_t tbbCrc32Clmul(const void* buf, size_t nWords)
+    {
+      return tbbCrc32Slicing(buf, nWords);
+    }
+#endif
+
+    bool tbbCrc32IsAccelerated()
+    {
+      return tables.haveClmul;
+    }
+
+    uint32_t tbbCrc32(const void* buf, size_t nWords)
+    {
+      return tables.haveClmul ? tbbCrc32Clmul(buf, nWords) : tbbCrc32Slicing(buf, nWords);
+    }
+
+    size_t tbbCheckPayloadCrcs(const void* const payloads[], const size_t nTrSamples[],
+                               size_t nPayloads, bool ok[])
+    {
+      const bool haveClmul = tables.haveClmul;
+      size_t nOk = 0;
+
+      for (size_t i = 0; i < nPayloads; i++) {
+        const unsigned char* payload = static_cast<const unsigned char*>(payloads[i]);
+
+        if (i + 1 < nPayloads) {
+          __builtin_prefetch(payloads[i + 1]);
+        }
+
+        uint32_t crc32val;
+        memcpy(&crc32val, &payload[nTrSamples[i] * sizeof(int16_t)], sizeof crc32val); // strict-aliasing safe
+        crc32val = le32toh(crc32val);
+
+        const uint32_t crc = haveClmul ? tbbCrc32Clmul(payload, nTrSamples[i])
+                                       : tbbCrc32Slicing(payload, nTrSamples[i]);
+        ok[i] = crc == crc32val;
+        nOk += ok[i];
+      }
+
+      return nOk;
+    }
+
+  } // namespace Cobalt
+} // namespace LOFAR
+
@@ -0,0 +1,68 @@
+//# TBB_Crc.h: CRC16 and CRC32 computation for TBB frames
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef LOFAR_COBALT_OUTPUTPROC_TBBCRC_H
+#define LOFAR_COBALT_OUTPUTPROC_TBBCRC_H 1
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace LOFAR
+{
+  namespace Cobalt
+  {
+
+    /*
+     * TBB computes its checksums over a frame as a sequence of 16-bit words, most significant byte first,
+     * with initial remainder 0, no final xor, and no bit reflection.
+     * Frames arrive little-endian, so this is a CRC over the frame bytes with the bytes of each word swapped.
+     * The routines below fold that swap into the computation.
+     *
+     * The CRC32 uses carry-less multiplication (PCLMULQDQ) if the CPU supports it, and slicing-by-8 tables otherwise.
+     * The CRC16 (frame header, 43 words) always uses slicing-by-8 tables.
+     */
+
+    // CRC16 (polynomial 0x8005) over nWords little-endian 16-bit words at buf.
+    uint16_t tbbCrc16(const void* buf, size_t nWords);
+
+    // CRC32 (polynomial 0x04C11DB7) over nWords little-endian 16-bit words at buf.
+    uint32_t tbbCrc32(const void* buf, size_t nWords);
+
+    /*
+     * Checks the crc32 of nPayloads transient payloads in one call.
+     * Payload i holds nTrSamples[i] int16_t samples, directly followed by the little-endian crc32.
+     * Sets ok[i] to whether payload i is valid. Returns the number of valid payloads.
+     */
+    size_t tbbCheckPayloadCrcs(const void* const payloads[], const size_t nTrSamples[],
+                               size_t nPayloads, bool ok[]);
+
+    // Whether tbbCrc32() uses PCLMULQDQ on this CPU.
+    bool tbbCrc32IsAccelerated();
+
+    // The CRC32 implementations behind tbbCrc32(), for testing and benchmarking.
+    // tbbCrc32Clmul() may only be called if tbbCrc32IsAccelerated().
+    uint32_t tbbCrc32Slicing(const void* buf, size_t nWords);
+    uint32_t tbbCrc32Clmul(const void* buf, size_t nWords);
+
+  } // namespace Cobalt
+} // namespace LOFAR
+
+#endif // LOFAR_COBALT_OUTPUTPROC_TBBCRC_H
+
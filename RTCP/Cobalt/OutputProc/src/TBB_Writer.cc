@@ -57,6 +57,7 @@
 #include <Stream/StreamFactory.h>
 #include <CoInterface/Exceptions.h>
 #include <OutputProc/CommonLofarAttributes.h>
+#include <OutputProc/TBB_Crc.h>
 
 #include <dal/lofar/StationNames.h>
 
@@ -234,7 +235,7 @@ namespace LOFAR
       }
     }
 
-    void TBB_Dipole::processTransientFrameData(const TBB_Frame& frame)
+    void TBB_Dipole::processTransientFrameData(const TBB_Frame& frame, bool crcOk)
     {
       /*
        * Out-of-order or duplicate frames are very unlikely in the LOFAR TBB setup,
@@ -275,9 +276,9 @@ namespace LOFAR
 
       /*
        * On a data checksum error, flag these samples.
-       * Flag zeroed payloads too, as incredibly unlikely to be correct (unless wave generator used and set to zero amp (pointless)), but not rejected by crc32tbb.
+       * Flag zeroed payloads too, as incredibly unlikely to be correct (unless wave generator used and set to zero amp (pointless)), but not rejected by the crc32.
        */
-      if (!crc32tbb(&frame.payload, frame.header.nOfSamplesPerFrame)) {
+      if (!crcOk) {
         appendFlags(offset, frame.header.nOfSamplesPerFrame);
         uint32_t crc32;
         memcpy(&crc32, &frame.payload.data[frame.header.nOfSamplesPerFrame], sizeof crc32); // strict-aliasing safe
@@ -332,13 +333,13 @@ namespace LOFAR
 
       /*
        * On a data checksum error, flag these samples.
-       * Flag zeroed payloads too, as incredibly unlikely to be correct (unless wave generator used and set to zero amp (pointless)), but not rejected by crc32tbb.
+       * Flag zeroed payloads too, as incredibly unlikely to be correct (unless wave generator used and set to zero amp (pointless)), but not rejected by the crc32.
        *
        * TBB Design Doc states the crc32 is computed for transient data only, but it is also valid for spectral data.
        * Except that it looks invalid for the first spectral frame each second, so skip checking those. // TODO: enable 'sliceNr != 0 && ' below after verifying with recent real data
        */
       unsigned nSamplesPerSubband = frame.header.nOfSamplesPerFrame / itsNrSubbands; // any remainder is zeroed until the crc32
-      if (0/*sliceNr != 0 && */ /*!crc32tbb(&frame.payload, 2 * MAX_TBB_SPECTRAL_NSAMPLES)*/) {
+      if (0/*sliceNr != 0 && */ /*tbbCrc32(frame.payload.data, 2 * MAX_TBB_SPECTRAL_NSAMPLES) != crc32*/) {
         appendFlags(offset, nSamplesPerSubband);
         uint32_t crc32;
         memcpy(&crc32, &frame.payload.data[2 * MAX_TBB_SPECTRAL_NSAMPLES], sizeof crc32); // strict-aliasing safe
@@ -622,7 +623,7 @@ namespace LOFAR
       return rawFilename;
     }
 
-    void TBB_Station::processPayload(const TBB_Frame& frame)
+    void TBB_Station::processPayload(const TBB_Frame& frame, bool payloadCrcOk)
     {
       // Guard against bogus incoming rsp/rcu IDs with at().
       TBB_Dipole& dipole(itsDipoles.at(frame.header.rspID * NR_RCUS_PER_RSPBOARD + frame.header.rcuID));
@@ -636,7 +637,7 @@ namespace LOFAR
       }
 
       if (itsSubbandInfo.centralFreqs.empty()) { // transient mode
-        dipole.processTransientFrameData(frame);
+        dipole.processTransientFrameData(frame, payloadCrcOk);
       } else { // spectral mode
         dipole.processSpectralFrameData(frame, itsSubbandInfo);
       }
@@ -867,49 +868,9 @@ namespace LOFAR
      * Assumes that the seqNr field in the TBB_Frame at buf has been zeroed.
      * Takes a ptr to a complete header. (Drop too small frames earlier.)
      */
-    bool TBB_StreamWriter::crc16tbb(const TBB_Header* header)
+    bool TBB_StreamWriter::crc16tbb(const TBB_Header* header) const
     {
-      itsCrc16gen.reset();
-
-      const char* ptr = reinterpret_cast<const char*>(header); // to char* for strict-aliasing
-      for (unsigned i = 0; i < sizeof(*header) - sizeof(header->crc16); i += 2) {
-        int16_t val;
-        memcpy(&val, &ptr[i], sizeof val); // strict-aliasing safe
-        val = __bswap_16(val);
-        itsCrc16gen.process_bytes(&val, sizeof val);
-      }
-
-      // It is also possible to process header->crc16 and see if checksum() equals 0.
-      uint16_t crc16val = header->crc16;
-#if __BYTE_ORDER == __BIG_ENDIAN
-      crc16val = __bswap_16(crc16val);
-#endif
-      return itsCrc16gen.checksum() == crc16val;
-    }
-
-    /*
-     * Note: The nTrSamples arg is without the space taken by the crc32 in payload (drop too small frames earlier)
-     * and in terms of the transient sample size, i.e. sizeof(int16_t).
-     */
-    bool TBB_Dipole::crc32tbb(const TBB_Payload* payload, size_t nTrSamples)
-    {
-      itsCrc32gen.reset();
-
-      const char* ptr = reinterpret_cast<const char*>(payload->data); // to char* for strict-aliasing
-      for (unsigned i = 0; i < nTrSamples * sizeof(int16_t); i += 2) {
-        int16_t val;
-        memcpy(&val, &ptr[i], sizeof val); // strict-aliasing safe
-        val = __bswap_16(val);
-        itsCrc32gen.process_bytes(&val, sizeof val);
-      }
-
-      // It is also possible to process crc32val and see if checksum() equals 0.
-      uint32_t crc32val;
-      memcpy(&crc32val, &ptr[nTrSamples * sizeof(int16_t)], sizeof crc32val); // idem
-#if __BYTE_ORDER == __BIG_ENDIAN
-      crc32val = __bswap_32(crc32val);
-#endif
-      return itsCrc32gen.checksum() == crc32val;
+      return tbbCrc16(header, (sizeof(*header) - sizeof(header->crc16)) / sizeof(int16_t)) == le16toh(header->crc16);
     }
 
     /*
@@ -1038,50 +999,86 @@ namespace LOFAR
 
     void TBB_StreamWriter::mainOutputLoop()
     {
+      TBB_Frame* frames[frameBatchSize];
+      const void* payloads[frameBatchSize];
+      size_t nTrSamples[frameBatchSize];
+      bool crcOk[frameBatchSize];
+
       bool running = true;
       while (running) {
-        TBB_Frame* frame;
+        /*
+         * Take the frames available (at least 1), to check their payload crcs in one go.
+         * A NULL frame notifies us that input is done: process the frames before it, then stop.
+         */
+        size_t nFrames = 0;
+        bool lastBatch = false;
         try {
-          frame = NULL;
-          frame = itsReceiveQueue.remove();
-          if (frame == NULL) {
-            itsOutExitStatus = 0;
-            break;
-          }
+          do {
+            TBB_Frame* frame = itsReceiveQueue.remove();
+            if (frame == NULL) {
+              lastBatch = true;
+              break;
+            }
+            frames[nFrames++] = frame;
+          } while (nFrames < frameBatchSize && !itsReceiveQueue.empty());
+        } catch (exception& exc) {
+          LOG_FATAL_STR(itsLogPrefix << exc.what());
+          running = false;
+        }
 
 #ifdef TBB_PRINT_QUEUE_LEN
-          LOG_INFO_STR(itsLogPrefix << "recvqsz=" << itsReceiveQueue.size());
+        LOG_INFO_STR(itsLogPrefix << "recvqsz=" << itsReceiveQueue.size() << " batch=" << nFrames);
 #endif
 
-          TBB_Station* station = itsWriter.getStation(frame->header);
-          station->processPayload(*frame);
-
-          // Tolerate the following exceptions. Maybe next rsp/rcu is ok; probably fatal too...
-        } catch (SystemCallException& exc) {
-          LOG_WARN_STR(itsLogPrefix << exc);
-        } catch (StorageException& exc) {
-          LOG_WARN_STR(itsLogPrefix << exc);
-        } catch (dal::DALException& exc) {
-          LOG_WARN_STR(itsLogPrefix << exc.what());
-        } catch (out_of_range& exc) {
-          LOG_WARN_STR(itsLogPrefix << exc.what());
-        } catch (Exception& exc) {
-          // Config/parset errors are fatal.
-          LOG_FATAL_STR(itsLogPrefix << exc);
-          running = false;
-        } catch (exception& exc) {
-          // Other errors are fatal.
-          LOG_FATAL_STR(itsLogPrefix << exc.what());
-          running = false;
+        /*
+         * Whether a frame is transient or spectral data is decided by the station (from the parset), not by the frame header.
+         * So check all payloads as transient data. processPayload() only uses the result in transient mode.
+         */
+        for (size_t i = 0; i < nFrames; i++) {
+          payloads[i] = frames[i]->payload.data;
+          nTrSamples[i] = frames[i]->header.nOfSamplesPerFrame;
         }
+        tbbCheckPayloadCrcs(payloads, nTrSamples, nFrames, crcOk);
+
+        for (size_t i = 0; i < nFrames; i++) {
+          if (running) {
+            try {
+              TBB_Station* station = itsWriter.getStation(frames[i]->header);
+              station->processPayload(*frames[i], crcOk[i]);
+
+              // Tolerate the following exceptions. Maybe next rsp/rcu is ok; probably fatal too...
+            } catch (SystemCallException& exc) {
+              LOG_WARN_STR(itsLogPrefix << exc);
+            } catch (StorageException& exc) {
+              LOG_WARN_STR(itsLogPrefix << exc);
+            } catch (dal::DALException& exc) {
+              LOG_WARN_STR(itsLogPrefix << exc.what());
+            } catch (out_of_range& exc) {
+              LOG_WARN_STR(itsLogPrefix << exc.what());
+            } catch (Exception& exc) {
+              // Config/parset errors are fatal.
+              LOG_FATAL_STR(itsLogPrefix << exc);
+              running = false;
+            } catch (exception& exc) {
+              // Other errors are fatal.
+              LOG_FATAL_STR(itsLogPrefix << exc.what());
+              running = false;
+            }
+          }
 
-        if (frame != NULL) {
           try {
-            itsFreeQueue.append(frame);
+            itsFreeQueue.append(frames[i]);
           } catch (exception& exc) {
             LOG_WARN_STR(itsLogPrefix << "may have lost a frame buffer (2): " << exc.what());
           }
         }
+
+        if (lastBatch) {
+          if (running) {
+            itsOutExitStatus = 0;
+          }
+          running = false;
+        }
       }
     }
 
@@ -26,7 +26,6 @@
 #include <string>
 #include <vector>
 #include <map>
-#include <boost/crc.hpp>
 
 #include <Common/LofarTypes.h>
 #ifndef USE_THREADS
@@ -158,10 +157,6 @@ namespace LOFAR
       };
       ssize_t itsDatasetLen;
 
-      // Same truncated polynomial as standard crc32, but with initial_remainder=0, final_xor_value=0, reflected_input=false, reflected_remainder_output=false.
-      // The boost::crc_optimal<> declarations precompute lookup tables, so do not declare inside the checking routine. (Still, for every TBB_Dipole...)
-      boost::crc_optimal<32, 0x04C11DB7 /*, 0, 0, false, false*/> itsCrc32gen;
-
       // do not use
       TBB_Dipole& operator=(const TBB_Dipole& rhs);
 
@@ -178,7 +173,8 @@ namespace LOFAR
                 const SubbandInfo& subbandInfo, const std::string& rawFilename, dal::TBB_Station& station,
                 Mutex& h5Mutex);
 
-      void processTransientFrameData(const TBB_Frame& frame);
+      // crcOk: whether the payload crc32 is valid (checked per batch by the output thread, see tbbCheckPayloadCrcs())
+      void processTransientFrameData(const TBB_Frame& frame, bool crcOk);
       void processSpectralFrameData(const TBB_Frame& frame, const SubbandInfo& subbandInfo);
 
     private:
@@ -188,7 +184,6 @@ namespace LOFAR
                                  const StationMetaData& stationMetaData, const SubbandInfo& subbandInfo,
                                  const std::string& rawFilename, dal::TBB_Station& station);
       bool hasAllZeroDataSamples(const TBB_Payload& payload, size_t nTrSamples) const;
-      bool crc32tbb(const TBB_Payload* payload, size_t nTrSamples);
     };
 
     class TBB_Station
@@ -219,7 +214,8 @@ namespace LOFAR
       ~TBB_Station();
 
       // Output threads
-      void processPayload(const TBB_Frame& frame);
+      // payloadCrcOk: whether the payload crc32 is valid as transient data (only used in transient mode)
+      void processPayload(const TBB_Frame& frame, bool payloadCrcOk);
 
     private:
       void initTBB_RootAttributesAndGroups(const std::string& stName);
@@ -246,6 +242,9 @@ namespace LOFAR
        */
       static const unsigned nrFrameBuffers = 1024;
 
+      // Max nr of frames the output thread takes from the queue to check the payload crcs of in one go.
+      static const unsigned frameBatchSize = 64;
+
       TBB_Frame* itsFrameBuffers;
 
       // Queue pointers point into itsFrameBuffers.
@@ -263,8 +262,6 @@ namespace LOFAR
       // Inflate struct timeval to 64 bytes (typical LEVEL1_DCACHE_LINESIZE). Unnecessary...
       struct timeval itsTimeoutStamp __attribute__((aligned(64)));
 
-      boost::crc_optimal<16, 0x8005 /*, 0, 0, false, false*/> itsCrc16gen;
-
 #ifdef TBB_DUMP_RAW_STATION_FRAMES
       LOFAR::FileStream* itsRawStationData;
 #endif
@@ -291,7 +288,7 @@ namespace LOFAR
       // Input threads
       void frameHeaderLittleToHost(TBB_Header& fh) const;
       void correctSampleNr(TBB_Header& header) const;
-      bool crc16tbb(const TBB_Header* header);
+      bool crc16tbb(const TBB_Header* header) const;
       void processHeader(TBB_Header& header, size_t recvPayloadSize);
       void mainInputLoop();
 
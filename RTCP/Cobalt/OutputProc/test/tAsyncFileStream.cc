@@ -0,0 +1,277 @@
+//# tAsyncFileStream.cc: Test AsyncFileStream class
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <Common/LofarLogger.h>
+#include <Stream/FileStream.h>
+#include <OutputProc/AsyncFileStream.h>
+
+using namespace std;
+using namespace LOFAR;
+using namespace LOFAR::Cobalt;
+
+class TempFile
+{
+public:
+  TempFile( const string &dirname = "/tmp/")
+  {
+    char templ[1024];
+    snprintf(templ, sizeof templ, "%stAsyncFileStreamXXXXXX", dirname.c_str());
+
+    fd = mkstemp(templ);
+
+    filename = templ;
+  }
+  ~TempFile()
+  {
+    if (filename != "") {
+      close(fd);
+      (void)unlink(filename.c_str());
+    }
+  }
+
+  string filename;
+private:
+  int fd;
+};
+
+size_t filesize(const string &filename)
+{
+  struct stat s;
+
+  if (stat(filename.c_str(), &s) < 0)
+    return 0;
+
+  return s.st_size;
+}
+
+vector<char> contents(const string &filename)
+{
+  vector<char> buf(filesize(filename));
+
+  if (!buf.empty()) {
+    FileStream s(filename, O_RDONLY, 0);
+    s.read(&buf[0], buf.size());
+  }
+
+  return buf;
+}
+
+const int flags = O_RDWR | O_CREAT | O_TRUNC;
+const int mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+
+// small buffers, to test writes spanning several of them
+AlignedBufferPool pool(4, 2 * AlignedBufferPool::alignment);
+
+void test_smallwrite( size_t bytes )
+{
+  printf("test_smallwrite(%lu)\n", bytes);
+
+  TempFile tmpfile;
+
+  vector<char> buf(bytes + 1);
+
+  for (size_t i = 0; i < bytes; ++i)
+    buf[i] = i % 256;
+
+  {
+    AsyncFileStream s(tmpfile.filename, flags, mode, 2, pool);
+    s.write(&buf[0], bytes);
+    assert(s.size() == bytes);
+  }
+
+  vector<char> result = contents(tmpfile.filename);
+
+  assert(result.size() == bytes);
+
+  for (size_t i = 0; i < bytes; ++i)
+    assert(result[i] == buf[i]);
+}
+
+void test_skip( size_t bytes1, size_t skip, size_t bytes2 )
+{
+  printf("test_skip(%lu, %lu, %lu)\n", bytes1, skip, bytes2);
+
+  TempFile tmpfile;
+
+  vector<char> buf1(bytes1 + 1, 1);
+  vector<char> buf2(bytes2 + 1, 2);
+
+  {
+    AsyncFileStream s(tmpfile.filename, flags, mode, 1, pool);
+    s.write(&buf1[0], bytes1);
+    s.skip(skip);
+    s.write(&buf2[0], bytes2);
+  }
+
+  vector<char> result = contents(tmpfile.filename);
+
+  assert(result.size() == bytes1 + skip + bytes2);
+
+  for (size_t i = 0; i < result.size(); ++i)
+    assert(result[i] == (i < bytes1 ? 1 : i < bytes1 + skip ? 0 : 2));
+}
+
+void test_sync()
+{
+  printf("test_sync()\n");
+
+  TempFile tmpfile;
+
+  const size_t bytes = AlignedBufferPool::alignment + 100;
+  vector<char> buf(bytes, 3);
+
+  AsyncFileStream s(tmpfile.filename, flags, mode, 2, pool);
+  s.write(&buf[0], bytes);
+  s.sync();
+
+  // synced data is on disk (with padding) while the stream is open
+  vector<char> result = contents(tmpfile.filename);
+  assert(result.size() >= bytes);
+  for (size_t i = 0; i < bytes; ++i)
+    assert(result[i] == 3);
+
+  // the partial block is rewritten after sync
+  s.write(&buf[0], bytes);
+  s.sync();
+  result = contents(tmpfile.filename);
+  assert(result.size() >= 2 * bytes);
+  for (size_t i = 0; i < 2 * bytes; ++i)
+    assert(result[i] == 3);
+}
+
+void test_manystreams()
+{
+  printf("test_manystreams()\n");
+
+  // the streams need more buffers than available
+  const size_t nrStreams = 3;
+  const size_t bytes = 5 * pool.bufferSize() + 123;
+
+  TempFile tmpfiles[nrStreams];
+  vector<char> buf(bytes);
+
+  for (size_t i = 0; i < bytes; ++i)
+    buf[i] = i % 251;
+
+  {
+    vector< SmartPtr<AsyncFileStream> > streams(nrStreams);
+
+    for (size_t i = 0; i < nrStreams; ++i)
+      streams[i] = new AsyncFileStream(tmpfiles[i].filename, flags, mode, 2, pool);
+
+    // interleave the writes
+    for (size_t pos = 0; pos < bytes; pos += 1000)
+      for (size_t i = 0; i < nrStreams; ++i) {
+        streams[i]->write(&buf[pos], min<size_t>(1000, bytes - pos));
+
+        if (pos % pool.bufferSize() < 1000)
+          streams[i]->sync();
+      }
+
+    cout << "method: " << streams[0]->method()
+         << ", O_DIRECT: " << streams[0]->direct()
+         << ", latency: " << streams[0]->latency() << endl;
+  }
+
+  for (size_t i = 0; i < nrStreams; ++i)
+    assert(contents(tmpfiles[i].filename) == buf);
+}
+
+void test_idlestreams()
+{
+  printf("test_idlestreams()\n");
+
+  // More streams than spare buffers, that all keep a partially filled buffer
+  // while the others write. This must not wait for the idle streams.
+  AlignedBufferPool smallPool(1, 2 * AlignedBufferPool::alignment);
+
+  const size_t nrStreams = 6;
+  const size_t bytes = 4 * smallPool.bufferSize() + 100;
+
+  TempFile tmpfiles[nrStreams];
+  vector<char> buf(bytes);
+
+  for (size_t i = 0; i < bytes; ++i)
+    buf[i] = i % 241;
+
+  {
+    vector< SmartPtr<AsyncFileStream> > streams(nrStreams);
+
+    for (size_t i = 0; i < nrStreams; ++i) {
+      streams[i] = new AsyncFileStream(tmpfiles[i].filename, flags, mode, 2, smallPool);
+      streams[i]->write(&buf[0], 100);
+    }
+
+    for (size_t i = 0; i < nrStreams; ++i)
+      streams[i]->write(&buf[100], bytes - 100);
+  }
+
+  // the pool grew by a buffer per stream
+  assert(smallPool.nrBuffers() == 1 + nrStreams);
+
+  for (size_t i = 0; i < nrStreams; ++i)
+    assert(contents(tmpfiles[i].filename) == buf);
+}
+
+int main()
+{
+  INIT_LOGGER("tAsyncFileStream");
+
+  const size_t blocksize = AlignedBufferPool::alignment;
+  const size_t buffersize = pool.bufferSize();
+
+  // test write()
+  test_smallwrite( 0 );
+  test_smallwrite( 1 );
+  test_smallwrite( blocksize );
+  test_smallwrite( blocksize - 1 );
+  test_smallwrite( blocksize + 1 );
+  test_smallwrite( buffersize );
+  test_smallwrite( buffersize + 1 );
+  test_smallwrite( 409 * 16 * 4 );
+
+  // test write() + skip() + write()
+  size_t values[] = {0, 1, blocksize - 1, blocksize, blocksize + 1, buffersize, 3 * buffersize + 1};
+  size_t numvalues = sizeof values / sizeof values[0];
+
+  for (unsigned bytes1 = 0; bytes1 < numvalues; bytes1++)
+    for (unsigned skip = 0; skip < numvalues; skip++)
+      for (unsigned bytes2 = 0; bytes2 < numvalues; bytes2++)
+        test_skip(values[bytes1], values[skip], values[bytes2]);
+
+  test_sync();
+  test_manystreams();
+  test_idlestreams();
+
+  return 0;
+}
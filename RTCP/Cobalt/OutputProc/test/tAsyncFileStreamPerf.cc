@@ -0,0 +1,145 @@
+//# tAsyncFileStreamPerf.cc: Compare the write throughput of the file streams
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+#include <Common/LofarLogger.h>
+#include <Stream/FileStream.h>
+#include <CoInterface/SmartPtr.h>
+#include <OutputProc/FastFileStream.h>
+#include <OutputProc/AsyncFileStream.h>
+
+using namespace LOFAR;
+using namespace Cobalt;
+using namespace std;
+
+// Writes nrStreams files concurrently, one thread per file as in a
+// SubbandWriter, using FileStream, FastFileStream and AsyncFileStream.
+//
+// Usage: tAsyncFileStreamPerf [nrStreams [MBperStream [dir]]]
+
+// size of one block of a subband, as written by an MSWriter
+const size_t blockSize = 256 * 1024 + 512;
+
+const int flags = O_RDWR | O_CREAT | O_TRUNC;
+const int mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+
+string fileName(const string &dir, size_t stream)
+{
+  ostringstream name;
+  name << dir << "/tAsyncFileStreamPerf." << getpid() << "." << stream;
+  return name.str();
+}
+
+template<typename StreamT> StreamT *create(const string &name)
+{
+  return new StreamT(name, flags, mode);
+}
+
+template<typename StreamT> void report(StreamT &)
+{
+}
+
+void report(AsyncFileStream &stream)
+{
+  cout << "    method " << stream.method() << (stream.direct() ? " with O_DIRECT" : "") << endl
+       << "    latency " << stream.latency() << endl
+       << "    queue depth " << stream.queueDepth() << endl
+       << "    waited " << stream.waitTime() << endl;
+}
+
+// Returns the total throughput, in MB/s.
+template<typename StreamT>
+double throughput(const string &dir, size_t nrStreams, size_t nrBlocks)
+{
+  vector<char> block(blockSize, 42);
+
+  const double start = omp_get_wtime();
+
+# pragma omp parallel for num_threads(nrStreams)
+  for (size_t s = 0; s < nrStreams; ++s) {
+    SmartPtr<StreamT> stream = create<StreamT>(fileName(dir, s));
+
+    for (size_t b = 0; b < nrBlocks; ++b)
+      stream->write(&block[0], block.size());
+
+    if (s == 0) {
+#     pragma omp critical (cout)
+      report(*stream);
+    }
+  }
+
+  const double elapsed = omp_get_wtime() - start;
+
+  for (size_t s = 0; s < nrStreams; ++s)
+    (void)unlink(fileName(dir, s).c_str());
+
+  return nrStreams * nrBlocks * blockSize / elapsed / 1e6;
+}
+
+
+template<typename StreamT>
+void measure(const string &name, const string &dir, size_t nrStreams, size_t nrBlocks)
+{
+  cout << name << ":" << endl;
+
+  const double MBps = throughput<StreamT>(dir, nrStreams, nrBlocks);
+
+  cout << "    " << fixed << setprecision(1) << MBps << " MB/s" << endl;
+}
+
+
+int main(int argc, char **argv)
+{
+  INIT_LOGGER("tAsyncFileStreamPerf");
+
+  const size_t nrStreams   = argc > 1 ? atoi(argv[1]) : 4;
+  const size_t MBperStream = argc > 2 ? atoi(argv[2]) : 16;
+  const string dir         = argc > 3 ? argv[3] : ".";
+
+  const size_t nrBlocks = MBperStream * 1024 * 1024 / blockSize + 1;
+
+  cout << "Writing " << nrStreams << " streams of " << nrBlocks << " blocks of "
+       << blockSize << " bytes to " << dir << endl;
+
+  try {
+    measure<FileStream>("FileStream", dir, nrStreams, nrBlocks);
+    measure<FastFileStream>("FastFileStream", dir, nrStreams, nrBlocks);
+    measure<AsyncFileStream>("AsyncFileStream", dir, nrStreams, nrBlocks);
+  } catch (Exception &ex) {
+    cout << "Unexpected exception: " << ex << endl;
+    return 1;
+  }
+
+  return 0;
+}
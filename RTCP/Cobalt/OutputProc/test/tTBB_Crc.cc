@@ -0,0 +1,129 @@
+//# tTBB_Crc.cc: Test the TBB frame CRC routines against boost::crc
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <vector>
+#include <endian.h>
+#include <boost/crc.hpp>
+
+#include <OutputProc/TBB_Crc.h>
+
+using namespace std;
+using namespace LOFAR;
+using namespace LOFAR::Cobalt;
+
+// The previous TBB_Writer implementation: byte swap each word and feed it to boost.
+uint16_t refCrc16(const unsigned char* p, size_t nWords)
+{
+  boost::crc_optimal<16, 0x8005> gen;
+  for (size_t i = 0; i < nWords; i++) {
+    unsigned char val[2] = { p[2 * i + 1], p[2 * i] };
+    gen.process_bytes(val, sizeof val);
+  }
+  return gen.checksum();
+}
+
+uint32_t refCrc32(const unsigned char* p, size_t nWords)
+{
+  boost::crc_optimal<32, 0x04C11DB7> gen;
+  for (size_t i = 0; i < nWords; i++) {
+    unsigned char val[2] = { p[2 * i + 1], p[2 * i] };
+    gen.process_bytes(val, sizeof val);
+  }
+  return gen.checksum();
+}
+
+void test_crc(const vector<unsigned char>& buf)
+{
+  printf("test_crc(): CRC32 %s PCLMULQDQ\n", tbbCrc32IsAccelerated() ? "with" : "without");
+
+  // all lengths up to beyond a transient frame, at all offsets mod 16
+  for (size_t nWords = 0; nWords <= 1300; nWords++) {
+    for (size_t offset = 0; offset < 16; offset++) {
+      const unsigned char* p = &buf[offset];
+      const uint32_t ref = refCrc32(p, nWords);
+
+      assert(tbbCrc32Slicing(p, nWords) == ref);
+      if (tbbCrc32IsAccelerated()) {
+        assert(tbbCrc32Clmul(p, nWords) == ref);
+      }
+      assert(tbbCrc32(p, nWords) == ref);
+
+      if (nWords <= 100) {
+        assert(tbbCrc16(p, nWords) == refCrc16(p, nWords));
+      }
+    }
+  }
+}
+
+void test_check_payloads(const vector<unsigned char>& buf)
+{
+  printf("test_check_payloads()\n");
+
+  const size_t nPayloads = 16;
+  const size_t nTrSamples = 1024;
+  vector<vector<unsigned char> > payloads(nPayloads, vector<unsigned char>(nTrSamples * 2 + 4));
+  const void* ptrs[nPayloads];
+  size_t sizes[nPayloads];
+  bool ok[nPayloads];
+
+  for (size_t i = 0; i < nPayloads; i++) {
+    memcpy(&payloads[i][0], &buf[i], nTrSamples * 2);
+    uint32_t crc = htole32(refCrc32(&payloads[i][0], nTrSamples));
+    memcpy(&payloads[i][nTrSamples * 2], &crc, sizeof crc);
+
+    ptrs[i] = &payloads[i][0];
+    sizes[i] = nTrSamples;
+  }
+
+  assert(tbbCheckPayloadCrcs(ptrs, sizes, nPayloads, ok) == nPayloads);
+  for (size_t i = 0; i < nPayloads; i++) {
+    assert(ok[i]);
+  }
+
+  // corrupt a sample, a crc, and pretend a payload is shorter
+  payloads[3][100] ^= 0x10;
+  payloads[7][nTrSamples * 2 + 3] ^= 0x01;
+  sizes[11] = nTrSamples - 1;
+
+  assert(tbbCheckPayloadCrcs(ptrs, sizes, nPayloads, ok) == nPayloads - 3);
+  for (size_t i = 0; i < nPayloads; i++) {
+    assert(ok[i] == (i != 3 && i != 7 && i != 11));
+  }
+}
+
+int main()
+{
+  vector<unsigned char> buf(4096);
+  srand(42);
+  for (size_t i = 0; i < buf.size(); i++) {
+    buf[i] = rand();
+  }
+
+  test_crc(buf);
+  test_check_payloads(buf);
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+//# tTBB_CrcPerf.cc: Measure the TBB frame CRC throughput
+//# Copyright (C) 2016  ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O. Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <boost/crc.hpp>
+
+#include <OutputProc/TBB_Crc.h>
+
+using namespace LOFAR;
+using namespace Cobalt;
+using namespace std;
+
+// Compares the frame checking rate of the previous boost::crc based
+// implementation with the slicing-by-8 and PCLMULQDQ ones, for transient
+// frames (1024 samples), against the frame rate of 48 dipoles dumped at the
+// 200 MHz sample rate.
+//
+// Usage: tTBB_CrcPerf [nrFrames]
+
+const size_t nTrSamples = 1024;
+const size_t frameSize = 88 + nTrSamples * sizeof(int16_t) + sizeof(uint32_t);
+const size_t batchSize = 64;
+const double dumpRate = 48 * 200e6 / nTrSamples; // frames/s
+
+double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// Checks nrFrames frames one at a time.
+template<typename CheckT>
+double frameRate(const vector<unsigned char>& frames, size_t nrFrames, CheckT check)
+{
+  const size_t nrBufFrames = frames.size() / frameSize;
+  size_t nOk = 0;
+
+  const double start = now();
+  for (size_t i = 0; i < nrFrames; i++) {
+    nOk += check(&frames[(i % nrBufFrames) * frameSize]);
+  }
+  const double rate = nrFrames / (now() - start);
+
+  if (nOk != nrFrames) {
+    cerr << "Unexpected crc failures: " << nrFrames - nOk << endl;
+    exit(1);
+  }
+  return rate;
+}
+
+bool checkBoost(const unsigned char* frame)
+{
+  boost::crc_optimal<16, 0x8005> gen16;
+  for (size_t i = 0; i < 86; i += 2) {
+    unsigned char val[2] = { frame[i + 1], frame[i] };
+    gen16.process_bytes(val, sizeof val);
+  }
+
+  boost::crc_optimal<32, 0x04C11DB7> gen32;
+  for (size_t i = 0; i < nTrSamples * sizeof(int16_t); i += 2) {
+    unsigned char val[2] = { frame[88 + i + 1], frame[88 + i] };
+    gen32.process_bytes(val, sizeof val);
+  }
+
+  uint16_t crc16;
+  uint32_t crc32;
+  memcpy(&crc16, &frame[86], sizeof crc16);
+  memcpy(&crc32, &frame[88 + nTrSamples * sizeof(int16_t)], sizeof crc32);
+  return gen16.checksum() == crc16 && gen32.checksum() == crc32;
+}
+
+template<uint32_t (*crc32)(const void*, size_t)>
+bool check(const unsigned char* frame)
+{
+  uint16_t crc16;
+  uint32_t crc32val;
+  memcpy(&crc16, &frame[86], sizeof crc16);
+  memcpy(&crc32val, &frame[88 + nTrSamples * sizeof(int16_t)], sizeof crc32val);
+  return tbbCrc16(frame, 43) == crc16 && crc32(&frame[88], nTrSamples) == crc32val;
+}
+
+// Checks nrFrames frames in batches, as the TBB_Writer output thread does.
+double batchFrameRate(const vector<unsigned char>& frames, size_t nrFrames)
+{
+  const size_t nrBufFrames = frames.size() / frameSize;
+  const void* payloads[batchSize];
+  size_t sizes[batchSize];
+  bool ok[batchSize];
+  size_t nOk = 0;
+
+  const double start = now();
+  for (size_t i = 0; i < nrFrames; i += batchSize) {
+    const size_t n = min(batchSize, nrFrames - i);
+    for (size_t j = 0; j < n; j++) {
+      const unsigned char* frame = &frames[((i + j) % nrBufFrames) * frameSize];
+      uint16_t crc16;
+      memcpy(&crc16, &frame[86], sizeof crc16);
+      nOk -= tbbCrc16(frame, 43) != crc16; // header, as in the input thread
+      payloads[j] = &frame[88];
+      sizes[j] = nTrSamples;
+    }
+    nOk += tbbCheckPayloadCrcs(payloads, sizes, n, ok); // payloads, as in the output thread
+  }
+  const double rate = nrFrames / (now() - start);
+
+  if (nOk != nrFrames) {
+    cerr << "Unexpected crc failures: " << nrFrames - nOk << endl;
+    exit(1);
+  }
+  return rate;
+}
+
+void report(const string& name, double rate)
+{
+  cout << setw(22) << name << setw(14) << fixed << setprecision(0) << rate << " frames/s"
+       << setw(10) << setprecision(2) << rate / dumpRate << " x 48-dipole dump rate" << endl;
+}
+
+int main(int argc, char** argv)
+{
+  const size_t nrFrames = argc > 1 ? atoi(argv[1]) : 200000;
+
+  // 1024 random frames with valid crcs (4 MB, beyond most L2 caches, like a frame queue)
+  const size_t nrBufFrames = 1024;
+  vector<unsigned char> frames(nrBufFrames * frameSize);
+  srand(1);
+  for (size_t f = 0; f < nrBufFrames; f++) {
+    unsigned char* frame = &frames[f * frameSize];
+    for (size_t i = 0; i < frameSize; i++) {
+      frame[i] = rand();
+    }
+    uint16_t crc16 = tbbCrc16(frame, 43);
+    uint32_t crc32 = tbbCrc32Slicing(&frame[88], nTrSamples);
+    memcpy(&frame[86], &crc16, sizeof crc16); // little-endian host
+    memcpy(&frame[88 + nTrSamples * sizeof(int16_t)], &crc32, sizeof crc32);
+  }
+
+  cout << "Checking " << nrFrames << " transient frames; 48-dipole dump rate is " << dumpRate << " frames/s" << endl;
+
+  report("boost::crc (previous)", frameRate(frames, nrFrames / 10, checkBoost));
+  report("slicing-by-8", frameRate(frames, nrFrames, check<tbbCrc32Slicing>));
+  if (tbbCrc32IsAccelerated()) {
+    report("PCLMULQDQ", frameRate(frames, nrFrames, check<tbbCrc32Clmul>));
+  } else {
+    cout << setw(22) << "PCLMULQDQ" << "  not supported by this CPU" << endl;
+  }
+  report("batched", batchFrameRate(frames, nrFrames));
+
+  return 0;
+}
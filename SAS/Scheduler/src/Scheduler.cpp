@@ -24,6 +24,9 @@
 #include <limits>
 #include <cstdlib>
 #include <QMessageBox>
+#include <QThread>
+#include <QFuture>
+#include <QtConcurrentRun>
 using std::vector;
 using std::max;
 using std::min;
@@ -31,7 +34,7 @@ using std::min;
 
 Scheduler::Scheduler() :
 	pData(0), data_loaded(false), userDefinedStopCriteria(false), maxNrOfOptimizeIterations(MAX_OPTIMIZE_ITERATIONS),
-	userAcceptedPenalty(0), minTimeBetweenTasks(MIN_TIME_BETWEEN_TASKS_JULIAN)
+	userAcceptedPenalty(0), nrOfAnnealingChains(0), minTimeBetweenTasks(MIN_TIME_BETWEEN_TASKS_JULIAN)
 {
 }
 
@@ -82,102 +85,142 @@ void Scheduler::calculatePenalties(void) {
 
 int Scheduler::optimize(void)
 {
-	bestSchedule = pData->getCurrentSchedule(); // needs operator = for class NeighbourSolution
-	unsigned int bestPenalty = pData->getCurrentSchedule().getPenalty();
 	userAcceptedPenaltyEnabled = Controller::theSchedulerSettings.getUserAcceptedPenaltyEnabled();
 	userAcceptedPenalty = Controller::theSchedulerSettings.getUserAcceptedPenalty();
 	maxNrOfOptimizeIterations = Controller::theSchedulerSettings.getMaxNrOptimizations();
 	maxNrOptimizationsEnabled  = Controller::theSchedulerSettings.getMaxNrOptimizationsEnabled();
+
+	// run independent annealing chains, each on its own copy of the current schedule, and keep the best result.
+	// The first chain runs in this thread and reports the progress.
+	unsigned nrChains = nrOfAnnealingChains ? nrOfAnnealingChains : static_cast<unsigned>(max(QThread::idealThreadCount(), 1));
+	std::vector<NeighbourSolution> chains(nrChains);
+	for (unsigned i = 0; i < nrChains; ++i) {
+		chains[i] = pData->getCurrentSchedule();
+	}
+	unsigned seed = static_cast<unsigned>(rand());
+	std::vector<QFuture<int> > results;
+	for (unsigned i = 1; i < nrChains; ++i) {
+		results.push_back(QtConcurrent::run(this, &Scheduler::annealChain, &chains[i], seed + i, false));
+	}
+	int result = annealChain(&chains[0], seed, true);
+
+	unsigned best(0);
+	for (unsigned i = 1; i < nrChains; ++i) {
+		int chainResult = results[i-1].result(); // waits for the chain to finish
+		if (chains[i].getPenalty() < chains[best].getPenalty()) {
+			best = i;
+			result = chainResult;
+		}
+	}
+	debugInfo("sisi", "best schedule penalty: ", chains[best].getPenalty(), ", found by annealing chain: ", best);
+	pData->setCurrentSchedule(chains[best]);
+	return result;
+}
+
+int Scheduler::annealChain(NeighbourSolution *schedule, unsigned seed, bool reportProgress)
+{
 	// c is the control parameter that determines the acceptance rate of a test schedule with a higher penalty
 	// We gradually force c to zero during subsequent iterations
 	unsigned int c = 500; //maxNrOfOptimizeIterations + 1; //(pData->getNrScheduled() + pData->getNrUnscheduled()) * MAX_TASK_PENALTY;
-	//unsigned int c_step = 2 * c / maxNrOfOptimizeIterations;
-	//	unsigned int currentScheduleMaxChangeCount = pData->getNrOfConflicts();
-	//	bool allowUnscheduleFixedTasks = Controller::theSchedulerSettings.getAllowUnscheduleFixedTasks();
-	unsigned iteration(0), taskID; // , predTaskID, successorTaskID;
+	unsigned iteration(0), taskID;
 	bool scheduleChanged(false);
 	Task * pTask(0);
+	int result(0);
+	size_t mark;
+	unsigned currentPenalty(schedule->calculatePenalty()), bestPenalty(currentPenalty), testPenalty;
+	// The schedule is changed in place. Rejected changes are undone. The accepted changes since the best schedule
+	// so far stay in the undo log, so we can return to the best schedule at the end.
+	schedule->startUndoLog();
 	while (true) {
 		scheduleChanged = false;
 		// check stopping criteria
 		if (userAcceptedPenaltyEnabled && (bestPenalty <= userAcceptedPenalty)) {
-			pData->setCurrentSchedule(bestSchedule);
-			return 1; // user accepted penalty reached
+			result = 1; // user accepted penalty reached
+			break;
 		}
 		if (maxNrOptimizationsEnabled && (iteration == maxNrOfOptimizeIterations)) {
-			pData->setCurrentSchedule(bestSchedule);
-			return 2; // max number of optimizations reached
+			result = 2; // max number of optimizations reached
+			break;
 		}
-		testSchedule = pData->getCurrentSchedule(); // make a copy of the current schedule
+		mark = schedule->beginChange();
 		// calculate a neighbour schedule
 		// SIMULATED ANNEALING ALGORITHM
 		// choose a random task to reschedule from the conflicting tasks
-		taskID = testSchedule.getRandomScheduledTaskID();
+		taskID = schedule->getRandomScheduledTaskID(seed);
 		if (taskID) {
-			pTask = testSchedule.getTaskForChange(taskID);
+			pTask = schedule->getTaskForChange(taskID);
+		}
+		else {
+			result = 3; // there are no more scheduled tasks that may be changed
+			break;
 		}
-		else return 3; // there are no more scheduled tasks that may be changed
 
 		// now try an alteration of the current schedule
 		if (pTask->getFixedDay()) {
 			if (!pTask->getFixedTime()) { // if task only fixed on day not on time
-                if (testSchedule.tryShiftTaskWithinDay(pTask->getID(), true)) {
+				if (schedule->tryShiftTaskWithinDay(pTask->getID(), true)) {
 					scheduleChanged = true;
 				}
 			}
 		}
 		else if (pTask->getFixedTime()) { // task only fixed on time not on day
-            if (testSchedule.tryMoveTaskToAdjacentDay(pTask->getID(), true)) {
+			if (schedule->tryMoveTaskToAdjacentDay(pTask->getID(), true)) {
 				scheduleChanged = true;
 			}
 		}
 		else {
-            if (testSchedule.shiftTask(pTask->getID(), true)) {
+			if (schedule->shiftTask(pTask->getID(), true)) {
 				scheduleChanged = true;
 			}
 		}
 
 		if (!scheduleChanged) { // if the schedule didn't change then we try to unschedule the random task
-			if (testSchedule.unscheduleTask(pTask->getID())) {
+			if (schedule->unscheduleTask(pTask->getID())) {
 				scheduleChanged = true;
 			}
 			else {
+				schedule->undoChanges(mark); // e.g. a changed shift direction
 				++iteration; // increase the iteration counter to prevent the possibility of an endless loop
 			}
 		}
 
 		if (scheduleChanged) {
 			// now check if other unscheduled tasks can be fit in to the changed schedule
-			testSchedule.tryScheduleUnscheduledTasks();
-			//testSchedule.addChangedTasks(changedTask);
-			// keep track of the best schedule so far.
-			testSchedule.calculatePenalty();
-			if (testSchedule.getPenalty() < bestSchedule.getPenalty()) {
-				bestSchedule = testSchedule;
-				bestPenalty = bestSchedule.getPenalty();
-				//pData->setCurrentSchedule(bestSchedule); // move to best schedule
-			}
+			schedule->tryScheduleUnscheduledTasks();
+			testPenalty = schedule->updatePenalty();
 
-			double acceptanceValue = static_cast<double>(rand()-1) / RAND_MAX;
-			double currentValue = exp((static_cast<double>(pData->getPenalty()) - static_cast<double>(testSchedule.getPenalty())) / c);
+			double acceptanceValue = static_cast<double>(rand_r(&seed)) / RAND_MAX;
+			double currentValue = exp((static_cast<double>(currentPenalty) - static_cast<double>(testPenalty)) / c);
 
-			debugInfo("sisisisi", "iteration: ",iteration+1, ", last penalty: ", testSchedule.getPenalty(), ", current penalty: ", pData->getPenalty(),
-					", best schedule penalty: ", bestSchedule.getPenalty());
+			if (reportProgress) {
+				debugInfo("sisisisi", "iteration: ",iteration+1, ", last penalty: ", testPenalty, ", current penalty: ", currentPenalty,
+						", best schedule penalty: ", min(testPenalty, bestPenalty));
+			}
 
-			if (testSchedule.getPenalty() <= pData->getPenalty()) {
-				pData->setCurrentSchedule(testSchedule);// accept schedule if it has a lower penalty
+			// accept schedule if it has a lower penalty, or else with a certain probability
+			if ((testPenalty <= currentPenalty) || (currentValue > acceptanceValue)) {
+				currentPenalty = testPenalty;
+				if (testPenalty < bestPenalty) { // keep track of the best schedule so far.
+					bestPenalty = testPenalty;
+					schedule->clearUndoLog();
+				}
 			}
-			else if (currentValue >	acceptanceValue) { // move to new schedule with a certain probability
-				pData->setCurrentSchedule(testSchedule);
-				//currentScheduleMaxChangeCount = pData->getNrOfConflicts();
+			else {
+				schedule->undoChanges(mark);
 			}
 			// force the control parameter stepwise towards zero during iterations
 			if (c > 50) {c -= 2;}
 
-			emit optimizeIterationFinished(++iteration);
+			++iteration;
+			if (reportProgress) {
+				emit optimizeIterationFinished(iteration);
+			}
 		}
 	} // while (true)
-    return false;
+
+	schedule->undoChanges(0); // back to the best schedule
+	schedule->stopUndoLog();
+	return result;
 }
 
 bool Scheduler::createStartSchedule(void)
@@ -52,6 +52,7 @@ public:
 //	void calculateSunSetsAndSunDowns(void);
 	void setMinimumTimeBetweenTasks(const AstroTime &min_time) {minTimeBetweenTasks = min_time;}
 	void setMaxOptimizationIterations(unsigned max_optimizations) {maxNrOfOptimizeIterations = max_optimizations;}
+	void setNrOfAnnealingChains(unsigned nr_chains) {nrOfAnnealingChains = nr_chains;} // 0: one chain per core
 	void updateSettings(void); // updates the scheduler settings according to the settings in Controller::theSchedulerSettings
 	bool tryRescheduleTask(unsigned task_id, const AstroDateTime &new_start);
 	bool rescheduleAbortedTask(unsigned task_id, const AstroDateTime &new_start);
@@ -60,6 +61,8 @@ private:
 	bool tryMoveTaskToAdjacentDay(Task *task);
 	bool tryShiftTask(Task *task, SchedulerDataBlock &testSchedule);
 	bool tryShiftTaskWithinDay(Task *task);
+	// one simulated annealing chain on schedule, which holds the best schedule found when done. Returns as optimize()
+	int annealChain(NeighbourSolution *schedule, unsigned seed, bool reportProgress);
 
 
 signals:
@@ -68,7 +71,6 @@ signals:
 
 private:
 	SchedulerData *pData;
-	NeighbourSolution testSchedule, bestSchedule;
 	std::vector<SchedulerDataBlock> possibleSolutions;
 	bool data_loaded;
 	bool userDefinedStopCriteria;
@@ -76,6 +78,7 @@ private:
 	bool maxNrOptimizationsEnabled;
 	unsigned maxNrOfOptimizeIterations;
 	unsigned userAcceptedPenalty;
+	unsigned nrOfAnnealingChains;
 	AstroTime minTimeBetweenTasks;
 };
 
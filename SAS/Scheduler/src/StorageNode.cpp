@@ -16,6 +16,15 @@
 #include <limits>
 #include <QDateTime>
 #include <cmath>
+#include <algorithm>
+
+// compares the time of a log point with a time, to binary search the (time sorted) node bandwidth log
+class cmp_LogPointTime
+{
+public:
+	bool operator() (const AstroDateTime &time, const nodeBandWidthLogPoint &point) const { return time < point.time; }
+	bool operator() (const nodeBandWidthLogPoint &point, const AstroDateTime &time) const { return point.time < time; }
+};
 
 StorageNode::StorageNode()
 : itsID(0), itsStatus(0), itsclaimID(0)
@@ -96,12 +105,11 @@ task_conflict StorageNode::checkBandWidth(const AstroDateTime &start, const Astr
 	if (totalBW_kbs > itsRemainingBandwidth.front().remainingNodeBW) {
 		return CONFLICT_STORAGE_NODE_BANDWIDTH;
 	}
-	for (nodeBandWidthVector::const_iterator it = itsRemainingBandwidth.begin(); it != itsRemainingBandwidth.end(); ++it) {
-		if ((it->time >= start) && (it->time <= end)) {
-			if (it->remainingNodeBW < totalBW_kbs)
-				return CONFLICT_STORAGE_NODE_BANDWIDTH;
-		}
-		if (it->time > end) break;
+	// the log points within (start,end)
+	for (nodeBandWidthVector::const_iterator it = std::lower_bound(itsRemainingBandwidth.begin(), itsRemainingBandwidth.end(), start, cmp_LogPointTime());
+			(it != itsRemainingBandwidth.end()) && (it->time <= end); ++it) {
+		if (it->remainingNodeBW < totalBW_kbs)
+			return CONFLICT_STORAGE_NODE_BANDWIDTH;
 	}
 	return CONFLICT_NO_CONFLICT;
 }
@@ -163,25 +171,21 @@ nodeStorageOptions StorageNode::getPossibleRaidArrays(const AstroDateTime &start
 		// first check if enough total bandwidth to this node is remaining
 		if (itsRemainingBandwidth.size() > 1) {
 //			std::cout << "number of log points in itsRemainingBandwidth:" << itsRemainingBandwidth.size() << std::endl;
-			for (nodeBandWidthVector::const_iterator it = itsRemainingBandwidth.begin(); it != itsRemainingBandwidth.end()-2; ++it) {
-//				if (debugOut)  {
-//					std::cout << "log point time:" << it->time.toString() << "BW:" << it->remainingNodeBW << "kbit/s" << std::endl;
-//				}
-				if (startTime <= (it+1)->time) { // found the first log point later than the start time of the observation
-					while (endTime > it->time) {
+			// binary search the log point before the first log point that is not earlier than the start time of the observation
+			nodeBandWidthVector::const_iterator it = std::lower_bound(itsRemainingBandwidth.begin() + 1, itsRemainingBandwidth.end(), startTime, cmp_LogPointTime()) - 1;
+			if (it < itsRemainingBandwidth.end() - 2) { // found the first log point later than the start time of the observation
+				while (endTime > it->time) {
 //						if (debugOut) {
 //						std::cout << "log point time:" << it->time.toString() << "BW:" << it->remainingNodeBW << "kbit/s" << std::endl;
 //						}
-						if (minBWreq > it->remainingNodeBW) {
+					if (minBWreq > it->remainingNodeBW) {
 //							if (debugOut) {
 //								std::cout << " not enough total bandwidth to this storage node: " << itsName.c_str() << std::endl;
 //							}
-							result.push_back(std::pair<int, task_conflict>(-1, CONFLICT_STORAGE_NODE_BANDWIDTH));
-							return locations; // don't check the raid arrays because there is not enough total bandwidth
-						}
-						if (++it == itsRemainingBandwidth.end()) break; // iterate to next logpoint in itsRemainingBandWidth
+						result.push_back(std::pair<int, task_conflict>(-1, CONFLICT_STORAGE_NODE_BANDWIDTH));
+						return locations; // don't check the raid arrays because there is not enough total bandwidth
 					}
-					break; // break out of for loop (no conflicts so far)
+					if (++it == itsRemainingBandwidth.end()) break; // iterate to next logpoint in itsRemainingBandWidth
 				}
 			}
 		}
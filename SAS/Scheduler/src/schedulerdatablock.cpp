@@ -15,7 +15,9 @@
 #include <map>
 #include <deque>
 #include <algorithm>
+#include <iterator>
 #include <math.h>
+#include <stdlib.h>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -42,7 +44,7 @@ using std::max;
 using std::min;
 
 SchedulerDataBlock::SchedulerDataBlock() :
-	itsSaveRequired(false), itsUploadRequired(false), nullTask(0) {
+	itsSaveRequired(false), itsUploadRequired(false), nullTask(0), itsLogChanges(false) {
 }
 
 SchedulerDataBlock::SchedulerDataBlock(const SchedulerDataBlock &other) {
@@ -291,7 +293,10 @@ SchedulerDataBlock & SchedulerDataBlock::operator=(const SchedulerDataBlock &rhs
 			unscheduledTasks.clear();
 		}
 		for (unscheduledTasksDeque::const_iterator it =	rhs.getUnscheduledTasks().begin(); it != rhs.getUnscheduledTasks().end(); ++it) {
-			Task *pTask = new Task(*(*it));
+			Task *pTask = cloneTask(*it); // keep the type of the task (e.g. unscheduled observations)
+			if (!pTask) {
+				pTask = new Task(*(*it));
+			}
 			this->addTask(pTask, DONT_CHECK_FREE_ID); // the NO_CHECK skips the check to see if the ID is free. (we already know it is free)
 		}
 
@@ -364,6 +369,10 @@ SchedulerDataBlock & SchedulerDataBlock::operator=(const SchedulerDataBlock &rhs
 		itsPenalty = rhs.getPenalty();
 		itsSaveRequired = rhs.getSaveRequired();
 		itsUploadRequired = rhs.getUploadRequired();
+		// the undo log refers to the tasks of rhs, it is not copied
+		itsLogChanges = false;
+		itsUndoLog.clear();
+		itsChangedTasks.clear();
 	}
 	return *this;
 }
@@ -687,8 +696,14 @@ void SchedulerDataBlock::unscheduleAll(bool forced_unschedule) {
 bool SchedulerDataBlock::unscheduleTask(unsigned task_id) {
 	Task *pTask(0);
 	scheduledTasksMap::iterator it = scheduledTasks.find(task_id);
+	undoRecord record;
 	if (it != scheduledTasks.end()) {
 		pTask = it->second;
+		if (itsLogChanges) {
+			logTaskPenalty(pTask);
+			record.wasScheduled = true;
+			record.status = pTask->getStatus();
+		}
 		scheduledTasks.erase(it);
 		pTask->setStatus(Task::UNSCHEDULED);
 		unscheduledTasks.push_back(pTask);
@@ -697,25 +712,40 @@ bool SchedulerDataBlock::unscheduleTask(unsigned task_id) {
 		pipelinesMap::iterator it = itsPipelines.find(task_id);
 		if (it != itsPipelines.end()) {
 			pTask = it->second;
+			record.status = pTask->getStatus();
 			pTask->setStatus(Task::UNSCHEDULED);
 		}
 		else {
 			reservationsMap::iterator it = itsReservations.find(task_id);
 			if (it != itsReservations.end()) {
 				pTask = it->second;
+				record.status = pTask->getStatus();
 				//			debugInfo("sis", "Reservation: ", task_id, " is being unscheduled");
 				pTask->setStatus(Task::ON_HOLD);
 			}
 		}
+		record.wasScheduled = false;
 	}
 	if (pTask) {
+		if (itsLogChanges) {
+			record.type = UNDO_UNSCHEDULE;
+			record.task = pTask;
+			itsUndoLog.push_back(record);
+		}
 		if (pTask->isStationTask()) {
 			stationsMap::iterator ssit;
             const std::map<std::string, unsigned> &stations =  static_cast<StationTask *>(pTask)->getStations();
 			for (std::map<std::string, unsigned>::const_iterator sit = stations.begin(); sit != stations.end(); ++sit) {
 				ssit = itsStations.find(sit->second); // first check if the station still exists, the user may have deleted it with the settingsdialog
                 if (ssit != itsStations.end()) {
-					ssit->second.removeTask(task_id);
+					stationTask removed(ssit->second.removeTask(task_id));
+					if (itsLogChanges && (removed.first == task_id)) {
+						record.type = UNDO_STATION_REMOVE;
+						record.stationID = ssit->first;
+						record.start = removed.second.first;
+						record.end = removed.second.second;
+						itsUndoLog.push_back(record);
+					}
 				}
 			}
 		}
@@ -732,6 +762,10 @@ std::vector<unsigned> SchedulerDataBlock::moveTask(Task *pTask, const AstroDateT
 
     AstroDateTime new_end = new_start + pTask->getDuration();
 
+    if (itsLogChanges) {
+        logTaskChange(pTask);
+    }
+
     if (pTask->isStationTask()) {
         // go by all Stations in this task to see if we have to kick out conflicting tasks
         // check if any of the conflicting tasks are SCHEDULED
@@ -740,6 +774,8 @@ std::vector<unsigned> SchedulerDataBlock::moveTask(Task *pTask, const AstroDateT
         const std::map<std::string, unsigned> &stations =  psTask->getStations();
         for (std::map<std::string, unsigned>::const_iterator sit = stations.begin(); sit != stations.end(); ++sit) {
             conflictIDs = itsStations[sit->second].getTaskswithinTimeSpan(new_start, new_end);
+            // the task itself is not a conflict
+            conflictIDs.erase(std::remove(conflictIDs.begin(), conflictIDs.end(), pTask->getID()), conflictIDs.end());
             if (unschedule_conflicting_tasks) {
                 for (std::vector<unsigned>::const_iterator tit = conflictIDs.begin(); tit != conflictIDs.end(); ++tit) {
                     const Task *pTask = getTask(*tit);
@@ -761,7 +797,15 @@ std::vector<unsigned> SchedulerDataBlock::moveTask(Task *pTask, const AstroDateT
         stationsMap::iterator sit;
         for (std::map<std::string, unsigned>::const_iterator sidit = stations.begin(); sidit != stations.end(); ++sidit) {
             if ((sit = itsStations.find(sidit->second)) != itsStations.end()) {
-                sit->second.moveTask(pTask->getID(), pTask->getScheduledStart(), pTask->getScheduledEnd());
+                if (sit->second.moveTask(pTask->getID(), new_start, new_end) && itsLogChanges) {
+                    undoRecord record;
+                    record.type = UNDO_STATION_MOVE;
+                    record.task = pTask;
+                    record.stationID = sit->first;
+                    record.start = pTask->getScheduledStart();
+                    record.end = pTask->getScheduledEnd();
+                    itsUndoLog.push_back(record);
+                }
             }
         }
     }
@@ -806,6 +850,9 @@ bool SchedulerDataBlock::tryMoveTaskToAdjacentDay(unsigned task_id, bool unsched
     std::pair<bool, std::vector<unsigned> > result;
 	result.first = false;
 	Task *task = getTaskForChange(task_id);
+	if (itsLogChanges) {
+		logTaskChange(task); // the shift direction may change before the move
+	}
 	AstroDateTime new_start;
 	if (task->hasPredecessors()) {
 		if (task->getShiftDirection() == SHIFT_RIGHT) {
@@ -869,6 +916,9 @@ bool SchedulerDataBlock::tryMoveTaskToAdjacentDay(unsigned task_id, bool unsched
 
 bool SchedulerDataBlock::tryShiftTaskWithinDay(unsigned task_id, bool unschedule_conflicting_tasks) {
 	Task *task = getTaskForChange(task_id);
+	if (itsLogChanges) {
+		logTaskChange(task); // the shift direction may change before the move
+	}
 	AstroDateTime new_start;
 	if (task->getShiftDirection() == SHIFT_RIGHT) {
 		new_start = task->getScheduledEnd() + task->getDuration();
@@ -952,6 +1002,9 @@ bool SchedulerDataBlock::tryShiftTask(unsigned task_id, bool unschedule_conflict
 */
 bool SchedulerDataBlock::shiftTask(unsigned task_id, bool unschedule_conflicting_tasks) {
 	Task *task = getTaskForChange(task_id);
+	if (itsLogChanges) {
+		logTaskChange(task); // the shift direction may change before the move
+	}
 	AstroDateTime new_start;
 	if (task->hasPredecessors()) {
 		if (task->getShiftDirection() == SHIFT_RIGHT) {
@@ -1281,122 +1334,8 @@ void SchedulerDataBlock::updateTasksStationIDs(void) {
 
 void SchedulerDataBlock::tryScheduleUnscheduledTasks(void) {
 	//TODO: SchedulerDataBlock::tryScheduleUnscheduledTasks Needs a complete rewrite!!!
-	/*
-	const AstroTime &min_time_between_tasks = Controller::theSchedulerSettings.getMinimumTimeBetweenTasks();
-	Task task;
-	Task::task_status status;
-	Station *pStation = 0;
-	bool opening_found, found_mutual_opening;
-#ifdef DEBUG_SCHEDULER
-	const Task * pTask(0);
-#endif
-	size_t count(0);
-	AstroDateTime previous_opening, first_opening;
-	unsigned nr_unscheduled = getNrUnscheduled();
-	for (unsigned i = 0; i != nr_unscheduled; ++i) { // iterate over all unscheduled tasks
-		opening_found = true;
-		found_mutual_opening = false;
-		if (getNextTask(task)) {
-			status = task.getStatus();
-			if (status == Task::ON_HOLD) {
-				holdNextTask(TASK_ON_HOLD);
-				opening_found = false;
-			}
-			else if (status == Task::ERROR) {
-				holdNextTask();
-				opening_found = false;
-			}
-			else if (checkTaskBoundaries(task)) {
-				// check with the stations requested by the task if the requested time is already occupied. If not schedule the task
-				first_opening = task.getFirstPossibleDateTime();
-				if (task.hasLinkedTask()) {
-					// TODO: Maybe the user should have a choice if he doesn't want a task to be scheduled if this doesn't fit with a predecessor or a successor
-					if (task.hasPredecessors()) {
-						if (getTaskStatus(task.getPredecessor()) == Task::SCHEDULED) { // don't schedule the task if the predecessor isn't scheduled
-							first_opening = max(getTaskEndTime(task.getPredecessor()) + task.getPredecessorMinTimeDif(), first_opening);
-							if (first_opening > Controller::theSchedulerSettings.getLatestSchedulingDay()) {
-								holdNextTask(OUTSIDE_SCHEDULE_BOUNDS);
-								opening_found= false;
-							}
-						} else {
-							holdNextTask(PREDECESSOR_UNSCHEDULED); // don't schedule task if predecessor isn't scheduled
-							opening_found = false;
-						}
-					}
-					//TODO: A Task can have multiple successors! So calculate for all predecessors and take the latest time
-					if (task.hasSuccesors()) {
-						for (std::vector<unsigned>::const_iterator it = task.getSuccessors().begin(); it != task.getSuccessors().end(); ++it) {
-							first_opening = max(getTaskFirstPossibleDate(*it) - getTaskPredecessorMaxTimeDif(*it) - task.getDuration(), first_opening);
-						}
-						if ((first_opening < Controller::theSchedulerSettings.getEarliestSchedulingDay()) |
-								(first_opening > Controller::theSchedulerSettings.getLatestSchedulingDay())) {
-							holdNextTask(OUTSIDE_SCHEDULE_BOUNDS);
-							opening_found= false;
-						}
-					}
-				}
-			}
-			else { // task has first possible and last possible dates out of schedule bounds
-				holdNextTask(OUTSIDE_SCHEDULE_BOUNDS);
-				opening_found = false;
-			}
-			while (!found_mutual_opening && opening_found) {
-				count = 0;
-				const std::map<std::string, unsigned> &stations =  task.getStations();
-				for (std::map<std::string, unsigned>::const_iterator it = stations.begin(); it != stations.end(); ++it) {
-					++count;
-					if ((pStation = getStationForChange(it->second))) {
-						previous_opening = first_opening;
-						if (pStation->findFirstOpportunity(task, first_opening, min_time_between_tasks)) {
-							// if possible to schedule at this station then first_possible holds the possible start time
-							if (first_opening != previous_opening) {
-								// check if the opening found is not too far from the predecessor if there is a predecessor
-								if (task.hasPredecessor()) {
-									if (first_opening > getTaskEndTime(task.getPredecessor()) + task.getPredecessorMaxTimeDif()) {
-										opening_found = false;
-										holdNextTask(MAX_DISTANCE_PREDECESSOR);
-										break;
-									}
-								}
-								if (count != 1) {
-									break; // starts again to ask all stations starting from the last found opening
-								}
-							}
-							if (count == stations.size()) {
-								found_mutual_opening = true;
-							}
-						} else { // one of the stations didn't find a possible scheduling time, skip other stations
-							opening_found = false;
-							holdNextTask(NO_MUTUAL_OPENING_FOUND);
-							break; // break out for loop, don't ask other stations for schedule opening
-						}
-					} else {
-						debugErr("sssisis", "SchedulerDataBlock::tryScheduleUnscheduledTasks: Station ", it->first.c_str(), ", with ID: ", it->second, " in the list of task ", task.getID(), " which doesn't seem to exist!");
-						opening_found = false;
-						holdNextTask(NON_EXISTING_STATION);
-						break; // break out for loop, don't ask other stations for schedule opening
-					}
-				}
-			}
-			if (found_mutual_opening && (task.getStations().size() > 0)) {
-				if (scheduleNextTask(first_opening)) {
-#ifdef DEBUG_SCHEDULER
-					if ((pTask = getScheduledTask(task.getID()))) {
-						debugInfo("sissss", "Task: ", pTask->getID(), " is scheduled at start: ",
-								pTask->getScheduledStart().toString().c_str(), " and end: ",	pTask->getScheduledEnd().toString().c_str());
-						//std::cout << "Task: " << pTask->getID() << " is scheduled at start: " << pTask->getScheduledStart().toString()
-						//		<< " and end: " << pTask->getScheduledEnd().toString() << "." << std::endl;
-					} else {
-						debugErr(
-								"sis", "SchedulerDataBlock::tryScheduleUnscheduledTasks: scheduled task ", task.getID(),
-								"was not correctly scheduled!");
-					}
-#endif
-				}
-			}
-		}
-	}
-	*/
+	// Until then it does not schedule anything. A rewrite has to record its changes in the undo log when
+	// itsLogChanges is set (see logTaskChange()), because Scheduler::annealChain() calls it for every move.
 }
 
 void SchedulerDataBlock::scheduleFixedTasks(void) {
@@ -2935,3 +2874,115 @@ unsigned SchedulerDataBlock::getRandomScheduledTaskID(void) {
 	else return 0;
 }
 
+
+unsigned SchedulerDataBlock::getRandomScheduledTaskID(unsigned &seed) {
+	if (!scheduledTasks.empty()) {
+		scheduledTasksMap::const_iterator it = scheduledTasks.begin();
+		std::advance(it, rand_r(&seed) % scheduledTasks.size());
+		return it->first;
+	}
+	else return 0;
+}
+
+void SchedulerDataBlock::startUndoLog(void) {
+	itsUndoLog.clear();
+	itsChangedTasks.clear();
+	itsLogChanges = true;
+}
+
+void SchedulerDataBlock::stopUndoLog(void) {
+	itsUndoLog.clear();
+	itsChangedTasks.clear();
+	itsLogChanges = false;
+}
+
+void SchedulerDataBlock::clearUndoLog(void) {
+	itsUndoLog.clear();
+	itsChangedTasks.clear();
+}
+
+size_t SchedulerDataBlock::beginChange(void) {
+	itsChangedTasks.clear();
+	undoRecord record;
+	record.type = UNDO_PENALTY;
+	record.task = 0;
+	record.penalty = itsPenalty;
+	itsUndoLog.push_back(record);
+	return itsUndoLog.size() - 1;
+}
+
+void SchedulerDataBlock::undoChanges(size_t mark) {
+	stationsMap::iterator sit;
+	while (itsUndoLog.size() > mark) {
+		const undoRecord &record(itsUndoLog.back());
+		switch (record.type) {
+		case UNDO_PENALTY:
+			itsPenalty = record.penalty;
+			break;
+		case UNDO_TASK_TIMES:
+			record.task->setScheduledStart(record.start);
+			record.task->syncStartStopTimes();
+			record.task->setShiftDirection(record.shiftDirection);
+			break;
+		case UNDO_UNSCHEDULE:
+			record.task->setStatus(record.status);
+			if (record.wasScheduled) { // the task was appended to the unscheduled tasks, put it back in the scheduled tasks
+				unscheduledTasksDeque::reverse_iterator uit = std::find(unscheduledTasks.rbegin(), unscheduledTasks.rend(), record.task);
+				if (uit != unscheduledTasks.rend()) {
+					unscheduledTasks.erase((++uit).base());
+				}
+				scheduledTasks.insert(scheduledTasksMap::value_type(record.task->getID(), static_cast<StationTask *>(record.task)));
+			}
+			break;
+		case UNDO_STATION_MOVE:
+			if ((sit = itsStations.find(record.stationID)) != itsStations.end()) {
+				sit->second.moveTask(record.task->getID(), record.start, record.end);
+			}
+			break;
+		case UNDO_STATION_REMOVE:
+			if ((sit = itsStations.find(record.stationID)) != itsStations.end()) {
+				sit->second.addTasktoStation(record.task->getID(), record.start, record.end);
+			}
+			break;
+		}
+		itsUndoLog.pop_back();
+	}
+	itsChangedTasks.clear();
+}
+
+unsigned SchedulerDataBlock::updatePenalty(void) {
+	for (std::vector<std::pair<Task *, unsigned> >::const_iterator it = itsChangedTasks.begin(); it != itsChangedTasks.end(); ++it) {
+		itsPenalty += taskPenalty(it->first) - it->second;
+	}
+	itsChangedTasks.clear();
+	return itsPenalty;
+}
+
+void SchedulerDataBlock::logTaskChange(Task *pTask) {
+	logTaskPenalty(pTask);
+	undoRecord record;
+	record.type = UNDO_TASK_TIMES;
+	record.task = pTask;
+	record.start = pTask->getScheduledStart();
+	record.shiftDirection = pTask->getShiftDirection();
+	itsUndoLog.push_back(record);
+}
+
+void SchedulerDataBlock::logTaskPenalty(Task *pTask) {
+	for (std::vector<std::pair<Task *, unsigned> >::const_iterator it = itsChangedTasks.begin(); it != itsChangedTasks.end(); ++it) {
+		if (it->first == pTask) return; // already logged
+	}
+	itsChangedTasks.push_back(std::pair<Task *, unsigned>(pTask, taskPenalty(pTask)));
+}
+
+// same contributions as in calculatePenalty()
+unsigned SchedulerDataBlock::taskPenalty(Task *pTask) const {
+	if (scheduledTasks.find(pTask->getID()) != scheduledTasks.end()) {
+		return pTask->calculatePenalty();
+	}
+	else if ((pTask->getStatus() != Task::ERROR) &&
+			(std::find(unscheduledTasks.rbegin(), unscheduledTasks.rend(), pTask) != unscheduledTasks.rend())) { // unscheduled tasks are appended at the back
+		return UNSCHEDULED_TASK_PENALTY;
+	}
+	return 0;
+}
@@ -81,7 +81,7 @@ public:
 	bool moveTaskToInactive(unsigned taskID); // puts the task in the inactive map if its state is one of the inactive states
 	bool rescheduleTask(unsigned task_id, const AstroDateTime & new_start); // tries to reschedule the task at the first opportunity from the given start time onwards (does not always succeed)
 	bool rescheduleAbortedTask(unsigned task_id, const AstroDateTime & new_start);
-	void tryScheduleUnscheduledTasks(void); // iterates over all unscheduled tasks to try and schedule them
+	void tryScheduleUnscheduledTasks(void); // should try to schedule all unscheduled tasks; currently does nothing (needs a rewrite)
 	// the following change.. functions change a task's schedule times without checking conflicts with other tasks
 	bool changeTaskStartTime(unsigned task_id, const AstroDateTime &new_start);
 	bool changeTaskEndTime(unsigned task_id, const AstroDateTime &new_end);
@@ -106,6 +106,7 @@ public:
 //	void clearConflictsTask(unsigned taskID) {itsConflicts.erase(taskID);}
 //	unsigned getRandomScheduledTaskID(bool includeFixedTasks);
 	unsigned getRandomScheduledTaskID(void);
+	unsigned getRandomScheduledTaskID(unsigned &seed); // thread safe version using rand_r with the caller's seed
 	bool taskExists(unsigned task_id) const;
 	// updates all tasks to use the new station IDs from schedulerSettings
 	void updateTasksStationIDs(void);
@@ -118,6 +119,18 @@ public:
     bool tryShiftTaskWithinDay(unsigned task_id, bool unschedule_conflicting_tasks);
 //	bool tryShiftTask(unsigned task_id, bool unschedule_conflicting_tasks);
 
+	// undo log, used by the optimizer to change a single schedule in place instead of copying it for every try.
+	// While started, the changes made by moveTask, shiftTask, tryMoveTaskToAdjacentDay, tryShiftTaskWithinDay
+	// and unscheduleTask are logged (other changes are not).
+	void startUndoLog(void);
+	void stopUndoLog(void);
+	void clearUndoLog(void); // forget the logged changes, undoChanges(0) will return to the current schedule
+	size_t beginChange(void); // starts a new change, returns the mark to undo it with undoChanges(mark)
+	void undoChanges(size_t mark); // reverts the changes (and the penalty) logged since mark
+	// updates the penalty of the schedule with the penalty differences of the tasks changed since beginChange()
+	// equal to calculatePenalty() if the penalty was up to date at beginChange()
+	unsigned updatePenalty(void);
+
 //	void alignLeft(void); // aligns all task as much as possible to the left
 
 	//sorting functions
@@ -244,6 +257,28 @@ private:
 	// 1: lower limit reached, can move right (later)
 	// 2: upper limit reached, can move left (earlier)
 	short int withinPredecessorsRange(const Task *task, const AstroDateTime &new_start) const;
+	// undo log bookkeeping
+	void logTaskChange(Task *pTask); // logs the schedule times and shift direction of the task
+	void logTaskPenalty(Task *pTask); // stores the penalty of the task the first time it is changed after beginChange()
+	unsigned taskPenalty(Task *pTask) const; // the penalty contribution of the task to the penalty of the schedule
+
+	enum undoType {
+		UNDO_PENALTY,
+		UNDO_TASK_TIMES,
+		UNDO_UNSCHEDULE,
+		UNDO_STATION_MOVE,
+		UNDO_STATION_REMOVE
+	};
+	struct undoRecord {
+		undoType type;
+		Task *task;
+		unsigned stationID;
+		AstroDateTime start, end;
+		bool shiftDirection;
+		bool wasScheduled; // UNDO_UNSCHEDULE: task was taken from scheduledTasks
+		Task::task_status status;
+		unsigned penalty;
+	};
 
 protected:
 	// scheduler data objects
@@ -261,6 +296,9 @@ protected:
 	unsigned itsPenalty; // the total penalty for this schedule
 	bool itsSaveRequired, itsUploadRequired;
 	Task nullTask;
+	bool itsLogChanges; // true if the undo log is started
+	std::vector<undoRecord> itsUndoLog;
+	std::vector<std::pair<Task *, unsigned> > itsChangedTasks; // the tasks changed since beginChange() and their penalty before the change
 };
 
 #endif /* SCHEDULERDATABLOCK_H_ */
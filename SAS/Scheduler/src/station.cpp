@@ -63,7 +63,8 @@ Station::Station(const std::string &name, unsigned id) :
 }
 
 Station::Station(const Station &other) :
-	station_id(other.getStationID()), itsName(other.getName()), itsTasks(other.getTasks())
+	station_id(other.getStationID()), itsName(other.getName()), itsTasks(other.getTasks()),
+	itsMaxTaskDuration(other.itsMaxTaskDuration)
 {
 }
 
@@ -75,6 +76,7 @@ Station & Station::operator=(const Station &rhs) {
 	station_id = rhs.getStationID();
 	itsName = rhs.getName();
 	itsTasks = rhs.getTasks();
+	itsMaxTaskDuration = rhs.itsMaxTaskDuration;
 	return *this;
 }
 
@@ -108,6 +110,8 @@ QDataStream& operator>> (QDataStream &in, Station &station) {
 				std::pair<unsigned, std::pair<AstroDateTime, AstroDateTime > >(taskID, timePair)
 		);
 	}
+	station.sortTasks2EndTime();
+	station.updateMaxTaskDuration();
 	return in;
 }
 
@@ -340,10 +344,29 @@ void Station::sortTasks2EndTime()
 	sort(itsTasks.begin(), itsTasks.end(), cmp_TaskEndTime());
 }
 
+void Station::insertTask(const stationTask &task)
+{
+	itsTasks.insert(std::upper_bound(itsTasks.begin(), itsTasks.end(), task, cmp_TaskEndTime()), task);
+	AstroTime duration(task.second.second.timeDifference(task.second.first));
+	if (duration > itsMaxTaskDuration) {
+		itsMaxTaskDuration = duration;
+	}
+}
+
+void Station::updateMaxTaskDuration(void)
+{
+	itsMaxTaskDuration = AstroTime();
+	for (stationTasksVector::const_iterator it = itsTasks.begin(); it != itsTasks.end(); ++it) {
+		AstroTime duration(it->second.second.timeDifference(it->second.first));
+		if (duration > itsMaxTaskDuration) {
+			itsMaxTaskDuration = duration;
+		}
+	}
+}
 
 bool Station::addTasktoStation(unsigned task_id, const AstroDateTime &start, const AstroDateTime &end)
 {
-	// Insert task in the vector tasks and sort the vector on the end times
+	// Insert task in the vector tasks at the position of its end time
 	for (stationTasksVector::iterator it = itsTasks.begin(); it != itsTasks.end(); ++it) {
 		if (it->first == task_id) {
 //#ifdef DEBUG_SCHEDULER
@@ -353,19 +376,11 @@ bool Station::addTasktoStation(unsigned task_id, const AstroDateTime &start, con
 			// already scheduled on this station.
 			// this happens e.g. when the task goes from PRESCHEDULED to SCHEDULED state
 			// only update the start and end time
-			it->second.first = start;
-			it->second.second = end;
-			sortTasks2EndTime();
-			return true;
+			return moveTask(task_id, start, end);
 		}
 	}
 	std::pair<AstroDateTime, AstroDateTime> times = std::pair<AstroDateTime, AstroDateTime>(start,end);
-	stationTask task =
-		(
-			stationTask(task_id, times)
-		);
-	itsTasks.push_back(task);
-	sortTasks2EndTime();
+	insertTask(stationTask(task_id, times));
 	return true;
 }
 
@@ -373,8 +388,12 @@ bool Station::moveTask(unsigned task_id, const AstroDateTime &start, const Astro
 {
 	for (stationTasksVector::iterator it = itsTasks.begin(); it != itsTasks.end(); ++it) {
 		if (it->first == task_id) {
-			it->second = std::pair<AstroDateTime, AstroDateTime>(start,end);
-			sortTasks2EndTime();
+			AstroTime old_duration(it->second.second.timeDifference(it->second.first));
+			itsTasks.erase(it);
+			insertTask(stationTask(task_id, std::pair<AstroDateTime, AstroDateTime>(start,end)));
+			if (!(old_duration < itsMaxTaskDuration)) { // the task may have been the longest one
+				updateMaxTaskDuration();
+			}
 			return true;
 		}
 	}
@@ -402,6 +421,9 @@ stationTask Station::removeTask(unsigned task_id) {
 			removed_task.first = task_id;
 			removed_task.second = it->second;
 			itsTasks.erase(it);
+			if (!(removed_task.second.second.timeDifference(removed_task.second.first) < itsMaxTaskDuration)) { // the task may have been the longest one
+				updateMaxTaskDuration();
+			}
 			return removed_task;
 		}
 	}
@@ -426,7 +448,11 @@ std::vector<unsigned> Station::getTaskswithinTimeSpan(const AstroDateTime &start
 	AstroTime min_time_between_tasks(Controller::theSchedulerSettings.getMinimumTimeBetweenTasks());
 //	std::cout << "getting tasks from station:" << itsName << std::endl
 //	<< " within timespan " << start.toString() << " - " << end.toString() << std::endl;
-	for (stationTasksVector::const_iterator it = itsTasks.begin(); it != itsTasks.end(); ++it) {
+	// only the tasks that end after (start - min_time_between_tasks) and before (end + min_time_between_tasks + itsMaxTaskDuration) can overlap
+	AstroDateTime first_end(start - min_time_between_tasks), last_end(end + min_time_between_tasks + itsMaxTaskDuration);
+	stationTasksVector::const_iterator it = std::upper_bound(itsTasks.begin(), itsTasks.end(),
+			stationTask(0, std::pair<AstroDateTime, AstroDateTime>(first_end, first_end)), cmp_TaskEndTime());
+	for (; (it != itsTasks.end()) && (it->second.second <= last_end); ++it) {
 //		std::cout << "task:" << it->first << ", start: " << it->second.first.toString() << ", end: " << it->second.second.toString() <<std::endl;
 //		std::cout << "test 1:" << static_cast<int>(it->second.first < end + min_time_between_tasks) << ", test 2:" << static_cast<int>(it->second.second > start - min_time_between_tasks) << std::endl;
 		if ((it->second.first < end + min_time_between_tasks) & (it->second.second > start - min_time_between_tasks)) {
@@ -115,10 +115,16 @@ public:
 
 private:
 	stationTasksVector::const_iterator lower_bound(const AstroDateTime &date) const;
+	// inserts the task at its end time position in itsTasks (which must already be sorted)
+	void insertTask(const stationTask &task);
+	void updateMaxTaskDuration(void);
 
 	quint16 station_id;
 	std::string itsName;
+	// itsTasks is kept sorted on end time. Together with the longest task duration this makes it an interval index:
+	// a task that ends after time t starts before t only if it ends before t + itsMaxTaskDuration
 	stationTasksVector itsTasks;
+	AstroTime itsMaxTaskDuration;
 };
 
 
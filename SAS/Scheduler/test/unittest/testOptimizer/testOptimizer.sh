@@ -0,0 +1,2 @@
+#!/bin/sh -x
+./runctest.sh testOptimizer
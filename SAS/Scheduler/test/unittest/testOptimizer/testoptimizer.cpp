@@ -0,0 +1,238 @@
+// Headless tests and benchmark of the schedule optimizer (simulated annealing)
+// on a season-sized schedule: the undo log must restore the schedule exactly,
+// the incremental penalty must equal the recalculated penalty, and the station
+// interval index must find the same tasks as a linear scan.
+
+#include <QtTest/QtTest>
+#include <QThread>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include "Controller.h"
+#include "Scheduler.h"
+#include "schedulerdata.h"
+#include "schedulerdatablock.h"
+#include "neighboursolution.h"
+#include "observation.h"
+#include "station.h"
+
+class TestOptimizer: public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void stationIndex();
+	void undoRestoresSchedule();
+	void benchmarkOptimize();
+
+private:
+	// a schedule with nrTasks observations of 1 to 8 hours on 4 to 12 of the stations, spread over the whole schedule
+	void fillSchedule(SchedulerDataBlock &schedule, unsigned nrTasks);
+	// everything the optimizer can change: the start times, states and the station bookkeeping
+	std::string scheduleState(const SchedulerDataBlock &schedule);
+
+	std::vector<std::string> itsStationNames;
+};
+
+void TestOptimizer::initTestCase()
+{
+	srand(1);
+	stationDefinitionsMap stations;
+	for (unsigned i = 0; i < 40; ++i) {
+		char name[8];
+		snprintf(name, sizeof name, "CS%03u", i + 1);
+		itsStationNames.push_back(name);
+		stations[name] = std::pair<double, double>(52.9 + 0.01 * i, 6.87 + 0.01 * i);
+	}
+	// keep the default schedule period (about half a year from now)
+	Controller::theSchedulerSettings.defineScheduleAndStations(stations,
+			Controller::theSchedulerSettings.getEarliestSchedulingDay(), Controller::theSchedulerSettings.getLatestSchedulingDay());
+	Controller::theSchedulerSettings.setMinTimeBetweenTasks(AstroTime(0, 1, 0));
+}
+
+void TestOptimizer::fillSchedule(SchedulerDataBlock &schedule, unsigned nrTasks)
+{
+	schedule.updateStations();
+	const AstroDate &firstDay(Controller::theSchedulerSettings.getEarliestSchedulingDay());
+	const AstroDate &lastDay(Controller::theSchedulerSettings.getLatestSchedulingDay());
+	unsigned nrDays = lastDay.toJulian() - firstDay.toJulian();
+
+	for (unsigned id = 1; id <= nrTasks; ++id) {
+		Observation *pObs = schedule.newObservation(id);
+		QVERIFY(pObs);
+		std::vector<std::string> stations;
+		unsigned nrStations = 4 + rand() % 9;
+		unsigned first = rand() % itsStationNames.size();
+		for (unsigned s = 0; s < nrStations; ++s) {
+			stations.push_back(itsStationNames[(first + s) % itsStationNames.size()]);
+		}
+		pObs->setStations(stations);
+		pObs->setDuration(AstroTime(1 + rand() % 8, 0, 0));
+		pObs->setWindowFirstDay(firstDay);
+		pObs->setWindowLastDay(lastDay);
+		pObs->setWindowMinTime(AstroTime(0, 0, 0));
+		pObs->setWindowMaxTime(AstroTime(23, 59, 59));
+
+		// schedule at a random time where it doesn't conflict, or leave unscheduled
+		for (unsigned attempt = 0; attempt < 20; ++attempt) {
+			pObs->setScheduledStart(AstroDateTime(firstDay.addDays(1 + rand() % (nrDays - 2)), AstroTime(rand() % 24, rand() % 60, 0)));
+			bool conflict(false);
+			const taskStationsMap &taskStations(pObs->getStations());
+			for (taskStationsMap::const_iterator it = taskStations.begin(); !conflict && (it != taskStations.end()); ++it) {
+				conflict = !schedule.getStation(it->second)->getTaskswithinTimeSpan(pObs->getScheduledStart(), pObs->getScheduledEnd()).empty();
+			}
+			if (!conflict) {
+				pObs->syncStartStopTimes();
+				QVERIFY(schedule.scheduleTask(pObs));
+				break;
+			}
+		}
+	}
+}
+
+std::string TestOptimizer::scheduleState(const SchedulerDataBlock &schedule)
+{
+	std::ostringstream state;
+	const scheduledTasksMap &scheduled(schedule.getScheduledTasks());
+	for (scheduledTasksMap::const_iterator it = scheduled.begin(); it != scheduled.end(); ++it) {
+		state << it->first << ":" << it->second->getScheduledStart().toString() << ":" << it->second->getStatus()
+			  << ":" << it->second->getShiftDirection() << " ";
+	}
+	state << "| ";
+	const unscheduledTasksDeque &unscheduled(schedule.getUnscheduledTasks());
+	for (unscheduledTasksDeque::const_iterator it = unscheduled.begin(); it != unscheduled.end(); ++it) {
+		state << (*it)->getID() << ":" << (*it)->getStatus() << " ";
+	}
+	const stationsMap &stations(schedule.getStations());
+	for (stationsMap::const_iterator sit = stations.begin(); sit != stations.end(); ++sit) {
+		state << "| " << sit->first << ": ";
+		const stationTasksVector &tasks(sit->second.getTasks());
+		for (stationTasksVector::const_iterator it = tasks.begin(); it != tasks.end(); ++it) {
+			state << it->first << "@" << it->second.first.toString() << "-" << it->second.second.toString() << " ";
+		}
+	}
+	return state.str();
+}
+
+void TestOptimizer::stationIndex()
+{
+	Station station("CS001", 1);
+	AstroDateTime start(Controller::theSchedulerSettings.getEarliestSchedulingDay());
+	AstroTime gap(Controller::theSchedulerSettings.getMinimumTimeBetweenTasks());
+	stationTasksVector reference;
+	for (unsigned id = 1; id <= 500; ++id) {
+		AstroDateTime taskStart(start + AstroTime((rand() % 2000) / 10.0));
+		AstroDateTime taskEnd(taskStart + AstroTime((1 + rand() % 300) / 100.0)); // overlapping tasks of up to 3 days
+		QVERIFY(station.addTasktoStation(id, taskStart, taskEnd));
+		reference.push_back(stationTask(id, std::pair<AstroDateTime, AstroDateTime>(taskStart, taskEnd)));
+	}
+	// move and remove some tasks, so the longest task changes
+	for (unsigned id = 1; id <= 100; ++id) {
+		AstroDateTime taskStart(start + AstroTime((rand() % 2000) / 10.0));
+		AstroDateTime taskEnd(taskStart + AstroTime((1 + rand() % 50) / 100.0));
+		QVERIFY(station.moveTask(id, taskStart, taskEnd));
+		reference[id - 1].second = std::pair<AstroDateTime, AstroDateTime>(taskStart, taskEnd);
+	}
+	for (unsigned id = 101; id <= 150; ++id) {
+		QCOMPARE(station.removeTask(id).first, id);
+	}
+	reference.erase(reference.begin() + 100, reference.begin() + 150);
+
+	for (unsigned query = 0; query < 1000; ++query) {
+		AstroDateTime queryStart(start + AstroTime((rand() % 2100) / 10.0 - 5.0));
+		AstroDateTime queryEnd(queryStart + AstroTime((rand() % 200) / 100.0));
+		std::vector<unsigned> expected;
+		for (stationTasksVector::const_iterator it = reference.begin(); it != reference.end(); ++it) {
+			if ((it->second.first < queryEnd + gap) && (it->second.second > queryStart - gap)) {
+				expected.push_back(it->first);
+			}
+		}
+		std::vector<unsigned> found(station.getTaskswithinTimeSpan(queryStart, queryEnd));
+		std::sort(expected.begin(), expected.end());
+		std::sort(found.begin(), found.end());
+		QVERIFY(found == expected);
+	}
+}
+
+void TestOptimizer::undoRestoresSchedule()
+{
+	SchedulerDataBlock schedule;
+	fillSchedule(schedule, 1000);
+	unsigned penalty = schedule.calculatePenalty();
+	const std::string before(scheduleState(schedule));
+
+	unsigned seed(2);
+	schedule.startUndoLog();
+	for (unsigned change = 0; change < 2000; ++change) {
+		size_t mark = schedule.beginChange();
+		unsigned taskID = schedule.getRandomScheduledTaskID(seed);
+		QVERIFY(taskID);
+		switch (change % 4) {
+		case 0: schedule.tryShiftTaskWithinDay(taskID, true); break;
+		case 1: schedule.tryMoveTaskToAdjacentDay(taskID, true); break;
+		case 2: schedule.shiftTask(taskID, true); break;
+		default: schedule.unscheduleTask(taskID); break;
+		}
+		unsigned incremental = schedule.updatePenalty();
+		QCOMPARE(incremental, schedule.calculatePenalty());
+		if (change % 3 == 0) { // reject a third of the changes
+			schedule.undoChanges(mark);
+			QCOMPARE(schedule.calculatePenalty(), schedule.getPenalty());
+		}
+	}
+	schedule.undoChanges(0);
+	schedule.stopUndoLog();
+
+	QCOMPARE(schedule.getPenalty(), penalty);
+	QCOMPARE(schedule.calculatePenalty(), penalty);
+	QVERIFY(scheduleState(schedule) == before);
+}
+
+void TestOptimizer::benchmarkOptimize()
+{
+	const unsigned nrTasks = 3000, nrIterations = 20000;
+	SchedulerDataBlock schedule;
+	fillSchedule(schedule, nrTasks);
+	SchedulerData data;
+	data.setCurrentSchedule(schedule);
+	unsigned startPenalty = data.calcCurrentPenalty();
+
+	// what copying the schedule would cost in every iteration
+	QTime timer;
+	timer.start();
+	for (unsigned i = 0; i < 10; ++i) {
+		NeighbourSolution copy;
+		copy = data.getCurrentSchedule();
+	}
+	double copyMs = timer.elapsed() / 10.0;
+
+	Controller::theSchedulerSettings.setUserAcceptedPenaltyEnabled(false);
+	Controller::theSchedulerSettings.setmaxNrOptimizationsEnabled(true);
+	Controller::theSchedulerSettings.setMaxNrOptimizations(nrIterations);
+
+	std::vector<unsigned> nrChains;
+	nrChains.push_back(1);
+	if (QThread::idealThreadCount() > 1) {
+		nrChains.push_back(QThread::idealThreadCount());
+	}
+	for (std::vector<unsigned>::const_iterator it = nrChains.begin(); it != nrChains.end(); ++it) {
+		data.setCurrentSchedule(schedule);
+		Scheduler scheduler;
+		scheduler.setData(data);
+		scheduler.setNrOfAnnealingChains(*it);
+		timer.restart();
+		QCOMPARE(scheduler.optimize(), 2);
+		int ms = timer.elapsed();
+		unsigned endPenalty = data.calcCurrentPenalty();
+		QVERIFY(endPenalty <= startPenalty);
+		QVERIFY(data.getNrScheduled() + data.getNrUnscheduled() == nrTasks);
+		printf("%u tasks, %u chain(s) of %u iterations: %d ms (%.1f iterations/s per chain), penalty %u -> %u; copying the schedule takes %.1f ms\n",
+				nrTasks, *it, nrIterations, ms, 1000.0 * nrIterations / std::max(ms, 1), startPenalty, endPenalty, copyMs);
+	}
+}
+
+QTEST_APPLESS_MAIN(TestOptimizer)
+#include "testoptimizer.moc"